@@ -1313,6 +1313,22 @@ gst_curl_http_src_handle_response (GstCurlHttpSrc * src)
     }
   }
 
+  /*
+   * Time from the start of the request until the connection, including the
+   * TLS handshake, was set up. Close to zero if a connection was reused
+   */
+  if (curl_easy_getinfo (src->curl_handle, CURLINFO_APPCONNECT_TIME,
+          &curl_info_dbl) != CURLE_OK || curl_info_dbl <= 0.0) {
+    if (curl_easy_getinfo (src->curl_handle, CURLINFO_CONNECT_TIME,
+            &curl_info_dbl) != CURLE_OK)
+      curl_info_dbl = -1.0;
+  }
+  if (curl_info_dbl >= 0.0) {
+    gst_structure_set (src->http_headers, CONNECT_TIME_NAME,
+        GST_TYPE_CLOCK_TIME, (GstClockTime) (curl_info_dbl * GST_SECOND),
+        NULL);
+  }
+
   /*
    * Push the content length
    */
@@ -90,6 +90,7 @@ typedef struct _GstCurlHttpSrcQueueElement GstCurlHttpSrcQueueElement;
 #define REQUEST_HEADERS_NAME    "request-headers"
 #define RESPONSE_HEADERS_NAME   "response-headers"
 #define REDIRECT_URI_NAME       "redirection-uri"
+#define CONNECT_TIME_NAME       "connect-time"
 
 typedef enum
   {
@@ -1777,15 +1777,69 @@ beach:
   return !fragment_finished;
 }
 
+/* Finds the next subsegment in playback direction that starts with a key
+ * unit. Returns FALSE if the sidx has no usable SAP information, otherwise
+ * @next_idx is set to the entry or to one past the end in playback direction
+ * if there is none */
+static gboolean
+gst_dash_demux_stream_sidx_next_key_unit (GstDashDemuxStream * dashstream,
+    gboolean forward, gint * next_idx)
+{
+  GstSidxBox *sidx = SIDX (dashstream);
+  GArray *ranges;
+  gboolean ret;
+  guint i;
+
+  ranges = gst_isoff_sidx_box_plan_ranges (sidx, dashstream->sidx_base_offset,
+      GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE,
+      GST_ISOFF_SIDX_RANGE_PLAN_KEY_UNITS);
+
+  ret = ranges->len > 0;
+  *next_idx = forward ? sidx->entries_count : -1;
+
+  for (i = 0; i < ranges->len; i++) {
+    GstSidxRange *range = &g_array_index (ranges, GstSidxRange, i);
+
+    if (forward && range->entry_index > sidx->entry_index) {
+      *next_idx = range->entry_index;
+      break;
+    } else if (!forward && range->entry_index < sidx->entry_index) {
+      *next_idx = range->entry_index;
+    }
+  }
+
+  g_array_free (ranges, TRUE);
+
+  return ret;
+}
+
 static gboolean
 gst_dash_demux_stream_advance_subfragment (GstAdaptiveDemuxStream * stream)
 {
   GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
 
   GstSidxBox *sidx = SIDX (dashstream);
   gboolean fragment_finished = TRUE;
 
   if (dashstream->sidx_parser.status == GST_ISOFF_SIDX_PARSER_FINISHED) {
+    gint key_unit_idx;
+    gboolean skip_to_key_unit =
+        GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (dashdemux)
+        && dashdemux->allow_trickmode_key_units
+        && dashstream->active_stream->mimeType == GST_STREAM_VIDEO
+        && gst_dash_demux_stream_sidx_next_key_unit (dashstream,
+        stream->demux->segment.rate > 0.0, &key_unit_idx);
+
+    /* In key-units trick mode subsegments without a key unit at their start
+     * are skipped completely instead of downloading their moof first */
+    if (skip_to_key_unit) {
+      GST_LOG_OBJECT (stream->pad, "Skipping from sidx entry %d to %d",
+          sidx->entry_index, key_unit_idx);
+      sidx->entry_index = stream->demux->segment.rate > 0.0 ?
+          key_unit_idx - 1 : key_unit_idx + 1;
+    }
+
     if (stream->demux->segment.rate > 0.0) {
       gint idx = ++sidx->entry_index;
       if (idx < sidx->entries_count) {
@@ -2528,7 +2582,8 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
   new_client->mpd_base_uri = g_strdup (demux->manifest_base_uri);
   gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
 
-  if (gst_mpd_client_parse (new_client, (gchar *) mapinfo.data, mapinfo.size)) {
+  if (gst_mpd_client_parse_update (new_client, (gchar *) mapinfo.data,
+          mapinfo.size, dashdemux->client)) {
     const gchar *period_id;
     guint period_idx;
     GList *iter;
@@ -3020,15 +3075,16 @@ gst_dash_demux_parse_isobmff (GstAdaptiveDemux * demux,
         dash_stream->isobmff_parser.current_start_offset, size);
 
     if (dash_stream->isobmff_parser.current_fourcc == GST_ISOFF_FOURCC_MOOF) {
-      GstByteReader sub_reader;
-
       /* Only allow SIDX before the very first moof */
       dash_stream->allow_sidx = FALSE;
 
       g_assert (dash_stream->moof == NULL);
       g_assert (dash_stream->moof_sync_samples == NULL);
-      gst_byte_reader_get_sub_reader (&reader, &sub_reader, size - header_size);
-      dash_stream->moof = gst_isoff_moof_box_parse (&sub_reader);
+      /* Parse in place, the trun sample tables are only decoded when looking
+       * for sync samples */
+      dash_stream->moof = gst_isoff_moof_box_parse_buffer (buffer,
+          gst_byte_reader_get_pos (&reader), size - header_size);
+      gst_byte_reader_skip_unchecked (&reader, size - header_size);
       dash_stream->moof_offset =
           dash_stream->isobmff_parser.current_start_offset;
       dash_stream->moof_size = size;
@@ -3243,9 +3299,9 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
       }
 
       prev_sample_end = trun_offset;
-      for (k = 0; k < trun->samples->len; k++) {
-        GstTrunSample *sample =
-            &g_array_index (trun->samples, GstTrunSample, k);
+      for (k = 0; k < trun->sample_count; k++) {
+        GstTrunSample sample_data;
+        GstTrunSample *sample = &sample_data;
         guint64 sample_offset;
         guint32 sample_flags;
 #if 0
@@ -3254,6 +3310,8 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
 
         sample_offset = prev_sample_end;
 
+        gst_isoff_trun_box_get_sample (trun, k, sample);
+
         if (trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) {
           sample_flags = sample->sample_flags;
         } else if ((trun->flags & GST_TRUN_FLAGS_FIRST_SAMPLE_FLAGS_PRESENT)
@@ -161,6 +161,7 @@ static const DashSinkMuxer dash_muxer_list[] = {
 #define DEFAULT_MPD_MIN_BUFFER_TIME 2000
 #define DEFAULT_MPD_PERIOD_DURATION GST_CLOCK_TIME_NONE
 #define DEFAULT_MPD_SUGGESTED_PRESENTATION_DELAY 0
+#define DEFAULT_CHUNK_DURATION 0
 
 #define DEFAULT_DASH_SINK_MUXER GST_DASH_SINK_MUXER_TS
 
@@ -186,6 +187,7 @@ enum
   PROP_MPD_BASEURL,
   PROP_MPD_PERIOD_DURATION,
   PROP_MPD_SUGGESTED_PRESENTATION_DELAY,
+  PROP_CHUNK_DURATION,
 };
 
 enum
@@ -253,6 +255,7 @@ struct _GstDashSink
   guint64 suggested_presentation_delay;
   guint64 min_buffer_time;
   gint64 period_duration;
+  guint64 chunk_duration;
 };
 
 typedef struct _GstDashSinkStream
@@ -557,6 +560,26 @@ gst_dash_sink_class_init (GstDashSinkClass * klass)
           G_MAXUINT64, DEFAULT_MPD_PERIOD_DURATION,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * dashsink:chunk-duration
+   *
+   * Duration in milliseconds of the CMAF chunks (moof/mdat pairs) written
+   * while a segment is still being produced. Only used with the mp4 muxer.
+   * When enabled, the segments are announced in the MPD with an
+   * availabilityTimeOffset so that clients can start fetching them with
+   * chunked transfer before they are complete. 0 disables low-latency
+   * chunking.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_CHUNK_DURATION,
+      g_param_spec_uint64 ("chunk-duration", "Chunk duration",
+          "Duration in milliseconds of the low-latency CMAF chunks written "
+          "inside a segment (0 = disabled, mp4 muxer only)", 0,
+          G_MAXUINT, DEFAULT_CHUNK_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstDashSink::get-playlist-stream:
    * @sink: the #GstDashSink
@@ -590,6 +613,12 @@ gst_dash_sink_class_init (GstDashSinkClass * klass)
   gst_type_mark_as_plugin_api (GST_TYPE_DASH_SINK_MUXER, 0);
 }
 
+static gboolean
+gst_dash_sink_is_low_latency (GstDashSink * sink)
+{
+  return sink->chunk_duration > 0 && sink->muxer == GST_DASH_SINK_MUXER_MP4;
+}
+
 static gchar *
 on_format_location (GstElement * splitmuxsink, guint fragment_id,
     GstDashSinkStream * dash_stream)
@@ -646,12 +675,20 @@ gst_dash_sink_add_splitmuxsink (GstDashSink * sink, GstDashSinkStream * stream)
       gst_element_factory_make (dash_muxer_list[sink->muxer].element_name,
       NULL);
 
-  if (sink->muxer == GST_DASH_SINK_MUXER_MP4)
-    g_object_set (mux, "fragment-duration", sink->target_duration * GST_MSECOND,
-        NULL);
-
   g_return_val_if_fail (mux != NULL, FALSE);
 
+  if (sink->muxer == GST_DASH_SINK_MUXER_MP4) {
+    if (gst_dash_sink_is_low_latency (sink)) {
+      /* Push every chunk out as soon as it is produced, without going back
+       * to rewrite the headers at the end of the segment */
+      g_object_set (mux, "fragment-duration", (guint) sink->chunk_duration,
+          "streamable", TRUE, NULL);
+    } else {
+      g_object_set (mux, "fragment-duration",
+          sink->target_duration * GST_MSECOND, NULL);
+    }
+  }
+
   stream->splitmuxsink = gst_element_factory_make ("splitmuxsink", NULL);
   if (!stream->splitmuxsink) {
     gst_object_unref (mux);
@@ -699,6 +736,7 @@ gst_dash_sink_init (GstDashSink * sink)
   sink->min_buffer_time = DEFAULT_MPD_MIN_BUFFER_TIME;
   sink->period_duration = DEFAULT_MPD_PERIOD_DURATION;
   sink->suggested_presentation_delay = DEFAULT_MPD_SUGGESTED_PRESENTATION_DELAY;
+  sink->chunk_duration = DEFAULT_CHUNK_DURATION;
 
   g_mutex_init (&sink->mpd_lock);
 
@@ -831,6 +869,16 @@ gst_dash_sink_generate_mpd_content (GstDashSink * sink,
             sink->current_period_id, stream->adaptation_set_id,
             stream->representation_id, "media", media_segment_template,
             "duration", sink->target_duration, NULL);
+        if (gst_dash_sink_is_low_latency (sink)) {
+          /* The first chunk is available one chunk duration after the
+           * segment starts instead of after the whole segment */
+          gdouble offset = sink->target_duration -
+              (gdouble) sink->chunk_duration / 1000;
+          gst_mpd_client_set_segment_template (sink->mpd_client,
+              sink->current_period_id, stream->adaptation_set_id,
+              stream->representation_id, "availability-time-offset",
+              MAX (offset, 0), "availability-time-complete", FALSE, NULL);
+        }
         g_free (media_segment_template);
       }
     }
@@ -1143,6 +1191,9 @@ gst_dash_sink_set_property (GObject * object, guint prop_id,
     case PROP_MPD_PERIOD_DURATION:
       sink->period_duration = g_value_get_uint64 (value);
       break;
+    case PROP_CHUNK_DURATION:
+      sink->chunk_duration = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1192,6 +1243,9 @@ gst_dash_sink_get_property (GObject * object, guint prop_id,
     case PROP_MPD_PERIOD_DURATION:
       g_value_set_uint64 (value, sink->period_duration);
       break;
+    case PROP_CHUNK_DURATION:
+      g_value_set_uint64 (value, sink->chunk_duration);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -73,6 +73,11 @@ struct _GstMPDAdaptationSetNode
 
   gchar *xlink_href;
   GstMPDXLinkActuate actuate;
+
+  /* hash of the XML subtree the node was parsed from, including what it
+   * inherits from its Period, 0 if it must not be reused by a manifest
+   * update */
+  guint64 content_hash;
 };
 
 GstMPDAdaptationSetNode * gst_mpd_adaptation_set_node_new (void);
@@ -491,11 +491,21 @@ gst_mpd_client_free (GstMPDClient * client)
 
 gboolean
 gst_mpd_client_parse (GstMPDClient * client, const gchar * data, gint size)
+{
+  return gst_mpd_client_parse_update (client, data, size, NULL);
+}
+
+/* Parses a manifest update, sharing the unchanged Periods and AdaptationSets
+ * with the manifest of @previous */
+gboolean
+gst_mpd_client_parse_update (GstMPDClient * client, const gchar * data,
+    gint size, GstMPDClient * previous)
 {
   gboolean ret = FALSE;
 
 
-  ret = gst_mpdparser_get_mpd_root_node (&client->mpd_root_node, data, size);
+  ret = gst_mpdparser_update_mpd_root_node (&client->mpd_root_node, data, size,
+      previous ? previous->mpd_root_node : NULL);
 
   if (ret) {
     gst_mpd_client_check_profiles (client);
@@ -60,6 +60,7 @@ void gst_mpd_client_free (GstMPDClient * client);
 
 /* main mpd parsing methods from xml data */
 gboolean gst_mpd_client_parse (GstMPDClient * client, const gchar * data, gint size);
+gboolean gst_mpd_client_parse_update (GstMPDClient * client, const gchar * data, gint size, GstMPDClient * previous);
 
 /* xml generator */
 gboolean gst_mpd_client_get_xml_content (GstMPDClient * client, gchar ** data, gint * size);
@@ -25,6 +25,7 @@
  */
 
 #include <string.h>
+#include <libxml/xmlreader.h>
 
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
@@ -62,20 +63,21 @@ static gboolean gst_mpdparser_parse_representation_node (GList ** list,
     xmlNode * a_node, GstMPDAdaptationSetNode * parent,
     GstMPDPeriodNode * period_node);
 static gboolean gst_mpdparser_parse_adaptation_set_node (GList ** list,
-    xmlNode * a_node, GstMPDPeriodNode * parent);
+    xmlNode * a_node, GstMPDPeriodNode * parent, GList * previous,
+    guint64 inherited_hash);
 static void gst_mpdparser_parse_subset_node (GList ** list, xmlNode * a_node);
 static gboolean
 gst_mpdparser_parse_segment_template_node (GstMPDSegmentTemplateNode ** pointer,
     xmlNode * a_node, GstMPDSegmentTemplateNode * parent);
 static gboolean gst_mpdparser_parse_period_node (GList ** list,
-    xmlNode * a_node);
+    xmlNode * a_node, GList * previous);
 static void gst_mpdparser_parse_program_info_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_range_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node);
 static gboolean gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader, GstMPDRootNode * previous);
 static void gst_mpdparser_parse_utctiming_node (GList ** list,
     xmlNode * a_node);
 
@@ -641,15 +643,107 @@ error:
   return FALSE;
 }
 
+/* Content hashes used to share unchanged Period and AdaptationSet nodes
+ * between a manifest and its update (64 bit FNV-1a) */
+#define GST_MPDPARSER_HASH_INIT G_GUINT64_CONSTANT (14695981039346656037)
+#define GST_MPDPARSER_HASH_PRIME G_GUINT64_CONSTANT (1099511628211)
+
+#define XLINK_NAMESPACE "http://www.w3.org/1999/xlink"
+
+static guint64
+gst_mpdparser_hash_string (guint64 hash, const xmlChar * str)
+{
+  if (str) {
+    for (; *str; str++) {
+      hash ^= *str;
+      hash *= GST_MPDPARSER_HASH_PRIME;
+    }
+  }
+
+  /* the terminating NUL separates consecutive strings */
+  return hash * GST_MPDPARSER_HASH_PRIME;
+}
+
+static guint64
+gst_mpdparser_hash_node (guint64 hash, xmlNode * a_node, gboolean * has_xlink)
+{
+  xmlAttr *attr;
+  xmlNode *cur_node;
+
+  hash = gst_mpdparser_hash_string (hash, a_node->name);
+
+  for (attr = a_node->properties; attr; attr = attr->next) {
+    if (attr->ns) {
+      if (xmlStrcmp (attr->ns->href, (xmlChar *) XLINK_NAMESPACE) == 0)
+        *has_xlink = TRUE;
+      hash = gst_mpdparser_hash_string (hash, attr->ns->href);
+    }
+    hash = gst_mpdparser_hash_string (hash, attr->name);
+    for (cur_node = attr->children; cur_node; cur_node = cur_node->next)
+      hash = gst_mpdparser_hash_string (hash, cur_node->content);
+  }
+
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (cur_node->type == XML_ELEMENT_NODE) {
+      hash = gst_mpdparser_hash_node (hash, cur_node, has_xlink);
+    } else if (cur_node->type == XML_TEXT_NODE
+        || cur_node->type == XML_CDATA_SECTION_NODE) {
+      hash = gst_mpdparser_hash_string (hash, cur_node->content);
+    }
+  }
+
+  /* end of element, so that siblings and children hash differently */
+  return gst_mpdparser_hash_string (hash, (xmlChar *) "/");
+}
+
+/* Returns 0 for subtrees containing xlink references: resolving them
+ * modifies the nodes, so these can't be shared */
+static guint64
+gst_mpdparser_get_content_hash (xmlNode * a_node, guint64 seed)
+{
+  gboolean has_xlink = FALSE;
+  guint64 hash;
+
+  hash = gst_mpdparser_hash_node (seed ? seed : GST_MPDPARSER_HASH_INIT,
+      a_node, &has_xlink);
+  if (has_xlink || hash == 0)
+    return 0;
+
+  return hash;
+}
+
 static gboolean
 gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
-    GstMPDPeriodNode * parent)
+    GstMPDPeriodNode * parent, GList * previous, guint64 inherited_hash)
 {
   xmlNode *cur_node;
   GstMPDAdaptationSetNode *new_adap_set;
   gchar *actuate;
+  guint64 content_hash;
+  guint id;
+
+  content_hash = gst_mpdparser_get_content_hash (a_node, inherited_hash);
+
+  /* reuse the AdaptationSet of the previous manifest with the same id if
+   * neither its content nor what it inherits from the Period changed */
+  if (previous && content_hash
+      && gst_xml_helper_get_prop_unsigned_integer (a_node, "id", 0, &id)) {
+    GList *l;
+
+    for (l = previous; l; l = l->next) {
+      GstMPDAdaptationSetNode *prev_adap_set = l->data;
+
+      if (prev_adap_set->id == id
+          && prev_adap_set->content_hash == content_hash) {
+        GST_LOG ("reusing unchanged AdaptationSet %u", id);
+        *list = g_list_append (*list, gst_object_ref (prev_adap_set));
+        return TRUE;
+      }
+    }
+  }
 
   new_adap_set = gst_mpd_adaptation_set_node_new ();
+  new_adap_set->content_hash = content_hash;
 
   GST_LOG ("attributes of AdaptationSet node:");
 
@@ -817,6 +911,16 @@ gst_mpdparser_parse_segment_template_node (GstMPDSegmentTemplateNode ** pointer,
         xmlMemStrdup (parent->bitstreamSwitching);
   }
 
+  if (!gst_xml_helper_get_prop_double (a_node, "availabilityTimeOffset",
+          &new_segment_template->availabilityTimeOffset) && parent) {
+    new_segment_template->availabilityTimeOffset =
+        parent->availabilityTimeOffset;
+  }
+
+  gst_xml_helper_get_prop_boolean (a_node, "availabilityTimeComplete",
+      parent ? parent->availabilityTimeComplete : TRUE,
+      &new_segment_template->availabilityTimeComplete);
+
   *pointer = new_segment_template;
   return TRUE;
 
@@ -825,14 +929,55 @@ error:
   return FALSE;
 }
 
+static GstMPDPeriodNode *
+gst_mpdparser_find_period (GList * periods, xmlNode * a_node)
+{
+  GstMPDPeriodNode *period = NULL;
+  xmlChar *id;
+  GList *l;
+
+  id = xmlGetProp (a_node, (xmlChar *) "id");
+  if (!id)
+    return NULL;
+
+  for (l = periods; l; l = l->next) {
+    GstMPDPeriodNode *prev_period = l->data;
+
+    if (g_strcmp0 (prev_period->id, (gchar *) id) == 0) {
+      period = prev_period;
+      break;
+    }
+  }
+  xmlFree (id);
+
+  return period;
+}
+
 static gboolean
-gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node,
+    GList * previous)
 {
   xmlNode *cur_node;
   GstMPDPeriodNode *new_period;
+  GstMPDPeriodNode *prev_period;
+  guint64 content_hash;
+  guint64 inherited_hash;
   gchar *actuate;
 
+  content_hash = gst_mpdparser_get_content_hash (a_node, 0);
+
+  /* reuse the Period of the previous manifest with the same id if its
+   * content did not change at all */
+  prev_period = gst_mpdparser_find_period (previous, a_node);
+  if (prev_period && content_hash
+      && prev_period->content_hash == content_hash) {
+    GST_LOG ("reusing unchanged Period %s", prev_period->id);
+    *list = g_list_append (*list, gst_object_ref (prev_period));
+    return TRUE;
+  }
+
   new_period = gst_mpd_period_node_new ();
+  new_period->content_hash = content_hash;
 
   GST_LOG ("attributes of Period node:");
 
@@ -876,6 +1021,23 @@ gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
     }
   }
 
+  /* Hash of everything AdaptationSets inherit from this Period, as
+   * AdaptationSets of the previous manifest can only be reused if it did
+   * not change either */
+  inherited_hash = gst_mpdparser_hash_string (GST_MPDPARSER_HASH_INIT,
+      (xmlChar *) (new_period->bitstreamSwitching ? "true" : "false"));
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (cur_node->type == XML_ELEMENT_NODE &&
+        (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentBase") == 0 ||
+            xmlStrcmp (cur_node->name, (xmlChar *) "SegmentList") == 0 ||
+            xmlStrcmp (cur_node->name, (xmlChar *) "SegmentTemplate") == 0)) {
+      gboolean has_xlink = FALSE;
+
+      inherited_hash =
+          gst_mpdparser_hash_node (inherited_hash, cur_node, &has_xlink);
+    }
+  }
+
   /* We must parse AdaptationSet after everything else in the Period has been
    * parsed because certain AdaptationSet child elements can inherit attributes
    * specified by the same element in the Period
@@ -884,7 +1046,9 @@ gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "AdaptationSet") == 0) {
         if (!gst_mpdparser_parse_adaptation_set_node
-            (&new_period->AdaptationSets, cur_node, new_period))
+            (&new_period->AdaptationSets, cur_node, new_period,
+                prev_period ? prev_period->AdaptationSets : NULL,
+                inherited_hash))
           goto error;
       }
     }
@@ -1010,11 +1174,21 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
   }
 }
 
+/* The MPD is read as a stream: only the root element and the top-level child
+ * currently being parsed are kept as a tree, the reader frees each child
+ * subtree once it moved past it */
 static gboolean
-gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer, xmlNode * a_node)
+gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer,
+    xmlTextReaderPtr reader, GstMPDRootNode * previous)
 {
+  xmlNode *a_node;
   xmlNode *cur_node;
   GstMPDRootNode *new_mpd_root;
+  int ret;
+
+  /* the element start of the root node, with its attributes and namespace
+   * declarations but without children yet */
+  a_node = xmlTextReaderCurrentNode (reader);
 
   gst_mpd_root_node_free (*pointer);
   *pointer = NULL;
@@ -1053,11 +1227,23 @@ gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer, xmlNode * a_node)
   gst_xml_helper_get_prop_duration (a_node, "maxSubsegmentDuration",
       GST_MPD_DURATION_NONE, &new_mpd_root->maxSubsegmentDuration);
 
-  /* explore children Period nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+  /* explore children Period nodes, one subtree at a time */
+  ret = xmlTextReaderRead (reader);
+  while (ret == 1) {
+    if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT
+        || xmlTextReaderDepth (reader) != 1) {
+      ret = xmlTextReaderRead (reader);
+      continue;
+    }
+
+    cur_node = xmlTextReaderExpand (reader);
+    if (cur_node == NULL)
+      goto error;
+
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
-        if (!gst_mpdparser_parse_period_node (&new_mpd_root->Periods, cur_node))
+        if (!gst_mpdparser_parse_period_node (&new_mpd_root->Periods, cur_node,
+                previous ? previous->Periods : NULL))
           goto error;
       } else if (xmlStrcmp (cur_node->name,
               (xmlChar *) "ProgramInformation") == 0) {
@@ -1074,8 +1260,15 @@ gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer, xmlNode * a_node)
             cur_node);
       }
     }
+
+    /* skip the subtree we just parsed */
+    ret = xmlTextReaderNext (reader);
   }
 
+  /* the rest of the document must be well-formed as well */
+  if (ret < 0)
+    goto error;
+
   *pointer = new_mpd_root;
   return TRUE;
 
@@ -1188,44 +1381,67 @@ gst_mpdparser_media_fragment_info_clear (GstMediaFragmentInfo * fragment)
 gboolean
 gst_mpdparser_get_mpd_root_node (GstMPDRootNode ** mpd_root_node,
     const gchar * data, gint size)
+{
+  return gst_mpdparser_update_mpd_root_node (mpd_root_node, data, size, NULL);
+}
+
+/*
+ * gst_mpdparser_update_mpd_root_node:
+ * @previous: (nullable): the root node of the manifest @data is an update of
+ *
+ * Parses @data like gst_mpdparser_get_mpd_root_node(). Periods and
+ * AdaptationSets of @previous whose id and content are the same in @data are
+ * not parsed again, a reference to the node of @previous is used instead.
+ */
+gboolean
+gst_mpdparser_update_mpd_root_node (GstMPDRootNode ** mpd_root_node,
+    const gchar * data, gint size, GstMPDRootNode * previous)
 {
   gboolean ret = FALSE;
 
   if (data) {
-    xmlDocPtr doc;
-    xmlNode *root_element = NULL;
+    xmlTextReaderPtr reader;
+    int res;
 
     GST_DEBUG ("MPD file fully buffered, start parsing...");
 
-    /* parse the complete MPD file into a tree (using the libxml2 default parser API) */
-
     /* this initialize the library and check potential ABI mismatches
      * between the version it was compiled for and the actual shared
      * library used
      */
     LIBXML_TEST_VERSION;
 
-    /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-    doc = xmlReadMemory (data, size, "noname.xml", NULL, XML_PARSE_NONET);
-    if (doc == NULL) {
+    /* read "data" as a stream of nodes, only the parts needed to build the
+     * MPD nodes are turned into a tree */
+    reader = xmlReaderForMemory (data, size, "noname.xml", NULL,
+        XML_PARSE_NONET);
+    if (reader == NULL) {
+      GST_ERROR ("failed to parse the MPD file");
+      return FALSE;
+    }
+
+    /* skip to the root element node */
+    do {
+      res = xmlTextReaderRead (reader);
+    } while (res == 1
+        && xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT);
+
+    if (res != 1) {
       GST_ERROR ("failed to parse the MPD file");
       ret = FALSE;
+    } else if (xmlStrcmp (xmlTextReaderConstLocalName (reader),
+            (xmlChar *) "MPD") != 0) {
+      GST_ERROR
+          ("can not find the root element MPD, failed to parse the MPD file");
+      ret = FALSE;              /* used to return TRUE before, but this seems wrong */
     } else {
-      /* get the root element node */
-      root_element = xmlDocGetRootElement (doc);
-
-      if (root_element->type != XML_ELEMENT_NODE
-          || xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
-        GST_ERROR
-            ("can not find the root element MPD, failed to parse the MPD file");
-        ret = FALSE;            /* used to return TRUE before, but this seems wrong */
-      } else {
-        /* now we can parse the MPD root node and all children nodes, recursively */
-        ret = gst_mpdparser_parse_root_node (mpd_root_node, root_element);
-      }
-      /* free the document */
-      xmlFreeDoc (doc);
+      /* now we can parse the MPD root node and all children nodes */
+      ret = gst_mpdparser_parse_root_node (mpd_root_node, reader, previous);
+      if (!ret)
+        GST_ERROR ("failed to parse the MPD file");
     }
+    /* free the reader and the document it built */
+    xmlFreeTextReader (reader);
   }
 
   return ret;
@@ -1277,7 +1493,7 @@ gst_mpdparser_get_external_periods (const gchar * data, gint size)
     for (iter = root_element->children; iter; iter = iter->next) {
       if (iter->type == XML_ELEMENT_NODE) {
         if (xmlStrcmp (iter->name, (xmlChar *) "Period") == 0) {
-          gst_mpdparser_parse_period_node (&new_periods, iter);
+          gst_mpdparser_parse_period_node (&new_periods, iter, NULL);
         } else {
           goto error;
         }
@@ -1317,7 +1533,7 @@ gst_mpdparser_get_external_adaptation_sets (const gchar * data, gint size,
     if (root_element->type == XML_ELEMENT_NODE &&
         xmlStrcmp (root_element->name, (xmlChar *) "AdaptationSet") == 0) {
       gst_mpdparser_parse_adaptation_set_node (&new_adaptation_sets,
-          root_element, period);
+          root_element, period, NULL, 0);
     }
   }
 
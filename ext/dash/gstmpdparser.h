@@ -147,6 +147,7 @@ struct _GstActiveStream
 
 /* MPD file parsing */
 gboolean gst_mpdparser_get_mpd_root_node (GstMPDRootNode ** mpd_root_node, const gchar * data, gint size);
+gboolean gst_mpdparser_update_mpd_root_node (GstMPDRootNode ** mpd_root_node, const gchar * data, gint size, GstMPDRootNode * previous);
 GstMPDSegmentListNode * gst_mpdparser_get_external_segment_list (const gchar * data, gint size, GstMPDSegmentListNode * parent);
 GList * gst_mpdparser_get_external_periods (const gchar * data, gint size);
 GList * gst_mpdparser_get_external_adaptation_sets (const gchar * data, gint size, GstMPDPeriodNode* period);
@@ -55,6 +55,10 @@ struct _GstMPDPeriodNode
 
   gchar *xlink_href;
   int actuate;
+
+  /* hash of the XML subtree the node was parsed from, 0 if it must not be
+   * reused by a manifest update */
+  guint64 content_hash;
 };
 
 GstMPDPeriodNode * gst_mpd_period_node_new (void);
@@ -38,6 +38,9 @@ struct _GstMPDSegmentTemplateNode
   gchar *index;
   gchar *initialization;
   gchar *bitstreamSwitching;
+  /* low latency chunked delivery */
+  gdouble availabilityTimeOffset;
+  gboolean availabilityTimeComplete;
 };
 
 GstMPDSegmentTemplateNode * gst_mpd_segment_template_node_new (void);
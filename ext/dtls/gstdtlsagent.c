@@ -51,11 +51,20 @@ enum
 
 static GParamSpec *properties[NUM_PROPERTIES];
 
+/* Upper bound of the client sessions remembered for resumption */
+#define MAX_SESSIONS 4096
+
+static const guchar session_id_context[] = "gstdtls";
+
 struct _GstDtlsAgentPrivate
 {
   SSL_CTX *ssl_context;
 
   GstDtlsCertificate *certificate;
+
+  /* resumption id -> SSL_SESSION of the last client handshake */
+  GMutex sessions_lock;
+  GHashTable *sessions;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GstDtlsAgent, gst_dtls_agent, GST_TYPE_OBJECT);
@@ -204,6 +213,17 @@ gst_dtls_agent_init (GstDtlsAgent * self)
 #if (OPENSSL_VERSION_NUMBER >= 0x1000200fL) && (OPENSSL_VERSION_NUMBER < 0x10100000L)
   SSL_CTX_set_ecdh_auto (priv->ssl_context, 1);
 #endif
+
+  /* Allow clients to resume their sessions, either from the server side
+   * session cache or with a session ticket. Both are bound to this context,
+   * which is shared by all connections using the same certificate. */
+  SSL_CTX_set_session_cache_mode (priv->ssl_context, SSL_SESS_CACHE_SERVER);
+  SSL_CTX_set_session_id_context (priv->ssl_context, session_id_context,
+      sizeof (session_id_context) - 1);
+
+  g_mutex_init (&priv->sessions_lock);
+  priv->sessions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) SSL_SESSION_free);
 }
 
 static void
@@ -211,6 +231,9 @@ gst_dtls_agent_finalize (GObject * gobject)
 {
   GstDtlsAgentPrivate *priv = GST_DTLS_AGENT (gobject)->priv;
 
+  g_hash_table_unref (priv->sessions);
+  g_mutex_clear (&priv->sessions_lock);
+
   SSL_CTX_free (priv->ssl_context);
   priv->ssl_context = NULL;
 
@@ -288,3 +311,64 @@ _gst_dtls_agent_peek_context (GstDtlsAgent * self)
   g_return_val_if_fail (GST_IS_DTLS_AGENT (self), NULL);
   return self->priv->ssl_context;
 }
+
+void
+_gst_dtls_agent_store_session (GstDtlsAgent * self, const gchar * id,
+    gpointer ssl)
+{
+  GstDtlsAgentPrivate *priv;
+  SSL_SESSION *session;
+
+  g_return_if_fail (GST_IS_DTLS_AGENT (self));
+  g_return_if_fail (id != NULL);
+
+  priv = self->priv;
+
+  session = SSL_get1_session (ssl);
+  if (!session)
+    return;
+
+  g_mutex_lock (&priv->sessions_lock);
+  if (g_hash_table_size (priv->sessions) >= MAX_SESSIONS
+      && !g_hash_table_contains (priv->sessions, id)) {
+    GST_DEBUG_OBJECT (self, "session cache full, not storing session of %s",
+        id);
+    SSL_SESSION_free (session);
+  } else {
+    GST_DEBUG_OBJECT (self, "storing session of %s", id);
+    g_hash_table_insert (priv->sessions, g_strdup (id), session);
+  }
+  g_mutex_unlock (&priv->sessions_lock);
+}
+
+gboolean
+_gst_dtls_agent_resume_session (GstDtlsAgent * self, const gchar * id,
+    gpointer ssl)
+{
+  GstDtlsAgentPrivate *priv;
+  SSL_SESSION *session;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (GST_IS_DTLS_AGENT (self), FALSE);
+  g_return_val_if_fail (id != NULL, FALSE);
+
+  priv = self->priv;
+
+  g_mutex_lock (&priv->sessions_lock);
+  session = g_hash_table_lookup (priv->sessions, id);
+  if (session && (guint64) SSL_SESSION_get_time (session) +
+      SSL_SESSION_get_timeout (session) < (guint64) (g_get_real_time () /
+          G_USEC_PER_SEC)) {
+    GST_DEBUG_OBJECT (self, "session of %s expired", id);
+    g_hash_table_remove (priv->sessions, id);
+    session = NULL;
+  }
+  /* SSL_set_session() takes its own reference */
+  if (session)
+    ret = SSL_set_session (ssl, session) == 1;
+  g_mutex_unlock (&priv->sessions_lock);
+
+  GST_DEBUG_OBJECT (self, "%s session of %s", ret ? "resuming" : "no", id);
+
+  return ret;
+}
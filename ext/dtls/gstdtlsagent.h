@@ -77,6 +77,17 @@ gchar *gst_dtls_agent_get_certificate_pem(GstDtlsAgent *self);
 void _gst_dtls_init_openssl(void);
 const GstDtlsAgentContext _gst_dtls_agent_peek_context(GstDtlsAgent *);
 
+/*
+ * Remembers the session negotiated by the client connection @ssl under @id,
+ * so that a later connection to the same peer can resume it.
+ */
+void _gst_dtls_agent_store_session(GstDtlsAgent *, const gchar *id, gpointer ssl);
+
+/*
+ * Offers the session stored under @id, if any, to the client connection @ssl.
+ */
+gboolean _gst_dtls_agent_resume_session(GstDtlsAgent *, const gchar *id, gpointer ssl);
+
 G_END_DECLS
 
 #endif /* gstdtlsagent_h */
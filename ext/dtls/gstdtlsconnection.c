@@ -70,6 +70,7 @@ enum
   PROP_0,
   PROP_AGENT,
   PROP_CONNECTION_STATE,
+  PROP_RESUMPTION_ID,
   NUM_PROPERTIES
 };
 
@@ -77,7 +78,41 @@ static GParamSpec *properties[NUM_PROPERTIES];
 
 static int connection_ex_index;
 
-static void handle_timeout (gpointer data, gpointer user_data);
+/* Records received while a handshake is still queued are dropped beyond
+ * this, the peer retransmits its flight anyway */
+#define MAX_PENDING_RECORDS 64
+
+/* The handshake work of all connections, the retransmission timeouts and the
+ * records queued with gst_dtls_connection_queue_handshake(), runs on one pool
+ * bounded to the number of CPUs */
+typedef enum
+{
+  WORK_TIMEOUT,
+  WORK_RECORDS,
+} WorkType;
+
+typedef struct
+{
+  GstDtlsConnection *connection;
+  WorkType type;
+  gint64 queued_at;
+} Work;
+
+typedef struct
+{
+  GstBuffer *buffer;
+  gint64 queued_at;
+} PendingRecord;
+
+static GThreadPool *handshake_pool;
+G_LOCK_DEFINE_STATIC (pool_stats);
+static guint pool_queued;
+static guint pool_queued_max;
+static GstClockTime pool_wait_max;
+
+static void handshake_pool_func (gpointer data, gpointer user_data);
+static void handle_timeout (GstDtlsConnection * self);
+static void handle_records (GstDtlsConnection * self);
 
 struct _GstDtlsConnectionPrivate
 {
@@ -104,7 +139,24 @@ struct _GstDtlsConnectionPrivate
   GstFlowReturn syscall_flow_return;
 
   gboolean timeout_pending;
-  GThreadPool *thread_pool;
+
+  GstDtlsAgent *agent;
+  gchar *resumption_id;
+  gboolean resumed;
+  gint64 handshake_start;
+  GstClockTime handshake_time;
+
+  /* PendingRecord, processed on the handshake pool */
+  GQueue pending_records;
+  gboolean records_pending;
+  guint64 records_dropped;
+  GstClockTime records_wait_max;
+
+  GstDtlsConnectionReceiveCallback receive_callback;
+  gpointer receive_callback_user_data;
+  GDestroyNotify receive_callback_destroy_notify;
+  /* the pool thread calling the receive callback, if any */
+  GThread *receive_callback_thread;
 };
 
 G_DEFINE_TYPE_WITH_CODE (GstDtlsConnection, gst_dtls_connection,
@@ -122,8 +174,12 @@ static void log_state (GstDtlsConnection *, const gchar * str);
 static gboolean export_srtp_keys (GstDtlsConnection *, GError ** err);
 static GstFlowReturn openssl_poll (GstDtlsConnection *, gboolean * notify_state,
     GError ** err);
+static gboolean verify_resumed_peer (GstDtlsConnection *,
+    gboolean * notify_state, GError ** err);
 static GstFlowReturn handle_error (GstDtlsConnection * self, int ret,
     GstResourceError error_type, gboolean * notify_state, GError ** err);
+static GstFlowReturn process_locked (GstDtlsConnection * self, gpointer data,
+    gsize len, gsize * written, gboolean * notify_state, GError ** err);
 static int openssl_verify_callback (int preverify_ok,
     X509_STORE_CTX * x509_ctx);
 
@@ -174,10 +230,21 @@ gst_dtls_connection_class_init (GstDtlsConnectionClass * klass)
       GST_DTLS_TYPE_CONNECTION_STATE,
       GST_DTLS_CONNECTION_STATE_NEW, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_RESUMPTION_ID] =
+      g_param_spec_string ("resumption-id",
+      "Resumption ID",
+      "Identifies the peer across connections, a client connection resumes "
+      "the last session negotiated with the same ID",
+      NULL, G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   _gst_dtls_init_openssl ();
 
+  handshake_pool = g_thread_pool_new (handshake_pool_func, NULL,
+      g_get_num_processors (), FALSE, NULL);
+  g_assert (handshake_pool);
+
   gobject_class->finalize = gst_dtls_connection_finalize;
 }
 
@@ -202,12 +269,16 @@ gst_dtls_connection_init (GstDtlsConnection * self)
   g_mutex_init (&priv->mutex);
   g_cond_init (&priv->condition);
 
-  /* Thread pool for handling timeouts, we only need one thread for that
-   * really and share threads with all other thread pools around there as
-   * this is not going to happen very often */
-  priv->thread_pool = g_thread_pool_new (handle_timeout, self, 1, FALSE, NULL);
-  g_assert (priv->thread_pool);
   priv->timeout_pending = FALSE;
+
+  g_queue_init (&priv->pending_records);
+}
+
+static void
+pending_record_free (PendingRecord * record)
+{
+  gst_buffer_unref (record->buffer);
+  g_free (record);
 }
 
 static void
@@ -216,14 +287,18 @@ gst_dtls_connection_finalize (GObject * gobject)
   GstDtlsConnection *self = GST_DTLS_CONNECTION (gobject);
   GstDtlsConnectionPrivate *priv = self->priv;
 
-  g_thread_pool_free (priv->thread_pool, TRUE, TRUE);
-  priv->thread_pool = NULL;
-
   SSL_free (priv->ssl);
   priv->ssl = NULL;
 
+  gst_clear_object (&priv->agent);
+  g_free (priv->resumption_id);
+  g_queue_clear_full (&priv->pending_records,
+      (GDestroyNotify) pending_record_free);
+
   if (priv->send_callback_destroy_notify)
     priv->send_callback_destroy_notify (priv->send_callback_user_data);
+  if (priv->receive_callback_destroy_notify)
+    priv->receive_callback_destroy_notify (priv->receive_callback_user_data);
 
   g_mutex_clear (&priv->mutex);
   g_cond_clear (&priv->condition);
@@ -285,6 +360,9 @@ gst_dtls_connection_set_property (GObject * object, guint prop_id,
       priv->ssl = SSL_new (ssl_context);
       g_return_if_fail (priv->ssl);
 
+      /* keeps the sessions to resume alive */
+      priv->agent = gst_object_ref (agent);
+
       priv->bio = BIO_new (BIO_s_gst_dtls_connection ());
       g_return_if_fail (priv->bio);
 
@@ -298,6 +376,12 @@ gst_dtls_connection_set_property (GObject * object, guint prop_id,
 
       log_state (self, "connection created");
       break;
+    case PROP_RESUMPTION_ID:
+      g_mutex_lock (&priv->mutex);
+      g_free (priv->resumption_id);
+      priv->resumption_id = g_value_dup_string (value);
+      g_mutex_unlock (&priv->mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -348,12 +432,19 @@ gst_dtls_connection_start (GstDtlsConnection * self, gboolean is_client,
   priv->sent_close_notify = FALSE;
   priv->received_close_notify = FALSE;
 
+  priv->resumed = FALSE;
+  priv->handshake_time = 0;
+
   /* Client immediately starts connecting, the server waits for a client to
    * start the handshake process */
   priv->is_client = is_client;
   if (priv->is_client) {
     priv->connection_state = GST_DTLS_CONNECTION_STATE_CONNECTING;
+    priv->handshake_start = g_get_monotonic_time ();
     notify_state = TRUE;
+    if (priv->resumption_id && SSL_in_before (priv->ssl))
+      _gst_dtls_agent_resume_session (priv->agent, priv->resumption_id,
+          priv->ssl);
     SSL_set_connect_state (priv->ssl);
   } else {
     if (priv->connection_state != GST_DTLS_CONNECTION_STATE_NEW) {
@@ -385,9 +476,47 @@ gst_dtls_connection_start (GstDtlsConnection * self, gboolean is_client,
 }
 
 static void
-handle_timeout (gpointer data, gpointer user_data)
+push_work (GstDtlsConnection * self, WorkType type)
+{
+  Work *work = g_new (Work, 1);
+
+  work->connection = g_object_ref (self);
+  work->type = type;
+  work->queued_at = g_get_monotonic_time ();
+
+  G_LOCK (pool_stats);
+  pool_queued++;
+  pool_queued_max = MAX (pool_queued_max, pool_queued);
+  G_UNLOCK (pool_stats);
+
+  g_thread_pool_push (handshake_pool, work, NULL);
+}
+
+static void
+handshake_pool_func (gpointer data, gpointer user_data)
+{
+  Work *work = data;
+  GstClockTime wait;
+
+  wait = (g_get_monotonic_time () - work->queued_at) * GST_USECOND;
+
+  G_LOCK (pool_stats);
+  pool_queued--;
+  pool_wait_max = MAX (pool_wait_max, wait);
+  G_UNLOCK (pool_stats);
+
+  if (work->type == WORK_TIMEOUT)
+    handle_timeout (work->connection);
+  else
+    handle_records (work->connection);
+
+  g_object_unref (work->connection);
+  g_free (work);
+}
+
+static void
+handle_timeout (GstDtlsConnection * self)
 {
-  GstDtlsConnection *self = user_data;
   GstDtlsConnectionPrivate *priv;
   gint ret;
   gboolean notify_state = FALSE;
@@ -429,8 +558,7 @@ schedule_timeout_handling (GstClock * clock, GstClockTime time, GstClockID id,
     self->priv->timeout_pending = TRUE;
 
     GST_TRACE_OBJECT (self, "Schedule timeout now");
-    g_thread_pool_push (self->priv->thread_pool, GINT_TO_POINTER (0xc0ffee),
-        NULL);
+    push_work (self, WORK_TIMEOUT);
   }
   g_mutex_unlock (&self->priv->mutex);
 
@@ -477,8 +605,7 @@ gst_dtls_connection_check_timeout_locked (GstDtlsConnection * self)
         self->priv->timeout_pending = TRUE;
         GST_TRACE_OBJECT (self, "Schedule timeout now");
 
-        g_thread_pool_push (self->priv->thread_pool, GINT_TO_POINTER (0xc0ffee),
-            NULL);
+        push_work (self, WORK_TIMEOUT);
       }
     }
   } else {
@@ -609,35 +736,48 @@ gst_dtls_connection_set_flow_return (GstDtlsConnection * self,
   self->priv->syscall_flow_return = flow_ret;
 }
 
-GstFlowReturn
-gst_dtls_connection_process (GstDtlsConnection * self, gpointer data, gsize len,
-    gsize * written, GError ** err)
+void
+gst_dtls_connection_set_receive_callback (GstDtlsConnection * self,
+    GstDtlsConnectionReceiveCallback callback, gpointer user_data,
+    GDestroyNotify destroy_notify)
 {
-  GstFlowReturn flow_ret = GST_FLOW_OK;
   GstDtlsConnectionPrivate *priv;
-  int ret;
-  gboolean notify_state = FALSE;
 
-  g_return_val_if_fail (GST_IS_DTLS_CONNECTION (self), 0);
-  g_return_val_if_fail (self->priv->ssl, 0);
-  g_return_val_if_fail (self->priv->bio, 0);
+  g_return_if_fail (GST_IS_DTLS_CONNECTION (self));
 
   priv = self->priv;
 
-  GST_TRACE_OBJECT (self, "locking @ process");
   g_mutex_lock (&priv->mutex);
-  GST_TRACE_OBJECT (self, "locked @ process");
+  /* The callback runs without the lock, wait until the user data isn't used
+   * anymore, unless we are called from the callback itself */
+  while (priv->receive_callback_thread &&
+      priv->receive_callback_thread != g_thread_self ())
+    g_cond_wait (&priv->condition, &priv->mutex);
+
+  if (priv->receive_callback_destroy_notify)
+    priv->receive_callback_destroy_notify (priv->receive_callback_user_data);
+  priv->receive_callback = callback;
+  priv->receive_callback_user_data = user_data;
+  priv->receive_callback_destroy_notify = destroy_notify;
+  g_mutex_unlock (&priv->mutex);
+}
+
+static GstFlowReturn
+process_locked (GstDtlsConnection * self, gpointer data, gsize len,
+    gsize * written, gboolean * notify_state, GError ** err)
+{
+  GstFlowReturn flow_ret = GST_FLOW_OK;
+  GstDtlsConnectionPrivate *priv = self->priv;
+  int ret;
 
   if (self->priv->received_close_notify
       || self->priv->connection_state == GST_DTLS_CONNECTION_STATE_CLOSED) {
     GST_DEBUG_OBJECT (self, "Already received close_notify");
-    g_mutex_unlock (&priv->mutex);
     return GST_FLOW_EOS;
   }
 
   if (self->priv->connection_state == GST_DTLS_CONNECTION_STATE_FAILED) {
     GST_ERROR_OBJECT (self, "Had a fatal error before");
-    g_mutex_unlock (&priv->mutex);
     if (err)
       *err =
           g_error_new_literal (GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
@@ -654,12 +794,10 @@ gst_dtls_connection_process (GstDtlsConnection * self, gpointer data, gsize len,
   log_state (self, "process start");
 
   if (SSL_want_write (priv->ssl)) {
-    flow_ret = openssl_poll (self, &notify_state, err);
+    flow_ret = openssl_poll (self, notify_state, err);
     log_state (self, "process want write, after poll");
-    if (flow_ret != GST_FLOW_OK) {
-      g_mutex_unlock (&priv->mutex);
+    if (flow_ret != GST_FLOW_OK)
       return flow_ret;
-    }
   }
 
   /* If we're a server and were in new state then by receiving the first data
@@ -667,7 +805,8 @@ gst_dtls_connection_process (GstDtlsConnection * self, gpointer data, gsize len,
   if (!priv->is_client) {
     if (self->priv->connection_state == GST_DTLS_CONNECTION_STATE_NEW) {
       priv->connection_state = GST_DTLS_CONNECTION_STATE_CONNECTING;
-      notify_state = TRUE;
+      priv->handshake_start = g_get_monotonic_time ();
+      *notify_state = TRUE;
     }
   }
 
@@ -676,44 +815,53 @@ gst_dtls_connection_process (GstDtlsConnection * self, gpointer data, gsize len,
   GST_DEBUG_OBJECT (self, "read result: %d", ret);
 
   flow_ret =
-      handle_error (self, ret, GST_RESOURCE_ERROR_READ, &notify_state, err);
+      handle_error (self, ret, GST_RESOURCE_ERROR_READ, notify_state, err);
   if (flow_ret == GST_FLOW_EOS) {
     self->priv->received_close_notify = TRUE;
     if (self->priv->connection_state != GST_DTLS_CONNECTION_STATE_FAILED
         && self->priv->connection_state != GST_DTLS_CONNECTION_STATE_CLOSED) {
       self->priv->connection_state = GST_DTLS_CONNECTION_STATE_CLOSED;
-      notify_state = TRUE;
+      *notify_state = TRUE;
     }
     /* Notify about the connection being properly closed now if both
      * sides did so */
     if (self->priv->sent_close_notify && self->priv->send_callback)
       self->priv->send_callback (self, NULL, 0, NULL);
 
-    g_mutex_unlock (&priv->mutex);
-
-    if (notify_state) {
-      g_object_notify_by_pspec (G_OBJECT (self),
-          properties[PROP_CONNECTION_STATE]);
-    }
-
     return flow_ret;
   } else if (flow_ret != GST_FLOW_OK) {
-    g_mutex_unlock (&priv->mutex);
-
-    if (notify_state) {
-      g_object_notify_by_pspec (G_OBJECT (self),
-          properties[PROP_CONNECTION_STATE]);
-    }
-
     return flow_ret;
   }
 
   log_state (self, "process after read");
 
-  flow_ret = openssl_poll (self, &notify_state, err);
+  flow_ret = openssl_poll (self, notify_state, err);
 
   log_state (self, "process after poll");
 
+  return flow_ret;
+}
+
+GstFlowReturn
+gst_dtls_connection_process (GstDtlsConnection * self, gpointer data, gsize len,
+    gsize * written, GError ** err)
+{
+  GstFlowReturn flow_ret;
+  GstDtlsConnectionPrivate *priv;
+  gboolean notify_state = FALSE;
+
+  g_return_val_if_fail (GST_IS_DTLS_CONNECTION (self), 0);
+  g_return_val_if_fail (self->priv->ssl, 0);
+  g_return_val_if_fail (self->priv->bio, 0);
+
+  priv = self->priv;
+
+  GST_TRACE_OBJECT (self, "locking @ process");
+  g_mutex_lock (&priv->mutex);
+  GST_TRACE_OBJECT (self, "locked @ process");
+
+  flow_ret = process_locked (self, data, len, written, &notify_state, err);
+
   GST_TRACE_OBJECT (self, "unlocking @ process");
   g_mutex_unlock (&priv->mutex);
 
@@ -725,6 +873,154 @@ gst_dtls_connection_process (GstDtlsConnection * self, gpointer data, gsize len,
   return flow_ret;
 }
 
+gboolean
+gst_dtls_connection_queue_handshake (GstDtlsConnection * self,
+    GstBuffer * buffer)
+{
+  GstDtlsConnectionPrivate *priv;
+  PendingRecord *record;
+
+  g_return_val_if_fail (GST_IS_DTLS_CONNECTION (self), FALSE);
+  g_return_val_if_fail (self->priv->ssl, FALSE);
+
+  priv = self->priv;
+
+  g_mutex_lock (&priv->mutex);
+
+  /* Records following queued ones are queued too to keep them in order */
+  if (!priv->records_pending && (SSL_is_init_finished (priv->ssl)
+          || priv->received_close_notify
+          || priv->connection_state == GST_DTLS_CONNECTION_STATE_CLOSED
+          || priv->connection_state == GST_DTLS_CONNECTION_STATE_FAILED)) {
+    g_mutex_unlock (&priv->mutex);
+    return FALSE;
+  }
+
+  if (g_queue_get_length (&priv->pending_records) >= MAX_PENDING_RECORDS) {
+    GST_DEBUG_OBJECT (self, "too many pending handshake records, dropping");
+    priv->records_dropped++;
+    g_mutex_unlock (&priv->mutex);
+    gst_buffer_unref (buffer);
+    return TRUE;
+  }
+
+  record = g_new (PendingRecord, 1);
+  record->buffer = buffer;
+  record->queued_at = g_get_monotonic_time ();
+  g_queue_push_tail (&priv->pending_records, record);
+
+  if (!priv->records_pending) {
+    priv->records_pending = TRUE;
+    push_work (self, WORK_RECORDS);
+  }
+
+  g_mutex_unlock (&priv->mutex);
+
+  return TRUE;
+}
+
+static void
+handle_records (GstDtlsConnection * self)
+{
+  GstDtlsConnectionPrivate *priv = self->priv;
+  PendingRecord *record;
+  gboolean notify_state = FALSE;
+
+  g_mutex_lock (&priv->mutex);
+  while ((record = g_queue_pop_head (&priv->pending_records))) {
+    GstBuffer *buffer;
+    GstMapInfo map;
+    gsize written = 0;
+    GstFlowReturn flow_ret;
+    GError *err = NULL;
+
+    priv->records_wait_max = MAX (priv->records_wait_max,
+        (g_get_monotonic_time () - record->queued_at) * GST_USECOND);
+    buffer = gst_buffer_make_writable (record->buffer);
+    g_free (record);
+
+    gst_buffer_map (buffer, &map, GST_MAP_READWRITE);
+    flow_ret = process_locked (self, map.data, map.size, &written,
+        &notify_state, &err);
+    gst_buffer_unmap (buffer, &map);
+
+    if (flow_ret != GST_FLOW_OK && flow_ret != GST_FLOW_EOS) {
+      GST_WARNING_OBJECT (self, "failed to process queued record: %s",
+          err ? err->message : gst_flow_get_name (flow_ret));
+    }
+    g_clear_error (&err);
+
+    /* Application data following the handshake in the same flight and the
+     * close of the connection are handed out without the lock, the records
+     * queued meanwhile wait for us */
+    if (priv->receive_callback && ((flow_ret == GST_FLOW_OK && written > 0)
+            || flow_ret == GST_FLOW_EOS)) {
+      GstDtlsConnectionReceiveCallback callback = priv->receive_callback;
+      gpointer user_data = priv->receive_callback_user_data;
+
+      if (flow_ret == GST_FLOW_OK) {
+        gst_buffer_set_size (buffer, written);
+      } else {
+        gst_buffer_unref (buffer);
+        buffer = NULL;
+      }
+
+      priv->receive_callback_thread = g_thread_self ();
+      g_mutex_unlock (&priv->mutex);
+      if (notify_state) {
+        g_object_notify_by_pspec (G_OBJECT (self),
+            properties[PROP_CONNECTION_STATE]);
+        notify_state = FALSE;
+      }
+      callback (self, buffer, user_data);
+      g_mutex_lock (&priv->mutex);
+      priv->receive_callback_thread = NULL;
+      g_cond_broadcast (&priv->condition);
+    } else {
+      gst_buffer_unref (buffer);
+    }
+  }
+  priv->records_pending = FALSE;
+  g_mutex_unlock (&priv->mutex);
+
+  if (notify_state) {
+    g_object_notify_by_pspec (G_OBJECT (self),
+        properties[PROP_CONNECTION_STATE]);
+  }
+}
+
+GstStructure *
+gst_dtls_connection_get_stats (GstDtlsConnection * self)
+{
+  GstDtlsConnectionPrivate *priv;
+  GstStructure *s;
+
+  g_return_val_if_fail (GST_IS_DTLS_CONNECTION (self), NULL);
+
+  priv = self->priv;
+
+  g_mutex_lock (&priv->mutex);
+  s = gst_structure_new ("application/x-dtls-connection-stats",
+      "resumed", G_TYPE_BOOLEAN, priv->resumed,
+      "handshake-time", G_TYPE_UINT64, priv->handshake_time,
+      "records-queued", G_TYPE_UINT,
+      g_queue_get_length (&priv->pending_records),
+      "records-dropped", G_TYPE_UINT64, priv->records_dropped,
+      "records-wait-max", G_TYPE_UINT64, priv->records_wait_max, NULL);
+  g_mutex_unlock (&priv->mutex);
+
+  G_LOCK (pool_stats);
+  gst_structure_set (s,
+      "pool-threads", G_TYPE_UINT,
+      (guint) g_thread_pool_get_max_threads (handshake_pool),
+      "pool-queued", G_TYPE_UINT, pool_queued,
+      "pool-queued-max", G_TYPE_UINT, pool_queued_max,
+      "pool-wait-max", G_TYPE_UINT64, pool_wait_max, NULL);
+  G_UNLOCK (pool_stats);
+
+  return s;
+}
+
 GstFlowReturn
 gst_dtls_connection_send (GstDtlsConnection * self, gconstpointer data,
     gsize len, gsize * written, GError ** err)
@@ -1038,6 +1334,47 @@ handle_error (GstDtlsConnection * self, int ret, GstResourceError error_type,
   }
 }
 
+/* The certificate callback does not run for resumed sessions, the peer
+ * certificate stored in the session is offered instead */
+static gboolean
+verify_resumed_peer (GstDtlsConnection * self, gboolean * notify_state,
+    GError ** err)
+{
+  X509 *peer;
+  gchar *pem = NULL;
+  gboolean accepted = FALSE;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  peer = SSL_get1_peer_certificate (self->priv->ssl);
+#else
+  peer = SSL_get_peer_certificate (self->priv->ssl);
+#endif
+  if (peer) {
+    pem = _gst_dtls_x509_to_pem (peer);
+    X509_free (peer);
+  }
+
+  if (pem) {
+    g_signal_emit (self, signals[SIGNAL_ON_PEER_CERTIFICATE], 0, pem,
+        &accepted);
+    g_free (pem);
+  }
+
+  if (!accepted) {
+    GST_WARNING_OBJECT (self, "peer certificate of resumed session rejected");
+    if (self->priv->connection_state != GST_DTLS_CONNECTION_STATE_FAILED) {
+      self->priv->connection_state = GST_DTLS_CONNECTION_STATE_FAILED;
+      *notify_state = TRUE;
+    }
+    if (err)
+      *err =
+          g_error_new_literal (GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+          "Peer certificate of resumed session rejected");
+  }
+
+  return accepted;
+}
+
 static GstFlowReturn
 openssl_poll (GstDtlsConnection * self, gboolean * notify_state, GError ** err)
 {
@@ -1057,6 +1394,22 @@ openssl_poll (GstDtlsConnection * self, gboolean * notify_state, GError ** err)
         GST_INFO_OBJECT (self,
             "handshake just completed successfully, exporting keys");
 
+        self->priv->handshake_time =
+            (g_get_monotonic_time () - self->priv->handshake_start) *
+            GST_USECOND;
+
+        if (SSL_session_reused (self->priv->ssl)) {
+          GST_INFO_OBJECT (self, "session was resumed");
+          self->priv->resumed = TRUE;
+          if (!verify_resumed_peer (self, notify_state, err))
+            return GST_FLOW_ERROR;
+        }
+
+        /* Also stores the renewed ticket of a resumed session */
+        if (self->priv->is_client && self->priv->resumption_id)
+          _gst_dtls_agent_store_session (self->priv->agent,
+              self->priv->resumption_id, self->priv->ssl);
+
         if (!export_srtp_keys (self, err))
           return GST_FLOW_ERROR;
 
@@ -115,6 +115,8 @@ typedef gboolean (*GstDtlsConnectionSendCallback) (GstDtlsConnection * connectio
 
 /*
  * Sets the callback that will be called whenever data needs to be sent.
+ * It is also called from the handshake thread pool and timeouts, so it must
+ * only hand the data over to the thread sending it.
  */
 void gst_dtls_connection_set_send_callback(GstDtlsConnection *, GstDtlsConnectionSendCallback, gpointer, GDestroyNotify);
 
@@ -135,6 +137,32 @@ void gst_dtls_connection_set_flow_return(GstDtlsConnection *, GstFlowReturn);
  */
 GstFlowReturn gst_dtls_connection_process(GstDtlsConnection *, gpointer ptr, gsize len, gsize *written, GError **err);
 
+typedef void (*GstDtlsConnectionReceiveCallback) (GstDtlsConnection * connection, GstBuffer * buffer, gpointer user_data);
+
+/*
+ * Sets the callback that will be called with the data decoded from records
+ * queued with gst_dtls_connection_queue_handshake(), or with NULL once the
+ * peer closed the connection. The callback is called from the handshake
+ * thread pool and must only queue the data for the streaming thread,
+ * replacing it waits until a running call has returned.
+ */
+void gst_dtls_connection_set_receive_callback(GstDtlsConnection *, GstDtlsConnectionReceiveCallback, gpointer, GDestroyNotify);
+
+/*
+ * Takes @buffer and processes it on the shared handshake thread pool if the
+ * handshake is not completed yet, or if earlier records are still queued.
+ *
+ * Returns FALSE without taking @buffer otherwise, it must then be passed to
+ * gst_dtls_connection_process().
+ */
+gboolean gst_dtls_connection_queue_handshake(GstDtlsConnection *, GstBuffer *buffer);
+
+/*
+ * Returns the handshake statistics of the connection and of the shared
+ * handshake thread pool.
+ */
+GstStructure *gst_dtls_connection_get_stats(GstDtlsConnection *);
+
 /*
  * Will encode and send the given data.
  *
@@ -70,6 +70,9 @@ enum
   PROP_SRTP_CIPHER,
   PROP_SRTP_AUTH,
   PROP_CONNECTION_STATE,
+  PROP_RESUMPTION_ID,
+  PROP_ASYNC_HANDSHAKE,
+  PROP_STATS,
   NUM_PROPERTIES
 };
 
@@ -78,6 +81,8 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_CONNECTION_ID NULL
 #define DEFAULT_PEM NULL
 #define DEFAULT_PEER_PEM NULL
+#define DEFAULT_RESUMPTION_ID NULL
+#define DEFAULT_ASYNC_HANDSHAKE FALSE
 
 #define DEFAULT_DECODER_KEY NULL
 #define DEFAULT_SRTP_CIPHER 0
@@ -105,8 +110,11 @@ static GstFlowReturn sink_chain (GstPad *, GstObject * parent, GstBuffer *);
 static GstFlowReturn sink_chain_list (GstPad *, GstObject * parent,
     GstBufferList *);
 
+static void on_handshake_data (GstDtlsConnection *, GstBuffer *, GstDtlsDec *);
+static GstFlowReturn push_handshake_output (GstDtlsDec *);
+static void clear_handshake_output (GstDtlsDec *);
+
 static GstDtlsAgent *get_agent_by_pem (const gchar * pem);
-static void agent_weak_ref_notify (gchar * pem, GstDtlsAgent *);
 static void create_connection (GstDtlsDec *, gchar * id);
 static void connection_weak_ref_notify (gchar * id, GstDtlsConnection *);
 
@@ -181,6 +189,55 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
       GST_DTLS_TYPE_CONNECTION_STATE,
       GST_DTLS_CONNECTION_STATE_NEW, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstDtlsDec:resumption-id:
+   *
+   * Identifies the remote peer across connections. When acting as client,
+   * the session negotiated with the peer is remembered under this ID and
+   * resumed by the next connection with the same ID and certificate, which
+   * skips the certificate exchange and key agreement of a full handshake.
+   *
+   * Since: 1.24
+   */
+  properties[PROP_RESUMPTION_ID] =
+      g_param_spec_string ("resumption-id",
+      "Resumption ID",
+      "Identifies the peer across connections to resume its last session",
+      DEFAULT_RESUMPTION_ID, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstDtlsDec:async-handshake:
+   *
+   * Process the received handshake records on a thread pool shared by all
+   * DTLS connections and bounded to the number of CPUs instead of the
+   * streaming thread. Only the cryptography runs on the pool, the data
+   * decoded there is pushed from the streaming thread with the next
+   * buffer.
+   *
+   * Since: 1.24
+   */
+  properties[PROP_ASYNC_HANDSHAKE] =
+      g_param_spec_boolean ("async-handshake",
+      "Asynchronous handshake",
+      "Process handshake records on the shared handshake thread pool",
+      DEFAULT_ASYNC_HANDSHAKE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstDtlsDec:stats:
+   *
+   * Handshake statistics of the connection: whether the session was
+   * resumed, the handshake duration, the records queued for the handshake
+   * thread pool and their maximum waiting time, and the current and maximum
+   * queue length and maximum waiting time of the pool itself.
+   *
+   * Since: 1.24
+   */
+  properties[PROP_STATS] =
+      g_param_spec_boxed ("stats",
+      "Statistics",
+      "Handshake statistics of the connection and the handshake thread pool",
+      GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   gst_element_class_add_static_pad_template (element_class, &src_template);
@@ -199,12 +256,15 @@ gst_dtls_dec_init (GstDtlsDec * self)
   self->connection_id = NULL;
   self->connection = NULL;
   self->peer_pem = NULL;
+  self->resumption_id = DEFAULT_RESUMPTION_ID;
+  self->async_handshake = DEFAULT_ASYNC_HANDSHAKE;
 
   self->decoder_key = NULL;
   self->srtp_cipher = DEFAULT_SRTP_CIPHER;
   self->srtp_auth = DEFAULT_SRTP_AUTH;
 
   g_mutex_init (&self->src_mutex);
+  g_queue_init (&self->handshake_output);
 
   self->src = NULL;
   self->sink = gst_pad_new_from_static_template (&sink_template, "sink");
@@ -233,6 +293,10 @@ gst_dtls_dec_finalize (GObject * object)
   g_free (self->peer_pem);
   self->peer_pem = NULL;
 
+  g_free (self->resumption_id);
+  self->resumption_id = NULL;
+
+  clear_handshake_output (self);
   g_mutex_clear (&self->src_mutex);
 
   GST_LOG_OBJECT (self, "finalized");
@@ -251,6 +315,8 @@ gst_dtls_dec_dispose (GObject * object)
   }
 
   if (self->connection) {
+    gst_dtls_connection_set_receive_callback (self->connection, NULL, NULL,
+        NULL);
     g_object_unref (self->connection);
     self->connection = NULL;
   }
@@ -280,6 +346,16 @@ gst_dtls_dec_set_property (GObject * object, guint prop_id,
         create_connection (self, self->connection_id);
       }
       break;
+    case PROP_RESUMPTION_ID:
+      g_free (self->resumption_id);
+      self->resumption_id = g_value_dup_string (value);
+      if (self->connection)
+        g_object_set (self->connection, "resumption-id", self->resumption_id,
+            NULL);
+      break;
+    case PROP_ASYNC_HANDSHAKE:
+      self->async_handshake = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -318,6 +394,17 @@ gst_dtls_dec_get_property (GObject * object, guint prop_id, GValue * value,
       else
         g_value_set_enum (value, GST_DTLS_CONNECTION_STATE_CLOSED);
       break;
+    case PROP_RESUMPTION_ID:
+      g_value_set_string (value, self->resumption_id);
+      break;
+    case PROP_ASYNC_HANDSHAKE:
+      g_value_set_boolean (value, self->async_handshake);
+      break;
+    case PROP_STATS:
+      if (self->connection)
+        g_value_take_boxed (value,
+            gst_dtls_connection_get_stats (self->connection));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -330,6 +417,9 @@ gst_dtls_dec_change_state (GstElement * element, GstStateChange transition)
   GstStateChangeReturn ret;
 
   switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      clear_handshake_output (self);
+      break;
     case GST_STATE_CHANGE_NULL_TO_READY:
       if (self->connection) {
         g_signal_connect_object (self->connection,
@@ -349,6 +439,9 @@ gst_dtls_dec_change_state (GstElement * element, GstStateChange transition)
 
   ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
 
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    clear_handshake_output (self);
+
   return ret;
 }
 
@@ -526,6 +619,12 @@ process_buffer_from_list (GstBuffer ** buffer, guint idx, gpointer user_data)
   GstDtlsDec *self = GST_DTLS_DEC (process_list_data->self);
   GstFlowReturn flow_ret;
 
+  if (self->async_handshake
+      && gst_dtls_connection_queue_handshake (self->connection, *buffer)) {
+    *buffer = NULL;
+    return TRUE;
+  }
+
   *buffer = gst_buffer_make_writable (*buffer);
   flow_ret = process_buffer (self, *buffer);
 
@@ -545,6 +644,13 @@ sink_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
   GstPad *other_pad;
   ProcessListData process_list_data = { self, GST_FLOW_OK, 0 };
 
+  /* what the handshake decoded so far goes before the new data */
+  process_list_data.flow_ret = push_handshake_output (self);
+  if (process_list_data.flow_ret != GST_FLOW_OK) {
+    gst_buffer_list_unref (list);
+    return process_list_data.flow_ret;
+  }
+
   list = gst_buffer_list_make_writable (list);
   gst_buffer_list_foreach (list, process_buffer_from_list, &process_list_data);
 
@@ -565,6 +671,9 @@ sink_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
     GST_DEBUG_OBJECT (self, "Not produced any buffers");
     gst_buffer_list_unref (list);
 
+    if (process_list_data.flow_ret == GST_FLOW_OK)
+      process_list_data.flow_ret = push_handshake_output (self);
+
     return process_list_data.flow_ret;
   }
 
@@ -612,6 +721,19 @@ sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       "received buffer from %s with length %" G_GSIZE_FORMAT,
       self->connection_id, gst_buffer_get_size (buffer));
 
+  if (self->async_handshake
+      && gst_dtls_connection_queue_handshake (self->connection, buffer)) {
+    GST_LOG_OBJECT (self, "queued handshake record");
+    return push_handshake_output (self);
+  }
+
+  /* what the handshake decoded so far goes before the new data */
+  ret = push_handshake_output (self);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
   buffer = gst_buffer_make_writable (buffer);
   ret = process_buffer (self, buffer);
   if (ret == GST_FLOW_ERROR) {
@@ -653,9 +775,102 @@ sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   return ret;
 }
 
+/* Called from the handshake thread pool with the data decoded from queued
+ * records, or NULL once the peer closed the connection. Only the streaming
+ * thread pushes downstream, so the data waits for its next chain call */
+static void
+on_handshake_data (GstDtlsConnection * connection, GstBuffer * buffer,
+    GstDtlsDec * self)
+{
+  g_mutex_lock (&self->src_mutex);
+  if (self->handshake_eos) {
+    gst_clear_buffer (&buffer);
+  } else if (buffer) {
+    GST_LOG_OBJECT (self, "queueing data decoded with the handshake");
+    g_queue_push_tail (&self->handshake_output, buffer);
+  } else {
+    GST_DEBUG_OBJECT (self, "Peer closed the connection");
+    self->handshake_eos = TRUE;
+  }
+  g_mutex_unlock (&self->src_mutex);
+}
+
+/* Pushes the data decoded on the handshake thread pool since the last
+ * call, from the streaming thread */
+static GstFlowReturn
+push_handshake_output (GstDtlsDec * self)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *buffer;
+  GstPad *other_pad;
+  gboolean eos;
+
+  g_mutex_lock (&self->src_mutex);
+  if (g_queue_is_empty (&self->handshake_output) && !self->handshake_eos) {
+    g_mutex_unlock (&self->src_mutex);
+    return GST_FLOW_OK;
+  }
+  other_pad = self->src;
+  if (other_pad)
+    gst_object_ref (other_pad);
+  g_mutex_unlock (&self->src_mutex);
+
+  if (!other_pad) {
+    GST_LOG_OBJECT (self, "dropping handshake data, have no source pad");
+    clear_handshake_output (self);
+    return GST_FLOW_OK;
+  }
+
+  do {
+    g_mutex_lock (&self->src_mutex);
+    buffer = g_queue_pop_head (&self->handshake_output);
+    eos = self->handshake_eos;
+    g_mutex_unlock (&self->src_mutex);
+
+    if (buffer) {
+      GST_LOG_OBJECT (self, "pushing data decoded with the handshake");
+      ret = gst_pad_push (other_pad, buffer);
+    }
+  } while (buffer && ret == GST_FLOW_OK);
+
+  /* If the peer closed the connection, signal that we're done here now */
+  if (!buffer && eos) {
+    g_mutex_lock (&self->src_mutex);
+    self->handshake_eos = FALSE;
+    g_mutex_unlock (&self->src_mutex);
+    gst_pad_push_event (other_pad, gst_event_new_eos ());
+    ret = GST_FLOW_EOS;
+  }
+
+  gst_object_unref (other_pad);
+
+  return ret;
+}
+
+static void
+clear_handshake_output (GstDtlsDec * self)
+{
+  g_mutex_lock (&self->src_mutex);
+  g_queue_clear_full (&self->handshake_output,
+      (GDestroyNotify) gst_buffer_unref);
+  self->handshake_eos = FALSE;
+  g_mutex_unlock (&self->src_mutex);
+}
+
+/* Agents stay cached when unused so that reconnecting peers find the
+ * certificate and the session cache of their SSL context again, the unused
+ * ones are only evicted when the cache grows beyond this */
+#define MAX_CACHED_AGENTS 16
+
 static GHashTable *agent_table = NULL;
 G_LOCK_DEFINE_STATIC (agent_table);
 
+static gboolean
+agent_is_unused (gpointer key, gpointer value, gpointer user_data)
+{
+  return GST_OBJECT_REFCOUNT_VALUE (value) == 1;
+}
+
 static GstDtlsAgent *generated_cert_agent = NULL;
 
 static GstDtlsAgent *
@@ -688,7 +903,8 @@ get_agent_by_pem (const gchar * pem)
 
     if (!agent_table) {
       agent_table =
-          g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+          g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+          gst_object_unref);
     }
 
     agent = GST_DTLS_AGENT (g_hash_table_lookup (agent_table, pem));
@@ -701,17 +917,18 @@ get_agent_by_pem (const gchar * pem)
           NULL);
       g_object_unref (certificate);
 
-      g_object_weak_ref (G_OBJECT (agent), (GWeakNotify) agent_weak_ref_notify,
-          (gpointer) g_strdup (pem));
+      if (g_hash_table_size (agent_table) >= MAX_CACHED_AGENTS)
+        g_hash_table_foreach_remove (agent_table, agent_is_unused, NULL);
 
-      g_hash_table_insert (agent_table, g_strdup (pem), agent);
+      g_hash_table_insert (agent_table, g_strdup (pem),
+          gst_object_ref_sink (agent));
 
       GST_DEBUG_OBJECT (agent, "no agent found, created new");
-    } else {
-      g_object_ref (agent);
-      GST_DEBUG_OBJECT (agent, "agent found");
     }
 
+    g_object_ref (agent);
+    GST_DEBUG_OBJECT (agent, "using cached agent");
+
     G_UNLOCK (agent_table);
   }
 
@@ -719,17 +936,6 @@ get_agent_by_pem (const gchar * pem)
   return agent;
 }
 
-static void
-agent_weak_ref_notify (gchar * pem, GstDtlsAgent * agent)
-{
-  G_LOCK (agent_table);
-  g_hash_table_remove (agent_table, pem);
-  G_UNLOCK (agent_table);
-
-  g_free (pem);
-  pem = NULL;
-}
-
 static GHashTable *connection_table = NULL;
 G_LOCK_DEFINE_STATIC (connection_table);
 
@@ -776,6 +982,8 @@ create_connection (GstDtlsDec * self, gchar * id)
   if (self->connection) {
     g_signal_handlers_disconnect_by_func (self->connection,
         on_connection_state_changed, self);
+    gst_dtls_connection_set_receive_callback (self->connection, NULL, NULL,
+        NULL);
     g_object_unref (self->connection);
     self->connection = NULL;
   }
@@ -794,7 +1002,10 @@ create_connection (GstDtlsDec * self, gchar * id)
   }
 
   self->connection =
-      g_object_new (GST_TYPE_DTLS_CONNECTION, "agent", self->agent, NULL);
+      g_object_new (GST_TYPE_DTLS_CONNECTION, "agent", self->agent,
+      "resumption-id", self->resumption_id, NULL);
+  gst_dtls_connection_set_receive_callback (self->connection,
+      (GstDtlsConnectionReceiveCallback) on_handshake_data, self, NULL);
   g_signal_connect_object (self->connection,
       "notify::connection-state", G_CALLBACK (on_connection_state_changed),
       self, 0);
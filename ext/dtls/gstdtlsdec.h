@@ -53,12 +53,18 @@ struct _GstDtlsDec {
     GstPad *src;
     GstPad *sink;
     GMutex src_mutex;
+    /* data decoded on the handshake thread pool, pushed from the
+     * streaming thread, protected by src_mutex */
+    GQueue handshake_output;
+    gboolean handshake_eos;
 
     GstDtlsAgent *agent;
     GstDtlsConnection *connection;
     GMutex connection_mutex;
     gchar *connection_id;
     gchar *peer_pem;
+    gchar *resumption_id;
+    gboolean async_handshake;
 
     GstBuffer *decoder_key;
     guint srtp_cipher;
@@ -34,6 +34,14 @@
  * Just point an external webserver to the directory with the playlist and
  * fragment files.
  *
+ * When #GstHlsSink2:part-duration is set, the playlist is rewritten every
+ * time a partial segment (a byte range of the fragment currently being
+ * written) is complete, with EXT-X-PART entries as defined by Low-Latency
+ * HLS. Together with the #GstHlsSink2::get-fragment-stream signal, which
+ * allows to provide any #GOutputStream for the fragments, and the
+ * #GstHlsSink2::part-written signal, this allows to serve the media data
+ * before the fragment is closed.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! h264parse ! hlssink2 max-files=5
@@ -62,8 +70,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink2_debug);
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
 #define DEFAULT_SEND_KEYFRAME_REQUESTS TRUE
+#define DEFAULT_PART_DURATION 0
 
 #define GST_M3U8_PLAYLIST_VERSION 3
+/* EXT-X-PART byte ranges need at least version 4, EXT-X-SERVER-CONTROL 6 */
+#define GST_M3U8_PLAYLIST_LOW_LATENCY_VERSION 6
 
 enum
 {
@@ -75,6 +86,7 @@ enum
   PROP_TARGET_DURATION,
   PROP_PLAYLIST_LENGTH,
   PROP_SEND_KEYFRAME_REQUESTS,
+  PROP_PART_DURATION,
 };
 
 enum
@@ -82,6 +94,7 @@ enum
   SIGNAL_GET_PLAYLIST_STREAM,
   SIGNAL_GET_FRAGMENT_STREAM,
   SIGNAL_DELETE_FRAGMENT,
+  SIGNAL_PART_WRITTEN,
   SIGNAL_LAST
 };
 
@@ -110,6 +123,8 @@ static void gst_hls_sink2_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * spec);
 static void gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message);
 static void gst_hls_sink2_reset (GstHlsSink2 * sink);
+static void gst_hls_sink2_render_playlist (GstHlsSink2 * sink);
+static void gst_hls_sink2_write_playlist (GstHlsSink2 * sink);
 static GstStateChangeReturn
 gst_hls_sink2_change_state (GstElement * element, GstStateChange trans);
 static GstPad *gst_hls_sink2_request_new_pad (GstElement * element,
@@ -133,11 +148,14 @@ gst_hls_sink2_finalize (GObject * object)
   g_free (sink->playlist_location);
   g_free (sink->playlist_root);
   g_free (sink->current_location);
+  g_free (sink->pending_playlist);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
+  g_mutex_clear (&sink->lock);
+  g_mutex_clear (&sink->write_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
@@ -257,6 +275,23 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
           DEFAULT_SEND_KEYFRAME_REQUESTS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstHlsSink2:part-duration:
+   *
+   * Target duration in milliseconds of the Low-Latency HLS partial segments.
+   * 0 disables partial segments. Can only be changed in the NULL or READY
+   * state.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_PART_DURATION,
+      g_param_spec_uint ("part-duration", "Part duration",
+          "The target duration in milliseconds of the low-latency partial "
+          "segments written while a fragment is open (0 - disabled)",
+          0, G_MAXUINT, DEFAULT_PART_DURATION,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   /**
    * GstHlsSink2::get-playlist-stream:
    * @sink: the #GstHlsSink2
@@ -302,6 +337,24 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
       g_signal_new ("delete-fragment", G_TYPE_FROM_CLASS (klass),
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING);
 
+  /**
+   * GstHlsSink2::part-written:
+   * @sink: the #GstHlsSink2
+   * @location: Location of the fragment file the part belongs to
+   * @offset: Byte offset of the part inside the fragment
+   * @size: Size in bytes of the part
+   *
+   * Emitted from the streaming thread when a partial segment has been
+   * completely written to the fragment's output stream and was added to the
+   * playlist.
+   *
+   * Since: 1.24
+   */
+  signals[SIGNAL_PART_WRITTEN] =
+      g_signal_new ("part-written", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_STRING,
+      G_TYPE_UINT64, G_TYPE_UINT64);
+
   klass->get_playlist_stream = gst_hls_sink2_get_playlist_stream;
   klass->get_fragment_stream = gst_hls_sink2_get_fragment_stream;
 }
@@ -317,6 +370,10 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
   g_signal_emit (sink, signals[SIGNAL_GET_FRAGMENT_STREAM], 0, location,
       &stream);
 
+  g_mutex_lock (&sink->lock);
+  sink->bytes_written = 0;
+  sink->part_offset = 0;
+  sink->part_start_running_time = GST_CLOCK_TIME_NONE;
   if (!stream) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Got no output stream for fragment '%s'."), location), (NULL));
@@ -326,6 +383,7 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
     g_free (sink->current_location);
     sink->current_location = g_steal_pointer (&location);
   }
+  g_mutex_unlock (&sink->lock);
   g_object_set (sink->giostreamsink, "stream", stream, NULL);
 
   if (stream)
@@ -336,10 +394,146 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
   return NULL;
 }
 
+static gchar *
+gst_hls_sink2_get_entry_location (GstHlsSink2 * sink, const gchar * location)
+{
+  gchar *name, *entry_location;
+
+  name = g_path_get_basename (location);
+  if (sink->playlist_root == NULL)
+    return name;
+
+  entry_location = g_build_filename (sink->playlist_root, name, NULL);
+  g_free (name);
+
+  return entry_location;
+}
+
+/* A closed part, announced with part-written once the lock is released */
+typedef struct
+{
+  gchar *location;
+  guint64 offset;
+  guint64 size;
+} GstHlsSink2Part;
+
+/* Must be called with the lock held */
+static void
+gst_hls_sink2_close_part (GstHlsSink2 * sink, GstClockTime running_time,
+    GstHlsSink2Part * part)
+{
+  gchar *entry_location;
+  guint64 size;
+
+  size = sink->bytes_written - sink->part_offset;
+  entry_location =
+      gst_hls_sink2_get_entry_location (sink, sink->current_location);
+
+  GST_LOG_OBJECT (sink, "Part of %s at %" G_GUINT64_FORMAT " size %"
+      G_GUINT64_FORMAT " duration %" GST_TIME_FORMAT, entry_location,
+      sink->part_offset, size,
+      GST_TIME_ARGS (running_time - sink->part_start_running_time));
+
+  gst_m3u8_playlist_add_part (sink->playlist, entry_location,
+      running_time - sink->part_start_running_time, sink->part_offset, size,
+      sink->part_independent);
+  g_free (entry_location);
+
+  gst_hls_sink2_render_playlist (sink);
+  part->location = g_strdup (sink->current_location);
+  part->offset = sink->part_offset;
+  part->size = size;
+
+  sink->part_offset = sink->bytes_written;
+  sink->part_start_running_time = GST_CLOCK_TIME_NONE;
+}
+
+/* Must be called without the lock held */
+static void
+gst_hls_sink2_part_written (GstHlsSink2 * sink, GstHlsSink2Part * part)
+{
+  if (!part->location)
+    return;
+
+  g_signal_emit (sink, signals[SIGNAL_PART_WRITTEN], 0, part->location,
+      part->offset, part->size);
+  g_free (part->location);
+  part->location = NULL;
+}
+
+/* Keeps track of the bytes written for the current fragment and cuts them
+ * into partial segments of part-duration */
+static GstPadProbeReturn
+gst_hls_sink2_fragment_probe (GstPad * pad, GstPadProbeInfo * info,
+    GstHlsSink2 * sink)
+{
+  GstBuffer *buffer;
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  GstHlsSink2Part part = { NULL, };
+  gsize size;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+      g_mutex_lock (&sink->lock);
+      gst_event_copy_segment (event, &sink->part_segment);
+      g_mutex_unlock (&sink->lock);
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+    if (gst_buffer_list_length (list) == 0)
+      return GST_PAD_PROBE_OK;
+    buffer = gst_buffer_list_get (list, 0);
+    size = gst_buffer_list_calculate_size (list);
+  } else {
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    size = gst_buffer_get_size (buffer);
+  }
+
+  g_mutex_lock (&sink->lock);
+  if (GST_BUFFER_DTS_OR_PTS (buffer) != GST_CLOCK_TIME_NONE
+      && sink->part_segment.format == GST_FORMAT_TIME) {
+    running_time = gst_segment_to_running_time (&sink->part_segment,
+        GST_FORMAT_TIME, GST_BUFFER_DTS_OR_PTS (buffer));
+  }
+
+  if (sink->part_duration > 0 && sink->current_location
+      && GST_CLOCK_TIME_IS_VALID (running_time)) {
+    if (GST_CLOCK_TIME_IS_VALID (sink->part_start_running_time) &&
+        sink->bytes_written > sink->part_offset &&
+        running_time >= sink->part_start_running_time +
+        sink->part_duration * GST_MSECOND) {
+      gst_hls_sink2_close_part (sink, running_time, &part);
+    }
+
+    if (!GST_CLOCK_TIME_IS_VALID (sink->part_start_running_time)) {
+      sink->part_start_running_time = running_time;
+      sink->part_independent =
+          !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+  }
+
+  sink->bytes_written += size;
+  g_mutex_unlock (&sink->lock);
+
+  if (part.location) {
+    gst_hls_sink2_write_playlist (sink);
+    gst_hls_sink2_part_written (sink, &part);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
 static void
 gst_hls_sink2_init (GstHlsSink2 * sink)
 {
   GstElement *mux;
+  GstPad *pad;
 
   sink->location = g_strdup (DEFAULT_LOCATION);
   sink->playlist_location = g_strdup (DEFAULT_PLAYLIST_LOCATION);
@@ -348,12 +542,21 @@ gst_hls_sink2_init (GstHlsSink2 * sink)
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
   sink->send_keyframe_requests = DEFAULT_SEND_KEYFRAME_REQUESTS;
+  sink->part_duration = DEFAULT_PART_DURATION;
   g_queue_init (&sink->old_locations);
+  g_mutex_init (&sink->lock);
+  g_mutex_init (&sink->write_lock);
+  gst_segment_init (&sink->part_segment, GST_FORMAT_UNDEFINED);
 
   sink->splitmuxsink = gst_element_factory_make ("splitmuxsink", NULL);
   gst_bin_add (GST_BIN (sink), sink->splitmuxsink);
 
   sink->giostreamsink = gst_element_factory_make ("giostreamsink", NULL);
+  pad = gst_element_get_static_pad (sink->giostreamsink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_BUFFER_LIST | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      (GstPadProbeCallback) gst_hls_sink2_fragment_probe, sink, NULL);
+  gst_object_unref (pad);
 
   mux = gst_element_factory_make ("mpegtsmux", NULL);
   g_object_set (sink->splitmuxsink, "location", NULL, "max-size-time",
@@ -374,10 +577,27 @@ gst_hls_sink2_reset (GstHlsSink2 * sink)
 {
   sink->index = 0;
 
+  g_mutex_lock (&sink->lock);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
-  sink->playlist =
-      gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION, sink->playlist_length);
+  if (sink->part_duration > 0) {
+    sink->playlist =
+        gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_LOW_LATENCY_VERSION,
+        sink->playlist_length);
+    sink->playlist->part_target_duration =
+        sink->part_duration * GST_MSECOND;
+  } else {
+    sink->playlist =
+        gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION,
+        sink->playlist_length);
+  }
+  g_free (sink->pending_playlist);
+  sink->pending_playlist = NULL;
+  gst_segment_init (&sink->part_segment, GST_FORMAT_UNDEFINED);
+  sink->bytes_written = 0;
+  sink->part_offset = 0;
+  sink->part_start_running_time = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (&sink->lock);
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
@@ -385,6 +605,15 @@ gst_hls_sink2_reset (GstHlsSink2 * sink)
   sink->state = GST_M3U8_PLAYLIST_RENDER_INIT;
 }
 
+/* Must be called with the lock held */
+static void
+gst_hls_sink2_render_playlist (GstHlsSink2 * sink)
+{
+  g_free (sink->pending_playlist);
+  sink->pending_playlist = gst_m3u8_playlist_render (sink->playlist);
+}
+
+/* Writes the last rendered playlist, must be called without the lock held */
 static void
 gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
 {
@@ -393,16 +622,24 @@ gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
   GOutputStream *stream = NULL;
   gsize bytes_to_write;
 
+  g_mutex_lock (&sink->write_lock);
+  g_mutex_lock (&sink->lock);
+  playlist_content = g_steal_pointer (&sink->pending_playlist);
+  g_mutex_unlock (&sink->lock);
+
+  /* already written by another thread */
+  if (!playlist_content)
+    goto done;
+
   g_signal_emit (sink, signals[SIGNAL_GET_PLAYLIST_STREAM], 0,
       sink->playlist_location, &stream);
   if (!stream) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Got no output stream for playlist '%s'."), sink->playlist_location),
         (NULL));
-    return;
+    goto done;
   }
 
-  playlist_content = gst_m3u8_playlist_render (sink->playlist);
   bytes_to_write = strlen (playlist_content);
   if (!g_output_stream_write_all (stream, playlist_content, bytes_to_write,
           NULL, NULL, &error)) {
@@ -413,8 +650,11 @@ gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
     error = NULL;
   }
 
-  g_free (playlist_content);
   g_object_unref (stream);
+
+done:
+  g_free (playlist_content);
+  g_mutex_unlock (&sink->write_lock);
 }
 
 static void
@@ -432,9 +672,12 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
               &sink->current_running_time_start);
         } else if (gst_structure_has_name (s, "splitmuxsink-fragment-closed")) {
           GstClockTime running_time;
+          GstHlsSink2Part part = { NULL, };
           gchar *entry_location;
 
+          g_mutex_lock (&sink->lock);
           if (!sink->current_location) {
+            g_mutex_unlock (&sink->lock);
             GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE, ((NULL)),
                 ("Fragment closed without knowing its location"));
             break;
@@ -442,22 +685,28 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
 
           gst_structure_get_clock_time (s, "running-time", &running_time);
 
+          /* The remaining data of the fragment forms its last part */
+          if (sink->part_duration > 0 &&
+              GST_CLOCK_TIME_IS_VALID (sink->part_start_running_time) &&
+              sink->bytes_written > sink->part_offset &&
+              running_time > sink->part_start_running_time)
+            gst_hls_sink2_close_part (sink, running_time, &part);
+
           GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-          if (sink->playlist_root == NULL) {
-            entry_location = g_path_get_basename (sink->current_location);
-          } else {
-            gchar *name = g_path_get_basename (sink->current_location);
-            entry_location = g_build_filename (sink->playlist_root, name, NULL);
-            g_free (name);
-          }
+          entry_location =
+              gst_hls_sink2_get_entry_location (sink, sink->current_location);
 
           gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
               NULL, running_time - sink->current_running_time_start,
               sink->index++, FALSE);
           g_free (entry_location);
 
-          gst_hls_sink2_write_playlist (sink);
+          gst_hls_sink2_render_playlist (sink);
           sink->state |= GST_M3U8_PLAYLIST_RENDER_STARTED;
+          g_mutex_unlock (&sink->lock);
+
+          gst_hls_sink2_write_playlist (sink);
+          gst_hls_sink2_part_written (sink, &part);
 
           g_queue_push_tail (&sink->old_locations,
               g_strdup (sink->current_location));
@@ -495,9 +744,12 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
       break;
     }
     case GST_MESSAGE_EOS:{
+      g_mutex_lock (&sink->lock);
       sink->playlist->end_list = TRUE;
-      gst_hls_sink2_write_playlist (sink);
+      gst_hls_sink2_render_playlist (sink);
       sink->state |= GST_M3U8_PLAYLIST_RENDER_ENDED;
+      g_mutex_unlock (&sink->lock);
+      gst_hls_sink2_write_playlist (sink);
       break;
     }
     default:
@@ -593,7 +845,10 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans)
       /* drain playlist with #EXT-X-ENDLIST */
       if (sink->playlist && (sink->state & GST_M3U8_PLAYLIST_RENDER_STARTED) &&
           !(sink->state & GST_M3U8_PLAYLIST_RENDER_ENDED)) {
+        g_mutex_lock (&sink->lock);
         sink->playlist->end_list = TRUE;
+        gst_hls_sink2_render_playlist (sink);
+        g_mutex_unlock (&sink->lock);
         gst_hls_sink2_write_playlist (sink);
       }
       /* fall-through */
@@ -649,6 +904,19 @@ gst_hls_sink2_set_property (GObject * object, guint prop_id,
             sink->send_keyframe_requests, NULL);
       }
       break;
+    case PROP_PART_DURATION:
+      /* the playlist version and the parts depend on it */
+      GST_OBJECT_LOCK (sink);
+      if (GST_STATE (sink) > GST_STATE_READY) {
+        GST_OBJECT_UNLOCK (sink);
+        GST_WARNING_OBJECT (sink, "part-duration can only be changed in the "
+            "NULL or READY state");
+        break;
+      }
+      GST_OBJECT_UNLOCK (sink);
+      sink->part_duration = g_value_get_uint (value);
+      gst_hls_sink2_reset (sink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -683,6 +951,9 @@ gst_hls_sink2_get_property (GObject * object, guint prop_id,
     case PROP_SEND_KEYFRAME_REQUESTS:
       g_value_set_boolean (value, sink->send_keyframe_requests);
       break;
+    case PROP_PART_DURATION:
+      g_value_set_uint (value, sink->part_duration);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
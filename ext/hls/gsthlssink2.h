@@ -50,10 +50,27 @@ struct _GstHlsSink2
   gint max_files;
   gint target_duration;
   gboolean send_keyframe_requests;
+  guint part_duration;
+
+  /* protects the playlist and the partial segment state below, which are
+   * updated from the muxer's streaming thread */
+  GMutex lock;
+  GstSegment part_segment;
+  guint64 bytes_written;
+  guint64 part_offset;
+  GstClockTime part_start_running_time;
+  gboolean part_independent;
 
   GstM3U8Playlist *playlist;
   guint index;
 
+  /* playlist rendered with the lock held and written out without it, so
+   * that get-playlist-stream is not emitted under the lock. write_lock
+   * serializes the writes, so a newer playlist is never overwritten by an
+   * older one */
+  gchar *pending_playlist;
+  GMutex write_lock;
+
   gchar *current_location;
   GstClockTime current_running_time_start;
   GQueue old_locations;
@@ -32,7 +32,12 @@ enum
   GST_M3U8_PLAYLIST_TYPE_VOD,
 };
 
+/* Number of completed segments for which the partial segments are still
+ * listed, as LL-HLS clients may be fetching them when the segment closes */
+#define GST_M3U8_PLAYLIST_MAX_SEGMENTS_WITH_PARTS 2
+
 typedef struct _GstM3U8Entry GstM3U8Entry;
+typedef struct _GstM3U8Part GstM3U8Part;
 
 struct _GstM3U8Entry
 {
@@ -40,8 +45,25 @@ struct _GstM3U8Entry
   gchar *title;
   gchar *url;
   gboolean discontinuous;
+  GList *parts;
+};
+
+struct _GstM3U8Part
+{
+  gfloat duration;
+  gchar *url;
+  guint64 offset;
+  guint64 size;
+  gboolean independent;
 };
 
+static void
+gst_m3u8_part_free (GstM3U8Part * part)
+{
+  g_free (part->url);
+  g_free (part);
+}
+
 static GstM3U8Entry *
 gst_m3u8_entry_new (const gchar * url, const gchar * title,
     gfloat duration, gboolean discontinuous)
@@ -65,6 +87,7 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
 
   g_free (entry->url);
   g_free (entry->title);
+  g_list_free_full (entry->parts, (GDestroyNotify) gst_m3u8_part_free);
   g_free (entry);
 }
 
@@ -79,6 +102,7 @@ gst_m3u8_playlist_new (guint version, guint window_size)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->pending_parts = g_queue_new ();
 
   return playlist;
 }
@@ -90,6 +114,8 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_queue_free_full (playlist->pending_parts,
+      (GDestroyNotify) gst_m3u8_part_free);
   g_free (playlist);
 }
 
@@ -109,6 +135,11 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
 
   entry = gst_m3u8_entry_new (url, title, duration, discontinuous);
 
+  /* The partial segments written so far all belong to this segment */
+  while (!g_queue_is_empty (playlist->pending_parts))
+    entry->parts = g_list_append (entry->parts,
+        g_queue_pop_head (playlist->pending_parts));
+
   if (playlist->window_size > 0) {
     /* Delete old entries from the playlist */
     while (playlist->entries->length >= playlist->window_size) {
@@ -125,6 +156,51 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   return TRUE;
 }
 
+/* Adds a partial segment (byte range of @url) of the segment currently being
+ * written. It gets attached to that segment by the next add_entry() call */
+gboolean
+gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+    const gchar * url, gfloat duration, guint64 offset, guint64 size,
+    gboolean independent)
+{
+  GstM3U8Part *part;
+
+  g_return_val_if_fail (playlist != NULL, FALSE);
+  g_return_val_if_fail (url != NULL, FALSE);
+
+  if (playlist->type == GST_M3U8_PLAYLIST_TYPE_VOD)
+    return FALSE;
+
+  part = g_new0 (GstM3U8Part, 1);
+  part->url = g_strdup (url);
+  part->duration = duration;
+  part->offset = offset;
+  part->size = size;
+  part->independent = independent;
+  g_queue_push_tail (playlist->pending_parts, part);
+
+  return TRUE;
+}
+
+static void
+gst_m3u8_playlist_render_parts (GstM3U8Playlist * playlist,
+    GString * playlist_str, GList * parts)
+{
+  GList *l;
+
+  for (l = parts; l != NULL; l = l->next) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    GstM3U8Part *part = l->data;
+
+    g_string_append_printf (playlist_str,
+        "#EXT-X-PART:DURATION=%s,URI=\"%s\",BYTERANGE=\"%" G_GUINT64_FORMAT
+        "@%" G_GUINT64_FORMAT "\"%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), part->duration / GST_SECOND),
+        part->url, part->size, part->offset,
+        part->independent ? ",INDEPENDENT=YES" : "");
+  }
+}
+
 static guint
 gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
@@ -159,6 +235,18 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 
   g_string_append_printf (playlist_str, "#EXT-X-TARGETDURATION:%u\n",
       gst_m3u8_playlist_target_duration (playlist));
+
+  if (playlist->part_target_duration > 0) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append_printf (playlist_str,
+        "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf),
+            3 * playlist->part_target_duration / GST_SECOND));
+    g_string_append_printf (playlist_str, "#EXT-X-PART-INF:PART-TARGET=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf),
+            playlist->part_target_duration / GST_SECOND));
+  }
   g_string_append (playlist_str, "\n");
 
   /* Entries */
@@ -169,6 +257,10 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
     if (entry->discontinuous)
       g_string_append (playlist_str, "#EXT-X-DISCONTINUITY\n");
 
+    if (playlist->part_target_duration > 0 &&
+        g_list_length (l) <= GST_M3U8_PLAYLIST_MAX_SEGMENTS_WITH_PARTS)
+      gst_m3u8_playlist_render_parts (playlist, playlist_str, entry->parts);
+
     if (playlist->version < 3) {
       g_string_append_printf (playlist_str, "#EXTINF:%d,%s\n",
           (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
@@ -182,6 +274,11 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
     g_string_append_printf (playlist_str, "%s\n", entry->url);
   }
 
+  /* Partial segments of the segment currently being written */
+  if (playlist->part_target_duration > 0)
+    gst_m3u8_playlist_render_parts (playlist, playlist_str,
+        playlist->pending_parts->head);
+
   if (playlist->end_list)
     g_string_append (playlist_str, "#EXT-X-ENDLIST");
 
@@ -35,9 +35,11 @@ struct _GstM3U8Playlist
   gint type;
   gboolean end_list;
   guint sequence_number;
+  gfloat part_target_duration;  /* 0 if partial segments are disabled */
 
   /*< Private >*/
   GQueue *entries;
+  GQueue *pending_parts;        /* parts of the segment being written */
 };
 
 typedef enum
@@ -60,6 +62,13 @@ gboolean          gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
                                                guint             index,
                                                gboolean          discontinuous);
 
+gboolean          gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+                                              const gchar     * url,
+                                              gfloat            duration,
+                                              guint64           offset,
+                                              guint64           size,
+                                              gboolean          independent);
+
 gchar *           gst_m3u8_playlist_render (GstM3U8Playlist * playlist);
 
 G_END_DECLS
@@ -33,9 +33,11 @@
  * For each reference frame, IQA will post a message containing
  * a structure named IQA.
  *
- * The only metric supported for now is "dssim", which will be available
+ * The supported metrics are "dssim", which will be available
  * if https://github.com/pornel/dssim was installed on the system
- * at the time that plugin was compiled.
+ * at the time that plugin was compiled, and "psnr" (Since: 1.24), which is
+ * always available. The PSNR is computed on the color components, in dB,
+ * and is 100 for identical frames.
  *
  * For each metric activated, this structure will contain another
  * structure, named after the metric.
@@ -61,6 +63,8 @@
 #include "config.h"
 #endif
 
+#include <math.h>
+
 #include "iqa.h"
 
 #ifdef HAVE_DSSIM
@@ -89,6 +93,7 @@ enum
   PROP_DO_SSIM,
   PROP_SSIM_ERROR_THRESHOLD,
   PROP_MODE,
+  PROP_DO_PSNR,
   PROP_LAST,
 };
 
@@ -318,6 +323,76 @@ cleanup_return:
 }
 #endif
 
+/* PSNR for identical frames */
+#define MAX_PSNR 100.0
+
+static gboolean
+do_psnr (GstIqa * self, GstVideoFrame * ref, GstVideoFrame * cmp,
+    GstStructure * msg_structure, gchar * padname)
+{
+  GstStructure *psnr_structure;
+  guint64 sse = 0, n_samples = 0;
+  gdouble psnr = MAX_PSNR;
+  gint c, x, y;
+
+  if (GST_VIDEO_FRAME_FORMAT (ref) != GST_VIDEO_FRAME_FORMAT (cmp) ||
+      GST_VIDEO_FRAME_WIDTH (ref) != GST_VIDEO_FRAME_WIDTH (cmp) ||
+      GST_VIDEO_FRAME_HEIGHT (ref) != GST_VIDEO_FRAME_HEIGHT (cmp)) {
+    GST_OBJECT_UNLOCK (self);
+
+    GST_ELEMENT_ERROR (self, STREAM, FAILED,
+        ("Video streams do not have the same format and sizes"),
+        ("Reference %dx%d - compared %dx%d", GST_VIDEO_FRAME_WIDTH (ref),
+            GST_VIDEO_FRAME_HEIGHT (ref), GST_VIDEO_FRAME_WIDTH (cmp),
+            GST_VIDEO_FRAME_HEIGHT (cmp)));
+
+    GST_OBJECT_LOCK (self);
+    return FALSE;
+  }
+
+  for (c = 0; c < GST_VIDEO_FRAME_N_COMPONENTS (ref); c++) {
+    gint width = GST_VIDEO_FRAME_COMP_WIDTH (ref, c);
+    gint height = GST_VIDEO_FRAME_COMP_HEIGHT (ref, c);
+    gint ref_pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (ref, c);
+    gint cmp_pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (cmp, c);
+
+    /* The alpha channel is not part of the picture */
+    if (GST_VIDEO_INFO_HAS_ALPHA (&ref->info) && c == GST_VIDEO_COMP_A)
+      continue;
+
+    for (y = 0; y < height; y++) {
+      const guint8 *ref_line = (const guint8 *)
+          GST_VIDEO_FRAME_COMP_DATA (ref, c) +
+          y * GST_VIDEO_FRAME_COMP_STRIDE (ref, c);
+      const guint8 *cmp_line = (const guint8 *)
+          GST_VIDEO_FRAME_COMP_DATA (cmp, c) +
+          y * GST_VIDEO_FRAME_COMP_STRIDE (cmp, c);
+      guint line_sse = 0;
+
+      /* At most 255^2 * 8192, fits in 32 bits for any sane width */
+      for (x = 0; x < width; x++) {
+        gint d = ref_line[x * ref_pstride] - cmp_line[x * cmp_pstride];
+
+        line_sse += d * d;
+      }
+      sse += line_sse;
+    }
+    n_samples += (guint64) width * height;
+  }
+
+  if (sse > 0 && n_samples > 0)
+    psnr = MIN (10 * log10 (255.0 * 255.0 * n_samples / sse), MAX_PSNR);
+
+  gst_structure_get (msg_structure, "psnr", GST_TYPE_STRUCTURE,
+      &psnr_structure, NULL);
+  gst_structure_set (psnr_structure, padname, G_TYPE_DOUBLE, psnr, NULL);
+  gst_structure_set (msg_structure, "psnr", GST_TYPE_STRUCTURE,
+      psnr_structure, NULL);
+  gst_structure_free (psnr_structure);
+
+  return TRUE;
+}
+
 static gboolean
 compare_frames (GstIqa * self, GstVideoFrame * ref, GstVideoFrame * cmp,
     GstBuffer * outbuf, GstStructure * msg_structure, gchar * padname)
@@ -329,6 +404,11 @@ compare_frames (GstIqa * self, GstVideoFrame * ref, GstVideoFrame * cmp,
   }
 #endif
 
+  if (self->do_psnr) {
+    if (!do_psnr (self, ref, cmp, msg_structure, padname))
+      return FALSE;
+  }
+
   return TRUE;
 }
 
@@ -348,6 +428,14 @@ gst_iqa_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
     self->max_dssim = 0.0;
   }
 
+  if (self->do_psnr) {
+    GstStructure *psnr_structure = gst_structure_new_empty ("psnr");
+
+    gst_structure_set (msg_structure, "psnr", GST_TYPE_STRUCTURE,
+        psnr_structure, NULL);
+    gst_structure_free (psnr_structure);
+  }
+
   GST_OBJECT_LOCK (vagg);
   for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
     GstVideoAggregatorPad *pad = l->data;
@@ -420,6 +508,11 @@ _set_property (GObject * object, guint prop_id, const GValue * value,
       self->mode = g_value_get_flags (value);
       GST_OBJECT_UNLOCK (self);
       break;
+    case PROP_DO_PSNR:
+      GST_OBJECT_LOCK (self);
+      self->do_psnr = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -448,6 +541,11 @@ _get_property (GObject * object,
       g_value_set_flags (value, self->mode);
       GST_OBJECT_UNLOCK (self);
       break;
+    case PROP_DO_PSNR:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->do_psnr);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -497,6 +595,17 @@ gst_iqa_class_init (GstIqaClass * klass)
           "Controls the frame comparison mode.", GST_TYPE_IQA_MODE,
           0, G_PARAM_READWRITE));
 
+  /**
+   * iqa:do-psnr:
+   *
+   * Compute the peak signal-to-noise ratio of the compared frames.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_DO_PSNR,
+      g_param_spec_boolean ("do-psnr", "do-psnr",
+          "Compute the peak signal-to-noise ratio", FALSE, G_PARAM_READWRITE));
+
   gst_type_mark_as_plugin_api (GST_TYPE_IQA_MODE, 0);
 
   gst_element_class_set_static_metadata (gstelement_class, "Iqa",
@@ -52,6 +52,7 @@ struct _GstIqa
   gdouble ssim_threshold;
   gdouble max_dssim;
   gint mode;
+  gboolean do_psnr;
 };
 
 struct _GstIqaClass
@@ -63,6 +63,7 @@ enum
   PROP_GST_SCTP_ASSOCIATION_ID,
   PROP_REMOTE_SCTP_PORT,
   PROP_USE_SOCK_STREAM,
+  PROP_BULK_MODE,
 
   NUM_PROPERTIES
 };
@@ -74,9 +75,20 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_GST_SCTP_ORDERED TRUE
 #define DEFAULT_SCTP_PPID 1
 #define DEFAULT_USE_SOCK_STREAM FALSE
+#define DEFAULT_BULK_MODE FALSE
 
+/* Fallback for when the association does not report free send buffer
+ * space in time */
 #define BUFFER_FULL_SLEEP_TIME 100000
 
+/* Messages are handed to the association in parts of at most this size, so
+ * sending can continue as soon as that much send buffer space is free */
+#define MAX_SEND_CHUNK_SIZE (64 * 1024)
+
+/* Packets are limited by the path MTU of 1200 configured on the association */
+#define PACKET_POOL_BUFFER_SIZE 1500
+#define PACKET_POOL_MIN_BUFFERS 16
+
 GType gst_sctp_enc_pad_get_type (void);
 
 #define GST_TYPE_SCTP_ENC_PAD (gst_sctp_enc_pad_get_type())
@@ -104,6 +116,14 @@ struct _GstSctpEncPad
   GCond cond;
   gboolean flushing;
   gboolean clear_to_send;
+
+  /* a message was partly handed to the association and still misses its
+   * end of record, e.g. because of a flush. Sent with these parameters */
+  gboolean record_open;
+  guint32 record_ppid;
+  gboolean record_ordered;
+  GstSctpAssociationPartialReliability record_pr;
+  guint32 record_pr_param;
 };
 
 G_DEFINE_TYPE (GstSctpEncPad, gst_sctp_enc_pad, GST_TYPE_PAD);
@@ -134,6 +154,7 @@ gst_sctp_enc_pad_init (GstSctpEncPad * self)
   g_cond_init (&self->cond);
   self->flushing = FALSE;
   self->clear_to_send = FALSE;
+  self->record_open = FALSE;
 }
 
 static void gst_sctp_enc_finalize (GObject * object);
@@ -159,6 +180,8 @@ static void on_sctp_association_state_changed (GstSctpAssociation *
 static gboolean configure_association (GstSctpEnc * self);
 static void on_sctp_packet_out (GstSctpAssociation * sctp_association,
     const guint8 * buf, gsize length, gpointer user_data);
+static void on_sctp_send_ready (GstSctpAssociation * sctp_association,
+    guint32 send_buffer_free, gpointer user_data);
 static void stop_srcpad_task (GstPad * pad, GstSctpEnc * self);
 static void sctpenc_cleanup (GstSctpEnc * self);
 static void get_config_from_caps (const GstCaps * caps, gboolean * ordered,
@@ -215,6 +238,22 @@ gst_sctp_enc_class_init (GstSctpEncClass * klass)
       "When TRUE the partial reliability parameters of the channel are ignored.",
       DEFAULT_USE_SOCK_STREAM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSctpEnc:bulk-mode:
+   *
+   * Favour throughput over latency. The association uses larger socket
+   * buffers and bundles small messages into full packets instead of sending
+   * each one immediately.
+   *
+   * Since: 1.24
+   */
+  properties[PROP_BULK_MODE] =
+      g_param_spec_boolean ("bulk-mode",
+      "Bulk mode",
+      "Favour throughput over latency. Must be set before the element "
+      "goes to PAUSED",
+      DEFAULT_BULK_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   signals[SIGNAL_SCTP_ASSOCIATION_ESTABLISHED] =
@@ -261,6 +300,7 @@ gst_sctp_enc_init (GstSctpEnc * self)
 {
   self->sctp_association_id = DEFAULT_GST_SCTP_ASSOCIATION_ID;
   self->remote_sctp_port = DEFAULT_REMOTE_SCTP_PORT;
+  self->bulk_mode = DEFAULT_BULK_MODE;
 
   self->sctp_association = NULL;
   self->outbound_sctp_packet_queue =
@@ -283,6 +323,8 @@ gst_sctp_enc_finalize (GObject * object)
 
   g_queue_clear (&self->pending_pads);
   gst_object_unref (self->outbound_sctp_packet_queue);
+  if (self->packet_pool)
+    gst_object_unref (self->packet_pool);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -303,6 +345,9 @@ gst_sctp_enc_set_property (GObject * object, guint prop_id,
     case PROP_USE_SOCK_STREAM:
       self->use_sock_stream = g_value_get_boolean (value);
       break;
+    case PROP_BULK_MODE:
+      self->bulk_mode = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -325,6 +370,9 @@ gst_sctp_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_USE_SOCK_STREAM:
       g_value_set_boolean (value, self->use_sock_stream);
       break;
+    case PROP_BULK_MODE:
+      g_value_set_boolean (value, self->bulk_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -589,6 +637,95 @@ gst_sctp_enc_srcpad_loop (GstPad * pad)
   }
 }
 
+/* Hands @length bytes of a message to the association, waiting for send
+ * buffer space as needed. Called with the pad lock held */
+static GstFlowReturn
+sctp_enc_send_chunk (GstSctpEnc * self, GstSctpEncPad * sctpenc_pad,
+    const guint8 * data, guint32 length, guint32 ppid, gboolean ordered,
+    GstSctpAssociationPartialReliability pr, guint32 pr_param,
+    gboolean end_of_record)
+{
+  GstFlowReturn flow_ret;
+
+  while (!sctpenc_pad->flushing) {
+    guint32 bytes_sent;
+
+    g_mutex_unlock (&sctpenc_pad->lock);
+
+    flow_ret =
+        gst_sctp_association_send_data (self->sctp_association, data,
+        length, sctpenc_pad->stream_id, ppid, ordered, pr, pr_param,
+        end_of_record, &bytes_sent);
+
+    g_mutex_lock (&sctpenc_pad->lock);
+    if (flow_ret == GST_FLOW_OK) {
+      if (end_of_record && bytes_sent == length) {
+        sctpenc_pad->record_open = FALSE;
+      } else if (bytes_sent > 0) {
+        sctpenc_pad->record_open = TRUE;
+        sctpenc_pad->record_ppid = ppid;
+        sctpenc_pad->record_ordered = ordered;
+        sctpenc_pad->record_pr = pr;
+        sctpenc_pad->record_pr_param = pr_param;
+      }
+    }
+
+    if (flow_ret != GST_FLOW_OK) {
+      if (flow_ret != GST_FLOW_EOS) {
+        GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+            ("Failed to send data"));
+      }
+      return flow_ret;
+    } else if (bytes_sent < length && !sctpenc_pad->flushing) {
+      gint64 end_time = g_get_monotonic_time () + BUFFER_FULL_SLEEP_TIME;
+
+      GST_TRACE_OBJECT (sctpenc_pad,
+          "Sent only %u of %u remaining bytes, waiting", bytes_sent, length);
+
+      sctpenc_pad->bytes_sent += bytes_sent;
+      data += bytes_sent;
+      length -= bytes_sent;
+
+      /* The send buffer is full, wait until the association reports free
+       * space again */
+      g_cond_wait_until (&sctpenc_pad->cond, &sctpenc_pad->lock, end_time);
+
+    } else if (bytes_sent == length) {
+      sctpenc_pad->bytes_sent += bytes_sent;
+      return GST_FLOW_OK;
+    }
+  }
+
+  return GST_FLOW_FLUSHING;
+}
+
+/* Ends a message that was interrupted after part of it was handed to the
+ * association. Without it the next message of the stream would be appended
+ * to the partial one, so the peer receives the truncated message instead.
+ * Called with the pad lock held */
+static void
+sctp_enc_end_open_record (GstSctpEnc * self, GstSctpEncPad * sctpenc_pad)
+{
+  GstFlowReturn flow_ret;
+  guint32 bytes_sent;
+
+  if (!sctpenc_pad->record_open)
+    return;
+
+  GST_DEBUG_OBJECT (sctpenc_pad, "Terminating partially sent message");
+
+  g_mutex_unlock (&sctpenc_pad->lock);
+  flow_ret = gst_sctp_association_send_data (self->sctp_association, NULL, 0,
+      sctpenc_pad->stream_id, sctpenc_pad->record_ppid,
+      sctpenc_pad->record_ordered, sctpenc_pad->record_pr,
+      sctpenc_pad->record_pr_param, TRUE, &bytes_sent);
+  g_mutex_lock (&sctpenc_pad->lock);
+
+  /* retried before the next message otherwise */
+  if (flow_ret == GST_FLOW_OK)
+    sctpenc_pad->record_open = FALSE;
+}
+
 static GstFlowReturn
 gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -604,8 +741,8 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   GstMeta *meta;
   const GstMetaInfo *meta_info = GST_SCTP_SEND_META_INFO;
   GstFlowReturn flow_ret = GST_FLOW_ERROR;
-  const guint8 *data;
-  guint32 length;
+  gsize remaining;
+  guint i, n_mem;
   gboolean clear_to_send;
 
   GST_OBJECT_LOCK (self);
@@ -654,14 +791,6 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       " with ppid %u ordered %d pr %d pr_param %u", buffer, ppid, ordered, pr,
       pr_param);
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
-    GST_ERROR_OBJECT (pad, "Could not map GstBuffer");
-    goto error;
-  }
-
-  data = map.data;
-  length = map.size;
-
   GST_OBJECT_LOCK (self);
   clear_to_send = g_queue_is_empty (&self->pending_pads);
   g_queue_push_tail (&self->pending_pads, sctpenc_pad);
@@ -677,45 +806,48 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     g_cond_wait (&sctpenc_pad->cond, &sctpenc_pad->lock);
   }
 
-  while (!sctpenc_pad->flushing) {
-    guint32 bytes_sent;
-
-    g_mutex_unlock (&sctpenc_pad->lock);
+  sctp_enc_end_open_record (self, sctpenc_pad);
 
-    flow_ret =
-        gst_sctp_association_send_data (self->sctp_association, data,
-        length, sctpenc_pad->stream_id, ppid, ordered, pr, pr_param,
-        &bytes_sent);
+  /* The message is sent from each memory of the buffer in turn instead of
+   * mapping the whole buffer, which would merge multiple memories into a
+   * copy. Only the last part of the message ends the record */
+  remaining = gst_buffer_get_size (buffer);
+  n_mem = gst_buffer_n_memory (buffer);
 
-    g_mutex_lock (&sctpenc_pad->lock);
-    if (flow_ret != GST_FLOW_OK) {
-      if (flow_ret != GST_FLOW_EOS) {
-        GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
-            ("Failed to send data"));
-      }
-      goto out;
-    } else if (bytes_sent < length && !sctpenc_pad->flushing) {
-      gint64 end_time = g_get_monotonic_time () + BUFFER_FULL_SLEEP_TIME;
+  if (remaining == 0) {
+    flow_ret = sctp_enc_send_chunk (self, sctpenc_pad, NULL, 0, ppid, ordered,
+        pr, pr_param, TRUE);
+  } else {
+    flow_ret = GST_FLOW_OK;
+  }
 
-      GST_TRACE_OBJECT (pad, "Sent only %u of %u remaining bytes, waiting",
-          bytes_sent, length);
+  for (i = 0; i < n_mem && remaining > 0 && flow_ret == GST_FLOW_OK; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    gsize offset = 0;
 
-      sctpenc_pad->bytes_sent += bytes_sent;
-      data += bytes_sent;
-      length -= bytes_sent;
+    if (!gst_memory_map (mem, &map, GST_MAP_READ)) {
+      GST_ERROR_OBJECT (pad, "Could not map GstMemory");
+      flow_ret = GST_FLOW_ERROR;
+      break;
+    }
 
-      /* The buffer was probably full. Retry in a while */
-      g_cond_wait_until (&sctpenc_pad->cond, &sctpenc_pad->lock, end_time);
+    while (offset < map.size && flow_ret == GST_FLOW_OK) {
+      guint32 chunk = MIN (map.size - offset, MAX_SEND_CHUNK_SIZE);
 
-    } else if (bytes_sent == length) {
-      GST_DEBUG_OBJECT (pad, "Successfully sent buffer");
-      sctpenc_pad->bytes_sent += bytes_sent;
-      break;
+      remaining -= chunk;
+      flow_ret = sctp_enc_send_chunk (self, sctpenc_pad, map.data + offset,
+          chunk, ppid, ordered, pr, pr_param, remaining == 0);
+      offset += chunk;
     }
+
+    gst_memory_unmap (mem, &map);
   }
-  flow_ret = sctpenc_pad->flushing ? GST_FLOW_FLUSHING : GST_FLOW_OK;
 
-out:
+  if (flow_ret == GST_FLOW_OK)
+    GST_DEBUG_OBJECT (pad, "Successfully sent buffer");
+  else if (flow_ret == GST_FLOW_FLUSHING)
+    sctp_enc_end_open_record (self, sctpenc_pad);
+
   sctpenc_pad->clear_to_send = FALSE;
   g_mutex_unlock (&sctpenc_pad->lock);
 
@@ -731,8 +863,6 @@ out:
     g_mutex_unlock (&sctpenc_pad_next->lock);
   }
 
-  gst_buffer_unmap (buffer, &map);
-error:
   gst_buffer_unref (buffer);
   return flow_ret;
 }
@@ -858,6 +988,21 @@ configure_association (GstSctpEnc * self)
   g_object_bind_property (self, "use-sock-stream", self->sctp_association,
       "use-sock-stream", G_BINDING_SYNC_CREATE);
 
+  g_object_set (self->sctp_association, "bulk-mode", self->bulk_mode, NULL);
+
+  if (!self->packet_pool) {
+    GstStructure *config;
+
+    self->packet_pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (self->packet_pool);
+    gst_buffer_pool_config_set_params (config, NULL, PACKET_POOL_BUFFER_SIZE,
+        PACKET_POOL_MIN_BUFFERS, 0);
+    gst_buffer_pool_set_config (self->packet_pool, config);
+  }
+  gst_buffer_pool_set_active (self->packet_pool, TRUE);
+
+  gst_sctp_association_set_on_send_ready (self->sctp_association,
+      on_sctp_send_ready, gst_object_ref (self), gst_object_unref);
   gst_sctp_association_set_on_packet_out (self->sctp_association,
       on_sctp_packet_out, gst_object_ref (self), gst_object_unref);
 
@@ -908,19 +1053,50 @@ data_queue_item_free (GstDataQueueItem * item)
   g_free (item);
 }
 
+/* Wake up the oldest pad which is the one that needs to finish first */
+static void
+wake_pending_pad (GstSctpEnc * self)
+{
+  GstSctpEncPad *sctpenc_pad;
+
+  GST_OBJECT_LOCK (self);
+  sctpenc_pad = g_queue_peek_head (&self->pending_pads);
+  if (sctpenc_pad) {
+    gst_object_ref (sctpenc_pad);
+
+    GST_OBJECT_UNLOCK (self);
+
+    g_mutex_lock (&sctpenc_pad->lock);
+    g_cond_signal (&sctpenc_pad->cond);
+    g_mutex_unlock (&sctpenc_pad->lock);
+
+    gst_object_unref (sctpenc_pad);
+  } else {
+    GST_OBJECT_UNLOCK (self);
+  }
+}
+
 static void
 on_sctp_packet_out (GstSctpAssociation * _association, const guint8 * buf,
     gsize length, gpointer user_data)
 {
   GstSctpEnc *self = user_data;
-  GstBuffer *gstbuf;
+  GstBuffer *gstbuf = NULL;
   GstDataQueueItem *item;
-  GstSctpEncPad *sctpenc_pad;
 
   GST_DEBUG_OBJECT (self, "Received output packet of size %" G_GSIZE_FORMAT,
       length);
 
-  gstbuf = gst_buffer_new_memdup (buf, length);
+  /* The association reuses its memory once we return, so the packet has to
+   * be copied, but at least into recycled memory */
+  if (length <= PACKET_POOL_BUFFER_SIZE && self->packet_pool &&
+      gst_buffer_pool_acquire_buffer (self->packet_pool, &gstbuf,
+          NULL) == GST_FLOW_OK) {
+    gst_buffer_fill (gstbuf, 0, buf, length);
+    gst_buffer_set_size (gstbuf, length);
+  } else {
+    gstbuf = gst_buffer_new_memdup (buf, length);
+  }
 
   item = g_new0 (GstDataQueueItem, 1);
   item->object = GST_MINI_OBJECT (gstbuf);
@@ -933,22 +1109,19 @@ on_sctp_packet_out (GstSctpAssociation * _association, const guint8 * buf,
     GST_DEBUG_OBJECT (self, "Failed to push item because we're flushing");
   }
 
-  /* Wake up the oldest pad which is the one that needs to finish first */
-  GST_OBJECT_LOCK (self);
-  sctpenc_pad = g_queue_peek_head (&self->pending_pads);
-  if (sctpenc_pad) {
-    gst_object_ref (sctpenc_pad);
+  wake_pending_pad (self);
+}
 
-    GST_OBJECT_UNLOCK (self);
+static void
+on_sctp_send_ready (GstSctpAssociation * _association,
+    guint32 send_buffer_free, gpointer user_data)
+{
+  GstSctpEnc *self = user_data;
 
-    g_mutex_lock (&sctpenc_pad->lock);
-    g_cond_signal (&sctpenc_pad->cond);
-    g_mutex_unlock (&sctpenc_pad->lock);
+  GST_TRACE_OBJECT (self, "%u bytes free in the send buffer",
+      send_buffer_free);
 
-    gst_object_unref (sctpenc_pad);
-  } else {
-    GST_OBJECT_UNLOCK (self);
-  }
+  wake_pending_pad (self);
 }
 
 static void
@@ -975,6 +1148,10 @@ sctpenc_cleanup (GstSctpEnc * self)
 
   gst_sctp_association_set_on_packet_out (self->sctp_association, NULL, NULL,
       NULL);
+  gst_sctp_association_set_on_send_ready (self->sctp_association, NULL, NULL,
+      NULL);
+  if (self->packet_pool)
+    gst_buffer_pool_set_active (self->packet_pool, FALSE);
 
   g_signal_handler_disconnect (self->sctp_association,
       self->signal_handler_state_changed);
@@ -51,9 +51,12 @@ struct _GstSctpEnc
   guint32 sctp_association_id;
   guint16 remote_sctp_port;
   gboolean use_sock_stream;
+  gboolean bulk_mode;
 
   GstSctpAssociation *sctp_association;
   GstDataQueue *outbound_sctp_packet_queue;
+  /* buffers for the packets produced by the association */
+  GstBufferPool *packet_pool;
 
   GQueue pending_pads;
 
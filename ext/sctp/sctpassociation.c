@@ -85,6 +85,7 @@ enum
   PROP_REMOTE_PORT,
   PROP_STATE,
   PROP_USE_SOCK_STREAM,
+  PROP_BULK_MODE,
 
   NUM_PROPERTIES
 };
@@ -96,6 +97,10 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_NUMBER_OF_SCTP_STREAMS 1024
 #define DEFAULT_LOCAL_SCTP_PORT 0
 #define DEFAULT_REMOTE_SCTP_PORT 0
+#define DEFAULT_BULK_MODE FALSE
+
+#define SCTP_BUFFER_SIZE (1024 * 1024)
+#define SCTP_BULK_BUFFER_SIZE (4 * 1024 * 1024)
 
 static GHashTable *associations = NULL;
 G_LOCK_DEFINE_STATIC (associations_lock);
@@ -118,6 +123,7 @@ static int sctp_packet_out (void *addr, void *buffer, size_t length, guint8 tos,
 static int receive_cb (struct socket *sock, union sctp_sockstore addr,
     void *data, size_t datalen, struct sctp_rcvinfo rcv_info, gint flags,
     void *ulp_info);
+static int send_cb (struct socket *sock, uint32_t sb_free);
 static void handle_notification (GstSctpAssociation * self,
     const union sctp_notification *notification, size_t length);
 static void handle_association_changed (GstSctpAssociation * self,
@@ -171,6 +177,12 @@ gst_sctp_association_class_init (GstSctpAssociationClass * klass)
       "When TRUE the partial reliability parameters of the channel is ignored.",
       FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_BULK_MODE] =
+      g_param_spec_boolean ("bulk-mode", "Bulk mode",
+      "Favour throughput over latency: use larger socket buffers and let "
+      "small messages be bundled into full packets",
+      DEFAULT_BULK_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 }
 
@@ -235,6 +247,7 @@ gst_sctp_association_init (GstSctpAssociation * self)
   self->state = GST_SCTP_ASSOCIATION_STATE_NEW;
 
   self->use_sock_stream = TRUE;
+  self->bulk_mode = DEFAULT_BULK_MODE;
 
   usrsctp_register_address ((void *) self);
 }
@@ -269,6 +282,7 @@ gst_sctp_association_set_property (GObject * object, guint prop_id,
     switch (prop_id) {
       case PROP_LOCAL_PORT:
       case PROP_REMOTE_PORT:
+      case PROP_BULK_MODE:
         GST_ERROR_OBJECT (self, "These properties cannot be set in this state");
         goto error;
     }
@@ -290,6 +304,9 @@ gst_sctp_association_set_property (GObject * object, guint prop_id,
     case PROP_USE_SOCK_STREAM:
       self->use_sock_stream = g_value_get_boolean (value);
       break;
+    case PROP_BULK_MODE:
+      self->bulk_mode = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -347,6 +364,9 @@ gst_sctp_association_get_property (GObject * object, guint prop_id,
     case PROP_USE_SOCK_STREAM:
       g_value_set_boolean (value, self->use_sock_stream);
       break;
+    case PROP_BULK_MODE:
+      g_value_set_boolean (value, self->bulk_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -453,6 +473,24 @@ gst_sctp_association_set_on_packet_received (GstSctpAssociation * self,
   maybe_set_state_to_ready (self);
 }
 
+/* @send_ready_cb is called from the usrsctp thread whenever acknowledged data
+ * freed up space in the send buffer of a full association */
+void
+gst_sctp_association_set_on_send_ready (GstSctpAssociation * self,
+    GstSctpAssociationSendReadyCb send_ready_cb, gpointer user_data,
+    GDestroyNotify destroy_notify)
+{
+  g_return_if_fail (GST_SCTP_IS_ASSOCIATION (self));
+
+  g_mutex_lock (&self->association_mutex);
+  if (self->send_ready_destroy_notify)
+    self->send_ready_destroy_notify (self->send_ready_user_data);
+  self->send_ready_cb = send_ready_cb;
+  self->send_ready_user_data = user_data;
+  self->send_ready_destroy_notify = destroy_notify;
+  g_mutex_unlock (&self->association_mutex);
+}
+
 void
 gst_sctp_association_incoming_packet (GstSctpAssociation * self,
     const guint8 * buf, guint32 length)
@@ -464,7 +502,7 @@ GstFlowReturn
 gst_sctp_association_send_data (GstSctpAssociation * self, const guint8 * buf,
     guint32 length, guint16 stream_id, guint32 ppid, gboolean ordered,
     GstSctpAssociationPartialReliability pr, guint32 reliability_param,
-    guint32 * bytes_sent_)
+    gboolean end_of_record, guint32 * bytes_sent_)
 {
   GstFlowReturn flow_ret;
   struct sctp_sendv_spa spa;
@@ -489,15 +527,15 @@ gst_sctp_association_send_data (GstSctpAssociation * self, const guint8 * buf,
   remote_addr = get_sctp_socket_address (self, self->remote_port);
   g_mutex_unlock (&self->association_mutex);
 
-  /* TODO: We probably want to split too large chunks into multiple packets
-   * and only set the SCTP_EOR flag on the last one. Firefox is using 0x4000
-   * as the maximum packet size
-   */
+  /* The socket uses explicit EOR, so a message can be handed over in several
+   * parts directly from the caller's memory. Only the last part completes
+   * the message */
   memset (&spa, 0, sizeof (spa));
 
   spa.sendv_sndinfo.snd_ppid = g_htonl (ppid);
   spa.sendv_sndinfo.snd_sid = stream_id;
-  spa.sendv_sndinfo.snd_flags = SCTP_EOR | (ordered ? 0 : SCTP_UNORDERED);
+  spa.sendv_sndinfo.snd_flags = (end_of_record ? SCTP_EOR : 0) |
+      (ordered ? 0 : SCTP_UNORDERED);
   spa.sendv_sndinfo.snd_context = 0;
   spa.sendv_sndinfo.snd_assoc_id = 0;
   spa.sendv_flags = SCTP_SEND_SNDINFO_VALID;
@@ -577,8 +615,9 @@ create_sctp_socket (GstSctpAssociation * self)
   struct linger l;
   struct sctp_event event;
   struct sctp_assoc_value stream_reset;
-  int buf_size = 1024 * 1024;
+  int buf_size = self->bulk_mode ? SCTP_BULK_BUFFER_SIZE : SCTP_BUFFER_SIZE;
   int value = 1;
+  int nodelay = self->bulk_mode ? 0 : 1;
   guint16 event_types[] = {
     SCTP_ASSOC_CHANGE,
     SCTP_PEER_ADDR_CHANGE,
@@ -599,8 +638,8 @@ create_sctp_socket (GstSctpAssociation * self)
   guint sock_type = self->use_sock_stream ? SOCK_STREAM : SOCK_SEQPACKET;
 
   if ((sock =
-          usrsctp_socket (AF_CONN, sock_type, IPPROTO_SCTP, receive_cb, NULL, 0,
-              (void *) self)) == NULL) {
+          usrsctp_socket (AF_CONN, sock_type, IPPROTO_SCTP, receive_cb,
+              send_cb, buf_size / 2, (void *) self)) == NULL) {
     GST_ERROR_OBJECT (self, "Could not open SCTP socket: (%u) %s", errno,
         g_strerror (errno));
     goto error;
@@ -643,7 +682,9 @@ create_sctp_socket (GstSctpAssociation * self)
         g_strerror (errno));
   }
 
-  if (usrsctp_setsockopt (sock, IPPROTO_SCTP, SCTP_NODELAY, &value,
+  /* In bulk mode small messages are allowed to wait for more data so they get
+   * bundled into full packets */
+  if (usrsctp_setsockopt (sock, IPPROTO_SCTP, SCTP_NODELAY, &nodelay,
           sizeof (int))) {
     GST_DEBUG_OBJECT (self, "Could not set SCTP_NODELAY: (%u) %s", errno,
         g_strerror (errno));
@@ -785,6 +826,22 @@ sctp_packet_out (void *addr, void *buffer, size_t length, guint8 tos,
   return 0;
 }
 
+static int
+send_cb (struct socket *sock, uint32_t sb_free)
+{
+  GstSctpAssociation *self = NULL;
+
+  if (usrsctp_get_ulpinfo (sock, (void **) &self) == 0 || self == NULL)
+    return 0;
+
+  g_mutex_lock (&self->association_mutex);
+  if (self->send_ready_cb)
+    self->send_ready_cb (self, sb_free, self->send_ready_user_data);
+  g_mutex_unlock (&self->association_mutex);
+
+  return 1;
+}
+
 static int
 receive_cb (struct socket *sock, union sctp_sockstore addr, void *data,
     size_t datalen, struct sctp_rcvinfo rcv_info, gint flags, void *ulp_info)
@@ -68,6 +68,8 @@ typedef void (*GstSctpAssociationPacketReceivedCb) (GstSctpAssociation *
     guint ppid, gpointer user_data);
 typedef void (*GstSctpAssociationPacketOutCb) (GstSctpAssociation *
     sctp_association, const guint8 * data, gsize length, gpointer user_data);
+typedef void (*GstSctpAssociationSendReadyCb) (GstSctpAssociation *
+    sctp_association, guint32 send_buffer_free, gpointer user_data);
 
 struct _GstSctpAssociation
 {
@@ -77,6 +79,7 @@ struct _GstSctpAssociation
   guint16 local_port;
   guint16 remote_port;
   gboolean use_sock_stream;
+  gboolean bulk_mode;
   struct socket *sctp_ass_sock;
 
   GMutex association_mutex;
@@ -90,6 +93,10 @@ struct _GstSctpAssociation
   GstSctpAssociationPacketOutCb packet_out_cb;
   gpointer packet_out_user_data;
   GDestroyNotify packet_out_destroy_notify;
+
+  GstSctpAssociationSendReadyCb send_ready_cb;
+  gpointer send_ready_user_data;
+  GDestroyNotify send_ready_destroy_notify;
 };
 
 struct _GstSctpAssociationClass
@@ -109,12 +116,14 @@ void gst_sctp_association_set_on_packet_out (GstSctpAssociation * self,
     GstSctpAssociationPacketOutCb packet_out_cb, gpointer user_data, GDestroyNotify destroy_notify);
 void gst_sctp_association_set_on_packet_received (GstSctpAssociation * self,
     GstSctpAssociationPacketReceivedCb packet_received_cb, gpointer user_data, GDestroyNotify destroy_notify);
+void gst_sctp_association_set_on_send_ready (GstSctpAssociation * self,
+    GstSctpAssociationSendReadyCb send_ready_cb, gpointer user_data, GDestroyNotify destroy_notify);
 void gst_sctp_association_incoming_packet (GstSctpAssociation * self,
     const guint8 * buf, guint32 length);
 GstFlowReturn gst_sctp_association_send_data (GstSctpAssociation * self,
     const guint8 * buf, guint32 length, guint16 stream_id, guint32 ppid,
     gboolean ordered, GstSctpAssociationPartialReliability pr,
-    guint32 reliability_param, guint32 *bytes_sent);
+    guint32 reliability_param, gboolean end_of_record, guint32 *bytes_sent);
 void gst_sctp_association_reset_stream (GstSctpAssociation * self,
     guint16 stream_id);
 void gst_sctp_association_force_close (GstSctpAssociation * self);
@@ -149,6 +149,84 @@ enum_value_from_nick (GType enum_gtype, const gchar * nick)
   return value;
 }
 
+/* The jobs of one gst_srtp_shard_pool_run() call */
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint pending;
+  GFunc func;
+  gpointer user_data;
+} ShardBatch;
+
+typedef struct
+{
+  ShardBatch *batch;
+  gpointer job;
+} ShardTask;
+
+static void
+shard_task_run (gpointer data, gpointer unused)
+{
+  ShardTask *task = data;
+  ShardBatch *batch = task->batch;
+
+  batch->func (task->job, batch->user_data);
+
+  g_mutex_lock (&batch->lock);
+  if (--batch->pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+/* Pool of threads protecting or unprotecting the packets of different SSRC
+ * shards in parallel. The streaming thread runs one shard itself, so the
+ * pool has one thread less than @n_threads */
+GThreadPool *
+gst_srtp_shard_pool_new (guint n_threads)
+{
+  g_return_val_if_fail (n_threads > 1, NULL);
+
+  return g_thread_pool_new (shard_task_run, NULL, n_threads - 1, FALSE, NULL);
+}
+
+/* Calls @func for each of the @n_jobs @jobs, in parallel on @pool and the
+ * calling thread, and returns once all calls returned */
+void
+gst_srtp_shard_pool_run (GThreadPool * pool, GFunc func, gpointer * jobs,
+    guint n_jobs, gpointer user_data)
+{
+  ShardBatch batch;
+  ShardTask *tasks;
+  guint i;
+
+  if (n_jobs == 0)
+    return;
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.pending = n_jobs - 1;
+  batch.func = func;
+  batch.user_data = user_data;
+
+  tasks = g_newa (ShardTask, n_jobs);
+  for (i = 1; i < n_jobs; i++) {
+    tasks[i].batch = &batch;
+    tasks[i].job = jobs[i];
+    g_thread_pool_push (pool, &tasks[i], NULL);
+  }
+
+  func (jobs[0], user_data);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_cond_clear (&batch.cond);
+  g_mutex_clear (&batch.lock);
+}
+
 gboolean
 gst_srtp_get_soft_limit_reached (void)
 {
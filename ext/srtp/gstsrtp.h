@@ -93,6 +93,11 @@ srtp_err_status_t srtp_get_stream_roc (srtp_t session, guint32 ssrc,
 void     gst_srtp_init_event_reporter    (void);
 gboolean gst_srtp_get_soft_limit_reached (void);
 
+GThreadPool *gst_srtp_shard_pool_new (guint n_threads);
+void         gst_srtp_shard_pool_run (GThreadPool * pool, GFunc func,
+                                      gpointer * jobs, guint n_jobs,
+                                      gpointer user_data);
+
 gboolean rtcp_buffer_get_ssrc (GstBuffer * buf, guint32 * ssrc);
 
 const gchar *enum_nick_from_value (GType enum_gtype, gint value);
@@ -103,6 +103,11 @@
  * the same caps as "srtp-key2=(buffer)key2data, mki2=(buffer)mki2data", and more can
  * be added up to 15.
  *
+ * Buffer lists carrying many SSRCs, e.g. a bundled session with simulcast,
+ * can be unprotected by several threads with the "n-threads" property. The
+ * SSRCs are then distributed over as many libsrtp sessions, and the packets
+ * of one SSRC are always unprotected in order by the same thread.
+ *
  * ## Example pipelines
  * |[
  * gst-launch-1.0 udpsrc port=5004 caps='application/x-srtp, payload=(int)8, ssrc=(uint)1356955624, srtp-key=(buffer)012345678901234567890123456789012345678901234567890123456789, srtp-cipher=(string)aes-128-icm, srtp-auth=(string)hmac-sha1-80, srtcp-cipher=(string)aes-128-icm, srtcp-auth=(string)hmac-sha1-80' !  srtpdec ! rtppcmadepay ! alawdec ! pulsesink
@@ -124,6 +129,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_srtp_dec_debug);
 #define GST_CAT_DEFAULT gst_srtp_dec_debug
 
 #define DEFAULT_REPLAY_WINDOW_SIZE 128
+#define DEFAULT_N_THREADS 1
 
 /* Filter signals and args */
 enum
@@ -140,7 +146,8 @@ enum
 {
   PROP_0,
   PROP_REPLAY_WINDOW_SIZE,
-  PROP_STATS
+  PROP_STATS,
+  PROP_N_THREADS
 };
 
 /* the capabilities of the inputs and outputs.
@@ -211,6 +218,10 @@ static GstFlowReturn gst_srtp_dec_chain_rtp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
 static GstFlowReturn gst_srtp_dec_chain_rtcp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
+static GstFlowReturn gst_srtp_dec_chain_list_rtp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
+static GstFlowReturn gst_srtp_dec_chain_list_rtcp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
 
 static GstStateChangeReturn gst_srtp_dec_change_state (GstElement * element,
     GstStateChange transition);
@@ -231,8 +242,31 @@ struct _GstSrtpDecSsrcStream
   GArray *keys;
   guint recv_count;
   guint recv_drop_count;
+
+  guint64 unprotect_count;
+  GstClockTime unprotect_time;
+  GstClockTime max_unprotect_time;
 };
 
+/* A buffer of a list to unprotect */
+typedef struct
+{
+  GstBuffer *buf;
+  guint32 ssrc;
+  gboolean is_rtcp;
+  /* FALSE if the buffer is dropped or passed through without unprotecting */
+  gboolean decode;
+  srtp_err_status_t err;
+  gboolean soft_limit;
+} UnprotectItem;
+
+/* The buffers of one SSRC shard in a list */
+typedef struct
+{
+  GstSrtpDec *filter;
+  GArray *items;
+} UnprotectJob;
+
 #ifdef HAVE_SRTP2
 struct GstSrtpDecKey
 {
@@ -292,6 +326,25 @@ gst_srtp_dec_class_init (GstSrtpDecClass * klass)
       g_param_spec_boxed ("stats", "Statistics", "Various statistics",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSrtpDec:n-threads:
+   *
+   * Number of threads unprotecting the packets of a buffer list in
+   * parallel, 0 to use one per processor. The packets of one SSRC are
+   * always unprotected by the same thread and in order. Takes effect on the
+   * next start of the element.
+   *
+   * The #GstSrtpDec:stats contain how long unprotecting the packets of each
+   * SSRC took.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads unprotecting buffer lists "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Install signals */
   /**
    * GstSrtpDec::request-key:
@@ -385,6 +438,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtp));
   gst_pad_set_chain_function (filter->rtp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtp));
+  gst_pad_set_chain_list_function (filter->rtp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtp));
 
   filter->rtp_srcpad =
       gst_pad_new_from_static_template (&rtp_src_template, "rtp_src");
@@ -408,6 +463,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtcp));
   gst_pad_set_chain_function (filter->rtcp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtcp));
+  gst_pad_set_chain_list_function (filter->rtcp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtcp));
 
   filter->rtcp_srcpad =
       gst_pad_new_from_static_template (&rtcp_src_template, "rtcp_src");
@@ -420,7 +477,13 @@ gst_srtp_dec_init (GstSrtpDec * filter)
   gst_element_add_pad (GST_ELEMENT (filter), filter->rtcp_sinkpad);
   gst_element_add_pad (GST_ELEMENT (filter), filter->rtcp_srcpad);
 
-  filter->first_session = TRUE;
+  filter->n_threads = DEFAULT_N_THREADS;
+}
+
+static srtp_t *
+gst_srtp_dec_get_session (GstSrtpDec * filter, guint32 ssrc)
+{
+  return &filter->sessions[ssrc % filter->n_sessions];
 }
 
 static GstStructure *
@@ -435,7 +498,7 @@ gst_srtp_dec_create_stats (GstSrtpDec * filter)
   g_value_init (&va, GST_TYPE_ARRAY);
   g_value_init (&v, GST_TYPE_STRUCTURE);
 
-  if (filter->session) {
+  if (filter->sessions) {
     GHashTableIter iter;
     gpointer key, value;
 
@@ -447,7 +510,8 @@ gst_srtp_dec_create_stats (GstSrtpDec * filter)
       srtp_err_status_t status;
       guint32 roc;
 
-      status = srtp_get_stream_roc (filter->session, ssrc, &roc);
+      status = srtp_get_stream_roc (*gst_srtp_dec_get_session (filter, ssrc),
+          ssrc, &roc);
       if (status != srtp_err_status_ok) {
         continue;
       }
@@ -455,7 +519,10 @@ gst_srtp_dec_create_stats (GstSrtpDec * filter)
       ss = gst_structure_new ("application/x-srtp-stream",
           "ssrc", G_TYPE_UINT, ssrc, "roc", G_TYPE_UINT, roc, "recv-count",
           G_TYPE_UINT, stream->recv_count, "recv-drop-count", G_TYPE_UINT,
-          stream->recv_drop_count, NULL);
+          stream->recv_drop_count, "unprotect-count", G_TYPE_UINT64,
+          stream->unprotect_count, "unprotect-time", G_TYPE_UINT64,
+          stream->unprotect_time, "max-unprotect-time", G_TYPE_UINT64,
+          stream->max_unprotect_time, NULL);
 
       g_value_take_boxed (&v, ss);
       gst_value_array_append_value (&va, &v);
@@ -485,6 +552,9 @@ gst_srtp_dec_set_property (GObject * object, guint prop_id,
     case PROP_REPLAY_WINDOW_SIZE:
       filter->replay_window_size = g_value_get_uint (value);
       break;
+    case PROP_N_THREADS:
+      filter->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -508,6 +578,9 @@ gst_srtp_dec_get_property (GObject * object, guint prop_id,
     case PROP_STATS:
       g_value_take_boxed (value, gst_srtp_dec_create_stats (filter));
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -527,7 +600,7 @@ gst_srtp_dec_remove_stream (GstSrtpDec * filter, guint ssrc)
   stream = g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
 
   if (stream) {
-    srtp_remove_stream (filter->session, ssrc);
+    srtp_remove_stream (*gst_srtp_dec_get_session (filter, ssrc), ssrc);
     g_hash_table_remove (filter->streams, GUINT_TO_POINTER (ssrc));
   }
 }
@@ -698,6 +771,7 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
 {
   srtp_err_status_t ret;
   srtp_policy_t policy;
+  srtp_t *session;
   GstMapInfo map;
   guchar tmp[1];
 #ifdef HAVE_SRTP2
@@ -707,9 +781,11 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
 
   memset (&policy, 0, sizeof (srtp_policy_t));
 
-  if (!stream)
+  if (!stream || !filter->sessions)
     return srtp_err_status_bad_param;
 
+  session = gst_srtp_dec_get_session (filter, ssrc);
+
   GST_INFO_OBJECT (filter, "Setting RTP policy...");
   set_crypto_policy_cipher_auth (stream->rtp_cipher, stream->rtp_auth,
       &policy.rtp);
@@ -754,13 +830,13 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
   policy.window_size = filter->replay_window_size;
   policy.next = NULL;
 
-  /* If it is the first stream, create the session
+  /* If it is the first stream of the shard, create the session
    * If not, add the stream policy to the session
    */
-  if (filter->first_session)
-    ret = srtp_create (&filter->session, &policy);
+  if (*session == NULL)
+    ret = srtp_create (session, &policy);
   else
-    ret = srtp_add_stream (filter->session, &policy);
+    ret = srtp_add_stream (*session, &policy);
 
   if (stream->key)
     gst_buffer_unmap (stream->key, &map);
@@ -782,7 +858,7 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
   if (ret == srtp_err_status_ok) {
     srtp_err_status_t status;
 
-    status = srtp_set_stream_roc (filter->session, ssrc, stream->roc);
+    status = srtp_set_stream_roc (*session, ssrc, stream->roc);
 #ifdef HAVE_SRTP2
     (void) status;              /* Ignore unused variable */
 #else
@@ -794,7 +870,6 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
     }
 #endif
 
-    filter->first_session = FALSE;
     g_hash_table_insert (filter->streams, GUINT_TO_POINTER (stream->ssrc),
         stream);
   }
@@ -968,20 +1043,20 @@ remove_yes (gpointer key, gpointer value, gpointer user_data)
 static void
 gst_srtp_dec_clear_streams (GstSrtpDec * filter)
 {
-  guint nb = 0;
+  guint nb = 0, i;
 
   GST_OBJECT_LOCK (filter);
 
-  if (!filter->first_session) {
-    srtp_dealloc (filter->session);
-    filter->session = NULL;
+  for (i = 0; i < filter->n_sessions; i++) {
+    if (filter->sessions[i]) {
+      srtp_dealloc (filter->sessions[i]);
+      filter->sessions[i] = NULL;
+    }
   }
 
   if (filter->streams)
     nb = g_hash_table_foreach_remove (filter->streams, remove_yes, NULL);
 
-  filter->first_session = TRUE;
-
   GST_OBJECT_UNLOCK (filter);
 
   GST_DEBUG_OBJECT (filter, "Cleared %d streams", nb);
@@ -1385,29 +1460,26 @@ err:
   return FALSE;
 }
 
-/*
- * This function should be called while holding the filter lock
- */
-static gboolean
-gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
+/* Unprotects the writable @buf in place with the session of @ssrc.
+ *
+ * Only uses the libsrtp stream and the timings of @ssrc, so buffers of
+ * different shards can be unprotected in parallel while the streaming thread
+ * holds the filter lock */
+static srtp_err_status_t
+gst_srtp_dec_unprotect_buffer (GstSrtpDec * filter, GstBuffer * buf,
     gboolean is_rtcp, guint32 ssrc)
 {
+  srtp_t session = *gst_srtp_dec_get_session (filter, ssrc);
+  GstSrtpDecSsrcStream *stream;
+  GstClockTime start, elapsed;
   GstMapInfo map;
   srtp_err_status_t err;
   gint size;
-  GstSrtpDecSsrcStream *stream;
-
-  GST_LOG_OBJECT (pad, "Received %s buffer of size %" G_GSIZE_FORMAT
-      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (buf),
-      ssrc);
-  filter->recv_count++;
-  /* Change buffer to remove protection */
-  buf = gst_buffer_make_writable (buf);
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
   size = map.size;
 
-unprotect:
+  start = gst_util_get_timestamp ();
 
   gst_srtp_init_event_reporter ();
 
@@ -1415,10 +1487,10 @@ unprotect:
 #ifdef HAVE_SRTP2
     stream = find_stream_by_ssrc (filter, ssrc);
 
-    err = srtp_unprotect_rtcp_mki (filter->session, map.data, &size,
+    err = srtp_unprotect_rtcp_mki (session, map.data, &size,
         stream && stream->keys);
 #else
-    err = srtp_unprotect_rtcp (filter->session, map.data, &size);
+    err = srtp_unprotect_rtcp (session, map.data, &size);
 #endif
   } else {
 #ifndef HAVE_SRTP2
@@ -1428,7 +1500,7 @@ unprotect:
             GUINT_TO_POINTER (ssrc))) {
       srtp_stream_t stream;
 
-      stream = srtp_get_stream (filter->session, htonl (ssrc));
+      stream = srtp_get_stream (session, htonl (ssrc));
 
       if (stream) {
         guint16 seqnum = 0;
@@ -1454,13 +1526,44 @@ unprotect:
     {
       stream = find_stream_by_ssrc (filter, ssrc);
 
-      err = srtp_unprotect_mki (filter->session, map.data, &size,
+      err = srtp_unprotect_mki (session, map.data, &size,
           stream && stream->keys);
     }
 #else
-    err = srtp_unprotect (filter->session, map.data, &size);
+    err = srtp_unprotect (session, map.data, &size);
 #endif
   }
+
+  elapsed = gst_util_get_timestamp () - start;
+
+  gst_buffer_unmap (buf, &map);
+
+  stream = find_stream_by_ssrc (filter, ssrc);
+  if (stream) {
+    stream->unprotect_count++;
+    stream->unprotect_time += elapsed;
+    stream->max_unprotect_time = MAX (stream->max_unprotect_time, elapsed);
+  }
+
+  if (err == srtp_err_status_ok)
+    gst_buffer_set_size (buf, size);
+
+  return err;
+}
+
+/*
+ * Handles the result @err of unprotecting @buf, asking for a new key and
+ * trying again if the key expired. Returns whether the buffer can be pushed.
+ *
+ * This function should be called while holding the filter lock
+ */
+static gboolean
+gst_srtp_dec_finish_decode (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
+    gboolean is_rtcp, guint32 ssrc, srtp_err_status_t err)
+{
+  GstSrtpDecSsrcStream *stream;
+
+check:
   stream = find_stream_by_ssrc (filter, ssrc);
   if (stream == NULL) {
     GST_WARNING_OBJECT (filter, "Could not find matching stream, dropping");
@@ -1494,7 +1597,8 @@ unprotect:
         goto err;
       }
 
-      goto unprotect;
+      err = gst_srtp_dec_unprotect_buffer (filter, buf, is_rtcp, ssrc);
+      goto check;
     }
     case srtp_err_status_auth_fail:
       GST_WARNING_OBJECT (filter, "Error authentication packet, dropping");
@@ -1510,16 +1614,34 @@ unprotect:
       stream->recv_drop_count++;
       goto err;
   }
-  gst_buffer_unmap (buf, &map);
-  gst_buffer_set_size (buf, size);
   return TRUE;
 
 err:
   filter->recv_drop_count++;
-  gst_buffer_unmap (buf, &map);
   return FALSE;
 }
 
+/*
+ * This function should be called while holding the filter lock
+ */
+static gboolean
+gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
+    gboolean is_rtcp, guint32 ssrc)
+{
+  srtp_err_status_t err;
+
+  GST_LOG_OBJECT (pad, "Received %s buffer of size %" G_GSIZE_FORMAT
+      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (buf),
+      ssrc);
+  filter->recv_count++;
+  /* Change buffer to remove protection */
+  buf = gst_buffer_make_writable (buf);
+
+  err = gst_srtp_dec_unprotect_buffer (filter, buf, is_rtcp, ssrc);
+
+  return gst_srtp_dec_finish_decode (filter, pad, buf, is_rtcp, ssrc, err);
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     gboolean is_rtcp)
@@ -1590,6 +1712,194 @@ drop_buffer:
   return ret;
 }
 
+static void
+unprotect_job_run (gpointer data, gpointer user_data)
+{
+  UnprotectJob *job = data;
+  guint i;
+
+  for (i = 0; i < job->items->len; i++) {
+    UnprotectItem *item = g_array_index (job->items, UnprotectItem *, i);
+
+    item->err = gst_srtp_dec_unprotect_buffer (job->filter, item->buf,
+        item->is_rtcp, item->ssrc);
+    item->soft_limit = gst_srtp_get_soft_limit_reached ();
+  }
+}
+
+static gboolean
+gst_srtp_dec_ensure_early_events (GstSrtpDec * filter, gboolean is_rtcp)
+{
+  if (is_rtcp) {
+    if (!filter->rtcp_has_segment)
+      return gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
+          filter->rtp_srcpad, TRUE);
+  } else {
+    if (!filter->rtp_has_segment)
+      return gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
+          filter->rtcp_srcpad, FALSE);
+  }
+
+  return TRUE;
+}
+
+/* Pushes the buffers of @out_list, if any, on the source pad of @is_rtcp */
+static GstFlowReturn
+gst_srtp_dec_push_list (GstSrtpDec * filter, gboolean is_rtcp,
+    GstBufferList * out_list)
+{
+  if (gst_buffer_list_length (out_list) == 0) {
+    gst_buffer_list_unref (out_list);
+    return GST_FLOW_OK;
+  }
+
+  if (!gst_srtp_dec_ensure_early_events (filter, is_rtcp)) {
+    gst_buffer_list_unref (out_list);
+    return GST_FLOW_FLUSHING;
+  }
+
+  return gst_pad_push_list (is_rtcp ? filter->rtcp_srcpad :
+      filter->rtp_srcpad, out_list);
+}
+
+/* Unprotects the buffers of a list with one job per SSRC shard, in parallel
+ * if there is more than one shard. The buffers that can be pushed are
+ * pushed in their original order */
+static GstFlowReturn
+gst_srtp_dec_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list, gboolean is_rtcp)
+{
+  GstSrtpDec *filter = GST_SRTP_DEC (parent);
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferList *out_list;
+  UnprotectItem *items;
+  UnprotectJob *jobs = NULL;
+  gpointer *job_ptrs = NULL;
+  guint i, len, n_jobs = 0, n_shards;
+
+  len = gst_buffer_list_length (buf_list);
+  if (len == 0) {
+    gst_buffer_list_unref (buf_list);
+    return GST_FLOW_OK;
+  }
+
+  GST_LOG_OBJECT (pad, "Buffer chain with list of %u", len);
+
+  buf_list = gst_buffer_list_make_writable (buf_list);
+  items = g_new0 (UnprotectItem, len);
+
+  GST_OBJECT_LOCK (filter);
+
+  n_shards = MAX (filter->n_sessions, 1);
+  jobs = g_new0 (UnprotectJob, n_shards);
+  job_ptrs = g_new (gpointer, n_shards);
+
+  for (i = 0; i < len; i++) {
+    UnprotectItem *item = &items[i];
+    GstSrtpDecSsrcStream *stream;
+    UnprotectJob *job;
+
+    item->is_rtcp = is_rtcp;
+    stream = validate_buffer (filter, gst_buffer_list_get (buf_list, i),
+        &item->ssrc, &item->is_rtcp);
+    if (!stream) {
+      GST_WARNING_OBJECT (filter, "Invalid buffer, dropping");
+      continue;
+    }
+
+    /* Change buffer to remove protection */
+    item->buf = gst_buffer_list_get_writable (buf_list, i);
+
+    if (!STREAM_HAS_CRYPTO (stream))
+      continue;
+
+    GST_LOG_OBJECT (pad, "Received %s buffer of size %" G_GSIZE_FORMAT
+        " with SSRC = %u", item->is_rtcp ? "RTCP" : "RTP",
+        gst_buffer_get_size (item->buf), item->ssrc);
+    filter->recv_count++;
+    item->decode = TRUE;
+
+    job = &jobs[item->ssrc % n_shards];
+    if (!job->items) {
+      job->filter = filter;
+      job->items = g_array_new (FALSE, FALSE, sizeof (UnprotectItem *));
+      job_ptrs[n_jobs++] = job;
+    }
+    g_array_append_val (job->items, item);
+  }
+
+#ifdef HAVE_SRTP2
+  if (n_jobs > 1) {
+    gst_srtp_shard_pool_run (filter->shard_pool, unprotect_job_run, job_ptrs,
+        n_jobs, NULL);
+    n_jobs = 0;
+  }
+#endif
+  /* The libsrtp 1 ROC workaround updates the element state, so it always
+   * unprotects from the streaming thread */
+  for (i = 0; i < n_jobs; i++)
+    unprotect_job_run (job_ptrs[i], NULL);
+
+  for (i = 0; i < len; i++) {
+    UnprotectItem *item = &items[i];
+
+    if (item->decode && !gst_srtp_dec_finish_decode (filter, pad, item->buf,
+            item->is_rtcp, item->ssrc, item->err))
+      item->buf = NULL;
+  }
+
+  GST_OBJECT_UNLOCK (filter);
+
+  for (i = 0; i < n_shards; i++) {
+    if (jobs[i].items)
+      g_array_free (jobs[i].items, TRUE);
+  }
+  g_free (jobs);
+  g_free (job_ptrs);
+
+  /* If all is well, we may have reached soft limit */
+  for (i = 0; i < len; i++) {
+    if (items[i].buf && items[i].soft_limit)
+      request_key_with_signal (filter, items[i].ssrc, SIGNAL_SOFT_LIMIT);
+  }
+
+  /* RTCP can arrive on the RTP pad with rtcp-mux, it is pushed on its own
+   * source pad. The runs of buffers between such packets are pushed as
+   * lists, so that everything is pushed in the original order */
+  out_list = gst_buffer_list_new_sized (len);
+  for (i = 0; i < len && ret == GST_FLOW_OK; i++) {
+    if (!items[i].buf)
+      continue;
+
+    if (items[i].is_rtcp == is_rtcp) {
+      gst_buffer_list_add (out_list, gst_buffer_ref (items[i].buf));
+      continue;
+    }
+
+    ret = gst_srtp_dec_push_list (filter, is_rtcp, out_list);
+    out_list = gst_buffer_list_new_sized (len - i);
+    if (ret != GST_FLOW_OK)
+      break;
+
+    if (!gst_srtp_dec_ensure_early_events (filter, items[i].is_rtcp)) {
+      ret = GST_FLOW_FLUSHING;
+      break;
+    }
+    ret = gst_pad_push (items[i].is_rtcp ? filter->rtcp_srcpad :
+        filter->rtp_srcpad, gst_buffer_ref (items[i].buf));
+  }
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_srtp_dec_push_list (filter, is_rtcp, out_list);
+  else
+    gst_buffer_list_unref (out_list);
+
+  g_free (items);
+  gst_buffer_list_unref (buf_list);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain_rtp (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1602,6 +1912,20 @@ gst_srtp_dec_chain_rtcp (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return gst_srtp_dec_chain (pad, parent, buf, TRUE);
 }
 
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, FALSE);
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtcp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, TRUE);
+}
+
 static GstStateChangeReturn
 gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
 {
@@ -1625,6 +1949,13 @@ gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
       filter->rtcp_has_segment = FALSE;
       filter->recv_count = 0;
       filter->recv_drop_count = 0;
+
+      filter->n_sessions = filter->n_threads;
+      if (filter->n_sessions == 0)
+        filter->n_sessions = g_get_num_processors ();
+      filter->sessions = g_new0 (srtp_t, filter->n_sessions);
+      if (filter->n_sessions > 1)
+        filter->shard_pool = gst_srtp_shard_pool_new (filter->n_sessions);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
@@ -1644,6 +1975,13 @@ gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
       gst_srtp_dec_clear_streams (filter);
       g_hash_table_unref (filter->streams);
       filter->streams = NULL;
+
+      if (filter->shard_pool) {
+        g_thread_pool_free (filter->shard_pool, FALSE, TRUE);
+        filter->shard_pool = NULL;
+      }
+      g_clear_pointer (&filter->sessions, g_free);
+      filter->n_sessions = 0;
 #ifndef HAVE_SRTP2
       g_hash_table_unref (filter->streams_roc_changed);
       filter->streams_roc_changed = NULL;
@@ -76,10 +76,14 @@ struct _GstSrtpDec
   GstPad *rtcp_sinkpad, *rtcp_srcpad;
 
   gboolean ask_update;
-  srtp_t session;
-  gboolean first_session;
+  /* one session per shard of SSRCs, see GstSrtpDec:n-threads */
+  srtp_t *sessions;
+  guint n_sessions;
   GHashTable *streams;
 
+  guint n_threads;
+  GThreadPool *shard_pool;
+
   gboolean rtp_has_segment;
   gboolean rtcp_has_segment;
   guint recv_count;
@@ -104,6 +104,11 @@
  * This element supports sending with a single Master Key, it is possible to set the
  * Master Key Identifier (MKI) using the "mki" property. If this property is set, the MKI
  * will be added to every buffer.
+ *
+ * Buffer lists carrying many SSRCs, e.g. a bundled session with simulcast,
+ * can be protected by several threads with the "n-threads" property. The
+ * SSRCs are then distributed over as many libsrtp sessions, and the packets
+ * of one SSRC are always protected in order by the same thread.
  */
 
 #include "gstsrtpelements.h"
@@ -132,6 +137,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_srtp_enc_debug);
 #define DEFAULT_RANDOM_KEY      FALSE
 #define DEFAULT_REPLAY_WINDOW_SIZE 128
 #define DEFAULT_ALLOW_REPEAT_TX FALSE
+#define DEFAULT_N_THREADS       1
 
 #define HAS_CRYPTO(filter) (filter->rtp_cipher != GST_SRTP_CIPHER_NULL || \
       filter->rtcp_cipher != GST_SRTP_CIPHER_NULL ||                      \
@@ -158,7 +164,8 @@ enum
   PROP_REPLAY_WINDOW_SIZE,
   PROP_ALLOW_REPEAT_TX,
   PROP_STATS,
-  PROP_MKI
+  PROP_MKI,
+  PROP_N_THREADS
 };
 
 typedef struct ProcessBufferItData
@@ -170,6 +177,31 @@ typedef struct ProcessBufferItData
   gboolean is_rtcp;
 } ProcessBufferItData;
 
+/* Protection statistics of one SSRC */
+typedef struct
+{
+  guint64 count;
+  GstClockTime time;
+  GstClockTime max_time;
+} GstSrtpEncSsrcStats;
+
+/* The buffers of one SSRC shard in a buffer list */
+typedef struct
+{
+  GArray *indices;
+  gboolean soft_limit;
+} ProtectJob;
+
+typedef struct
+{
+  GstSrtpEnc *filter;
+  gboolean is_rtcp;
+  GstBuffer **inbufs;
+  guint32 *ssrcs;
+  GstBuffer **outbufs;
+  srtp_err_status_t *errs;
+} ProtectListData;
+
 /* the capabilities of the inputs and outputs.
  *
  * describe the real formats here.
@@ -335,6 +367,25 @@ gst_srtp_enc_class_init (GstSrtpEncClass * klass)
           GST_PARAM_MUTABLE_PLAYING));
 #endif
 
+  /**
+   * GstSrtpEnc:n-threads:
+   *
+   * Number of threads protecting the packets of a buffer list in parallel,
+   * 0 to use one per processor. The packets of one SSRC are always protected
+   * by the same thread and in order. Takes effect when the next session is
+   * created, i.e. on the first packet after a key change or a restart.
+   *
+   * The #GstSrtpEnc:stats contain how long protecting the packets of each
+   * SSRC took.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads protecting buffer lists (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstSrtpEnc::soft-limit:
    * @gstsrtpenc: the element on which the signal is emitted
@@ -363,7 +414,9 @@ gst_srtp_enc_init (GstSrtpEnc * filter)
   filter->rtcp_auth = DEFAULT_RTCP_AUTH;
   filter->replay_window_size = DEFAULT_REPLAY_WINDOW_SIZE;
   filter->allow_repeat_tx = DEFAULT_ALLOW_REPEAT_TX;
-  filter->ssrcs_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+  filter->n_threads = DEFAULT_N_THREADS;
+  filter->ssrcs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, g_free);
 }
 
 static guint
@@ -388,6 +441,7 @@ gst_srtp_enc_create_session (GstSrtpEnc * filter)
   srtp_policy_t policy;
   GstMapInfo map;
   guchar tmp[1];
+  guint i;
 #ifdef HAVE_SRTP2
   srtp_master_key_t mkey;
   srtp_master_key_t *mkey_ptr = &mkey;
@@ -468,12 +522,24 @@ gst_srtp_enc_create_session (GstSrtpEnc * filter)
   policy.window_size = filter->replay_window_size;
   policy.allow_repeat_tx = filter->allow_repeat_tx;
 
-  /* If it is the first stream, create the session
-   * If not, add the stream to the session
-   */
-  ret = srtp_create (&filter->session, &policy);
+  /* Every shard gets its own session with the same policy, the streams of
+   * the SSRCs are created in it on their first packet */
+  filter->n_sessions = filter->n_threads;
+  if (filter->n_sessions == 0)
+    filter->n_sessions = g_get_num_processors ();
+  filter->sessions = g_new0 (srtp_t, filter->n_sessions);
+
+  ret = srtp_err_status_ok;
+  for (i = 0; i < filter->n_sessions && ret == srtp_err_status_ok; i++)
+    ret = srtp_create (&filter->sessions[i], &policy);
   filter->first_session = FALSE;
 
+  if (ret == srtp_err_status_ok && filter->n_sessions > 1) {
+    GST_DEBUG_OBJECT (filter, "Protecting with %u threads",
+        filter->n_sessions);
+    filter->shard_pool = gst_srtp_shard_pool_new (filter->n_sessions);
+  }
+
 #ifdef HAVE_SRTP2
 done:
 
@@ -494,12 +560,23 @@ static void
 gst_srtp_enc_reset_no_lock (GstSrtpEnc * filter)
 {
   if (!filter->first_session) {
-    if (filter->session) {
-      srtp_dealloc (filter->session);
-      filter->session = NULL;
+    if (filter->shard_pool) {
+      g_thread_pool_free (filter->shard_pool, FALSE, TRUE);
+      filter->shard_pool = NULL;
+    }
+
+    if (filter->sessions) {
+      guint i;
+
+      for (i = 0; i < filter->n_sessions; i++) {
+        if (filter->sessions[i])
+          srtp_dealloc (filter->sessions[i]);
+      }
+      g_clear_pointer (&filter->sessions, g_free);
+      filter->n_sessions = 0;
     }
 
-    g_hash_table_remove_all (filter->ssrcs_set);
+    g_hash_table_remove_all (filter->ssrcs);
   }
 
   filter->first_session = TRUE;
@@ -653,13 +730,19 @@ gst_srtp_enc_dispose (GObject * object)
   gst_buffer_replace (&filter->key, NULL);
   gst_buffer_replace (&filter->mki, NULL);
 
-  if (filter->ssrcs_set)
-    g_hash_table_unref (filter->ssrcs_set);
-  filter->ssrcs_set = NULL;
+  if (filter->ssrcs)
+    g_hash_table_unref (filter->ssrcs);
+  filter->ssrcs = NULL;
 
   G_OBJECT_CLASS (gst_srtp_enc_parent_class)->dispose (object);
 }
 
+static srtp_t
+gst_srtp_enc_get_session (GstSrtpEnc * filter, guint32 ssrc)
+{
+  return filter->sessions[ssrc % filter->n_sessions];
+}
+
 static GstStructure *
 gst_srtp_enc_create_stats (GstSrtpEnc * filter)
 {
@@ -672,24 +755,29 @@ gst_srtp_enc_create_stats (GstSrtpEnc * filter)
   g_value_init (&va, GST_TYPE_ARRAY);
   g_value_init (&v, GST_TYPE_STRUCTURE);
 
-  if (filter->session) {
+  if (filter->sessions) {
     GHashTableIter iter;
-    gpointer key;
+    gpointer key, value;
 
-    g_hash_table_iter_init (&iter, filter->ssrcs_set);
-    while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    g_hash_table_iter_init (&iter, filter->ssrcs);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+      GstSrtpEncSsrcStats *stats = value;
       GstStructure *ss;
       guint32 ssrc = GPOINTER_TO_UINT (key);
       srtp_err_status_t status;
       guint32 roc;
 
-      status = srtp_get_stream_roc (filter->session, ssrc, &roc);
+      status = srtp_get_stream_roc (gst_srtp_enc_get_session (filter, ssrc),
+          ssrc, &roc);
       if (status != srtp_err_status_ok) {
         continue;
       }
 
       ss = gst_structure_new ("application/x-srtp-stream",
-          "ssrc", G_TYPE_UINT, ssrc, "roc", G_TYPE_UINT, roc, NULL);
+          "ssrc", G_TYPE_UINT, ssrc, "roc", G_TYPE_UINT, roc,
+          "protect-count", G_TYPE_UINT64, stats->count,
+          "protect-time", G_TYPE_UINT64, stats->time,
+          "max-protect-time", G_TYPE_UINT64, stats->max_time, NULL);
 
       g_value_take_boxed (&v, ss);
       gst_value_array_append_value (&va, &v);
@@ -750,6 +838,10 @@ gst_srtp_enc_set_property (GObject * object, guint prop_id,
     case PROP_ALLOW_REPEAT_TX:
       filter->allow_repeat_tx = g_value_get_boolean (value);
       break;
+
+    case PROP_N_THREADS:
+      filter->n_threads = g_value_get_uint (value);
+      break;
 #ifdef HAVE_SRTP2
     case PROP_MKI:
       gst_clear_buffer (&filter->mki);
@@ -802,6 +894,9 @@ gst_srtp_enc_get_property (GObject * object, guint prop_id,
     case PROP_STATS:
       g_value_take_boxed (value, gst_srtp_enc_create_stats (filter));
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->n_threads);
+      break;
 #ifdef HAVE_SRTP2
     case PROP_MKI:
       if (filter->mki)
@@ -827,9 +922,9 @@ get_rtp_other_pad (GstPad * pad)
 static void
 gst_srtp_enc_add_ssrc (GstSrtpEnc * filter, guint ssrc)
 {
-  gboolean is_added =
-      g_hash_table_add (filter->ssrcs_set, GUINT_TO_POINTER (ssrc));
-  if (is_added) {
+  if (!g_hash_table_contains (filter->ssrcs, GUINT_TO_POINTER (ssrc))) {
+    g_hash_table_insert (filter->ssrcs, GUINT_TO_POINTER (ssrc),
+        g_new0 (GstSrtpEncSsrcStats, 1));
     GST_DEBUG_OBJECT (filter, "Added ssrc %u", ssrc);
   }
 }
@@ -1111,26 +1206,40 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
   return GST_FLOW_OK;
 }
 
-static void
-gst_srtp_enc_ensure_ssrc (GstSrtpEnc * filter, GstBuffer * buf)
+/* Returns the SSRC whose session protects @buf, or 0 if there is none */
+static guint32
+gst_srtp_enc_get_ssrc (GstSrtpEnc * filter, GstBuffer * buf, gboolean is_rtcp)
 {
   GstRTPBuffer rtpbuf = GST_RTP_BUFFER_INIT;
-  if (gst_rtp_buffer_map (buf,
+  guint32 ssrc = 0;
+
+  if (is_rtcp) {
+    rtcp_buffer_get_ssrc (buf, &ssrc);
+  } else if (gst_rtp_buffer_map (buf,
           GST_MAP_READ | GST_RTP_BUFFER_MAP_FLAG_SKIP_PADDING, &rtpbuf)) {
-    guint32 ssrc = gst_rtp_buffer_get_ssrc (&rtpbuf);
+    ssrc = gst_rtp_buffer_get_ssrc (&rtpbuf);
     gst_srtp_enc_add_ssrc (filter, ssrc);
     gst_rtp_buffer_unmap (&rtpbuf);
   }
+
+  return ssrc;
 }
 
-static GstFlowReturn
-gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
-    GstBuffer * buf, gboolean is_rtcp, GstBuffer ** outbuf_ptr)
+/* Protects a copy of @buf with the session of @ssrc.
+ *
+ * Only uses the libsrtp stream and the statistics of @ssrc, so buffers of
+ * different shards can be protected in parallel while the streaming thread
+ * holds the filter lock */
+static srtp_err_status_t
+gst_srtp_enc_protect_buffer (GstSrtpEnc * filter, GstBuffer * buf,
+    guint32 ssrc, gboolean is_rtcp, GstBuffer ** outbuf_ptr)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
+  srtp_t session = gst_srtp_enc_get_session (filter, ssrc);
+  GstSrtpEncSsrcStats *stats;
   gint size_max, size;
-  GstBuffer *bufout = NULL;
+  GstBuffer *bufout;
   GstMapInfo mapout;
+  GstClockTime start, elapsed;
   srtp_err_status_t err;
 
   /* Create a bigger buffer to add protection */
@@ -1142,67 +1251,91 @@ gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
 
   gst_buffer_extract (buf, 0, mapout.data, size);
 
-  GST_OBJECT_LOCK (filter);
+  start = gst_util_get_timestamp ();
 
   gst_srtp_init_event_reporter ();
 
-  if (filter->session == NULL) {
-    /* The rtcp session disappeared (element shutting down) */
-    GST_OBJECT_UNLOCK (filter);
-    ret = GST_FLOW_FLUSHING;
-    goto fail;
-  }
-
-  gst_srtp_enc_ensure_ssrc (filter, buf);
-
 #ifdef HAVE_SRTP2
   if (is_rtcp)
-    err = srtp_protect_rtcp_mki (filter->session, mapout.data, &size,
+    err = srtp_protect_rtcp_mki (session, mapout.data, &size,
         (filter->mki != NULL), 0);
   else
-    err = srtp_protect_mki (filter->session, mapout.data, &size,
+    err = srtp_protect_mki (session, mapout.data, &size,
         (filter->mki != NULL), 0);
 #else
   if (is_rtcp)
-    err = srtp_protect_rtcp (filter->session, mapout.data, &size);
+    err = srtp_protect_rtcp (session, mapout.data, &size);
   else
-    err = srtp_protect (filter->session, mapout.data, &size);
+    err = srtp_protect (session, mapout.data, &size);
 #endif
 
-  GST_OBJECT_UNLOCK (filter);
+  elapsed = gst_util_get_timestamp () - start;
 
   gst_buffer_unmap (bufout, &mapout);
 
+  stats = g_hash_table_lookup (filter->ssrcs, GUINT_TO_POINTER (ssrc));
+  if (stats) {
+    stats->count++;
+    stats->time += elapsed;
+    stats->max_time = MAX (stats->max_time, elapsed);
+  }
+
   if (err == srtp_err_status_ok) {
     /* Buffer protected */
     gst_buffer_set_size (bufout, size);
     gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+    *outbuf_ptr = bufout;
+  } else {
+    gst_buffer_unref (bufout);
+    *outbuf_ptr = NULL;
+  }
 
-    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d",
-        is_rtcp ? "RTCP" : "RTP", size);
-
-  } else if (err == srtp_err_status_key_expired) {
+  return err;
+}
 
+static GstFlowReturn
+gst_srtp_enc_protect_error (GstSrtpEnc * filter, srtp_err_status_t err)
+{
+  if (err == srtp_err_status_key_expired) {
     GST_ELEMENT_ERROR (GST_ELEMENT_CAST (filter), STREAM, ENCODE,
         ("Key usage limit has been reached"),
         ("Unable to protect buffer (hard key usage limit reached)"));
-    ret = GST_FLOW_ERROR;
-    goto fail;
-
   } else {
     /* srtp_protect failed */
     GST_ELEMENT_ERROR (filter, LIBRARY, FAILED, (NULL),
         ("Unable to protect buffer (protect failed) code %d", err));
-    ret = GST_FLOW_ERROR;
-    goto fail;
   }
 
-  *outbuf_ptr = bufout;
-  return ret;
+  return GST_FLOW_ERROR;
+}
 
-fail:
-  gst_buffer_unref (bufout);
-  return ret;
+static GstFlowReturn
+gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
+    GstBuffer * buf, gboolean is_rtcp, GstBuffer ** outbuf_ptr)
+{
+  srtp_err_status_t err;
+  guint32 ssrc;
+
+  GST_OBJECT_LOCK (filter);
+
+  if (filter->sessions == NULL) {
+    /* The rtcp session disappeared (element shutting down) */
+    GST_OBJECT_UNLOCK (filter);
+    return GST_FLOW_FLUSHING;
+  }
+
+  ssrc = gst_srtp_enc_get_ssrc (filter, buf, is_rtcp);
+  err = gst_srtp_enc_protect_buffer (filter, buf, ssrc, is_rtcp, outbuf_ptr);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  if (err != srtp_err_status_ok)
+    return gst_srtp_enc_protect_error (filter, err);
+
+  GST_LOG_OBJECT (pad, "Encoding %s buffer of size %" G_GSIZE_FORMAT,
+      is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (*outbuf_ptr));
+
+  return GST_FLOW_OK;
 }
 
 static GstFlowReturn
@@ -1276,6 +1409,112 @@ process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
   return TRUE;
 }
 
+static void
+protect_job_run (gpointer data, gpointer user_data)
+{
+  ProtectJob *job = data;
+  ProtectListData *list = user_data;
+  guint i;
+
+  for (i = 0; i < job->indices->len; i++) {
+    guint idx = g_array_index (job->indices, guint, i);
+
+    list->errs[idx] = gst_srtp_enc_protect_buffer (list->filter,
+        list->inbufs[idx], list->ssrcs[idx], list->is_rtcp,
+        &list->outbufs[idx]);
+    if (gst_srtp_get_soft_limit_reached ())
+      job->soft_limit = TRUE;
+  }
+}
+
+/* Protects the buffers of @buf_list with one job per SSRC shard on the shard
+ * pool. The output keeps the order of the input */
+static GstFlowReturn
+gst_srtp_enc_process_list_sharded (GstSrtpEnc * filter, GstPad * pad,
+    GstBufferList * buf_list, gboolean is_rtcp, GstBufferList ** out_list_ptr,
+    gboolean * soft_limit)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  ProtectListData data;
+  ProtectJob *jobs = NULL;
+  gpointer *job_ptrs = NULL;
+  guint i, len, n_jobs = 0, n_shards = 0;
+
+  len = gst_buffer_list_length (buf_list);
+
+  data.filter = filter;
+  data.is_rtcp = is_rtcp;
+  data.inbufs = g_new (GstBuffer *, len);
+  data.ssrcs = g_new (guint32, len);
+  data.outbufs = g_new0 (GstBuffer *, len);
+  data.errs = g_new0 (srtp_err_status_t, len);
+
+  GST_OBJECT_LOCK (filter);
+
+  if (filter->sessions == NULL) {
+    /* The rtcp session disappeared (element shutting down) */
+    GST_OBJECT_UNLOCK (filter);
+    ret = GST_FLOW_FLUSHING;
+    goto done;
+  }
+
+  n_shards = filter->n_sessions;
+  jobs = g_new0 (ProtectJob, n_shards);
+  job_ptrs = g_new (gpointer, n_shards);
+
+  for (i = 0; i < len; i++) {
+    ProtectJob *job;
+
+    data.inbufs[i] = gst_buffer_list_get (buf_list, i);
+    data.ssrcs[i] = gst_srtp_enc_get_ssrc (filter, data.inbufs[i], is_rtcp);
+
+    job = &jobs[data.ssrcs[i] % n_shards];
+    if (!job->indices) {
+      job->indices = g_array_new (FALSE, FALSE, sizeof (guint));
+      job_ptrs[n_jobs++] = job;
+    }
+    g_array_append_val (job->indices, i);
+  }
+
+  gst_srtp_shard_pool_run (filter->shard_pool, protect_job_run, job_ptrs,
+      n_jobs, &data);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  *out_list_ptr = gst_buffer_list_new_sized (len);
+  for (i = 0; i < len; i++) {
+    if (data.errs[i] != srtp_err_status_ok) {
+      ret = gst_srtp_enc_protect_error (filter, data.errs[i]);
+      gst_clear_buffer_list (out_list_ptr);
+      break;
+    }
+    gst_buffer_list_add (*out_list_ptr, data.outbufs[i]);
+    data.outbufs[i] = NULL;
+  }
+
+  GST_LOG_OBJECT (pad, "Encoded list of %u %s buffers in %u shards", len,
+      is_rtcp ? "RTCP" : "RTP", n_jobs);
+
+done:
+  for (i = 0; i < n_shards; i++) {
+    if (jobs[i].indices) {
+      *soft_limit |= jobs[i].soft_limit;
+      g_array_free (jobs[i].indices, TRUE);
+    }
+  }
+  for (i = 0; i < len; i++)
+    gst_clear_buffer (&data.outbufs[i]);
+
+  g_free (jobs);
+  g_free (job_ptrs);
+  g_free (data.inbufs);
+  g_free (data.ssrcs);
+  g_free (data.outbufs);
+  g_free (data.errs);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * buf_list, gboolean is_rtcp)
@@ -1285,6 +1524,7 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   GstPad *otherpad;
   GstBufferList *out_list = NULL;
   ProcessBufferItData process_data;
+  gboolean sharded, soft_limit = FALSE;
 
   GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
       gst_buffer_list_length (buf_list));
@@ -1303,19 +1543,31 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
     return gst_pad_push_list (otherpad, buf_list);
   }
 
-  GST_OBJECT_UNLOCK (filter);
+  sharded = filter->n_sessions > 1;
 
-  out_list = gst_buffer_list_new ();
+  GST_OBJECT_UNLOCK (filter);
 
-  process_data.filter = filter;
-  process_data.pad = pad;
-  process_data.is_rtcp = is_rtcp;
-  process_data.out_list = out_list;
-  process_data.flowret = GST_FLOW_OK;
+  if (sharded) {
+    ret = gst_srtp_enc_process_list_sharded (filter, pad, buf_list, is_rtcp,
+        &out_list, &soft_limit);
+    if (ret != GST_FLOW_OK)
+      goto out;
+  } else {
+    out_list = gst_buffer_list_new ();
+
+    process_data.filter = filter;
+    process_data.pad = pad;
+    process_data.is_rtcp = is_rtcp;
+    process_data.out_list = out_list;
+    process_data.flowret = GST_FLOW_OK;
+
+    if (!gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data)) {
+      gst_buffer_list_unref (out_list);
+      ret = process_data.flowret;
+      goto out;
+    }
 
-  if (!gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data)) {
-    ret = process_data.flowret;
-    goto out;
+    soft_limit = gst_srtp_get_soft_limit_reached ();
   }
 
   if (!gst_buffer_list_length (out_list)) {
@@ -1336,7 +1588,7 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
   GST_OBJECT_LOCK (filter);
 
-  if (gst_srtp_get_soft_limit_reached ()) {
+  if (soft_limit) {
     GST_OBJECT_UNLOCK (filter);
     g_signal_emit (filter, gst_srtp_enc_signals[SIGNAL_SOFT_LIMIT], 0);
     GST_OBJECT_LOCK (filter);
@@ -78,14 +78,20 @@ struct _GstSrtpEnc
   guint rtcp_auth;
   GstBuffer *mki;
 
-  srtp_t session;
+  /* one session per shard of SSRCs, see GstSrtpEnc:n-threads */
+  srtp_t *sessions;
+  guint n_sessions;
   gboolean first_session;
   gboolean key_changed;
 
   guint replay_window_size;
   gboolean allow_repeat_tx;
 
-  GHashTable *ssrcs_set;
+  guint n_threads;
+  GThreadPool *shard_pool;
+
+  /* SSRC -> GstSrtpEncSsrcStats */
+  GHashTable *ssrcs;
 };
 
 struct _GstSrtpEncClass
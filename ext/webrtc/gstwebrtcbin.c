@@ -65,6 +65,10 @@
 #define RTPSTORAGE_EXTRA_TIME (50)
 
 #define DEFAULT_JB_LATENCY 200
+#define DEFAULT_STATS_INTERVAL 0
+#define DEFAULT_SCTP_BULK_MODE FALSE
+/* advertised in bulk mode, the default of 64 KiB applies otherwise */
+#define SCTP_BULK_MAX_MESSAGE_SIZE "262144"
 
 #define RTPHDREXT_MID GST_RTP_HDREXT_BASE "sdes:mid"
 #define RTPHDREXT_STREAM_ID GST_RTP_HDREXT_BASE "sdes:rtp-stream-id"
@@ -642,6 +646,7 @@ enum
   ON_ICE_CANDIDATE_SIGNAL,
   ON_NEW_TRANSCEIVER_SIGNAL,
   GET_STATS_SIGNAL,
+  GET_FILTERED_STATS_SIGNAL,
   ADD_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVERS_SIGNAL,
@@ -673,7 +678,9 @@ enum
   PROP_ICE_AGENT,
   PROP_LATENCY,
   PROP_SCTP_TRANSPORT,
-  PROP_HTTP_PROXY
+  PROP_HTTP_PROXY,
+  PROP_STATS_INTERVAL,
+  PROP_SCTP_BULK_MODE
 };
 
 static guint gst_webrtc_bin_signals[LAST_SIGNAL] = { 0 };
@@ -688,22 +695,20 @@ typedef struct
 GstWebRTCICEStream *
 _find_ice_stream_for_session (GstWebRTCBin * webrtc, guint session_id)
 {
-  int i;
+  GstWebRTCICEStream *stream;
 
-  for (i = 0; i < webrtc->priv->ice_stream_map->len; i++) {
-    IceStreamItem *item =
-        &g_array_index (webrtc->priv->ice_stream_map, IceStreamItem, i);
+  stream = g_hash_table_lookup (webrtc->priv->ice_streams_by_session,
+      GUINT_TO_POINTER (session_id));
 
-    if (item->session_id == session_id) {
-      GST_TRACE_OBJECT (webrtc, "Found ice stream id %" GST_PTR_FORMAT " for "
-          "session %u", item->stream, session_id);
-      return item->stream;
-    }
+  if (stream) {
+    GST_TRACE_OBJECT (webrtc, "Found ice stream id %" GST_PTR_FORMAT " for "
+        "session %u", stream, session_id);
+  } else {
+    GST_TRACE_OBJECT (webrtc, "No ice stream available for session %u",
+        session_id);
   }
 
-  GST_TRACE_OBJECT (webrtc, "No ice stream available for session %u",
-      session_id);
-  return NULL;
+  return stream;
 }
 
 void
@@ -715,6 +720,12 @@ _add_ice_stream_item (GstWebRTCBin * webrtc, guint session_id,
   GST_TRACE_OBJECT (webrtc, "adding ice stream %" GST_PTR_FORMAT " for "
       "session %u", stream, session_id);
   g_array_append_val (webrtc->priv->ice_stream_map, item);
+
+  /* the first stream added for a session is the one that is looked up */
+  if (!g_hash_table_contains (webrtc->priv->ice_streams_by_session,
+          GUINT_TO_POINTER (session_id)))
+    g_hash_table_insert (webrtc->priv->ice_streams_by_session,
+        GUINT_TO_POINTER (session_id), stream);
 }
 
 typedef gboolean (*FindTransceiverFunc) (GstWebRTCRTPTransceiver * p1,
@@ -752,13 +763,123 @@ transceiver_match_for_mline (GstWebRTCRTPTransceiver * trans, guint * mline)
   return trans->mline == *mline;
 }
 
+/* Whether @a comes before @b in the list of transceivers */
+static gboolean
+_transceiver_is_before (GstWebRTCBin * webrtc, GstWebRTCRTPTransceiver * a,
+    GstWebRTCRTPTransceiver * b)
+{
+  guint idx_a = G_MAXUINT, idx_b = G_MAXUINT;
+
+  g_ptr_array_find (webrtc->priv->transceivers, a, &idx_a);
+  g_ptr_array_find (webrtc->priv->transceivers, b, &idx_b);
+
+  return idx_a < idx_b;
+}
+
+static void
+_transceiver_index_mline (GstWebRTCBin * webrtc,
+    GstWebRTCRTPTransceiver * trans)
+{
+  GstWebRTCRTPTransceiver *other;
+
+  if (trans->stopped || trans->mline == -1)
+    return;
+
+  other = g_hash_table_lookup (webrtc->priv->transceivers_by_mline,
+      GUINT_TO_POINTER (trans->mline));
+  if (!other || (other != trans && _transceiver_is_before (webrtc, trans,
+              other)))
+    g_hash_table_insert (webrtc->priv->transceivers_by_mline,
+        GUINT_TO_POINTER (trans->mline), trans);
+}
+
+static void
+_transceiver_index_mid (GstWebRTCBin * webrtc, GstWebRTCRTPTransceiver * trans)
+{
+  GstWebRTCRTPTransceiver *other;
+
+  if (!trans->mid)
+    return;
+
+  other = g_hash_table_lookup (webrtc->priv->transceivers_by_mid, trans->mid);
+  if (!other || (other != trans && _transceiver_is_before (webrtc, trans,
+              other)))
+    g_hash_table_insert (webrtc->priv->transceivers_by_mid,
+        g_strdup (trans->mid), trans);
+}
+
+/* Removes @trans from the index entry for @key and hands the entry to the
+ * next transceiver with the same key, if any */
+static void
+_transceiver_unindex (GstWebRTCBin * webrtc, GHashTable * index,
+    gpointer key, GBoxedCopyFunc key_copy, gconstpointer data,
+    FindTransceiverFunc func, GstWebRTCRTPTransceiver * trans)
+{
+  GstWebRTCRTPTransceiver *next;
+
+  if (g_hash_table_lookup (index, key) != trans)
+    return;
+
+  g_hash_table_remove (index, key);
+  next = _find_transceiver (webrtc, data, func);
+  if (next && next != trans)
+    g_hash_table_insert (index, key_copy ? key_copy (key) : key, next);
+}
+
+/* Sets the mline of @trans, keeping transceivers_by_mline up to date */
+static void
+_transceiver_set_mline (GstWebRTCBin * webrtc,
+    GstWebRTCRTPTransceiver * trans, guint mline)
+{
+  guint old_mline = trans->mline;
+
+  if (old_mline == mline)
+    return;
+
+  trans->mline = mline;
+
+  if (old_mline != -1) {
+    _transceiver_unindex (webrtc, webrtc->priv->transceivers_by_mline,
+        GUINT_TO_POINTER (old_mline), NULL, &old_mline,
+        (FindTransceiverFunc) transceiver_match_for_mline, trans);
+  }
+  _transceiver_index_mline (webrtc, trans);
+}
+
+/* Sets the mid of @trans, keeping transceivers_by_mid up to date */
+static void
+_transceiver_set_mid (GstWebRTCBin * webrtc, GstWebRTCRTPTransceiver * trans,
+    const gchar * mid)
+{
+  gchar *old_mid = trans->mid;
+
+  if (g_strcmp0 (old_mid, mid) == 0)
+    return;
+
+  trans->mid = g_strdup (mid);
+
+  if (old_mid) {
+    _transceiver_unindex (webrtc, webrtc->priv->transceivers_by_mid, old_mid,
+        (GBoxedCopyFunc) g_strdup, old_mid,
+        (FindTransceiverFunc) transceiver_match_for_mid, trans);
+  }
+  _transceiver_index_mid (webrtc, trans);
+
+  g_free (old_mid);
+}
+
 static GstWebRTCRTPTransceiver *
 _find_transceiver_for_mline (GstWebRTCBin * webrtc, guint mlineindex)
 {
   GstWebRTCRTPTransceiver *trans;
 
-  trans = _find_transceiver (webrtc, &mlineindex,
-      (FindTransceiverFunc) transceiver_match_for_mline);
+  if (mlineindex == -1) {
+    trans = _find_transceiver (webrtc, &mlineindex,
+        (FindTransceiverFunc) transceiver_match_for_mline);
+  } else {
+    trans = g_hash_table_lookup (webrtc->priv->transceivers_by_mline,
+        GUINT_TO_POINTER (mlineindex));
+  }
 
   GST_TRACE_OBJECT (webrtc,
       "Found transceiver %" GST_PTR_FORMAT " for mlineindex %u", trans,
@@ -772,8 +893,12 @@ _find_transceiver_for_mid (GstWebRTCBin * webrtc, const char *mid)
 {
   GstWebRTCRTPTransceiver *trans;
 
-  trans = _find_transceiver (webrtc, mid,
-      (FindTransceiverFunc) transceiver_match_for_mid);
+  if (mid == NULL) {
+    trans = _find_transceiver (webrtc, mid,
+        (FindTransceiverFunc) transceiver_match_for_mid);
+  } else {
+    trans = g_hash_table_lookup (webrtc->priv->transceivers_by_mid, mid);
+  }
 
   GST_TRACE_OBJECT (webrtc, "Found transceiver %" GST_PTR_FORMAT " for "
       "mid %s", trans, mid);
@@ -781,38 +906,13 @@ _find_transceiver_for_mid (GstWebRTCBin * webrtc, const char *mid)
   return trans;
 }
 
-typedef gboolean (*FindTransportFunc) (TransportStream * p1,
-    gconstpointer data);
-
-static TransportStream *
-_find_transport (GstWebRTCBin * webrtc, gconstpointer data,
-    FindTransportFunc func)
-{
-  int i;
-
-  for (i = 0; i < webrtc->priv->transports->len; i++) {
-    TransportStream *stream = g_ptr_array_index (webrtc->priv->transports, i);
-
-    if (func (stream, data))
-      return stream;
-  }
-
-  return NULL;
-}
-
-static gboolean
-match_stream_for_session (TransportStream * trans, guint * session)
-{
-  return trans->session_id == *session;
-}
-
 static TransportStream *
 _find_transport_for_session (GstWebRTCBin * webrtc, guint session_id)
 {
   TransportStream *stream;
 
-  stream = _find_transport (webrtc, &session_id,
-      (FindTransportFunc) match_stream_for_session);
+  stream = g_hash_table_lookup (webrtc->priv->transports_by_session,
+      GUINT_TO_POINTER (session_id));
 
   GST_TRACE_OBJECT (webrtc,
       "Found transport %" GST_PTR_FORMAT " for session %u", stream, session_id);
@@ -1100,6 +1200,38 @@ _gst_pc_thread (GstWebRTCBin * webrtc)
   return NULL;
 }
 
+static GstStructure *_update_stats_task (GstWebRTCBin * webrtc,
+    gpointer data);
+
+static gboolean
+_stats_timeout (GstWebRTCBin * webrtc)
+{
+  gst_webrtc_bin_enqueue_task (webrtc, _update_stats_task, NULL, NULL, NULL);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* (Re)starts or stops the periodic stats updates according to the
+ * stats-interval property, call with the object lock */
+static void
+_update_stats_source_unlocked (GstWebRTCBin * webrtc)
+{
+  if (webrtc->priv->stats_source) {
+    g_source_destroy (webrtc->priv->stats_source);
+    g_source_unref (webrtc->priv->stats_source);
+    webrtc->priv->stats_source = NULL;
+  }
+
+  if (webrtc->priv->stats_interval > 0 && webrtc->priv->main_context
+      && !webrtc->priv->is_closed) {
+    GSource *source = g_timeout_source_new (webrtc->priv->stats_interval);
+
+    g_source_set_callback (source, (GSourceFunc) _stats_timeout, webrtc, NULL);
+    g_source_attach (source, webrtc->priv->main_context);
+    webrtc->priv->stats_source = source;
+  }
+}
+
 static void
 _start_thread (GstWebRTCBin * webrtc)
 {
@@ -1114,6 +1246,10 @@ _start_thread (GstWebRTCBin * webrtc)
   while (!webrtc->priv->loop)
     PC_COND_WAIT (webrtc);
   webrtc->priv->is_closed = FALSE;
+
+  GST_OBJECT_LOCK (webrtc);
+  _update_stats_source_unlocked (webrtc);
+  GST_OBJECT_UNLOCK (webrtc);
   PC_UNLOCK (webrtc);
 }
 
@@ -1122,6 +1258,7 @@ _stop_thread (GstWebRTCBin * webrtc)
 {
   GST_OBJECT_LOCK (webrtc);
   webrtc->priv->is_closed = TRUE;
+  _update_stats_source_unlocked (webrtc);
   GST_OBJECT_UNLOCK (webrtc);
 
   PC_LOCK (webrtc);
@@ -2417,6 +2554,7 @@ _create_webrtc_transceiver (GstWebRTCBin * webrtc,
       G_CALLBACK (gst_webrtc_bin_attach_tos), webrtc, G_CONNECT_SWAPPED);
 
   g_ptr_array_add (webrtc->priv->transceivers, trans);
+  _transceiver_index_mline (webrtc, rtp_trans);
 
   gst_object_unref (sender);
   gst_object_unref (receiver);
@@ -2451,6 +2589,10 @@ _create_transport_channel (GstWebRTCBin * webrtc, guint session_id)
   gst_bin_add (GST_BIN (webrtc), GST_ELEMENT (ret->send_bin));
   gst_bin_add (GST_BIN (webrtc), GST_ELEMENT (ret->receive_bin));
   g_ptr_array_add (webrtc->priv->transports, ret);
+  if (!g_hash_table_contains (webrtc->priv->transports_by_session,
+          GUINT_TO_POINTER (session_id)))
+    g_hash_table_insert (webrtc->priv->transports_by_session,
+        GUINT_TO_POINTER (session_id), ret);
 
   pad_name = g_strdup_printf ("recv_rtcp_sink_%u", ret->session_id);
   if (!gst_element_link_pads (GST_ELEMENT (ret->receive_bin), "rtcp_src",
@@ -2706,7 +2848,13 @@ _get_or_create_data_channel_transports (GstWebRTCBin * webrtc, guint session_id)
     webrtc->priv->data_channel_transport = stream;
 
     if (!(sctp_transport = webrtc->priv->sctp_transport)) {
+      gboolean bulk_mode;
+
       sctp_transport = webrtc_sctp_transport_new ();
+      GST_OBJECT_LOCK (webrtc);
+      bulk_mode = webrtc->priv->sctp_bulk_mode;
+      GST_OBJECT_UNLOCK (webrtc);
+      g_object_set (sctp_transport->sctpenc, "bulk-mode", bulk_mode, NULL);
       sctp_transport->transport =
           g_object_ref (webrtc->priv->data_channel_transport->transport);
       sctp_transport->webrtcbin = webrtc;
@@ -3690,6 +3838,23 @@ gather_media_mapping (GstWebRTCBin * webrtc)
   return media_mapping;
 }
 
+static void
+_add_sctp_attributes_to_media (GstWebRTCBin * webrtc, GstSDPMedia * media)
+{
+  gboolean bulk_mode;
+
+  /* FIXME: negotiate this properly */
+  gst_sdp_media_add_attribute (media, "sctp-port", "5000");
+
+  GST_OBJECT_LOCK (webrtc);
+  bulk_mode = webrtc->priv->sctp_bulk_mode;
+  GST_OBJECT_UNLOCK (webrtc);
+
+  if (bulk_mode)
+    gst_sdp_media_add_attribute (media, "max-message-size",
+        SCTP_BULK_MAX_MESSAGE_SIZE);
+}
+
 static gboolean
 _add_data_channel_offer (GstWebRTCBin * webrtc, GstSDPMessage * msg,
     GstSDPMedia * media, GString * bundled_mids, guint bundle_idx,
@@ -3775,8 +3940,7 @@ _add_data_channel_offer (GstWebRTCBin * webrtc, GstSDPMessage * msg,
     g_string_append_printf (bundled_mids, " %s", mid);
   }
 
-  /* FIXME: negotiate this properly */
-  gst_sdp_media_add_attribute (media, "sctp-port", "5000");
+  _add_sctp_attributes_to_media (webrtc, media);
 
   _get_or_create_data_channel_transports (webrtc,
       bundled_mids ? 0 : webrtc->priv->transceivers->len);
@@ -4450,8 +4614,7 @@ _create_answer_task (GstWebRTCBin * webrtc, const GstStructure * options,
       gst_sdp_media_set_port_info (media, 9, 0);
       gst_sdp_media_add_format (media, "webrtc-datachannel");
 
-      /* FIXME: negotiate this properly on renegotiation */
-      gst_sdp_media_add_attribute (media, "sctp-port", "5000");
+      _add_sctp_attributes_to_media (webrtc, media);
 
       _get_or_create_data_channel_transports (webrtc,
           bundled_mids ? bundle_idx : i);
@@ -5602,7 +5765,7 @@ _update_transceiver_from_sdp_media (GstWebRTCBin * webrtc,
       gst_sdp_message_get_media (webrtc->current_remote_description->sdp,
       media_idx);
 
-  rtp_trans->mline = media_idx;
+  _transceiver_set_mline (webrtc, rtp_trans, media_idx);
 
   if (!g_strcmp0 (gst_sdp_media_get_media (media), "audio")) {
     if (rtp_trans->kind == GST_WEBRTC_KIND_VIDEO)
@@ -5621,10 +5784,8 @@ _update_transceiver_from_sdp_media (GstWebRTCBin * webrtc,
   for (i = 0; i < gst_sdp_media_attributes_len (media); i++) {
     const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media, i);
 
-    if (g_strcmp0 (attr->key, "mid") == 0) {
-      g_free (rtp_trans->mid);
-      rtp_trans->mid = g_strdup (attr->value);
-    }
+    if (g_strcmp0 (attr->key, "mid") == 0)
+      _transceiver_set_mid (webrtc, rtp_trans, attr->value);
   }
 
   {
@@ -5796,7 +5957,7 @@ _update_transceiver_from_sdp_media (GstWebRTCBin * webrtc,
       }
     }
 
-    rtp_trans->mline = media_idx;
+    _transceiver_set_mline (webrtc, rtp_trans, media_idx);
     rtp_trans->current_direction = new_dir;
   }
 
@@ -6894,6 +7055,7 @@ _on_local_ice_candidate_cb (GstWebRTCICE * ice, guint session_id,
 struct get_stats
 {
   GstPad *pad;
+  GstStructure *filter;
   GstPromise *promise;
 };
 
@@ -6902,25 +7064,63 @@ _free_get_stats (struct get_stats *stats)
 {
   if (stats->pad)
     gst_object_unref (stats->pad);
+  if (stats->filter)
+    gst_structure_free (stats->filter);
   if (stats->promise)
     gst_promise_unref (stats->promise);
   g_free (stats);
 }
 
+/* Periodic stats update: keeps the report for get-stats and posts what
+ * changed since the previous one on the bus */
+static GstStructure *
+_update_stats_task (GstWebRTCBin * webrtc, gpointer data)
+{
+  GstStructure *stats, *delta;
+
+  stats = gst_webrtc_bin_create_stats (webrtc, NULL, NULL);
+  delta = gst_webrtc_stats_diff (webrtc->priv->last_stats, stats);
+
+  gst_clear_structure (&webrtc->priv->last_stats);
+  webrtc->priv->last_stats = stats;
+  webrtc->priv->last_stats_time = g_get_monotonic_time ();
+
+  if (delta)
+    gst_element_post_message (GST_ELEMENT (webrtc),
+        gst_message_new_element (GST_OBJECT (webrtc), delta));
+
+  return NULL;
+}
+
 /* https://www.w3.org/TR/webrtc/#dom-rtcpeerconnection-getstats() */
 static GstStructure *
 _get_stats_task (GstWebRTCBin * webrtc, struct get_stats *stats)
 {
+  guint interval;
+
+  GST_OBJECT_LOCK (webrtc);
+  interval = webrtc->priv->stats_interval;
+  GST_OBJECT_UNLOCK (webrtc);
+
+  /* The report of the periodic update is recent enough, don't walk all the
+   * pads, sessions and transports again */
+  if (!stats->pad && webrtc->priv->last_stats && interval > 0
+      && g_get_monotonic_time () - webrtc->priv->last_stats_time <
+      interval * G_GINT64_CONSTANT (1000)) {
+    GST_LOG_OBJECT (webrtc, "answering from the periodic stats report");
+    return gst_webrtc_stats_filter (webrtc->priv->last_stats, stats->filter);
+  }
+
   /* Our selector is the pad,
    * https://www.w3.org/TR/webrtc/#dfn-stats-selection-algorithm
    */
 
-  return gst_webrtc_bin_create_stats (webrtc, stats->pad);
+  return gst_webrtc_bin_create_stats (webrtc, stats->pad, stats->filter);
 }
 
 static void
-gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
-    GstPromise * promise)
+gst_webrtc_bin_get_filtered_stats (GstWebRTCBin * webrtc, GstPad * pad,
+    const GstStructure * filter, GstPromise * promise)
 {
   struct get_stats *stats;
 
@@ -6932,6 +7132,8 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
   /* FIXME: check that pad exists in element */
   if (pad)
     stats->pad = gst_object_ref (pad);
+  if (filter)
+    stats->filter = gst_structure_copy (filter);
 
   if (!gst_webrtc_bin_enqueue_task (webrtc, (GstWebRTCBinFunc) _get_stats_task,
           stats, (GDestroyNotify) _free_get_stats, promise)) {
@@ -6947,6 +7149,13 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
   }
 }
 
+static void
+gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
+    GstPromise * promise)
+{
+  gst_webrtc_bin_get_filtered_stats (webrtc, pad, NULL, promise);
+}
+
 static GstWebRTCRTPTransceiver *
 gst_webrtc_bin_add_transceiver (GstWebRTCBin * webrtc,
     GstWebRTCRTPTransceiverDirection direction, GstCaps * caps)
@@ -8157,7 +8366,7 @@ gst_webrtc_bin_request_new_pad (GstElement * element, GstPadTemplate * templ,
   if (lock_mline) {
     WebRTCTransceiver *wtrans = WEBRTC_TRANSCEIVER (trans);
     wtrans->mline_locked = TRUE;
-    trans->mline = serial;
+    _transceiver_set_mline (webrtc, trans, serial);
   }
 
   PC_UNLOCK (webrtc);
@@ -8263,6 +8472,17 @@ gst_webrtc_bin_set_property (GObject * object, guint prop_id,
       gst_webrtc_ice_set_http_proxy (webrtc->priv->ice,
           g_value_get_string (value));
       break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->stats_interval = g_value_get_uint (value);
+      _update_stats_source_unlocked (webrtc);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
+    case PROP_SCTP_BULK_MODE:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->sctp_bulk_mode = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -8344,6 +8564,16 @@ gst_webrtc_bin_get_property (GObject * object, guint prop_id,
       g_value_take_string (value,
           gst_webrtc_ice_get_http_proxy (webrtc->priv->ice));
       break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_uint (value, webrtc->priv->stats_interval);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
+    case PROP_SCTP_BULK_MODE:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_boolean (value, webrtc->priv->sctp_bulk_mode);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -8386,6 +8616,8 @@ gst_webrtc_bin_dispose (GObject * object)
   if (webrtc->priv->ice_stream_map)
     g_array_free (webrtc->priv->ice_stream_map, TRUE);
   webrtc->priv->ice_stream_map = NULL;
+  g_clear_pointer (&webrtc->priv->ice_streams_by_session,
+      g_hash_table_destroy);
 
   g_clear_object (&webrtc->priv->sctp_transport);
 
@@ -8397,10 +8629,14 @@ gst_webrtc_bin_finalize (GObject * object)
 {
   GstWebRTCBin *webrtc = GST_WEBRTC_BIN (object);
 
+  g_clear_pointer (&webrtc->priv->transports_by_session, g_hash_table_destroy);
   if (webrtc->priv->transports)
     g_ptr_array_free (webrtc->priv->transports, TRUE);
   webrtc->priv->transports = NULL;
 
+  g_clear_pointer (&webrtc->priv->transceivers_by_mid, g_hash_table_destroy);
+  g_clear_pointer (&webrtc->priv->transceivers_by_mline,
+      g_hash_table_destroy);
   if (webrtc->priv->transceivers)
     g_ptr_array_free (webrtc->priv->transceivers, TRUE);
   webrtc->priv->transceivers = NULL;
@@ -8452,6 +8688,8 @@ gst_webrtc_bin_finalize (GObject * object)
     gst_webrtc_session_description_free (webrtc->priv->last_generated_offer);
   webrtc->priv->last_generated_offer = NULL;
 
+  gst_clear_structure (&webrtc->priv->last_stats);
+
   g_mutex_clear (DC_GET_LOCK (webrtc));
   g_mutex_clear (ICE_GET_LOCK (webrtc));
   g_mutex_clear (PC_GET_LOCK (webrtc));
@@ -8658,6 +8896,55 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
           GST_TYPE_WEBRTC_SCTP_TRANSPORT,
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWebRTCBin:stats-interval:
+   *
+   * Interval (in ms) at which the statistics are collected on the
+   * peerconnection thread, 0 to disable.
+   *
+   * After each collection, an element message named
+   * "application/x-webrtc-stats-delta" is posted on the bus.  It contains
+   * the stats entries (see #GstWebRTCBin::get-stats) that are new or changed
+   * since the previous collection, ignoring their timestamp, and the ids of
+   * the entries that disappeared in a "removed-ids" (G_TYPE_STRV) field.
+   * Nothing is posted if nothing changed.
+   *
+   * While enabled, #GstWebRTCBin::get-stats and
+   * #GstWebRTCBin::get-filtered-stats without a pad are answered from the
+   * last collection instead of collecting the statistics again.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Stats Interval",
+          "Interval (in ms) at which statistics are collected and changes "
+          "are posted on the bus (0 = disabled)",
+          0, G_MAXUINT, DEFAULT_STATS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:sctp-bulk-mode:
+   *
+   * Configure the SCTP association carrying the data channels for
+   * throughput instead of latency: larger send and receive buffers, and
+   * small messages are bundled into full packets instead of being sent
+   * immediately. Useful for file transfers and other bulk data.
+   *
+   * Messages of up to 256 KiB are advertised in the SDP instead of the
+   * default of 64 KiB.
+   *
+   * Only has an effect if set before the SCTP transport is created, i.e.
+   * before the first data channel is negotiated.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_SCTP_BULK_MODE,
+      g_param_spec_boolean ("sctp-bulk-mode", "SCTP bulk mode",
+          "Favour throughput over latency for data channels",
+          DEFAULT_SCTP_BULK_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstWebRTCBin::create-offer:
    * @object: the #webrtcbin
@@ -8819,6 +9106,31 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
       G_CALLBACK (gst_webrtc_bin_get_stats), NULL, NULL, NULL,
       G_TYPE_NONE, 2, GST_TYPE_PAD, GST_TYPE_PROMISE);
 
+  /**
+   * GstWebRTCBin::get-filtered-stats:
+   * @object: the #webrtcbin
+   * @pad: (nullable): A #GstPad to get the stats for, or %NULL for all
+   * @filter: (nullable): a #GstStructure the stats entries must match
+   * @promise: a #GstPromise for the result
+   *
+   * Like #GstWebRTCBin::get-stats but the reply only contains the stats
+   * entries that have all the fields of @filter with an intersecting value.
+   * For example a filter with a "type" field holding a list of
+   * #GstWebRTCStatsType only returns the entries of those types, and one with
+   * an "id" field only returns the entries with that id.
+   *
+   * Statistics of types that can't match the filter are not collected, in
+   * particular the RTP sessions are not queried when no RTP stream stats are
+   * requested.
+   *
+   * Since: 1.24
+   */
+  gst_webrtc_bin_signals[GET_FILTERED_STATS_SIGNAL] =
+      g_signal_new_class_handler ("get-filtered-stats",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_bin_get_filtered_stats), NULL, NULL, NULL,
+      G_TYPE_NONE, 3, GST_TYPE_PAD, GST_TYPE_STRUCTURE, GST_TYPE_PROMISE);
+
   /**
    * GstWebRTCBin::on-negotiation-needed:
    * @object: the #webrtcbin
@@ -9029,6 +9341,10 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
       g_ptr_array_new_with_free_func ((GDestroyNotify) _unparent_and_unref);
   webrtc->priv->transports =
       g_ptr_array_new_with_free_func ((GDestroyNotify) _transport_free);
+  webrtc->priv->transceivers_by_mid =
+      g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  webrtc->priv->transceivers_by_mline = g_hash_table_new (NULL, NULL);
+  webrtc->priv->transports_by_session = g_hash_table_new (NULL, NULL);
 
   webrtc->priv->data_channels =
       g_ptr_array_new_with_free_func ((GDestroyNotify) gst_object_unref);
@@ -9038,6 +9354,7 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
 
   webrtc->priv->ice_stream_map =
       g_array_new (FALSE, TRUE, sizeof (IceStreamItem));
+  webrtc->priv->ice_streams_by_session = g_hash_table_new (NULL, NULL);
   webrtc->priv->pending_remote_ice_candidates =
       g_array_new (FALSE, TRUE, sizeof (IceCandidateItem));
   g_array_set_clear_func (webrtc->priv->pending_remote_ice_candidates,
@@ -9051,4 +9368,6 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
   /* we start off closed until we move to READY */
   webrtc->priv->is_closed = TRUE;
   webrtc->priv->jb_latency = DEFAULT_JB_LATENCY;
+  webrtc->priv->stats_interval = DEFAULT_STATS_INTERVAL;
+  webrtc->priv->sctp_bulk_mode = DEFAULT_SCTP_BULK_MODE;
 }
@@ -108,6 +108,12 @@ struct _GstWebRTCBinPrivate
   gboolean bundle;
   GPtrArray *transceivers;
   GPtrArray *transports;
+  /* lookup indexes into transceivers and transports, keyed by mid (string),
+   * mline and session id (GUINT_TO_POINTER). Each key maps to the first
+   * matching entry in the array, like a linear search would find it */
+  GHashTable *transceivers_by_mid;
+  GHashTable *transceivers_by_mline;
+  GHashTable *transports_by_session;
   GPtrArray *data_channels;
   /* list of data channels we've received a sctp stream for but no data
    * channel protocol for */
@@ -123,6 +129,8 @@ struct _GstWebRTCBinPrivate
 
   GstWebRTCICE *ice;
   GArray *ice_stream_map;
+  /* session id -> GstWebRTCICEStream, index into ice_stream_map */
+  GHashTable *ice_streams_by_session;
   GMutex ice_lock;
   GArray *pending_remote_ice_candidates;
   GArray *pending_local_ice_candidates;
@@ -153,6 +161,17 @@ struct _GstWebRTCBinPrivate
   GstWebRTCSessionDescription *last_generated_answer;
 
   gboolean tos_attached;
+
+  /* protected by the object lock */
+  gboolean sctp_bulk_mode;
+
+  /* periodic stats updates, protected by the object lock */
+  guint stats_interval;
+  GSource *stats_source;
+  /* last periodic stats report and when it was created, protected by the
+   * pc_lock */
+  GstStructure *last_stats;
+  gint64 last_stats_time;
 };
 
 typedef GstStructure *(*GstWebRTCBinFunc) (GstWebRTCBin * webrtc, gpointer data);
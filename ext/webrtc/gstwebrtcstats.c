@@ -870,15 +870,129 @@ _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
   return has_caps_ssrc;
 }
 
+/* RTP session statistics shared by all pads of a (bundled) session, only
+ * retrieved once per stats report */
+struct session_stats
+{
+  GValueArray *source_stats;
+  /* ssrc -> source stats of that ssrc */
+  GHashTable *sources;
+  /* ssrc -> GPtrArray of source stats with a report block about that ssrc */
+  GHashTable *rb_sources;
+  gchar *transport_id;
+};
+
+static void
+_free_session_stats (struct session_stats *session)
+{
+  if (session->source_stats)
+    g_value_array_free (session->source_stats);
+  g_hash_table_unref (session->sources);
+  g_hash_table_unref (session->rb_sources);
+  g_free (session->transport_id);
+  g_free (session);
+}
+
+struct stats_collection
+{
+  GstStructure *s;
+  /* whether any of the RTP stream stats types were requested */
+  gboolean want_rtp;
+  /* session id -> struct session_stats */
+  GHashTable *sessions;
+};
+
+static struct session_stats *
+_get_session_stats (GstWebRTCBin * webrtc, TransportStream * stream,
+    struct stats_collection *collection)
+{
+  struct session_stats *session;
+  GObject *gst_rtp_session;
+  GstStructure *twcc_stats;
+  guint i;
+
+  session = g_hash_table_lookup (collection->sessions,
+      GUINT_TO_POINTER (stream->session_id));
+  if (session)
+    return session;
+
+  session = g_new0 (struct session_stats, 1);
+  session->sources = g_hash_table_new (NULL, NULL);
+  session->rb_sources = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) g_ptr_array_unref);
+
+  g_signal_emit_by_name (webrtc->rtpbin, "get-session", stream->session_id,
+      &gst_rtp_session);
+  g_object_get (gst_rtp_session, "twcc-stats", &twcc_stats, NULL);
+
+  session->transport_id =
+      _get_stats_from_dtls_transport (webrtc, stream->transport,
+      GST_WEBRTC_ICE_STREAM (stream->stream), twcc_stats, collection->s);
+
+  if (collection->want_rtp) {
+    GObject *rtp_session;
+    GstStructure *rtp_stats;
+
+    g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
+        stream->session_id, &rtp_session);
+    g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+
+    gst_structure_get (rtp_stats, "source-stats", G_TYPE_VALUE_ARRAY,
+        &session->source_stats, NULL);
+
+    GST_DEBUG_OBJECT (webrtc, "retrieved rtp stats from transport %"
+        GST_PTR_FORMAT " rtp session %" GST_PTR_FORMAT " with %u rtp sources, "
+        "transport %" GST_PTR_FORMAT, stream, rtp_session,
+        session->source_stats->n_values, stream->transport);
+
+    /* index the sources so that each ssrc of each pad is a lookup instead of
+     * a walk over all the sources of the session */
+    for (i = 0; i < session->source_stats->n_values; i++) {
+      const GValue *val = g_value_array_get_nth (session->source_stats, i);
+      const GstStructure *stats = gst_value_get_structure (val);
+      guint ssrc = 0, rb_ssrc = 0;
+      gboolean have_ssrc;
+
+      have_ssrc = gst_structure_get_uint (stats, "ssrc", &ssrc);
+      if (have_ssrc)
+        g_hash_table_insert (session->sources, GUINT_TO_POINTER (ssrc),
+            (gpointer) stats);
+
+      if (gst_structure_get_uint (stats, "rb-ssrc", &rb_ssrc)
+          && (!have_ssrc || rb_ssrc != ssrc)) {
+        GPtrArray *rb = g_hash_table_lookup (session->rb_sources,
+            GUINT_TO_POINTER (rb_ssrc));
+
+        if (!rb) {
+          rb = g_ptr_array_new ();
+          g_hash_table_insert (session->rb_sources, GUINT_TO_POINTER (rb_ssrc),
+              rb);
+        }
+        g_ptr_array_add (rb, (gpointer) stats);
+      }
+    }
+
+    g_clear_object (&rtp_session);
+    gst_clear_structure (&rtp_stats);
+  }
+
+  g_clear_object (&gst_rtp_session);
+  gst_clear_structure (&twcc_stats);
+
+  g_hash_table_insert (collection->sessions,
+      GUINT_TO_POINTER (stream->session_id), session);
+
+  return session;
+}
+
 struct transport_stream_stats
 {
   GstWebRTCBin *webrtc;
   TransportStream *stream;
-  char *transport_id;
+  struct session_stats *session;
   char *codec_id;
   const char *kind;
   guint clock_rate;
-  GValueArray *source_stats;
   GstStructure *s;
 };
 
@@ -886,50 +1000,41 @@ static gboolean
 webrtc_stats_get_from_transport (SsrcMapItem * entry,
     struct transport_stream_stats *ts_stats)
 {
-  double ts;
-  int i;
-
-  gst_structure_get_double (ts_stats->s, "timestamp", &ts);
+  const GstStructure *stats;
+  GPtrArray *rb;
+  guint i;
 
   /* construct stats objects */
-  for (i = 0; i < ts_stats->source_stats->n_values; i++) {
-    const GstStructure *stats;
-    const GValue *val = g_value_array_get_nth (ts_stats->source_stats, i);
-    guint stats_ssrc = 0;
-
-    stats = gst_value_get_structure (val);
-
-    /* skip foreign sources */
-    if (gst_structure_get_uint (stats, "ssrc", &stats_ssrc) &&
-        entry->ssrc == stats_ssrc)
-      _get_stats_from_rtp_source_stats (ts_stats->webrtc, ts_stats->stream,
-          stats, ts_stats->codec_id, ts_stats->kind, ts_stats->transport_id,
-          ts_stats->s);
-    else if (gst_structure_get_uint (stats, "rb-ssrc", &stats_ssrc)
-        && entry->ssrc == stats_ssrc)
-      _get_stats_from_remote_rtp_source_stats (ts_stats->webrtc,
-          ts_stats->stream, stats, entry->ssrc, ts_stats->clock_rate,
-          ts_stats->codec_id, ts_stats->kind, ts_stats->transport_id,
-          ts_stats->s);
-  }
+  stats = g_hash_table_lookup (ts_stats->session->sources,
+      GUINT_TO_POINTER (entry->ssrc));
+  if (stats)
+    _get_stats_from_rtp_source_stats (ts_stats->webrtc, ts_stats->stream,
+        stats, ts_stats->codec_id, ts_stats->kind,
+        ts_stats->session->transport_id, ts_stats->s);
+
+  rb = g_hash_table_lookup (ts_stats->session->rb_sources,
+      GUINT_TO_POINTER (entry->ssrc));
+  for (i = 0; rb && i < rb->len; i++)
+    _get_stats_from_remote_rtp_source_stats (ts_stats->webrtc,
+        ts_stats->stream, g_ptr_array_index (rb, i), entry->ssrc,
+        ts_stats->clock_rate, ts_stats->codec_id, ts_stats->kind,
+        ts_stats->session->transport_id, ts_stats->s);
 
   /* we want to look at all the entries */
   return FALSE;
 }
 
 static gboolean
-_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
+_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
+    struct stats_collection *collection)
 {
   GstWebRTCBinPad *wpad = GST_WEBRTC_BIN_PAD (pad);
   struct transport_stream_stats ts_stats = { NULL, };
   guint ssrc, clock_rate;
-  GObject *rtp_session;
-  GObject *gst_rtp_session;
-  GstStructure *rtp_stats, *twcc_stats;
   GstWebRTCKind kind;
 
-  _get_codec_stats_from_pad (webrtc, pad, s, &ts_stats.codec_id, &ssrc,
-      &clock_rate);
+  _get_codec_stats_from_pad (webrtc, pad, collection->s, &ts_stats.codec_id,
+      &ssrc, &clock_rate);
 
   if (!wpad->trans)
     goto out;
@@ -957,49 +1062,73 @@ _get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
   if (!ts_stats.stream->transport)
     goto out;
 
-  g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
-      ts_stats.stream->session_id, &rtp_session);
-  g_object_get (rtp_session, "stats", &rtp_stats, NULL);
-  g_signal_emit_by_name (webrtc->rtpbin, "get-session",
-      ts_stats.stream->session_id, &gst_rtp_session);
-  g_object_get (gst_rtp_session, "twcc-stats", &twcc_stats, NULL);
-
-  gst_structure_get (rtp_stats, "source-stats", G_TYPE_VALUE_ARRAY,
-      &ts_stats.source_stats, NULL);
-
-  ts_stats.transport_id =
-      _get_stats_from_dtls_transport (webrtc, ts_stats.stream->transport,
-      GST_WEBRTC_ICE_STREAM (ts_stats.stream->stream), twcc_stats, s);
-
-  GST_DEBUG_OBJECT (webrtc, "retrieving rtp stream stats from transport %"
-      GST_PTR_FORMAT " rtp session %" GST_PTR_FORMAT " with %u rtp sources, "
-      "transport %" GST_PTR_FORMAT, ts_stats.stream, rtp_session,
-      ts_stats.source_stats->n_values, ts_stats.stream->transport);
+  ts_stats.session = _get_session_stats (webrtc, ts_stats.stream, collection);
+  if (!ts_stats.session->source_stats)
+    goto out;
 
-  ts_stats.s = s;
+  ts_stats.webrtc = webrtc;
+  ts_stats.s = collection->s;
   ts_stats.clock_rate = clock_rate;
 
   transport_stream_find_ssrc_map_item (ts_stats.stream, &ts_stats,
       (FindSsrcMapFunc) webrtc_stats_get_from_transport);
 
-  g_clear_object (&rtp_session);
-  g_clear_object (&gst_rtp_session);
-  gst_clear_structure (&rtp_stats);
-  gst_clear_structure (&twcc_stats);
-  g_value_array_free (ts_stats.source_stats);
-  ts_stats.source_stats = NULL;
-  g_clear_pointer (&ts_stats.transport_id, g_free);
-
 out:
   g_clear_pointer (&ts_stats.codec_id, g_free);
   return TRUE;
 }
 
+static gboolean
+_filter_field_matches (GQuark field_id, const GValue * value,
+    const GstStructure * entry)
+{
+  const GValue *entry_value = gst_structure_id_get_value (entry, field_id);
+
+  return entry_value && gst_value_intersect (NULL, entry_value, value);
+}
+
+static gboolean
+_stats_entry_matches (GQuark field_id, GValue * value,
+    const GstStructure * filter)
+{
+  if (!GST_VALUE_HOLDS_STRUCTURE (value))
+    return TRUE;
+
+  return gst_structure_foreach (filter,
+      (GstStructureForeachFunc) _filter_field_matches,
+      (gpointer) gst_value_get_structure (value));
+}
+
+/* Whether stats entries of @type can match @filter */
+static gboolean
+_filter_wants_type (const GstStructure * filter, GstWebRTCStatsType type)
+{
+  const GValue *filter_type;
+  GValue v = G_VALUE_INIT;
+  gboolean ret;
+
+  if (!filter)
+    return TRUE;
+
+  filter_type = gst_structure_get_value (filter, "type");
+  if (!filter_type)
+    return TRUE;
+
+  g_value_init (&v, GST_TYPE_WEBRTC_STATS_TYPE);
+  g_value_set_enum (&v, type);
+  ret = gst_value_intersect (NULL, &v, filter_type);
+  g_value_unset (&v);
+
+  return ret;
+}
+
 GstStructure *
-gst_webrtc_bin_create_stats (GstWebRTCBin * webrtc, GstPad * pad)
+gst_webrtc_bin_create_stats (GstWebRTCBin * webrtc, GstPad * pad,
+    const GstStructure * filter)
 {
   GstStructure *s = gst_structure_new_empty ("application/x-webrtc-stats");
   double ts = monotonic_time_as_double_milliseconds ();
+  struct stats_collection collection = { NULL, };
   GstStructure *pc_stats;
 
   _init_debug ();
@@ -1007,7 +1136,6 @@ gst_webrtc_bin_create_stats (GstWebRTCBin * webrtc, GstPad * pad)
   gst_structure_set (s, "timestamp", G_TYPE_DOUBLE, ts, NULL);
 
   /* FIXME: better unique IDs */
-  /* FIXME: rate limitting stat updates? */
   /* FIXME: all stats need to be kept forever */
 
   GST_DEBUG_OBJECT (webrtc, "updating stats at time %f", ts);
@@ -1019,13 +1147,141 @@ gst_webrtc_bin_create_stats (GstWebRTCBin * webrtc, GstPad * pad)
     gst_structure_free (pc_stats);
   }
 
+  collection.s = s;
+  collection.want_rtp =
+      _filter_wants_type (filter, GST_WEBRTC_STATS_INBOUND_RTP)
+      || _filter_wants_type (filter, GST_WEBRTC_STATS_OUTBOUND_RTP)
+      || _filter_wants_type (filter, GST_WEBRTC_STATS_REMOTE_INBOUND_RTP)
+      || _filter_wants_type (filter, GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP);
+  collection.sessions = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) _free_session_stats);
+
   if (pad)
-    _get_stats_from_pad (webrtc, pad, s);
+    _get_stats_from_pad (webrtc, pad, &collection);
   else
     gst_element_foreach_pad (GST_ELEMENT (webrtc),
-        (GstElementForeachPadFunc) _get_stats_from_pad, s);
+        (GstElementForeachPadFunc) _get_stats_from_pad, &collection);
+
+  g_hash_table_unref (collection.sessions);
 
   gst_structure_remove_field (s, "timestamp");
 
+  if (filter)
+    gst_structure_filter_and_map_in_place (s,
+        (GstStructureFilterMapFunc) _stats_entry_matches, (gpointer) filter);
+
+  return s;
+}
+
+/*
+ * gst_webrtc_stats_filter:
+ * @stats: a stats report as created by gst_webrtc_bin_create_stats()
+ * @filter: (nullable): the fields the stats entries must match
+ *
+ * Returns: a copy of @stats with only the entries that have all the fields of
+ * @filter with an intersecting value
+ */
+GstStructure *
+gst_webrtc_stats_filter (const GstStructure * stats,
+    const GstStructure * filter)
+{
+  GstStructure *s = gst_structure_copy (stats);
+
+  if (filter)
+    gst_structure_filter_and_map_in_place (s,
+        (GstStructureFilterMapFunc) _stats_entry_matches, (gpointer) filter);
+
   return s;
 }
+
+static gboolean
+_stats_field_equal (GQuark field_id, const GValue * value,
+    const GstStructure * other)
+{
+  const GValue *other_value;
+
+  /* changes every time */
+  if (field_id == g_quark_from_static_string ("timestamp"))
+    return TRUE;
+
+  other_value = gst_structure_id_get_value (other, field_id);
+
+  return other_value
+      && gst_value_compare (value, other_value) == GST_VALUE_EQUAL;
+}
+
+static gboolean
+_stats_entry_equal (const GstStructure * a, const GstStructure * b)
+{
+  if (gst_structure_n_fields (a) != gst_structure_n_fields (b))
+    return FALSE;
+
+  return gst_structure_foreach (a, (GstStructureForeachFunc) _stats_field_equal,
+      (gpointer) b);
+}
+
+/*
+ * gst_webrtc_stats_diff:
+ * @old_stats: (nullable): the previous stats report
+ * @new_stats: the current stats report
+ *
+ * Returns: (nullable): a structure named "application/x-webrtc-stats-delta"
+ * with the entries of @new_stats that are new or changed since @old_stats,
+ * and the ids of the entries that disappeared in a "removed-ids" field, or
+ * %NULL if nothing changed
+ */
+GstStructure *
+gst_webrtc_stats_diff (const GstStructure * old_stats,
+    const GstStructure * new_stats)
+{
+  GstStructure *delta;
+  GPtrArray *removed;
+  guint i, n;
+
+  delta = gst_structure_new_empty ("application/x-webrtc-stats-delta");
+
+  n = gst_structure_n_fields (new_stats);
+  for (i = 0; i < n; i++) {
+    const gchar *id = gst_structure_nth_field_name (new_stats, i);
+    const GValue *value = gst_structure_get_value (new_stats, id);
+    const GValue *old_value = NULL;
+
+    if (old_stats)
+      old_value = gst_structure_get_value (old_stats, id);
+
+    if (old_value && GST_VALUE_HOLDS_STRUCTURE (old_value)
+        && GST_VALUE_HOLDS_STRUCTURE (value)
+        && _stats_entry_equal (gst_value_get_structure (value),
+            gst_value_get_structure (old_value)))
+      continue;
+
+    gst_structure_set_value (delta, id, value);
+  }
+
+  removed = g_ptr_array_new ();
+  n = old_stats ? gst_structure_n_fields (old_stats) : 0;
+  for (i = 0; i < n; i++) {
+    const gchar *id = gst_structure_nth_field_name (old_stats, i);
+
+    if (!gst_structure_has_field (new_stats, id))
+      g_ptr_array_add (removed, g_strdup (id));
+  }
+
+  if (removed->len > 0) {
+    gchar **removed_ids;
+
+    g_ptr_array_add (removed, NULL);
+    removed_ids = (gchar **) g_ptr_array_free (removed, FALSE);
+    gst_structure_set (delta, "removed-ids", G_TYPE_STRV, removed_ids, NULL);
+    g_strfreev (removed_ids);
+  } else {
+    g_ptr_array_free (removed, TRUE);
+  }
+
+  if (gst_structure_n_fields (delta) == 0) {
+    gst_structure_free (delta);
+    return NULL;
+  }
+
+  return delta;
+}
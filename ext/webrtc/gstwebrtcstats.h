@@ -29,7 +29,14 @@ G_BEGIN_DECLS
 
 G_GNUC_INTERNAL
 GstStructure *     gst_webrtc_bin_create_stats         (GstWebRTCBin * webrtc,
-                                                        GstPad * pad);
+                                                        GstPad * pad,
+                                                        const GstStructure * filter);
+G_GNUC_INTERNAL
+GstStructure *     gst_webrtc_stats_filter             (const GstStructure * stats,
+                                                        const GstStructure * filter);
+G_GNUC_INTERNAL
+GstStructure *     gst_webrtc_stats_diff               (const GstStructure * old_stats,
+                                                        const GstStructure * new_stats);
 
 G_END_DECLS
 
@@ -1036,19 +1036,89 @@ _emit_low_threshold (WebRTCDataChannel * channel, gpointer user_data)
       (channel));
 }
 
+static void
+_buffered_amount_sent (WebRTCDataChannel * channel, guint64 size)
+{
+  guint64 prev_amount;
+
+  GST_WEBRTC_DATA_CHANNEL_LOCK (channel);
+  prev_amount = channel->parent.buffered_amount;
+  channel->parent.buffered_amount -= size;
+  GST_TRACE_OBJECT (channel, "checking low-threshold: prev %"
+      G_GUINT64_FORMAT " low-threshold %" G_GUINT64_FORMAT " buffered %"
+      G_GUINT64_FORMAT, prev_amount,
+      channel->parent.buffered_amount_low_threshold,
+      channel->parent.buffered_amount);
+  if (prev_amount >= channel->parent.buffered_amount_low_threshold
+      && channel->parent.buffered_amount <=
+      channel->parent.buffered_amount_low_threshold) {
+    _channel_enqueue_task (channel, (ChannelTask) _emit_low_threshold, NULL,
+        NULL);
+  }
+
+  GST_WEBRTC_DATA_CHANNEL_UNLOCK (channel);
+  g_object_notify (G_OBJECT (&channel->parent), "buffered-amount");
+}
+
+/* The buffer can be released after the channel is gone, and another channel
+ * can be allocated at the same address meanwhile, so a weak reference is
+ * kept instead of the pointer */
+typedef struct
+{
+  GWeakRef channel;
+  gsize size;
+} SentBuffer;
+
+static void
+_on_buffer_released (SentBuffer * sent, GstMiniObject * buffer)
+{
+  WebRTCDataChannel *channel;
+
+  if ((channel = g_weak_ref_get (&sent->channel))) {
+    _buffered_amount_sent (channel, sent->size);
+    g_object_unref (channel);
+  }
+
+  g_weak_ref_clear (&sent->channel);
+  g_free (sent);
+}
+
+/* A message stays part of the buffered amount until sctpenc released its
+ * buffer, which happens once the SCTP association accepted all of it into
+ * its send buffer (or when it is dropped on flushing). sctpenc blocks while
+ * that send buffer is full, so the buffered amount follows the actual
+ * congestion of the association instead of dropping as soon as the message
+ * leaves the appsrc */
+static void
+_track_buffer (WebRTCDataChannel * channel, GstBuffer * buffer)
+{
+  SentBuffer *sent = g_new (SentBuffer, 1);
+
+  g_weak_ref_init (&sent->channel, channel);
+  sent->size = gst_buffer_get_size (buffer);
+  gst_mini_object_weak_ref (GST_MINI_OBJECT (buffer),
+      (GstMiniObjectNotify) _on_buffer_released, sent);
+}
+
+static gboolean
+_track_buffer_list_item (GstBuffer ** buffer, guint idx, gpointer user_data)
+{
+  _track_buffer (user_data, *buffer);
+
+  return TRUE;
+}
+
 static GstPadProbeReturn
 on_appsrc_data (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
 {
   WebRTCDataChannel *channel = user_data;
-  guint64 prev_amount;
-  guint64 size = 0;
 
   if (GST_PAD_PROBE_INFO_TYPE (info) & (GST_PAD_PROBE_TYPE_BUFFER)) {
     GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
-    size = gst_buffer_get_size (buffer);
+    _track_buffer (channel, buffer);
   } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
     GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
-    size = gst_buffer_list_calculate_size (list);
+    gst_buffer_list_foreach (list, _track_buffer_list_item, channel);
   } else if (GST_PAD_PROBE_INFO_TYPE (info) &
       GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
     GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
@@ -1061,26 +1131,6 @@ on_appsrc_data (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
     }
   }
 
-  if (size > 0) {
-    GST_WEBRTC_DATA_CHANNEL_LOCK (channel);
-    prev_amount = channel->parent.buffered_amount;
-    channel->parent.buffered_amount -= size;
-    GST_TRACE_OBJECT (channel, "checking low-threshold: prev %"
-        G_GUINT64_FORMAT " low-threshold %" G_GUINT64_FORMAT " buffered %"
-        G_GUINT64_FORMAT, prev_amount,
-        channel->parent.buffered_amount_low_threshold,
-        channel->parent.buffered_amount);
-    if (prev_amount >= channel->parent.buffered_amount_low_threshold
-        && channel->parent.buffered_amount <=
-        channel->parent.buffered_amount_low_threshold) {
-      _channel_enqueue_task (channel, (ChannelTask) _emit_low_threshold, NULL,
-          NULL);
-    }
-
-    GST_WEBRTC_DATA_CHANNEL_UNLOCK (channel);
-    g_object_notify (G_OBJECT (&channel->parent), "buffered-amount");
-  }
-
   return GST_PAD_PROBE_OK;
 }
 
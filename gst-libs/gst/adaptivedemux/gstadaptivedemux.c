@@ -1331,6 +1331,7 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
       g_malloc0 (sizeof (guint64) * NUM_LOOKBACK_FRAGMENTS);
   gst_pad_set_element_private (pad, stream);
   stream->qos_earliest_time = GST_CLOCK_TIME_NONE;
+  stream->last_connect_time = GST_CLOCK_TIME_NONE;
 
   g_mutex_lock (&demux->priv->preroll_lock);
   stream->do_block = TRUE;
@@ -2936,7 +2937,17 @@ _uri_handler_probe (GstPad * pad, GstPadProbeInfo * info,
     switch (GST_EVENT_TYPE (ev)) {
       case GST_EVENT_SEGMENT:
         stream->fragment_bytes_downloaded = 0;
+        stream->last_connect_time = GST_CLOCK_TIME_NONE;
         break;
+      case GST_EVENT_CUSTOM_DOWNSTREAM_STICKY:{
+        const GstStructure *s = gst_event_get_structure (ev);
+
+        if (gst_structure_has_name (s, "http-headers")
+            && !gst_structure_get_clock_time (s, "connect-time",
+                &stream->last_connect_time))
+          stream->last_connect_time = GST_CLOCK_TIME_NONE;
+        break;
+      }
       case GST_EVENT_EOS:
       {
         stream->last_download_time =
@@ -4320,7 +4331,10 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
               "fragment-stop-time", GST_TYPE_CLOCK_TIME,
               gst_util_get_timestamp (), "fragment-size", G_TYPE_UINT64,
               stream->download_total_bytes, "fragment-download-time",
-              GST_TYPE_CLOCK_TIME, stream->last_download_time, NULL)));
+              GST_TYPE_CLOCK_TIME, stream->last_download_time,
+              "fragment-first-byte-time", GST_TYPE_CLOCK_TIME,
+              stream->last_latency, "fragment-connect-time",
+              GST_TYPE_CLOCK_TIME, stream->last_connect_time, NULL)));
 
   /* Don't update to the end of the segment if in reverse playback */
   GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
@@ -178,6 +178,9 @@ struct _GstAdaptiveDemuxStream
    * of previous fragment (pre-queue2) */
   GstClockTime last_latency;
   GstClockTime last_download_time;
+  /* connection setup time of the previous fragment as reported by the source
+   * in its http-headers, GST_CLOCK_TIME_NONE if unknown */
+  GstClockTime last_connect_time;
 
   /* Average for the last fragments */
   guint64 moving_bitrate;
@@ -200,8 +200,54 @@ gst_isoff_tfhd_box_parse (GstTfhdBox * tfhd, GstByteReader * reader)
   return TRUE;
 }
 
+static guint
+gst_isoff_trun_sample_record_size (GstTrunFlags flags)
+{
+  guint record_size = 0;
+
+  if (flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT)
+    record_size += 4;
+  if (flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT)
+    record_size += 4;
+  if (flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT)
+    record_size += 4;
+  if (flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
+    record_size += 4;
+
+  return record_size;
+}
+
 static gboolean
-gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
+gst_isoff_trun_sample_parse (GstTrunSample * sample, GstTrunFlags flags,
+    GstByteReader * reader)
+{
+  memset (sample, 0, sizeof (*sample));
+
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &sample->sample_duration))
+    return FALSE;
+
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &sample->sample_size))
+    return FALSE;
+
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &sample->sample_flags))
+    return FALSE;
+
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
+      && !gst_byte_reader_get_uint32_be (reader,
+          &sample->sample_composition_time_offset.u))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* With @in_place the sample records are not copied out but only referenced,
+ * and need to stay valid for as long as the trun is used */
+static gboolean
+gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader,
+    gboolean in_place)
 {
   gint i;
 
@@ -219,10 +265,6 @@ gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
   if (!gst_byte_reader_get_uint32_be (reader, &trun->sample_count))
     return FALSE;
 
-  trun->samples =
-      g_array_sized_new (FALSE, FALSE, sizeof (GstTrunSample),
-      trun->sample_count);
-
   if ((trun->flags & GST_TRUN_FLAGS_DATA_OFFSET_PRESENT) &&
       !gst_byte_reader_get_uint32_be (reader, (guint32 *) & trun->data_offset))
     return FALSE;
@@ -231,24 +273,30 @@ gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
       !gst_byte_reader_get_uint32_be (reader, &trun->first_sample_flags))
     return FALSE;
 
-  for (i = 0; i < trun->sample_count; i++) {
-    GstTrunSample sample = { 0, };
+  trun->sample_record_size = gst_isoff_trun_sample_record_size (trun->flags);
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT) &&
-        !gst_byte_reader_get_uint32_be (reader, &sample.sample_duration))
-      goto error;
+  if (in_place) {
+    guint remaining = gst_byte_reader_get_remaining (reader);
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT) &&
-        !gst_byte_reader_get_uint32_be (reader, &sample.sample_size))
-      goto error;
+    if (trun->sample_record_size > 0 &&
+        trun->sample_count > remaining / trun->sample_record_size)
+      return FALSE;
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) &&
-        !gst_byte_reader_get_uint32_be (reader, &sample.sample_flags))
-      goto error;
+    if (!gst_byte_reader_get_data (reader,
+            trun->sample_count * trun->sample_record_size, &trun->sample_data))
+      return FALSE;
+
+    return TRUE;
+  }
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
-        && !gst_byte_reader_get_uint32_be (reader,
-            &sample.sample_composition_time_offset.u))
+  trun->samples =
+      g_array_sized_new (FALSE, FALSE, sizeof (GstTrunSample),
+      trun->sample_count);
+
+  for (i = 0; i < trun->sample_count; i++) {
+    GstTrunSample sample;
+
+    if (!gst_isoff_trun_sample_parse (&sample, trun->flags, reader))
       goto error;
 
     g_array_append_val (trun->samples, sample);
@@ -261,6 +309,79 @@ error:
   return FALSE;
 }
 
+/**
+ * gst_isoff_trun_box_get_sample:
+ * @trun: a #GstTrunBox
+ * @idx: index of the sample
+ * @sample: (out): the sample
+ *
+ * Gets the @idx-th sample of @trun, decoding it from the referenced data if
+ * the trun was parsed in place.
+ *
+ * Returns: %TRUE if @idx is a valid sample index
+ *
+ * Since: 1.24
+ */
+gboolean
+gst_isoff_trun_box_get_sample (const GstTrunBox * trun, guint idx,
+    GstTrunSample * sample)
+{
+  GstByteReader reader;
+
+  g_return_val_if_fail (trun != NULL, FALSE);
+  g_return_val_if_fail (sample != NULL, FALSE);
+
+  if (idx >= trun->sample_count)
+    return FALSE;
+
+  if (trun->samples) {
+    *sample = g_array_index (trun->samples, GstTrunSample, idx);
+    return TRUE;
+  }
+
+  gst_byte_reader_init (&reader,
+      trun->sample_data ? trun->sample_data +
+      (gsize) idx * trun->sample_record_size : NULL,
+      trun->sample_record_size);
+
+  return gst_isoff_trun_sample_parse (sample, trun->flags, &reader);
+}
+
+/**
+ * gst_isoff_trun_box_get_samples:
+ * @trun: a #GstTrunBox
+ *
+ * Makes sure the samples of @trun are available as an array, decoding them
+ * from the referenced data if the trun was parsed in place.
+ *
+ * Returns: (transfer none) (element-type GstTrunSample): the samples
+ *
+ * Since: 1.24
+ */
+GArray *
+gst_isoff_trun_box_get_samples (GstTrunBox * trun)
+{
+  guint i;
+
+  g_return_val_if_fail (trun != NULL, NULL);
+
+  if (trun->samples)
+    return trun->samples;
+
+  trun->samples =
+      g_array_sized_new (FALSE, FALSE, sizeof (GstTrunSample),
+      trun->sample_count);
+
+  for (i = 0; i < trun->sample_count; i++) {
+    GstTrunSample sample;
+
+    gst_isoff_trun_box_get_sample (trun, i, &sample);
+    g_array_append_val (trun->samples, sample);
+  }
+
+  return trun->samples;
+}
+
 static gboolean
 gst_isoff_tfdt_box_parse (GstTfdtBox * tfdt, GstByteReader * reader)
 {
@@ -402,7 +523,8 @@ gst_isoff_tfrf_box_parse (GstTfrfBox * tfrf, GstByteReader * reader)
 }
 
 static gboolean
-gst_isoff_traf_box_parse (GstTrafBox * traf, GstByteReader * reader)
+gst_isoff_traf_box_parse (GstTrafBox * traf, GstByteReader * reader,
+    gboolean in_place)
 {
   gboolean had_tfhd = FALSE;
 
@@ -447,7 +569,7 @@ gst_isoff_traf_box_parse (GstTrafBox * traf, GstByteReader * reader)
 
         gst_byte_reader_get_sub_reader (reader, &sub_reader,
             size - header_size);
-        if (!gst_isoff_trun_box_parse (&trun, &sub_reader))
+        if (!gst_isoff_trun_box_parse (&trun, &sub_reader, in_place))
           goto error;
 
         g_array_append_val (traf->trun, trun);
@@ -491,16 +613,13 @@ error:
   return FALSE;
 }
 
-GstMoofBox *
-gst_isoff_moof_box_parse (GstByteReader * reader)
+static gboolean
+gst_isoff_moof_box_parse_contents (GstMoofBox * moof, GstByteReader * reader,
+    gboolean in_place)
 {
-  GstMoofBox *moof;
   gboolean had_mfhd = FALSE;
   GstByteReader sub_reader;
 
-
-  INITIALIZE_DEBUG_CATEGORY;
-  moof = g_new0 (GstMoofBox, 1);
   moof->traf = g_array_new (FALSE, FALSE, sizeof (GstTrafBox));
   g_array_set_clear_func (moof->traf,
       (GDestroyNotify) gst_isoff_traf_box_clear);
@@ -512,16 +631,16 @@ gst_isoff_moof_box_parse (GstByteReader * reader)
 
     if (!gst_isoff_parse_box_header (reader, &fourcc, NULL, &header_size,
             &size))
-      goto error;
+      return FALSE;
     if (gst_byte_reader_get_remaining (reader) < size - header_size)
-      goto error;
+      return FALSE;
 
     switch (fourcc) {
       case GST_ISOFF_FOURCC_MFHD:{
         gst_byte_reader_get_sub_reader (reader, &sub_reader,
             size - header_size);
         if (!gst_isoff_mfhd_box_parse (&moof->mfhd, &sub_reader))
-          goto error;
+          return FALSE;
         had_mfhd = TRUE;
         break;
       }
@@ -530,8 +649,8 @@ gst_isoff_moof_box_parse (GstByteReader * reader)
 
         gst_byte_reader_get_sub_reader (reader, &sub_reader,
             size - header_size);
-        if (!gst_isoff_traf_box_parse (&traf, &sub_reader))
-          goto error;
+        if (!gst_isoff_traf_box_parse (&traf, &sub_reader, in_place))
+          return FALSE;
 
         g_array_append_val (moof->traf, traf);
         break;
@@ -542,20 +661,90 @@ gst_isoff_moof_box_parse (GstByteReader * reader)
     }
   }
 
-  if (!had_mfhd)
-    goto error;
+  return had_mfhd;
+}
+
+GstMoofBox *
+gst_isoff_moof_box_parse (GstByteReader * reader)
+{
+  GstMoofBox *moof;
+
+  INITIALIZE_DEBUG_CATEGORY;
+  moof = g_new0 (GstMoofBox, 1);
+
+  if (!gst_isoff_moof_box_parse_contents (moof, reader, FALSE)) {
+    gst_isoff_moof_box_free (moof);
+    return NULL;
+  }
 
   return moof;
+}
 
-error:
-  gst_isoff_moof_box_free (moof);
-  return NULL;
+/**
+ * gst_isoff_moof_box_parse_buffer:
+ * @buffer: a #GstBuffer
+ * @offset: offset of the moof box payload (after the box header) in @buffer
+ * @size: size of the moof box payload
+ *
+ * Parses a moof box in place. Contrary to gst_isoff_moof_box_parse() the trun
+ * sample tables are not copied but only referenced from the memory of
+ * @buffer, which is kept alive by the returned box, and decoded on demand by
+ * gst_isoff_trun_box_get_sample(). The trun samples arrays are %NULL until
+ * gst_isoff_trun_box_get_samples() is called.
+ *
+ * The box is only parsed without a copy if it lies within a single memory of
+ * @buffer. A box spread over several memories is merged into one when it is
+ * mapped, as the trun sample tables have to be contiguous to be referenced.
+ *
+ * Returns: (transfer full) (nullable): the parsed moof box
+ *
+ * Since: 1.24
+ */
+GstMoofBox *
+gst_isoff_moof_box_parse_buffer (GstBuffer * buffer, gsize offset, gsize size)
+{
+  GstMoofBox *moof;
+  GstByteReader reader;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  INITIALIZE_DEBUG_CATEGORY;
+
+  if (offset + size > gst_buffer_get_size (buffer))
+    return NULL;
+
+  moof = g_new0 (GstMoofBox, 1);
+
+  /* Shares the memory with the parent buffer */
+  moof->buffer =
+      gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset, size);
+  if (moof->buffer && gst_buffer_n_memory (moof->buffer) > 1)
+    GST_LOG ("moof box spans %u memories, mapping a merged copy",
+        gst_buffer_n_memory (moof->buffer));
+  if (!moof->buffer || !gst_buffer_map (moof->buffer, &moof->map, GST_MAP_READ)) {
+    gst_clear_buffer (&moof->buffer);
+    gst_isoff_moof_box_free (moof);
+    return NULL;
+  }
+
+  gst_byte_reader_init (&reader, moof->map.data, moof->map.size);
+  if (!gst_isoff_moof_box_parse_contents (moof, &reader, TRUE)) {
+    gst_isoff_moof_box_free (moof);
+    return NULL;
+  }
+
+  return moof;
 }
 
 void
 gst_isoff_moof_box_free (GstMoofBox * moof)
 {
-  g_array_free (moof->traf, TRUE);
+  if (moof->traf)
+    g_array_free (moof->traf, TRUE);
+  if (moof->buffer) {
+    gst_buffer_unmap (moof->buffer, &moof->map);
+    gst_buffer_unref (moof->buffer);
+  }
   g_free (moof);
 }
 
@@ -973,3 +1162,78 @@ done:
   gst_buffer_unmap (buffer, &info);
   return res;
 }
+
+static gboolean
+gst_isoff_sidx_entry_is_key_unit (const GstSidxBoxEntry * entry)
+{
+  /* SAP types 1 to 3 are decodable from the first byte of the subsegment
+   * onwards, higher types need data from before the SAP */
+  return entry->starts_with_sap && entry->sap_type >= 1
+      && entry->sap_type <= 3;
+}
+
+/**
+ * gst_isoff_sidx_box_plan_ranges:
+ * @sidx: a completely parsed #GstSidxBox
+ * @base_offset: offset of the first byte after the sidx box in the indexed
+ *   resource, including the sidx first_offset
+ * @start: start of the time range to plan for, or %GST_CLOCK_TIME_NONE
+ * @stop: end of the time range to plan for, or %GST_CLOCK_TIME_NONE
+ * @mode: which subsegments to include
+ *
+ * Turns the media subsegment references of @sidx overlapping [@start, @stop)
+ * into absolute byte ranges that can be requested directly. With
+ * %GST_ISOFF_SIDX_RANGE_PLAN_KEY_UNITS only subsegments that start with a
+ * decodable stream access point are included, which is what a keyframe-only
+ * trick mode has to download.
+ *
+ * References to other sidx boxes are skipped.
+ *
+ * Returns: (transfer full) (element-type GstSidxRange): the planned ranges in
+ *   presentation order
+ *
+ * Since: 1.24
+ */
+GArray *
+gst_isoff_sidx_box_plan_ranges (const GstSidxBox * sidx, guint64 base_offset,
+    GstClockTime start, GstClockTime stop, GstSidxRangePlanMode mode)
+{
+  GArray *ranges;
+  gint i;
+
+  g_return_val_if_fail (sidx != NULL, NULL);
+
+  INITIALIZE_DEBUG_CATEGORY;
+  ranges = g_array_new (FALSE, FALSE, sizeof (GstSidxRange));
+
+  for (i = 0; i < sidx->entries_count; i++) {
+    const GstSidxBoxEntry *entry = &sidx->entries[i];
+    GstSidxRange range;
+
+    if (entry->ref_type != 0)
+      continue;
+
+    if (GST_CLOCK_TIME_IS_VALID (start) &&
+        GST_CLOCK_TIME_IS_VALID (entry->duration) &&
+        entry->pts + entry->duration <= start)
+      continue;
+
+    if (GST_CLOCK_TIME_IS_VALID (stop) && entry->pts >= stop)
+      break;
+
+    if (mode == GST_ISOFF_SIDX_RANGE_PLAN_KEY_UNITS &&
+        !gst_isoff_sidx_entry_is_key_unit (entry))
+      continue;
+
+    range.entry_index = i;
+    range.offset = base_offset + entry->offset;
+    range.size = entry->size;
+    range.pts = entry->pts;
+    range.duration = entry->duration;
+    g_array_append_val (ranges, range);
+  }
+
+  GST_LOG ("planned %u of %d sidx ranges", ranges->len, sidx->entries_count);
+
+  return ranges;
+}
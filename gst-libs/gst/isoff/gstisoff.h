@@ -154,6 +154,11 @@ typedef struct _GstTrunBox
   gint32 data_offset;
   guint32 first_sample_flags;
   GArray *samples;
+
+  /* Raw per-sample records when parsed in place, NULL otherwise.
+   * Points into the data owned by the GstMoofBox */
+  const guint8 *sample_data;
+  guint sample_record_size;
 } GstTrunBox;
 
 typedef struct _GstTrunSample
@@ -188,14 +193,27 @@ typedef struct _GstMoofBox
 {
   GstMfhdBox mfhd;
   GArray *traf;
+
+  /* Backing data of in-place parsed boxes */
+  GstBuffer *buffer;
+  GstMapInfo map;
 } GstMoofBox;
 
 GST_ISOFF_API
 GstMoofBox * gst_isoff_moof_box_parse (GstByteReader *reader);
 
+GST_ISOFF_API
+GstMoofBox * gst_isoff_moof_box_parse_buffer (GstBuffer *buffer, gsize offset, gsize size);
+
 GST_ISOFF_API
 void gst_isoff_moof_box_free (GstMoofBox *moof);
 
+GST_ISOFF_API
+gboolean gst_isoff_trun_box_get_sample (const GstTrunBox *trun, guint idx, GstTrunSample *sample);
+
+GST_ISOFF_API
+GArray * gst_isoff_trun_box_get_samples (GstTrunBox *trun);
+
 typedef struct _GstTkhdBox
 {
   guint32 track_id;
@@ -294,6 +312,27 @@ GstIsoffParserResult gst_isoff_sidx_parser_parse (GstSidxParser * parser, GstByt
 GST_ISOFF_API
 GstIsoffParserResult gst_isoff_sidx_parser_add_buffer (GstSidxParser * parser, GstBuffer * buf, guint * consumed);
 
+typedef enum
+{
+  GST_ISOFF_SIDX_RANGE_PLAN_ALL,
+  GST_ISOFF_SIDX_RANGE_PLAN_KEY_UNITS
+} GstSidxRangePlanMode;
+
+typedef struct _GstSidxRange
+{
+  guint entry_index;
+
+  /* absolute byte range in the indexed resource */
+  guint64 offset;
+  guint64 size;
+
+  GstClockTime pts;
+  GstClockTime duration;
+} GstSidxRange;
+
+GST_ISOFF_API
+GArray * gst_isoff_sidx_box_plan_ranges (const GstSidxBox * sidx, guint64 base_offset, GstClockTime start, GstClockTime stop, GstSidxRangePlanMode mode);
+
 G_END_DECLS
 
 #endif /* __GST_ISOFF_H__ */
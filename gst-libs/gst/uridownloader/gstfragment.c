@@ -26,6 +26,7 @@
 #include <gst/base/gsttypefindhelper.h>
 #include <gst/base/gstadapter.h>
 #include "gstfragment.h"
+#include "gstfragment_private.h"
 #include "gsturidownloader_debug.h"
 
 #define GST_CAT_DEFAULT uridownloader_debug
@@ -39,16 +40,10 @@ enum
   PROP_DISCONTINOUS,
   PROP_BUFFER,
   PROP_CAPS,
+  PROP_TIMINGS,
   PROP_LAST
 };
 
-struct _GstFragmentPrivate
-{
-  GstBuffer *buffer;
-  GstCaps *caps;
-  GMutex lock;
-};
-
 G_DEFINE_TYPE_WITH_PRIVATE (GstFragment, gst_fragment, G_TYPE_OBJECT);
 
 static void gst_fragment_dispose (GObject * object);
@@ -103,6 +98,10 @@ gst_fragment_get_property (GObject * object,
       g_value_take_boxed (value, gst_fragment_get_caps (fragment));
       break;
 
+    case PROP_TIMINGS:
+      g_value_take_boxed (value, gst_fragment_get_timings (fragment));
+      break;
+
     default:
       /* We don't have any other property... */
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -148,6 +147,18 @@ gst_fragment_class_init (GstFragmentClass * klass)
       g_param_spec_boxed ("caps", "Fragment caps",
           "The caps of the fragment's buffer. (NULL = detect)", GST_TYPE_CAPS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstFragment:timings:
+   *
+   * Timings of the request, see gst_fragment_get_timings().
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_TIMINGS,
+      g_param_spec_boxed ("timings", "Timings",
+          "Connect, first byte and transfer times of the request",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -167,6 +178,10 @@ gst_fragment_init (GstFragment * fragment)
   fragment->completed = FALSE;
   fragment->discontinuous = FALSE;
   fragment->headers = NULL;
+  priv->request_time = 0;
+  priv->connect_time = 0;
+  priv->response_time = 0;
+  priv->first_byte_time = 0;
 }
 
 GstFragment *
@@ -262,6 +277,64 @@ gst_fragment_get_caps (GstFragment * fragment)
   return fragment->priv->caps;
 }
 
+static GstClockTime
+gst_fragment_time_since_request (GstFragment * fragment, guint64 time)
+{
+  GstFragmentPrivate *priv = fragment->priv;
+
+  if (priv->request_time == 0 || time < priv->request_time)
+    return GST_CLOCK_TIME_NONE;
+
+  return time - priv->request_time;
+}
+
+/**
+ * gst_fragment_get_timings:
+ * @fragment: a #GstFragment
+ *
+ * Returns the timings of the request that downloaded @fragment as a
+ * "GstFragmentTimings" structure with these #GstClockTime fields, all
+ * relative to the time the request was issued and %GST_CLOCK_TIME_NONE
+ * when unknown:
+ *
+ * - "connect-time": until the connection was set up. Only known if
+ *   the source element reported it, or if a connection was reused
+ * - "response-time": until the response headers arrived
+ * - "first-byte-time": until the first byte arrived
+ * - "download-time": until the download was complete
+ *
+ * and "transfer-time", the time from the first byte to the end of the
+ * download.
+ *
+ * Returns: (transfer full): the timings of @fragment
+ *
+ * Since: 1.24
+ */
+GstStructure *
+gst_fragment_get_timings (GstFragment * fragment)
+{
+  GstFragmentPrivate *priv;
+  GstClockTime transfer_time = GST_CLOCK_TIME_NONE;
+
+  g_return_val_if_fail (fragment != NULL, NULL);
+
+  priv = fragment->priv;
+  if (priv->first_byte_time != 0 && fragment->download_stop_time != 0
+      && fragment->download_stop_time >= priv->first_byte_time)
+    transfer_time = fragment->download_stop_time - priv->first_byte_time;
+
+  return gst_structure_new ("GstFragmentTimings",
+      "connect-time", GST_TYPE_CLOCK_TIME,
+      gst_fragment_time_since_request (fragment, priv->connect_time),
+      "response-time", GST_TYPE_CLOCK_TIME,
+      gst_fragment_time_since_request (fragment, priv->response_time),
+      "first-byte-time", GST_TYPE_CLOCK_TIME,
+      gst_fragment_time_since_request (fragment, priv->first_byte_time),
+      "download-time", GST_TYPE_CLOCK_TIME,
+      gst_fragment_time_since_request (fragment, fragment->download_stop_time),
+      "transfer-time", GST_TYPE_CLOCK_TIME, transfer_time, NULL);
+}
+
 gboolean
 gst_fragment_add_buffer (GstFragment * fragment, GstBuffer * buffer)
 {
@@ -78,6 +78,9 @@ void gst_fragment_set_caps (GstFragment * fragment, GstCaps * caps);
 GST_URI_DOWNLOADER_API
 GstCaps * gst_fragment_get_caps (GstFragment * fragment);
 
+GST_URI_DOWNLOADER_API
+GstStructure * gst_fragment_get_timings (GstFragment * fragment);
+
 GST_URI_DOWNLOADER_API
 gboolean gst_fragment_add_buffer (GstFragment *fragment, GstBuffer *buffer);
 
@@ -0,0 +1,44 @@
+/* GStreamer
+ * Copyright (C) 2011 Andoni Morales Alastruey <ylatuya@gmail.com>
+ *
+ * gstfragment_private.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GSTFRAGMENT_PRIVATE_H__
+#define __GSTFRAGMENT_PRIVATE_H__
+
+#include "gstfragment.h"
+
+G_BEGIN_DECLS
+
+struct _GstFragmentPrivate
+{
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GMutex lock;
+
+  /* Request timings, in gst_util_get_timestamp() time (monotonic, not epoch),
+   * 0 if unknown. Exposed through gst_fragment_get_timings() */
+  guint64 request_time;         /* When the request was issued */
+  guint64 connect_time;         /* When the connection was set up */
+  guint64 response_time;        /* When the response headers arrived */
+  guint64 first_byte_time;      /* When the first byte arrived */
+};
+
+G_END_DECLS
+#endif /* __GSTFRAGMENT_PRIVATE_H__ */
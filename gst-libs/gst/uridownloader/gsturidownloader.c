@@ -24,16 +24,32 @@
 
 #include <glib.h>
 #include "gstfragment.h"
+#include "gstfragment_private.h"
 #include "gsturidownloader.h"
 #include "gsturidownloader_debug.h"
 
 #define GST_CAT_DEFAULT uridownloader_debug
 GST_DEBUG_CATEGORY (uridownloader_debug);
 
+/* Maximum number of parked source elements kept around per downloader. Each
+ * one holds on to its persistent (keep-alive / TLS) connection to one
+ * origin, so that alternating between e.g. a manifest host and a CDN host
+ * does not force a reconnection on every request */
+#define MAX_IDLE_SOURCES 4
+
+typedef struct
+{
+  GstElement *urisrc;
+  gchar *origin;
+} GstUriDownloaderIdleSource;
+
 struct _GstUriDownloaderPrivate
 {
   /* Fragments fetcher */
   GstElement *urisrc;
+  gchar *origin;                /* scheme://host:port of urisrc */
+  gboolean reused_src;          /* urisrc served a request before */
+  GQueue idle_sources;          /* GstUriDownloaderIdleSource, most recent first */
   GstBus *bus;
   GstPad *pad;
   GstFragment *download;
@@ -61,6 +77,8 @@ static GstBusSyncReply gst_uri_downloader_bus_handler (GstBus * bus,
 static gboolean gst_uri_downloader_ensure_src (GstUriDownloader * downloader,
     const gchar * uri);
 static void gst_uri_downloader_destroy_src (GstUriDownloader * downloader);
+static void gst_uri_downloader_clear_idle_sources (GstUriDownloader *
+    downloader);
 
 static GstStaticPadTemplate sinkpadtemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -116,6 +134,7 @@ gst_uri_downloader_dispose (GObject * object)
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
   gst_uri_downloader_destroy_src (downloader);
+  gst_uri_downloader_clear_idle_sources (downloader);
 
   if (downloader->priv->bus != NULL) {
     gst_object_unref (downloader->priv->bus);
@@ -175,6 +194,20 @@ gst_uri_downloader_set_parent (GstUriDownloader * downloader,
   g_weak_ref_set (&downloader->priv->parent, parent);
 }
 
+/* Takes the connection setup time from the "connect-time" field that some
+ * sources (e.g. curlhttpsrc) add to their http-headers */
+static void
+gst_uri_downloader_update_connect_time (GstFragment * download,
+    const GstStructure * headers)
+{
+  GstClockTime connect_time;
+
+  if (download->priv->request_time != 0
+      && gst_structure_get_clock_time (headers, "connect-time", &connect_time)
+      && GST_CLOCK_TIME_IS_VALID (connect_time))
+    download->priv->connect_time = download->priv->request_time + connect_time;
+}
+
 static gboolean
 gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event)
@@ -209,6 +242,11 @@ gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
           if (downloader->priv->download->headers)
             gst_structure_free (downloader->priv->download->headers);
           downloader->priv->download->headers = gst_structure_copy (str);
+          if (downloader->priv->download->priv->response_time == 0)
+            downloader->priv->download->priv->response_time =
+                gst_util_get_timestamp ();
+          gst_uri_downloader_update_connect_time (downloader->priv->download,
+              str);
         }
         GST_OBJECT_UNLOCK (downloader);
       }
@@ -306,6 +344,22 @@ gst_uri_downloader_bus_handler (GstBus * bus,
     }
     if (parent)
       gst_object_unref (parent);
+  } else if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_HAVE_CONTEXT) {
+    GstElement *parent = g_weak_ref_get (&downloader->priv->parent);
+
+    /* Sources like souphttpsrc announce their HTTP session this way. Hand it
+     * over to the parent so that it ends up in the main pipeline and gets
+     * shared with all other sources, which then reuse the same persistent
+     * connections and TLS sessions */
+    if (parent) {
+      GstContext *context;
+
+      gst_message_parse_have_context (message, &context);
+      gst_element_set_context (parent, context);
+      gst_element_post_message (parent,
+          gst_message_new_have_context (GST_OBJECT_CAST (parent), context));
+      gst_object_unref (parent);
+    }
   }
 
   gst_message_unref (message);
@@ -333,6 +387,9 @@ gst_uri_downloader_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   GST_LOG_OBJECT (downloader, "The uri fetcher received a new buffer "
       "of size %" G_GSIZE_FORMAT, gst_buffer_get_size (buf));
+  if (!downloader->priv->got_buffer)
+    downloader->priv->download->priv->first_byte_time =
+        gst_util_get_timestamp ();
   downloader->priv->got_buffer = TRUE;
   if (!gst_fragment_add_buffer (downloader->priv->download, buf)) {
     GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
@@ -397,36 +454,127 @@ gst_uri_downloader_set_range (GstUriDownloader * downloader,
   return TRUE;
 }
 
+/* Returns the scheme://host:port of @uri, which identifies the persistent
+ * connection a source element holds after a download */
+static gchar *
+gst_uri_downloader_get_origin (const gchar * uri)
+{
+  GstUri *gst_uri;
+  gchar *origin;
+
+  gst_uri = gst_uri_from_string (uri);
+  if (!gst_uri)
+    return gst_uri_get_protocol (uri);
+
+  origin = g_strdup_printf ("%s://%s:%u", gst_uri_get_scheme (gst_uri),
+      GST_STR_NULL (gst_uri_get_host (gst_uri)), gst_uri_get_port (gst_uri));
+  gst_uri_unref (gst_uri);
+
+  return origin;
+}
+
+static void
+gst_uri_downloader_idle_source_free (GstUriDownloaderIdleSource * idle)
+{
+  gst_element_set_state (idle->urisrc, GST_STATE_NULL);
+  gst_object_unref (idle->urisrc);
+  g_free (idle->origin);
+  g_free (idle);
+}
+
+static void
+gst_uri_downloader_clear_idle_sources (GstUriDownloader * downloader)
+{
+  GstUriDownloaderIdleSource *idle;
+
+  while ((idle = g_queue_pop_head (&downloader->priv->idle_sources)))
+    gst_uri_downloader_idle_source_free (idle);
+}
+
+/* Parks the current source element so that its connection can be picked up
+ * again by a later request to the same origin */
+static void
+gst_uri_downloader_park_src (GstUriDownloader * downloader)
+{
+  GstUriDownloaderIdleSource *idle;
+
+  if (!downloader->priv->urisrc)
+    return;
+
+  idle = g_new0 (GstUriDownloaderIdleSource, 1);
+  idle->urisrc = downloader->priv->urisrc;
+  idle->origin = downloader->priv->origin;
+  downloader->priv->urisrc = NULL;
+  downloader->priv->origin = NULL;
+
+  GST_DEBUG_OBJECT (downloader, "Parking source element for %s",
+      idle->origin);
+  g_queue_push_head (&downloader->priv->idle_sources, idle);
+
+  while (g_queue_get_length (&downloader->priv->idle_sources) >
+      MAX_IDLE_SOURCES) {
+    idle = g_queue_pop_tail (&downloader->priv->idle_sources);
+    GST_DEBUG_OBJECT (downloader, "Dropping idle source element for %s",
+        idle->origin);
+    gst_uri_downloader_idle_source_free (idle);
+  }
+}
+
+/* Takes back a parked source element connected to @origin, if any */
+static gboolean
+gst_uri_downloader_unpark_src (GstUriDownloader * downloader,
+    const gchar * origin)
+{
+  GList *l;
+
+  for (l = downloader->priv->idle_sources.head; l; l = l->next) {
+    GstUriDownloaderIdleSource *idle = l->data;
+
+    if (g_strcmp0 (idle->origin, origin) == 0) {
+      g_queue_delete_link (&downloader->priv->idle_sources, l);
+      downloader->priv->urisrc = idle->urisrc;
+      downloader->priv->origin = idle->origin;
+      g_free (idle);
+      GST_DEBUG_OBJECT (downloader, "Re-using parked source element for %s",
+          origin);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 static gboolean
 gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
 {
-  if (downloader->priv->urisrc) {
-    gchar *old_protocol, *new_protocol;
-    gchar *old_uri;
+  gchar *origin;
+
+  origin = gst_uri_downloader_get_origin (uri);
+  downloader->priv->reused_src = FALSE;
+
+  if (downloader->priv->urisrc
+      && g_strcmp0 (downloader->priv->origin, origin) != 0) {
+    GST_DEBUG_OBJECT (downloader, "Origin changed from %s to %s",
+        downloader->priv->origin, origin);
+    gst_uri_downloader_park_src (downloader);
+  }
 
-    old_uri =
-        gst_uri_handler_get_uri (GST_URI_HANDLER (downloader->priv->urisrc));
-    old_protocol = gst_uri_get_protocol (old_uri);
-    new_protocol = gst_uri_get_protocol (uri);
+  if (!downloader->priv->urisrc)
+    gst_uri_downloader_unpark_src (downloader, origin);
+
+  if (downloader->priv->urisrc) {
+    GError *err = NULL;
 
-    if (!g_str_equal (old_protocol, new_protocol)) {
+    GST_DEBUG_OBJECT (downloader, "Re-using old source element");
+    if (!gst_uri_handler_set_uri
+        (GST_URI_HANDLER (downloader->priv->urisrc), uri, &err)) {
+      GST_DEBUG_OBJECT (downloader,
+          "Failed to re-use old source element: %s", err->message);
+      g_clear_error (&err);
       gst_uri_downloader_destroy_src (downloader);
-      GST_DEBUG_OBJECT (downloader, "Can't re-use old source element");
     } else {
-      GError *err = NULL;
-
-      GST_DEBUG_OBJECT (downloader, "Re-using old source element");
-      if (!gst_uri_handler_set_uri
-          (GST_URI_HANDLER (downloader->priv->urisrc), uri, &err)) {
-        GST_DEBUG_OBJECT (downloader,
-            "Failed to re-use old source element: %s", err->message);
-        g_clear_error (&err);
-        gst_uri_downloader_destroy_src (downloader);
-      }
+      downloader->priv->reused_src = TRUE;
     }
-    g_free (old_uri);
-    g_free (old_protocol);
-    g_free (new_protocol);
   }
 
   if (!downloader->priv->urisrc) {
@@ -443,6 +591,13 @@ gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
     }
   }
 
+  if (downloader->priv->urisrc) {
+    g_free (downloader->priv->origin);
+    downloader->priv->origin = origin;
+  } else {
+    g_free (origin);
+  }
+
   return downloader->priv->urisrc != NULL;
 }
 
@@ -455,6 +610,8 @@ gst_uri_downloader_destroy_src (GstUriDownloader * downloader)
   gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
   gst_object_unref (downloader->priv->urisrc);
   downloader->priv->urisrc = NULL;
+  g_free (downloader->priv->origin);
+  downloader->priv->origin = NULL;
 }
 
 static gboolean
@@ -607,6 +764,12 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     }
   }
 
+  downloader->priv->download->priv->request_time = gst_util_get_timestamp ();
+  /* the connection of a reused source is usually still open, replaced by
+   * the actual connect time if the source reports it */
+  if (downloader->priv->reused_src)
+    downloader->priv->download->priv->connect_time =
+        downloader->priv->download->priv->request_time;
   GST_OBJECT_UNLOCK (downloader);
   ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_PLAYING);
   GST_OBJECT_LOCK (downloader);
@@ -652,9 +815,13 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     }
   }
 
-  if (download != NULL)
+  if (download != NULL) {
+    GstStructure *timings = gst_fragment_get_timings (download);
+
     GST_INFO_OBJECT (downloader, "URI fetched successfully");
-  else
+    GST_DEBUG_OBJECT (downloader, "Timings %" GST_PTR_FORMAT, timings);
+    gst_structure_free (timings);
+  } else
     GST_INFO_OBJECT (downloader, "Error fetching URI");
 
 quit:
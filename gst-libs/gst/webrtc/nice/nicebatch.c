@@ -0,0 +1,220 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* for sendmmsg() */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "nicebatch.h"
+
+#ifdef HAVE_SENDMMSG
+#include <errno.h>
+#include <string.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+#define GST_CAT_DEFAULT gst_webrtc_nice_batch_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+/* Datagrams passed to one sendmmsg() call */
+#define BATCH_SIZE 64
+/* Limits of one UDP_SEGMENT send: the kernel refuses more than 64 segments
+ * and the payload has to fit into a single UDP datagram */
+#define GSO_MAX_SEGMENTS 64
+#define GSO_MAX_BYTES 65000
+
+typedef union
+{
+  struct cmsghdr hdr;
+  guint8 buf[CMSG_SPACE (sizeof (guint16))];
+} BatchControl;
+
+/* Fills @msgs with the datagrams of @iov starting at @first, merging runs of
+ * equally sized datagrams into one segmented send when @gso is set. Only the
+ * last segment of a run may be shorter. Returns the number of messages,
+ * @msg_first receives the index of the first datagram of each */
+static guint
+_build_batch_messages (GstWebRTCNiceBatchTarget * target, struct iovec *iov,
+    guint first, guint n_iov, gboolean gso, struct mmsghdr *msgs,
+    guint * msg_first, BatchControl * controls)
+{
+  guint n_msgs = 0, i = first;
+
+  while (i < n_iov) {
+    struct msghdr *hdr = &msgs[n_msgs].msg_hdr;
+    gsize segment_size = iov[i].iov_len, total = iov[i].iov_len;
+    guint j = i + 1;
+
+    if (gso) {
+      while (j < n_iov && j - i < GSO_MAX_SEGMENTS
+          && iov[j].iov_len <= segment_size
+          && total + iov[j].iov_len <= GSO_MAX_BYTES) {
+        total += iov[j].iov_len;
+        /* a shorter segment ends the run */
+        if (iov[j++].iov_len < segment_size)
+          break;
+      }
+    }
+
+    memset (&msgs[n_msgs], 0, sizeof (msgs[n_msgs]));
+    hdr->msg_name = &target->addr;
+    hdr->msg_namelen = target->addr_len;
+    hdr->msg_iov = &iov[i];
+    hdr->msg_iovlen = j - i;
+
+#ifdef __linux__
+    if (j - i > 1) {
+      struct cmsghdr *cmsg;
+
+      hdr->msg_control = controls[n_msgs].buf;
+      hdr->msg_controllen = sizeof (controls[n_msgs].buf);
+      cmsg = CMSG_FIRSTHDR (hdr);
+      cmsg->cmsg_level = IPPROTO_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN (sizeof (guint16));
+      *(guint16 *) CMSG_DATA (cmsg) = segment_size;
+    }
+#endif
+
+    msg_first[n_msgs++] = i;
+    i = j;
+  }
+
+  return n_msgs;
+}
+
+/* Sends up to BATCH_SIZE datagrams with as few syscalls as possible. Each
+ * datagram is sent whole or not at all, so a short count from sendmmsg()
+ * only means that the remaining messages have to be sent again. */
+static void
+_send_batch (GstObject * obj, GstWebRTCNiceBatchTarget * target,
+    struct iovec *iov, guint n_iov)
+{
+  struct mmsghdr msgs[BATCH_SIZE];
+  guint msg_first[BATCH_SIZE + 1];
+  BatchControl controls[BATCH_SIZE];
+  gint fd = g_socket_get_fd (target->socket);
+  guint n_msgs, sent = 0;
+
+  n_msgs = _build_batch_messages (target, iov, 0, n_iov, target->gso,
+      msgs, msg_first, controls);
+  msg_first[n_msgs] = n_iov;
+
+  while (sent < n_msgs) {
+    gint ret = sendmmsg (fd, &msgs[sent], n_msgs - sent, 0);
+
+    if (ret > 0) {
+      sent += ret;
+      continue;
+    }
+
+    if (errno == EINTR)
+      continue;
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      /* a blocking socket waits for room like g_socket_send() would,
+       * otherwise datagrams that don't fit are lost, as with libnice */
+      if (g_socket_get_blocking (target->socket)
+          && g_socket_condition_wait (target->socket, G_IO_OUT, NULL, NULL))
+        continue;
+
+      GST_LOG_OBJECT (obj, "send buffer full, dropping %u datagrams",
+          n_iov - msg_first[sent]);
+      return;
+    }
+
+    if (msgs[sent].msg_hdr.msg_controllen != 0 && (errno == EIO
+            || errno == EINVAL || errno == ENOPROTOOPT
+            || errno == EOPNOTSUPP)) {
+      /* no segmentation offload for this socket or device, send the
+       * remaining datagrams one by one */
+      GST_INFO_OBJECT (obj, "UDP segmentation offload not available: %s",
+          g_strerror (errno));
+      target->gso = FALSE;
+      n_msgs = _build_batch_messages (target, iov, msg_first[sent], n_iov,
+          FALSE, msgs, msg_first, controls);
+      msg_first[n_msgs] = n_iov;
+      sent = 0;
+      continue;
+    }
+
+    /* e.g. ICMP errors of previous sends, skip the failed message */
+    GST_DEBUG_OBJECT (obj, "failed to send datagrams: %s", g_strerror (errno));
+    sent++;
+  }
+}
+
+/*
+ * gst_webrtc_nice_batch_send_list:
+ * @obj: (nullable): the object to log for
+ * @target: where to send the datagrams
+ * @list: the datagrams to send, one per buffer
+ *
+ * Sends the buffers of @list as datagrams, in order, to @target with
+ * sendmmsg() and UDP segmentation offload. @target->gso is cleared if the
+ * kernel rejected the offload, the datagrams are then sent one by one.
+ */
+void
+gst_webrtc_nice_batch_send_list (GstObject * obj,
+    GstWebRTCNiceBatchTarget * target, GstBufferList * list)
+{
+  GstBuffer *bufs[BATCH_SIZE];
+  GstMapInfo maps[BATCH_SIZE];
+  struct iovec iov[BATCH_SIZE];
+  guint i, len, n_iov = 0;
+  static gsize debug_init = 0;
+
+  if (g_once_init_enter (&debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_webrtc_nice_batch_debug, "webrtcnicebatch",
+        0, "webrtcnicebatch");
+    g_once_init_leave (&debug_init, 1);
+  }
+
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++) {
+    bufs[n_iov] = gst_buffer_list_get (list, i);
+
+    if (gst_buffer_map (bufs[n_iov], &maps[n_iov], GST_MAP_READ)) {
+      iov[n_iov].iov_base = maps[n_iov].data;
+      iov[n_iov].iov_len = maps[n_iov].size;
+      n_iov++;
+    } else {
+      GST_WARNING_OBJECT (obj, "failed to map buffer %u of list", i);
+    }
+
+    if (n_iov > 0 && (n_iov == BATCH_SIZE || i == len - 1)) {
+      guint k;
+
+      _send_batch (obj, target, iov, n_iov);
+      for (k = 0; k < n_iov; k++)
+        gst_buffer_unmap (bufs[k], &maps[k]);
+      n_iov = 0;
+    }
+  }
+}
+#endif
@@ -0,0 +1,49 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_WEBRTC_NICE_BATCH_H__
+#define __GST_WEBRTC_NICE_BATCH_H__
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+
+#ifdef HAVE_SENDMMSG
+#include <sys/socket.h>
+
+G_BEGIN_DECLS
+
+/* Destination of a batched send, copied out of the transport so that the
+ * syscalls are made without holding its lock */
+typedef struct
+{
+  GSocket *socket;
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+  /* cleared once the kernel rejected UDP segmentation offload */
+  gboolean gso;
+} GstWebRTCNiceBatchTarget;
+
+G_GNUC_INTERNAL
+void gst_webrtc_nice_batch_send_list (GstObject * obj,
+                                      GstWebRTCNiceBatchTarget * target,
+                                      GstBufferList * list);
+
+G_END_DECLS
+
+#endif /* HAVE_SENDMMSG */
+#endif /* __GST_WEBRTC_NICE_BATCH_H__ */
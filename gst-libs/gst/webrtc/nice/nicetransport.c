@@ -23,6 +23,12 @@
 
 #include "nicestream.h"
 #include "nicetransport.h"
+#include "nicebatch.h"
+
+#ifdef HAVE_SENDMMSG
+#include <string.h>
+#include <netinet/in.h>
+#endif
 
 #define GST_CAT_DEFAULT gst_webrtc_nice_transport_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -51,6 +57,18 @@ struct _GstWebRTCNiceTransportPrivate
   gint receive_buffer_size;
   gulong on_new_selected_pair_id;
   gulong on_component_state_changed_id;
+
+#ifdef HAVE_SENDMMSG
+  /* protects the batched send state below */
+  GMutex batch_lock;
+  /* socket and peer of the selected pair if it can be written to directly,
+   * NULL if buffer lists go through libnice */
+  GSocket *batch_socket;
+  struct sockaddr_storage batch_addr;
+  socklen_t batch_addr_len;
+  /* cleared once the kernel rejected UDP segmentation offload */
+  gboolean batch_gso;
+#endif
 };
 
 #define gst_webrtc_nice_transport_parent_class parent_class
@@ -185,6 +203,11 @@ gst_webrtc_nice_transport_finalize (GObject * object)
 
   gst_object_unref (nice->stream);
 
+#ifdef HAVE_SENDMMSG
+  g_clear_object (&nice->priv->batch_socket);
+  g_mutex_clear (&nice->priv->batch_lock);
+#endif
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -240,6 +263,91 @@ gst_webrtc_nice_transport_update_buffer_size (GstWebRTCNiceTransport * nice)
   gst_object_unref (webrtc_ice);
 }
 
+#ifdef HAVE_SENDMMSG
+/* Called from the libnice context when a pair got selected. Buffer lists are
+ * written to the socket of the pair directly if it is a plain UDP one, i.e.
+ * neither TCP nor relayed through TURN, which libnice has to frame itself. */
+static void
+_update_batch_send (GstWebRTCNiceTransport * nice, NiceAgent * agent,
+    guint stream_id, guint component, NiceCandidate * lcandidate,
+    NiceCandidate * rcandidate)
+{
+  GSocket *socket = NULL;
+
+  if (lcandidate->transport == NICE_CANDIDATE_TRANSPORT_UDP
+      && lcandidate->type != NICE_CANDIDATE_TYPE_RELAYED)
+    socket = nice_agent_get_selected_socket (agent, stream_id, component);
+
+  g_mutex_lock (&nice->priv->batch_lock);
+  g_clear_object (&nice->priv->batch_socket);
+  if (socket) {
+    memset (&nice->priv->batch_addr, 0, sizeof (nice->priv->batch_addr));
+    nice_address_copy_to_sockaddr (&rcandidate->addr,
+        (struct sockaddr *) &nice->priv->batch_addr);
+    nice->priv->batch_addr_len =
+        nice_address_ip_version (&rcandidate->addr) == 6 ?
+        sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in);
+    nice->priv->batch_socket = socket;
+    GST_DEBUG_OBJECT (nice, "sending buffer lists on fd %d directly",
+        g_socket_get_fd (socket));
+  } else {
+    GST_DEBUG_OBJECT (nice, "sending buffer lists through libnice");
+  }
+  g_mutex_unlock (&nice->priv->batch_lock);
+}
+
+static void
+_clear_batch_send (GstWebRTCNiceTransport * nice)
+{
+  g_mutex_lock (&nice->priv->batch_lock);
+  g_clear_object (&nice->priv->batch_socket);
+  g_mutex_unlock (&nice->priv->batch_lock);
+}
+
+/* Writes the buffer lists reaching nicesink to the socket of the selected
+ * pair with sendmmsg() and UDP segmentation offload. Lists that can't take
+ * this path are passed on to nicesink. */
+static GstPadProbeReturn
+_nicesink_buffer_list_probe (GstPad * pad, GstPadProbeInfo * info,
+    GWeakRef * nice_weak)
+{
+  GstWebRTCNiceTransport *nice = g_weak_ref_get (nice_weak);
+  GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+  GstWebRTCNiceBatchTarget target;
+
+  if (!nice)
+    return GST_PAD_PROBE_REMOVE;
+
+  /* the socket is kept alive by our ref if the pair changes meanwhile */
+  g_mutex_lock (&nice->priv->batch_lock);
+  if (!nice->priv->batch_socket) {
+    g_mutex_unlock (&nice->priv->batch_lock);
+    gst_object_unref (nice);
+    return GST_PAD_PROBE_OK;
+  }
+  target.socket = g_object_ref (nice->priv->batch_socket);
+  target.addr = nice->priv->batch_addr;
+  target.addr_len = nice->priv->batch_addr_len;
+  target.gso = nice->priv->batch_gso;
+  g_mutex_unlock (&nice->priv->batch_lock);
+
+  gst_webrtc_nice_batch_send_list (GST_OBJECT (nice), &target, list);
+  g_object_unref (target.socket);
+
+  if (!target.gso) {
+    g_mutex_lock (&nice->priv->batch_lock);
+    nice->priv->batch_gso = FALSE;
+    g_mutex_unlock (&nice->priv->batch_lock);
+  }
+
+  gst_buffer_list_unref (list);
+  GST_PAD_PROBE_INFO_DATA (info) = NULL;
+  gst_object_unref (nice);
+
+  return GST_PAD_PROBE_HANDLED;
+}
+#endif
+
 
 static void
 _on_new_selected_pair (NiceAgent * agent, guint stream_id,
@@ -263,6 +371,11 @@ _on_new_selected_pair (NiceAgent * agent, guint stream_id,
   if (comp != ice->component)
     goto cleanup;
 
+#ifdef HAVE_SENDMMSG
+  _update_batch_send (nice, agent, stream_id, component, lcandidate,
+      rcandidate);
+#endif
+
   gst_webrtc_ice_transport_selected_pair_change (ice);
 
 cleanup:
@@ -293,6 +406,14 @@ _on_component_state_changed (NiceAgent * agent, guint stream_id,
   GST_DEBUG_OBJECT (ice, "%u %u %s", stream_id, component,
       nice_component_state_to_string (state));
 
+#ifdef HAVE_SENDMMSG
+  /* the selected pair is gone, a new one will be announced */
+  if (state == NICE_COMPONENT_STATE_DISCONNECTED
+      || state == NICE_COMPONENT_STATE_GATHERING
+      || state == NICE_COMPONENT_STATE_FAILED)
+    _clear_batch_send (nice);
+#endif
+
   gst_webrtc_ice_transport_connection_state_change (ice,
       _nice_component_state_to_gst (state));
 
@@ -359,6 +480,16 @@ gst_webrtc_nice_transport_constructed (GObject * object)
     g_object_set (ice->sink, "agent", agent, "stream", our_stream_id,
         "component", component, "async", FALSE, "enable-last-sample", FALSE,
         "sync", FALSE, NULL);
+#ifdef HAVE_SENDMMSG
+    {
+      GstPad *pad = gst_element_get_static_pad (ice->sink, "sink");
+
+      gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER_LIST,
+          (GstPadProbeCallback) _nicesink_buffer_list_probe, weak_new (nice),
+          (GDestroyNotify) weak_free);
+      gst_object_unref (pad);
+    }
+#endif
   }
 
   g_object_unref (agent);
@@ -415,6 +546,13 @@ static void
 gst_webrtc_nice_transport_init (GstWebRTCNiceTransport * nice)
 {
   nice->priv = gst_webrtc_nice_transport_get_instance_private (nice);
+
+#ifdef HAVE_SENDMMSG
+  g_mutex_init (&nice->priv->batch_lock);
+#ifdef __linux__
+  nice->priv->batch_gso = TRUE;
+#endif
+#endif
 }
 
 GstWebRTCNiceTransport *
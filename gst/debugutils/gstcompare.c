@@ -24,6 +24,7 @@
 #include "config.h"
 #endif
 #include <string.h>
+#include <math.h>
 
 #include <gst/gst.h>
 #include <gst/base/gstcollectpads.h>
@@ -56,7 +57,8 @@ enum GstCompareMethod
 {
   GST_COMPARE_METHOD_MEM,
   GST_COMPARE_METHOD_MAX,
-  GST_COMPARE_METHOD_SSIM
+  GST_COMPARE_METHOD_SSIM,
+  GST_COMPARE_METHOD_PSNR
 };
 
 #define GST_COMPARE_METHOD_TYPE (gst_compare_method_get_type())
@@ -69,6 +71,7 @@ gst_compare_method_get_type (void)
     {GST_COMPARE_METHOD_MEM, "Memory", "mem"},
     {GST_COMPARE_METHOD_MAX, "Maximum metric", "max"},
     {GST_COMPARE_METHOD_SSIM, "SSIM (raw video)", "ssim"},
+    {GST_COMPARE_METHOD_PSNR, "PSNR (raw video)", "psnr"},
     {0, NULL, NULL}
   };
 
@@ -92,7 +95,9 @@ enum
   PROP_OFFSET_TS,
   PROP_METHOD,
   PROP_THRESHOLD,
-  PROP_UPPER
+  PROP_UPPER,
+  PROP_N_THREADS,
+  PROP_POST_RESULTS
 };
 
 #define DEFAULT_META             GST_BUFFER_COPY_ALL
@@ -100,6 +105,8 @@ enum
 #define DEFAULT_METHOD           GST_COMPARE_METHOD_MEM
 #define DEFAULT_THRESHOLD        0
 #define DEFAULT_UPPER            TRUE
+#define DEFAULT_N_THREADS        1
+#define DEFAULT_POST_RESULTS     FALSE
 
 static void gst_compare_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
@@ -172,6 +179,42 @@ gst_compare_class_init (GstCompareClass * klass)
           "Whether threshold value is upper bound or lower bound for difference measure",
           DEFAULT_UPPER, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompare:n-threads:
+   *
+   * Number of threads computing the SSIM and PSNR of a frame in parallel,
+   * 0 to use one per processor. Takes effect when going from READY to
+   * PAUSED.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads comparing video frames (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompare:post-results:
+   *
+   * Post an element message named "GstCompareResult" for each compared
+   * buffer, with its "timestamp" and the "delta" of the content method.
+   * With the ssim and psnr methods it also contains the "ssim" and "psnr" of
+   * the frame and arrays of the values of each component in the
+   * "ssim-components" and "psnr-components" fields. The PSNR is in dB and
+   * 100 for identical content.
+   *
+   * Independently of this, a "GstCompareSummary" message with the number of
+   * compared and failed buffers and the average, minimum and maximum values
+   * is posted at EOS.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_POST_RESULTS,
+      g_param_spec_boolean ("post-results", "Post results",
+          "Post a message with the result of each comparison",
+          DEFAULT_POST_RESULTS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -215,6 +258,9 @@ gst_compare_init (GstCompare * comp)
   comp->method = DEFAULT_METHOD;
   comp->threshold = DEFAULT_THRESHOLD;
   comp->upper = DEFAULT_UPPER;
+  comp->n_threads = DEFAULT_N_THREADS;
+  comp->post_results = DEFAULT_POST_RESULTS;
+  comp->n_jobs = 1;
 
   gst_compare_reset (comp);
 }
@@ -222,6 +268,16 @@ gst_compare_init (GstCompare * comp)
 static void
 gst_compare_reset (GstCompare * comp)
 {
+  comp->n_frames = 0;
+  comp->n_failed = 0;
+  comp->n_video = 0;
+  comp->delta_sum = 0;
+  comp->delta_min = 0;
+  comp->delta_max = 0;
+  comp->ssim_sum = 0;
+  comp->ssim_min = 0;
+  comp->psnr_sum = 0;
+  comp->psnr_min = 0;
 }
 
 static gboolean
@@ -351,11 +407,165 @@ gst_compare_max (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
   return delta;
 }
 
-static double
-gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
-    gint width, gint height, gint step, gint stride)
+/* Sums over a block of 8x8 pixels, the 16x16 SSIM windows overlapping by
+ * half a window are made of 2x2 blocks, so each pixel is only read once */
+#define BLOCK_SIZE 8
+
+typedef struct
+{
+  gint sum1, sum2, ssum1, ssum2, acov, count;
+} GstCompareBlock;
+
+/* Computes the blocks of the block rows first_row to last_row (excluded) */
+typedef struct
+{
+  const guint8 *data1, *data2;
+  gint width, height, step, stride;
+  GstCompareBlock *blocks;
+  gint blocks_per_row;
+  gint first_row, last_row;
+} GstCompareBlocksJob;
+
+static inline void
+gst_compare_block_add_row (GstCompareBlock * block, const guint8 * data1,
+    const guint8 * data2, gint width, gint step)
+{
+  gint sum1 = 0, sum2 = 0, ssum1 = 0, ssum2 = 0, acov = 0, i;
+
+  /* kept free of dependencies between iterations for the vectorizer */
+  if (step == 1 && width == BLOCK_SIZE) {
+    for (i = 0; i < BLOCK_SIZE; i++) {
+      gint p1 = data1[i], p2 = data2[i];
+
+      sum1 += p1;
+      sum2 += p2;
+      ssum1 += p1 * p1;
+      ssum2 += p2 * p2;
+      acov += p1 * p2;
+    }
+  } else {
+    for (i = 0; i < width; i++) {
+      gint p1 = data1[i * step], p2 = data2[i * step];
+
+      sum1 += p1;
+      sum2 += p2;
+      ssum1 += p1 * p1;
+      ssum2 += p2 * p2;
+      acov += p1 * p2;
+    }
+  }
+
+  block->sum1 += sum1;
+  block->sum2 += sum2;
+  block->ssum1 += ssum1;
+  block->ssum2 += ssum2;
+  block->acov += acov;
+  block->count += width;
+}
+
+static void
+gst_compare_blocks_run (gpointer data, gpointer user_data)
+{
+  GstCompareBlocksJob *job = data;
+  gint bx, by, y;
+
+  for (by = job->first_row; by < job->last_row; by++) {
+    GstCompareBlock *row = job->blocks + by * job->blocks_per_row;
+    gint y_end = MIN ((by + 1) * BLOCK_SIZE, job->height);
+
+    memset (row, 0, job->blocks_per_row * sizeof (GstCompareBlock));
+
+    for (y = by * BLOCK_SIZE; y < y_end; y++) {
+      const guint8 *line1 = job->data1 + y * job->stride;
+      const guint8 *line2 = job->data2 + y * job->stride;
+
+      for (bx = 0; bx < job->blocks_per_row; bx++) {
+        gint x = bx * BLOCK_SIZE;
+
+        gst_compare_block_add_row (&row[bx], line1 + x * job->step,
+            line2 + x * job->step, MIN (BLOCK_SIZE, job->width - x),
+            job->step);
+      }
+    }
+  }
+}
+
+/* The jobs of one gst_compare_run_jobs() call */
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint pending;
+  GFunc func;
+} GstCompareBatch;
+
+typedef struct
+{
+  GstCompareBatch *batch;
+  gpointer job;
+} GstCompareTask;
+
+static void
+gst_compare_task_run (gpointer data, gpointer unused)
+{
+  GstCompareTask *task = data;
+  GstCompareBatch *batch = task->batch;
+
+  batch->func (task->job, NULL);
+
+  g_mutex_lock (&batch->lock);
+  if (--batch->pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+/* Calls @func for each of the @n_jobs @jobs, in parallel on the thread pool
+ * and the streaming thread, and returns once all calls returned */
+static void
+gst_compare_run_jobs (GstCompare * comp, GFunc func, gpointer jobs,
+    gsize job_size, guint n_jobs)
 {
-  gint count = 0, i, j;
+  GstCompareBatch batch;
+  GstCompareTask *tasks;
+  guint i;
+
+  if (n_jobs == 0)
+    return;
+
+  if (!comp->pool || n_jobs == 1) {
+    for (i = 0; i < n_jobs; i++)
+      func ((guint8 *) jobs + i * job_size, NULL);
+    return;
+  }
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.pending = n_jobs - 1;
+  batch.func = func;
+
+  tasks = g_newa (GstCompareTask, n_jobs);
+  for (i = 1; i < n_jobs; i++) {
+    tasks[i].batch = &batch;
+    tasks[i].job = (guint8 *) jobs + i * job_size;
+    g_thread_pool_push (comp->pool, &tasks[i], NULL);
+  }
+
+  func (jobs, NULL);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_cond_clear (&batch.cond);
+  g_mutex_clear (&batch.lock);
+}
+
+static gdouble
+gst_compare_ssim_window (GstCompare * comp, const GstCompareBlock * blocks,
+    gint n_blocks)
+{
+  gint count = 0, i;
   gint sum1 = 0, sum2 = 0, ssum1 = 0, ssum2 = 0, acov = 0;
   gdouble avg1, avg2, var1, var2, cov;
 
@@ -365,28 +575,19 @@ gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
   const gdouble c1 = (k1 * L) * (k1 * L);
   const gdouble c2 = (k2 * L) * (k2 * L);
 
+  for (i = 0; i < n_blocks; i++) {
+    sum1 += blocks[i].sum1;
+    sum2 += blocks[i].sum2;
+    ssum1 += blocks[i].ssum1;
+    ssum2 += blocks[i].ssum2;
+    acov += blocks[i].acov;
+    count += blocks[i].count;
+  }
+
   /* For empty images, return maximum similarity */
-  if (height <= 0 || width <= 0)
+  if (count == 0)
     return 1.0;
 
-  /* plain and simple; no fancy optimizations */
-  for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      sum1 += *data1;
-      sum2 += *data2;
-      ssum1 += *data1 * *data1;
-      ssum2 += *data2 * *data2;
-      acov += *data1 * *data2;
-      count++;
-      data1 += step;
-      data2 += step;
-    }
-    data1 -= j * step;
-    data2 -= j * step;
-    data1 += stride;
-    data2 += stride;
-  }
-
   avg1 = sum1 / count;
   avg2 = sum2 / count;
   var1 = ssum1 / count - avg1 * avg1;
@@ -397,22 +598,57 @@ gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
       ((avg1 * avg1 + avg2 * avg2 + c1) * (var1 + var2 + c2));
 }
 
-/* @width etc are for the particular component */
+/* @width etc are for the particular component. Returns the SSIM and stores
+ * the sum of the squared differences in @sse */
 static gdouble
 gst_compare_ssim_component (GstCompare * comp, guint8 * data1, guint8 * data2,
-    gint width, gint height, gint step, gint stride)
+    gint width, gint height, gint step, gint stride, guint64 * sse)
 {
-  const gint window = 16;
+  const gint window = 2 * BLOCK_SIZE;
+  GstCompareBlocksJob *jobs;
+  GstCompareBlock *blocks;
   gdouble ssim_sum = 0;
-  gint count = 0, i, j;
+  gint count = 0, i, j, bw, bh, n_jobs;
+
+  *sse = 0;
+
+  /* For empty images, return maximum similarity */
+  if (width <= 0 || height <= 0)
+    return 1.0;
+
+  bw = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  bh = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  blocks = g_new (GstCompareBlock, bw * bh);
+
+  /* One band of block rows per thread */
+  n_jobs = MIN (comp->n_jobs, bh);
+  jobs = g_newa (GstCompareBlocksJob, n_jobs);
+  for (i = 0; i < n_jobs; i++) {
+    jobs[i].data1 = data1;
+    jobs[i].data2 = data2;
+    jobs[i].width = width;
+    jobs[i].height = height;
+    jobs[i].step = step;
+    jobs[i].stride = stride;
+    jobs[i].blocks = blocks;
+    jobs[i].blocks_per_row = bw;
+    jobs[i].first_row = bh * i / n_jobs;
+    jobs[i].last_row = bh * (i + 1) / n_jobs;
+  }
+  gst_compare_run_jobs (comp, gst_compare_blocks_run, jobs,
+      sizeof (GstCompareBlocksJob), n_jobs);
+
+  for (i = 0; i < bw * bh; i++)
+    *sse += (gint64) blocks[i].ssum1 + blocks[i].ssum2 - 2 * blocks[i].acov;
 
   for (j = 0; j + (window / 2) < height; j += (window / 2)) {
     for (i = 0; i + (window / 2) < width; i += (window / 2)) {
+      const GstCompareBlock *b = blocks + (j / BLOCK_SIZE) * bw +
+          i / BLOCK_SIZE;
+      GstCompareBlock w[4] = { b[0], b[1], b[bw], b[bw + 1] };
       gdouble ssim;
 
-      ssim = gst_compare_ssim_window (comp, data1 + step * i + j * stride,
-          data2 + step * i + j * stride,
-          MIN (window, width - i), MIN (window, height - j), step, stride);
+      ssim = gst_compare_ssim_window (comp, w, 4);
       GST_LOG_OBJECT (comp, "ssim for %dx%d at (%d, %d) = %f", window, window,
           i, j, ssim);
       ssim_sum += ssim;
@@ -420,6 +656,8 @@ gst_compare_ssim_component (GstCompare * comp, guint8 * data1, guint8 * data2,
     }
   }
 
+  g_free (blocks);
+
   /* For empty images, return maximum similarity */
   if (count == 0)
     return 1.0;
@@ -427,14 +665,46 @@ gst_compare_ssim_component (GstCompare * comp, guint8 * data1, guint8 * data2,
   return (ssim_sum / count);
 }
 
+/* PSNR for identical content */
+#define MAX_PSNR 100.0
+
 static gdouble
-gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
-    GstBuffer * buf2, GstCaps * caps2)
+gst_compare_psnr_from_mse (gdouble mse)
+{
+  if (mse <= 0)
+    return MAX_PSNR;
+
+  return MIN (10 * log10 (255.0 * 255.0 / mse), MAX_PSNR);
+}
+
+typedef struct
+{
+  gint n_comps;
+  gdouble ssim;
+  gdouble psnr;
+  gdouble mse;
+  gdouble comp_ssim[GST_VIDEO_MAX_COMPONENTS];
+  gdouble comp_psnr[GST_VIDEO_MAX_COMPONENTS];
+} GstCompareVideoResult;
+
+typedef enum
+{
+  GST_COMPARE_VIDEO_OK,
+  GST_COMPARE_VIDEO_MISMATCH,
+  GST_COMPARE_VIDEO_ERROR
+} GstCompareVideoReturn;
+
+/* Computes the SSIM and PSNR, both per component and weighted over the
+ * frame */
+static GstCompareVideoReturn
+gst_compare_video (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
+    GstBuffer * buf2, GstCaps * caps2, GstCompareVideoResult * result)
 {
   GstVideoInfo info1, info2;
   GstVideoFrame frame1, frame2;
   gint i, comps;
-  gdouble cssim[4], ssim, c[4] = { 1.0, 0.0, 0.0, 0.0 };
+  gdouble c[4] = { 1.0, 0.0, 0.0, 0.0 };
+  guint64 sse = 0, n_samples = 0;
 
   if (!caps1)
     goto invalid_input;
@@ -451,9 +721,15 @@ gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
   if (GST_VIDEO_INFO_FORMAT (&info1) != GST_VIDEO_INFO_FORMAT (&info2) ||
       GST_VIDEO_INFO_WIDTH (&info1) != GST_VIDEO_INFO_WIDTH (&info2) ||
       GST_VIDEO_INFO_HEIGHT (&info1) != GST_VIDEO_INFO_HEIGHT (&info2))
-    return comp->threshold + 1;
+    return GST_COMPARE_VIDEO_MISMATCH;
 
   comps = GST_VIDEO_INFO_N_COMPONENTS (&info1);
+  /* only support most common formats */
+  for (i = 0; i < comps; i++) {
+    if (GST_VIDEO_INFO_COMP_DEPTH (&info1, i) != 8)
+      goto unsupported_input;
+  }
+
   /* note that some are reported both yuv and gray */
   for (i = 0; i < comps; ++i)
     c[i] = 1.0;
@@ -464,60 +740,88 @@ gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     c[i] /= (GST_VIDEO_INFO_IS_YUV (&info1) && (comps > 1)) ?
         2 * (comps - 1) : comps;
 
-  gst_video_frame_map (&frame1, &info1, buf1, GST_MAP_READ);
-  gst_video_frame_map (&frame2, &info2, buf2, GST_MAP_READ);
+  if (!gst_video_frame_map (&frame1, &info1, buf1, GST_MAP_READ))
+    goto invalid_input;
+  if (!gst_video_frame_map (&frame2, &info2, buf2, GST_MAP_READ)) {
+    gst_video_frame_unmap (&frame1);
+    goto invalid_input;
+  }
 
+  result->n_comps = comps;
+  result->ssim = 0;
   for (i = 0; i < comps; i++) {
     gint cw, ch, step, stride;
+    guint64 comp_sse;
 
-    /* only support most common formats */
-    if (GST_VIDEO_INFO_COMP_DEPTH (&info1, i) != 8)
-      goto unsupported_input;
     cw = GST_VIDEO_FRAME_COMP_WIDTH (&frame1, i);
     ch = GST_VIDEO_FRAME_COMP_HEIGHT (&frame1, i);
     step = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame1, i);
     stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame1, i);
 
     GST_LOG_OBJECT (comp, "component %d", i);
-    cssim[i] = gst_compare_ssim_component (comp,
+    result->comp_ssim[i] = gst_compare_ssim_component (comp,
         GST_VIDEO_FRAME_COMP_DATA (&frame1, i),
-        GST_VIDEO_FRAME_COMP_DATA (&frame2, i), cw, ch, step, stride);
-    GST_LOG_OBJECT (comp, "ssim[%d] = %f", i, cssim[i]);
+        GST_VIDEO_FRAME_COMP_DATA (&frame2, i), cw, ch, step, stride,
+        &comp_sse);
+    result->comp_psnr[i] = cw > 0 && ch > 0 ?
+        gst_compare_psnr_from_mse ((gdouble) comp_sse / (cw * ch)) : MAX_PSNR;
+    result->ssim += result->comp_ssim[i] * c[i];
+    sse += comp_sse;
+    n_samples += (guint64) cw * ch;
+
+    GST_DEBUG_OBJECT (comp, "ssim[%d] = %f, psnr[%d] = %f, c[%d] = %f", i,
+        result->comp_ssim[i], i, result->comp_psnr[i], i, c[i]);
   }
 
   gst_video_frame_unmap (&frame1);
   gst_video_frame_unmap (&frame2);
 
-#ifndef GST_DISABLE_GST_DEBUG
-  for (i = 0; i < 4; i++) {
-    GST_DEBUG_OBJECT (comp, "ssim[%d] = %f, c[%d] = %f", i, cssim[i], i, c[i]);
-  }
-#endif
-
-  ssim = cssim[0] * c[0] + cssim[1] * c[1] + cssim[2] * c[2] + cssim[3] * c[3];
+  /* The PSNR of the frame is the one of all the samples */
+  result->mse = n_samples ? (gdouble) sse / n_samples : 0;
+  result->psnr = gst_compare_psnr_from_mse (result->mse);
 
-  return ssim;
+  return GST_COMPARE_VIDEO_OK;
 
   /* ERRORS */
 invalid_input:
   {
     GST_ERROR_OBJECT (comp, "ssim method needs raw video input");
-    return 0;
+    return GST_COMPARE_VIDEO_ERROR;
   }
 unsupported_input:
   {
     GST_ERROR_OBJECT (comp, "raw video format not supported %" GST_PTR_FORMAT,
         caps1);
-    return 0;
+    return GST_COMPARE_VIDEO_ERROR;
   }
 }
 
+static void
+gst_compare_result_set_array (GstStructure * s, const gchar * field,
+    const gdouble * values, gint n_values)
+{
+  GValue array = G_VALUE_INIT;
+  gint i;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  for (i = 0; i < n_values; i++) {
+    GValue v = G_VALUE_INIT;
+
+    g_value_init (&v, G_TYPE_DOUBLE);
+    g_value_set_double (&v, values[i]);
+    gst_value_array_append_and_take_value (&array, &v);
+  }
+  gst_structure_take_value (s, field, &array);
+}
+
 static void
 gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     GstBuffer * buf2, GstCaps * caps2)
 {
   gdouble delta = 0;
   gsize size1, size2;
+  GstCompareVideoResult video;
+  gboolean have_video = FALSE, failed;
 
   /* first check metadata */
   gst_compare_meta (comp, buf1, caps1, buf2, caps2);
@@ -546,7 +850,20 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
         delta = gst_compare_max (comp, buf1, caps1, buf2, caps2);
         break;
       case GST_COMPARE_METHOD_SSIM:
-        delta = gst_compare_ssim (comp, buf1, caps1, buf2, caps2);
+      case GST_COMPARE_METHOD_PSNR:
+        switch (gst_compare_video (comp, buf1, caps1, buf2, caps2, &video)) {
+          case GST_COMPARE_VIDEO_OK:
+            have_video = TRUE;
+            delta = comp->method == GST_COMPARE_METHOD_SSIM ?
+                video.ssim : video.psnr;
+            break;
+          case GST_COMPARE_VIDEO_MISMATCH:
+            delta = comp->threshold + 1;
+            break;
+          default:
+            delta = 0;
+            break;
+        }
         break;
       default:
         g_assert_not_reached ();
@@ -554,8 +871,9 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     }
   }
 
-  if ((comp->upper && delta > comp->threshold) ||
-      (!comp->upper && delta < comp->threshold)) {
+  failed = (comp->upper && delta > comp->threshold) ||
+      (!comp->upper && delta < comp->threshold);
+  if (failed) {
     GST_WARNING_OBJECT (comp, "buffers %p and %p failed content match %f",
         buf1, buf2, delta);
 
@@ -564,6 +882,69 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
             gst_structure_new ("delta", "content", G_TYPE_DOUBLE, delta,
                 NULL)));
   }
+
+  /* aggregated for the summary at EOS */
+  comp->n_frames++;
+  comp->n_failed += failed;
+  comp->delta_sum += delta;
+  comp->delta_min = comp->n_frames > 1 ? MIN (comp->delta_min, delta) : delta;
+  comp->delta_max = comp->n_frames > 1 ? MAX (comp->delta_max, delta) : delta;
+  if (have_video) {
+    comp->n_video++;
+    comp->ssim_sum += video.ssim;
+    comp->ssim_min = comp->n_video > 1 ?
+        MIN (comp->ssim_min, video.ssim) : video.ssim;
+    comp->psnr_sum += video.psnr;
+    comp->psnr_min = comp->n_video > 1 ?
+        MIN (comp->psnr_min, video.psnr) : video.psnr;
+  }
+
+  if (comp->post_results) {
+    GstStructure *result;
+
+    result = gst_structure_new ("GstCompareResult",
+        "timestamp", GST_TYPE_CLOCK_TIME, GST_BUFFER_PTS (buf1),
+        "delta", G_TYPE_DOUBLE, delta, NULL);
+    if (have_video) {
+      gst_structure_set (result, "ssim", G_TYPE_DOUBLE, video.ssim,
+          "psnr", G_TYPE_DOUBLE, video.psnr, NULL);
+      gst_compare_result_set_array (result, "ssim-components",
+          video.comp_ssim, video.n_comps);
+      gst_compare_result_set_array (result, "psnr-components",
+          video.comp_psnr, video.n_comps);
+    }
+
+    gst_element_post_message (GST_ELEMENT (comp),
+        gst_message_new_element (GST_OBJECT (comp), result));
+  }
+}
+
+static void
+gst_compare_post_summary (GstCompare * comp)
+{
+  GstStructure *summary;
+
+  if (comp->n_frames == 0)
+    return;
+
+  summary = gst_structure_new ("GstCompareSummary",
+      "frames", G_TYPE_UINT64, comp->n_frames,
+      "failed", G_TYPE_UINT64, comp->n_failed,
+      "delta-average", G_TYPE_DOUBLE, comp->delta_sum / comp->n_frames,
+      "delta-min", G_TYPE_DOUBLE, comp->delta_min,
+      "delta-max", G_TYPE_DOUBLE, comp->delta_max, NULL);
+  if (comp->n_video > 0) {
+    gst_structure_set (summary,
+        "ssim-average", G_TYPE_DOUBLE, comp->ssim_sum / comp->n_video,
+        "ssim-min", G_TYPE_DOUBLE, comp->ssim_min,
+        "psnr-average", G_TYPE_DOUBLE, comp->psnr_sum / comp->n_video,
+        "psnr-min", G_TYPE_DOUBLE, comp->psnr_min, NULL);
+  }
+
+  GST_INFO_OBJECT (comp, "summary %" GST_PTR_FORMAT, summary);
+
+  gst_element_post_message (GST_ELEMENT (comp),
+      gst_message_new_element (GST_OBJECT (comp), summary));
 }
 
 static GstFlowReturn
@@ -581,6 +962,7 @@ gst_compare_collect_pads (GstCollectPads * cpads, GstCompare * comp)
   caps2 = gst_pad_get_current_caps (comp->checkpad);
 
   if (!buf1 && !buf2) {
+    gst_compare_post_summary (comp);
     gst_pad_push_event (comp->srcpad, gst_event_new_eos ());
     return GST_FLOW_EOS;
   } else if (buf1 && buf2) {
@@ -632,6 +1014,12 @@ gst_compare_set_property (GObject * object, guint prop_id,
     case PROP_UPPER:
       comp->upper = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      comp->n_threads = g_value_get_uint (value);
+      break;
+    case PROP_POST_RESULTS:
+      comp->post_results = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -660,6 +1048,12 @@ gst_compare_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_UPPER:
       g_value_set_boolean (value, comp->upper);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, comp->n_threads);
+      break;
+    case PROP_POST_RESULTS:
+      g_value_set_boolean (value, comp->post_results);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -673,8 +1067,15 @@ gst_compare_change_state (GstElement * element, GstStateChange transition)
   GstStateChangeReturn ret;
 
   switch (transition) {
-    case GST_STATE_CHANGE_NULL_TO_READY:
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      comp->n_jobs = comp->n_threads ? comp->n_threads :
+          g_get_num_processors ();
+      /* the streaming thread runs one of the jobs itself */
+      if (comp->n_jobs > 1)
+        comp->pool = g_thread_pool_new (gst_compare_task_run, NULL,
+            comp->n_jobs - 1, FALSE, NULL);
+      /* fall through */
+    case GST_STATE_CHANGE_NULL_TO_READY:
       gst_collect_pads_start (comp->cpads);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -692,6 +1093,11 @@ gst_compare_change_state (GstElement * element, GstStateChange transition)
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_compare_reset (comp);
+      if (comp->pool) {
+        g_thread_pool_free (comp->pool, FALSE, TRUE);
+        comp->pool = NULL;
+      }
+      comp->n_jobs = 1;
       break;
     default:
       break;
@@ -62,6 +62,20 @@ struct _GstCompare {
   gint method;
   gdouble threshold;
   gboolean upper;
+  guint n_threads;
+  gboolean post_results;
+
+  /* threads computing the video comparisons */
+  guint n_jobs;
+  GThreadPool *pool;
+
+  /* aggregated results for the summary at EOS */
+  guint64 n_frames;
+  guint64 n_failed;
+  guint64 n_video;
+  gdouble delta_sum, delta_min, delta_max;
+  gdouble ssim_sum, ssim_min;
+  gdouble psnr_sum, psnr_min;
 };
 
 struct _GstCompareClass {
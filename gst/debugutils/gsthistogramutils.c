@@ -0,0 +1,200 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+
+#include "gsthistogramutils.h"
+
+/* Histograms of durations with logarithmic buckets, and the statistics
+ * query and PTS lookups shared by the elements reporting timing
+ * statistics */
+
+void
+gst_debug_histogram_reset (GstDebugHistogram * hist)
+{
+  guint i;
+
+  for (i = 0; i < GST_DEBUG_HISTOGRAM_BUCKETS; i++)
+    g_atomic_int_set (&hist->buckets[i], 0);
+  g_atomic_int_set (&hist->max, 0);
+}
+
+void
+gst_debug_histogram_add (GstDebugHistogram * hist, gint64 us)
+{
+  guint bucket = 0;
+  gint value, max;
+
+  value = CLAMP (us, 0, G_MAXINT);
+  if (value > 0)
+    bucket = MIN (g_bit_storage (value) - 1,
+        GST_DEBUG_HISTOGRAM_BUCKETS - 1);
+  g_atomic_int_inc (&hist->buckets[bucket]);
+
+  do {
+    max = g_atomic_int_get (&hist->max);
+  } while (value > max &&
+      !g_atomic_int_compare_and_exchange (&hist->max, max, value));
+}
+
+/* Upper bound of the bucket containing the given percentile */
+static guint64
+gst_debug_histogram_percentile (const guint * counts, guint total,
+    guint percent)
+{
+  guint64 target, sum = 0;
+  guint i;
+
+  target = MAX (((guint64) total * percent + 99) / 100, 1);
+  for (i = 0; i < GST_DEBUG_HISTOGRAM_BUCKETS; i++) {
+    sum += counts[i];
+    if (sum >= target)
+      break;
+  }
+
+  return (G_GUINT64_CONSTANT (1) << MIN (i + 1,
+          GST_DEBUG_HISTOGRAM_BUCKETS)) * GST_USECOND;
+}
+
+void
+gst_debug_histogram_add_to_structure (GstDebugHistogram * hist,
+    GstStructure * s, const gchar * prefix)
+{
+  guint counts[GST_DEBUG_HISTOGRAM_BUCKETS];
+  GValue array = G_VALUE_INIT;
+  guint i, total = 0;
+  gchar *name;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  for (i = 0; i < GST_DEBUG_HISTOGRAM_BUCKETS; i++) {
+    GValue v = G_VALUE_INIT;
+
+    counts[i] = g_atomic_int_get (&hist->buckets[i]);
+    total += counts[i];
+
+    g_value_init (&v, G_TYPE_UINT);
+    g_value_set_uint (&v, counts[i]);
+    gst_value_array_append_and_take_value (&array, &v);
+  }
+
+  name = g_strconcat (prefix, "-count", NULL);
+  gst_structure_set (s, name, G_TYPE_UINT, total, NULL);
+  g_free (name);
+
+  name = g_strconcat (prefix, "-histogram", NULL);
+  gst_structure_take_value (s, name, &array);
+  g_free (name);
+
+  if (total == 0)
+    return;
+
+  name = g_strconcat (prefix, "-p50", NULL);
+  gst_structure_set (s, name, G_TYPE_UINT64,
+      gst_debug_histogram_percentile (counts, total, 50), NULL);
+  g_free (name);
+
+  name = g_strconcat (prefix, "-p90", NULL);
+  gst_structure_set (s, name, G_TYPE_UINT64,
+      gst_debug_histogram_percentile (counts, total, 90), NULL);
+  g_free (name);
+
+  name = g_strconcat (prefix, "-p99", NULL);
+  gst_structure_set (s, name, G_TYPE_UINT64,
+      gst_debug_histogram_percentile (counts, total, 99), NULL);
+  g_free (name);
+
+  name = g_strconcat (prefix, "-max", NULL);
+  gst_structure_set (s, name, G_TYPE_UINT64,
+      (guint64) g_atomic_int_get (&hist->max) * GST_USECOND, NULL);
+  g_free (name);
+}
+
+/* Whether @query is the custom query collecting the statistics of the
+ * elements on the way, named @name */
+gboolean
+gst_debug_stats_query_has_name (GstQuery * query, const gchar * name)
+{
+  const GstStructure *s;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_CUSTOM)
+    return FALSE;
+
+  s = gst_query_get_structure (query);
+
+  return s && gst_structure_has_name (s, name);
+}
+
+/* Appends @stats, which is taken, to the "stats" array of @query */
+void
+gst_debug_stats_query_add (GstQuery * query, GstStructure * stats)
+{
+  GstStructure *writable;
+  const GValue *prev;
+  GValue array = G_VALUE_INIT;
+  GValue value = G_VALUE_INIT;
+
+  writable = gst_query_writable_structure (query);
+  g_value_init (&array, GST_TYPE_ARRAY);
+  prev = gst_structure_get_value (writable, "stats");
+  if (prev && GST_VALUE_HOLDS_ARRAY (prev))
+    g_value_copy (prev, &array);
+
+  g_value_init (&value, GST_TYPE_STRUCTURE);
+  g_value_take_boxed (&value, stats);
+  gst_value_array_append_and_take_value (&array, &value);
+  gst_structure_take_value (writable, "stats", &array);
+}
+
+void
+gst_debug_pts_ring_reset (GstDebugPtsRing * ring)
+{
+  memset (ring, 0, sizeof (GstDebugPtsRing));
+}
+
+void
+gst_debug_pts_ring_add (GstDebugPtsRing * ring, GstClockTime pts,
+    guint64 id, gint64 time)
+{
+  GstDebugPtsEntry *entry;
+
+  entry = &ring->entries[ring->pos % GST_DEBUG_PTS_RING_SIZE];
+  entry->pts = pts;
+  entry->id = id;
+  entry->time = time;
+  ring->pos++;
+}
+
+/* Returns the last entry with @pts, or NULL */
+const GstDebugPtsEntry *
+gst_debug_pts_ring_find (GstDebugPtsRing * ring, GstClockTime pts)
+{
+  guint i, n;
+
+  /* Most buffers are found right away, unless they are reordered */
+  n = MIN (ring->pos, GST_DEBUG_PTS_RING_SIZE);
+  for (i = 1; i <= n; i++) {
+    GstDebugPtsEntry *entry =
+        &ring->entries[(ring->pos - i) % GST_DEBUG_PTS_RING_SIZE];
+
+    if (entry->pts == pts)
+      return entry;
+  }
+
+  return NULL;
+}
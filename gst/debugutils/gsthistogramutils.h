@@ -0,0 +1,86 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __GST_HISTOGRAM_UTILS_H__
+#define __GST_HISTOGRAM_UTILS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* One bucket per power of two microseconds */
+#define GST_DEBUG_HISTOGRAM_BUCKETS 32
+
+/* Updated with atomic operations only, so that the statistics can be read
+ * at any time without blocking the streaming thread */
+typedef struct
+{
+  gint buckets[GST_DEBUG_HISTOGRAM_BUCKETS];
+  gint max;                     /* in us */
+} GstDebugHistogram;
+
+void
+gst_debug_histogram_reset (GstDebugHistogram * hist);
+
+void
+gst_debug_histogram_add (GstDebugHistogram * hist, gint64 us);
+
+void
+gst_debug_histogram_add_to_structure (GstDebugHistogram * hist,
+                                      GstStructure * s,
+                                      const gchar * prefix);
+
+gboolean
+gst_debug_stats_query_has_name (GstQuery * query, const gchar * name);
+
+void
+gst_debug_stats_query_add (GstQuery * query, GstStructure * stats);
+
+#define GST_DEBUG_PTS_RING_SIZE 256
+
+/* A buffer that went through an element, the meaning of @id and @time is
+ * up to the element */
+typedef struct
+{
+  GstClockTime pts;
+  guint64 id;
+  gint64 time;
+} GstDebugPtsEntry;
+
+/* The last buffers that went through an element, to find them again by PTS
+ * further downstream */
+typedef struct
+{
+  GstDebugPtsEntry entries[GST_DEBUG_PTS_RING_SIZE];
+  guint pos;
+} GstDebugPtsRing;
+
+void
+gst_debug_pts_ring_reset (GstDebugPtsRing * ring);
+
+void
+gst_debug_pts_ring_add (GstDebugPtsRing * ring, GstClockTime pts,
+                        guint64 id, gint64 time);
+
+const GstDebugPtsEntry *
+gst_debug_pts_ring_find (GstDebugPtsRing * ring, GstClockTime pts);
+
+G_END_DECLS
+
+#endif
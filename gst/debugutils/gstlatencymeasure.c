@@ -0,0 +1,431 @@
+/* GStreamer
+ * Copyright (C) 2026 GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+/**
+ * SECTION:element-latencymeasure
+ * @title: latencymeasure
+ * @see_also: latencystamp
+ *
+ * Measures the time buffers took since they went through the #latencystamp
+ * element of the same #GstLatencyMeasure:channel. Several of them can be
+ * placed along a pipeline, each one reporting the latency up to that stage.
+ *
+ * Buffers are matched by the #GstReferenceTimestampMeta added by
+ * #latencystamp and, for those that lost it, by their PTS among the last
+ * stamps of the same process.
+ *
+ * > The duration field of these metas is not a duration: #latencystamp
+ * > stores the ID of the buffer in it, which is reported as the "id" of
+ * > the measurements.
+ *
+ * The statistics are available through the #GstLatencyMeasure:stats
+ * property. The statistics of all the latencymeasure elements upstream of a
+ * pad can be collected at once with a custom query with a #GstStructure
+ * named "GstLatencyStatsQuery". Each element on the way appends its
+ * statistics to the "stats" array field of the query.
+ *
+ * With #GstLatencyMeasure:post-messages, an element message named
+ * "GstLatencyMeasurement" is posted for each matched buffer, with the ID
+ * of the buffer in an "id" (guint64) field and its latency in ns in a
+ * "latency" (guint64) field.
+ *
+ * Streams merged by a muxer can carry the stamps of several streams, so
+ * audio and video should be stamped on different channels.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 -m v4l2src ! latencystamp ! x264enc tune=zerolatency !
+ *     latencymeasure name=encoded ! avdec_h264 ! latencymeasure name=decoded !
+ *     fakesink
+ * ]| Measures the time frames take to be encoded, and then decoded.
+ *
+ * Since: 1.24
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdebugutilsbadelements.h"
+#include "gstlatencystamp.h"
+#include "gstlatencymeasure.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_latency_measure_debug);
+#define GST_CAT_DEFAULT gst_latency_measure_debug
+
+#define DEFAULT_CHANNEL "default"
+#define DEFAULT_POST_MESSAGES FALSE
+
+enum
+{
+  PROP_0,
+  PROP_CHANNEL,
+  PROP_POST_MESSAGES,
+  PROP_STATS
+};
+
+static void gst_latency_measure_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_latency_measure_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_latency_measure_finalize (GObject * object);
+static gboolean gst_latency_measure_start (GstBaseTransform * trans);
+static gboolean gst_latency_measure_stop (GstBaseTransform * trans);
+static gboolean gst_latency_measure_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_latency_measure_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query);
+static GstFlowReturn gst_latency_measure_transform_ip (GstBaseTransform *
+    trans, GstBuffer * buf);
+static GstStructure *gst_latency_measure_get_stats (GstLatencyMeasure *
+    measure);
+
+G_DEFINE_TYPE_WITH_CODE (GstLatencyMeasure, gst_latency_measure,
+    GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (gst_latency_measure_debug, "latencymeasure", 0,
+        "debug category for latencymeasure element"));
+GST_ELEMENT_REGISTER_DEFINE (latencymeasure, "latencymeasure", GST_RANK_NONE,
+    gst_latency_measure_get_type ());
+
+static void
+gst_latency_measure_class_init (GstLatencyMeasureClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseTransformClass *base_transform_class =
+      GST_BASE_TRANSFORM_CLASS (klass);
+
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+
+  gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
+      "Latency measure", "Generic",
+      "Measures the latency of buffers stamped upstream",
+      "GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>");
+
+  gobject_class->set_property = gst_latency_measure_set_property;
+  gobject_class->get_property = gst_latency_measure_get_property;
+  gobject_class->finalize = gst_latency_measure_finalize;
+  base_transform_class->start = GST_DEBUG_FUNCPTR (gst_latency_measure_start);
+  base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_latency_measure_stop);
+  base_transform_class->set_caps =
+      GST_DEBUG_FUNCPTR (gst_latency_measure_set_caps);
+  base_transform_class->query = GST_DEBUG_FUNCPTR (gst_latency_measure_query);
+  base_transform_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_latency_measure_transform_ip);
+
+  /**
+   * GstLatencyMeasure:channel:
+   *
+   * Channel of the #latencystamp element from which the latency is
+   * measured.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_CHANNEL,
+      g_param_spec_string ("channel", "Channel",
+          "Channel of the stamps", DEFAULT_CHANNEL,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstLatencyMeasure:post-messages:
+   *
+   * Post a "GstLatencyMeasurement" element message for each matched buffer.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post messages",
+          "Post an element message with the latency of each buffer",
+          DEFAULT_POST_MESSAGES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstLatencyMeasure:stats:
+   *
+   * Statistics in a #GstStructure named "GstLatencyMeasureStats" with:
+   *
+   * - "name" (gchararray): name of the element
+   * - "channel" (gchararray): channel of the stamps
+   * - "media" (gchararray): "video", "audio" or the media type of the
+   *   stream
+   * - "stamped" (guint): number of buffers matched by their meta
+   * - "matched-by-pts" (guint): number of buffers matched by their PTS
+   * - "unmatched" (guint): number of buffers that could not be matched
+   * - "lost" (guint64): number of stamped buffers that did not arrive,
+   *   dropped or merged into others on the way
+   * - "latency-count" (guint): number of measurements
+   * - "latency-histogram" (GstValueArray of guint): number of measurements
+   *   per bucket, bucket n counting the latencies from 2^n to 2^(n+1) us
+   * - "latency-p50", "latency-p90", "latency-p99" (guint64): percentiles in
+   *   ns, rounded up to the upper bound of their bucket
+   * - "latency-max" (guint64): maximum in ns
+   *
+   * The statistics are reset when going from READY to PAUSED.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics of the latency", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_latency_measure_init (GstLatencyMeasure * measure)
+{
+  measure->channel = g_strdup (DEFAULT_CHANNEL);
+  measure->post_messages = DEFAULT_POST_MESSAGES;
+
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (measure), TRUE);
+}
+
+static void
+gst_latency_measure_finalize (GObject * object)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (object);
+
+  g_free (measure->channel);
+  g_free (measure->media);
+
+  G_OBJECT_CLASS (gst_latency_measure_parent_class)->finalize (object);
+}
+
+static void
+gst_latency_measure_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (object);
+
+  switch (property_id) {
+    case PROP_CHANNEL:
+      GST_OBJECT_LOCK (measure);
+      if (GST_STATE (measure) > GST_STATE_READY) {
+        GST_OBJECT_UNLOCK (measure);
+        GST_WARNING_OBJECT (measure, "channel can only be changed in the "
+            "NULL or READY state");
+        break;
+      }
+      g_free (measure->channel);
+      measure->channel = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (measure);
+      break;
+    case PROP_POST_MESSAGES:
+      g_atomic_int_set (&measure->post_messages, g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_latency_measure_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (object);
+
+  switch (property_id) {
+    case PROP_CHANNEL:
+      GST_OBJECT_LOCK (measure);
+      g_value_set_string (value, measure->channel);
+      GST_OBJECT_UNLOCK (measure);
+      break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, g_atomic_int_get (&measure->post_messages));
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_latency_measure_get_stats (measure));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static gboolean
+gst_latency_measure_start (GstBaseTransform * trans)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (trans);
+
+  gst_debug_histogram_reset (&measure->latency);
+  g_atomic_int_set (&measure->stamped, 0);
+  g_atomic_int_set (&measure->matched_by_pts, 0);
+  g_atomic_int_set (&measure->unmatched, 0);
+
+  GST_OBJECT_LOCK (measure);
+  measure->reference = gst_latency_stamp_make_reference (measure->channel);
+  measure->stamp_channel = g_strdup (measure->channel);
+  g_clear_pointer (&measure->media, g_free);
+  measure->have_ids = FALSE;
+  GST_OBJECT_UNLOCK (measure);
+
+  return TRUE;
+}
+
+static gboolean
+gst_latency_measure_stop (GstBaseTransform * trans)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (trans);
+
+  gst_clear_caps (&measure->reference);
+  g_clear_pointer (&measure->stamp_channel, g_free);
+
+  return TRUE;
+}
+
+static gboolean
+gst_latency_measure_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (trans);
+  GstStructure *s = gst_caps_get_structure (incaps, 0);
+  const gchar *name = gst_structure_get_name (s);
+  gchar *media;
+
+  /* RTP streams tell what they carry */
+  if (gst_structure_has_name (s, "application/x-rtp") &&
+      gst_structure_has_field_typed (s, "media", G_TYPE_STRING))
+    media = g_strdup (gst_structure_get_string (s, "media"));
+  else if (g_str_has_prefix (name, "video/"))
+    media = g_strdup ("video");
+  else if (g_str_has_prefix (name, "audio/"))
+    media = g_strdup ("audio");
+  else
+    media = g_strdup (name);
+
+  GST_OBJECT_LOCK (measure);
+  g_free (measure->media);
+  measure->media = media;
+  GST_OBJECT_UNLOCK (measure);
+
+  return TRUE;
+}
+
+/* Can be called from any thread */
+static GstStructure *
+gst_latency_measure_get_stats (GstLatencyMeasure * measure)
+{
+  GstStructure *s;
+  gchar *name;
+  guint stamped, matched_by_pts;
+  guint64 lost = 0;
+
+  stamped = g_atomic_int_get (&measure->stamped);
+  matched_by_pts = g_atomic_int_get (&measure->matched_by_pts);
+
+  name = gst_object_get_name (GST_OBJECT (measure));
+  s = gst_structure_new ("GstLatencyMeasureStats", "name", G_TYPE_STRING,
+      name, NULL);
+  g_free (name);
+
+  GST_OBJECT_LOCK (measure);
+  /* Buffers duplicated on the way can make up for lost ones */
+  if (measure->have_ids) {
+    guint64 span = measure->last_id - measure->first_id + 1;
+
+    if (span > (guint64) stamped + matched_by_pts)
+      lost = span - stamped - matched_by_pts;
+  }
+  gst_structure_set (s, "channel", G_TYPE_STRING, measure->channel,
+      "media", G_TYPE_STRING, measure->media ? measure->media : "", NULL);
+  GST_OBJECT_UNLOCK (measure);
+
+  gst_structure_set (s, "stamped", G_TYPE_UINT, stamped,
+      "matched-by-pts", G_TYPE_UINT, matched_by_pts,
+      "unmatched", G_TYPE_UINT, g_atomic_int_get (&measure->unmatched),
+      "lost", G_TYPE_UINT64, lost, NULL);
+  gst_debug_histogram_add_to_structure (&measure->latency, s, "latency");
+
+  return s;
+}
+
+static gboolean
+gst_latency_measure_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (trans);
+
+  if (!gst_debug_stats_query_has_name (query, "GstLatencyStatsQuery"))
+    return
+        GST_BASE_TRANSFORM_CLASS (gst_latency_measure_parent_class)->query
+        (trans, direction, query);
+
+  GST_DEBUG_OBJECT (measure, "adding statistics to query");
+  gst_debug_stats_query_add (query, gst_latency_measure_get_stats (measure));
+
+  /* The measures further upstream append theirs too */
+  GST_BASE_TRANSFORM_CLASS (gst_latency_measure_parent_class)->query (trans,
+      direction, query);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_latency_measure_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  GstLatencyMeasure *measure = GST_LATENCY_MEASURE (trans);
+  GstClockTime now = g_get_monotonic_time () * GST_USECOND;
+  GstReferenceTimestampMeta *meta;
+  GstClockTime time, latency;
+  guint64 id;
+
+  meta = gst_buffer_get_reference_timestamp_meta (buf, measure->reference);
+  if (meta) {
+    id = meta->duration;
+    time = meta->timestamp;
+    g_atomic_int_inc (&measure->stamped);
+  } else if (gst_latency_stamp_lookup (measure->stamp_channel,
+          GST_BUFFER_PTS (buf), &id, &time)) {
+    g_atomic_int_inc (&measure->matched_by_pts);
+  } else {
+    GST_LOG_OBJECT (measure, "buffer %" GST_PTR_FORMAT " is not stamped",
+        buf);
+    g_atomic_int_inc (&measure->unmatched);
+    return GST_FLOW_OK;
+  }
+
+  latency = now > time ? now - time : 0;
+  gst_debug_histogram_add (&measure->latency, latency / GST_USECOND);
+
+  GST_LOG_OBJECT (measure, "buffer %" G_GUINT64_FORMAT " latency %"
+      GST_TIME_FORMAT, id, GST_TIME_ARGS (latency));
+
+  GST_OBJECT_LOCK (measure);
+  if (!measure->have_ids) {
+    measure->first_id = measure->last_id = id;
+    measure->have_ids = TRUE;
+  } else {
+    measure->first_id = MIN (measure->first_id, id);
+    measure->last_id = MAX (measure->last_id, id);
+  }
+  GST_OBJECT_UNLOCK (measure);
+
+  if (g_atomic_int_get (&measure->post_messages)) {
+    gst_element_post_message (GST_ELEMENT (measure),
+        gst_message_new_element (GST_OBJECT (measure),
+            gst_structure_new ("GstLatencyMeasurement",
+                "id", G_TYPE_UINT64, id,
+                "latency", G_TYPE_UINT64, latency, NULL)));
+  }
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,69 @@
+/* GStreamer
+ * Copyright (C) 2026 GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_LATENCY_MEASURE_H__
+#define __GST_LATENCY_MEASURE_H__
+
+#include <gst/base/gstbasetransform.h>
+
+#include "gsthistogramutils.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_LATENCY_MEASURE   (gst_latency_measure_get_type())
+#define GST_LATENCY_MEASURE(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_LATENCY_MEASURE,GstLatencyMeasure))
+#define GST_IS_LATENCY_MEASURE(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_LATENCY_MEASURE))
+
+typedef struct _GstLatencyMeasure GstLatencyMeasure;
+typedef struct _GstLatencyMeasureClass GstLatencyMeasureClass;
+
+struct _GstLatencyMeasure
+{
+  GstBaseTransform parent;
+
+  /* properties */
+  gchar *channel;
+  gboolean post_messages;
+
+  GstCaps *reference;
+  /* copy of the channel while running */
+  gchar *stamp_channel;
+
+  /* Statistics, the counters and the histogram are updated atomically and
+   * the rest is protected by the object lock */
+  gchar *media;
+  GstDebugHistogram latency;
+  gint stamped;
+  gint matched_by_pts;
+  gint unmatched;
+  gboolean have_ids;
+  guint64 first_id;
+  guint64 last_id;
+};
+
+struct _GstLatencyMeasureClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_latency_measure_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,298 @@
+/* GStreamer
+ * Copyright (C) 2026 GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+/**
+ * SECTION:element-latencystamp
+ * @title: latencystamp
+ * @see_also: latencymeasure
+ *
+ * Stamps the buffers going through it for #latencymeasure elements further
+ * downstream, possibly in another process on the same host.
+ *
+ * Each buffer gets a #GstReferenceTimestampMeta whose reference caps are
+ * "timestamp/x-gst-latency-stamp, channel=(string)<channel>". Its timestamp
+ * is the capture time, from the monotonic clock of the system.
+ *
+ * > The duration field of these metas is not a duration: it holds the ID
+ * > of the buffer, increasing by one for each buffer since the element
+ * > started. Elements other than #latencymeasure must not interpret it.
+ *
+ * Unlike a dedicated meta, which many elements would drop, reference
+ * timestamp metas are kept by most elements, including encoders, decoders,
+ * and RTP payloaders and depayloaders. The last stamps are also remembered by
+ * PTS, so that a #latencymeasure of the same #GstLatencyStamp:channel in the
+ * same process can still match buffers that were recreated without their
+ * metas, as long as their PTS was kept.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 -m v4l2src ! latencystamp ! x264enc tune=zerolatency !
+ *     latencymeasure name=encoded ! avdec_h264 ! latencymeasure name=decoded !
+ *     fakesink
+ * ]| Measures the time frames take to be encoded, and then decoded.
+ *
+ * Since: 1.24
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdebugutilsbadelements.h"
+#include "gstlatencystamp.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_latency_stamp_debug);
+#define GST_CAT_DEFAULT gst_latency_stamp_debug
+
+#define DEFAULT_CHANNEL "default"
+
+enum
+{
+  PROP_0,
+  PROP_CHANNEL
+};
+
+/* The running latencystamp elements by channel, not reffed */
+static GHashTable *channels;
+G_LOCK_DEFINE_STATIC (channels);
+
+static void gst_latency_stamp_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_latency_stamp_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_latency_stamp_finalize (GObject * object);
+static gboolean gst_latency_stamp_start (GstBaseTransform * trans);
+static gboolean gst_latency_stamp_stop (GstBaseTransform * trans);
+static GstFlowReturn gst_latency_stamp_transform_ip (GstBaseTransform *
+    trans, GstBuffer * buf);
+
+G_DEFINE_TYPE_WITH_CODE (GstLatencyStamp, gst_latency_stamp,
+    GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (gst_latency_stamp_debug, "latencystamp", 0,
+        "debug category for latencystamp element"));
+GST_ELEMENT_REGISTER_DEFINE (latencystamp, "latencystamp", GST_RANK_NONE,
+    gst_latency_stamp_get_type ());
+
+static void
+gst_latency_stamp_class_init (GstLatencyStampClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseTransformClass *base_transform_class =
+      GST_BASE_TRANSFORM_CLASS (klass);
+
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+
+  gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
+      "Latency stamp", "Generic",
+      "Stamps buffers for measuring their latency downstream",
+      "GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>");
+
+  gobject_class->set_property = gst_latency_stamp_set_property;
+  gobject_class->get_property = gst_latency_stamp_get_property;
+  gobject_class->finalize = gst_latency_stamp_finalize;
+  base_transform_class->start = GST_DEBUG_FUNCPTR (gst_latency_stamp_start);
+  base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_latency_stamp_stop);
+  base_transform_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_latency_stamp_transform_ip);
+
+  /**
+   * GstLatencyStamp:channel:
+   *
+   * Name matching the stamps with the #latencymeasure elements.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_CHANNEL,
+      g_param_spec_string ("channel", "Channel",
+          "Channel of the stamps", DEFAULT_CHANNEL,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_latency_stamp_init (GstLatencyStamp * stamp)
+{
+  stamp->channel = g_strdup (DEFAULT_CHANNEL);
+
+  /* The metas are added to the buffers we get, which are otherwise
+   * passed through */
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (stamp), TRUE);
+}
+
+static void
+gst_latency_stamp_finalize (GObject * object)
+{
+  GstLatencyStamp *stamp = GST_LATENCY_STAMP (object);
+
+  g_free (stamp->channel);
+
+  G_OBJECT_CLASS (gst_latency_stamp_parent_class)->finalize (object);
+}
+
+static void
+gst_latency_stamp_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstLatencyStamp *stamp = GST_LATENCY_STAMP (object);
+
+  switch (property_id) {
+    case PROP_CHANNEL:
+      GST_OBJECT_LOCK (stamp);
+      if (GST_STATE (stamp) > GST_STATE_READY) {
+        GST_OBJECT_UNLOCK (stamp);
+        GST_WARNING_OBJECT (stamp, "channel can only be changed in the NULL "
+            "or READY state");
+        break;
+      }
+      g_free (stamp->channel);
+      stamp->channel = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (stamp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_latency_stamp_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstLatencyStamp *stamp = GST_LATENCY_STAMP (object);
+
+  switch (property_id) {
+    case PROP_CHANNEL:
+      GST_OBJECT_LOCK (stamp);
+      g_value_set_string (value, stamp->channel);
+      GST_OBJECT_UNLOCK (stamp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+GstCaps *
+gst_latency_stamp_make_reference (const gchar * channel)
+{
+  return gst_caps_new_simple ("timestamp/x-gst-latency-stamp",
+      "channel", G_TYPE_STRING, channel ? channel : "", NULL);
+}
+
+static gboolean
+gst_latency_stamp_start (GstBaseTransform * trans)
+{
+  GstLatencyStamp *stamp = GST_LATENCY_STAMP (trans);
+  gchar *channel;
+
+  GST_OBJECT_LOCK (stamp);
+  stamp->reference = gst_latency_stamp_make_reference (stamp->channel);
+  stamp->next_id = 0;
+  gst_debug_pts_ring_reset (&stamp->entries);
+  channel = g_strdup (stamp->channel);
+  GST_OBJECT_UNLOCK (stamp);
+
+  G_LOCK (channels);
+  if (!channels)
+    channels = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  if (!g_hash_table_contains (channels, channel)) {
+    /* owned by the table */
+    stamp->registered_channel = channel;
+    g_hash_table_insert (channels, channel, stamp);
+  } else {
+    GST_WARNING_OBJECT (stamp, "channel %s already stamped elsewhere, "
+        "buffers without meta won't be matched by PTS", channel);
+    g_free (channel);
+  }
+  G_UNLOCK (channels);
+
+  return TRUE;
+}
+
+static gboolean
+gst_latency_stamp_stop (GstBaseTransform * trans)
+{
+  GstLatencyStamp *stamp = GST_LATENCY_STAMP (trans);
+
+  G_LOCK (channels);
+  if (stamp->registered_channel)
+    g_hash_table_remove (channels, stamp->registered_channel);
+  stamp->registered_channel = NULL;
+  G_UNLOCK (channels);
+
+  gst_clear_caps (&stamp->reference);
+
+  return TRUE;
+}
+
+/* Looks for a recent stamp of the given channel by PTS, for the buffers
+ * that lost their meta */
+gboolean
+gst_latency_stamp_lookup (const gchar * channel, GstClockTime pts,
+    guint64 * id, GstClockTime * time)
+{
+  GstLatencyStamp *stamp;
+  const GstDebugPtsEntry *entry;
+  gboolean found = FALSE;
+
+  if (!GST_CLOCK_TIME_IS_VALID (pts))
+    return FALSE;
+
+  G_LOCK (channels);
+  stamp = channels ? g_hash_table_lookup (channels, channel) : NULL;
+  if (stamp) {
+    GST_OBJECT_LOCK (stamp);
+    entry = gst_debug_pts_ring_find (&stamp->entries, pts);
+    if (entry) {
+      *id = entry->id;
+      *time = entry->time;
+      found = TRUE;
+    }
+    GST_OBJECT_UNLOCK (stamp);
+  }
+  G_UNLOCK (channels);
+
+  return found;
+}
+
+static GstFlowReturn
+gst_latency_stamp_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  GstLatencyStamp *stamp = GST_LATENCY_STAMP (trans);
+  GstClockTime now = g_get_monotonic_time () * GST_USECOND;
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+  guint64 id = stamp->next_id++;
+
+  GST_LOG_OBJECT (stamp, "stamping buffer %" G_GUINT64_FORMAT " with pts %"
+      GST_TIME_FORMAT, id, GST_TIME_ARGS (pts));
+
+  gst_buffer_add_reference_timestamp_meta (buf, stamp->reference, now, id);
+
+  if (GST_CLOCK_TIME_IS_VALID (pts)) {
+    GST_OBJECT_LOCK (stamp);
+    gst_debug_pts_ring_add (&stamp->entries, pts, id, now);
+    GST_OBJECT_UNLOCK (stamp);
+  }
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,68 @@
+/* GStreamer
+ * Copyright (C) 2026 GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_LATENCY_STAMP_H__
+#define __GST_LATENCY_STAMP_H__
+
+#include <gst/base/gstbasetransform.h>
+
+#include "gsthistogramutils.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_LATENCY_STAMP   (gst_latency_stamp_get_type())
+#define GST_LATENCY_STAMP(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_LATENCY_STAMP,GstLatencyStamp))
+#define GST_IS_LATENCY_STAMP(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_LATENCY_STAMP))
+
+typedef struct _GstLatencyStamp GstLatencyStamp;
+typedef struct _GstLatencyStampClass GstLatencyStampClass;
+
+struct _GstLatencyStamp
+{
+  GstBaseTransform parent;
+
+  /* properties */
+  gchar *channel;
+
+  GstCaps *reference;
+  guint64 next_id;
+  /* the key of the element in the channels, NULL if another one of the
+   * same channel was running first */
+  gchar *registered_channel;
+
+  /* The last stamps, for the buffers that lost their meta on the way.
+   * Protected by the object lock */
+  GstDebugPtsRing entries;
+};
+
+struct _GstLatencyStampClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_latency_stamp_get_type (void);
+
+GstCaps *gst_latency_stamp_make_reference (const gchar * channel);
+
+gboolean gst_latency_stamp_lookup (const gchar * channel, GstClockTime pts,
+    guint64 * id, GstClockTime * time);
+
+G_END_DECLS
+
+#endif
@@ -26,7 +26,10 @@
 #include <gst/video/video.h>
 #include <gio/gio.h>
 
+#include <string.h>
+
 #include "gstdebugutilsbadelements.h"
+#include "gsthistogramutils.h"
 #include "gstvideocodectestsink.h"
 
 /**
@@ -45,10 +48,46 @@
  * * "checksum-type"  G_TYPE_STRING The checksum type (only MD5 is supported)
  * * "checksum"       G_TYPE_STRING The checksum as a string
  *
+ * If #GstVideoCodecTestSink:manifest is set, each frame is also checked
+ * against the expected checksums and the message has these fields too
+ * (Since: 1.24):
+ *
+ * * "frames-expected"   G_TYPE_UINT Number of checksums in the manifest
+ * * "frames-mismatched" G_TYPE_UINT Number of frames with a different
+ *   checksum, including the missing and extra frames
+ * * "first-mismatch"    G_TYPE_INT64 Index of the first of them, or -1
+ *
+ * It is preceded by an element message of type `conformance/stats` with
+ * the decoding performance (Since: 1.24):
+ *
+ * * "frames"           G_TYPE_UINT64 Number of frames received
+ * * "elapsed"          G_TYPE_UINT64 Time in ns from the start of the
+ *   element, or the previous EOS, to this one
+ * * "sink-time"        G_TYPE_UINT64 Part of it spent in this element
+ * * "fps"              G_TYPE_DOUBLE Frames per second over that time
+ * * "interval-*"       Time between frames, see below
+ * * "latency-*"        Time frames took from the #latencystamp element
+ *   upstream, if any, see below
+ *
+ * The times between frames and the latencies are described by these
+ * fields, with "interval" or "latency" as prefix:
+ *
+ * * "*-count"     G_TYPE_UINT Number of measurements
+ * * "*-histogram" GST_TYPE_ARRAY of G_TYPE_UINT Number of measurements per
+ *   bucket, bucket n counting the times from 2^n to 2^(n+1) us
+ * * "*-p50", "*-p90", "*-p99" G_TYPE_UINT64 Percentiles in ns, rounded up
+ *   to the upper bound of their bucket, if there were measurements
+ * * "*-max"       G_TYPE_UINT64 Maximum in ns, if there were measurements
+ *
  * ## Example launch lines
  * |[
  * gst-launch-1.0 videotestsrc num-buffers=2 ! videocodectestsink location=true-raw.yuv -m
  * ]|
+ * |[
+ * gst-launch-1.0 -m filesrc location=conformance.bit ! h264parse !
+ *     latencystamp ! avdec_h264 ! videocodectestsink manifest=frames.md5
+ * ]| Checks each decoded frame against the MD5 checksums of frames.md5, and
+ * measures the decoding time of each frame.
  *
  * Since: 1.20
  */
@@ -57,6 +96,7 @@ enum
 {
   PROP_0,
   PROP_LOCATION,
+  PROP_MANIFEST,
 };
 
 struct _GstVideoCodecTestSink
@@ -70,9 +110,27 @@ struct _GstVideoCodecTestSink
       GstVideoFrame * frame);
   GOutputStream *ostream;
   GChecksum *checksum;
+  /* deinterleaved chroma line of NV12 frames */
+  guchar *line;
+
+  /* per-frame checksums and the expected ones, from the manifest */
+  GChecksum *frame_checksum;
+  GPtrArray *expected;
+  guint n_mismatched;
+  gint64 first_mismatch;
+
+  /* performance, in monotonic time */
+  guint64 n_frames;
+  GstClockTime start_time;
+  GstClockTime last_frame_time;
+  GstClockTime sink_time;
+  GstDebugHistogram intervals;
+  GstDebugHistogram latencies;
+  GstCaps *stamp_reference;
 
   /* protect with object lock */
   gchar *location;
+  gchar *manifest;
 };
 
 static GstStaticPadTemplate gst_video_codec_test_sink_template =
@@ -102,6 +160,10 @@ gst_video_codec_test_sink_set_property (GObject * object, guint prop_id,
       g_free (self->location);
       self->location = g_value_dup_string (value);
       break;
+    case PROP_MANIFEST:
+      g_free (self->manifest);
+      self->manifest = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -122,6 +184,9 @@ gst_video_codec_test_sink_get_property (GObject * object, guint prop_id,
     case PROP_LOCATION:
       g_value_set_string (value, self->location);
       break;
+    case PROP_MANIFEST:
+      g_value_set_string (value, self->manifest);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -130,12 +195,60 @@ gst_video_codec_test_sink_get_property (GObject * object, guint prop_id,
   GST_OBJECT_UNLOCK (self);
 }
 
+/* Reads one checksum per line, ignoring empty lines and the ones starting
+ * with '#', and anything after the checksum, like the file names written
+ * by md5sum */
+static GPtrArray *
+gst_video_codec_test_sink_read_manifest (const gchar * manifest,
+    GError ** error)
+{
+  GPtrArray *expected;
+  gchar *contents;
+  gchar **lines;
+  guint i;
+
+  if (!g_file_get_contents (manifest, &contents, NULL, error))
+    return NULL;
+
+  expected = g_ptr_array_new_with_free_func (g_free);
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i]; i++) {
+    gchar *line = g_strstrip (lines[i]);
+    gsize len;
+
+    if (line[0] == '\0' || line[0] == '#')
+      continue;
+
+    len = strcspn (line, " \t");
+    g_ptr_array_add (expected, g_ascii_strdown (line, len));
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return expected;
+}
+
+static void
+gst_video_codec_test_sink_reset (GstVideoCodecTestSink * self)
+{
+  self->n_mismatched = 0;
+  self->first_mismatch = -1;
+  self->n_frames = 0;
+  self->start_time = g_get_monotonic_time () * GST_USECOND;
+  self->last_frame_time = GST_CLOCK_TIME_NONE;
+  self->sink_time = 0;
+  gst_debug_histogram_reset (&self->intervals);
+  gst_debug_histogram_reset (&self->latencies);
+}
+
 static gboolean
 gst_video_codec_test_sink_start (GstBaseSink * sink)
 {
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (sink);
   GError *error = NULL;
   GFile *file = NULL;
+  gchar *manifest;
   gboolean ret = TRUE;
 
   GST_OBJECT_LOCK (self);
@@ -143,9 +256,34 @@ gst_video_codec_test_sink_start (GstBaseSink * sink)
   self->checksum = g_checksum_new (self->hash);
   if (self->location)
     file = g_file_new_for_path (self->location);
+  manifest = g_strdup (self->manifest);
 
   GST_OBJECT_UNLOCK (self);
 
+  if (manifest) {
+    self->expected = gst_video_codec_test_sink_read_manifest (manifest,
+        &error);
+    if (!self->expected) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ,
+          ("Failed to read manifest '%s'.", manifest),
+          ("Reading failed: %s", error->message));
+      g_clear_error (&error);
+      g_free (manifest);
+      g_clear_object (&file);
+      g_clear_pointer (&self->checksum, g_checksum_free);
+      return FALSE;
+    }
+
+    GST_DEBUG_OBJECT (self, "expecting %u frames", self->expected->len);
+    self->frame_checksum = g_checksum_new (self->hash);
+    g_free (manifest);
+  }
+
+  /* Stamps of any channel */
+  self->stamp_reference =
+      gst_caps_new_empty_simple ("timestamp/x-gst-latency-stamp");
+  gst_video_codec_test_sink_reset (self);
+
   if (file) {
     self->ostream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
             G_FILE_CREATE_REPLACE_DESTINATION, NULL, &error));
@@ -170,6 +308,10 @@ gst_video_codec_test_sink_stop (GstBaseSink * sink)
 
   g_checksum_free (self->checksum);
   self->checksum = NULL;
+  g_clear_pointer (&self->frame_checksum, g_checksum_free);
+  g_clear_pointer (&self->expected, g_ptr_array_unref);
+  g_clear_pointer (&self->line, g_free);
+  gst_clear_caps (&self->stamp_reference);
 
   if (self->ostream) {
     GError *error = NULL;
@@ -193,6 +335,8 @@ gst_video_codec_test_sink_process_data (GstVideoCodecTestSink * self,
   GError *error = NULL;
 
   g_checksum_update (self->checksum, data, length);
+  if (self->frame_checksum)
+    g_checksum_update (self->frame_checksum, data, length);
 
   if (!self->ostream)
     return GST_FLOW_OK;
@@ -270,16 +414,14 @@ gst_video_codec_test_sink_process_nv12 (GstVideoCodecTestSink * self,
 
     for (y = 0; y < GST_VIDEO_INFO_COMP_HEIGHT (&self->vinfo, 1); y++) {
       guint width = GST_ROUND_UP_2 (GST_VIDEO_INFO_WIDTH (&self->vinfo)) / 2;
+      GstFlowReturn ret;
 
-      for (x = 0; x < width; x++) {
-        GstFlowReturn ret;
-
-        ret = gst_video_codec_test_sink_process_data (self,
-            data + 2 * x + comp, 1);
+      for (x = 0; x < width; x++)
+        self->line[x] = data[2 * x + comp];
 
-        if (ret != GST_FLOW_OK)
-          return ret;
-      }
+      ret = gst_video_codec_test_sink_process_data (self, self->line, width);
+      if (ret != GST_FLOW_OK)
+        return ret;
 
       data += stride;
     }
@@ -288,19 +430,62 @@ gst_video_codec_test_sink_process_nv12 (GstVideoCodecTestSink * self,
   return GST_FLOW_OK;
 }
 
+static void
+gst_video_codec_test_sink_check_frame (GstVideoCodecTestSink * self)
+{
+  const gchar *checksum = g_checksum_get_string (self->frame_checksum);
+
+  if (self->n_frames >= self->expected->len ||
+      g_strcmp0 (checksum, g_ptr_array_index (self->expected,
+              self->n_frames)) != 0) {
+    GST_WARNING_OBJECT (self, "frame %" G_GUINT64_FORMAT " has checksum %s, "
+        "expected %s", self->n_frames, checksum,
+        self->n_frames < self->expected->len ?
+        (gchar *) g_ptr_array_index (self->expected, self->n_frames) :
+        "no frame");
+    if (self->first_mismatch < 0)
+      self->first_mismatch = self->n_frames;
+    self->n_mismatched++;
+  }
+
+  g_checksum_reset (self->frame_checksum);
+}
+
 static GstFlowReturn
 gst_video_codec_test_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (sink);
+  GstClockTime now = g_get_monotonic_time () * GST_USECOND;
+  GstReferenceTimestampMeta *meta;
   GstVideoFrame frame;
+  GstFlowReturn ret;
+
+  if (GST_CLOCK_TIME_IS_VALID (self->last_frame_time)) {
+    gst_debug_histogram_add (&self->intervals,
+        (now - self->last_frame_time) / GST_USECOND);
+  }
+  self->last_frame_time = now;
+
+  meta = gst_buffer_get_reference_timestamp_meta (buffer,
+      self->stamp_reference);
+  if (meta && now > meta->timestamp) {
+    gst_debug_histogram_add (&self->latencies,
+        (now - meta->timestamp) / GST_USECOND);
+  }
 
   if (!gst_video_frame_map (&frame, &self->vinfo, buffer, GST_MAP_READ))
     return GST_FLOW_ERROR;
 
-  self->process (self, &frame);
+  ret = self->process (self, &frame);
 
   gst_video_frame_unmap (&frame);
-  return GST_FLOW_OK;
+
+  if (self->frame_checksum)
+    gst_video_codec_test_sink_check_frame (self);
+  self->n_frames++;
+  self->sink_time += g_get_monotonic_time () * GST_USECOND - now;
+
+  return ret;
 }
 
 static gboolean
@@ -325,6 +510,8 @@ gst_video_codec_test_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
       break;
     case GST_VIDEO_FORMAT_NV12:
       self->process = gst_video_codec_test_sink_process_nv12;
+      g_free (self->line);
+      self->line = g_malloc (GST_VIDEO_INFO_WIDTH (&self->vinfo));
       break;
     default:
       g_assert_not_reached ();
@@ -342,6 +529,26 @@ gst_video_codec_test_sink_propose_allocation (GstBaseSink * sink,
   return TRUE;
 }
 
+static void
+gst_video_codec_test_sink_post_stats (GstVideoCodecTestSink * self)
+{
+  GstClockTime elapsed;
+  GstStructure *s;
+
+  elapsed = g_get_monotonic_time () * GST_USECOND - self->start_time;
+  s = gst_structure_new ("conformance/stats",
+      "frames", G_TYPE_UINT64, self->n_frames,
+      "elapsed", G_TYPE_UINT64, elapsed,
+      "sink-time", G_TYPE_UINT64, self->sink_time,
+      "fps", G_TYPE_DOUBLE, elapsed > 0 ?
+      (gdouble) self->n_frames * GST_SECOND / elapsed : 0.0, NULL);
+  gst_debug_histogram_add_to_structure (&self->intervals, s, "interval");
+  gst_debug_histogram_add_to_structure (&self->latencies, s, "latency");
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), s));
+}
+
 static gboolean
 gst_video_codec_test_sink_event (GstBaseSink * sink, GstEvent * event)
 {
@@ -349,6 +556,7 @@ gst_video_codec_test_sink_event (GstBaseSink * sink, GstEvent * event)
 
   if (event->type == GST_EVENT_EOS) {
     const gchar *checksum_type = "UNKNOWN";
+    GstStructure *s;
 
     switch (self->hash) {
       case G_CHECKSUM_MD5:
@@ -371,12 +579,30 @@ gst_video_codec_test_sink_event (GstBaseSink * sink, GstEvent * event)
         break;
     }
 
+    gst_video_codec_test_sink_post_stats (self);
+
+    s = gst_structure_new ("conformance/checksum", "checksum-type",
+        G_TYPE_STRING, checksum_type, "checksum", G_TYPE_STRING,
+        g_checksum_get_string (self->checksum), NULL);
+
+    if (self->expected) {
+      /* The missing frames did not match either */
+      if (self->n_frames < self->expected->len) {
+        if (self->first_mismatch < 0)
+          self->first_mismatch = self->n_frames;
+        self->n_mismatched += self->expected->len - self->n_frames;
+      }
+
+      gst_structure_set (s, "frames-expected", G_TYPE_UINT,
+          self->expected->len, "frames-mismatched", G_TYPE_UINT,
+          self->n_mismatched, "first-mismatch", G_TYPE_INT64,
+          self->first_mismatch, NULL);
+    }
+
     gst_element_post_message (GST_ELEMENT (self),
-        gst_message_new_element (GST_OBJECT (self),
-            gst_structure_new ("conformance/checksum", "checksum-type",
-                G_TYPE_STRING, checksum_type, "checksum", G_TYPE_STRING,
-                g_checksum_get_string (self->checksum), NULL)));
+        gst_message_new_element (GST_OBJECT (self), s));
     g_checksum_reset (self->checksum);
+    gst_video_codec_test_sink_reset (self);
   }
 
   return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
@@ -395,6 +621,7 @@ gst_video_codec_test_sink_finalize (GObject * object)
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (object);
 
   g_free (self->location);
+  g_free (self->manifest);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -428,6 +655,30 @@ gst_video_codec_test_sink_class_init (GstVideoCodecTestSinkClass * klass)
           "File path to store non-padded I420 stream (optional).", NULL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstVideoCodecTestSink:manifest:
+   *
+   * File with the expected checksum of each frame, one per line in
+   * hexadecimal. Empty lines, lines starting with '#' and anything after
+   * the checksum on a line are ignored.
+   *
+   * The checksum of a frame is the MD5 of the bytes this element writes to
+   * #GstVideoCodecTestSink:location for it: the Y, U and V planes one
+   * after the other, each as rows of the width and height of the caps
+   * with the stride padding of the buffer left out, and no crop meta
+   * applied. Samples of the 10 and 12 bits formats are 16 bits little
+   * endian. NV12 frames are hashed in I420 layout: the luma plane, then
+   * the interleaved chroma plane split into a U plane followed by a V
+   * plane, each (width + 1) / 2 samples wide. md5sum over a raw frame of
+   * a reference decoder only matches if it uses that same layout.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_MANIFEST,
+      g_param_spec_string ("manifest", "Manifest",
+          "File with the expected checksum of each frame (optional).", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Video CODEC Test Sink", "Debug/video/Sink",
       "Sink to test video CODEC conformance",
@@ -33,17 +33,42 @@
  * This element is currently intended for transcoding pipelines,
  * although may be useful in other contexts.
  *
+ * With #GstWatchdog:warning-timeout, an element message named
+ * "GstWatchdogWarning" is posted on the bus when the flow pauses for that
+ * long, before the error of #GstWatchdog:timeout. It contains the
+ * "warning-timeout" and "timeout" fields and the statistics of the element
+ * in a "stats" field.
+ *
+ * The statistics are also available through the #GstWatchdog:stats property.
+ * They contain a histogram of the time between buffers and, if
+ * #GstWatchdog:upstream-watchdog is set, of the time buffers took from the
+ * upstream watchdog to this one. The latter matches buffers by their PTS, so
+ * that the processing time of decoders and encoders can be measured too.
+ *
+ * The statistics of all the watchdogs upstream of a pad can be collected at
+ * once with a custom query with a #GstStructure named "GstWatchdogStatsQuery".
+ * Each watchdog on the way appends its statistics to the "stats" array field
+ * of the query.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v fakesrc ! watchdog ! fakesink
  * ]|
  *
+ * |[
+ * gst-launch-1.0 -m filesrc location=in.mkv ! matroskademux ! watchdog name=in
+ *     warning-timeout=100 ! avdec_h264 ! watchdog upstream-watchdog=in !
+ *     fakesink
+ * ]| Posts a message when no frame was decoded for 100 ms. The statistics of
+ * the second watchdog contain the decoding time of the frames.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <string.h>
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
 #include "gstdebugutilsbadelements.h"
@@ -65,6 +90,8 @@ static gboolean gst_watchdog_sink_event (GstBaseTransform * trans,
     GstEvent * event);
 static gboolean gst_watchdog_src_event (GstBaseTransform * trans,
     GstEvent * event);
+static gboolean gst_watchdog_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query);
 static GstFlowReturn gst_watchdog_transform_ip (GstBaseTransform * trans,
     GstBuffer * buf);
 static void gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object,
@@ -72,11 +99,16 @@ static void gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object,
 
 static GstStateChangeReturn
 gst_watchdog_change_state (GstElement * element, GstStateChange transition);
+static void gst_watchdog_dispose (GObject * object);
+static GstStructure *gst_watchdog_get_stats (GstWatchdog * watchdog);
 
 enum
 {
   PROP_0,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_WARNING_TIMEOUT,
+  PROP_UPSTREAM_WATCHDOG,
+  PROP_STATS
 };
 
 /* class initialization */
@@ -111,11 +143,13 @@ gst_watchdog_class_init (GstWatchdogClass * klass)
       GST_DEBUG_FUNCPTR (gst_watchdog_change_state);
   gobject_class->set_property = gst_watchdog_set_property;
   gobject_class->get_property = gst_watchdog_get_property;
+  gobject_class->dispose = gst_watchdog_dispose;
   base_transform_class->start = GST_DEBUG_FUNCPTR (gst_watchdog_start);
   base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_watchdog_stop);
   base_transform_class->sink_event =
       GST_DEBUG_FUNCPTR (gst_watchdog_sink_event);
   base_transform_class->src_event = GST_DEBUG_FUNCPTR (gst_watchdog_src_event);
+  base_transform_class->query = GST_DEBUG_FUNCPTR (gst_watchdog_query);
   base_transform_class->transform_ip =
       GST_DEBUG_FUNCPTR (gst_watchdog_transform_ip);
 
@@ -125,11 +159,74 @@ gst_watchdog_class_init (GstWatchdogClass * klass)
           "received. 0 means disabled.", 0, G_MAXINT, 1000,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWatchdog:warning-timeout:
+   *
+   * Timeout (in ms) after which a "GstWatchdogWarning" element message is
+   * posted on the bus if no buffers are received. It is only posted if
+   * this is smaller than #GstWatchdog:timeout, or if that is disabled.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_WARNING_TIMEOUT,
+      g_param_spec_int ("warning-timeout", "Warning timeout",
+          "Timeout (in ms) after which an element message is posted on the bus "
+          "if no buffers are received. 0 means disabled.", 0, G_MAXINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWatchdog:upstream-watchdog:
+   *
+   * Watchdog further upstream in the pipeline. The time buffers take from
+   * there to this element is added to the statistics.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_UPSTREAM_WATCHDOG,
+      g_param_spec_object ("upstream-watchdog", "Upstream watchdog",
+          "Watchdog from which the processing time is measured",
+          GST_TYPE_WATCHDOG, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWatchdog:stats:
+   *
+   * Statistics in a #GstStructure named "GstWatchdogStats" with the name of
+   * the element in a "name" field, and for the time between buffers:
+   *
+   * - "gap-count" (guint): number of measurements
+   * - "gap-histogram" (GstValueArray of guint): number of measurements per
+   *   bucket, bucket n counting the times from 2^n to 2^(n+1) us
+   * - "gap-p50", "gap-p90", "gap-p99" (guint64): percentiles in ns, rounded
+   *   up to the upper bound of their bucket
+   * - "gap-max" (guint64): maximum in ns
+   *
+   * If #GstWatchdog:upstream-watchdog is set, the same fields with a
+   * "processing" prefix describe the time buffers took from there.
+   *
+   * The statistics are reset when going from READY to PAUSED.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics of the buffer flow", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_watchdog_init (GstWatchdog * watchdog)
 {
+  g_weak_ref_init (&watchdog->upstream_watchdog, NULL);
+}
+
+static void
+gst_watchdog_dispose (GObject * object)
+{
+  GstWatchdog *watchdog = GST_WATCHDOG (object);
+
+  g_weak_ref_set (&watchdog->upstream_watchdog, NULL);
+
+  G_OBJECT_CLASS (gst_watchdog_parent_class)->dispose (object);
 }
 
 static void
@@ -147,6 +244,20 @@ gst_watchdog_set_property (GObject * object, guint property_id,
       gst_watchdog_feed (watchdog, NULL, FALSE);
       GST_OBJECT_UNLOCK (watchdog);
       break;
+    case PROP_WARNING_TIMEOUT:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->warning_timeout = g_value_get_int (value);
+      gst_watchdog_feed (watchdog, NULL, FALSE);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_UPSTREAM_WATCHDOG:{
+      GstWatchdog *upstream = g_value_get_object (value);
+
+      if (upstream)
+        g_atomic_int_set (&upstream->paired, TRUE);
+      g_weak_ref_set (&watchdog->upstream_watchdog, upstream);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -165,6 +276,16 @@ gst_watchdog_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_int (value, watchdog->timeout);
       break;
+    case PROP_WARNING_TIMEOUT:
+      g_value_set_int (value, watchdog->warning_timeout);
+      break;
+    case PROP_UPSTREAM_WATCHDOG:
+      g_value_take_object (value,
+          g_weak_ref_get (&watchdog->upstream_watchdog));
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_watchdog_get_stats (watchdog));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -198,6 +319,67 @@ gst_watchdog_trigger (gpointer ptr)
   return FALSE;
 }
 
+/* Can be called from any thread without locking */
+static GstStructure *
+gst_watchdog_get_stats (GstWatchdog * watchdog)
+{
+  GstStructure *s;
+  GstWatchdog *upstream;
+  gchar *name;
+
+  name = gst_object_get_name (GST_OBJECT (watchdog));
+  s = gst_structure_new ("GstWatchdogStats", "name", G_TYPE_STRING, name,
+      NULL);
+  g_free (name);
+
+  gst_debug_histogram_add_to_structure (&watchdog->gaps, s, "gap");
+
+  upstream = g_weak_ref_get (&watchdog->upstream_watchdog);
+  if (upstream) {
+    gst_debug_histogram_add_to_structure (&watchdog->processing, s,
+        "processing");
+    gst_object_unref (upstream);
+  }
+
+  return s;
+}
+
+static gboolean
+gst_watchdog_warn (gpointer ptr)
+{
+  GstWatchdog *watchdog = GST_WATCHDOG (ptr);
+  GstStructure *s;
+
+  GST_DEBUG_OBJECT (watchdog, "watchdog warning");
+
+  s = gst_structure_new ("GstWatchdogWarning",
+      "warning-timeout", G_TYPE_INT, watchdog->warning_timeout,
+      "timeout", G_TYPE_INT, watchdog->timeout, NULL);
+  gst_structure_take (s, "stats", gst_watchdog_get_stats (watchdog));
+
+  gst_element_post_message (GST_ELEMENT (watchdog),
+      gst_message_new_element (GST_OBJECT (watchdog), s));
+
+  return FALSE;
+}
+
+/*  Call with OBJECT_LOCK taken */
+static void
+gst_watchdog_clear_sources (GstWatchdog * watchdog)
+{
+  if (watchdog->source) {
+    g_source_destroy (watchdog->source);
+    g_source_unref (watchdog->source);
+    watchdog->source = NULL;
+  }
+
+  if (watchdog->warning_source) {
+    g_source_destroy (watchdog->warning_source);
+    g_source_unref (watchdog->warning_source);
+    watchdog->warning_source = NULL;
+  }
+}
+
 static gboolean
 gst_watchdog_quit_mainloop (gpointer ptr)
 {
@@ -214,7 +396,7 @@ gst_watchdog_quit_mainloop (gpointer ptr)
 static void
 gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object, gboolean force)
 {
-  if (watchdog->source) {
+  if (watchdog->source || watchdog->warning_source) {
     if (watchdog->waiting_for_flush_start) {
       if (mini_object && GST_IS_EVENT (mini_object) &&
           GST_EVENT_TYPE (mini_object) == GST_EVENT_FLUSH_START) {
@@ -241,24 +423,32 @@ gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object, gboolean force)
         force = TRUE;
       }
     }
-    g_source_destroy (watchdog->source);
-    g_source_unref (watchdog->source);
-    watchdog->source = NULL;
-
+    gst_watchdog_clear_sources (watchdog);
   }
 
-  if (watchdog->timeout == 0) {
-    GST_LOG_OBJECT (watchdog, "Timeout is 0 => nothing to do");
+  if (watchdog->timeout == 0 && watchdog->warning_timeout == 0) {
+    GST_LOG_OBJECT (watchdog, "Timeouts are 0 => nothing to do");
   } else if (watchdog->main_context == NULL) {
     GST_LOG_OBJECT (watchdog, "No maincontext => nothing to do");
   } else if ((GST_STATE (watchdog) != GST_STATE_PLAYING) && force == FALSE) {
     GST_LOG_OBJECT (watchdog,
         "Not in playing and force is FALSE => Nothing to do");
   } else {
-    watchdog->source = g_timeout_source_new (watchdog->timeout);
-    g_source_set_callback (watchdog->source, gst_watchdog_trigger,
-        gst_object_ref (watchdog), gst_object_unref);
-    g_source_attach (watchdog->source, watchdog->main_context);
+    if (watchdog->timeout > 0) {
+      watchdog->source = g_timeout_source_new (watchdog->timeout);
+      g_source_set_callback (watchdog->source, gst_watchdog_trigger,
+          gst_object_ref (watchdog), gst_object_unref);
+      g_source_attach (watchdog->source, watchdog->main_context);
+    }
+
+    if (watchdog->warning_timeout > 0 && (watchdog->timeout == 0 ||
+            watchdog->warning_timeout < watchdog->timeout)) {
+      watchdog->warning_source =
+          g_timeout_source_new (watchdog->warning_timeout);
+      g_source_set_callback (watchdog->warning_source, gst_watchdog_warn,
+          gst_object_ref (watchdog), gst_object_unref);
+      g_source_attach (watchdog->warning_source, watchdog->main_context);
+    }
   }
 }
 
@@ -270,6 +460,11 @@ gst_watchdog_start (GstBaseTransform * trans)
   GST_DEBUG_OBJECT (watchdog, "start");
   GST_OBJECT_LOCK (watchdog);
 
+  gst_debug_histogram_reset (&watchdog->gaps);
+  gst_debug_histogram_reset (&watchdog->processing);
+  g_atomic_int_set (&watchdog->reset_gap, TRUE);
+  gst_debug_pts_ring_reset (&watchdog->arrivals);
+
   watchdog->main_context = g_main_context_new ();
   watchdog->main_loop = g_main_loop_new (watchdog->main_context, TRUE);
   watchdog->thread = g_thread_new ("watchdog", gst_watchdog_thread, watchdog);
@@ -287,11 +482,7 @@ gst_watchdog_stop (GstBaseTransform * trans)
   GST_DEBUG_OBJECT (watchdog, "stop");
   GST_OBJECT_LOCK (watchdog);
 
-  if (watchdog->source) {
-    g_source_destroy (watchdog->source);
-    g_source_unref (watchdog->source);
-    watchdog->source = NULL;
-  }
+  gst_watchdog_clear_sources (watchdog);
 
   /* dispatch an idle event that trigger g_main_loop_quit to avoid race
    * between g_main_loop_run and g_main_loop_quit */
@@ -321,6 +512,10 @@ gst_watchdog_sink_event (GstBaseTransform * trans, GstEvent * event)
 
   GST_DEBUG_OBJECT (watchdog, "sink_event");
 
+  /* Don't count the time a seek took as a gap in the stream */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+    g_atomic_int_set (&watchdog->reset_gap, TRUE);
+
   GST_OBJECT_LOCK (watchdog);
   gst_watchdog_feed (watchdog, event, FALSE);
   GST_OBJECT_UNLOCK (watchdog);
@@ -358,14 +553,64 @@ gst_watchdog_src_event (GstBaseTransform * trans, GstEvent * event)
       event);
 }
 
+static gboolean
+gst_watchdog_query (GstBaseTransform * trans, GstPadDirection direction,
+    GstQuery * query)
+{
+  GstWatchdog *watchdog = GST_WATCHDOG (trans);
+
+  if (!gst_debug_stats_query_has_name (query, "GstWatchdogStatsQuery"))
+    return GST_BASE_TRANSFORM_CLASS (gst_watchdog_parent_class)->query (trans,
+        direction, query);
+
+  GST_DEBUG_OBJECT (watchdog, "adding statistics to query");
+  gst_debug_stats_query_add (query, gst_watchdog_get_stats (watchdog));
+
+  /* Let the other watchdogs on the way add theirs, the query succeeded
+   * whether there are any or not */
+  GST_BASE_TRANSFORM_CLASS (gst_watchdog_parent_class)->query (trans,
+      direction, query);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_watchdog_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 {
   GstWatchdog *watchdog = GST_WATCHDOG (trans);
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+  GstWatchdog *upstream;
+  gint64 now;
 
   GST_DEBUG_OBJECT (watchdog, "transform_ip");
 
+  now = g_get_monotonic_time ();
+  if (!g_atomic_int_compare_and_exchange (&watchdog->reset_gap, TRUE, FALSE))
+    gst_debug_histogram_add (&watchdog->gaps,
+        now - watchdog->last_buffer_time);
+  watchdog->last_buffer_time = now;
+
+  upstream = g_weak_ref_get (&watchdog->upstream_watchdog);
+  if (upstream) {
+    gint64 arrival = 0;
+
+    if (GST_CLOCK_TIME_IS_VALID (pts)) {
+      const GstDebugPtsEntry *entry;
+
+      GST_OBJECT_LOCK (upstream);
+      entry = gst_debug_pts_ring_find (&upstream->arrivals, pts);
+      if (entry)
+        arrival = entry->time;
+      GST_OBJECT_UNLOCK (upstream);
+    }
+    if (arrival != 0)
+      gst_debug_histogram_add (&watchdog->processing, now - arrival);
+    gst_object_unref (upstream);
+  }
+
   GST_OBJECT_LOCK (watchdog);
+  if (g_atomic_int_get (&watchdog->paired) && GST_CLOCK_TIME_IS_VALID (pts))
+    gst_debug_pts_ring_add (&watchdog->arrivals, pts, 0, now);
   gst_watchdog_feed (watchdog, buf, FALSE);
   GST_OBJECT_UNLOCK (watchdog);
 
@@ -385,7 +630,8 @@ gst_watchdog_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
-      /* Activate timer */
+      /* Activate timer, and don't count the time spent in PAUSED as a gap */
+      g_atomic_int_set (&watchdog->reset_gap, TRUE);
       GST_OBJECT_LOCK (watchdog);
       gst_watchdog_feed (watchdog, NULL, FALSE);
       GST_OBJECT_UNLOCK (watchdog);
@@ -406,13 +652,9 @@ gst_watchdog_change_state (GstElement * element, GstStateChange transition)
       GST_OBJECT_UNLOCK (watchdog);
       break;
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
-      /* Disable the timer */
+      /* Disable the timers */
       GST_OBJECT_LOCK (watchdog);
-      if (watchdog->source) {
-        g_source_destroy (watchdog->source);
-        g_source_unref (watchdog->source);
-        watchdog->source = NULL;
-      }
+      gst_watchdog_clear_sources (watchdog);
       GST_OBJECT_UNLOCK (watchdog);
       break;
     default:
@@ -23,6 +23,8 @@
 
 #include <gst/base/gstbasetransform.h>
 
+#include "gsthistogramutils.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_WATCHDOG   (gst_watchdog_get_type())
@@ -40,15 +42,30 @@ struct _GstWatchdog
 
   /* properties */
   int timeout;
+  int warning_timeout;
+  GWeakRef upstream_watchdog;
 
   GMainContext *main_context;
   GMainLoop *main_loop;
   GThread *thread;
   GSource *source;
+  GSource *warning_source;
 
   gboolean waiting_for_a_buffer;
   gboolean waiting_for_flush_start;
   gboolean waiting_for_flush_stop;
+
+  /* time between buffers, and time since the buffers with the same PTS went
+   * through the upstream watchdog */
+  GstDebugHistogram gaps;
+  GstDebugHistogram processing;
+  gint64 last_buffer_time;
+  gint reset_gap;
+
+  /* Set when a downstream watchdog measures the processing time from us,
+   * the arrivals are then protected by the object lock */
+  gint paired;
+  GstDebugPtsRing arrivals;
 };
 
 struct _GstWatchdogClass
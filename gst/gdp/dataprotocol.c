@@ -133,8 +133,7 @@ G_STMT_START {							\
 #define CRC_INIT   0xFFFF
 
 static guint16 gst_dp_crc (const guint8 * buffer, guint length);
-static guint16 gst_dp_crc_from_memory_maps (const GstMapInfo * maps,
-    guint n_maps);
+static guint16 gst_dp_crc_from_buffer (GstBuffer * buffer);
 
 /* payloading functions */
 
@@ -148,6 +147,7 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   guint16 flags_mask;
   guint16 header_crc = 0, crc = 0;
   gsize buffer_size;
+  guint n_mems, i;
 
   mem = gst_allocator_alloc (NULL, GST_DP_HEADER_LENGTH, NULL);
   gst_memory_map (mem, &map, GST_MAP_READWRITE);
@@ -156,32 +156,9 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* version, flags, type */
   GST_DP_INIT_HEADER (h, GST_DP_VERSION_1_0, flags, GST_DP_PAYLOAD_BUFFER);
 
-  if ((flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD)) {
-    GstMapInfo *maps;
-    guint n_maps, i;
-
-    buffer_size = 0;
-
-    n_maps = gst_buffer_n_memory (buffer);
-    if (n_maps > 0) {
-      maps = g_newa (GstMapInfo, n_maps);
-
-      for (i = 0; i < n_maps; ++i) {
-        GstMemory *mem;
-
-        mem = gst_buffer_peek_memory (buffer, i);
-        gst_memory_map (mem, &maps[i], GST_MAP_READ);
-        buffer_size += maps[i].size;
-      }
-
-      crc = gst_dp_crc_from_memory_maps (maps, n_maps);
-
-      for (i = 0; i < n_maps; ++i)
-        gst_memory_unmap (maps[i].memory, &maps[i]);
-    }
-  } else {
-    buffer_size = gst_buffer_get_size (buffer);
-  }
+  buffer_size = gst_buffer_get_size (buffer);
+  if ((flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    crc = gst_dp_crc_from_buffer (buffer);
 
   /* buffer properties */
   GST_WRITE_UINT32_BE (h + 6, buffer_size);
@@ -220,8 +197,14 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* header */
   gst_buffer_append_memory (ret_buf, mem);
 
-  /* buffer data */
-  return gst_buffer_append (ret_buf, gst_buffer_ref (buffer));
+  /* buffer data, the memories are shared and not copied, unlike with
+   * gst_buffer_append() which would copy the whole buffer when it is not
+   * writable */
+  n_mems = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n_mems; i++)
+    gst_buffer_append_memory (ret_buf, gst_buffer_get_memory (buffer, i));
+
+  return ret_buf;
 }
 
 GstBuffer *
@@ -365,6 +348,50 @@ static const guint16 gst_dp_crc_table[256] = {
   0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
 };
 
+/* gst_dp_crc_tables[k][b] is the CRC of the byte b followed by k + 1 zero
+ * bytes, which allows processing 8 bytes at once ("slicing-by-8") */
+static guint16 gst_dp_crc_tables[7][256];
+
+static void
+gst_dp_crc_init_tables (void)
+{
+  static gsize once = 0;
+
+  if (g_once_init_enter (&once)) {
+    const guint16 *prev = gst_dp_crc_table;
+    guint i, b;
+
+    for (i = 0; i < G_N_ELEMENTS (gst_dp_crc_tables); i++) {
+      for (b = 0; b < 256; b++)
+        gst_dp_crc_tables[i][b] = (guint16) ((prev[b] << 8) ^
+            gst_dp_crc_table[prev[b] >> 8]);
+      prev = gst_dp_crc_tables[i];
+    }
+    g_once_init_leave (&once, 1);
+  }
+}
+
+static guint16
+gst_dp_crc_update (guint16 crc_register, const guint8 * buffer, gsize length)
+{
+  const guint16 *t0 = gst_dp_crc_table;
+  guint16 (*t)[256] = gst_dp_crc_tables;
+
+  for (; length >= 8; length -= 8, buffer += 8) {
+    crc_register = t[6][buffer[0] ^ (crc_register >> 8)] ^
+        t[5][buffer[1] ^ (crc_register & 0xff)] ^
+        t[4][buffer[2]] ^ t[3][buffer[3]] ^ t[2][buffer[4]] ^
+        t[1][buffer[5]] ^ t[0][buffer[6]] ^ t0[buffer[7]];
+  }
+
+  for (; length--;) {
+    crc_register = (guint16) ((crc_register << 8) ^
+        t0[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+  }
+
+  return crc_register;
+}
+
 /**
  * gst_dp_crc:
  * @buffer: array of bytes
@@ -379,50 +406,42 @@ static const guint16 gst_dp_crc_table[256] = {
 static guint16
 gst_dp_crc (const guint8 * buffer, guint length)
 {
-  guint16 crc_register = CRC_INIT;
-
   if (length == 0)
     return 0;
 
   g_assert (buffer != NULL);
 
-  /* calc CRC */
-  for (; length--;) {
-    crc_register = (guint16) ((crc_register << 8) ^
-        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-  }
-  return (0xffff ^ crc_register);
+  gst_dp_crc_init_tables ();
+
+  return (0xffff ^ gst_dp_crc_update (CRC_INIT, buffer, length));
 }
 
+/* CRC of all the memories of @buffer, mapped one by one so that they are
+ * never merged */
 static guint16
-gst_dp_crc_from_memory_maps (const GstMapInfo * maps, guint n_maps)
+gst_dp_crc_from_buffer (GstBuffer * buffer)
 {
   guint16 crc_register = CRC_INIT;
-  gsize total_length = 0;
+  guint n_mems, i;
 
-  if (n_maps == 0)
+  if (gst_buffer_get_size (buffer) == 0)
     return 0;
 
-  g_assert (maps != NULL);
-
-  /* calc CRC */
-  while (n_maps > 0) {
-    guint8 *buffer = maps->data;
-    gsize length = maps->size;
+  gst_dp_crc_init_tables ();
 
-    total_length += length;
+  n_mems = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n_mems; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    GstMapInfo map;
 
-    while (length-- > 0) {
-      crc_register = (guint16) ((crc_register << 8) ^
-          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+    if (!gst_memory_map (mem, &map, GST_MAP_READ)) {
+      GST_WARNING ("could not map memory %u for the crc", i);
+      continue;
     }
-    --n_maps;
-    ++maps;
+    crc_register = gst_dp_crc_update (crc_register, map.data, map.size);
+    gst_memory_unmap (mem, &map);
   }
 
-  if (G_UNLIKELY (total_length == 0))
-    return 0;
-
   return (0xffff ^ crc_register);
 }
 
@@ -518,6 +537,48 @@ gst_dp_buffer_from_header (guint header_length, const guint8 * header,
   return buffer;
 }
 
+/**
+ * gst_dp_buffer_from_header_and_payload:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: (transfer full): a #GstBuffer containing the packet payload
+ *
+ * Creates a #GstBuffer from the given header, using the memories of
+ * @payload as its data without copying them.
+ *
+ * This function does not check the header passed to it, use
+ * gst_dp_validate_header() first if the header data is unchecked.
+ *
+ * Returns: A #GstBuffer if the buffer was successfully created, or NULL.
+ */
+GstBuffer *
+gst_dp_buffer_from_header_and_payload (guint header_length,
+    const guint8 * header, GstBuffer * payload)
+{
+  GstBuffer *buffer;
+
+  g_return_val_if_fail (header != NULL, NULL);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, NULL);
+  g_return_val_if_fail (GST_DP_HEADER_PAYLOAD_TYPE (header) ==
+      GST_DP_PAYLOAD_BUFFER, NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (payload), NULL);
+
+  /* only take the memories, the metadata of the payload is the one of the
+   * transport */
+  buffer = gst_buffer_new ();
+  gst_buffer_copy_into (buffer, payload, GST_BUFFER_COPY_MEMORY, 0, -1);
+  gst_buffer_unref (payload);
+
+  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
+  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
+  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
+  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
+  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
+  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+
+  return buffer;
+}
+
 /**
  * gst_dp_caps_from_packet:
  * @header_length: the length of the packet header
@@ -754,6 +815,47 @@ crc_error:
   }
 }
 
+/**
+ * gst_dp_validate_payload_buffer:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: a #GstBuffer containing the packet payload
+ *
+ * Same as gst_dp_validate_payload(), without requiring the payload to be
+ * contiguous in memory.
+ *
+ * Returns: %TRUE if the CRC matches, or no CRC checksum is present.
+ */
+gboolean
+gst_dp_validate_payload_buffer (guint header_length, const guint8 * header,
+    GstBuffer * payload)
+{
+  guint16 crc_read, crc_calculated;
+
+  g_return_val_if_fail (header != NULL, FALSE);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, FALSE);
+  g_return_val_if_fail (GST_IS_BUFFER (payload), FALSE);
+
+  if (!(GST_DP_HEADER_FLAGS (header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    return TRUE;
+
+  crc_read = GST_DP_HEADER_CRC_PAYLOAD (header);
+  crc_calculated = gst_dp_crc_from_buffer (payload);
+  if (crc_read != crc_calculated)
+    goto crc_error;
+
+  GST_LOG ("payload crc validation: %02x", crc_read);
+  return TRUE;
+
+  /* ERRORS */
+crc_error:
+  {
+    GST_WARNING ("payload crc mismatch: read %02x, calculated %02x", crc_read,
+        crc_calculated);
+    return FALSE;
+  }
+}
+
 /**
  * gst_dp_validate_packet:
  * @header_length: the length of the packet header
@@ -90,6 +90,7 @@ static void gst_gdp_depay_set_property (GObject * object, guint prop_id,
 static void gst_gdp_depay_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_gdp_depay_decide_allocation (GstGDPDepay * depay);
+static gboolean gst_gdp_depay_can_share_payload (GstGDPDepay * depay);
 
 static void
 gst_gdp_depay_class_init (GstGDPDepayClass * klass)
@@ -343,7 +344,10 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto wrong_type;
         }
 
-        if (this->payload_length) {
+        /* buffer payloads are validated once taken from the adapter, they
+         * may span several input buffers */
+        if (this->payload_length &&
+            this->payload_type != GST_DP_PAYLOAD_BUFFER) {
           const guint8 *data;
           gboolean res;
 
@@ -365,21 +369,37 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto no_caps;
 
         GST_LOG_OBJECT (this, "reading GDP buffer from adapter");
-        buf =
-            gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
-            this->allocator, &this->allocation_params);
-        if (!buf)
-          goto buffer_failed;
+        if (this->payload_length > 0 &&
+            gst_gdp_depay_can_share_payload (this)) {
+          GstBuffer *payload;
+
+          /* use the received memories as they are, without merging them */
+          payload = gst_adapter_take_buffer_fast (this->adapter,
+              this->payload_length);
+          buf = gst_dp_buffer_from_header_and_payload (GST_DP_HEADER_LENGTH,
+              this->header, payload);
+        } else {
+          buf = gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
+              this->allocator, &this->allocation_params);
+
+          /* now take the payload if there is any */
+          if (buf && this->payload_length > 0) {
+            GstMapInfo map;
 
-        /* now take the payload if there is any */
-        if (this->payload_length > 0) {
-          GstMapInfo map;
+            gst_buffer_map (buf, &map, GST_MAP_WRITE);
+            gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
+            gst_buffer_unmap (buf, &map);
 
-          gst_buffer_map (buf, &map, GST_MAP_WRITE);
-          gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
-          gst_buffer_unmap (buf, &map);
+            gst_adapter_flush (this->adapter, this->payload_length);
+          }
+        }
+        if (!buf)
+          goto buffer_failed;
 
-          gst_adapter_flush (this->adapter, this->payload_length);
+        if (!gst_dp_validate_payload_buffer (GST_DP_HEADER_LENGTH,
+                this->header, buf)) {
+          gst_buffer_unref (buf);
+          goto payload_validate_error;
         }
 
         if (GST_BUFFER_TIMESTAMP (buf) > -this->ts_offset)
@@ -548,6 +568,21 @@ gst_gdp_depay_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
+/* The payload can be pushed in the memories it was received in, unless
+ * downstream asked for memory that they might not be compatible with */
+static gboolean
+gst_gdp_depay_can_share_payload (GstGDPDepay * this)
+{
+  const GstAllocationParams *params = &this->allocation_params;
+
+  if (this->allocator &&
+      g_strcmp0 (this->allocator->mem_type, GST_ALLOCATOR_SYSMEM) != 0)
+    return FALSE;
+
+  return params->flags == 0 && params->prefix == 0 && params->padding == 0 &&
+      params->align <= gst_memory_alignment;
+}
+
 static void
 gst_gdp_depay_decide_allocation (GstGDPDepay * gdpdepay)
 {
@@ -228,7 +228,7 @@ gst_inter_audio_sink_stop (GstBaseSink * sink)
   GST_DEBUG_OBJECT (interaudiosink, "stop");
 
   g_mutex_lock (&interaudiosink->surface->mutex);
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
+  gst_inter_surface_clear_audio (interaudiosink->surface);
   memset (&interaudiosink->surface->audio_info, 0, sizeof (GstAudioInfo));
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
@@ -255,7 +255,7 @@ gst_inter_audio_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   interaudiosink->surface->audio_info = info;
   interaudiosink->info = info;
   /* TODO: Ideally we would drain the source here */
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
+  gst_inter_surface_clear_audio (interaudiosink->surface);
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
   return TRUE;
@@ -323,7 +323,7 @@ gst_inter_audio_sink_render (GstBaseSink * sink, GstBuffer * buffer)
   while (n > buffer_samples) {
     GST_DEBUG_OBJECT (interaudiosink, "flushing %" GST_TIME_FORMAT,
         GST_TIME_ARGS (period_time));
-    gst_adapter_flush (interaudiosink->surface->audio_adapter,
+    gst_inter_surface_flush_audio (interaudiosink->surface,
         period_samples * bpf);
     n -= period_samples;
   }
@@ -289,6 +289,8 @@ gst_inter_audio_src_start (GstBaseSrc * src)
   interaudiosrc->surface->audio_buffer_time = interaudiosrc->buffer_time;
   interaudiosrc->surface->audio_latency_time = interaudiosrc->latency_time;
   interaudiosrc->surface->audio_period_time = interaudiosrc->period_time;
+  gst_inter_surface_add_audio_reader (interaudiosrc->surface,
+      &interaudiosrc->audio_reader);
   g_mutex_unlock (&interaudiosrc->surface->mutex);
 
   return TRUE;
@@ -301,6 +303,11 @@ gst_inter_audio_src_stop (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (interaudiosrc, "stop");
 
+  g_mutex_lock (&interaudiosrc->surface->mutex);
+  gst_inter_surface_remove_audio_reader (interaudiosrc->surface,
+      &interaudiosrc->audio_reader);
+  g_mutex_unlock (&interaudiosrc->surface->mutex);
+
   gst_inter_surface_unref (interaudiosrc->surface);
   interaudiosrc->surface = NULL;
 
@@ -365,17 +372,15 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
   period_samples =
       gst_util_uint64_scale (period_time, interaudiosrc->info.rate, GST_SECOND);
 
+  /* Each source reads from its own position, several can share a channel */
   if (bpf > 0)
-    n = gst_adapter_available (interaudiosrc->surface->audio_adapter) / bpf;
-  else
-    n = 0;
+    buffer = gst_inter_surface_read_audio (interaudiosrc->surface,
+        &interaudiosrc->audio_reader, period_samples * bpf);
 
-  if (n > period_samples)
-    n = period_samples;
-  if (n > 0) {
-    buffer = gst_adapter_take_buffer (interaudiosrc->surface->audio_adapter,
-        n * bpf);
+  if (buffer) {
+    n = gst_buffer_get_size (buffer) / bpf;
   } else {
+    n = 0;
     buffer = gst_buffer_new ();
     GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
   }
@@ -40,6 +40,7 @@ struct _GstInterAudioSrc
   GstBaseSrc base_interaudiosrc;
 
   GstInterSurface *surface;
+  GstInterSurfaceAudioReader audio_reader;
   char *channel;
 
   guint64 n_samples;
@@ -25,6 +25,9 @@
 
 #include "gstintersurface.h"
 
+/* Value of the users of a slot a writer is filling */
+#define FRAME_WRITING (G_MININT / 2)
+
 static GList *list;
 static GMutex mutex;
 
@@ -48,6 +51,7 @@ gst_inter_surface_get (const char *name)
   surface->ref_count = 1;
   surface->name = g_strdup (name);
   g_mutex_init (&surface->mutex);
+  surface->video_current = -1;
   surface->audio_adapter = gst_adapter_new ();
   surface->audio_buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   surface->audio_latency_time = DEFAULT_AUDIO_LATENCY_TIME;
@@ -68,6 +72,7 @@ gst_inter_surface_unref (GstInterSurface * surface)
   g_mutex_lock (&mutex);
   if ((--surface->ref_count) == 0) {
     GList *g;
+    guint i;
 
     for (g = list; g; g = g_list_next (g)) {
       GstInterSurface *tmp = g->data;
@@ -78,7 +83,9 @@ gst_inter_surface_unref (GstInterSurface * surface)
     }
 
     g_mutex_clear (&surface->mutex);
-    gst_buffer_replace (&surface->video_buffer, NULL);
+    for (i = 0; i < GST_INTER_SURFACE_VIDEO_FRAMES; i++)
+      gst_buffer_replace (&surface->video_frames[i].buffer, NULL);
+    g_list_free (surface->audio_readers);
     gst_buffer_replace (&surface->sub_buffer, NULL);
     gst_object_unref (surface->audio_adapter);
     g_free (surface->name);
@@ -86,3 +93,165 @@ gst_inter_surface_unref (GstInterSurface * surface)
   }
   g_mutex_unlock (&mutex);
 }
+
+/* Makes @buffer, which may be NULL, the current frame of @surface.
+ *
+ * The frame is written into a slot no reader is using, which the writer
+ * claims by swapping its users from 0 to FRAME_WRITING, and then published
+ * by pointing video_current at it. A reader that finds a slot being written
+ * or no longer current tries again, so neither side takes a lock. */
+void
+gst_inter_surface_publish_video (GstInterSurface * surface,
+    GstBuffer * buffer, const GstVideoInfo * info)
+{
+  GstInterSurfaceFrame *frame;
+  guint seqnum;
+  gint i;
+
+  /* Readers only hold a slot while they take a reference on its frame */
+  for (i = 0;; i = (i + 1) % GST_INTER_SURFACE_VIDEO_FRAMES) {
+    frame = &surface->video_frames[i];
+    if (i != g_atomic_int_get (&surface->video_current) &&
+        g_atomic_int_compare_and_exchange (&frame->users, 0, FRAME_WRITING))
+      break;
+
+    if (i == GST_INTER_SURFACE_VIDEO_FRAMES - 1)
+      g_thread_yield ();
+  }
+
+  seqnum = g_atomic_int_add (&surface->video_seqnum, 1) + 1;
+  /* 0 means no frame */
+  if (seqnum == 0)
+    seqnum = g_atomic_int_add (&surface->video_seqnum, 1) + 1;
+
+  gst_buffer_replace (&frame->buffer, buffer);
+  if (info)
+    frame->info = *info;
+  else
+    memset (&frame->info, 0, sizeof (GstVideoInfo));
+  frame->seqnum = seqnum;
+
+  g_atomic_int_set (&surface->video_current, i);
+  g_atomic_int_add (&frame->users, -FRAME_WRITING);
+}
+
+/* Returns a reference to the current frame of @surface, or NULL, along with
+ * its seqnum (0 if nothing was published yet) and video info */
+GstBuffer *
+gst_inter_surface_get_video (GstInterSurface * surface, guint * seqnum,
+    GstVideoInfo * info)
+{
+  GstInterSurfaceFrame *frame;
+  GstBuffer *buffer = NULL;
+  gint current;
+
+  for (;;) {
+    current = g_atomic_int_get (&surface->video_current);
+    if (current < 0) {
+      *seqnum = 0;
+      memset (info, 0, sizeof (GstVideoInfo));
+      return NULL;
+    }
+
+    frame = &surface->video_frames[current];
+    /* Once users is raised, a writer can't claim the slot anymore, so if it
+     * is still the current one its frame stays put until users drops */
+    if (g_atomic_int_add (&frame->users, 1) >= 0 &&
+        g_atomic_int_get (&surface->video_current) == current)
+      break;
+
+    g_atomic_int_add (&frame->users, -1);
+  }
+
+  if (frame->buffer)
+    buffer = gst_buffer_ref (frame->buffer);
+  *info = frame->info;
+  *seqnum = frame->seqnum;
+  g_atomic_int_add (&frame->users, -1);
+
+  return buffer;
+}
+
+/* The audio functions must be called with the surface mutex.
+ *
+ * The audio is kept in audio_adapter until all readers got it or it is
+ * older than the buffer time, each reader only advances its own offset. */
+void
+gst_inter_surface_add_audio_reader (GstInterSurface * surface,
+    GstInterSurfaceAudioReader * reader)
+{
+  /* Start with the oldest data that is still available, which is where the
+   * slowest reader is */
+  reader->offset = surface->audio_offset;
+  surface->audio_readers = g_list_prepend (surface->audio_readers, reader);
+}
+
+void
+gst_inter_surface_remove_audio_reader (GstInterSurface * surface,
+    GstInterSurfaceAudioReader * reader)
+{
+  surface->audio_readers = g_list_remove (surface->audio_readers, reader);
+}
+
+void
+gst_inter_surface_flush_audio (GstInterSurface * surface, gsize size)
+{
+  gst_adapter_flush (surface->audio_adapter, size);
+  surface->audio_offset += size;
+}
+
+void
+gst_inter_surface_clear_audio (GstInterSurface * surface)
+{
+  gst_inter_surface_flush_audio (surface,
+      gst_adapter_available (surface->audio_adapter));
+}
+
+/* Returns up to @max_size bytes of audio that @reader did not read yet, or
+ * NULL if there are none */
+GstBuffer *
+gst_inter_surface_read_audio (GstInterSurface * surface,
+    GstInterSurfaceAudioReader * reader, gsize max_size)
+{
+  GstBuffer *buffer = NULL;
+  guint64 min_offset;
+  gsize available, skip, size;
+  GstMapInfo map;
+  GList *l;
+
+  /* Data this reader did not get in time is gone */
+  if (reader->offset < surface->audio_offset)
+    reader->offset = surface->audio_offset;
+
+  available = gst_adapter_available (surface->audio_adapter);
+  skip = reader->offset - surface->audio_offset;
+  size = MIN (available - skip, max_size);
+
+  if (size > 0) {
+    if (skip == 0 && !surface->audio_readers->next) {
+      /* Only reader, take the data without copying it */
+      buffer = gst_adapter_take_buffer (surface->audio_adapter, size);
+      surface->audio_offset += size;
+      reader->offset += size;
+      return buffer;
+    }
+
+    buffer = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    gst_adapter_copy (surface->audio_adapter, map.data, skip, size);
+    gst_buffer_unmap (buffer, &map);
+    reader->offset += size;
+  }
+
+  /* Drop what all readers got */
+  min_offset = reader->offset;
+  for (l = surface->audio_readers; l; l = l->next) {
+    GstInterSurfaceAudioReader *other = l->data;
+
+    min_offset = MIN (min_offset, MAX (other->offset, surface->audio_offset));
+  }
+  if (min_offset > surface->audio_offset)
+    gst_inter_surface_flush_audio (surface, min_offset - surface->audio_offset);
+
+  return buffer;
+}
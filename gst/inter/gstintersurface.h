@@ -27,6 +27,27 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterSurfaceFrame GstInterSurfaceFrame;
+typedef struct _GstInterSurfaceAudioReader GstInterSurfaceAudioReader;
+
+#define GST_INTER_SURFACE_VIDEO_FRAMES 4
+
+/* One slot of the video frame ring. users counts the readers taking a
+ * reference on the frame, a writer owns the slot while it fills it */
+struct _GstInterSurfaceFrame
+{
+  gint users;
+  guint seqnum;
+  GstBuffer *buffer;
+  GstVideoInfo info;
+};
+
+/* Read position of one interaudiosrc in the audio of the surface, as an
+ * offset in bytes since the surface was created */
+struct _GstInterSurfaceAudioReader
+{
+  guint64 offset;
+};
 
 struct _GstInterSurface
 {
@@ -35,9 +56,11 @@ struct _GstInterSurface
 
   char *name;
 
-  /* video */
-  GstVideoInfo video_info;
-  int video_buffer_count;
+  /* video, published and read without taking the mutex. video_current is
+   * the slot of the last published frame, -1 if there is none yet */
+  GstInterSurfaceFrame video_frames[GST_INTER_SURFACE_VIDEO_FRAMES];
+  gint video_current;
+  guint video_seqnum;
 
   /* audio */
   GstAudioInfo audio_info;
@@ -45,9 +68,11 @@ struct _GstInterSurface
   guint64 audio_latency_time;
   guint64 audio_period_time;
 
-  GstBuffer *video_buffer;
   GstBuffer *sub_buffer;
   GstAdapter *audio_adapter;
+  /* offset of the first byte of audio_adapter */
+  guint64 audio_offset;
+  GList *audio_readers;
 };
 
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
@@ -58,6 +83,20 @@ struct _GstInterSurface
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+void gst_inter_surface_publish_video (GstInterSurface *surface,
+    GstBuffer *buffer, const GstVideoInfo *info);
+GstBuffer * gst_inter_surface_get_video (GstInterSurface *surface,
+    guint *seqnum, GstVideoInfo *info);
+
+void gst_inter_surface_add_audio_reader (GstInterSurface *surface,
+    GstInterSurfaceAudioReader *reader);
+void gst_inter_surface_remove_audio_reader (GstInterSurface *surface,
+    GstInterSurfaceAudioReader *reader);
+void gst_inter_surface_flush_audio (GstInterSurface *surface, gsize size);
+void gst_inter_surface_clear_audio (GstInterSurface *surface);
+GstBuffer * gst_inter_surface_read_audio (GstInterSurface *surface,
+    GstInterSurfaceAudioReader *reader, gsize max_size);
+
 
 G_END_DECLS
 
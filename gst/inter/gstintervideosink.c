@@ -199,9 +199,6 @@ gst_inter_video_sink_start (GstBaseSink * sink)
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
 
   intervideosink->surface = gst_inter_surface_get (intervideosink->channel);
-  g_mutex_lock (&intervideosink->surface->mutex);
-  memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
-  g_mutex_unlock (&intervideosink->surface->mutex);
 
   return TRUE;
 }
@@ -211,13 +208,7 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
-  }
-  intervideosink->surface->video_buffer = NULL;
-  memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
-  g_mutex_unlock (&intervideosink->surface->mutex);
+  gst_inter_surface_publish_video (intervideosink->surface, NULL, NULL);
 
   gst_inter_surface_unref (intervideosink->surface);
   intervideosink->surface = NULL;
@@ -236,10 +227,8 @@ gst_inter_video_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
     return FALSE;
   }
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  intervideosink->surface->video_info = info;
+  /* The sources get it along with the next frame */
   intervideosink->info = info;
-  g_mutex_unlock (&intervideosink->surface->mutex);
 
   return TRUE;
 }
@@ -252,13 +241,8 @@ gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
   GST_DEBUG_OBJECT (intervideosink, "render ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
-  }
-  intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
-  intervideosink->surface->video_buffer_count = 0;
-  g_mutex_unlock (&intervideosink->surface->mutex);
+  gst_inter_surface_publish_video (intervideosink->surface, buffer,
+      &intervideosink->info);
 
   return GST_FLOW_OK;
 }
@@ -198,16 +198,23 @@ static GstCaps *
 gst_inter_video_src_get_caps (GstBaseSrc * src, GstCaps * filter)
 {
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
+  GstVideoInfo surface_info;
+  GstBuffer *buffer;
   GstCaps *caps;
+  guint seqnum;
 
   GST_DEBUG_OBJECT (intervideosrc, "get_caps");
 
   if (!intervideosrc->surface)
     return GST_BASE_SRC_CLASS (parent_class)->get_caps (src, filter);
 
-  g_mutex_lock (&intervideosrc->surface->mutex);
-  if (intervideosrc->surface->video_info.finfo) {
-    caps = gst_video_info_to_caps (&intervideosrc->surface->video_info);
+  buffer = gst_inter_surface_get_video (intervideosrc->surface, &seqnum,
+      &surface_info);
+  if (buffer)
+    gst_buffer_unref (buffer);
+
+  if (surface_info.finfo) {
+    caps = gst_video_info_to_caps (&surface_info);
     gst_caps_set_simple (caps, "framerate", GST_TYPE_FRACTION_RANGE, 1,
         G_MAXINT, G_MAXINT, 1, NULL);
 
@@ -221,7 +228,6 @@ gst_inter_video_src_get_caps (GstBaseSrc * src, GstCaps * filter)
   } else {
     caps = NULL;
   }
-  g_mutex_unlock (&intervideosrc->surface->mutex);
 
   if (caps)
     return caps;
@@ -278,6 +284,8 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->surface = gst_inter_surface_get (intervideosrc->channel);
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
+  intervideosrc->video_seqnum = 0;
+  intervideosrc->video_buffer_count = 0;
 
   return TRUE;
 }
@@ -328,7 +336,9 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
   GstCaps *caps;
   GstBuffer *buffer;
+  GstVideoInfo surface_info;
   guint64 frames;
+  guint seqnum;
   gboolean is_gap = FALSE;
 
   GST_DEBUG_OBJECT (intervideosrc, "create");
@@ -340,9 +350,15 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
       GST_VIDEO_INFO_FPS_N (&intervideosrc->info),
       GST_VIDEO_INFO_FPS_D (&intervideosrc->info) * GST_SECOND);
 
-  g_mutex_lock (&intervideosrc->surface->mutex);
-  if (intervideosrc->surface->video_info.finfo) {
-    GstVideoInfo tmp_info = intervideosrc->surface->video_info;
+  buffer = gst_inter_surface_get_video (intervideosrc->surface, &seqnum,
+      &surface_info);
+  if (seqnum != intervideosrc->video_seqnum) {
+    intervideosrc->video_seqnum = seqnum;
+    intervideosrc->video_buffer_count = 0;
+  }
+
+  if (surface_info.finfo) {
+    GstVideoInfo tmp_info = surface_info;
 
     /* We negotiate the framerate ourselves */
     tmp_info.fps_n = intervideosrc->info.fps_n;
@@ -362,25 +378,17 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  if (intervideosrc->surface->video_buffer) {
-    /* We have a buffer to push */
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
-
-    /* Can only be true if timeout > 0 */
-    if (intervideosrc->surface->video_buffer_count == frames) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
-    }
-  }
+  /* The frame is repeated until the timeout, black frames follow */
+  if (buffer && intervideosrc->video_buffer_count > frames)
+    gst_buffer_replace (&buffer, NULL);
 
-  if (intervideosrc->surface->video_buffer_count != 0 &&
-      intervideosrc->surface->video_buffer_count != (frames + 1)) {
+  if (intervideosrc->video_buffer_count != 0 &&
+      intervideosrc->video_buffer_count != (frames + 1)) {
     /* This is a repeat of the stored buffer or of a black frame */
     is_gap = TRUE;
   }
 
-  intervideosrc->surface->video_buffer_count++;
-  g_mutex_unlock (&intervideosrc->surface->mutex);
+  intervideosrc->video_buffer_count++;
 
   if (caps) {
     gboolean ret;
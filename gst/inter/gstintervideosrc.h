@@ -48,6 +48,11 @@ struct _GstInterVideoSrc
   GstBuffer *black_frame;
   int n_frames;
   GstClockTime timestamp_offset;
+
+  /* seqnum of the last frame of the surface and how many times it was
+   * output so far */
+  guint video_seqnum;
+  guint64 video_buffer_count;
 };
 
 struct _GstInterVideoSrcClass
@@ -53,6 +53,22 @@ distribution_get_type (void)
   return static_g_define_type_id;
 }
 
+static GType
+aqm_get_type (void)
+{
+  static gsize static_g_define_type_id = 0;
+  if (g_once_init_enter (&static_g_define_type_id)) {
+    static const GEnumValue values[] = {
+      {AQM_NONE, "Drop tail", "none"},
+      {AQM_CODEL, "CoDel", "codel"},
+      {0, NULL, NULL}
+    };
+    GType g_define_type_id = g_enum_register_static ("GstNetSimAqm", values);
+    g_once_init_leave (&static_g_define_type_id, g_define_type_id);
+  }
+  return static_g_define_type_id;
+}
+
 enum
 {
   PROP_0,
@@ -66,6 +82,10 @@ enum
   PROP_MAX_KBPS,
   PROP_MAX_BUCKET_SIZE,
   PROP_ALLOW_REORDERING,
+  PROP_TRACE_FILE,
+  PROP_TRACE_QUEUE_SIZE,
+  PROP_TRACE_AQM,
+  PROP_TRACE_STATS,
 };
 
 /* these numbers are nothing but wild guesses and don't reflect any reality */
@@ -79,6 +99,16 @@ enum
 #define DEFAULT_MAX_KBPS -1
 #define DEFAULT_MAX_BUCKET_SIZE -1
 #define DEFAULT_ALLOW_REORDERING TRUE
+#define DEFAULT_TRACE_FILE NULL
+#define DEFAULT_TRACE_QUEUE_SIZE 0
+#define DEFAULT_TRACE_AQM AQM_NONE
+#define DEFAULT_TRACE_STATS FALSE
+
+/* bytes that can be sent at each delivery opportunity of a trace */
+#define TRACE_MTU 1500
+/* RFC 8289 defaults */
+#define CODEL_TARGET (5 * G_TIME_SPAN_MILLISECOND)
+#define CODEL_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
 
 static GstStaticPadTemplate gst_net_sim_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
@@ -470,6 +500,420 @@ gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf)
   return TRUE;
 }
 
+typedef struct
+{
+  GstBuffer *buf;
+  gsize size;
+  gsize remaining;
+  gint64 arrival_time;
+  /* the head of the queue went through the AQM and is being sent */
+  gboolean dequeued;
+} TraceItem;
+
+static void
+trace_item_free (TraceItem * item)
+{
+  gst_buffer_unref (item->buf);
+  g_slice_free (TraceItem, item);
+}
+
+static gboolean
+gst_net_sim_load_trace (GstNetSim * netsim)
+{
+  gchar *filename, *contents = NULL, **lines, **line;
+  GError *err = NULL;
+  GArray *trace;
+  guint32 last = 0;
+
+  GST_OBJECT_LOCK (netsim);
+  filename = g_strdup (netsim->trace_file);
+  GST_OBJECT_UNLOCK (netsim);
+
+  if (filename == NULL)
+    return TRUE;
+
+  if (!g_file_get_contents (filename, &contents, NULL, &err)) {
+    GST_ELEMENT_ERROR (netsim, RESOURCE, OPEN_READ,
+        ("Could not open trace file \"%s\".", filename), ("%s", err->message));
+    g_clear_error (&err);
+    g_free (filename);
+    return FALSE;
+  }
+
+  trace = g_array_new (FALSE, FALSE, sizeof (guint32));
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (line = lines; *line != NULL; line++) {
+    gchar *str = g_strstrip (*line), *end;
+    guint64 ms;
+
+    if (*str == '\0')
+      continue;
+
+    ms = g_ascii_strtoull (str, &end, 10);
+    if (*end != '\0' || ms > G_MAXUINT32 || ms < last) {
+      GST_ELEMENT_ERROR (netsim, RESOURCE, READ,
+          ("Invalid trace file \"%s\".", filename),
+          ("Expected increasing millisecond timestamps, got \"%s\"", str));
+      goto error;
+    }
+
+    last = ms;
+    g_array_append_val (trace, last);
+  }
+
+  /* the trace repeats every last timestamp milliseconds */
+  if (last == 0) {
+    GST_ELEMENT_ERROR (netsim, RESOURCE, READ,
+        ("Invalid trace file \"%s\".", filename),
+        ("The trace must span at least one millisecond"));
+    goto error;
+  }
+
+  GST_INFO_OBJECT (netsim, "Loaded %u delivery opportunities over %u ms from "
+      "%s", trace->len, last, filename);
+
+  g_strfreev (lines);
+  g_free (filename);
+
+  g_mutex_lock (&netsim->loop_mutex);
+  if (netsim->trace)
+    g_array_unref (netsim->trace);
+  netsim->trace = trace;
+  netsim->trace_period = last;
+  g_mutex_unlock (&netsim->loop_mutex);
+
+  return TRUE;
+
+error:
+  g_strfreev (lines);
+  g_free (filename);
+  g_array_unref (trace);
+  return FALSE;
+}
+
+/* Must be called with the loop mutex, once the main loop has stopped */
+static void
+gst_net_sim_trace_reset (GstNetSim * netsim)
+{
+  if (netsim->trace_source) {
+    if (!g_source_is_destroyed (netsim->trace_source))
+      g_source_destroy (netsim->trace_source);
+    g_source_unref (netsim->trace_source);
+    netsim->trace_source = NULL;
+  }
+
+  g_queue_clear_full (&netsim->trace_queue, (GDestroyNotify) trace_item_free);
+  netsim->trace_queue_bytes = 0;
+  netsim->trace_base_time = -1;
+  netsim->trace_next = 0;
+  netsim->codel_dropping = FALSE;
+  netsim->codel_count = 0;
+  netsim->codel_lastcount = 0;
+  netsim->codel_first_above_time = 0;
+  netsim->codel_drop_next = 0;
+}
+
+static gint64
+gst_net_sim_trace_opportunity_time (GstNetSim * netsim, guint64 index)
+{
+  guint64 cycle = index / netsim->trace->len;
+  guint32 ms = g_array_index (netsim->trace, guint32,
+      index % netsim->trace->len);
+
+  return netsim->trace_base_time +
+      (cycle * netsim->trace_period + ms) * G_TIME_SPAN_MILLISECOND;
+}
+
+/* Moves to the first delivery opportunity at or after @now. The ones before
+ * went by with an empty queue and are lost */
+static void
+gst_net_sim_trace_skip (GstNetSim * netsim, gint64 now)
+{
+  guint64 elapsed, period, cycle;
+  guint lo = 0, hi = netsim->trace->len;
+
+  if (gst_net_sim_trace_opportunity_time (netsim, netsim->trace_next) >= now)
+    return;
+
+  elapsed = now - netsim->trace_base_time;
+  period = netsim->trace_period * G_TIME_SPAN_MILLISECOND;
+  cycle = elapsed / period;
+  elapsed -= cycle * period;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (netsim->trace, guint32, mid) *
+        G_TIME_SPAN_MILLISECOND < elapsed)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  netsim->trace_next = MAX (netsim->trace_next, cycle * netsim->trace->len +
+      lo);
+}
+
+static void
+gst_net_sim_trace_add_stats (GstNetSim * netsim, GQueue * stats,
+    TraceItem * item, gint64 departure_time, const gchar * status)
+{
+  if (!netsim->trace_stats)
+    return;
+
+  g_queue_push_tail (stats, gst_structure_new ("GstNetSimPacket",
+          "status", G_TYPE_STRING, status,
+          "size", G_TYPE_UINT, (guint) item->size,
+          "arrival-time", G_TYPE_UINT64,
+          (guint64) (item->arrival_time - netsim->trace_base_time) *
+          GST_USECOND, "departure-time", G_TYPE_UINT64,
+          (guint64) (departure_time - netsim->trace_base_time) * GST_USECOND,
+          "queue-delay", G_TYPE_UINT64,
+          (guint64) (departure_time - item->arrival_time) * GST_USECOND,
+          "queue-bytes", G_TYPE_UINT, (guint) netsim->trace_queue_bytes,
+          NULL));
+}
+
+static void
+gst_net_sim_post_stats (GstNetSim * netsim, GQueue * stats)
+{
+  GstStructure *s;
+
+  while ((s = g_queue_pop_head (stats)))
+    gst_element_post_message (GST_ELEMENT_CAST (netsim),
+        gst_message_new_element (GST_OBJECT_CAST (netsim), s));
+}
+
+static void
+gst_net_sim_trace_drop_head (GstNetSim * netsim, gint64 now, GQueue * stats)
+{
+  TraceItem *item = g_queue_pop_head (&netsim->trace_queue);
+
+  netsim->trace_queue_bytes -= item->size;
+  GST_DEBUG_OBJECT (netsim, "AQM dropping packet queued for %" G_GINT64_FORMAT
+      "us", now - item->arrival_time);
+  gst_net_sim_trace_add_stats (netsim, stats, item, now, "aqm");
+  trace_item_free (item);
+}
+
+static gboolean
+gst_net_sim_codel_ok_to_drop (GstNetSim * netsim, TraceItem * item,
+    gint64 now)
+{
+  if (now - item->arrival_time < CODEL_TARGET ||
+      netsim->trace_queue_bytes - item->size <= TRACE_MTU) {
+    netsim->codel_first_above_time = 0;
+    return FALSE;
+  }
+
+  if (netsim->codel_first_above_time == 0) {
+    netsim->codel_first_above_time = now + CODEL_INTERVAL;
+    return FALSE;
+  }
+
+  return now >= netsim->codel_first_above_time;
+}
+
+static gint64
+gst_net_sim_codel_control_law (gint64 t, guint count)
+{
+  return t + CODEL_INTERVAL / sqrt (count);
+}
+
+/* The dequeue side of CoDel (RFC 8289): drops packets from the head of the
+ * queue while their sojourn time stays above the target and returns the
+ * packet to send, or NULL when everything was dropped */
+static TraceItem *
+gst_net_sim_codel_dequeue (GstNetSim * netsim, gint64 now, GQueue * stats)
+{
+  TraceItem *item = g_queue_peek_head (&netsim->trace_queue);
+  gboolean ok_to_drop;
+
+  item->dequeued = TRUE;
+  ok_to_drop = gst_net_sim_codel_ok_to_drop (netsim, item, now);
+
+  if (netsim->codel_dropping) {
+    if (!ok_to_drop)
+      netsim->codel_dropping = FALSE;
+
+    while (netsim->codel_dropping && now >= netsim->codel_drop_next) {
+      gst_net_sim_trace_drop_head (netsim, now, stats);
+      netsim->codel_count++;
+
+      item = g_queue_peek_head (&netsim->trace_queue);
+      if (item == NULL) {
+        netsim->codel_first_above_time = 0;
+        netsim->codel_dropping = FALSE;
+        break;
+      }
+
+      item->dequeued = TRUE;
+      if (!gst_net_sim_codel_ok_to_drop (netsim, item, now))
+        netsim->codel_dropping = FALSE;
+      else
+        netsim->codel_drop_next =
+            gst_net_sim_codel_control_law (netsim->codel_drop_next,
+            netsim->codel_count);
+    }
+  } else if (ok_to_drop) {
+    guint delta;
+
+    gst_net_sim_trace_drop_head (netsim, now, stats);
+
+    item = g_queue_peek_head (&netsim->trace_queue);
+    if (item) {
+      item->dequeued = TRUE;
+      gst_net_sim_codel_ok_to_drop (netsim, item, now);
+    } else {
+      netsim->codel_first_above_time = 0;
+    }
+
+    /* restart close to the previous drop rate if the last dropping state
+     * ended recently */
+    netsim->codel_dropping = TRUE;
+    delta = netsim->codel_count - netsim->codel_lastcount;
+    if (delta > 1 && now - netsim->codel_drop_next < 16 * CODEL_INTERVAL)
+      netsim->codel_count = delta;
+    else
+      netsim->codel_count = 1;
+    netsim->codel_drop_next =
+        gst_net_sim_codel_control_law (now, netsim->codel_count);
+    netsim->codel_lastcount = netsim->codel_count;
+  }
+
+  return item;
+}
+
+static gboolean gst_net_sim_trace_deliver (GstNetSim * netsim);
+
+/* Must be called with the loop mutex */
+static void
+gst_net_sim_trace_schedule (GstNetSim * netsim)
+{
+  GSource *source;
+
+  if (netsim->trace_source != NULL || netsim->main_loop == NULL ||
+      g_queue_is_empty (&netsim->trace_queue))
+    return;
+
+  source = g_source_new (&gst_net_sim_source_funcs, sizeof (GSource));
+  g_source_set_ready_time (source,
+      gst_net_sim_trace_opportunity_time (netsim, netsim->trace_next));
+  g_source_set_callback (source, (GSourceFunc) gst_net_sim_trace_deliver,
+      netsim, NULL);
+  g_source_attach (source, g_main_loop_get_context (netsim->main_loop));
+  netsim->trace_source = source;
+}
+
+/* Sends up to TRACE_MTU bytes of the queue at every delivery opportunity that
+ * is due. Packets bigger than what is left of an opportunity take several. */
+static gboolean
+gst_net_sim_trace_deliver (GstNetSim * netsim)
+{
+  GQueue delivered = G_QUEUE_INIT;
+  GQueue stats = G_QUEUE_INIT;
+  TraceItem *item;
+  gint64 now, opportunity;
+
+  g_mutex_lock (&netsim->loop_mutex);
+  g_clear_pointer (&netsim->trace_source, g_source_unref);
+  now = g_get_monotonic_time ();
+
+  while (!g_queue_is_empty (&netsim->trace_queue) &&
+      (opportunity = gst_net_sim_trace_opportunity_time (netsim,
+              netsim->trace_next)) <= now) {
+    gsize budget = TRACE_MTU;
+
+    netsim->trace_next++;
+
+    while (budget > 0) {
+      item = g_queue_peek_head (&netsim->trace_queue);
+      if (item != NULL && !item->dequeued && netsim->trace_aqm == AQM_CODEL)
+        item = gst_net_sim_codel_dequeue (netsim, opportunity, &stats);
+      if (item == NULL)
+        break;
+
+      item->dequeued = TRUE;
+      if (item->remaining > budget) {
+        item->remaining -= budget;
+        break;
+      }
+
+      budget -= item->remaining;
+      g_queue_pop_head (&netsim->trace_queue);
+      netsim->trace_queue_bytes -= item->size;
+      gst_net_sim_trace_add_stats (netsim, &stats, item, opportunity,
+          "delivered");
+      g_queue_push_tail (&delivered, item);
+    }
+  }
+
+  gst_net_sim_trace_schedule (netsim);
+  g_mutex_unlock (&netsim->loop_mutex);
+
+  gst_net_sim_post_stats (netsim, &stats);
+
+  while ((item = g_queue_pop_head (&delivered))) {
+    gst_net_sim_delay_buffer (netsim, item->buf);
+    trace_item_free (item);
+  }
+
+  return FALSE;
+}
+
+static GstFlowReturn
+gst_net_sim_trace_enqueue (GstNetSim * netsim, GstBuffer * buf)
+{
+  GQueue stats = G_QUEUE_INIT;
+  TraceItem *item;
+  gint64 now;
+
+  g_mutex_lock (&netsim->loop_mutex);
+  if (netsim->main_loop == NULL) {
+    g_mutex_unlock (&netsim->loop_mutex);
+    return GST_FLOW_FLUSHING;
+  }
+
+  now = g_get_monotonic_time ();
+  if (netsim->trace_base_time == -1)
+    netsim->trace_base_time = now;
+
+  item = g_slice_new0 (TraceItem);
+  item->buf = gst_buffer_ref (buf);
+  item->size = item->remaining = gst_buffer_get_size (buf);
+  item->arrival_time = now;
+
+  if (netsim->trace_queue_size > 0 &&
+      netsim->trace_queue_bytes + item->size > netsim->trace_queue_size) {
+    GST_DEBUG_OBJECT (netsim, "Queue full (%" G_GSIZE_FORMAT " bytes), "
+        "dropping packet", netsim->trace_queue_bytes);
+    gst_net_sim_trace_add_stats (netsim, &stats, item, now, "queue-full");
+    trace_item_free (item);
+  } else {
+    if (g_queue_is_empty (&netsim->trace_queue))
+      gst_net_sim_trace_skip (netsim, now);
+    g_queue_push_tail (&netsim->trace_queue, item);
+    netsim->trace_queue_bytes += item->size;
+    gst_net_sim_trace_schedule (netsim);
+  }
+  g_mutex_unlock (&netsim->loop_mutex);
+
+  gst_net_sim_post_stats (netsim, &stats);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_net_sim_forward (GstNetSim * netsim, GstBuffer * buf)
+{
+  if (netsim->trace != NULL)
+    return gst_net_sim_trace_enqueue (netsim, buf);
+
+  return gst_net_sim_delay_buffer (netsim, buf);
+}
+
 static GstFlowReturn
 gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -491,10 +935,10 @@ gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       g_rand_double (netsim->rand_seed) <
       (gdouble) netsim->duplicate_probability) {
     GST_DEBUG_OBJECT (netsim, "Duplicating packet");
-    gst_net_sim_delay_buffer (netsim, buf);
-    ret = gst_net_sim_delay_buffer (netsim, buf);
+    gst_net_sim_forward (netsim, buf);
+    ret = gst_net_sim_forward (netsim, buf);
   } else {
-    ret = gst_net_sim_delay_buffer (netsim, buf);
+    ret = gst_net_sim_forward (netsim, buf);
   }
 
 done:
@@ -502,6 +946,46 @@ done:
   return ret;
 }
 
+static GstStateChangeReturn
+gst_net_sim_change_state (GstElement * element, GstStateChange transition)
+{
+  GstNetSim *netsim = GST_NET_SIM (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (!gst_net_sim_load_trace (netsim))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      g_mutex_lock (&netsim->loop_mutex);
+      gst_net_sim_trace_reset (netsim);
+      g_mutex_unlock (&netsim->loop_mutex);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_net_sim_parent_class)->change_state (element,
+      transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      g_mutex_lock (&netsim->loop_mutex);
+      gst_net_sim_trace_reset (netsim);
+      g_mutex_unlock (&netsim->loop_mutex);
+      break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      g_mutex_lock (&netsim->loop_mutex);
+      g_clear_pointer (&netsim->trace, g_array_unref);
+      g_mutex_unlock (&netsim->loop_mutex);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
 
 static void
 gst_net_sim_set_property (GObject * object,
@@ -542,6 +1026,21 @@ gst_net_sim_set_property (GObject * object,
     case PROP_ALLOW_REORDERING:
       netsim->allow_reordering = g_value_get_boolean (value);
       break;
+    case PROP_TRACE_FILE:
+      GST_OBJECT_LOCK (netsim);
+      g_free (netsim->trace_file);
+      netsim->trace_file = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (netsim);
+      break;
+    case PROP_TRACE_QUEUE_SIZE:
+      netsim->trace_queue_size = g_value_get_uint (value);
+      break;
+    case PROP_TRACE_AQM:
+      netsim->trace_aqm = g_value_get_enum (value);
+      break;
+    case PROP_TRACE_STATS:
+      netsim->trace_stats = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -585,6 +1084,20 @@ gst_net_sim_get_property (GObject * object,
     case PROP_ALLOW_REORDERING:
       g_value_set_boolean (value, netsim->allow_reordering);
       break;
+    case PROP_TRACE_FILE:
+      GST_OBJECT_LOCK (netsim);
+      g_value_set_string (value, netsim->trace_file);
+      GST_OBJECT_UNLOCK (netsim);
+      break;
+    case PROP_TRACE_QUEUE_SIZE:
+      g_value_set_uint (value, netsim->trace_queue_size);
+      break;
+    case PROP_TRACE_AQM:
+      g_value_set_enum (value, netsim->trace_aqm);
+      break;
+    case PROP_TRACE_STATS:
+      g_value_set_boolean (value, netsim->trace_stats);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -608,6 +1121,8 @@ gst_net_sim_init (GstNetSim * netsim)
   netsim->rand_seed = g_rand_new ();
   netsim->main_loop = NULL;
   netsim->prev_time = GST_CLOCK_TIME_NONE;
+  g_queue_init (&netsim->trace_queue);
+  netsim->trace_base_time = -1;
 
   GST_OBJECT_FLAG_SET (netsim->sinkpad,
       GST_PAD_FLAG_PROXY_CAPS | GST_PAD_FLAG_PROXY_ALLOCATION);
@@ -624,6 +1139,10 @@ gst_net_sim_finalize (GObject * object)
   GstNetSim *netsim = GST_NET_SIM (object);
 
   g_rand_free (netsim->rand_seed);
+  g_queue_clear_full (&netsim->trace_queue, (GDestroyNotify) trace_item_free);
+  if (netsim->trace)
+    g_array_unref (netsim->trace);
+  g_free (netsim->trace_file);
   g_mutex_clear (&netsim->loop_mutex);
   g_cond_clear (&netsim->start_cond);
 
@@ -665,6 +1184,9 @@ gst_net_sim_class_init (GstNetSimClass * klass)
   gobject_class->set_property = gst_net_sim_set_property;
   gobject_class->get_property = gst_net_sim_get_property;
 
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_net_sim_change_state);
+
   g_object_class_install_property (gobject_class, PROP_MIN_DELAY,
       g_param_spec_int ("min-delay", "Minimum delay (ms)",
           "The minimum delay in ms to apply to buffers",
@@ -757,9 +1279,73 @@ gst_net_sim_class_init (GstNetSimClass * klass)
           DEFAULT_ALLOW_REORDERING,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstNetSim:trace-file:
+   *
+   * Replays the link capacity recorded in a Mahimahi style trace file instead
+   * of letting every packet through right away. Each line of the file holds
+   * the time in milliseconds at which the link can send 1500 bytes, and the
+   * trace starts over when its last timestamp is reached. Packets wait in a
+   * queue for their delivery opportunities, see #GstNetSim:trace-queue-size
+   * and #GstNetSim:trace-aqm, before the other impairments are applied.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_TRACE_FILE,
+      g_param_spec_string ("trace-file", "Trace File",
+          "Delivery opportunity trace to replay (NULL = disabled)",
+          DEFAULT_TRACE_FILE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:trace-queue-size:
+   *
+   * Maximum number of bytes waiting for a delivery opportunity, packets
+   * arriving at a full queue are dropped.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_TRACE_QUEUE_SIZE,
+      g_param_spec_uint ("trace-queue-size", "Trace Queue Size",
+          "Maximum number of bytes in the trace queue (0 = unlimited)",
+          0, G_MAXUINT, DEFAULT_TRACE_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:trace-aqm:
+   *
+   * Active queue management of the trace queue, on top of the drops of a
+   * full queue.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_TRACE_AQM,
+      g_param_spec_enum ("trace-aqm", "Trace AQM",
+          "Active queue management of the trace queue",
+          aqm_get_type (), DEFAULT_TRACE_AQM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:trace-stats:
+   *
+   * Post an element message for every packet leaving the trace queue. The
+   * GstNetSimPacket structure has the "status" of the packet ("delivered",
+   * "queue-full" or "aqm"), its "size", its "arrival-time" and
+   * "departure-time" since the first packet, the "queue-delay" and the
+   * "queue-bytes" left behind.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_TRACE_STATS,
+      g_param_spec_boolean ("trace-stats", "Trace Stats",
+          "Post an element message for every packet of the trace queue",
+          DEFAULT_TRACE_STATS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (netsim_debug, "netsim", 0, "Network simulator");
 
   gst_type_mark_as_plugin_api (distribution_get_type (), 0);
+  gst_type_mark_as_plugin_api (aqm_get_type (), 0);
 }
 
 static gboolean
@@ -53,6 +53,12 @@ typedef enum
   DISTRIBUTION_GAMMA
 } GstNetSimDistribution;
 
+typedef enum
+{
+  AQM_NONE,
+  AQM_CODEL
+} GstNetSimAqm;
+
 typedef struct
 {
   gboolean generate;
@@ -77,6 +83,20 @@ struct _GstNetSim
   NormalDistributionState delay_state;
   gint64 last_ready_time;
 
+  /* trace replay, all times in monotonic microseconds */
+  GArray *trace;                /* delivery opportunities in ms, guint32 */
+  guint32 trace_period;
+  GQueue trace_queue;
+  gsize trace_queue_bytes;
+  gint64 trace_base_time;
+  guint64 trace_next;
+  GSource *trace_source;
+  gboolean codel_dropping;
+  guint codel_count;
+  guint codel_lastcount;
+  gint64 codel_first_above_time;
+  gint64 codel_drop_next;
+
   /* properties */
   gint min_delay;
   gint max_delay;
@@ -88,6 +108,10 @@ struct _GstNetSim
   gint max_kbps;
   gint max_bucket_size;
   gboolean allow_reordering;
+  gchar *trace_file;
+  guint trace_queue_size;
+  GstNetSimAqm trace_aqm;
+  gboolean trace_stats;
 };
 
 struct _GstNetSimClass
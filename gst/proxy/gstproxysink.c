@@ -30,6 +30,13 @@
  *
  * This element also copies sticky events onto the matching proxysrc element.
  *
+ * With #GstProxySink:max-batch-buffers, small buffers are collected into
+ * buffer lists before being passed to the proxysrc, which reduces the
+ * per-buffer overhead of high packet rate streams such as audio or RTP. A
+ * list is passed on once it holds #GstProxySink:max-batch-buffers buffers,
+ * once its timestamps span #GstProxySink:max-batch-time or that much time
+ * passed since its first buffer arrived, and before any serialized event.
+ *
  * For example usage, see proxysrc.
  */
 
@@ -43,6 +50,18 @@
 #define GST_CAT_DEFAULT gst_proxy_sink_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+#define DEFAULT_MAX_BATCH_BUFFERS 0
+#define DEFAULT_MAX_BATCH_BUFFER_SIZE 1500
+#define DEFAULT_MAX_BATCH_TIME (20 * GST_MSECOND)
+
+enum
+{
+  PROP_0,
+  PROP_MAX_BATCH_BUFFERS,
+  PROP_MAX_BATCH_BUFFER_SIZE,
+  PROP_MAX_BATCH_TIME,
+};
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -58,6 +77,10 @@ GST_ELEMENT_REGISTER_DEFINE (proxysink, "proxysink", GST_RANK_NONE,
     GST_TYPE_PROXY_SINK);
 
 static void gst_proxy_sink_dispose (GObject * object);
+static void gst_proxy_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_proxy_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 static gboolean gst_proxy_sink_sink_query (GstPad * pad, GstObject * parent,
     GstQuery * query);
 static GstFlowReturn gst_proxy_sink_sink_chain (GstPad * pad,
@@ -83,6 +106,55 @@ gst_proxy_sink_class_init (GstProxySinkClass * klass)
   GST_DEBUG_CATEGORY_INIT (gst_proxy_sink_debug, "proxysink", 0, "proxy sink");
 
   object_class->dispose = gst_proxy_sink_dispose;
+  object_class->set_property = gst_proxy_sink_set_property;
+  object_class->get_property = gst_proxy_sink_get_property;
+
+  /**
+   * GstProxySink:max-batch-buffers:
+   *
+   * Maximum number of small buffers collected into a buffer list before it
+   * is passed to the proxysrc. 0 or 1 disables the batching.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (object_class, PROP_MAX_BATCH_BUFFERS,
+      g_param_spec_uint ("max-batch-buffers", "Max batch buffers",
+          "Maximum number of buffers collected into a buffer list "
+          "(0 = disabled)", 0, G_MAXUINT, DEFAULT_MAX_BATCH_BUFFERS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySink:max-batch-buffer-size:
+   *
+   * Buffers bigger than this are not batched, they are passed on right away
+   * after the buffers collected so far.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (object_class, PROP_MAX_BATCH_BUFFER_SIZE,
+      g_param_spec_uint ("max-batch-buffer-size", "Max batch buffer size",
+          "Size in bytes up to which buffers are batched", 0, G_MAXUINT,
+          DEFAULT_MAX_BATCH_BUFFER_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySink:max-batch-time:
+   *
+   * Maximum timestamp difference between the first and the last buffer of a
+   * batch, and maximum time a batch is held back when no more buffers
+   * arrive. This is added to the latency reported upstream when batching is
+   * enabled. 0 disables the batching.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (object_class, PROP_MAX_BATCH_TIME,
+      g_param_spec_uint64 ("max-batch-time", "Max batch time",
+          "Maximum time spanned by a batch in ns (0 = disabled)", 0,
+          G_MAXUINT64, DEFAULT_MAX_BATCH_TIME,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state = gst_proxy_sink_change_state;
   gstelement_class->send_event = gst_proxy_sink_send_event;
@@ -110,19 +182,93 @@ gst_proxy_sink_init (GstProxySink * self)
       GST_DEBUG_FUNCPTR (gst_proxy_sink_sink_query));
   gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
 
+  self->max_batch_buffers = DEFAULT_MAX_BATCH_BUFFERS;
+  self->max_batch_buffer_size = DEFAULT_MAX_BATCH_BUFFER_SIZE;
+  self->max_batch_time = DEFAULT_MAX_BATCH_TIME;
+  self->batch_start = GST_CLOCK_TIME_NONE;
+
   GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SINK);
 }
 
+static void
+gst_proxy_sink_stop_batch_timer (GstProxySink * self)
+{
+  if (!self->batch_timer)
+    return;
+
+  gst_clock_id_unschedule (self->batch_timer);
+  gst_clock_id_unref (self->batch_timer);
+  self->batch_timer = NULL;
+}
+
+/* Drops the buffers collected so far */
+static void
+gst_proxy_sink_clear_batch (GstProxySink * self)
+{
+  gst_proxy_sink_stop_batch_timer (self);
+  gst_clear_buffer_list (&self->batch);
+  self->batch_start = GST_CLOCK_TIME_NONE;
+}
+
 static void
 gst_proxy_sink_dispose (GObject * object)
 {
   GstProxySink *self = GST_PROXY_SINK (object);
 
   g_weak_ref_clear (&self->proxysrc);
+  gst_proxy_sink_clear_batch (self);
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+gst_proxy_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstProxySink *self = GST_PROXY_SINK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MAX_BATCH_BUFFERS:
+      self->max_batch_buffers = g_value_get_uint (value);
+      break;
+    case PROP_MAX_BATCH_BUFFER_SIZE:
+      self->max_batch_buffer_size = g_value_get_uint (value);
+      break;
+    case PROP_MAX_BATCH_TIME:
+      self->max_batch_time = g_value_get_uint64 (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_proxy_sink_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstProxySink *self = GST_PROXY_SINK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MAX_BATCH_BUFFERS:
+      g_value_set_uint (value, self->max_batch_buffers);
+      break;
+    case PROP_MAX_BATCH_BUFFER_SIZE:
+      g_value_set_uint (value, self->max_batch_buffer_size);
+      break;
+    case PROP_MAX_BATCH_TIME:
+      g_value_set_uint64 (value, self->max_batch_time);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
 static GstStateChangeReturn
 gst_proxy_sink_change_state (GstElement * element, GstStateChange transition)
 {
@@ -143,6 +289,17 @@ gst_proxy_sink_change_state (GstElement * element, GstStateChange transition)
 
   ret = gstelement_class->change_state (element, transition);
 
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* The pad is deactivated now, only a batch timeout may still run */
+      GST_PAD_STREAM_LOCK (self->sinkpad);
+      gst_proxy_sink_clear_batch (self);
+      GST_PAD_STREAM_UNLOCK (self->sinkpad);
+      break;
+    default:
+      break;
+  }
+
   return ret;
 }
 
@@ -246,6 +403,8 @@ gst_proxy_sink_send_sticky_events (GstProxySink * self, GstPad * pad,
   }
 }
 
+static void gst_proxy_sink_push_batch (GstProxySink * self, GstPad * pad);
+
 static gboolean
 gst_proxy_sink_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -257,8 +416,13 @@ gst_proxy_sink_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
   GST_LOG_OBJECT (pad, "Got %s event", GST_EVENT_TYPE_NAME (event));
 
-  if (event_type == GST_EVENT_FLUSH_STOP)
+  if (event_type == GST_EVENT_FLUSH_STOP) {
     self->pending_sticky_events = FALSE;
+    gst_proxy_sink_clear_batch (self);
+  } else if (GST_EVENT_IS_SERIALIZED (event)) {
+    /* Keep the order of the collected buffers and the event */
+    gst_proxy_sink_push_batch (self, pad);
+  }
 
   src = g_weak_ref_get (&self->proxysrc);
   if (src) {
@@ -310,15 +474,13 @@ gst_proxy_sink_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return ret;
 }
 
-static GstFlowReturn
-gst_proxy_sink_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+static void
+gst_proxy_sink_push_list (GstProxySink * self, GstPad * pad,
+    GstBufferList * list)
 {
-  GstProxySink *self = GST_PROXY_SINK (parent);
   GstProxySrc *src;
   GstFlowReturn ret = GST_FLOW_OK;
 
-  GST_LOG_OBJECT (pad, "Chaining buffer %p", buffer);
-
   src = g_weak_ref_get (&self->proxysrc);
   if (src) {
     GstPad *srcpad;
@@ -326,29 +488,125 @@ gst_proxy_sink_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
     gst_proxy_sink_send_sticky_events (self, pad, srcpad);
 
-    ret = gst_pad_push (srcpad, buffer);
+    ret = gst_pad_push_list (srcpad, list);
     gst_object_unref (srcpad);
     gst_object_unref (src);
-
-    GST_LOG_OBJECT (pad, "Chained buffer %p: %s", buffer,
+    GST_LOG_OBJECT (pad, "Chained buffer list %p: %s", list,
         gst_flow_get_name (ret));
   } else {
-    gst_buffer_unref (buffer);
-    GST_LOG_OBJECT (pad, "Dropped buffer %p: no otherpad", buffer);
+    gst_buffer_list_unref (list);
+    GST_LOG_OBJECT (pad, "Dropped buffer list %p: no otherpad", list);
   }
+}
 
-  return GST_FLOW_OK;
+/* Passes on the buffers collected by gst_proxy_sink_sink_chain(), if any */
+static void
+gst_proxy_sink_push_batch (GstProxySink * self, GstPad * pad)
+{
+  GstBufferList *list = self->batch;
+
+  if (!list)
+    return;
+
+  self->batch = NULL;
+  self->batch_start = GST_CLOCK_TIME_NONE;
+  gst_proxy_sink_stop_batch_timer (self);
+
+  GST_LOG_OBJECT (pad, "Pushing batch of %u buffers",
+      gst_buffer_list_length (list));
+  gst_proxy_sink_push_list (self, pad, list);
+}
+
+static void
+gst_proxy_sink_batch_timeout_func (GstElement * element, gpointer user_data)
+{
+  GstProxySink *self = GST_PROXY_SINK (element);
+  GstClockID id = user_data;
+
+  GST_PAD_STREAM_LOCK (self->sinkpad);
+  /* Unless the batch was passed on or dropped meanwhile */
+  if (self->batch_timer == id && !GST_PAD_IS_FLUSHING (self->sinkpad)) {
+    GST_LOG_OBJECT (self, "Batch timed out");
+    gst_proxy_sink_push_batch (self, self->sinkpad);
+  }
+  GST_PAD_STREAM_UNLOCK (self->sinkpad);
+}
+
+static gboolean
+gst_proxy_sink_batch_timeout (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  /* Don't block the clock thread, the proxysrc queue may be full */
+  gst_element_call_async (GST_ELEMENT (user_data),
+      gst_proxy_sink_batch_timeout_func, gst_clock_id_ref (id),
+      (GDestroyNotify) gst_clock_id_unref);
+
+  return TRUE;
+}
+
+/* Starts a new batch, passed on after @max_time at the latest */
+static void
+gst_proxy_sink_start_batch (GstProxySink * self, guint max_buffers,
+    GstClockTime max_time)
+{
+  GstClock *clock = gst_system_clock_obtain ();
+
+  self->batch = gst_buffer_list_new_sized (max_buffers);
+  self->batch_timer = gst_clock_new_single_shot_id (clock,
+      gst_clock_get_time (clock) + max_time);
+  gst_clock_id_wait_async (self->batch_timer, gst_proxy_sink_batch_timeout,
+      gst_object_ref (self), gst_object_unref);
+  gst_object_unref (clock);
+}
+
+/* Adds a small buffer to the current batch, and passes the batch on once it
+ * is full. Returns FALSE if the buffer is not to be batched */
+static gboolean
+gst_proxy_sink_batch_buffer (GstProxySink * self, GstPad * pad,
+    GstBuffer * buffer)
+{
+  guint max_buffers, max_buffer_size;
+  GstClockTime max_time, ts;
+
+  GST_OBJECT_LOCK (self);
+  max_buffers = self->max_batch_buffers;
+  max_buffer_size = self->max_batch_buffer_size;
+  max_time = self->max_batch_time;
+  GST_OBJECT_UNLOCK (self);
+
+  if (max_buffers <= 1 || max_time == 0 ||
+      gst_buffer_get_size (buffer) > max_buffer_size)
+    return FALSE;
+
+  ts = GST_BUFFER_DTS_OR_PTS (buffer);
+  if (!self->batch)
+    gst_proxy_sink_start_batch (self, max_buffers, max_time);
+  if (!GST_CLOCK_TIME_IS_VALID (self->batch_start))
+    self->batch_start = ts;
+  gst_buffer_list_add (self->batch, buffer);
+
+  if (gst_buffer_list_length (self->batch) >= max_buffers ||
+      (GST_CLOCK_TIME_IS_VALID (ts) &&
+          GST_CLOCK_TIME_IS_VALID (self->batch_start) &&
+          ts >= self->batch_start + max_time))
+    gst_proxy_sink_push_batch (self, pad);
+
+  return TRUE;
 }
 
 static GstFlowReturn
-gst_proxy_sink_sink_chain_list (GstPad * pad, GstObject * parent,
-    GstBufferList * list)
+gst_proxy_sink_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
   GstProxySink *self = GST_PROXY_SINK (parent);
   GstProxySrc *src;
   GstFlowReturn ret = GST_FLOW_OK;
 
-  GST_LOG_OBJECT (pad, "Chaining buffer list %p", list);
+  GST_LOG_OBJECT (pad, "Chaining buffer %p", buffer);
+
+  if (gst_proxy_sink_batch_buffer (self, pad, buffer))
+    return GST_FLOW_OK;
+
+  gst_proxy_sink_push_batch (self, pad);
 
   src = g_weak_ref_get (&self->proxysrc);
   if (src) {
@@ -357,19 +615,34 @@ gst_proxy_sink_sink_chain_list (GstPad * pad, GstObject * parent,
 
     gst_proxy_sink_send_sticky_events (self, pad, srcpad);
 
-    ret = gst_pad_push_list (srcpad, list);
+    ret = gst_pad_push (srcpad, buffer);
     gst_object_unref (srcpad);
     gst_object_unref (src);
-    GST_LOG_OBJECT (pad, "Chained buffer list %p: %s", list,
+
+    GST_LOG_OBJECT (pad, "Chained buffer %p: %s", buffer,
         gst_flow_get_name (ret));
   } else {
-    gst_buffer_list_unref (list);
-    GST_LOG_OBJECT (pad, "Dropped buffer list %p: no otherpad", list);
+    gst_buffer_unref (buffer);
+    GST_LOG_OBJECT (pad, "Dropped buffer %p: no otherpad", buffer);
   }
 
   return GST_FLOW_OK;
 }
 
+static GstFlowReturn
+gst_proxy_sink_sink_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstProxySink *self = GST_PROXY_SINK (parent);
+
+  GST_LOG_OBJECT (pad, "Chaining buffer list %p", list);
+
+  gst_proxy_sink_push_batch (self, pad);
+  gst_proxy_sink_push_list (self, pad, list);
+
+  return GST_FLOW_OK;
+}
+
 /* Wrapper function for accessing private member
  * This can also be retrieved with gst_element_get_static_pad, but that depends
  * on the implementation of GstProxySink */
@@ -386,3 +659,25 @@ gst_proxy_sink_set_proxysrc (GstProxySink * self, GstProxySrc * src)
   g_return_if_fail (self);
   g_weak_ref_set (&self->proxysrc, src);
 }
+
+/* Called by the proxysrc with the latency of the upstream pipeline */
+void
+gst_proxy_sink_update_latency (GstProxySink * self, GstQuery * query)
+{
+  gboolean live;
+  GstClockTime min, max, batch_time = 0;
+
+  GST_OBJECT_LOCK (self);
+  if (self->max_batch_buffers > 1)
+    batch_time = self->max_batch_time;
+  GST_OBJECT_UNLOCK (self);
+
+  if (batch_time == 0)
+    return;
+
+  gst_query_parse_latency (query, &live, &min, &max);
+  min += batch_time;
+  if (GST_CLOCK_TIME_IS_VALID (max))
+    max += batch_time;
+  gst_query_set_latency (query, live, min, max);
+}
@@ -50,6 +50,18 @@ struct _GstProxySink {
   gboolean pending_sticky_events;
   gboolean sent_stream_start;
   gboolean sent_caps;
+
+  /* Properties, protected by the object lock */
+  guint max_batch_buffers;
+  guint max_batch_buffer_size;
+  GstClockTime max_batch_time;
+
+  /* Small buffers collected from the streaming thread, protected by the
+   * stream lock of the sinkpad */
+  GstBufferList *batch;
+  GstClockTime batch_start;
+  /* Passes the batch on max-batch-time after its first buffer */
+  GstClockID batch_timer;
 };
 
 struct _GstProxySinkClass {
@@ -33,6 +33,14 @@
  * However, the queue may get filled up if the downstream pipeline does not
  * accept buffers quickly enough; perhaps because it is not yet PLAYING.
  *
+ * By default the upstream pipeline then blocks until there is space in the
+ * queue again. The size of the queue can be configured with the
+ * #GstProxySrc:max-size-buffers, #GstProxySrc:max-size-bytes and
+ * #GstProxySrc:max-size-time properties, and with #GstProxySrc:leaky the queue
+ * drops buffers instead, so that a slow downstream pipeline can't stall the
+ * upstream one. The fill level, the number of dropped buffers and the time
+ * buffers spent in the queue are reported by #GstProxySrc:stats.
+ *
  * ## Usage
  * 
  * |[<!-- language="C" -->
@@ -87,12 +95,54 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+/* Defaults of the internal queue */
+#define DEFAULT_MAX_SIZE_BUFFERS 200
+#define DEFAULT_MAX_SIZE_BYTES (10 * 1024 * 1024)
+#define DEFAULT_MAX_SIZE_TIME GST_SECOND
+#define DEFAULT_LEAKY GST_PROXY_SRC_LEAKY_NONE
+
 enum
 {
   PROP_0,
   PROP_PROXYSINK,
+  PROP_MAX_SIZE_BUFFERS,
+  PROP_MAX_SIZE_BYTES,
+  PROP_MAX_SIZE_TIME,
+  PROP_LEAKY,
+  PROP_STATS,
 };
 
+#define GST_TYPE_PROXY_SRC_LEAKY (gst_proxy_src_leaky_get_type ())
+static GType
+gst_proxy_src_leaky_get_type (void)
+{
+  static GType leaky_type = 0;
+  static const GEnumValue leaky[] = {
+    {GST_PROXY_SRC_LEAKY_NONE, "Not Leaky", "no"},
+    {GST_PROXY_SRC_LEAKY_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_PROXY_SRC_LEAKY_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!leaky_type) {
+    leaky_type = g_enum_register_static ("GstProxySrcLeaky", leaky);
+  }
+  return leaky_type;
+}
+
+/* Monotonic time at which a buffer or buffer list entered the queue. The
+ * buffers can be shared with other elements, so the times are kept on the
+ * side in the order the buffers entered the queue instead of on the
+ * buffers themselves. @data only identifies the buffer, no reference is
+ * held on it */
+typedef struct
+{
+  gconstpointer data;
+  gint64 time;
+} GstProxySrcEnqueueTime;
+
 /* We're not subclassing from basesrc because we don't want any of the special
  * handling it has for events/queries/etc. We just pass-through everything. */
 
@@ -114,6 +164,7 @@ static gboolean gst_proxy_src_send_event (GstElement * element,
     GstEvent * event);
 static gboolean gst_proxy_src_query (GstElement * element, GstQuery * query);
 static void gst_proxy_src_dispose (GObject * object);
+static GstStructure *gst_proxy_src_get_stats (GstProxySrc * self);
 
 static void
 gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
@@ -125,6 +176,22 @@ gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PROXYSINK:
       g_value_take_object (value, g_weak_ref_get (&self->proxysink));
       break;
+    case PROP_MAX_SIZE_BUFFERS:
+    case PROP_MAX_SIZE_BYTES:
+    case PROP_MAX_SIZE_TIME:
+      g_object_get_property (G_OBJECT (self->queue), spec->name, value);
+      break;
+    case PROP_LEAKY:{
+      gint leaky;
+
+      /* The queue has its own enum type with the same values */
+      g_object_get (self->queue, "leaky", &leaky, NULL);
+      g_value_set_enum (value, leaky);
+      break;
+    }
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_proxy_src_get_stats (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
       break;
@@ -157,6 +224,21 @@ gst_proxy_src_set_property (GObject * object, guint prop_id,
         g_object_unref (sink);
       }
       break;
+    case PROP_MAX_SIZE_BUFFERS:
+      g_object_set (self->queue, "max-size-buffers", g_value_get_uint (value),
+          NULL);
+      break;
+    case PROP_MAX_SIZE_BYTES:
+      g_object_set (self->queue, "max-size-bytes", g_value_get_uint (value),
+          NULL);
+      break;
+    case PROP_MAX_SIZE_TIME:
+      g_object_set (self->queue, "max-size-time", g_value_get_uint64 (value),
+          NULL);
+      break;
+    case PROP_LEAKY:
+      g_object_set (self->queue, "leaky", g_value_get_enum (value), NULL);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
   }
@@ -179,6 +261,90 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
       g_param_spec_object ("proxysink", "Proxysink", "Matching proxysink",
           GST_TYPE_PROXY_SINK, G_PARAM_READWRITE));
 
+  /**
+   * GstProxySrc:max-size-buffers:
+   *
+   * Max. number of buffers in the internal queue (0=disable).
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Max. number of buffers in the queue (0=disable)", 0, G_MAXUINT,
+          DEFAULT_MAX_SIZE_BUFFERS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-bytes:
+   *
+   * Max. amount of data in the internal queue (bytes, 0=disable).
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes", "Max. size (kB)",
+          "Max. amount of data in the queue (bytes, 0=disable)", 0, G_MAXUINT,
+          DEFAULT_MAX_SIZE_BYTES,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-time:
+   *
+   * Max. amount of data in the internal queue (in ns, 0=disable).
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_TIME,
+      g_param_spec_uint64 ("max-size-time", "Max. size (ns)",
+          "Max. amount of data in the queue (in ns, 0=disable)", 0, G_MAXUINT64,
+          DEFAULT_MAX_SIZE_TIME,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:leaky:
+   *
+   * Where the internal queue drops buffers when it is full. By default the
+   * upstream pipeline is blocked until there is space again.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where the queue leaks, if at all", GST_TYPE_PROXY_SRC_LEAKY,
+          DEFAULT_LEAKY,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:stats:
+   *
+   * Statistics of the internal queue in a #GstStructure named
+   * "application/x-proxysrc-stats" with the following fields:
+   *
+   * - "received" (guint64): buffers received from the proxysink
+   * - "pushed" (guint64): buffers pushed downstream
+   * - "dropped" (guint64): buffers dropped by the queue, because it was leaky
+   *   or flushing
+   * - "current-level-buffers" (guint): buffers in the queue
+   * - "current-level-bytes" (guint): bytes in the queue
+   * - "current-level-time" (guint64): amount of data in the queue (in ns)
+   * - "average-latency" (guint64): average time the buffers spent in the
+   *   queue (in ns)
+   * - "max-latency" (guint64): maximum time a buffer spent in the queue
+   *   (in ns)
+   *
+   * The statistics are reset when going from READY to PAUSED.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics of the internal queue", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_proxy_src_change_state;
   gstelement_class->send_event = gst_proxy_src_send_event;
   gstelement_class->query = gst_proxy_src_query;
@@ -188,6 +354,78 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
   gst_element_class_set_static_metadata (gstelement_class, "Proxy source",
       "Source", "Proxy source for internal process communication",
       "Sebastian Dröge <sebastian@centricular.com>");
+
+  gst_type_mark_as_plugin_api (GST_TYPE_PROXY_SRC_LEAKY, 0);
+}
+
+static guint
+gst_proxy_src_probe_info_n_buffers (GstPadProbeInfo * info)
+{
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    return gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+  return 1;
+}
+
+static GstPadProbeReturn
+gst_proxy_src_queue_sink_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstProxySrc *self = user_data;
+  GstProxySrcEnqueueTime *enqueue_time;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_FLUSH) {
+    /* The queue dropped everything it held */
+    if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) ==
+        GST_EVENT_FLUSH_STOP) {
+      GST_OBJECT_LOCK (self);
+      g_queue_clear_full (&self->enqueue_times, g_free);
+      GST_OBJECT_UNLOCK (self);
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  enqueue_time = g_new (GstProxySrcEnqueueTime, 1);
+  enqueue_time->data = GST_PAD_PROBE_INFO_DATA (info);
+  enqueue_time->time = g_get_monotonic_time ();
+
+  GST_OBJECT_LOCK (self);
+  self->in_buffers += gst_proxy_src_probe_info_n_buffers (info);
+  g_queue_push_tail (&self->enqueue_times, enqueue_time);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+gst_proxy_src_queue_src_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstProxySrc *self = user_data;
+  gconstpointer data = GST_PAD_PROBE_INFO_DATA (info);
+  GstProxySrcEnqueueTime *enqueue_time;
+  gint64 now = g_get_monotonic_time ();
+
+  GST_OBJECT_LOCK (self);
+  self->out_buffers += gst_proxy_src_probe_info_n_buffers (info);
+
+  /* The buffers leave the queue in the order they entered it, the times in
+   * front of the one of this buffer are the ones of buffers the queue
+   * dropped because it was leaky */
+  while ((enqueue_time = g_queue_pop_head (&self->enqueue_times))) {
+    if (enqueue_time->data == data) {
+      GstClockTime latency = (now - enqueue_time->time) * GST_USECOND;
+
+      self->total_latency += latency;
+      self->max_latency = MAX (self->max_latency, latency);
+      self->n_latencies++;
+      g_free (enqueue_time);
+      break;
+    }
+    g_free (enqueue_time);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_PAD_PROBE_OK;
 }
 
 static void
@@ -198,6 +436,8 @@ gst_proxy_src_init (GstProxySrc * self)
 
   GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
 
+  g_queue_init (&self->enqueue_times);
+
   /* We feed incoming buffers into a queue to decouple the downstream pipeline
    * from the upstream pipeline */
   self->queue = gst_element_factory_make ("queue", NULL);
@@ -232,8 +472,18 @@ gst_proxy_src_init (GstProxySrc * self)
    * Yes, this is a hack/workaround. */
   sinkpad = gst_element_get_static_pad (self->queue, "sink");
   gst_pad_link (self->internal_srcpad, sinkpad);
+  gst_pad_add_probe (sinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST |
+      GST_PAD_PROBE_TYPE_EVENT_FLUSH, gst_proxy_src_queue_sink_probe, self,
+      NULL);
   gst_object_unref (sinkpad);
 
+  srcpad = gst_element_get_static_pad (self->queue, "src");
+  gst_pad_add_probe (srcpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      gst_proxy_src_queue_src_probe, self, NULL);
+  gst_object_unref (srcpad);
+
   gst_bin_set_suppressed_flags (GST_BIN (self),
       GST_ELEMENT_FLAG_SOURCE | GST_ELEMENT_FLAG_SINK);
   GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
@@ -252,6 +502,10 @@ gst_proxy_src_dispose (GObject * object)
 
   g_weak_ref_set (&self->proxysink, NULL);
 
+  GST_OBJECT_LOCK (self);
+  g_queue_clear_full (&self->enqueue_times, g_free);
+  GST_OBJECT_UNLOCK (self);
+
   G_OBJECT_CLASS (gst_proxy_src_parent_class)->dispose (object);
 }
 
@@ -263,6 +517,17 @@ gst_proxy_src_change_state (GstElement * element, GstStateChange transition)
   GstProxySrc *self = GST_PROXY_SRC (element);
   GstStateChangeReturn ret;
 
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    GST_OBJECT_LOCK (self);
+    self->in_buffers = 0;
+    self->out_buffers = 0;
+    self->n_latencies = 0;
+    self->total_latency = 0;
+    self->max_latency = 0;
+    g_queue_clear_full (&self->enqueue_times, g_free);
+    GST_OBJECT_UNLOCK (self);
+  }
+
   ret = gstelement_class->change_state (element, transition);
   if (ret == GST_STATE_CHANGE_FAILURE)
     return ret;
@@ -337,6 +602,8 @@ gst_proxy_src_internal_src_query (GstPad * pad, GstObject * parent,
     sinkpad = gst_proxy_sink_get_internal_sinkpad (sink);
 
     ret = gst_pad_peer_query (sinkpad, query);
+    if (ret && GST_QUERY_TYPE (query) == GST_QUERY_LATENCY)
+      gst_proxy_sink_update_latency (sink, query);
     gst_object_unref (sinkpad);
     gst_object_unref (sink);
   }
@@ -376,6 +643,40 @@ gst_proxy_src_internal_src_event (GstPad * pad, GstObject * parent,
   return ret;
 }
 
+static GstStructure *
+gst_proxy_src_get_stats (GstProxySrc * self)
+{
+  guint level_buffers, level_bytes;
+  guint64 level_time, in, out, dropped;
+  GstClockTime avg_latency, max_latency;
+
+  /* The level is not read atomically with the counters, so buffers that are
+   * entering or leaving the queue meanwhile can briefly be miscounted */
+  g_object_get (self->queue, "current-level-buffers", &level_buffers,
+      "current-level-bytes", &level_bytes, "current-level-time", &level_time,
+      NULL);
+
+  GST_OBJECT_LOCK (self);
+  in = self->in_buffers;
+  out = self->out_buffers;
+  avg_latency = self->n_latencies ?
+      self->total_latency / self->n_latencies : 0;
+  max_latency = self->max_latency;
+  GST_OBJECT_UNLOCK (self);
+
+  dropped = in > out + level_buffers ? in - out - level_buffers : 0;
+
+  return gst_structure_new ("application/x-proxysrc-stats",
+      "received", G_TYPE_UINT64, in,
+      "pushed", G_TYPE_UINT64, out,
+      "dropped", G_TYPE_UINT64, dropped,
+      "current-level-buffers", G_TYPE_UINT, level_buffers,
+      "current-level-bytes", G_TYPE_UINT, level_bytes,
+      "current-level-time", G_TYPE_UINT64, level_time,
+      "average-latency", G_TYPE_UINT64, avg_latency,
+      "max-latency", G_TYPE_UINT64, max_latency, NULL);
+}
+
 /* Wrapper function for accessing private member */
 GstPad *
 gst_proxy_src_get_internal_srcpad (GstProxySrc * self)
@@ -37,6 +37,13 @@ typedef struct _GstProxySrc GstProxySrc;
 typedef struct _GstProxySrcClass GstProxySrcClass;
 typedef struct _GstProxySrcPrivate GstProxySrcPrivate;
 
+/* Same values as the leaky property of the internal queue */
+typedef enum {
+  GST_PROXY_SRC_LEAKY_NONE = 0,
+  GST_PROXY_SRC_LEAKY_UPSTREAM = 1,
+  GST_PROXY_SRC_LEAKY_DOWNSTREAM = 2
+} GstProxySrcLeaky;
+
 struct _GstProxySrc {
   GstBin parent;
 
@@ -56,6 +63,15 @@ struct _GstProxySrc {
 
   /* The matching proxysink; queries and events are sent to its sinkpad */
   GWeakRef proxysink;
+
+  /* Statistics of the queue, protected by the object lock */
+  guint64 in_buffers;
+  guint64 out_buffers;
+  guint64 n_latencies;
+  GstClockTime total_latency;
+  GstClockTime max_latency;
+  /* GstProxySrcEnqueueTime of the buffers in the queue, oldest first */
+  GQueue enqueue_times;
 };
 
 struct _GstProxySrcClass {
@@ -30,6 +30,11 @@
  * This elements replies to custom events 'GstRTPRetransmissionRequest' and
  * when available sends in RIST form the lost packet. This element is intented
  * to be used by ristsink element.
+ *
+ * The history of each SSRC is a ring of packets indexed by their extended
+ * sequence number. "max-size-packets" limits the number of packets it
+ * holds, the seqnums of the packets may span more than that if some of
+ * them were never received. The ring grows as needed, up to 65536 seqnums.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -48,6 +53,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_rist_rtx_send_debug);
 #define DEFAULT_MAX_SIZE_TIME    0
 #define DEFAULT_MAX_SIZE_PACKETS 100
 
+/* initial and maximum number of packets in the history of an SSRC */
+#define HISTORY_MIN_SIZE 1024
+#define HISTORY_MAX_SIZE 65536
+
 enum
 {
   PROP_0,
@@ -55,6 +64,9 @@ enum
   PROP_MAX_SIZE_PACKETS,
   PROP_NUM_RTX_REQUESTS,
   PROP_NUM_RTX_PACKETS,
+  PROP_NUM_RTX_HITS,
+  PROP_NUM_RTX_MISSES,
+  PROP_NUM_EVICTIONS,
 };
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
@@ -92,6 +104,9 @@ struct _GstRistRtxSend
   /* statistics */
   guint num_rtx_requests;
   guint num_rtx_packets;
+  guint num_rtx_hits;
+  guint num_rtx_misses;
+  guint num_evictions;
 };
 
 static gboolean gst_rist_rtx_send_queue_check_full (GstDataQueue * queue,
@@ -129,24 +144,26 @@ typedef struct
 {
   guint32 extseqnum;
   guint32 timestamp;
+  /* NULL if the slot is empty */
   GstBuffer *buffer;
 } BufferQueueItem;
 
-static void
-buffer_queue_item_free (BufferQueueItem * item)
-{
-  gst_buffer_unref (item->buffer);
-  g_slice_free (BufferQueueItem, item);
-}
-
 typedef struct
 {
   guint32 rtx_ssrc;
   guint16 seqnum_base, next_seqnum;
   gint clock_rate;
 
-  /* history of rtp packets */
-  GSequence *queue;
+  /* history of rtp packets, the packet with extended seqnum N is in slot
+   * N % history_size. The history covers history_len seqnums starting from
+   * the oldest packet at history_low, the first and last slots are never
+   * empty */
+  BufferQueueItem *history;
+  guint history_size;
+  guint32 history_low;
+  guint history_len;
+  /* number of packets in the history */
+  guint history_count;
   guint32 max_extseqnum;
 
   /* current rtcp app seqnum extension */
@@ -161,7 +178,6 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 
   data->rtx_ssrc = rtx_ssrc;
   data->next_seqnum = data->seqnum_base = g_random_int_range (0, G_MAXUINT16);
-  data->queue = g_sequence_new ((GDestroyNotify) buffer_queue_item_free);
   data->max_extseqnum = -1;
 
   return data;
@@ -170,10 +186,59 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 static void
 ssrc_rtx_data_free (SSRCRtxData * data)
 {
-  g_sequence_free (data->queue);
+  guint i;
+
+  for (i = 0; i < data->history_size; i++)
+    gst_clear_buffer (&data->history[i].buffer);
+  g_free (data->history);
   g_slice_free (SSRCRtxData, data);
 }
 
+static inline BufferQueueItem *
+ssrc_rtx_data_get_slot (SSRCRtxData * data, guint32 extseqnum)
+{
+  return &data->history[extseqnum & (data->history_size - 1)];
+}
+
+/* Returns the stored packet with @extseqnum, or NULL */
+static BufferQueueItem *
+ssrc_rtx_data_lookup (SSRCRtxData * data, guint32 extseqnum)
+{
+  BufferQueueItem *item;
+
+  if (extseqnum - data->history_low >= data->history_len)
+    return NULL;
+
+  item = ssrc_rtx_data_get_slot (data, extseqnum);
+  if (!item->buffer || item->extseqnum != extseqnum)
+    return NULL;
+
+  return item;
+}
+
+/* Moves the history to a ring of @size slots, @size being a power of two
+ * not smaller than the current history length */
+static void
+ssrc_rtx_data_resize (SSRCRtxData * data, guint size)
+{
+  BufferQueueItem *history = data->history;
+  guint history_size = data->history_size;
+  guint i;
+
+  data->history = g_new0 (BufferQueueItem, size);
+  data->history_size = size;
+
+  for (i = 0; i < data->history_len; i++) {
+    BufferQueueItem *item =
+        &history[(data->history_low + i) & (history_size - 1)];
+
+    if (item->buffer)
+      *ssrc_rtx_data_get_slot (data, item->extseqnum) = *item;
+  }
+
+  g_free (history);
+}
+
 static void
 gst_rist_rtx_send_class_init (GstRistRtxSendClass * klass)
 {
@@ -208,6 +273,44 @@ gst_rist_rtx_send_class_init (GstRistRtxSendClass * klass)
           " Number of retransmission packets sent", 0, G_MAXUINT,
           0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRistRtxSend:num-rtx-hits:
+   *
+   * Number of retransmission requests for a packet still in the history.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_HITS,
+      g_param_spec_uint ("num-rtx-hits", "Num RTX Hits",
+          "Number of retransmission requests for a packet in the history",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRistRtxSend:num-rtx-misses:
+   *
+   * Number of retransmission requests for a packet that was already evicted
+   * from the history or not sent yet.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_MISSES,
+      g_param_spec_uint ("num-rtx-misses", "Num RTX Misses",
+          "Number of retransmission requests for a packet not in the history",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRistRtxSend:num-evictions:
+   *
+   * Number of packets removed from the history because of the
+   * #GstRistRtxSend:max-size-packets or #GstRistRtxSend:max-size-time limits.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_NUM_EVICTIONS,
+      g_param_spec_uint ("num-evictions", "Num Evictions",
+          "Number of packets removed from the history because of its limits",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
 
@@ -229,6 +332,9 @@ gst_rist_rtx_send_reset (GstRistRtxSend * rtx)
   g_hash_table_remove_all (rtx->rtx_ssrcs);
   rtx->num_rtx_requests = 0;
   rtx->num_rtx_packets = 0;
+  rtx->num_rtx_hits = 0;
+  rtx->num_rtx_misses = 0;
+  rtx->num_evictions = 0;
   GST_OBJECT_UNLOCK (rtx);
 }
 
@@ -369,15 +475,6 @@ gst_rtp_rist_buffer_new (GstRistRtxSend * rtx, GstBuffer * buffer, guint32 ssrc)
   return buffer;
 }
 
-static gint
-buffer_queue_items_cmp (BufferQueueItem * a, BufferQueueItem * b,
-    gpointer user_data)
-{
-  /* gst_rtp_buffer_compare_seqnum returns the opposite of what we want,
-   * it returns negative when seqnum1 > seqnum2 and we want negative
-   * when b > a, i.e. a is smaller, so it comes first in the sequence */
-  return a->extseqnum - b->extseqnum;
-}
 
 static gboolean
 gst_rist_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
@@ -410,8 +507,7 @@ gst_rist_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
         /* check if request is for us */
         if (g_hash_table_contains (rtx->ssrc_data, GUINT_TO_POINTER (ssrc))) {
           SSRCRtxData *data;
-          GSequenceIter *iter;
-          BufferQueueItem search_item;
+          BufferQueueItem *item;
           guint32 extseqnum;
 
           /* update statistics */
@@ -427,27 +523,19 @@ gst_rist_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
             extseqnum = gst_rist_rtp_ext_seq (&max_extseqnum, seqnum);
           }
 
-          search_item.extseqnum = extseqnum;
-          iter = g_sequence_lookup (data->queue, &search_item,
-              (GCompareDataFunc) buffer_queue_items_cmp, NULL);
-          if (iter) {
-            BufferQueueItem *item = g_sequence_get (iter);
+          item = ssrc_rtx_data_lookup (data, extseqnum);
+          if (item) {
+            ++rtx->num_rtx_hits;
             GST_LOG_OBJECT (rtx, "found %u (%u:%u)", item->extseqnum,
                 item->extseqnum >> 16, item->extseqnum & 0xFFFF);
             rtx_buf = gst_rtp_rist_buffer_new (rtx, item->buffer, ssrc);
-          }
+          } else {
+            ++rtx->num_rtx_misses;
 #ifndef GST_DISABLE_DEBUG
-          else {
-            BufferQueueItem *item = NULL;
-
-            iter = g_sequence_get_begin_iter (data->queue);
-            if (!g_sequence_iter_is_end (iter))
-              item = g_sequence_get (iter);
-
-            if (item && extseqnum < item->extseqnum) {
+            if (data->history_len > 0 && extseqnum < data->history_low) {
               GST_DEBUG_OBJECT (rtx, "requested seqnum %u has already been "
                   "removed from the rtx queue; the first available is %u",
-                  seqnum, item->extseqnum);
+                  seqnum, data->history_low);
             } else {
               GST_WARNING_OBJECT (rtx, "requested seqnum %u has not been "
                   "transmitted yet in the original stream; either the remote end "
@@ -553,14 +641,13 @@ gst_rist_rtx_send_get_ts_diff (SSRCRtxData * data)
   BufferQueueItem *high_buf, *low_buf;
   guint32 result;
 
-  high_buf =
-      g_sequence_get (g_sequence_iter_prev (g_sequence_get_end_iter
-          (data->queue)));
-  low_buf = g_sequence_get (g_sequence_get_begin_iter (data->queue));
-
-  if (!high_buf || !low_buf || high_buf == low_buf)
+  if (data->history_len < 2)
     return 0;
 
+  high_buf = ssrc_rtx_data_get_slot (data,
+      data->history_low + data->history_len - 1);
+  low_buf = ssrc_rtx_data_get_slot (data, data->history_low);
+
   high_ts = high_buf->timestamp;
   low_ts = low_buf->timestamp;
 
@@ -575,12 +662,87 @@ gst_rist_rtx_send_get_ts_diff (SSRCRtxData * data)
   return (guint32) gst_util_uint64_scale_int (result, 1000, data->clock_rate);
 }
 
+/* Removes the oldest packet from the history, must be called with lock */
+static void
+gst_rist_rtx_send_evict_oldest (GstRistRtxSend * rtx, SSRCRtxData * data)
+{
+  BufferQueueItem *item = ssrc_rtx_data_get_slot (data, data->history_low);
+
+  gst_clear_buffer (&item->buffer);
+  data->history_count--;
+  rtx->num_evictions++;
+
+  /* skip the seqnums that were never stored */
+  do {
+    data->history_low++;
+    data->history_len--;
+  } while (data->history_len > 0 &&
+      !ssrc_rtx_data_get_slot (data, data->history_low)->buffer);
+}
+
+/* Must be called with lock */
+static void
+gst_rist_rtx_send_store (GstRistRtxSend * rtx, SSRCRtxData * data,
+    guint32 extseqnum, guint32 rtptime, GstBuffer * buffer)
+{
+  BufferQueueItem *item;
+  guint len;
+
+  if (data->history_len > 0) {
+    if ((gint32) (extseqnum - data->history_low) < 0) {
+      GST_DEBUG_OBJECT (rtx, "Not storing packet %u older than the history",
+          extseqnum);
+      return;
+    }
+
+    /* remove oldest packets from history if they don't fit in the ring */
+    while (data->history_len > 0 &&
+        extseqnum - data->history_low >= HISTORY_MAX_SIZE)
+      gst_rist_rtx_send_evict_oldest (rtx, data);
+  }
+
+  if (data->history_len == 0) {
+    data->history_low = extseqnum;
+    len = 1;
+  } else {
+    len = MAX (data->history_len, extseqnum - data->history_low + 1);
+  }
+
+  if (len > data->history_size) {
+    guint size = HISTORY_MIN_SIZE;
+
+    while (size < MAX (len, MIN (rtx->max_size_packets, HISTORY_MAX_SIZE)))
+      size <<= 1;
+    ssrc_rtx_data_resize (data, size);
+  }
+
+  item = ssrc_rtx_data_get_slot (data, extseqnum);
+  if (item->buffer)
+    gst_buffer_unref (item->buffer);
+  else
+    data->history_count++;
+  item->extseqnum = extseqnum;
+  item->timestamp = rtptime;
+  item->buffer = gst_buffer_ref (buffer);
+  data->history_len = len;
+
+  /* remove oldest packets from history if they are too many */
+  if (rtx->max_size_packets) {
+    while (data->history_count > rtx->max_size_packets)
+      gst_rist_rtx_send_evict_oldest (rtx, data);
+  }
+
+  if (rtx->max_size_time) {
+    while (gst_rist_rtx_send_get_ts_diff (data) > rtx->max_size_time)
+      gst_rist_rtx_send_evict_oldest (rtx, data);
+  }
+}
+
 /* Must be called with lock */
 static void
 process_buffer (GstRistRtxSend * rtx, GstBuffer * buffer)
 {
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-  BufferQueueItem *item;
   SSRCRtxData *data;
   guint16 seqnum;
   guint32 ssrc, rtptime;
@@ -616,21 +778,7 @@ process_buffer (GstRistRtxSend * rtx, GstBuffer * buffer)
     extseqnum = gst_rist_rtp_ext_seq (&data->max_extseqnum, seqnum);
 
   /* add current rtp buffer to queue history */
-  item = g_slice_new0 (BufferQueueItem);
-  item->extseqnum = extseqnum;
-  item->timestamp = rtptime;
-  item->buffer = gst_buffer_ref (buffer);
-  g_sequence_append (data->queue, item);
-
-  /* remove oldest packets from history if they are too many */
-  if (rtx->max_size_packets) {
-    while (g_sequence_get_length (data->queue) > rtx->max_size_packets)
-      g_sequence_remove (g_sequence_get_begin_iter (data->queue));
-  }
-  if (rtx->max_size_time) {
-    while (gst_rist_rtx_send_get_ts_diff (data) > rtx->max_size_time)
-      g_sequence_remove (g_sequence_get_begin_iter (data->queue));
-  }
+  gst_rist_rtx_send_store (rtx, data, extseqnum, rtptime, buffer);
 }
 
 static GstFlowReturn
@@ -757,6 +905,21 @@ gst_rist_rtx_send_get_property (GObject * object,
       g_value_set_uint (value, rtx->num_rtx_packets);
       GST_OBJECT_UNLOCK (rtx);
       break;
+    case PROP_NUM_RTX_HITS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_hits);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_RTX_MISSES:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_misses);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_EVICTIONS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_evictions);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
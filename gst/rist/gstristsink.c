@@ -51,19 +51,40 @@
  * mapped to its own RTP session. RTX request are only replied to on the
  * link the NACK was received from.
  *
- * There are currently two bonding methods in place: "broadcast" and "round-robin".
+ * There are currently three bonding methods in place: "broadcast",
+ * "round-robin" and "weighted".
  * In "broadcast" mode, all the packets are duplicated over all sessions.
- * While in "round-robin" mode, packets are evenly distributed over the links. One
+ * While in "round-robin" mode, packets are evenly distributed over the links.
+ * In "weighted" mode, the share of the packets of each link follows its
+ * quality as reported by the receiver in RTCP: links with a lower round trip
+ * time and less packet loss get more packets. One
  * can also implement its own dispatcher element and configure it using the
  * "dispatcher" property. As a reference, "broadcast" mode is implemented with
- * the "tee" element, while "round-robin" mode is implemented with the
- * "round-robin" element.
+ * the "tee" element, while "round-robin" and "weighted" modes are implemented
+ * with the "round-robin" element.
+ *
+ * With the "round-robin" and "weighted" methods, packets with any of the
+ * "bonding-duplicate-flags" set are sent over all links.
  *
  * ## Example gst-launch line for bonding
  * |[
  * gst-launch-1.0 udpsrc ! tsparse set-timestamps=1 smoothing-latency=40000 ! \
  *  rtpmp2tpay ! ristsink bonding-addresses="10.0.0.1:5004,11.0.0.1:5006"
  * ]|
+ *
+ * ## Example of weighted bonding over simulated links
+ * |[
+ * gst-launch-1.0 ristsrc bonding-addresses="127.0.0.1:5004,127.0.0.1:5006" ! \
+ *   rtpmp2tdepay ! fakesink \
+ *   udpsrc port=6004 ! netsim drop-probability=0.05 ! \
+ *     udpsink host=127.0.0.1 port=5004 \
+ *   udpsrc port=6006 ! netsim delay-distribution=normal min-delay=20 \
+ *     max-delay=80 ! udpsink host=127.0.0.1 port=5006 \
+ *   videotestsrc is-live=1 ! x264enc tune=zerolatency ! mpegtsmux ! \
+ *   rtpmp2tpay ! ristsink bonding-method=weighted \
+ *     bonding-addresses="127.0.0.1:6004,127.0.0.1:6006" stats-update-interval=1000
+ * ]| The RTP packets of each link go through a netsim element, the "session-stats"
+ * show how the packets are spread over the two links.
  */
 
 /* using GValueArray, which has not replacement */
@@ -101,15 +122,23 @@ enum
   PROP_BONDING_METHOD,
   PROP_DISPATCHER,
   PROP_DROP_NULL_TS_PACKETS,
-  PROP_SEQUENCE_NUMBER_EXTENSION
+  PROP_SEQUENCE_NUMBER_EXTENSION,
+  PROP_BONDING_DUPLICATE_FLAGS
 };
 
 typedef enum
 {
   GST_RIST_BONDING_METHOD_BROADCAST,
   GST_RIST_BONDING_METHOD_ROUND_ROBIN,
+  GST_RIST_BONDING_METHOD_WEIGHTED,
 } GstRistBondingMethod;
 
+/* weight of the last RTCP report in the smoothed link quality */
+#define WEIGHT_SMOOTHING 0.25
+/* links never get less than this share of the weight of the best link, so
+ * that a link recovering from a bad period gets used again */
+#define MIN_RELATIVE_WEIGHT 0.05
+
 static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -127,6 +156,11 @@ typedef struct
   GstElement *rtx_send;
   GstElement *rtx_queue;
   guint32 rtcp_ssrc;
+
+  /* link quality for the weighted bonding method, 0 until the first RTCP
+   * report, protected by bonds_lock */
+  gdouble quality;
+  gdouble weight;
 } RistSenderBond;
 
 struct _GstRistSink
@@ -147,6 +181,7 @@ struct _GstRistSink
   GstClockTime min_rtcp_interval;
   gdouble max_rtcp_bandwidth;
   GstRistBondingMethod bonding_method;
+  GstBufferFlags bonding_duplicate_flags;
 
   /* Bonds */
   GPtrArray *bonds;
@@ -175,6 +210,8 @@ gst_rist_bonding_method_get_type (void)
         "GST_RIST_BONDING_METHOD_BROADCAST", "broadcast"},
     {GST_RIST_BONDING_METHOD_ROUND_ROBIN,
         "GST_RIST_BONDING_METHOD_ROUND_ROBIN", "round-robin"},
+    {GST_RIST_BONDING_METHOD_WEIGHTED,
+        "GST_RIST_BONDING_METHOD_WEIGHTED", "weighted"},
     {0, NULL, NULL}
   };
 
@@ -202,6 +239,7 @@ gst_rist_sink_add_bond (GstRistSink * sink)
 
   bond->session = sink->bonds->len;
   bond->address = g_strdup ("localhost");
+  bond->weight = 1.0;
 
   g_snprintf (name, 32, "rist_rtp_udpsink%u", bond->session);
   bond->rtp_sink = gst_element_factory_make ("udpsink", name);
@@ -709,6 +747,90 @@ dns_resolve_failed:
   return GST_STATE_CHANGE_FAILURE;
 }
 
+/* called with bonds lock */
+static void
+gst_rist_sink_update_weights (GstRistSink * sink)
+{
+  gdouble max_quality = 0.0;
+  gint i;
+
+  for (i = 0; i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+    max_quality = MAX (max_quality, bond->quality);
+  }
+
+  if (max_quality <= 0.0)
+    return;
+
+  for (i = 0; i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+    GstPad *pad;
+    gchar name[32];
+
+    /* links without report yet are assumed to be as good as the best one */
+    if (bond->quality > 0.0)
+      bond->weight = MAX (bond->quality / max_quality, MIN_RELATIVE_WEIGHT);
+    else
+      bond->weight = 1.0;
+
+    g_snprintf (name, 32, "src_%u", bond->session);
+    pad = gst_element_get_static_pad (sink->dispatcher, name);
+    if (!pad)
+      continue;
+
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (pad), "weight"))
+      g_object_set (pad, "weight", bond->weight, NULL);
+    gst_object_unref (pad);
+  }
+}
+
+/* Called when a report of the receiver about a link was processed */
+static void
+gst_rist_sink_on_ssrc_active (GObject * session, GObject * source,
+    GstRistSink * sink)
+{
+  GstStructure *stats;
+  gboolean internal = TRUE, have_rb = FALSE;
+  guint fraction_lost = 0, rb_rtt = 0;
+  guint session_id;
+  RistSenderBond *bond;
+  gdouble rtt, loss, quality;
+
+  g_object_get (source, "stats", &stats, NULL);
+  gst_structure_get (stats, "internal", G_TYPE_BOOLEAN, &internal,
+      "have-rb", G_TYPE_BOOLEAN, &have_rb, NULL);
+  gst_structure_get_uint (stats, "rb-fractionlost", &fraction_lost);
+  gst_structure_get_uint (stats, "rb-round-trip", &rb_rtt);
+  gst_structure_free (stats);
+
+  if (internal || !have_rb)
+    return;
+
+  session_id =
+      GPOINTER_TO_UINT (g_object_get_qdata (session, session_id_quark));
+
+  /* rb_rtt is in Q16 in NTP time */
+  rtt = MAX (rb_rtt / 65536.0, 0.001);
+  loss = fraction_lost / 256.0;
+  quality = (1.0 - loss) / rtt;
+
+  g_mutex_lock (&sink->bonds_lock);
+  if (session_id < sink->bonds->len) {
+    bond = g_ptr_array_index (sink->bonds, session_id);
+
+    if (bond->quality > 0.0)
+      bond->quality += WEIGHT_SMOOTHING * (quality - bond->quality);
+    else
+      bond->quality = quality;
+
+    GST_LOG_OBJECT (sink, "link %u: rtt %.1f ms, loss %.1f %%, quality %f",
+        session_id, rtt * 1000.0, loss * 100.0, bond->quality);
+
+    gst_rist_sink_update_weights (sink);
+  }
+  g_mutex_unlock (&sink->bonds_lock);
+}
+
 static GstStateChangeReturn
 gst_rist_sink_reuse_socket (GstRistSink * sink)
 {
@@ -725,6 +847,15 @@ gst_rist_sink_reuse_socket (GstRistSink * sink)
         "rtcp-fraction", sink->max_rtcp_bandwidth, NULL);
     g_object_unref (session);
 
+    if (sink->bonding_method == GST_RIST_BONDING_METHOD_WEIGHTED) {
+      g_signal_emit_by_name (sink->rtpbin, "get-internal-session", i,
+          &session);
+      g_object_set_qdata (session, session_id_quark, GUINT_TO_POINTER (i));
+      g_signal_connect_object (session, "on-ssrc-active",
+          (GCallback) gst_rist_sink_on_ssrc_active, sink, 0);
+      g_object_unref (session);
+    }
+
     g_snprintf (name, 32, "src_%u", bond->session);
     pad = gst_element_request_pad_simple (sink->dispatcher, name);
     gst_element_link_pads (sink->dispatcher, name, bond->rtx_queue, "sink");
@@ -754,9 +885,12 @@ gst_rist_sink_start (GstRistSink * sink)
         }
         break;
       case GST_RIST_BONDING_METHOD_ROUND_ROBIN:
+      case GST_RIST_BONDING_METHOD_WEIGHTED:
         sink->dispatcher = gst_element_factory_make ("roundrobin",
             "rist_dispatcher");
         g_assert (sink->dispatcher);
+        g_object_set (sink->dispatcher, "duplicate-flags",
+            sink->bonding_duplicate_flags, NULL);
         break;
     }
   }
@@ -836,6 +970,10 @@ gst_rist_sink_create_stats (GstRistSink * sink)
         "sent-retransmitted-packets", G_TYPE_UINT64, rtx_sent,
         "round-trip-time", G_TYPE_UINT64, rtt, NULL);
 
+    if (sink->bonding_method == GST_RIST_BONDING_METHOD_WEIGHTED)
+      gst_structure_set (stats, "bonding-weight", G_TYPE_DOUBLE,
+          bond->weight, NULL);
+
     g_value_init (&value, GST_TYPE_STRUCTURE);
     g_value_take_boxed (&value, stats);
     g_value_array_append (session_stats, &value);
@@ -1167,6 +1305,10 @@ gst_rist_sink_get_property (GObject * object, guint prop_id,
       g_value_set_enum (value, sink->bonding_method);
       break;
 
+    case PROP_BONDING_DUPLICATE_FLAGS:
+      g_value_set_flags (value, sink->bonding_duplicate_flags);
+      break;
+
     case PROP_DISPATCHER:
       g_value_set_object (value, sink->dispatcher);
       break;
@@ -1278,6 +1420,10 @@ gst_rist_sink_set_property (GObject * object, guint prop_id,
       sink->bonding_method = g_value_get_enum (value);
       break;
 
+    case PROP_BONDING_DUPLICATE_FLAGS:
+      sink->bonding_duplicate_flags = g_value_get_flags (value);
+      break;
+
     case PROP_DISPATCHER:
       if (sink->dispatcher)
         g_object_unref (sink->dispatcher);
@@ -1419,6 +1565,22 @@ gst_rist_sink_class_init (GstRistSinkClass * klass)
           GST_RIST_BONDING_METHOD_BROADCAST,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT));
 
+  /**
+   * GstRistSink:bonding-duplicate-flags:
+   *
+   * With the "round-robin" and "weighted" bonding methods, packets with any
+   * of these buffer flags set are sent over all links, e.g. to protect the
+   * most critical packets against the loss of a link.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (object_class, PROP_BONDING_DUPLICATE_FLAGS,
+      g_param_spec_flags ("bonding-duplicate-flags", "Bonding Duplicate Flags",
+          "Send packets with any of these flags over all links",
+          GST_TYPE_BUFFER_FLAGS, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   g_object_class_install_property (object_class, PROP_DISPATCHER,
       g_param_spec_object ("dispatcher", "Bonding Dispatcher",
           "An element that takes care of multi-plexing bonded links. When set "
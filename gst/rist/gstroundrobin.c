@@ -27,6 +27,13 @@
  * element, which duplicates buffers over all pads. This element 
  * can be used to distrute load across multiple branches when the buffer
  * can be processed independently.
+ *
+ * Each src pad has a "weight" property, the share of the buffers a pad
+ * receives is proportional to its weight and the buffers are interleaved as
+ * evenly as possible (smooth weighted round robin). With the default equal
+ * weights, the buffers are distributed in turn over the pads.
+ *
+ * Buffers with any of the "duplicate-flags" set are pushed on all pads.
  */
 
 #include "gstroundrobin.h"
@@ -44,36 +51,209 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src_%d",
     GST_PAD_REQUEST,
     GST_STATIC_CAPS ("ANY"));
 
+enum
+{
+  PROP_0,
+  PROP_DUPLICATE_FLAGS,
+};
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_WEIGHT,
+};
+
+#define DEFAULT_DUPLICATE_FLAGS 0
+#define DEFAULT_PAD_WEIGHT 1.0
+
 struct _GstRoundRobin
 {
   GstElement parent;
   gint index;
+  GstBufferFlags duplicate_flags;
 };
 
+#define GST_TYPE_ROUND_ROBIN_PAD (gst_round_robin_pad_get_type())
+#define GST_ROUND_ROBIN_PAD(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_ROUND_ROBIN_PAD,GstRoundRobinPad))
+typedef struct _GstRoundRobinPad GstRoundRobinPad;
+typedef struct
+{
+  GstPadClass parent;
+} GstRoundRobinPadClass;
+
+struct _GstRoundRobinPad
+{
+  GstPad parent;
+
+  /* protected by the object lock */
+  gdouble weight;
+
+  /* protected by the element object lock */
+  gdouble current_weight;
+};
+
+GType gst_round_robin_pad_get_type (void);
+
+G_DEFINE_TYPE (GstRoundRobinPad, gst_round_robin_pad, GST_TYPE_PAD);
+
+static void
+gst_round_robin_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRoundRobinPad *pad = GST_ROUND_ROBIN_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_WEIGHT:
+      GST_OBJECT_LOCK (pad);
+      pad->weight = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_round_robin_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRoundRobinPad *pad = GST_ROUND_ROBIN_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_WEIGHT:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_double (value, pad->weight);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_round_robin_pad_class_init (GstRoundRobinPadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->set_property = gst_round_robin_pad_set_property;
+  gobject_class->get_property = gst_round_robin_pad_get_property;
+
+  /**
+   * GstRoundRobinPad:weight:
+   *
+   * Relative share of the buffers pushed on this pad, 0 to only push the
+   * buffers with #GstRoundRobin:duplicate-flags on it.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_WEIGHT,
+      g_param_spec_double ("weight", "Weight",
+          "Relative share of the buffers pushed on this pad", 0.0, G_MAXDOUBLE,
+          DEFAULT_PAD_WEIGHT, G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_round_robin_pad_init (GstRoundRobinPad * pad)
+{
+  pad->weight = DEFAULT_PAD_WEIGHT;
+}
+
 G_DEFINE_TYPE_WITH_CODE (GstRoundRobin, gst_round_robin,
     GST_TYPE_ELEMENT, GST_DEBUG_CATEGORY_INIT (gst_round_robin_debug,
         "roundrobin", 0, "Round Robin"));
 GST_ELEMENT_REGISTER_DEFINE (roundrobin, "roundrobin", GST_RANK_NONE,
     GST_TYPE_ROUND_ROBIN);
 
+/* Pushes @buffer on all src pads, returns OK if any pad accepted it */
+static GstFlowReturn
+gst_round_robin_push_all (GstRoundRobin * disp, GstBuffer * buffer)
+{
+  GstElement *elem = (GstElement *) disp;
+  GstFlowReturn ret = GST_FLOW_NOT_LINKED;
+  GList *pads, *l;
+
+  GST_OBJECT_LOCK (disp);
+  pads = g_list_copy_deep (elem->srcpads, (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (disp);
+
+  for (l = pads; l; l = l->next) {
+    GstFlowReturn pad_ret = gst_pad_push (l->data, gst_buffer_ref (buffer));
+
+    if (ret != GST_FLOW_OK && pad_ret != GST_FLOW_NOT_LINKED)
+      ret = pad_ret;
+  }
+
+  g_list_free_full (pads, gst_object_unref);
+  gst_buffer_unref (buffer);
+
+  /* no pad, that's fine */
+  if (ret == GST_FLOW_NOT_LINKED)
+    ret = GST_FLOW_OK;
+
+  return ret;
+}
+
+/* Smooth weighted round robin: every pad earns its weight for each buffer
+ * and the pad with the most earned weight pays for the buffer with the total
+ * weight. Must be called with the object lock */
+static GstPad *
+gst_round_robin_select_pad (GstRoundRobin * disp)
+{
+  GstElement *elem = (GstElement *) disp;
+  GstRoundRobinPad *best = NULL;
+  gdouble total = 0.0;
+  GList *l;
+
+  for (l = elem->srcpads; l; l = l->next) {
+    GstRoundRobinPad *pad = l->data;
+    gdouble weight;
+
+    GST_OBJECT_LOCK (pad);
+    weight = pad->weight;
+    GST_OBJECT_UNLOCK (pad);
+
+    if (weight <= 0.0)
+      continue;
+
+    pad->current_weight += weight;
+    total += weight;
+    if (!best || pad->current_weight > best->current_weight)
+      best = pad;
+  }
+
+  if (best) {
+    best->current_weight -= total;
+    return GST_PAD (best);
+  }
+
+  /* no weights at all, distribute equally */
+  if (disp->index >= elem->numsrcpads)
+    disp->index = 0;
+
+  return g_list_nth_data (elem->srcpads, disp->index++);
+}
+
 static GstFlowReturn
 gst_round_robin_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
   GstRoundRobin *disp = (GstRoundRobin *) parent;
-  GstElement *elem = (GstElement *) parent;
   GstPad *src_pad = NULL;
   GstFlowReturn ret;
 
   GST_OBJECT_LOCK (disp);
-  if (disp->index >= elem->numsrcpads)
-    disp->index = 0;
-
-  src_pad = g_list_nth_data (elem->srcpads, disp->index);
+  if (disp->duplicate_flags &&
+      GST_BUFFER_FLAG_IS_SET (buffer, disp->duplicate_flags)) {
+    GST_OBJECT_UNLOCK (disp);
+    GST_LOG_OBJECT (disp, "duplicating %" GST_PTR_FORMAT, buffer);
+    return gst_round_robin_push_all (disp, buffer);
+  }
 
-  if (src_pad) {
+  src_pad = gst_round_robin_select_pad (disp);
+  if (src_pad)
     gst_object_ref (src_pad);
-    disp->index += 1;
-  }
   GST_OBJECT_UNLOCK (disp);
 
   if (!src_pad)
@@ -98,7 +278,8 @@ gst_round_robin_request_pad (GstElement * element, GstPadTemplate * templ,
     return NULL;
   }
 
-  pad = gst_pad_new_from_static_template (&src_templ, name);
+  pad = g_object_new (GST_TYPE_ROUND_ROBIN_PAD, "name", name, "direction",
+      templ->direction, "template", templ, NULL);
   gst_element_add_pad (element, pad);
 
   return pad;
@@ -119,19 +300,76 @@ gst_round_robin_init (GstRoundRobin * disp)
   gst_pad_set_chain_function (pad, GST_DEBUG_FUNCPTR (gst_round_robin_chain));
 }
 
+static void
+gst_round_robin_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRoundRobin *disp = GST_ROUND_ROBIN (object);
+
+  switch (prop_id) {
+    case PROP_DUPLICATE_FLAGS:
+      GST_OBJECT_LOCK (disp);
+      disp->duplicate_flags = g_value_get_flags (value);
+      GST_OBJECT_UNLOCK (disp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_round_robin_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRoundRobin *disp = GST_ROUND_ROBIN (object);
+
+  switch (prop_id) {
+    case PROP_DUPLICATE_FLAGS:
+      GST_OBJECT_LOCK (disp);
+      g_value_set_flags (value, disp->duplicate_flags);
+      GST_OBJECT_UNLOCK (disp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_round_robin_class_init (GstRoundRobinClass * klass)
 {
+  GObjectClass *gobject_class = (GObjectClass *) klass;
   GstElementClass *element_class = (GstElementClass *) klass;
 
+  gobject_class->set_property = gst_round_robin_set_property;
+  gobject_class->get_property = gst_round_robin_get_property;
+
+  /**
+   * GstRoundRobin:duplicate-flags:
+   *
+   * Buffers with any of these flags set are pushed on all src pads instead
+   * of one, e.g. to send the most critical packets over all bonded links.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_DUPLICATE_FLAGS,
+      g_param_spec_flags ("duplicate-flags", "Duplicate Flags",
+          "Push buffers with any of these flags on all pads",
+          GST_TYPE_BUFFER_FLAGS, DEFAULT_DUPLICATE_FLAGS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_metadata (element_class,
       "Round Robin", "Source/Network",
       "A round robin dispatcher element.",
       "Nicolas Dufresne <nicolas.dufresne@collabora.com");
 
   gst_element_class_add_static_pad_template (element_class, &sink_templ);
-  gst_element_class_add_static_pad_template (element_class, &src_templ);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &src_templ, GST_TYPE_ROUND_ROBIN_PAD);
 
   element_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_round_robin_request_pad);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_ROUND_ROBIN_PAD, 0);
 }
@@ -0,0 +1,725 @@
+/* GStreamer
+ * Copyright (C) 2026 GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The RTP source of rtpsrc when #GstRtpSrc:batch-size or
+ * #GstRtpSrc:timestamping are set. Unlike udpsrc, which reads one datagram
+ * per wakeup, it drains up to batch-size datagrams with a single recvmmsg()
+ * call and pushes them downstream as one buffer list.
+ *
+ * With timestamping, the kernel reports when the network stack received
+ * each datagram (SO_TIMESTAMPING software timestamps). The buffer timestamps
+ * are then derived from that time instead of the time the streaming thread
+ * woke up, and the original timestamp is attached as a "timestamp/x-unix"
+ * #GstReferenceTimestampMeta. Hardware timestamps are not used: they are
+ * in the time base of the clock of the network device, not comparable to
+ * the system real time clock.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* for recvmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
+
+#include <gst/net/net.h>
+
+#include "gstrtpbatchsrc.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_rtp_batch_src_debug);
+#define GST_CAT_DEFAULT gst_rtp_batch_src_debug
+
+#define DEFAULT_PROP_ADDRESS          "0.0.0.0"
+#define DEFAULT_PROP_PORT             5004
+#define DEFAULT_PROP_MULTICAST_IFACE  NULL
+#define DEFAULT_PROP_BATCH_SIZE       32
+#define DEFAULT_PROP_MTU              1500
+#define DEFAULT_PROP_TIMESTAMPING     FALSE
+
+/* Biggest UDP datagram */
+#define MAX_DATAGRAM_SIZE             G_MAXUINT16
+
+enum
+{
+  PROP_0,
+
+  PROP_ADDRESS,
+  PROP_PORT,
+  PROP_MULTICAST_IFACE,
+  PROP_CAPS,
+  PROP_BATCH_SIZE,
+  PROP_MTU,
+  PROP_TIMESTAMPING,
+  PROP_USED_SOCKET,
+};
+
+/* room for one SCM_TIMESTAMPING message, three struct timespec */
+typedef union
+{
+  struct cmsghdr hdr;
+  guint8 buf[CMSG_SPACE (3 * sizeof (struct timespec))];
+} BatchControl;
+
+#define gst_rtp_batch_src_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstRtpBatchSrc, gst_rtp_batch_src, GST_TYPE_PUSH_SRC,
+    GST_DEBUG_CATEGORY_INIT (gst_rtp_batch_src_debug, "rtpbatchsrc", 0,
+        "RTP batched UDP source"));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static void
+gst_rtp_batch_src_free_slots (GstRtpBatchSrc * self)
+{
+  guint i;
+
+  if (self->buffers) {
+    for (i = 0; i < self->batch_size; i++) {
+      gst_clear_buffer (&self->buffers[i]);
+      if (self->overflow[i])
+        gst_memory_unref (self->overflow[i]);
+    }
+  }
+
+  g_clear_pointer (&self->buffers, g_free);
+  g_clear_pointer (&self->maps, g_free);
+  g_clear_pointer (&self->overflow, g_free);
+  g_clear_pointer (&self->overflow_maps, g_free);
+  g_clear_pointer (&self->msgs, g_free);
+  g_clear_pointer (&self->iovs, g_free);
+  g_clear_pointer (&self->names, g_free);
+  g_clear_pointer (&self->controls, g_free);
+}
+
+static GInetAddress *
+gst_rtp_batch_src_resolve (GstRtpBatchSrc * self, GError ** error)
+{
+  GInetAddress *iaddr;
+  GResolver *resolver;
+  GList *results;
+
+  iaddr = g_inet_address_new_from_string (self->address);
+  if (iaddr)
+    return iaddr;
+
+  resolver = g_resolver_get_default ();
+  results = g_resolver_lookup_by_name (resolver, self->address,
+      self->cancellable, error);
+  g_object_unref (resolver);
+
+  if (!results)
+    return NULL;
+
+  iaddr = G_INET_ADDRESS (g_object_ref (results->data));
+  g_resolver_free_addresses (results);
+
+  return iaddr;
+}
+
+static void
+gst_rtp_batch_src_enable_timestamping (GstRtpBatchSrc * self)
+{
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+  gint flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+  if (setsockopt (g_socket_get_fd (self->socket), SOL_SOCKET, SO_TIMESTAMPING,
+          &flags, sizeof (flags)) == 0) {
+    self->have_timestamps = TRUE;
+    return;
+  }
+
+  GST_ELEMENT_WARNING (self, RESOURCE, SETTINGS, (NULL),
+      ("Could not enable receive timestamps: %s", g_strerror (errno)));
+#else
+  GST_ELEMENT_WARNING (self, RESOURCE, SETTINGS, (NULL),
+      ("Receive timestamps are not supported on this platform"));
+#endif
+}
+
+static gboolean
+gst_rtp_batch_src_start (GstBaseSrc * src)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (src);
+  GInetAddress *iaddr;
+  GSocketAddress *bind_addr;
+  GError *error = NULL;
+
+  iaddr = gst_rtp_batch_src_resolve (self, &error);
+  if (!iaddr)
+    goto resolve_failed;
+
+  self->socket = g_socket_new (g_inet_address_get_family (iaddr),
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error);
+  if (!self->socket) {
+    g_object_unref (iaddr);
+    goto no_socket;
+  }
+
+  /* like udpsrc, bind to the group to only get its packets */
+  bind_addr = g_inet_socket_address_new (iaddr, self->port);
+  if (!g_socket_bind (self->socket, bind_addr, TRUE, &error)) {
+    g_object_unref (bind_addr);
+    g_object_unref (iaddr);
+    goto bind_failed;
+  }
+  g_object_unref (bind_addr);
+
+  if (g_inet_address_get_is_multicast (iaddr)) {
+    gchar **ifaces = NULL, **iface;
+
+    if (self->multi_iface)
+      ifaces = g_strsplit (self->multi_iface, ",", -1);
+
+    iface = ifaces;
+    do {
+      if (!g_socket_join_multicast_group (self->socket, iaddr, FALSE,
+              iface ? g_strstrip (*iface) : NULL, &error)) {
+        g_strfreev (ifaces);
+        g_object_unref (iaddr);
+        goto join_failed;
+      }
+    } while (iface && *(++iface));
+    g_strfreev (ifaces);
+  }
+  g_object_unref (iaddr);
+
+  self->have_timestamps = FALSE;
+  if (self->timestamping)
+    gst_rtp_batch_src_enable_timestamping (self);
+
+  self->buffers = g_new0 (GstBuffer *, self->batch_size);
+  self->maps = g_new0 (GstMapInfo, self->batch_size);
+  self->overflow = g_new0 (GstMemory *, self->batch_size);
+  self->overflow_maps = g_new0 (GstMapInfo, self->batch_size);
+  self->msgs = g_new0 (struct mmsghdr, self->batch_size);
+  self->iovs = g_new0 (struct iovec, 2 * self->batch_size);
+  self->names = g_new0 (struct sockaddr_storage, self->batch_size);
+  if (self->have_timestamps)
+    self->controls = g_new0 (BatchControl, self->batch_size);
+
+  GST_DEBUG_OBJECT (self, "receiving on %s:%d, %u datagrams per call%s",
+      self->address, self->port, self->batch_size,
+      self->have_timestamps ? " with kernel timestamps" : "");
+
+  return TRUE;
+
+resolve_failed:
+  GST_ELEMENT_ERROR (self, RESOURCE, NOT_FOUND,
+      ("Could not resolve hostname '%s'", self->address),
+      ("DNS resolver reported: %s", error->message));
+  g_clear_error (&error);
+  return FALSE;
+
+no_socket:
+  GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ, (NULL),
+      ("Could not create socket: %s", error->message));
+  g_clear_error (&error);
+  return FALSE;
+
+bind_failed:
+  GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS, (NULL),
+      ("Could not bind to %s:%d: %s", self->address, self->port,
+          error->message));
+  g_clear_error (&error);
+  g_clear_object (&self->socket);
+  return FALSE;
+
+join_failed:
+  GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS, (NULL),
+      ("Could not join multicast group %s: %s", self->address,
+          error->message));
+  g_clear_error (&error);
+  g_clear_object (&self->socket);
+  return FALSE;
+}
+
+static gboolean
+gst_rtp_batch_src_stop (GstBaseSrc * src)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (src);
+
+  if (self->socket) {
+    g_socket_close (self->socket, NULL);
+    g_clear_object (&self->socket);
+  }
+
+  gst_rtp_batch_src_free_slots (self);
+  g_clear_object (&self->last_addr);
+  self->last_name_len = 0;
+
+  return TRUE;
+}
+
+static gboolean
+gst_rtp_batch_src_unlock (GstBaseSrc * src)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (src);
+
+  g_cancellable_cancel (self->cancellable);
+
+  return TRUE;
+}
+
+static gboolean
+gst_rtp_batch_src_unlock_stop (GstBaseSrc * src)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (src);
+
+  g_cancellable_reset (self->cancellable);
+
+  return TRUE;
+}
+
+static GstCaps *
+gst_rtp_batch_src_get_caps (GstBaseSrc * src, GstCaps * filter)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (src);
+  GstCaps *caps, *result;
+
+  GST_OBJECT_LOCK (self);
+  caps = self->caps ? gst_caps_ref (self->caps) : gst_caps_new_any ();
+  GST_OBJECT_UNLOCK (self);
+
+  if (filter) {
+    result = gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (caps);
+  } else {
+    result = caps;
+  }
+
+  return result;
+}
+
+/* Returns the sender of @msg as a socket address, reusing the one of the
+ * previous datagram if it is the same */
+static GSocketAddress *
+gst_rtp_batch_src_get_address (GstRtpBatchSrc * self, struct msghdr *msg)
+{
+  if (self->last_addr == NULL || msg->msg_namelen != self->last_name_len ||
+      memcmp (msg->msg_name, self->last_name, msg->msg_namelen) != 0) {
+    g_clear_object (&self->last_addr);
+    self->last_addr = g_socket_address_new_from_native (msg->msg_name,
+        msg->msg_namelen);
+    self->last_name_len = MIN (msg->msg_namelen, sizeof (self->last_name));
+    memcpy (self->last_name, msg->msg_name, self->last_name_len);
+  }
+
+  return self->last_addr;
+}
+
+/* Returns the kernel receive time of @msg in nanoseconds since the Unix
+ * epoch, from the software timestamp */
+static GstClockTime
+gst_rtp_batch_src_get_timestamp (GstRtpBatchSrc * self, struct msghdr *msg)
+{
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+  struct cmsghdr *cmsg;
+
+  for (cmsg = CMSG_FIRSTHDR (msg); cmsg; cmsg = CMSG_NXTHDR (msg, cmsg)) {
+    struct timespec ts[3];
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+      continue;
+
+    memcpy (ts, CMSG_DATA (cmsg), sizeof (ts));
+    if (ts[0].tv_sec != 0 || ts[0].tv_nsec != 0)
+      return GST_TIMESPEC_TO_TIME (ts[0]);
+  }
+#endif
+
+  return GST_CLOCK_TIME_NONE;
+}
+
+/* Receives up to batch-size datagrams without blocking, returns the number
+ * of filled slots or -1 with errno set */
+static gint
+gst_rtp_batch_src_receive (GstRtpBatchSrc * self)
+{
+  struct mmsghdr *msgs = self->msgs;
+  struct iovec *iovs = self->iovs;
+  struct sockaddr_storage *names = self->names;
+  BatchControl *controls = self->controls;
+  gsize overflow_size = MAX_DATAGRAM_SIZE - self->mtu;
+  guint i;
+  gint n;
+
+  for (i = 0; i < self->batch_size; i++) {
+    struct msghdr *hdr = &msgs[i].msg_hdr;
+
+    if (self->buffers[i] == NULL)
+      self->buffers[i] = gst_buffer_new_allocate (NULL, self->mtu, NULL);
+    gst_buffer_map (self->buffers[i], &self->maps[i], GST_MAP_WRITE);
+
+    memset (&msgs[i], 0, sizeof (msgs[i]));
+    hdr->msg_iov = &iovs[2 * i];
+    hdr->msg_iovlen = 1;
+    iovs[2 * i].iov_base = self->maps[i].data;
+    iovs[2 * i].iov_len = self->maps[i].size;
+
+    if (overflow_size > 0) {
+      if (self->overflow[i] == NULL)
+        self->overflow[i] = gst_allocator_alloc (NULL, overflow_size, NULL);
+      gst_memory_map (self->overflow[i], &self->overflow_maps[i],
+          GST_MAP_WRITE);
+
+      hdr->msg_iovlen = 2;
+      iovs[2 * i + 1].iov_base = self->overflow_maps[i].data;
+      iovs[2 * i + 1].iov_len = self->overflow_maps[i].size;
+    }
+
+    hdr->msg_name = &names[i];
+    hdr->msg_namelen = sizeof (names[i]);
+    if (controls) {
+      hdr->msg_control = controls[i].buf;
+      hdr->msg_controllen = sizeof (controls[i].buf);
+    }
+  }
+
+  do {
+    n = recvmmsg (g_socket_get_fd (self->socket), msgs, self->batch_size,
+        MSG_DONTWAIT, NULL);
+  } while (n < 0 && errno == EINTR);
+
+  for (i = 0; i < self->batch_size; i++) {
+    gst_buffer_unmap (self->buffers[i], &self->maps[i]);
+    if (self->overflow[i])
+      gst_memory_unmap (self->overflow[i], &self->overflow_maps[i]);
+  }
+
+  return n;
+}
+
+static GstFlowReturn
+gst_rtp_batch_src_create (GstPushSrc * psrc, GstBuffer ** buf)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (psrc);
+  struct mmsghdr *msgs = self->msgs;
+  GstBufferList *list;
+  GstClock *clock;
+  GstClockTime base_time = 0, now = GST_CLOCK_TIME_NONE, real_now = 0;
+  GError *error = NULL;
+  gint i, n;
+
+retry:
+  if (!g_socket_condition_wait (self->socket, G_IO_IN, self->cancellable,
+          &error)) {
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      g_clear_error (&error);
+      return GST_FLOW_FLUSHING;
+    }
+
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("Select error: %s", error->message));
+    g_clear_error (&error);
+    return GST_FLOW_ERROR;
+  }
+
+  n = gst_rtp_batch_src_receive (self);
+  if (n < 0) {
+    /* ECONNREFUSED are ICMP errors of earlier sends on this port */
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED)
+      goto retry;
+
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("Receive error: %s", g_strerror (errno)));
+    return GST_FLOW_ERROR;
+  }
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock) {
+    gst_object_ref (clock);
+    base_time = GST_ELEMENT_CAST (self)->base_time;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  if (clock) {
+    now = gst_clock_get_time (clock);
+    real_now = g_get_real_time () * GST_USECOND;
+    gst_object_unref (clock);
+  }
+
+  list = gst_buffer_list_new_sized (n);
+  for (i = 0; i < n; i++) {
+    struct msghdr *hdr = &msgs[i].msg_hdr;
+    GstBuffer *buffer = self->buffers[i];
+    GstClockTime ts = GST_CLOCK_TIME_NONE;
+
+    self->buffers[i] = NULL;
+
+    if (hdr->msg_flags & MSG_TRUNC) {
+      GST_WARNING_OBJECT (self, "dropping datagram bigger than %u bytes",
+          MAX_DATAGRAM_SIZE);
+      gst_buffer_unref (buffer);
+      continue;
+    }
+
+    if (msgs[i].msg_len > self->mtu) {
+      GST_LOG_OBJECT (self, "datagram of %u bytes is bigger than the mtu",
+          msgs[i].msg_len);
+      gst_memory_resize (self->overflow[i], 0, msgs[i].msg_len - self->mtu);
+      gst_buffer_append_memory (buffer, self->overflow[i]);
+      self->overflow[i] = NULL;
+    } else {
+      gst_buffer_set_size (buffer, msgs[i].msg_len);
+    }
+    gst_buffer_add_net_address_meta (buffer,
+        gst_rtp_batch_src_get_address (self, hdr));
+
+    if (self->have_timestamps) {
+      ts = gst_rtp_batch_src_get_timestamp (self, hdr);
+      if (GST_CLOCK_TIME_IS_VALID (ts))
+        gst_buffer_add_reference_timestamp_meta (buffer, self->timestamp_caps,
+            ts, GST_CLOCK_TIME_NONE);
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID (now) && now >= base_time) {
+      GstClockTime running_time = now - base_time;
+
+      /* move the arrival back by the time the datagram spent in the
+       * kernel */
+      if (GST_CLOCK_TIME_IS_VALID (ts) && ts < real_now)
+        running_time -= MIN (real_now - ts, running_time);
+
+      GST_BUFFER_PTS (buffer) = GST_BUFFER_DTS (buffer) = running_time;
+    }
+
+    gst_buffer_list_add (list, buffer);
+  }
+
+  if (gst_buffer_list_length (list) == 0) {
+    gst_buffer_list_unref (list);
+    goto retry;
+  }
+
+  GST_LOG_OBJECT (self, "received %u datagrams",
+      gst_buffer_list_length (list));
+
+  if (gst_buffer_list_length (list) == 1) {
+    *buf = gst_buffer_ref (gst_buffer_list_get (list, 0));
+    gst_buffer_list_unref (list);
+  } else {
+    gst_base_src_submit_buffer_list (GST_BASE_SRC (self), list);
+    *buf = NULL;
+  }
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_rtp_batch_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (object);
+
+  switch (prop_id) {
+    case PROP_ADDRESS:
+      g_free (self->address);
+      self->address = g_value_dup_string (value);
+      if (self->address == NULL)
+        self->address = g_strdup (DEFAULT_PROP_ADDRESS);
+      break;
+    case PROP_PORT:
+      self->port = g_value_get_int (value);
+      break;
+    case PROP_MULTICAST_IFACE:
+      g_free (self->multi_iface);
+      self->multi_iface = g_value_dup_string (value);
+      break;
+    case PROP_CAPS:{
+      const GstCaps *caps = gst_value_get_caps (value);
+
+      GST_OBJECT_LOCK (self);
+      gst_caps_replace (&self->caps, (GstCaps *) caps);
+      GST_OBJECT_UNLOCK (self);
+      gst_pad_mark_reconfigure (GST_BASE_SRC_PAD (self));
+      break;
+    }
+    case PROP_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_MTU:
+      self->mtu = g_value_get_uint (value);
+      break;
+    case PROP_TIMESTAMPING:
+      self->timestamping = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_batch_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (object);
+
+  switch (prop_id) {
+    case PROP_ADDRESS:
+      g_value_set_string (value, self->address);
+      break;
+    case PROP_PORT:
+      g_value_set_int (value, self->port);
+      break;
+    case PROP_MULTICAST_IFACE:
+      g_value_set_string (value, self->multi_iface);
+      break;
+    case PROP_CAPS:
+      GST_OBJECT_LOCK (self);
+      gst_value_set_caps (value, self->caps);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    case PROP_MTU:
+      g_value_set_uint (value, self->mtu);
+      break;
+    case PROP_TIMESTAMPING:
+      g_value_set_boolean (value, self->timestamping);
+      break;
+    case PROP_USED_SOCKET:
+      g_value_set_object (value, self->socket);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_batch_src_finalize (GObject * object)
+{
+  GstRtpBatchSrc *self = GST_RTP_BATCH_SRC (object);
+
+  g_free (self->address);
+  g_free (self->multi_iface);
+  gst_clear_caps (&self->caps);
+  gst_clear_caps (&self->timestamp_caps);
+  g_object_unref (self->cancellable);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_rtp_batch_src_class_init (GstRtpBatchSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
+  GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+
+  gobject_class->set_property = gst_rtp_batch_src_set_property;
+  gobject_class->get_property = gst_rtp_batch_src_get_property;
+  gobject_class->finalize = gst_rtp_batch_src_finalize;
+
+  gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_rtp_batch_src_start);
+  gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_rtp_batch_src_stop);
+  gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_rtp_batch_src_unlock);
+  gstbasesrc_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_rtp_batch_src_unlock_stop);
+  gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gst_rtp_batch_src_get_caps);
+  gstpushsrc_class->create = GST_DEBUG_FUNCPTR (gst_rtp_batch_src_create);
+
+  g_object_class_install_property (gobject_class, PROP_ADDRESS,
+      g_param_spec_string ("address", "Address",
+          "Address to receive packets from (can be IPv4 or IPv6)",
+          DEFAULT_PROP_ADDRESS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PORT,
+      g_param_spec_int ("port", "Port", "The port to receive packets on",
+          0, G_MAXUINT16, DEFAULT_PROP_PORT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MULTICAST_IFACE,
+      g_param_spec_string ("multicast-iface", "Multicast Interface",
+          "The network interfaces on which to join the multicast group, "
+          "separated by comma", DEFAULT_PROP_MULTICAST_IFACE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CAPS,
+      g_param_spec_boxed ("caps", "Caps",
+          "The caps of the source pad", GST_TYPE_CAPS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch Size",
+          "Maximum number of datagrams read per system call", 1, 1024,
+          DEFAULT_PROP_BATCH_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MTU,
+      g_param_spec_uint ("mtu", "MTU",
+          "Expected maximum size of a datagram, bigger ones are received "
+          "into an extra memory", 1, MAX_DATAGRAM_SIZE,
+          DEFAULT_PROP_MTU,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TIMESTAMPING,
+      g_param_spec_boolean ("timestamping", "Timestamping",
+          "Timestamp packets with their kernel receive time",
+          DEFAULT_PROP_TIMESTAMPING,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_USED_SOCKET,
+      g_param_spec_object ("used-socket", "Socket Handle",
+          "Socket currently in use for receiving, NULL when stopped",
+          G_TYPE_SOCKET, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  gst_element_class_add_static_pad_template (gstelement_class, &src_template);
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "RTP batched UDP source", "Source/Network",
+      "Receives batches of UDP datagrams for rtpsrc",
+      "GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>");
+}
+
+static void
+gst_rtp_batch_src_init (GstRtpBatchSrc * self)
+{
+  self->address = g_strdup (DEFAULT_PROP_ADDRESS);
+  self->port = DEFAULT_PROP_PORT;
+  self->multi_iface = g_strdup (DEFAULT_PROP_MULTICAST_IFACE);
+  self->batch_size = DEFAULT_PROP_BATCH_SIZE;
+  self->mtu = DEFAULT_PROP_MTU;
+  self->timestamping = DEFAULT_PROP_TIMESTAMPING;
+  self->cancellable = g_cancellable_new ();
+  self->timestamp_caps = gst_caps_new_empty_simple ("timestamp/x-unix");
+
+  gst_base_src_set_live (GST_BASE_SRC (self), TRUE);
+  gst_base_src_set_format (GST_BASE_SRC (self), GST_FORMAT_TIME);
+}
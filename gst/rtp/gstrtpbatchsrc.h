@@ -0,0 +1,86 @@
+/* GStreamer
+ * Copyright (C) 2026 GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_RTP_BATCH_SRC_H__
+#define __GST_RTP_BATCH_SRC_H__
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+
+G_BEGIN_DECLS
+#define GST_TYPE_RTP_BATCH_SRC \
+  (gst_rtp_batch_src_get_type())
+#define GST_RTP_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_RTP_BATCH_SRC, GstRtpBatchSrc))
+#define GST_IS_RTP_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_RTP_BATCH_SRC))
+
+typedef struct _GstRtpBatchSrc GstRtpBatchSrc;
+typedef struct _GstRtpBatchSrcClass GstRtpBatchSrcClass;
+
+/* Internal UDP source of rtpsrc reading up to batch-size datagrams per
+ * recvmmsg() call, optionally with the kernel receive timestamps */
+struct _GstRtpBatchSrc
+{
+  GstPushSrc parent;
+
+  /* Properties */
+  gchar *address;
+  gint port;
+  gchar *multi_iface;
+  GstCaps *caps;
+  guint batch_size;
+  guint mtu;
+  gboolean timestamping;
+
+  GSocket *socket;
+  GCancellable *cancellable;
+  gboolean have_timestamps;
+
+  /* One receive slot per datagram of a batch, the buffers of the slots that
+   * were not filled are reused by the next call. Like in udpsrc, the part of
+   * a datagram that does not fit in mtu bytes goes to the overflow memory of
+   * the slot, which is only added to the buffer when it was used */
+  GstBuffer **buffers;
+  GstMapInfo *maps;
+  GstMemory **overflow;
+  GstMapInfo *overflow_maps;
+  gpointer msgs;
+  gpointer iovs;
+  gpointer names;
+  gpointer controls;
+
+  /* sender of the last datagram, most packets come from the same one */
+  GSocketAddress *last_addr;
+  guint8 last_name[128];
+  guint last_name_len;
+
+  GstCaps *timestamp_caps;
+};
+
+struct _GstRtpBatchSrcClass
+{
+  GstPushSrcClass parent;
+};
+
+GType gst_rtp_batch_src_get_type (void);
+
+G_END_DECLS
+#endif /* __GST_RTP_BATCH_SRC_H__ */
@@ -48,6 +48,7 @@ struct _GstRtpSink
   gint ttl;
   gint ttl_mc;
   gchar *multi_iface;
+  gboolean gso;
 
   /* Internal elements */
   GstElement *rtpbin;
@@ -57,6 +58,12 @@ struct _GstRtpSink
   GstElement *rtcp_src;
   GstElement *rtcp_sink;
 
+  /* UDP segmentation offload, only used from the streaming thread of the
+   * RTP udpsink */
+  gulong gso_probe;
+  guint gso_size;
+  gboolean gso_failed;
+
   GMutex lock;
 };
 
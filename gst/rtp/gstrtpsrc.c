@@ -40,6 +40,11 @@
  * This element also implements the URI scheme `rtp://` allowing to render
  * RTP streams in GStreamer based media players. The RTP URI handler also
  * allows setting properties through the URI query.
+ *
+ * For high bitrate streams, #GstRtpSrc:batch-size makes the element read
+ * many packets per system call and #GstRtpSrc:timestamping timestamps them
+ * with the time the kernel received them, e.g.
+ * `rtp://239.1.1.1:5004?batch-size=64&timestamping=true`.
  */
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -52,6 +57,9 @@
 
 #include "gstrtpsrc.h"
 #include "gstrtp-utils.h"
+#ifdef HAVE_RECVMMSG
+#include "gstrtpbatchsrc.h"
+#endif
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtp_src_debug);
 #define GST_CAT_DEFAULT gst_rtp_src_debug
@@ -66,6 +74,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_rtp_src_debug);
 #define DEFAULT_PROP_PORT             5004
 #define DEFAULT_PROP_URI              "rtp://"DEFAULT_PROP_ADDRESS":"G_STRINGIFY(DEFAULT_PROP_PORT)
 #define DEFAULT_PROP_MULTICAST_IFACE  NULL
+#define DEFAULT_PROP_BATCH_SIZE       0
+#define DEFAULT_PROP_TIMESTAMPING     FALSE
 
 enum
 {
@@ -80,6 +90,8 @@ enum
   PROP_LATENCY,
   PROP_MULTICAST_IFACE,
   PROP_CAPS,
+  PROP_BATCH_SIZE,
+  PROP_TIMESTAMPING,
 
   PROP_LAST
 };
@@ -270,6 +282,12 @@ gst_rtp_src_set_property (GObject * object, guint prop_id,
         gst_caps_unref (old_caps);
       break;
     }
+    case PROP_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_TIMESTAMPING:
+      self->timestamping = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -315,6 +333,12 @@ gst_rtp_src_get_property (GObject * object, guint prop_id,
     case PROP_CAPS:
       gst_value_set_caps (value, self->caps);
       break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    case PROP_TIMESTAMPING:
+      g_value_set_boolean (value, self->timestamping);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -472,6 +496,41 @@ gst_rtp_src_class_init (GstRtpSrcClass * klass)
           "The caps of the incoming stream", GST_TYPE_CAPS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRtpSrc:batch-size:
+   *
+   * Read up to this many RTP packets per system call with recvmmsg() and
+   * push them downstream as buffer lists. 0 receives the packets one by
+   * one with udpsrc. Only available on platforms with recvmmsg().
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch Size",
+          "Maximum number of RTP packets read per system call "
+          "(0 = one by one)", 0, 1024, DEFAULT_PROP_BATCH_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpSrc:timestamping:
+   *
+   * Timestamp the RTP packets with the time the kernel received them
+   * (SO_TIMESTAMPING) instead of the time they were read, so that the
+   * jitterbuffer does not see the scheduling jitter of the receiving
+   * thread. These are software timestamps taken by the network stack. The
+   * kernel time is also attached to the buffers as a "timestamp/x-unix"
+   * #GstReferenceTimestampMeta. Linux only.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_TIMESTAMPING,
+      g_param_spec_boolean ("timestamping", "Timestamping",
+          "Timestamp RTP packets with their kernel receive time",
+          DEFAULT_PROP_TIMESTAMPING,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&src_template));
 
@@ -655,6 +714,71 @@ gst_rtp_src_on_send_rtcp (GstPad * pad, GstPadProbeInfo * info,
   return GST_PAD_PROBE_OK;
 }
 
+/* Replaces the RTP udpsrc by the batched source, or the other way around,
+ * depending on the batch-size and timestamping properties */
+static gboolean
+gst_rtp_src_setup_rtp_src (GstRtpSrc * self)
+{
+#ifdef HAVE_RECVMMSG
+  const gchar *props[] = { "address", "port", "caps", "multicast-iface" };
+  gboolean batched = self->batch_size > 0 || self->timestamping;
+  GstElement *src;
+  GstPad *pad, *peer;
+  guint i;
+
+  if (batched == GST_IS_RTP_BATCH_SRC (self->rtp_src)) {
+    if (batched)
+      g_object_set (self->rtp_src, "batch-size", MAX (self->batch_size, 1),
+          "timestamping", self->timestamping, NULL);
+    return TRUE;
+  }
+
+  if (batched) {
+    src = g_object_new (GST_TYPE_RTP_BATCH_SRC, "name", "rtp_rtp_batchsrc0",
+        "batch-size", MAX (self->batch_size, 1), "timestamping",
+        self->timestamping, NULL);
+  } else {
+    src = gst_element_factory_make ("udpsrc", "rtp_rtp_udpsrc0");
+    if (src == NULL)
+      return FALSE;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (props); i++) {
+    GValue value = G_VALUE_INIT;
+
+    g_value_init (&value,
+        g_object_class_find_property (G_OBJECT_GET_CLASS (self->rtp_src),
+            props[i])->value_type);
+    g_object_get_property (G_OBJECT (self->rtp_src), props[i], &value);
+    g_object_set_property (G_OBJECT (src), props[i], &value);
+    g_value_unset (&value);
+  }
+
+  pad = gst_element_get_static_pad (self->rtp_src, "src");
+  peer = gst_pad_get_peer (pad);
+  gst_pad_unlink (pad, peer);
+  gst_object_unref (pad);
+
+  gst_element_set_state (self->rtp_src, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (self), self->rtp_src);
+  gst_bin_add (GST_BIN (self), src);
+  self->rtp_src = src;
+
+  pad = gst_element_get_static_pad (self->rtp_src, "src");
+  gst_pad_link (pad, peer);
+  gst_object_unref (pad);
+  gst_object_unref (peer);
+
+  GST_DEBUG_OBJECT (self, "receiving RTP with %" GST_PTR_FORMAT, src);
+#else
+  if (self->batch_size > 0 || self->timestamping)
+    GST_WARNING_OBJECT (self, "recvmmsg() is not available, receiving RTP "
+        "packets one by one");
+#endif
+
+  return TRUE;
+}
+
 static gboolean
 gst_rtp_src_start (GstRtpSrc * self)
 {
@@ -770,6 +894,10 @@ gst_rtp_src_change_state (GstElement * element, GstStateChange transition)
       gst_element_state_get_name (GST_STATE_TRANSITION_CURRENT (transition)),
       gst_element_state_get_name (GST_STATE_TRANSITION_NEXT (transition)));
 
+  if (transition == GST_STATE_CHANGE_NULL_TO_READY &&
+      !gst_rtp_src_setup_rtp_src (self))
+    return GST_STATE_CHANGE_FAILURE;
+
   ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
   if (ret == GST_STATE_CHANGE_FAILURE)
     return ret;
@@ -812,6 +940,8 @@ gst_rtp_src_init (GstRtpSrc * self)
   self->ttl_mc = DEFAULT_PROP_TTL_MC;
   self->encoding_name = DEFAULT_PROP_ENCODING_NAME;
   self->caps = DEFAULT_PROP_CAPS;
+  self->batch_size = DEFAULT_PROP_BATCH_SIZE;
+  self->timestamping = DEFAULT_PROP_TIMESTAMPING;
 
   GST_OBJECT_FLAG_SET (GST_OBJECT (self), GST_ELEMENT_FLAG_SOURCE);
   gst_bin_set_suppressed_flags (GST_BIN (self),
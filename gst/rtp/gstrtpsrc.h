@@ -52,6 +52,8 @@ struct _GstRtpSrc
   gchar *encoding_name;
   gchar *multi_iface;
   GstCaps *caps;
+  guint batch_size;
+  gboolean timestamping;
 
   /* Internal elements */
   GstElement *rtpbin;
@@ -24,6 +24,11 @@
 #  include "config.h"
 #endif
 
+/* for memfd_create() */
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
@@ -34,8 +39,16 @@
 #endif
 #include <errno.h>
 #include <string.h>
+#ifdef HAVE_SYS_SOCKET_H
+#  include <fcntl.h>
+#  include <glib-unix.h>
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#endif
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
+#include <gst/allocators/allocators.h>
 #include "gstipcpipelinecomm.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
@@ -43,7 +56,20 @@ GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
 
+/* A GstBuffer cannot have more memories than that */
+#define MAX_FDS_PER_BUFFER 16
+/* id, flags, maxsize, offset and size of each memory of a fd buffer */
+#define FD_MEMORY_DESC_SIZE (4 + 4 + 8 + 8 + 8)
+#define FD_MEMORY_FLAG_DMABUF (1 << 0)
+/* Number of released memfd memories kept around for copied buffers */
+#define MEMFD_POOL_SIZE 8
+
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+
 GQuark QUARK_ID;
+static GQuark QUARK_RELEASE;
 
 typedef enum
 {
@@ -193,6 +219,10 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+      return "FD_BUFFER";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE_MEMORY:
+      return "RELEASE_MEMORY";
     default:
       return "UNKNOWN";
   }
@@ -219,6 +249,20 @@ gst_ipc_pipeline_comm_sync_fd (GstIpcPipelineComm * comm, guint32 id,
   return !comm_error;
 }
 
+#ifndef _MSC_VER
+/* Waits until fdout has room again, when it is non-blocking and full */
+static void
+wait_fdout_writable (GstIpcPipelineComm * comm)
+{
+  GPollFD pfd;
+
+  pfd.fd = comm->fdout;
+  pfd.events = G_IO_OUT | G_IO_ERR | G_IO_HUP;
+  pfd.revents = 0;
+  g_poll (&pfd, 1, -1);
+}
+#endif
+
 static gboolean
 write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
 {
@@ -246,7 +290,11 @@ write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
     ssize_t written =
         write (comm->fdout, (const unsigned char *) data + offset, size);
     if (written < 0) {
-      if (errno == EAGAIN || errno == EINTR)
+      if (errno == EAGAIN) {
+        wait_fdout_writable (comm);
+        continue;
+      }
+      if (errno == EINTR)
         continue;
       GST_ERROR_OBJECT (comm->element, "Failed to write to fd: %s",
           strerror (errno));
@@ -278,6 +326,141 @@ write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
   return ret;
 }
 
+#ifdef HAVE_SYS_SOCKET_H
+/* The fds go along with the first bytes, so the reader has them by the
+ * time it parses the chunk referring to them */
+static gboolean
+write_to_fd_with_fds (GstIpcPipelineComm * comm, const guint8 * data,
+    size_t size, const int *fds, guint n_fds)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE (sizeof (int) * MAX_FDS_PER_BUFFER)];
+  ssize_t written;
+
+  if (n_fds == 0)
+    return write_to_fd_raw (comm, data, size);
+
+  g_assert (n_fds <= MAX_FDS_PER_BUFFER);
+
+  iov.iov_base = (void *) data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  memset (control, 0, sizeof (control));
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE (sizeof (int) * n_fds);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int) * n_fds);
+  memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * n_fds);
+
+  GST_TRACE_OBJECT (comm->element, "Writing %u bytes and %u fds to fdout",
+      (unsigned) size, n_fds);
+  while ((written = sendmsg (comm->fdout, &msg, 0)) < 0) {
+    if (errno == EAGAIN)
+      wait_fdout_writable (comm);
+    else if (errno != EINTR)
+      break;
+  }
+
+  if (written < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to send fds: %s",
+        strerror (errno));
+    return FALSE;
+  }
+
+  return write_to_fd_raw (comm, data + written, size - written);
+}
+
+/* Like read(), also queuing the fds that came along */
+static ssize_t
+read_from_fd_with_fds (GstIpcPipelineComm * comm, guint8 * data, gsize size)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE (sizeof (int) * MAX_FDS_PER_BUFFER)];
+  ssize_t sz;
+
+  if (comm->fdin_not_socket == comm->pollFDin.fd)
+    return read (comm->pollFDin.fd, data, size);
+
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof (control);
+
+  sz = recvmsg (comm->pollFDin.fd, &msg, MSG_CMSG_CLOEXEC);
+  if (sz < 0 && errno == ENOTSOCK) {
+    /* a pipe, no fd can come from there */
+    comm->fdin_not_socket = comm->pollFDin.fd;
+    return read (comm->pollFDin.fd, data, size);
+  }
+
+  if (sz <= 0)
+    return sz;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    guint i, n_fds;
+    int fd;
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+    for (i = 0; i < n_fds; i++) {
+      memcpy (&fd, CMSG_DATA (cmsg) + i * sizeof (int), sizeof (int));
+      g_queue_push_tail (&comm->received_fds, GINT_TO_POINTER (fd));
+    }
+  }
+  if (msg.msg_flags & MSG_CTRUNC)
+    GST_WARNING_OBJECT (comm->element, "Some received fds were dropped");
+
+  return sz;
+}
+#endif
+
+/* Tells the peer about the memories of fd buffers we don't use anymore,
+ * must be called with the comm mutex */
+static void
+gst_ipc_pipeline_comm_write_releases_locked (GstIpcPipelineComm * comm)
+{
+  const unsigned char payload_type =
+      GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE_MEMORY;
+  GstByteWriter bw;
+  gboolean ret;
+  guint i;
+
+  g_mutex_lock (&comm->release_lock);
+  if (comm->pending_releases->len == 0 || comm->fdout < 0) {
+    g_array_set_size (comm->pending_releases, 0);
+    g_mutex_unlock (&comm->release_lock);
+    return;
+  }
+
+  GST_TRACE_OBJECT (comm->element, "Releasing %u memories",
+      comm->pending_releases->len);
+  gst_byte_writer_init (&bw);
+  ret = gst_byte_writer_put_uint8 (&bw, payload_type) &&
+      gst_byte_writer_put_uint32_le (&bw, 0) &&
+      gst_byte_writer_put_uint32_le (&bw,
+      comm->pending_releases->len * sizeof (guint32));
+  for (i = 0; ret && i < comm->pending_releases->len; i++)
+    ret = gst_byte_writer_put_uint32_le (&bw,
+        g_array_index (comm->pending_releases, guint32, i));
+  g_array_set_size (comm->pending_releases, 0);
+  g_mutex_unlock (&comm->release_lock);
+
+  if (!ret || !write_byte_writer_to_fd (comm, &bw))
+    GST_WARNING_OBJECT (comm->element, "Failed to release memories");
+  gst_byte_writer_reset (&bw);
+}
+
 static void
 gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
     guint32 ret, CommRequestType type)
@@ -304,6 +487,9 @@ gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
   if (!write_byte_writer_to_fd (comm, &bw))
     goto write_failed;
 
+  /* piggyback the releases that could not be sent right away */
+  gst_ipc_pipeline_comm_write_releases_locked (comm);
+
 done:
   g_mutex_unlock (&comm->mutex);
   gst_byte_writer_reset (&bw);
@@ -519,6 +705,181 @@ typedef struct
   guint64 flags;
 } CommBufferMetadata;
 
+#ifdef HAVE_SYS_SOCKET_H
+static gboolean
+gst_ipc_pipeline_comm_can_pass_fds (GstIpcPipelineComm * comm)
+{
+  struct stat st;
+
+  if (!comm->fd_passing)
+    return FALSE;
+
+  if (comm->checked_fdout != comm->fdout) {
+    comm->checked_fdout = comm->fdout;
+    comm->fdout_is_socket = fstat (comm->fdout, &st) == 0 &&
+        S_ISSOCK (st.st_mode);
+    if (!comm->fdout_is_socket)
+      GST_WARNING_OBJECT (comm->element, "fdout %d is not a socket, buffers "
+          "will be written on it", comm->fdout);
+  }
+
+  return comm->fdout_is_socket;
+}
+
+static GstMemory *
+gst_ipc_pipeline_comm_alloc_memfd (GstIpcPipelineComm * comm, gsize size)
+{
+  GstMemory *mem;
+  int fd;
+
+  while ((mem = g_queue_pop_head (&comm->memfd_pool))) {
+    if (mem->maxsize >= size) {
+      gst_memory_resize (mem, -(gssize) mem->offset, size);
+      return mem;
+    }
+    gst_memory_unref (mem);
+  }
+
+#ifdef HAVE_MEMFD_CREATE
+  fd = memfd_create ("gst-ipcpipeline", MFD_CLOEXEC);
+#else
+  {
+    gchar *filename = NULL;
+
+    fd = g_file_open_tmp ("gst-ipcpipeline-XXXXXX", &filename, NULL);
+    if (fd >= 0)
+      unlink (filename);
+    g_free (filename);
+  }
+#endif
+  if (fd < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to create shared memory: %s",
+        strerror (errno));
+    return NULL;
+  }
+
+  if (ftruncate (fd, size) < 0) {
+    GST_ERROR_OBJECT (comm->element, "ftruncate failed: %s", strerror (errno));
+    close (fd);
+    return NULL;
+  }
+
+  return gst_fd_allocator_alloc (comm->memfd_allocator, fd, size,
+      GST_FD_MEMORY_FLAG_NONE);
+}
+
+/* Writes the start of a fd buffer chunk, where the buffer data is replaced
+ * by the description of its memories and their fds are passed along.
+ * Buffers which are not only made of fd memories are copied into a memfd
+ * first. The memories are kept alive until the peer releases them. */
+static gboolean
+gst_ipc_pipeline_comm_write_fd_buffer_header (GstIpcPipelineComm * comm,
+    GstBuffer * buffer, const CommBufferMetadata * meta, guint32 meta_bytes)
+{
+  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER;
+  GstMemory *mems[MAX_FDS_PER_BUFFER];
+  int fds[MAX_FDS_PER_BUFFER];
+  guint n_mems, n;
+  GstByteWriter bw;
+  guint8 *data;
+  guint size;
+  gboolean ret;
+
+  n_mems = gst_buffer_n_memory (buffer);
+  for (n = 0; n < n_mems; n++) {
+    if (!gst_is_fd_memory (gst_buffer_peek_memory (buffer, n)))
+      break;
+  }
+
+  if (n_mems > 0 && n == n_mems) {
+    for (n = 0; n < n_mems; n++)
+      mems[n] = gst_buffer_get_memory (buffer, n);
+  } else if (gst_buffer_get_size (buffer) > 0) {
+    GstMapInfo map;
+
+    GST_LOG_OBJECT (comm->element, "Copying buffer to shared memory");
+    mems[0] = gst_ipc_pipeline_comm_alloc_memfd (comm,
+        gst_buffer_get_size (buffer));
+    if (!mems[0])
+      return FALSE;
+    if (!gst_memory_map (mems[0], &map, GST_MAP_WRITE)) {
+      gst_memory_unref (mems[0]);
+      return FALSE;
+    }
+    gst_buffer_extract (buffer, 0, map.data, map.size);
+    gst_memory_unmap (mems[0], &map);
+    n_mems = 1;
+  } else {
+    n_mems = 0;
+  }
+
+  gst_byte_writer_init (&bw);
+  ret = gst_byte_writer_put_uint8 (&bw, payload_type) &&
+      gst_byte_writer_put_uint32_le (&bw, comm->send_id) &&
+      gst_byte_writer_put_uint32_le (&bw, sizeof (CommBufferMetadata) +
+      sizeof (guint32) + n_mems * FD_MEMORY_DESC_SIZE + meta_bytes) &&
+      gst_byte_writer_put_data (&bw, (const guint8 *) meta,
+      sizeof (CommBufferMetadata)) &&
+      gst_byte_writer_put_uint32_le (&bw, n_mems);
+
+  for (n = 0; n < n_mems; n++) {
+    gsize offset, maxsize, msize;
+    guint32 id = ++comm->memory_id;
+
+    msize = gst_memory_get_sizes (mems[n], &offset, &maxsize);
+    ret = ret && gst_byte_writer_put_uint32_le (&bw, id) &&
+        gst_byte_writer_put_uint32_le (&bw,
+        gst_is_dmabuf_memory (mems[n]) ? FD_MEMORY_FLAG_DMABUF : 0) &&
+        gst_byte_writer_put_uint64_le (&bw, maxsize) &&
+        gst_byte_writer_put_uint64_le (&bw, offset) &&
+        gst_byte_writer_put_uint64_le (&bw, msize);
+    fds[n] = gst_fd_memory_get_fd (mems[n]);
+
+    /* takes the reference */
+    g_hash_table_insert (comm->sent_memories, GUINT_TO_POINTER (id), mems[n]);
+  }
+
+  size = gst_byte_writer_get_size (&bw);
+  data = gst_byte_writer_reset_and_get_data (&bw);
+  ret = ret && data && write_to_fd_with_fds (comm, data, size, fds, n_mems);
+  g_free (data);
+
+  return ret;
+}
+
+static void
+gst_ipc_pipeline_comm_release_memories (GstIpcPipelineComm * comm,
+    const guint8 * payload, guint32 size)
+{
+  GList *unused = NULL;
+  guint32 id;
+
+  g_mutex_lock (&comm->mutex);
+  for (; size >= sizeof (id); size -= sizeof (id), payload += sizeof (id)) {
+    GstMemory *mem;
+
+    id = GST_READ_UINT32_LE (payload);
+    mem = g_hash_table_lookup (comm->sent_memories, GUINT_TO_POINTER (id));
+    if (!mem) {
+      GST_WARNING_OBJECT (comm->element, "Release of unknown memory %u", id);
+      continue;
+    }
+    g_hash_table_steal (comm->sent_memories, GUINT_TO_POINTER (id));
+
+    GST_TRACE_OBJECT (comm->element, "Memory %u released", id);
+    if (mem->allocator == comm->memfd_allocator &&
+        g_queue_get_length (&comm->memfd_pool) < MEMFD_POOL_SIZE)
+      g_queue_push_tail (&comm->memfd_pool, mem);
+    else
+      unused = g_list_prepend (unused, mem);
+  }
+  g_mutex_unlock (&comm->mutex);
+
+  /* may give memories back to an upstream pool */
+  g_list_free_full (unused, (GDestroyNotify) gst_memory_unref);
+}
+#endif
+
 GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
@@ -531,6 +892,7 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
   GstByteWriter bw;
+  gboolean pass_fds = FALSE;
 
   g_mutex_lock (&comm->mutex);
   ++comm->send_id;
@@ -550,29 +912,39 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   /* work out meta size */
   gst_buffer_foreach_meta (buffer, build_meta, &repr);
 
-  if (!gst_byte_writer_put_uint8 (&bw, payload_type))
-    goto write_failed;
-  if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
-    goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
-    goto write_failed;
-  size = gst_buffer_get_size (buffer);
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
+#ifdef HAVE_SYS_SOCKET_H
+  pass_fds = gst_ipc_pipeline_comm_can_pass_fds (comm);
+  if (pass_fds && !gst_ipc_pipeline_comm_write_fd_buffer_header (comm, buffer,
+          &meta, repr.total_bytes))
     goto write_failed;
+#endif
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+  if (!pass_fds) {
+    if (!gst_byte_writer_put_uint8 (&bw, payload_type))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
+      goto write_failed;
+    size =
+        gst_buffer_get_size (buffer) + sizeof (guint32) +
+        sizeof (CommBufferMetadata) + repr.total_bytes;
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta,
+            sizeof (meta)))
+      goto write_failed;
+    size = gst_buffer_get_size (buffer);
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    if (!write_byte_writer_to_fd (comm, &bw))
+      goto write_failed;
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+      goto map_failed;
+    ret = write_to_fd_raw (comm, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    if (!ret)
+      goto write_failed;
+  }
 
   /* meta */
   gst_byte_writer_init (&bw);
@@ -643,44 +1015,22 @@ map_failed:
   goto done;
 }
 
-static GstBuffer *
-gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+/* Reads the meta list following the buffer data and applies it along
+ * with the buffer metadata */
+static gboolean
+gst_ipc_pipeline_comm_read_buffer_meta (GstIpcPipelineComm * comm,
+    GstBuffer * buffer, const CommBufferMetadata * bmeta, guint32 size)
 {
-  GstBuffer *buffer;
-  CommBufferMetadata meta;
   guint32 n_meta, n;
   const guint8 *payload = NULL;
-  guint32 mapped_size, buffer_data_size;
+  guint32 mapped_size;
 
-  /* this should not be called if we don't have enough yet */
-  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
-  g_return_val_if_fail (size >= sizeof (CommBufferMetadata), NULL);
-
-  mapped_size = sizeof (CommBufferMetadata) + sizeof (buffer_data_size);
-  payload = gst_adapter_map (comm->adapter, mapped_size);
-  if (!payload)
-    return NULL;
-  memcpy (&meta, payload, sizeof (CommBufferMetadata));
-  payload += sizeof (CommBufferMetadata);
-  memcpy (&buffer_data_size, payload, sizeof (buffer_data_size));
-  size -= mapped_size;
-  gst_adapter_unmap (comm->adapter);
-  gst_adapter_flush (comm->adapter, mapped_size);
-
-  if (buffer_data_size == 0) {
-    buffer = gst_buffer_new ();
-  } else {
-    buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
-    gst_adapter_flush (comm->adapter, buffer_data_size);
-  }
-  size -= buffer_data_size;
-
-  GST_BUFFER_PTS (buffer) = meta.pts;
-  GST_BUFFER_DTS (buffer) = meta.dts;
-  GST_BUFFER_DURATION (buffer) = meta.duration;
-  GST_BUFFER_OFFSET (buffer) = meta.offset;
-  GST_BUFFER_OFFSET_END (buffer) = meta.offset_end;
-  GST_BUFFER_FLAGS (buffer) = meta.flags;
+  GST_BUFFER_PTS (buffer) = bmeta->pts;
+  GST_BUFFER_DTS (buffer) = bmeta->dts;
+  GST_BUFFER_DURATION (buffer) = bmeta->duration;
+  GST_BUFFER_OFFSET (buffer) = bmeta->offset;
+  GST_BUFFER_OFFSET_END (buffer) = bmeta->offset_end;
+  GST_BUFFER_FLAGS (buffer) = bmeta->flags;
 
   /* If you don't call that, the GType isn't yet known at the
      g_type_from_name below */
@@ -688,10 +1038,8 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
 
   mapped_size = size;
   payload = gst_adapter_map (comm->adapter, mapped_size);
-  if (!payload) {
-    gst_buffer_unref (buffer);
-    return NULL;
-  }
+  if (!payload)
+    return FALSE;
   memcpy (&n_meta, payload, sizeof (n_meta));
   payload += sizeof (n_meta);
 
@@ -740,8 +1088,227 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
+  return TRUE;
+}
+
+static GstBuffer *
+gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+{
+  GstBuffer *buffer;
+  CommBufferMetadata meta;
+  const guint8 *payload = NULL;
+  guint32 mapped_size, buffer_data_size;
+
+  /* this should not be called if we don't have enough yet */
+  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
+  g_return_val_if_fail (size >= sizeof (CommBufferMetadata), NULL);
+
+  mapped_size = sizeof (CommBufferMetadata) + sizeof (buffer_data_size);
+  payload = gst_adapter_map (comm->adapter, mapped_size);
+  if (!payload)
+    return NULL;
+  memcpy (&meta, payload, sizeof (CommBufferMetadata));
+  payload += sizeof (CommBufferMetadata);
+  memcpy (&buffer_data_size, payload, sizeof (buffer_data_size));
+  size -= mapped_size;
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, mapped_size);
+
+  if (buffer_data_size == 0) {
+    buffer = gst_buffer_new ();
+  } else {
+    buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
+    gst_adapter_flush (comm->adapter, buffer_data_size);
+  }
+  size -= buffer_data_size;
+
+  if (!gst_ipc_pipeline_comm_read_buffer_meta (comm, buffer, &meta, size)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+#ifdef HAVE_SYS_SOCKET_H
+typedef struct
+{
+  GstIpcPipelineComm *comm;
+  GstElement *element;
+  guint32 id;
+} CommMemoryRelease;
+
+/* Queues the release of the memory @id for the reader thread, which
+ * sends it with the next ones */
+static void
+gst_ipc_pipeline_comm_queue_release (GstIpcPipelineComm * comm, guint32 id)
+{
+  g_mutex_lock (&comm->release_lock);
+  g_array_append_val (comm->pending_releases, id);
+  g_mutex_unlock (&comm->release_lock);
+}
+
+static void
+comm_memory_release_free (CommMemoryRelease * release)
+{
+  GstIpcPipelineComm *comm = release->comm;
+
+  /* This can be any thread, including one holding the comm mutex, so the
+   * release is left to the reader thread */
+  gst_ipc_pipeline_comm_queue_release (comm, release->id);
+  if (comm->release_wakeup[1] >= 0) {
+    const guint8 wakeup = 1;
+
+    /* a full pipe already wakes the reader thread up */
+    if (write (comm->release_wakeup[1], &wakeup, 1) < 0 && errno != EAGAIN)
+      GST_WARNING_OBJECT (comm->element, "Failed to wake the reader up: %s",
+          g_strerror (errno));
+  }
+
+  gst_object_unref (release->element);
+  g_free (release);
+}
+
+/* Drops the first @n received fds */
+static void
+gst_ipc_pipeline_comm_close_received_fds (GstIpcPipelineComm * comm, guint n)
+{
+  while (n-- > 0 && !g_queue_is_empty (&comm->received_fds))
+    close (GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds)));
+}
+
+/* The memory described by the peer must lie within the fd it passed */
+static gboolean
+fd_memory_is_valid (int fd, guint64 maxsize, guint64 offset, guint64 size)
+{
+  off_t fd_size = lseek (fd, 0, SEEK_END);
+
+  return fd_size >= 0 && maxsize <= (guint64) fd_size &&
+      maxsize <= G_MAXSSIZE && offset <= maxsize && size <= maxsize - offset;
+}
+
+static GstBuffer *
+gst_ipc_pipeline_comm_read_fd_buffer (GstIpcPipelineComm * comm, guint32 size)
+{
+  GstBuffer *buffer;
+  CommBufferMetadata meta;
+  const guint8 *payload = NULL, *descs;
+  guint32 mapped_size, n_mems, n;
+
+  /* this should not be called if we don't have enough yet */
+  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
+
+  mapped_size = sizeof (CommBufferMetadata) + sizeof (n_mems);
+  if (size < mapped_size)
+    return NULL;
+  payload = gst_adapter_map (comm->adapter, mapped_size);
+  if (!payload)
+    return NULL;
+  memcpy (&meta, payload, sizeof (CommBufferMetadata));
+  payload += sizeof (CommBufferMetadata);
+  n_mems = GST_READ_UINT32_LE (payload);
+  size -= mapped_size;
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, mapped_size);
+
+  if (n_mems > MAX_FDS_PER_BUFFER || size < n_mems * FD_MEMORY_DESC_SIZE) {
+    GST_ERROR_OBJECT (comm->element, "Invalid fd buffer with %u memories",
+        n_mems);
+    gst_ipc_pipeline_comm_close_received_fds (comm, n_mems);
+    return NULL;
+  }
+
+  mapped_size = n_mems * FD_MEMORY_DESC_SIZE;
+  payload = mapped_size ? gst_adapter_map (comm->adapter, mapped_size) : NULL;
+  descs = payload;
+  if (mapped_size && !payload) {
+    gst_ipc_pipeline_comm_close_received_fds (comm, n_mems);
+    return NULL;
+  }
+
+  if (g_queue_get_length (&comm->received_fds) < n_mems) {
+    GST_ERROR_OBJECT (comm->element, "Fd buffer with %u memories, only %u "
+        "fds received", n_mems, g_queue_get_length (&comm->received_fds));
+    gst_ipc_pipeline_comm_close_received_fds (comm, n_mems);
+    n = 0;
+    goto release_memories;
+  }
+
+  buffer = gst_buffer_new ();
+  for (n = 0; n < n_mems; n++) {
+    CommMemoryRelease *release;
+    GstMemory *mem;
+    guint32 id, flags;
+    guint64 maxsize, offset, msize;
+    int fd;
+
+    id = GST_READ_UINT32_LE (payload);
+    flags = GST_READ_UINT32_LE (payload + 4);
+    maxsize = GST_READ_UINT64_LE (payload + 8);
+    offset = GST_READ_UINT64_LE (payload + 16);
+    msize = GST_READ_UINT64_LE (payload + 24);
+    payload += FD_MEMORY_DESC_SIZE;
+
+    fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds));
+    if (!fd_memory_is_valid (fd, maxsize, offset, msize)) {
+      GST_ERROR_OBJECT (comm->element, "Invalid memory %u: offset %"
+          G_GUINT64_FORMAT ", size %" G_GUINT64_FORMAT ", maxsize %"
+          G_GUINT64_FORMAT, id, offset, msize, maxsize);
+      close (fd);
+      gst_buffer_unref (buffer);
+      /* the fds of the other memories of this buffer */
+      gst_ipc_pipeline_comm_close_received_fds (comm, n_mems - n - 1);
+      goto release_memories;
+    }
+
+    /* the memory owns the fd from now on */
+    if (flags & FD_MEMORY_FLAG_DMABUF)
+      mem = gst_dmabuf_allocator_alloc (comm->dmabuf_allocator, fd, maxsize);
+    else
+      mem = gst_fd_allocator_alloc (comm->fd_allocator, fd, maxsize,
+          GST_FD_MEMORY_FLAG_NONE);
+    if (!mem) {
+      close (fd);
+      gst_ipc_pipeline_comm_queue_release (comm, id);
+      continue;
+    }
+    gst_memory_resize (mem, offset, msize);
+    GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+
+    /* the peer gets the id back once this memory is freed */
+    release = g_new (CommMemoryRelease, 1);
+    release->comm = comm;
+    release->element = gst_object_ref (comm->element);
+    release->id = id;
+    gst_mini_object_set_qdata (GST_MINI_OBJECT (mem), QUARK_RELEASE, release,
+        (GDestroyNotify) comm_memory_release_free);
+
+    gst_buffer_append_memory (buffer, mem);
+  }
+  if (mapped_size) {
+    gst_adapter_unmap (comm->adapter);
+    gst_adapter_flush (comm->adapter, mapped_size);
+  }
+  size -= mapped_size;
+
+  if (!gst_ipc_pipeline_comm_read_buffer_meta (comm, buffer, &meta, size)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
   return buffer;
+
+release_memories:
+  /* the peer keeps the memories we did not take until they are released,
+   * the ones before @n were released with the buffer */
+  for (; n < n_mems; n++)
+    gst_ipc_pipeline_comm_queue_release (comm,
+        GST_READ_UINT32_LE (descs + n * FD_MEMORY_DESC_SIZE));
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, mapped_size);
+  return NULL;
 }
+#endif
 
 static gboolean
 gst_ipc_pipeline_comm_write_sink_message_event_to_fd (GstIpcPipelineComm * comm,
@@ -1630,11 +2197,61 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   comm->adapter = gst_adapter_new ();
   comm->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&comm->pollFDin);
+
+  comm->checked_fdout = comm->fdin_not_socket = -1;
+  comm->sent_memories =
+      g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) gst_memory_unref);
+  g_queue_init (&comm->memfd_pool);
+  g_queue_init (&comm->received_fds);
+  comm->memfd_allocator = gst_fd_allocator_new ();
+  comm->fd_allocator = gst_fd_allocator_new ();
+  comm->dmabuf_allocator = gst_dmabuf_allocator_new ();
+  g_mutex_init (&comm->release_lock);
+  comm->pending_releases = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  comm->release_wakeup[0] = comm->release_wakeup[1] = -1;
+  gst_poll_fd_init (&comm->pollFDrelease);
+#ifdef HAVE_SYS_SOCKET_H
+  if (g_unix_open_pipe (comm->release_wakeup, FD_CLOEXEC, NULL)) {
+    g_unix_set_fd_nonblocking (comm->release_wakeup[0], TRUE, NULL);
+    g_unix_set_fd_nonblocking (comm->release_wakeup[1], TRUE, NULL);
+    comm->pollFDrelease.fd = comm->release_wakeup[0];
+    gst_poll_add_fd (comm->poll, &comm->pollFDrelease);
+    gst_poll_fd_ctl_read (comm->poll, &comm->pollFDrelease, TRUE);
+  }
+#endif
+}
+
+static void
+gst_ipc_pipeline_comm_drop_fds (GstIpcPipelineComm * comm)
+{
+  g_hash_table_remove_all (comm->sent_memories);
+  g_queue_foreach (&comm->memfd_pool, (GFunc) gst_memory_unref, NULL);
+  g_queue_clear (&comm->memfd_pool);
+#ifdef HAVE_SYS_SOCKET_H
+  while (!g_queue_is_empty (&comm->received_fds))
+    close (GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds)));
+#endif
+  comm->checked_fdout = comm->fdin_not_socket = -1;
 }
 
 void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
+  gst_ipc_pipeline_comm_drop_fds (comm);
+  g_hash_table_destroy (comm->sent_memories);
+  gst_object_unref (comm->memfd_allocator);
+  gst_object_unref (comm->fd_allocator);
+  gst_object_unref (comm->dmabuf_allocator);
+  g_array_unref (comm->pending_releases);
+  g_mutex_clear (&comm->release_lock);
+#ifdef HAVE_SYS_SOCKET_H
+  if (comm->release_wakeup[0] >= 0) {
+    close (comm->release_wakeup[0]);
+    close (comm->release_wakeup[1]);
+  }
+#endif
   g_hash_table_destroy (comm->waiting_ids);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
@@ -1676,6 +2293,9 @@ gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
         g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
         (GDestroyNotify) comm_request_free);
   }
+  /* nobody is going to release the memories we passed anymore */
+  if (cleanup || comm->fdout < 0)
+    gst_ipc_pipeline_comm_drop_fds (comm);
   g_mutex_unlock (&comm->mutex);
 }
 
@@ -1761,6 +2381,16 @@ again:
       ret = (errno == EBUSY) ? 2 : 1;
   }
 
+#ifdef HAVE_SYS_SOCKET_H
+  /* the pending releases are sent by the caller, after reading */
+  if (comm->pollFDrelease.fd >= 0
+      && gst_poll_fd_can_read (comm->poll, &comm->pollFDrelease)) {
+    guint8 wakeup[16];
+
+    while (read (comm->pollFDrelease.fd, wakeup, sizeof (wakeup)) > 0);
+  }
+#endif
+
   /* read from fdin if possible and push data to our adapter */
   if (comm->pollFDin.fd >= 0
       && gst_poll_fd_can_read (comm->poll, &comm->pollFDin)) {
@@ -1778,6 +2408,8 @@ again:
         errno = last_error;
       }
     }
+#elif defined (HAVE_SYS_SOCKET_H)
+    sz = read_from_fd_with_fds (comm, map.data, map.size);
 #else
     sz = read (comm->pollFDin.fd, map.data, map.size);
 #endif
@@ -1845,6 +2477,8 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE_MEMORY:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1909,6 +2543,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1916,7 +2551,16 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        if (comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER)
+          buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+#ifdef HAVE_SYS_SOCKET_H
+        else
+          buf = gst_ipc_pipeline_comm_read_fd_buffer (comm,
+              comm->payload_length);
+#else
+        else
+          buf = NULL;
+#endif
         if (!buf)
           goto buffer_failed;
 
@@ -2106,6 +2750,26 @@ read_many (GstIpcPipelineComm * comm)
         if (comm->on_message)
           (*comm->on_message) (comm->id, message, comm->user_data);
 
+        GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
+        comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
+        break;
+      }
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE_MEMORY:
+      {
+        available = gst_adapter_available (comm->adapter);
+        if (available < comm->payload_length)
+          goto done;
+
+#ifdef HAVE_SYS_SOCKET_H
+        if (comm->payload_length) {
+          payload = gst_adapter_map (comm->adapter, comm->payload_length);
+          gst_ipc_pipeline_comm_release_memories (comm, payload,
+              comm->payload_length);
+          gst_adapter_unmap (comm->adapter);
+        }
+#endif
+        gst_adapter_flush (comm->adapter, comm->payload_length);
+
         GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
         comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
         break;
@@ -2188,6 +2852,10 @@ reader_thread (gpointer data)
         break;
       default:
         read_many (comm);
+        /* the releases queued by the threads freeing the memories */
+        g_mutex_lock (&comm->mutex);
+        gst_ipc_pipeline_comm_write_releases_locked (comm);
+        g_mutex_unlock (&comm->mutex);
         break;
     }
   }
@@ -2352,6 +3020,7 @@ gst_ipc_pipeline_comm_plugin_init (void)
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_comm_debug, "ipcpipelinecomm", 0,
         "ipc pipeline comm");
     QUARK_ID = g_quark_from_static_string ("ipcpipeline-id");
+    QUARK_RELEASE = g_quark_from_static_string ("ipcpipeline-release");
     REGISTER_SERIALIZATION_NO_COMPARE (gst_event_get_type (), event);
     g_once_init_leave (&once, (gsize) 1);
   }
@@ -51,6 +51,8 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE_MEMORY,
 } GstIpcPipelineCommDataType;
 
 typedef struct
@@ -76,6 +78,26 @@ typedef struct
   guint read_chunk_size;
   GstClockTime ack_time;
 
+  /* fd passing of the buffer memories, sender side */
+  gboolean fd_passing;
+  int checked_fdout;
+  gboolean fdout_is_socket;
+  guint32 memory_id;
+  GHashTable *sent_memories;
+  GQueue memfd_pool;
+  GstAllocator *memfd_allocator;
+
+  /* receiver side */
+  int fdin_not_socket;
+  GQueue received_fds;
+  GstAllocator *fd_allocator;
+  GstAllocator *dmabuf_allocator;
+  GMutex release_lock;
+  GArray *pending_releases;
+  /* wakes the reader thread up to send the pending releases */
+  int release_wakeup[2];
+  GstPollFD pollFDrelease;
+
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
   void (*on_query) (guint32, GstQuery *, gboolean, gpointer);
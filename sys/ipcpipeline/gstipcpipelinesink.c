@@ -66,7 +66,11 @@
  * GError are serialized differently).
  *
  * Buffers are transported by writing their content directly on the socket.
- * More efficient ways for memory sharing could be implemented in the future.
+ * When #GstIpcPipelineSink:fd-passing is enabled and the output is a Unix
+ * socket, only their metadata goes through the socket and their memories are
+ * passed as file descriptors instead. Memories which are not backed by a file
+ * descriptor are copied once into a memfd. Each memory is kept alive until the
+ * slave tells it does not use it anymore.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -99,11 +103,13 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_FD_PASSING,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_FD_PASSING FALSE
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -179,6 +185,20 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstIpcPipelineSink:fd-passing:
+   *
+   * Pass the buffer memories to ipcpipelinesrc as file descriptors instead
+   * of writing their content on the socket. This requires fdout to be a Unix
+   * socket, buffers are written on it otherwise.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing", "FD passing",
+          "Pass the buffer memories as file descriptors",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
       G_TYPE_FROM_CLASS (klass),
@@ -214,6 +234,7 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.fd_passing = DEFAULT_FD_PASSING;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -275,6 +296,9 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_FD_PASSING:
+      sink->comm.fd_passing = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -300,6 +324,9 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, sink->comm.fd_passing);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -39,6 +39,7 @@
 #include "gstshmsink.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
 
@@ -58,17 +59,32 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_RING_SIZE,
+  PROP_FD_PASSING
 };
 
 struct GstShmClient
 {
   ShmClient *client;
   GstPollFD pollfd;
+  GstPollFD ringpollfd;
 };
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_RING_SIZE 64
+#define DEFAULT_FD_PASSING FALSE
+
+/* Identifies a fd memory towards the clients as long as it is alive */
+typedef struct
+{
+  /* the memory must not keep the sink alive */
+  GWeakRef sink;
+  guint id;
+} GstShmSinkFdId;
+
+static GQuark fd_id_quark;
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -103,6 +119,7 @@ static gboolean gst_shm_sink_propose_allocation (GstBaseSink * sink,
     GstQuery * query);
 
 static gpointer pollthread_func (gpointer data);
+static void free_buffer_locked (GstBuffer * buffer, void *data);
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
@@ -308,6 +325,21 @@ gst_shm_sink_allocator_alloc (GstAllocator * allocator, gsize size,
 
   GST_OBJECT_LOCK (self->sink);
   memory = gst_shm_sink_allocator_alloc_locked (self, size, params);
+  if (!memory && self->sink->pipe) {
+    GSList *list = NULL;
+
+    /* The clients using a notification ring batch their acks, release the
+     * buffers they are already done with before giving up */
+    sp_writer_ring_release_acked (self->sink->pipe,
+        (sp_buffer_free_callback) free_buffer_locked, &list);
+    if (list) {
+      GST_OBJECT_UNLOCK (self->sink);
+      g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+      GST_OBJECT_LOCK (self->sink);
+      if (self->sink->pipe)
+        memory = gst_shm_sink_allocator_alloc_locked (self, size, params);
+    }
+  }
   GST_OBJECT_UNLOCK (self->sink);
 
   if (!memory) {
@@ -357,6 +389,8 @@ gst_shm_sink_init (GstShmSink * self)
   self->unlock = FALSE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->ring_size = DEFAULT_RING_SIZE;
+  self->fd_passing = DEFAULT_FD_PASSING;
 
   gst_allocation_params_init (&self->params);
 }
@@ -419,6 +453,42 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSink:ring-size:
+   *
+   * Number of slots of the notification ring offered to the sources that
+   * ask for one with #GstShmSrc:use-ring. Buffers are then announced and
+   * acked through the ring in shared memory instead of the control socket,
+   * and a source that has as many buffers in flight misses the next ones.
+   * Rounded up to a power of two, 0 makes all sources use the socket.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size",
+          "Notification ring size",
+          "Number of slots of the notification ring offered to the sources, "
+          "0 to only use the control socket",
+          0, 65536, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSink:fd-passing:
+   *
+   * Send buffers made of a single fd backed memory, such as memfd or
+   * dmabuf, by passing the fd to the sources instead of copying them into
+   * the shared memory area. Each fd is only passed once to a source, until
+   * the memory is freed. Only used when all connected sources support it,
+   * the buffers are copied otherwise.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing", "FD passing",
+          "Pass the fd of fd backed memory to the sources instead of copying "
+          "it into the shared memory area", DEFAULT_FD_PASSING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
       G_TYPE_NONE, 1, G_TYPE_INT);
@@ -436,6 +506,8 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
       "Olivier Crete <olivier.crete@collabora.co.uk>");
 
   GST_DEBUG_CATEGORY_INIT (shmsink_debug, "shmsink", 0, "Shared Memory Sink");
+
+  fd_id_quark = g_quark_from_static_string ("GstShmSinkFdId");
 }
 
 static void
@@ -507,6 +579,20 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_RING_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->ring_size = g_value_get_uint (value);
+      if (self->pipe)
+        sp_writer_set_ring_size (self->pipe, self->ring_size);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      self->fd_passing = g_value_get_boolean (value);
+      if (self->pipe)
+        sp_writer_set_fd_passing (self->pipe, self->fd_passing);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -536,6 +622,12 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, self->fd_passing);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -572,6 +664,8 @@ gst_shm_sink_start (GstBaseSink * bsink)
   }
 
   sp_set_data (self->pipe, self);
+  sp_writer_set_ring_size (self->pipe, self->ring_size);
+  sp_writer_set_fd_passing (self->pipe, self->fd_passing);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
 
@@ -642,6 +736,15 @@ gst_shm_sink_stop (GstBaseSink * bsink)
   return TRUE;
 }
 
+/* Waits for the poll thread to release buffers, the clients using a
+ * notification ring only signal their acks right away if asked to */
+static void
+gst_shm_sink_wait_released_locked (GstShmSink * self)
+{
+  sp_writer_ring_want_acks (self->pipe);
+  g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+}
+
 static gboolean
 gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
 {
@@ -660,6 +763,103 @@ gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
   return TRUE;
 }
 
+static void
+gst_shm_sink_fd_id_free (GstShmSinkFdId * fd_id)
+{
+  GstShmSink *sink = g_weak_ref_get (&fd_id->sink);
+
+  /* The memory is gone, the clients can close their copy of the fd. If the
+   * sink is gone too, its pipe and the clients went with it */
+  if (sink) {
+    GST_OBJECT_LOCK (sink);
+    if (sink->pipe)
+      sp_writer_forget_fd (sink->pipe, fd_id->id);
+    GST_OBJECT_UNLOCK (sink);
+    gst_object_unref (sink);
+  }
+
+  g_weak_ref_clear (&fd_id->sink);
+  g_slice_free (GstShmSinkFdId, fd_id);
+}
+
+/* Returns the id given to @memory by the sink that sent it, or NULL if no
+ * sink sent it yet or if that sink is gone. @sink is then set to a
+ * reference to that sink, or to NULL */
+static GstShmSinkFdId *
+gst_shm_sink_get_fd_id (GstMemory * memory, GstShmSink ** sink)
+{
+  GstShmSinkFdId *fd_id;
+
+  *sink = NULL;
+  fd_id = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (memory),
+      fd_id_quark);
+  if (fd_id)
+    *sink = g_weak_ref_get (&fd_id->sink);
+
+  return *sink ? fd_id : NULL;
+}
+
+/* Returns the memory of @buf if it can be sent by passing its fd */
+static GstMemory *
+gst_shm_sink_get_fd_memory_locked (GstShmSink * self, GstBuffer * buf)
+{
+  GstShmSink *owner;
+  GstMemory *memory;
+
+  if (!self->fd_passing || gst_buffer_n_memory (buf) != 1)
+    return NULL;
+
+  memory = gst_buffer_peek_memory (buf, 0);
+  if (!gst_is_fd_memory (memory))
+    return NULL;
+
+  /* Already sent by another shmsink */
+  if (gst_shm_sink_get_fd_id (memory, &owner)) {
+    gst_object_unref (owner);
+    if (owner != self)
+      return NULL;
+  }
+
+  if (!sp_writer_clients_accept_fds (self->pipe))
+    return NULL;
+
+  return memory;
+}
+
+static int
+gst_shm_sink_send_fd_locked (GstShmSink * self, GstMemory * memory,
+    GstBuffer * sendbuf)
+{
+  GstShmSinkFdId *fd_id;
+  GstShmSink *owner;
+  gsize offset, maxsize, size;
+
+  fd_id = gst_shm_sink_get_fd_id (memory, &owner);
+  if (owner)
+    gst_object_unref (owner);
+  if (!fd_id) {
+    /* replaces the id of a sink that is gone */
+    fd_id = g_slice_new (GstShmSinkFdId);
+    g_weak_ref_init (&fd_id->sink, self);
+    /* 0 is not a valid id */
+    if (++self->next_fd_id == 0)
+      self->next_fd_id++;
+    fd_id->id = self->next_fd_id;
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (memory), fd_id_quark,
+        fd_id, (GDestroyNotify) gst_shm_sink_fd_id_free);
+  }
+
+  size = gst_memory_get_sizes (memory, &offset, &maxsize);
+
+  GST_LOG_OBJECT (self, "Passing fd %d (id %u) for %" G_GSIZE_FORMAT
+      " bytes at offset %" G_GSIZE_FORMAT, gst_fd_memory_get_fd (memory),
+      fd_id->id, size, offset);
+
+  return sp_writer_send_fd_buf (self->pipe, gst_fd_memory_get_fd (memory),
+      fd_id->id, maxsize, gst_is_dmabuf_memory (memory), offset, size,
+      sendbuf);
+}
+
 static GstFlowReturn
 gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
@@ -669,8 +869,10 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   gboolean need_new_memory = FALSE;
   GstFlowReturn ret = GST_FLOW_OK;
   GstMemory *memory = NULL;
+  GstMemory *fd_memory;
   GstBuffer *sendbuf = NULL;
   gsize written_bytes;
+  GSList *released = NULL;
 
   GST_OBJECT_LOCK (self);
   if (self->unlock) {
@@ -691,7 +893,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   }
 
   while (!gst_shm_sink_can_render (self, GST_BUFFER_TIMESTAMP (buf))) {
-    g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+    gst_shm_sink_wait_released_locked (self);
     if (self->unlock) {
       GST_OBJECT_UNLOCK (self);
       ret = gst_base_sink_wait_preroll (bsink);
@@ -702,6 +904,22 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     }
   }
 
+  fd_memory = gst_shm_sink_get_fd_memory_locked (self, buf);
+  if (fd_memory) {
+    sendbuf = gst_buffer_ref (buf);
+    sp_writer_ring_release_acked (self->pipe,
+        (sp_buffer_free_callback) free_buffer_locked, &released);
+    rv = gst_shm_sink_send_fd_locked (self, fd_memory, sendbuf);
+    GST_OBJECT_UNLOCK (self);
+
+    g_slist_free_full (released, (GDestroyNotify) gst_buffer_unref);
+    if (rv == 0) {
+      GST_DEBUG_OBJECT (self, "No clients connected, unreffing buffer");
+      gst_buffer_unref (sendbuf);
+    }
+
+    return ret;
+  }
 
   if (gst_buffer_n_memory (buf) > 1) {
     GST_LOG_OBJECT (self, "Buffer %p has %d GstMemory, we only support a single"
@@ -730,7 +948,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     while ((memory =
             gst_shm_sink_allocator_alloc_locked (self->allocator,
                 gst_buffer_get_size (buf), &self->params)) == NULL) {
-      g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+      gst_shm_sink_wait_released_locked (self);
       if (self->unlock) {
         GST_OBJECT_UNLOCK (self);
         ret = gst_base_sink_wait_preroll (bsink);
@@ -786,6 +1004,11 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     goto error;
   }
 
+  /* The clients using a notification ring only signal their acks once in a
+   * while, release what they are done with so their ring doesn't fill up */
+  sp_writer_ring_release_acked (self->pipe,
+      (sp_buffer_free_callback) free_buffer_locked, &released);
+
   /* Make the memory readonly as of now as we've sent it to the other side
    * We know it's not mapped for writing anywhere as we just mapped it for
    * reading
@@ -802,6 +1025,8 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 
   GST_OBJECT_UNLOCK (self);
 
+  g_slist_free_full (released, (GDestroyNotify) gst_buffer_unref);
+
   if (rv == 0) {
     GST_DEBUG_OBJECT (self, "No clients connected, unreffing buffer");
     gst_buffer_unref (sendbuf);
@@ -811,6 +1036,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 
 error:
   GST_OBJECT_UNLOCK (self);
+  g_slist_free_full (released, (GDestroyNotify) gst_buffer_unref);
   return GST_FLOW_ERROR;
 }
 
@@ -879,6 +1105,7 @@ pollthread_func (gpointer data)
 
       gclient = g_slice_new (struct GstShmClient);
       gclient->client = client;
+      gst_poll_fd_init (&gclient->ringpollfd);
       gst_poll_fd_init (&gclient->pollfd);
       gclient->pollfd.fd = sp_writer_get_client_fd (client);
       gst_poll_add_fd (self->poll, &gclient->pollfd);
@@ -908,6 +1135,23 @@ pollthread_func (gpointer data)
         goto close_client;
       }
 
+      if (gclient->ringpollfd.fd >= 0 &&
+          gst_poll_fd_can_read (self->poll, &gclient->ringpollfd)) {
+        GSList *list = NULL;
+        int rv;
+
+        GST_OBJECT_LOCK (self);
+        rv = sp_writer_ring_recv (self->pipe, gclient->client,
+            (sp_buffer_free_callback) free_buffer_locked, &list);
+        GST_OBJECT_UNLOCK (self);
+        g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+
+        if (rv < 0) {
+          GST_WARNING_OBJECT (self, "One client sent invalid acks, closing");
+          goto close_client;
+        }
+      }
+
       if (gst_poll_fd_can_read (self->poll, &gclient->pollfd)) {
         int rv;
         gpointer tag = NULL;
@@ -926,6 +1170,17 @@ pollthread_func (gpointer data)
 
         if (rv == 0)
           gst_buffer_unref (tag);
+
+        /* The client just got its notification ring */
+        if (gclient->ringpollfd.fd < 0 &&
+            sp_writer_get_client_ring_fd (gclient->client) >= 0) {
+          gclient->ringpollfd.fd =
+              sp_writer_get_client_ring_fd (gclient->client);
+          gst_poll_add_fd (self->poll, &gclient->ringpollfd);
+          gst_poll_fd_ctl_read (self->poll, &gclient->ringpollfd, TRUE);
+          GST_DEBUG_OBJECT (self, "Client %d uses a notification ring",
+              gclient->pollfd.fd);
+        }
       }
       continue;
     close_client:
@@ -939,6 +1194,8 @@ pollthread_func (gpointer data)
       }
 
       gst_poll_remove_fd (self->poll, &gclient->pollfd);
+      if (gclient->ringpollfd.fd >= 0)
+        gst_poll_remove_fd (self->poll, &gclient->ringpollfd);
       self->clients = g_list_remove (self->clients, gclient);
 
       g_signal_emit (self, signals[SIGNAL_CLIENT_DISCONNECTED], 0,
@@ -964,7 +1221,7 @@ gst_shm_sink_event (GstBaseSink * bsink, GstEvent * event)
       GST_OBJECT_LOCK (self);
       while (self->wait_for_connection && sp_writer_pending_writes (self->pipe)
           && !self->unlock)
-        g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+        gst_shm_sink_wait_released_locked (self);
       GST_OBJECT_UNLOCK (self);
       break;
     default:
@@ -60,6 +60,9 @@ struct _GstShmSink
   GstPollFD serverpollfd;
 
   gboolean wait_for_connection;
+  guint ring_size;
+  gboolean fd_passing;
+  guint next_fd_id;
   gboolean stop;
   gboolean unlock;
   GstClockTimeDiff buffer_time;
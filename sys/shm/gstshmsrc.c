@@ -41,6 +41,7 @@
 #include "gstshmsrc.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
 
@@ -56,13 +57,20 @@ enum
   PROP_0,
   PROP_SOCKET_PATH,
   PROP_IS_LIVE,
-  PROP_SHM_AREA_NAME
+  PROP_SHM_AREA_NAME,
+  PROP_USE_RING,
+  PROP_RING_BUFFERS
 };
 
+#define DEFAULT_USE_RING FALSE
+
 struct GstShmBuffer
 {
   char *buf;
   GstShmPipe *pipe;
+  gboolean from_ring;
+  /* fd is -1 for buffers in the shared memory area */
+  ShmFdBuffer fdbuf;
 };
 
 
@@ -137,6 +145,35 @@ gst_shm_src_class_init (GstShmSrcClass * klass)
           "The name of the shared memory area used to get buffers",
           NULL, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSrc:use-ring:
+   *
+   * Ask the sink for a notification ring in shared memory, buffers are
+   * then received and released without a message on the control socket
+   * each and the acks are batched. The sink must support it, see
+   * #GstShmSink:ring-size, otherwise the control socket keeps being used.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_USE_RING,
+      g_param_spec_boolean ("use-ring", "Use a notification ring",
+          "Ask the sink to announce buffers through a ring in shared memory "
+          "instead of the control socket", DEFAULT_USE_RING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSrc:ring-buffers:
+   *
+   * Number of buffers received through the notification ring since the
+   * element was started, see #GstShmSrc:use-ring.
+   *
+   * Since: 1.24
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_BUFFERS,
+      g_param_spec_uint64 ("ring-buffers", "Ring buffers",
+          "Number of buffers received through the notification ring", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &srctemplate);
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -153,6 +190,10 @@ gst_shm_src_init (GstShmSrc * self)
 {
   self->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&self->pollfd);
+  gst_poll_fd_init (&self->ringpollfd);
+  self->use_ring = DEFAULT_USE_RING;
+  self->fd_allocator = gst_fd_allocator_new ();
+  self->dmabuf_allocator = gst_dmabuf_allocator_new ();
 }
 
 static void
@@ -162,6 +203,8 @@ gst_shm_src_finalize (GObject * object)
 
   gst_poll_free (self->poll);
   g_free (self->socket_path);
+  gst_object_unref (self->fd_allocator);
+  gst_object_unref (self->dmabuf_allocator);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -189,6 +232,11 @@ gst_shm_src_set_property (GObject * object, guint prop_id,
       gst_base_src_set_live (GST_BASE_SRC (object),
           g_value_get_boolean (value));
       break;
+    case PROP_USE_RING:
+      GST_OBJECT_LOCK (object);
+      self->use_ring = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -216,6 +264,16 @@ gst_shm_src_get_property (GObject * object, guint prop_id,
         g_value_set_string (value, sp_get_shm_area_name (self->pipe->pipe));
       GST_OBJECT_UNLOCK (object);
       break;
+    case PROP_USE_RING:
+      GST_OBJECT_LOCK (object);
+      g_value_set_boolean (value, self->use_ring);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_RING_BUFFERS:
+      GST_OBJECT_LOCK (object);
+      g_value_set_uint64 (value, self->ring_buffers);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -241,6 +299,12 @@ gst_shm_src_start_reading (GstShmSrc * self)
 
   GST_OBJECT_LOCK (self);
   gstpipe->pipe = sp_client_open (self->socket_path);
+  if (gstpipe->pipe)
+    sp_client_accept_fds (gstpipe->pipe);
+  if (gstpipe->pipe && self->use_ring &&
+      !sp_client_request_ring (gstpipe->pipe))
+    GST_WARNING_OBJECT (self, "Could not ask for a notification ring");
+  self->ring_buffers = 0;
   GST_OBJECT_UNLOCK (self);
 
   if (!gstpipe->pipe) {
@@ -258,6 +322,10 @@ gst_shm_src_start_reading (GstShmSrc * self)
 
   gst_poll_fd_init (&self->pollfd);
   self->pollfd.fd = sp_get_fd (self->pipe->pipe);
+  if (self->ringpollfd.fd >= 0) {
+    gst_poll_remove_fd (self->poll, &self->ringpollfd);
+    gst_poll_fd_init (&self->ringpollfd);
+  }
   gst_poll_add_fd (self->poll, &self->pollfd);
   gst_poll_fd_ctl_read (self->poll, &self->pollfd, TRUE);
 
@@ -311,7 +379,12 @@ free_buffer (gpointer data)
   GST_LOG ("Freeing buffer %p", gsb->buf);
 
   GST_OBJECT_LOCK (gsb->pipe->src);
-  sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
+  if (gsb->fdbuf.fd >= 0)
+    sp_client_fd_recv_finish (gsb->pipe->pipe, &gsb->fdbuf, gsb->from_ring);
+  else if (gsb->from_ring)
+    sp_client_ring_recv_finish (gsb->pipe->pipe, gsb->buf);
+  else
+    sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
   GST_OBJECT_UNLOCK (gsb->pipe->src);
 
   gst_shm_pipe_dec (gsb->pipe);
@@ -326,6 +399,8 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   GstShmPipe *pipe;
   gchar *buf = NULL;
   int rv = 0;
+  gboolean from_ring = FALSE;
+  ShmFdBuffer fdbuf = { 0, -1 };
   struct GstShmBuffer *gsb;
 
   GST_DEBUG_OBJECT (self, "Stopping %p", self);
@@ -341,7 +416,32 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   GST_OBJECT_UNLOCK (self);
 
   do {
-    if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
+    GstClockTime timeout = GST_CLOCK_TIME_NONE;
+
+    if (self->ringpollfd.fd >= 0) {
+      buf = NULL;
+      GST_OBJECT_LOCK (self);
+      rv = sp_client_ring_recv (pipe->pipe, &buf, &fdbuf);
+      /* Don't sleep if the ring is not empty, the next buffer may be in an
+       * area that is still to be read from the socket */
+      if (rv == 0 && !buf && fdbuf.fd < 0 &&
+          !sp_client_ring_prepare_wait (pipe->pipe))
+        timeout = 0;
+      if (rv == 0 && (buf || fdbuf.fd >= 0))
+        self->ring_buffers++;
+      GST_OBJECT_UNLOCK (self);
+      if (rv < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+            ("Error reading from the notification ring: %d", rv));
+        goto error;
+      }
+      if (buf || fdbuf.fd >= 0) {
+        from_ring = TRUE;
+        break;
+      }
+    }
+
+    if (gst_poll_wait (self->poll, timeout) < 0) {
       if (errno == EBUSY)
         goto flushing;
       GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
@@ -368,24 +468,56 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
       buf = NULL;
       GST_LOG_OBJECT (self, "Reading from pipe");
       GST_OBJECT_LOCK (self);
-      rv = sp_client_recv (pipe->pipe, &buf);
+      rv = sp_client_recv_fd (pipe->pipe, &buf, &fdbuf);
       GST_OBJECT_UNLOCK (self);
       if (rv < 0) {
         GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
             ("Error reading control data: %d", rv));
         goto error;
       }
-    }
-  } while (buf == NULL);
 
-  GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
+      if (self->ringpollfd.fd < 0 && sp_client_get_ring_fd (pipe->pipe) >= 0) {
+        GST_DEBUG_OBJECT (self, "Using the notification ring");
+        self->ringpollfd.fd = sp_client_get_ring_fd (pipe->pipe);
+        gst_poll_add_fd (self->poll, &self->ringpollfd);
+        gst_poll_fd_ctl_read (self->poll, &self->ringpollfd, TRUE);
+      }
+    }
+  } while (buf == NULL && fdbuf.fd < 0);
 
   gsb = g_slice_new0 (struct GstShmBuffer);
   gsb->buf = buf;
   gsb->pipe = pipe;
+  gsb->from_ring = from_ring;
+  gsb->fdbuf = fdbuf;
+
+  if (fdbuf.fd >= 0) {
+    GstMemory *mem;
+
+    GST_LOG_OBJECT (self, "Got fd %d (id %u) buffer at offset %lu of size %d",
+        fdbuf.fd, fdbuf.id, fdbuf.offset, rv);
+
+    /* The fd stays owned by the pipe, it is closed once the sink is done
+     * with it and no buffer uses it anymore */
+    if (fdbuf.is_dmabuf)
+      mem = gst_dmabuf_allocator_alloc_with_flags (self->dmabuf_allocator,
+          fdbuf.fd, fdbuf.fd_size, GST_FD_MEMORY_FLAG_DONT_CLOSE);
+    else
+      mem = gst_fd_allocator_alloc (self->fd_allocator, fdbuf.fd,
+          fdbuf.fd_size, GST_FD_MEMORY_FLAG_DONT_CLOSE);
+    gst_memory_resize (mem, fdbuf.offset, rv);
+    GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+        g_quark_from_static_string ("GstShmSrcBuffer"), gsb, free_buffer);
+
+    *outbuf = gst_buffer_new ();
+    gst_buffer_append_memory (*outbuf, mem);
+  } else {
+    GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
 
-  *outbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      buf, rv, 0, rv, gsb, free_buffer);
+    *outbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        buf, rv, 0, rv, gsb, free_buffer);
+  }
 
   return GST_FLOW_OK;
 
@@ -472,6 +604,10 @@ gst_shm_pipe_dec (GstShmPipe * pipe)
 
   gst_poll_remove_fd (pipe->src->poll, &pipe->src->pollfd);
   gst_poll_fd_init (&pipe->src->pollfd);
+  if (pipe->src->ringpollfd.fd >= 0) {
+    gst_poll_remove_fd (pipe->src->poll, &pipe->src->ringpollfd);
+    gst_poll_fd_init (&pipe->src->ringpollfd);
+  }
 
   GST_OBJECT_UNLOCK (pipe->src);
 
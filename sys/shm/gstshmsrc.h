@@ -52,7 +52,14 @@ struct _GstShmSrc
   GstShmPipe *pipe;
   GstPoll *poll;
   GstPollFD pollfd;
+  GstPollFD ringpollfd;
 
+  gboolean use_ring;
+  /* Protected by the object lock */
+  guint64 ring_buffers;
+
+  GstAllocator *fd_allocator;
+  GstAllocator *dmabuf_allocator;
 
   GstFlowReturn flow_return;
   gboolean unlocked;
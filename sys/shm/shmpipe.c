@@ -47,6 +47,10 @@
 #include <sys/mman.h>
 #include <assert.h>
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
 #include "shmalloc.h"
 
 /*
@@ -67,9 +71,50 @@
  * type 4: ack buffer
  * offset
  *
- * Type 4 goes from the client to the server
+ * type 5: ring setup
+ * Number of slots of the ring
+ *
+ * type 6: accept fds
+ * No payload
+ *
+ * type 7: new fd (the fd is passed with SCM_RIGHTS)
+ * Size of the memory behind the fd
+ * fd id
+ * flags
+ *
+ * type 8: close fd
+ * fd id
+ *
+ * type 9: fd buffer
+ * offset
+ * bufsize
+ * fd id
+ *
+ * Types 4 and 6 go from the client to the server
+ * Type 5 is sent by the client to ask for a notification ring and the
+ * server replies with the same type
  * The rest are from the server to the client
  * The client should never write in the SHM
+ *
+ * A buffer in a passed fd is acked with type 4 with an area id of 0, area
+ * ids start at 1. The flags of the first new shm area tell if the server
+ * can pass fds, the client then sends type 6 if it can use them. Each fd
+ * is only passed once per client, until the server closes it.
+ */
+
+/*
+ * Notification ring
+ *
+ * Instead of one command per buffer and one per ack over the socket, a
+ * client can ask for a ring of descriptors in a separate shared memory
+ * area. The server replies with the number of slots (0 if it refused)
+ * and passes the ring area and two eventfds with SCM_RIGHTS. The server
+ * only signals the first eventfd if the client went to sleep on an empty
+ * ring, and the client only signals the second one when the server waits
+ * for buffers to be released or a quarter of the ring is waiting to be
+ * acked. New areas are still announced over the socket, but closing them
+ * goes through the ring so that it stays ordered with the buffers, and
+ * waits on the server side while the ring is full.
  */
 
 
@@ -80,10 +125,91 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_RING_SETUP = 5,
+  COMMAND_ACCEPT_FDS = 6,
+  COMMAND_NEW_FD = 7,
+  COMMAND_CLOSE_FD = 8,
+  COMMAND_FD_BUFFER = 9
+};
+
+/* Flags of the new shm area sent when a client connects */
+#define SERVER_FLAG_FD_PASSING (1 << 0)
+
+/* Flags of a new fd */
+#define FD_FLAG_DMABUF (1 << 0)
+
+#define RING_CACHELINE 64
+#define MAX_FDS_PER_COMMAND 3
+
+/* Each index lives in its own cache line as it is written by only one of
+ * the two sides */
+typedef struct
+{
+  uint32_t value;
+  char padding[RING_CACHELINE - sizeof (uint32_t)];
+} ShmRingIndex;
+
+typedef struct
+{
+  ShmRingIndex size;
+  ShmRingIndex desc_head;       /* written by the server */
+  ShmRingIndex desc_tail;       /* written by the client */
+  ShmRingIndex ack_head;        /* written by the client */
+  ShmRingIndex ack_tail;        /* written by the server */
+  ShmRingIndex client_waiting;
+  ShmRingIndex server_waiting;
+} ShmRingHeader;
+
+enum
+{
+  RING_DESC_BUFFER = 1,
+  RING_DESC_CLOSE_SHM_AREA = 2,
+  RING_DESC_FD_BUFFER = 3
+};
+
+typedef struct
+{
+  uint32_t type;
+  int32_t area_id;              /* the fd id for RING_DESC_FD_BUFFER */
+  uint64_t offset;
+  uint64_t size;
+} ShmRingDesc;
+
+typedef struct
+{
+  int32_t area_id;              /* 0 for a buffer in a passed fd */
+  uint32_t fd_id;
+  uint64_t offset;
+} ShmRingAck;
+
+typedef struct _ShmRing ShmRing;
+
+struct _ShmRing
+{
+  ShmRingHeader *header;
+  ShmRingDesc *descs;
+  ShmRingAck *acks;
+  size_t map_size;
+  uint32_t mask;
+
+  int notify_fd;
+  int ack_fd;
+
+  /* Buffers sent through the ring and not acked yet, server only */
+  unsigned int outstanding;
+  /* Areas to close once the ring has room again, server only */
+  int *pending_closes;
+  unsigned int n_pending_closes;
 };
 
+#define RING_LOAD(index) __atomic_load_n (&(index).value, __ATOMIC_ACQUIRE)
+#define RING_STORE(index, v) \
+  __atomic_store_n (&(index).value, (v), __ATOMIC_RELEASE)
+#define RING_FENCE() __atomic_thread_fence (__ATOMIC_SEQ_CST)
+
 typedef struct _ShmArea ShmArea;
+typedef struct _ShmFd ShmFd;
 
 struct _ShmArea
 {
@@ -108,7 +234,9 @@ struct _ShmBuffer
 {
   int use_count;
 
+  /* NULL for a buffer in a passed fd */
   ShmArea *shm_area;
+  unsigned int fd_id;
   unsigned long offset;
   size_t size;
 
@@ -141,15 +269,43 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  /* Slots of the rings offered to the clients, 0 to refuse them */
+  unsigned int ring_size;
+  int fd_passing;
+  /* Client only */
+  ShmRing *ring;
+  ShmFd *fds;
+  int accept_fds;
+  int fds_requested;
 };
 
 struct _ShmClient
 {
   int fd;
+  ShmRing *ring;
+
+  /* The fds already passed to this client */
+  int accepts_fds;
+  unsigned int *fd_ids;
+  int n_fd_ids;
 
   ShmClient *next;
 };
 
+/* A fd passed by the server, on the client side */
+struct _ShmFd
+{
+  unsigned int id;
+  int fd;
+  size_t size;
+  int is_dmabuf;
+
+  int use_count;
+
+  ShmFd *next;
+};
+
 struct _ShmBlock
 {
   ShmPipe *pipe;
@@ -168,6 +324,7 @@ struct CommandBuffer
     {
       size_t size;
       unsigned int path_size;
+      unsigned int flags;
       /* Followed by path */
     } new_shm_area;
     struct
@@ -178,7 +335,28 @@ struct CommandBuffer
     struct
     {
       unsigned long offset;
+      unsigned int fd_id;
     } ack_buffer;
+    struct
+    {
+      unsigned int size;
+    } ring_setup;
+    struct
+    {
+      size_t size;
+      unsigned int fd_id;
+      unsigned int flags;
+    } new_fd;
+    struct
+    {
+      unsigned int fd_id;
+    } close_fd;
+    struct
+    {
+      unsigned long offset;
+      unsigned int size;
+      unsigned int fd_id;
+    } fd_buffer;
   } payload;
 };
 
@@ -187,6 +365,8 @@ static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf, ShmClient * client, void **tag);
 static void sp_shm_area_dec (ShmPipe * self, ShmArea * area);
+static void sp_ring_free (ShmRing * ring);
+static int sp_writer_setup_ring (ShmPipe * self, ShmClient * client);
 
 
 
@@ -451,6 +631,19 @@ sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
 void
 sp_client_close (ShmPipe * self)
 {
+  if (self->ring) {
+    sp_ring_free (self->ring);
+    self->ring = NULL;
+  }
+
+  while (self->fds) {
+    ShmFd *shm_fd = self->fds;
+
+    self->fds = shm_fd->next;
+    close (shm_fd->fd);
+    spalloc_free (ShmFd, shm_fd);
+  }
+
   sp_writer_close (self, NULL, NULL);
 }
 
@@ -484,6 +677,219 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+static int
+send_command_with_fds (int fd, struct CommandBuffer *cb,
+    unsigned short int type, int area_id, const int *fds, int n_fds)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE (sizeof (int) * MAX_FDS_PER_COMMAND)];
+
+  assert (n_fds > 0 && n_fds <= MAX_FDS_PER_COMMAND);
+
+  cb->type = type;
+  cb->area_id = area_id;
+
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  memset (control, 0, sizeof (control));
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE (sizeof (int) * n_fds);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int) * n_fds);
+  memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * n_fds);
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+
+static void
+ring_signal (int fd)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  eventfd_write (fd, 1);
+#endif
+}
+
+static void
+ring_clear (int fd)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  eventfd_t value;
+
+  /* the eventfds are non-blocking, nothing to do if it was not signalled */
+  eventfd_read (fd, &value);
+#endif
+}
+
+static size_t
+ring_map_size (unsigned int size)
+{
+  return sizeof (ShmRingHeader) + size * sizeof (ShmRingDesc) +
+      size * sizeof (ShmRingAck);
+}
+
+static ShmRing *
+sp_ring_map (int shm_fd, unsigned int size)
+{
+  ShmRing *ring;
+  char *data;
+  size_t map_size = ring_map_size (size);
+
+  data = mmap (NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  ring = spalloc_new (ShmRing);
+  memset (ring, 0, sizeof (ShmRing));
+  ring->header = (ShmRingHeader *) data;
+  ring->descs = (ShmRingDesc *) (data + sizeof (ShmRingHeader));
+  ring->acks = (ShmRingAck *) (ring->descs + size);
+  ring->map_size = map_size;
+  ring->mask = size - 1;
+  ring->notify_fd = -1;
+  ring->ack_fd = -1;
+
+  return ring;
+}
+
+/* Creates the ring of a client on the server side, @shm_fd is the area
+ * to pass to the client and must be closed once sent */
+static ShmRing *
+sp_ring_new (unsigned int size, mode_t perms, int *shm_fd)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  ShmRing *ring = NULL;
+  char tmppath[32];
+  int i = 0;
+  int fd;
+
+  /* The ring is private to the client, it's only reachable through the
+   * fd we pass so there is no need to keep a name */
+  do {
+    snprintf (tmppath, sizeof (tmppath), "/shmpipe-ring.%5d.%5d", getpid (),
+        i++);
+    fd = shm_open (tmppath, O_RDWR | O_CREAT | O_EXCL, perms);
+  } while (fd < 0 && errno == EEXIST);
+
+  if (fd < 0)
+    return NULL;
+  shm_unlink (tmppath);
+
+  if (ftruncate (fd, ring_map_size (size)) < 0)
+    goto error;
+
+  ring = sp_ring_map (fd, size);
+  if (!ring)
+    goto error;
+
+  ring->header->size.value = size;
+  ring->notify_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  ring->ack_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (ring->notify_fd < 0 || ring->ack_fd < 0)
+    goto error;
+
+  *shm_fd = fd;
+  return ring;
+
+error:
+  if (ring)
+    sp_ring_free (ring);
+  close (fd);
+#endif
+  return NULL;
+}
+
+static void
+sp_ring_free (ShmRing * ring)
+{
+  munmap (ring->header, ring->map_size);
+  if (ring->notify_fd >= 0)
+    close (ring->notify_fd);
+  if (ring->ack_fd >= 0)
+    close (ring->ack_fd);
+  free (ring->pending_closes);
+  spalloc_free (ShmRing, ring);
+}
+
+/* Returns 0 if the ring is full */
+static int
+sp_ring_push (ShmRing * ring, uint32_t type, int area_id,
+    unsigned long offset, unsigned long size)
+{
+  ShmRingHeader *header = ring->header;
+  uint32_t head = header->desc_head.value;
+  ShmRingDesc *desc;
+
+  if (head - RING_LOAD (header->desc_tail) > ring->mask)
+    return 0;
+
+  desc = &ring->descs[head & ring->mask];
+  desc->type = type;
+  desc->area_id = area_id;
+  desc->offset = offset;
+  desc->size = size;
+  RING_STORE (header->desc_head, head + 1);
+
+  /* Pairs with the fence in sp_client_ring_prepare_wait(), either the
+   * client sees the new descriptor or we see that it is sleeping */
+  RING_FENCE ();
+  if (RING_LOAD (header->client_waiting)) {
+    RING_STORE (header->client_waiting, 0);
+    ring_signal (ring->notify_fd);
+  }
+
+  return 1;
+}
+
+/* Pushes the area closes that did not fit in the ring before, returns 0
+ * if some are still waiting for room */
+static int
+sp_ring_push_pending_closes (ShmRing * ring)
+{
+  unsigned int i;
+
+  for (i = 0; i < ring->n_pending_closes; i++) {
+    if (!sp_ring_push (ring, RING_DESC_CLOSE_SHM_AREA,
+            ring->pending_closes[i], 0, 0))
+      break;
+  }
+
+  ring->n_pending_closes -= i;
+  memmove (ring->pending_closes, ring->pending_closes + i,
+      sizeof (int) * ring->n_pending_closes);
+
+  return ring->n_pending_closes == 0;
+}
+
+/* The close of an area has to stay behind the buffers of that area still
+ * in the ring, so if the ring is full it waits there until it has room */
+static int
+sp_ring_push_close (ShmRing * ring, int area_id)
+{
+  int *pending_closes;
+
+  pending_closes = realloc (ring->pending_closes, sizeof (int) *
+      (ring->n_pending_closes + 1));
+  if (!pending_closes)
+    return 0;
+  ring->pending_closes = pending_closes;
+  ring->pending_closes[ring->n_pending_closes++] = area_id;
+
+  sp_ring_push_pending_closes (ring);
+
+  return 1;
+}
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -510,9 +916,15 @@ sp_writer_resize (ShmPipe * self, size_t size)
   for (client = self->clients; client; client = client->next) {
     struct CommandBuffer cb = { 0 };
 
-    if (!send_command (client->fd, &cb, COMMAND_CLOSE_SHM_AREA,
-            old_current->id))
+    /* Ring clients may still have buffers of the old area in their ring,
+     * so close it behind them */
+    if (client->ring) {
+      if (!sp_ring_push_close (client->ring, old_current->id))
+        continue;
+    } else if (!send_command (client->fd, &cb, COMMAND_CLOSE_SHM_AREA,
+            old_current->id)) {
       continue;
+    }
 
     cb.payload.new_shm_area.size = newarea->shm_area_len;
     cb.payload.new_shm_area.path_size = pathlen;
@@ -613,11 +1025,23 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   sb->tag = tag;
 
   for (client = self->clients; client; client = client->next) {
-    struct CommandBuffer cb = { 0 };
-    cb.payload.buffer.offset = offset;
-    cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
-      continue;
+    if (client->ring) {
+      /* A client that does not read its ring fast enough misses buffers
+       * instead of blocking the server */
+      if (!sp_ring_push_pending_closes (client->ring) ||
+          client->ring->outstanding > client->ring->mask ||
+          !sp_ring_push (client->ring, RING_DESC_BUFFER, area->id, offset,
+              bsize))
+        continue;
+      client->ring->outstanding++;
+    } else {
+      struct CommandBuffer cb = { 0 };
+      cb.payload.buffer.offset = offset;
+      cb.payload.buffer.size = bsize;
+      if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER,
+              self->shm_area->id))
+        continue;
+    }
     sb->clients[i++] = client->fd;
     c++;
   }
@@ -638,12 +1062,194 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   return c;
 }
 
+void
+sp_writer_set_fd_passing (ShmPipe * self, int enabled)
+{
+  self->fd_passing = enabled;
+}
+
+/* Returns 1 if there are clients and they all accept buffers in passed
+ * fds */
+int
+sp_writer_clients_accept_fds (ShmPipe * self)
+{
+  ShmClient *client;
+
+  if (!self->clients)
+    return 0;
+
+  for (client = self->clients; client; client = client->next) {
+    if (!client->accepts_fds)
+      return 0;
+  }
+
+  return 1;
+}
+
+static int
+sp_writer_client_has_fd (ShmClient * client, unsigned int fd_id)
+{
+  int i;
+
+  for (i = 0; i < client->n_fd_ids; i++) {
+    if (client->fd_ids[i] == fd_id)
+      return 1;
+  }
+
+  return 0;
+}
+
+static int
+sp_writer_pass_fd (ShmClient * client, int fd, unsigned int fd_id,
+    size_t fd_size, int is_dmabuf)
+{
+  struct CommandBuffer cb = { 0 };
+  unsigned int *fd_ids;
+
+  fd_ids = realloc (client->fd_ids, sizeof (unsigned int) *
+      (client->n_fd_ids + 1));
+  if (!fd_ids)
+    return 0;
+  client->fd_ids = fd_ids;
+
+  cb.payload.new_fd.size = fd_size;
+  cb.payload.new_fd.fd_id = fd_id;
+  cb.payload.new_fd.flags = is_dmabuf ? FD_FLAG_DMABUF : 0;
+  if (!send_command_with_fds (client->fd, &cb, COMMAND_NEW_FD, 0, &fd, 1))
+    return 0;
+
+  client->fd_ids[client->n_fd_ids++] = fd_id;
+
+  return 1;
+}
+
+/* Sends a buffer of @size bytes at @offset in the memory behind @fd to the
+ * clients, the fd is only passed to the clients that don't have it yet.
+ * @fd_id identifies the memory until sp_writer_forget_fd() is called.
+ * Returns the number of client this has successfully been sent to */
+int
+sp_writer_send_fd_buf (ShmPipe * self, int fd, unsigned int fd_id,
+    size_t fd_size, int is_dmabuf, unsigned long offset, size_t size,
+    void *tag)
+{
+  ShmBuffer *sb;
+  ShmClient *client = NULL;
+  int i = 0;
+  int c = 0;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  assert (fd_id != 0);
+
+  sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
+  memset (sb, 0, sizeof (ShmBuffer));
+  memset (sb->clients, -1, sizeof (int) * self->num_clients);
+  sb->fd_id = fd_id;
+  sb->offset = offset;
+  sb->size = size;
+  sb->num_clients = self->num_clients;
+  sb->tag = tag;
+
+  for (client = self->clients; client; client = client->next) {
+    if (!client->accepts_fds)
+      continue;
+
+    if (!sp_writer_client_has_fd (client, fd_id) &&
+        !sp_writer_pass_fd (client, fd, fd_id, fd_size, is_dmabuf))
+      continue;
+
+    if (client->ring) {
+      if (!sp_ring_push_pending_closes (client->ring) ||
+          client->ring->outstanding > client->ring->mask ||
+          !sp_ring_push (client->ring, RING_DESC_FD_BUFFER, fd_id, offset,
+              size))
+        continue;
+      client->ring->outstanding++;
+    } else {
+      struct CommandBuffer cb = { 0 };
+      cb.payload.fd_buffer.offset = offset;
+      cb.payload.fd_buffer.size = size;
+      cb.payload.fd_buffer.fd_id = fd_id;
+      if (!send_command (client->fd, &cb, COMMAND_FD_BUFFER, 0))
+        continue;
+    }
+    sb->clients[i++] = client->fd;
+    c++;
+  }
+
+  if (c == 0) {
+    spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * sb->num_clients, sb);
+    return 0;
+  }
+
+  sb->use_count = c;
+
+  sb->next = self->buffers;
+  self->buffers = sb;
+
+  return c;
+}
+
+/* Tells the clients to close their copy of the fd identified by @fd_id,
+ * all the buffers in it must have been released */
+void
+sp_writer_forget_fd (ShmPipe * self, unsigned int fd_id)
+{
+  ShmClient *client;
+
+  for (client = self->clients; client; client = client->next) {
+    int i;
+
+    for (i = 0; i < client->n_fd_ids; i++) {
+      if (client->fd_ids[i] == fd_id) {
+        struct CommandBuffer cb = { 0 };
+
+        client->fd_ids[i] = client->fd_ids[--client->n_fd_ids];
+        cb.payload.close_fd.fd_id = fd_id;
+        send_command (client->fd, &cb, COMMAND_CLOSE_FD, 0);
+        break;
+      }
+    }
+  }
+}
+
+/* @fds receives up to MAX_FDS_PER_COMMAND descriptors passed along with
+ * the command, they are dropped by the kernel if it is NULL */
 static int
-recv_command (int fd, struct CommandBuffer *cb)
+recv_command (int fd, struct CommandBuffer *cb, int *fds, int *n_fds)
 {
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE (sizeof (int) * MAX_FDS_PER_COMMAND)];
   int retval;
 
-  retval = recv (fd, cb, sizeof (struct CommandBuffer), MSG_DONTWAIT);
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  if (fds) {
+    *n_fds = 0;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+  }
+
+  retval = recvmsg (fd, &msg, MSG_DONTWAIT);
+
+  if (fds) {
+    for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        int n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+
+        assert (n <= MAX_FDS_PER_COMMAND);
+        memcpy (fds, CMSG_DATA (cmsg), sizeof (int) * n);
+        *n_fds = n;
+      }
+    }
+  }
+
   if (retval == sizeof (struct CommandBuffer)) {
     return 1;
   } else {
@@ -651,17 +1257,111 @@ recv_command (int fd, struct CommandBuffer *cb)
   }
 }
 
+static void
+close_fds (int *fds, int n_fds)
+{
+  int i;
+
+  for (i = 0; i < n_fds; i++)
+    close (fds[i]);
+}
+
+static ShmFd *
+sp_client_find_fd (ShmPipe * self, unsigned int fd_id)
+{
+  ShmFd *shm_fd;
+
+  for (shm_fd = self->fds; shm_fd; shm_fd = shm_fd->next) {
+    if (shm_fd->id == fd_id)
+      return shm_fd;
+  }
+
+  return NULL;
+}
+
+static void
+sp_client_fd_dec (ShmPipe * self, ShmFd * shm_fd)
+{
+  ShmFd *item, *prev_item = NULL;
+
+  assert (shm_fd->use_count > 0);
+  shm_fd->use_count--;
+
+  if (shm_fd->use_count > 0)
+    return;
+
+  for (item = self->fds; item; item = item->next) {
+    if (item == shm_fd) {
+      if (prev_item)
+        prev_item->next = item->next;
+      else
+        self->fds = item->next;
+      break;
+    }
+    prev_item = item;
+  }
+  assert (item);
+
+  close (shm_fd->fd);
+  spalloc_free (ShmFd, shm_fd);
+}
+
+static long int
+sp_client_fd_buffer (ShmFd * shm_fd, unsigned long offset, size_t size,
+    ShmFdBuffer * fdbuf)
+{
+  if (!fdbuf)
+    return -8;
+
+  if (offset + size > shm_fd->size)
+    return -9;
+
+  shm_fd->use_count++;
+  fdbuf->id = shm_fd->id;
+  fdbuf->fd = shm_fd->fd;
+  fdbuf->fd_size = shm_fd->size;
+  fdbuf->is_dmabuf = shm_fd->is_dmabuf;
+  fdbuf->offset = offset;
+
+  return size;
+}
+
+void
+sp_client_accept_fds (ShmPipe * self)
+{
+  self->accept_fds = 1;
+}
+
 long int
 sp_client_recv (ShmPipe * self, char **buf)
+{
+  return sp_client_recv_fd (self, buf, NULL);
+}
+
+/* Like sp_client_recv(), but the buffer can also be in a fd passed by
+ * the server, then @buf is left untouched and @fdbuf is filled */
+long int
+sp_client_recv_fd (ShmPipe * self, char **buf, ShmFdBuffer * fdbuf)
 {
   char *area_name = NULL;
   ShmArea *newarea;
   ShmArea *area;
+  ShmFd *shm_fd;
   struct CommandBuffer cb;
+  int fds[MAX_FDS_PER_COMMAND];
+  int n_fds = 0;
   int retval;
 
-  if (!recv_command (self->main_socket, &cb))
+  if (!recv_command (self->main_socket, &cb, fds, &n_fds)) {
+    close_fds (fds, n_fds);
     return -1;
+  }
+
+  if (cb.type != COMMAND_RING_SETUP && cb.type != COMMAND_NEW_FD &&
+      n_fds > 0) {
+    close_fds (fds, n_fds);
+    return -5;
+  }
 
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
@@ -686,6 +1386,15 @@ sp_client_recv (ShmPipe * self, char **buf)
 
       newarea->next = self->shm_area;
       self->shm_area = newarea;
+
+      if ((cb.payload.new_shm_area.flags & SERVER_FLAG_FD_PASSING) &&
+          self->accept_fds && !self->fds_requested) {
+        struct CommandBuffer reply = { 0 };
+
+        if (!send_command (self->main_socket, &reply, COMMAND_ACCEPT_FDS, 0))
+          return -10;
+        self->fds_requested = 1;
+      }
       break;
 
     case COMMAND_CLOSE_SHM_AREA:
@@ -708,6 +1417,62 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_RING_SETUP:
+      /* The server refused, keep using the socket */
+      if (cb.payload.ring_setup.size == 0) {
+        close_fds (fds, n_fds);
+        break;
+      }
+
+      if (n_fds != 3 || self->ring ||
+          (cb.payload.ring_setup.size & (cb.payload.ring_setup.size - 1))) {
+        close_fds (fds, n_fds);
+        return -6;
+      }
+
+      self->ring = sp_ring_map (fds[0], cb.payload.ring_setup.size);
+      close (fds[0]);
+      if (!self->ring ||
+          self->ring->header->size.value != cb.payload.ring_setup.size) {
+        close_fds (fds + 1, 2);
+        if (self->ring)
+          sp_ring_free (self->ring);
+        self->ring = NULL;
+        return -7;
+      }
+      self->ring->notify_fd = fds[1];
+      self->ring->ack_fd = fds[2];
+      break;
+
+    case COMMAND_NEW_FD:
+      if (n_fds != 1 || sp_client_find_fd (self, cb.payload.new_fd.fd_id)) {
+        close_fds (fds, n_fds);
+        return -11;
+      }
+
+      shm_fd = spalloc_new (ShmFd);
+      shm_fd->id = cb.payload.new_fd.fd_id;
+      shm_fd->fd = fds[0];
+      shm_fd->size = cb.payload.new_fd.size;
+      shm_fd->is_dmabuf = !!(cb.payload.new_fd.flags & FD_FLAG_DMABUF);
+      shm_fd->use_count = 1;
+      shm_fd->next = self->fds;
+      self->fds = shm_fd;
+      break;
+
+    case COMMAND_CLOSE_FD:
+      shm_fd = sp_client_find_fd (self, cb.payload.close_fd.fd_id);
+      if (shm_fd)
+        sp_client_fd_dec (self, shm_fd);
+      break;
+
+    case COMMAND_FD_BUFFER:
+      shm_fd = sp_client_find_fd (self, cb.payload.fd_buffer.fd_id);
+      if (!shm_fd)
+        return -12;
+      return sp_client_fd_buffer (shm_fd, cb.payload.fd_buffer.offset,
+          cb.payload.fd_buffer.size, fdbuf);
+
     default:
       return -99;
   }
@@ -715,27 +1480,53 @@ sp_client_recv (ShmPipe * self, char **buf)
   return 0;
 }
 
+/* An area id of 0 means a buffer in the passed fd @fd_id */
+static ShmBuffer *
+sp_writer_find_buffer (ShmPipe * self, int area_id, unsigned int fd_id,
+    unsigned long offset, ShmBuffer ** prev_buf)
+{
+  ShmBuffer *buf;
+
+  *prev_buf = NULL;
+  for (buf = self->buffers; buf; buf = buf->next) {
+    if (buf->offset == offset && (buf->shm_area ?
+            buf->shm_area->id == area_id : area_id == 0 &&
+            buf->fd_id == fd_id))
+      return buf;
+    *prev_buf = buf;
+  }
+
+  return NULL;
+}
+
 int
 sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
 {
   ShmBuffer *buf = NULL, *prev_buf = NULL;
   struct CommandBuffer cb;
 
-  if (!recv_command (client->fd, &cb))
+  if (!recv_command (client->fd, &cb, NULL, NULL))
     return -1;
 
   switch (cb.type) {
     case COMMAND_ACK_BUFFER:
-
-      for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
-            buf->offset == cb.payload.ack_buffer.offset) {
-          return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
-        }
-        prev_buf = buf;
-      }
+      buf = sp_writer_find_buffer (self, cb.area_id,
+          cb.payload.ack_buffer.fd_id, cb.payload.ack_buffer.offset,
+          &prev_buf);
+      if (buf)
+        return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
 
       return -2;
+
+    case COMMAND_ACCEPT_FDS:
+      client->accepts_fds = self->fd_passing;
+      return 1;
+
+    case COMMAND_RING_SETUP:
+      if (sp_writer_setup_ring (self, client) < 0)
+        return -3;
+      return 1;
+
     default:
       return -99;
   }
@@ -743,6 +1534,154 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
   return 0;
 }
 
+static int
+sp_writer_setup_ring (ShmPipe * self, ShmClient * client)
+{
+  struct CommandBuffer cb = { 0 };
+  ShmRing *ring;
+  int fds[3];
+  int ret;
+
+  if (client->ring)
+    return 0;
+
+  if (self->ring_size == 0 ||
+      !(ring = sp_ring_new (self->ring_size, self->perms, &fds[0]))) {
+    /* Tell the client to keep using the socket */
+    return send_command (client->fd, &cb, COMMAND_RING_SETUP, 0) ? 0 : -1;
+  }
+
+  fds[1] = ring->notify_fd;
+  fds[2] = ring->ack_fd;
+  cb.payload.ring_setup.size = self->ring_size;
+  ret = send_command_with_fds (client->fd, &cb, COMMAND_RING_SETUP, 0, fds,
+      3);
+  close (fds[0]);
+
+  if (!ret) {
+    sp_ring_free (ring);
+    return -1;
+  }
+
+  client->ring = ring;
+  return 0;
+}
+
+void
+sp_writer_set_ring_size (ShmPipe * self, unsigned int size)
+{
+  unsigned int n = 1;
+
+  if (size == 0) {
+    self->ring_size = 0;
+    return;
+  }
+
+  while (n < size && n < (1U << 16))
+    n <<= 1;
+  self->ring_size = n;
+}
+
+int
+sp_writer_get_client_ring_fd (ShmClient * client)
+{
+  if (client->ring)
+    return client->ring->ack_fd;
+
+  return -1;
+}
+
+static int
+sp_writer_ring_release (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  ShmRing *ring = client->ring;
+  uint32_t tail = ring->header->ack_tail.value;
+  uint32_t head = RING_LOAD (ring->header->ack_head);
+  int ret = 0;
+
+  if (head - tail > ring->mask + 1)
+    return -1;
+
+  for (; tail != head; tail++) {
+    ShmRingAck *ack = &ring->acks[tail & ring->mask];
+    ShmBuffer *buf, *prev_buf = NULL;
+
+    buf = sp_writer_find_buffer (self, ack->area_id, ack->fd_id, ack->offset,
+        &prev_buf);
+    if (buf) {
+      void *tag = NULL;
+
+      if (sp_shmbuf_dec (self, buf, prev_buf, client, &tag) == 0 && callback)
+        callback (tag, user_data);
+    }
+
+    if (!buf || ring->outstanding == 0) {
+      ret = -2;
+      break;
+    }
+    ring->outstanding--;
+  }
+
+  RING_STORE (ring->header->ack_tail, tail);
+
+  /* The client read its ring before acking, so there may be room for the
+   * closes now */
+  sp_ring_push_pending_closes (ring);
+
+  return ret;
+}
+
+/* Called when the ring fd of a client is readable, releases the buffers
+ * it acked */
+int
+sp_writer_ring_recv (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  if (!client->ring)
+    return 0;
+
+  ring_clear (client->ring->ack_fd);
+
+  return sp_writer_ring_release (self, client, callback, user_data);
+}
+
+/* Releases the buffers acked by all the ring clients, whether they
+ * signalled it or not */
+void
+sp_writer_ring_release_acked (ShmPipe * self,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  ShmClient *client;
+
+  for (client = self->clients; client; client = client->next) {
+    if (client->ring)
+      sp_writer_ring_release (self, client, callback, user_data);
+  }
+}
+
+/* Asks the ring clients to signal their next ack right away, and wakes
+ * up the poll loop itself for the ones that already have pending acks */
+void
+sp_writer_ring_want_acks (ShmPipe * self)
+{
+  ShmClient *client;
+
+  for (client = self->clients; client; client = client->next) {
+    ShmRingHeader *header;
+
+    if (!client->ring)
+      continue;
+
+    header = client->ring->header;
+    RING_STORE (header->server_waiting, 1);
+    /* Pairs with the fence in sp_client_ring_recv_finish() */
+    RING_FENCE ();
+    if (RING_LOAD (header->ack_head) != header->ack_tail.value)
+      ring_signal (client->ring->ack_fd);
+  }
+}
+
 int
 sp_client_recv_finish (ShmPipe * self, char *buf)
 {
@@ -767,6 +1706,210 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
       self->shm_area->id);
 }
 
+int
+sp_client_request_ring (ShmPipe * self)
+{
+  struct CommandBuffer cb = { 0 };
+
+  return send_command (self->main_socket, &cb, COMMAND_RING_SETUP, 0);
+}
+
+int
+sp_client_get_ring_fd (ShmPipe * self)
+{
+  if (self->ring)
+    return self->ring->notify_fd;
+
+  return -1;
+}
+
+/* Same as sp_client_recv_fd(), buffers in passed fds are only accepted if
+ * @fdbuf is not NULL */
+long int
+sp_client_ring_recv (ShmPipe * self, char **buf, ShmFdBuffer * fdbuf)
+{
+  ShmRing *ring = self->ring;
+  ShmRingHeader *header;
+  uint32_t tail, head;
+
+  if (!ring)
+    return 0;
+
+  header = ring->header;
+  tail = header->desc_tail.value;
+  head = RING_LOAD (header->desc_head);
+
+  if (head - tail > ring->mask + 1)
+    return -1;
+
+  for (; tail != head; tail++) {
+    /* The slot belongs to the server again as soon as the tail moves past
+     * it, so work on a copy */
+    ShmRingDesc desc = ring->descs[tail & ring->mask];
+    ShmArea *area;
+    ShmFd *shm_fd;
+    long int ret;
+
+    for (area = self->shm_area; area; area = area->next) {
+      if (area->id == desc.area_id)
+        break;
+    }
+
+    switch (desc.type) {
+      case RING_DESC_FD_BUFFER:
+        /* Same as for areas, the fd is passed on the socket first */
+        shm_fd = sp_client_find_fd (self, desc.area_id);
+        if (!shm_fd)
+          return 0;
+
+        ret = sp_client_fd_buffer (shm_fd, desc.offset, desc.size, fdbuf);
+        if (ret >= 0)
+          RING_STORE (header->desc_tail, tail + 1);
+        return ret;
+
+      case RING_DESC_CLOSE_SHM_AREA:
+        if (area)
+          sp_shm_area_dec (self, area);
+        break;
+
+      case RING_DESC_BUFFER:
+        /* The area is announced on the socket before the server puts its
+         * buffers in the ring, read the socket first */
+        if (!area)
+          return 0;
+
+        if (desc.offset + desc.size > area->shm_area_len)
+          return -2;
+
+        *buf = area->shm_area_buf + desc.offset;
+        sp_shm_area_inc (area);
+        RING_STORE (header->desc_tail, tail + 1);
+        return desc.size;
+
+      default:
+        return -99;
+    }
+
+    RING_STORE (header->desc_tail, tail + 1);
+  }
+
+  return 0;
+}
+
+/* Returns 1 if the caller can sleep until the ring fd becomes readable
+ * and 0 if there is something in the ring */
+int
+sp_client_ring_prepare_wait (ShmPipe * self)
+{
+  ShmRingHeader *header;
+
+  if (!self->ring)
+    return 1;
+
+  header = self->ring->header;
+  ring_clear (self->ring->notify_fd);
+
+  RING_STORE (header->client_waiting, 1);
+  /* Pairs with the fence in sp_ring_push() */
+  RING_FENCE ();
+  if (RING_LOAD (header->desc_head) != header->desc_tail.value) {
+    RING_STORE (header->client_waiting, 0);
+    return 0;
+  }
+
+  return 1;
+}
+
+/* Publishes the ack written in the slot @head */
+static void
+sp_client_ring_push_ack (ShmRing * ring, uint32_t head)
+{
+  ShmRingHeader *header = ring->header;
+  uint32_t pending;
+
+  RING_STORE (header->ack_head, head + 1);
+
+  /* Acks are batched unless the server is waiting for them */
+  RING_FENCE ();
+  pending = head + 1 - RING_LOAD (header->ack_tail);
+  if (RING_LOAD (header->server_waiting)) {
+    RING_STORE (header->server_waiting, 0);
+    ring_signal (ring->ack_fd);
+  } else if (pending >= (ring->mask + 1) / 4) {
+    ring_signal (ring->ack_fd);
+  }
+}
+
+int
+sp_client_ring_recv_finish (ShmPipe * self, char *buf)
+{
+  ShmRing *ring = self->ring;
+  ShmRingHeader *header = ring->header;
+  ShmArea *shm_area = NULL;
+  ShmRingAck *ack;
+  uint32_t head = header->ack_head.value;
+
+  for (shm_area = self->shm_area; shm_area; shm_area = shm_area->next) {
+    if (buf >= shm_area->shm_area_buf &&
+        buf < shm_area->shm_area_buf + shm_area->shm_area_len)
+      break;
+  }
+
+  assert (shm_area);
+
+  /* The server never has more buffers in flight than the ring has slots */
+  if (head - RING_LOAD (header->ack_tail) > ring->mask) {
+    sp_shm_area_dec (self, shm_area);
+    return 0;
+  }
+
+  ack = &ring->acks[head & ring->mask];
+  ack->area_id = shm_area->id;
+  ack->fd_id = 0;
+  ack->offset = buf - shm_area->shm_area_buf;
+  sp_client_ring_push_ack (ring, head);
+
+  sp_shm_area_dec (self, shm_area);
+
+  return 1;
+}
+
+int
+sp_client_fd_recv_finish (ShmPipe * self, ShmFdBuffer * fdbuf, int from_ring)
+{
+  ShmFd *shm_fd = sp_client_find_fd (self, fdbuf->id);
+  int ret;
+
+  assert (shm_fd);
+
+  if (from_ring) {
+    ShmRing *ring = self->ring;
+    ShmRingHeader *header = ring->header;
+    uint32_t head = header->ack_head.value;
+    ShmRingAck *ack;
+
+    ret = 0;
+    if (head - RING_LOAD (header->ack_tail) <= ring->mask) {
+      ack = &ring->acks[head & ring->mask];
+      ack->area_id = 0;
+      ack->fd_id = fdbuf->id;
+      ack->offset = fdbuf->offset;
+      sp_client_ring_push_ack (ring, head);
+      ret = 1;
+    }
+  } else {
+    struct CommandBuffer cb = { 0 };
+
+    cb.payload.ack_buffer.offset = fdbuf->offset;
+    cb.payload.ack_buffer.fd_id = fdbuf->id;
+    ret = send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER, 0);
+  }
+
+  sp_client_fd_dec (self, shm_fd);
+
+  return ret;
+}
+
 ShmPipe *
 sp_client_open (const char *path)
 {
@@ -822,6 +1965,8 @@ sp_writer_accept_client (ShmPipe * self)
 
   cb.payload.new_shm_area.size = self->shm_area->shm_area_len;
   cb.payload.new_shm_area.path_size = pathlen;
+  if (self->fd_passing)
+    cb.payload.new_shm_area.flags = SERVER_FLAG_FD_PASSING;
   if (!send_command (fd, &cb, COMMAND_NEW_SHM_AREA, self->shm_area->id)) {
     fprintf (stderr, "Sending new shm area failed: %s", strerror (errno));
     goto error;
@@ -834,6 +1979,7 @@ sp_writer_accept_client (ShmPipe * self)
   }
 
   client = spalloc_new (ShmClient);
+  memset (client, 0, sizeof (ShmClient));
   client->fd = fd;
 
   /* Prepend ot linked list */
@@ -881,8 +2027,10 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
 
     if (tag)
       *tag = buf->tag;
-    shm_alloc_space_block_dec (buf->ablock);
-    sp_shm_area_dec (self, buf->shm_area);
+    if (buf->shm_area) {
+      shm_alloc_space_block_dec (buf->ablock);
+      sp_shm_area_dec (self, buf->shm_area);
+    }
     spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
     return 0;
   }
@@ -931,6 +2079,10 @@ again:
 
   self->num_clients--;
 
+  if (client->ring)
+    sp_ring_free (client->ring);
+  free (client->fd_ids);
+
   spalloc_free (ShmClient, client);
 }
 
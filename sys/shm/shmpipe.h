@@ -56,6 +56,27 @@
  * buffers are no longer valid. If was valid buffer was received, the
  * client must release it with sp_client_recv_finish() when it is done
  * reading from it.
+ *
+ * The writer can offer a notification ring to its clients with
+ * sp_writer_set_ring_size(). A client asks for it with
+ * sp_client_request_ring(), once sp_client_get_ring_fd() returns a valid
+ * fd, it must also read buffers with sp_client_ring_recv() and call
+ * sp_client_ring_prepare_wait() before select()ing on that fd. Buffers
+ * received from the ring are released with sp_client_ring_recv_finish().
+ * On the writer side, sp_writer_get_client_ring_fd() returns the fd to
+ * select() on for the acks of a client, sp_writer_ring_recv() is called
+ * when it is readable, and sp_writer_ring_want_acks() before waiting for
+ * buffers to be released, as the clients batch their acks otherwise.
+ *
+ * A writer that enabled sp_writer_set_fd_passing() can also send buffers
+ * that live in other memory, such as memfds or dmabufs, with
+ * sp_writer_send_fd_buf() once sp_writer_clients_accept_fds() says all
+ * the clients can use them. The fd is only passed once per client, and
+ * sp_writer_forget_fd() must be called when the memory goes away. Clients
+ * that call sp_client_accept_fds() before reading from the socket and
+ * then read with sp_client_recv_fd() get the fd and offset of such
+ * buffers in a ShmFdBuffer, and release them with
+ * sp_client_fd_recv_finish().
  */
 
 
@@ -80,6 +101,17 @@ typedef struct _ShmBuffer ShmBuffer;
 
 typedef void (*sp_buffer_free_callback) (void * tag, void * user_data);
 
+/* A buffer in a fd passed by the writer, the fd stays owned by the
+ * ShmPipe until the buffer is released */
+typedef struct
+{
+  unsigned int id;
+  int fd;
+  size_t fd_size;
+  int is_dmabuf;
+  unsigned long offset;
+} ShmFdBuffer;
+
 ShmPipe *sp_writer_create (const char *path, size_t size, mode_t perms);
 const char *sp_writer_get_path (ShmPipe *pipe);
 void sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
@@ -106,6 +138,21 @@ void sp_writer_close_client (ShmPipe *self, ShmClient * client,
     sp_buffer_free_callback callback, void * user_data);
 int sp_writer_recv (ShmPipe * self, ShmClient * client, void ** tag);
 
+void sp_writer_set_ring_size (ShmPipe * self, unsigned int size);
+int sp_writer_get_client_ring_fd (ShmClient * client);
+int sp_writer_ring_recv (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void * user_data);
+void sp_writer_ring_release_acked (ShmPipe * self,
+    sp_buffer_free_callback callback, void * user_data);
+void sp_writer_ring_want_acks (ShmPipe * self);
+
+void sp_writer_set_fd_passing (ShmPipe * self, int enabled);
+int sp_writer_clients_accept_fds (ShmPipe * self);
+int sp_writer_send_fd_buf (ShmPipe * self, int fd, unsigned int fd_id,
+    size_t fd_size, int is_dmabuf, unsigned long offset, size_t size,
+    void * tag);
+void sp_writer_forget_fd (ShmPipe * self, unsigned int fd_id);
+
 int sp_writer_pending_writes (ShmPipe * self);
 
 ShmBuffer *sp_writer_get_pending_buffers (ShmPipe * self);
@@ -114,7 +161,17 @@ void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
+long int sp_client_recv_fd (ShmPipe * self, char **buf, ShmFdBuffer * fdbuf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
+int sp_client_request_ring (ShmPipe * self);
+int sp_client_get_ring_fd (ShmPipe * self);
+long int sp_client_ring_recv (ShmPipe * self, char **buf,
+    ShmFdBuffer * fdbuf);
+int sp_client_ring_prepare_wait (ShmPipe * self);
+int sp_client_ring_recv_finish (ShmPipe * self, char *buf);
+void sp_client_accept_fds (ShmPipe * self);
+int sp_client_fd_recv_finish (ShmPipe * self, ShmFdBuffer * fdbuf,
+    int from_ring);
 void sp_client_close (ShmPipe * self);
 
 #ifdef __cplusplus
@@ -0,0 +1,557 @@
+/* Offline network simulator for elements based upon GstAdaptiveDemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The simulator serves the resources of a test case through GstTestHTTPSrc,
+ * delaying responses and throttling transfers according to a network trace.
+ * The trace is played back on a GstTestClock installed as the system clock,
+ * which is also what demuxers measure download rates with. Once every
+ * thread inside the simulated network is blocked on the clock, the clock
+ * jumps to the next pending wait, so a run takes little real time and its
+ * results don't depend on the load of the machine.
+ *
+ * Playback is modelled by a player that starts as soon as the first media
+ * fragment has been received and then consumes media in real time, stalling
+ * whenever it runs out of received fragments. Media fragments are assumed to
+ * belong to a single adaptive stream.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include "adaptive_demux_sim.h"
+
+/* how often a transfer stalled by a zero bandwidth step checks the trace */
+#define SIM_STALL_POLL_INTERVAL (10 * GST_MSECOND)
+/* real time interval at which the simulation checks whether the simulated
+ * time can be advanced */
+#define SIM_CLOCK_DRIVE_INTERVAL_MS 1
+
+typedef struct _GstAdaptiveDemuxSim
+{
+  const GstAdaptiveDemuxSimConfig *config;
+  GstAdaptiveDemuxSimResults *results;
+  GstStructure *algorithm;
+  GstClock *clock;
+  guint clock_drive_id;
+
+  /* protects everything below */
+  GMutex lock;
+  GRand *rand;
+  GstClockTime start_time;
+  /* threads inside the http src callbacks that are not waiting for the
+   * clock, and the clock ids of the ones that are */
+  guint n_busy;
+  GList *waits;
+
+  /* representation selection */
+  guint last_bitrate;
+  gdouble weighted_bitrate;
+  GstClockTime selected_duration;
+
+  /* playback model */
+  gboolean playing;
+  GstClockTime received_duration;
+  /* run time at which the media time play_ref_media was played */
+  GstClockTime play_ref_time;
+  GstClockTime play_ref_media;
+
+  guint n_streams;
+  guint n_eos;
+} GstAdaptiveDemuxSim;
+
+/* must be called with the lock */
+static GstClockTime
+gst_adaptive_demux_sim_get_run_time (GstAdaptiveDemuxSim * sim)
+{
+  return gst_clock_get_time (sim->clock) - sim->start_time;
+}
+
+/* Marks the calling thread as working inside the simulated network, the
+ * simulated time does not move on until it waits or leaves */
+static void
+gst_adaptive_demux_sim_enter (GstAdaptiveDemuxSim * sim)
+{
+  g_mutex_lock (&sim->lock);
+  sim->n_busy++;
+  g_mutex_unlock (&sim->lock);
+}
+
+static void
+gst_adaptive_demux_sim_leave (GstAdaptiveDemuxSim * sim)
+{
+  g_mutex_lock (&sim->lock);
+  sim->n_busy--;
+  g_mutex_unlock (&sim->lock);
+}
+
+/* Blocks for @delay of simulated time, must be called between
+ * gst_adaptive_demux_sim_enter() and gst_adaptive_demux_sim_leave() */
+static void
+gst_adaptive_demux_sim_wait (GstAdaptiveDemuxSim * sim, GstClockTime delay)
+{
+  GstClockID id;
+
+  g_mutex_lock (&sim->lock);
+  id = gst_clock_new_single_shot_id (sim->clock,
+      gst_clock_get_time (sim->clock) + delay);
+  sim->waits = g_list_prepend (sim->waits, id);
+  sim->n_busy--;
+  g_mutex_unlock (&sim->lock);
+
+  gst_clock_id_wait (id, NULL);
+
+  g_mutex_lock (&sim->lock);
+  sim->waits = g_list_remove (sim->waits, id);
+  sim->n_busy++;
+  g_mutex_unlock (&sim->lock);
+
+  gst_clock_id_unref (id);
+}
+
+/* Advances the simulated time to the earliest pending wait and releases it,
+ * but only once no thread is working inside the simulated network and all
+ * the ones waiting in it are blocked on the clock */
+static gboolean
+gst_adaptive_demux_sim_drive_clock (GstAdaptiveDemuxSim * sim)
+{
+  GstTestClock *clock = GST_TEST_CLOCK (sim->clock);
+  GList *pending = NULL, *l;
+  gboolean blocked = TRUE;
+  GstClockID id;
+
+  g_mutex_lock (&sim->lock);
+  if (sim->n_busy > 0) {
+    g_mutex_unlock (&sim->lock);
+    return G_SOURCE_CONTINUE;
+  }
+
+  /* The waiting threads registered their ids, make sure they are blocked
+   * on them. The pending ids may include the ones of the demuxer */
+  if (sim->waits) {
+    gst_test_clock_wait_for_multiple_pending_ids (clock,
+        g_list_length (sim->waits), &pending);
+    for (l = sim->waits; l && blocked; l = l->next)
+      blocked = g_list_find (pending, l->data) != NULL;
+    g_list_free_full (pending, (GDestroyNotify) gst_clock_id_unref);
+  }
+  g_mutex_unlock (&sim->lock);
+
+  if (blocked && gst_test_clock_peek_next_pending_id (clock, &id)) {
+    GstClockTime time = gst_clock_id_get_time (id);
+
+    if (time > gst_clock_get_time (sim->clock))
+      gst_test_clock_set_time (clock, time);
+    gst_clock_id_unref (id);
+
+    id = gst_test_clock_process_next_clock_id (clock);
+    if (id)
+      gst_clock_id_unref (id);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Returns the trace step in effect at @now, or NULL if the network is not
+ * limited at all. @step_end is set to the start of the next step */
+static const GstAdaptiveDemuxSimTraceStep *
+gst_adaptive_demux_sim_get_step (GstAdaptiveDemuxSim * sim, GstClockTime now,
+    GstClockTime * step_end)
+{
+  const GstAdaptiveDemuxSimConfig *config = sim->config;
+  guint i;
+
+  *step_end = GST_CLOCK_TIME_NONE;
+  if (config->n_trace_steps == 0)
+    return NULL;
+
+  for (i = 1; i < config->n_trace_steps; i++) {
+    if (config->trace[i].start > now) {
+      *step_end = config->trace[i].start;
+      break;
+    }
+  }
+
+  return &config->trace[i - 1];
+}
+
+static const GstAdaptiveDemuxSimResource *
+gst_adaptive_demux_sim_find_resource (GstAdaptiveDemuxSim * sim,
+    const gchar * uri)
+{
+  const GstAdaptiveDemuxSimResource *resource;
+
+  for (resource = sim->config->resources; resource->uri; resource++) {
+    if (g_strcmp0 (resource->uri, uri) == 0)
+      return resource;
+  }
+
+  return NULL;
+}
+
+/* Sleeps for as long as transferring @length bytes takes with the bandwidth
+ * of the trace, which might change during the transfer */
+static void
+gst_adaptive_demux_sim_throttle (GstAdaptiveDemuxSim * sim, guint length)
+{
+  guint64 bits = (guint64) length * 8;
+
+  while (bits > 0) {
+    const GstAdaptiveDemuxSimTraceStep *step;
+    GstClockTime now, step_end, delay;
+    guint64 sent_bits = bits;
+
+    g_mutex_lock (&sim->lock);
+    now = gst_adaptive_demux_sim_get_run_time (sim);
+    step = gst_adaptive_demux_sim_get_step (sim, now, &step_end);
+    g_mutex_unlock (&sim->lock);
+
+    if (step == NULL)
+      return;
+
+    if (step->bandwidth == 0) {
+      gst_adaptive_demux_sim_wait (sim, SIM_STALL_POLL_INTERVAL);
+      continue;
+    }
+
+    delay = gst_util_uint64_scale_ceil (bits, GST_SECOND, step->bandwidth);
+    if (GST_CLOCK_TIME_IS_VALID (step_end) && now + delay > step_end) {
+      delay = step_end - now;
+      sent_bits = gst_util_uint64_scale (delay, step->bandwidth, GST_SECOND);
+      sent_bits = CLAMP (sent_bits, 1, bits);
+    }
+
+    gst_adaptive_demux_sim_wait (sim, delay);
+    bits -= sent_bits;
+  }
+}
+
+static void
+gst_adaptive_demux_sim_fragment_requested (GstAdaptiveDemuxSim * sim,
+    const GstAdaptiveDemuxSimResource * resource)
+{
+  GstAdaptiveDemuxSimResults *results = sim->results;
+
+  if (sim->last_bitrate != 0 && sim->last_bitrate != resource->bitrate)
+    results->switch_count++;
+  sim->last_bitrate = resource->bitrate;
+
+  sim->weighted_bitrate += (gdouble) resource->bitrate * resource->duration;
+  sim->selected_duration += resource->duration;
+  results->fragment_count++;
+}
+
+static void
+gst_adaptive_demux_sim_fragment_received (GstAdaptiveDemuxSim * sim,
+    const GstAdaptiveDemuxSimResource * resource)
+{
+  GstAdaptiveDemuxSimResults *results = sim->results;
+  GstClockTime now;
+
+  g_mutex_lock (&sim->lock);
+  now = gst_adaptive_demux_sim_get_run_time (sim);
+
+  if (!sim->playing) {
+    sim->playing = TRUE;
+    results->startup_time = now;
+    sim->play_ref_time = now;
+    sim->play_ref_media = 0;
+  } else {
+    GstClockTime position = sim->play_ref_media + (now - sim->play_ref_time);
+
+    if (position > sim->received_duration) {
+      /* The player ran out of data before this fragment arrived */
+      GstClockTime stall_start = sim->play_ref_time +
+          (sim->received_duration - sim->play_ref_media);
+
+      results->rebuffer_count++;
+      results->rebuffer_time += now - stall_start;
+      sim->play_ref_time = now;
+      sim->play_ref_media = sim->received_duration;
+
+      GST_DEBUG ("rebuffering for %" GST_TIME_FORMAT " at %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (now - stall_start), GST_TIME_ARGS (stall_start));
+    }
+  }
+
+  sim->received_duration += resource->duration;
+  g_mutex_unlock (&sim->lock);
+}
+
+static gboolean
+gst_adaptive_demux_sim_http_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstAdaptiveDemuxSim *sim = (GstAdaptiveDemuxSim *) user_data;
+  const GstAdaptiveDemuxSimResource *resource;
+  const GstAdaptiveDemuxSimTraceStep *step;
+  GstClockTime step_end, delay = 0;
+  gdouble jitter, loss;
+  gboolean failed = FALSE;
+
+  resource = gst_adaptive_demux_sim_find_resource (sim, uri);
+  if (resource == NULL)
+    return FALSE;
+
+  gst_adaptive_demux_sim_enter (sim);
+
+  g_mutex_lock (&sim->lock);
+  step = gst_adaptive_demux_sim_get_step (sim,
+      gst_adaptive_demux_sim_get_run_time (sim), &step_end);
+  /* Always draw the same amount of random numbers per request so that the
+   * sequence doesn't depend on the trace */
+  jitter = g_rand_double (sim->rand);
+  loss = g_rand_double (sim->rand);
+  if (step) {
+    delay = step->latency + jitter * step->jitter;
+    failed = resource->bitrate > 0 && loss < step->loss;
+  }
+
+  if (failed)
+    sim->results->failed_requests++;
+  else if (resource->bitrate > 0)
+    gst_adaptive_demux_sim_fragment_requested (sim, resource);
+  g_mutex_unlock (&sim->lock);
+
+  if (delay > 0)
+    gst_adaptive_demux_sim_wait (sim, delay);
+
+  gst_adaptive_demux_sim_leave (sim);
+
+  if (failed) {
+    GST_DEBUG ("dropping request for %s", uri);
+    input_data->status_code = 503;
+    return FALSE;
+  }
+
+  input_data->context = (gpointer) resource;
+  input_data->size = resource->size;
+  if (resource->payload && resource->size == 0)
+    input_data->size = strlen (resource->payload);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_adaptive_demux_sim_http_src_create (GstTestHTTPSrc * src,
+    guint64 offset, guint length, GstBuffer ** retbuf, gpointer context,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxSim *sim = (GstAdaptiveDemuxSim *) user_data;
+  const GstAdaptiveDemuxSimResource *resource =
+      (const GstAdaptiveDemuxSimResource *) context;
+  GstBuffer *buf;
+
+  gst_adaptive_demux_sim_enter (sim);
+  gst_adaptive_demux_sim_throttle (sim, length);
+  gst_adaptive_demux_sim_leave (sim);
+
+  buf = gst_buffer_new_allocate (NULL, length, NULL);
+  fail_if (buf == NULL, "Not enough memory to allocate buffer");
+
+  if (resource->payload) {
+    gst_buffer_fill (buf, 0, resource->payload + offset, length);
+  } else {
+    GstMapInfo info;
+    guint64 i;
+
+    gst_buffer_map (buf, &info, GST_MAP_WRITE);
+    for (i = 0; i < length; ++i)
+      info.data[i] = (offset + i) & 0xff;
+    gst_buffer_unmap (buf, &info);
+  }
+
+  if (resource->bitrate > 0 && offset + length >= resource->size)
+    gst_adaptive_demux_sim_fragment_received (sim, resource);
+
+  *retbuf = buf;
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_adaptive_demux_sim_set_demux_property (GQuark field_id,
+    const GValue * value, gpointer user_data)
+{
+  GObject *demux = G_OBJECT (user_data);
+  const gchar *name = g_quark_to_string (field_id);
+
+  fail_unless (g_object_class_find_property (G_OBJECT_GET_CLASS (demux),
+          name) != NULL, "demuxer has no property %s", name);
+
+  if (G_VALUE_HOLDS_STRING (value))
+    gst_util_set_object_arg (demux, name, g_value_get_string (value));
+  else
+    g_object_set_property (demux, name, value);
+
+  return TRUE;
+}
+
+static void
+gst_adaptive_demux_sim_pre_test (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxSim *sim = (GstAdaptiveDemuxSim *) user_data;
+
+  if (sim->algorithm)
+    gst_structure_foreach (sim->algorithm,
+        gst_adaptive_demux_sim_set_demux_property, engine->demux);
+
+  g_mutex_lock (&sim->lock);
+  sim->start_time = gst_clock_get_time (sim->clock);
+  g_mutex_unlock (&sim->lock);
+
+  sim->clock_drive_id = g_timeout_add (SIM_CLOCK_DRIVE_INTERVAL_MS,
+      (GSourceFunc) gst_adaptive_demux_sim_drive_clock, sim);
+}
+
+static void
+gst_adaptive_demux_sim_pad_added (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  GstAdaptiveDemuxSim *sim = (GstAdaptiveDemuxSim *) user_data;
+
+  sim->n_streams++;
+}
+
+static void
+gst_adaptive_demux_sim_eos (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  GstAdaptiveDemuxSim *sim = (GstAdaptiveDemuxSim *) user_data;
+
+  sim->n_eos++;
+  if (sim->n_eos == sim->n_streams) {
+    sim->results->completed = TRUE;
+    g_main_loop_quit (engine->loop);
+  }
+}
+
+static void
+gst_adaptive_demux_sim_bus_error (GstAdaptiveDemuxTestEngine * engine,
+    GstMessage * msg, gpointer user_data)
+{
+  GstAdaptiveDemuxSim *sim = (GstAdaptiveDemuxSim *) user_data;
+
+  GST_INFO ("run of %s aborted by error from %s", sim->results->algorithm,
+      GST_OBJECT_NAME (msg->src));
+
+  sim->results->completed = FALSE;
+  g_main_loop_quit (engine->loop);
+}
+
+/*
+ * Run the demuxer over the resources of @config with the network behaving
+ * as described by its trace, and fill @results. The test http src plugin
+ * needs to be registered with gst_adaptive_demux_test_setup().
+ */
+void
+gst_adaptive_demux_sim_run (const GstAdaptiveDemuxSimConfig * config,
+    GstAdaptiveDemuxSimResults * results)
+{
+  GstAdaptiveDemuxSim sim = { 0, };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestCallbacks test_callbacks = { 0 };
+  gchar *results_str;
+
+  fail_unless (config != NULL && config->resources != NULL);
+  fail_unless (results != NULL);
+  fail_if (config->n_trace_steps > 0 &&
+      config->trace[config->n_trace_steps - 1].bandwidth == 0,
+      "the last trace step would stall the run forever");
+
+  memset (results, 0, sizeof (*results));
+  results->startup_time = GST_CLOCK_TIME_NONE;
+
+  sim.config = config;
+  sim.results = results;
+  if (config->algorithm) {
+    sim.algorithm = gst_structure_from_string (config->algorithm, NULL);
+    fail_unless (sim.algorithm != NULL, "invalid algorithm description %s",
+        config->algorithm);
+    results->algorithm = g_strdup (gst_structure_get_name (sim.algorithm));
+  } else {
+    results->algorithm = g_strdup ("default");
+  }
+  g_mutex_init (&sim.lock);
+  sim.rand = g_rand_new_with_seed (config->seed);
+
+  /* picked up by the demuxer and the pipeline */
+  sim.clock = gst_test_clock_new ();
+  gst_system_clock_set_default (sim.clock);
+
+  http_src_callbacks.src_start = gst_adaptive_demux_sim_http_src_start;
+  http_src_callbacks.src_create = gst_adaptive_demux_sim_http_src_create;
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &sim);
+
+  test_callbacks.pre_test = gst_adaptive_demux_sim_pre_test;
+  test_callbacks.demux_pad_added = gst_adaptive_demux_sim_pad_added;
+  test_callbacks.appsink_eos = gst_adaptive_demux_sim_eos;
+  test_callbacks.bus_error_message = gst_adaptive_demux_sim_bus_error;
+
+  gst_adaptive_demux_test_run (config->element_name, config->manifest_uri,
+      &test_callbacks, &sim);
+
+  gst_test_http_src_install_callbacks (NULL, NULL);
+
+  if (sim.clock_drive_id)
+    g_source_remove (sim.clock_drive_id);
+  gst_system_clock_set_default (NULL);
+  gst_object_unref (sim.clock);
+
+  if (sim.selected_duration > 0)
+    results->average_bitrate = sim.weighted_bitrate / sim.selected_duration;
+
+  results_str = gst_adaptive_demux_sim_results_to_string (results);
+  GST_INFO ("%s", results_str);
+  g_free (results_str);
+
+  g_rand_free (sim.rand);
+  g_mutex_clear (&sim.lock);
+  if (sim.algorithm)
+    gst_structure_free (sim.algorithm);
+}
+
+void
+gst_adaptive_demux_sim_results_clear (GstAdaptiveDemuxSimResults * results)
+{
+  g_free (results->algorithm);
+  memset (results, 0, sizeof (*results));
+}
+
+/* Serializes @results as a GstStructure string, one line per run makes it
+ * easy to compare algorithms */
+gchar *
+gst_adaptive_demux_sim_results_to_string (const GstAdaptiveDemuxSimResults *
+    results)
+{
+  GstStructure *s;
+  gchar *str;
+
+  s = gst_structure_new ("adaptive-demux-sim-results",
+      "algorithm", G_TYPE_STRING, results->algorithm,
+      "completed", G_TYPE_BOOLEAN, results->completed,
+      "startup-time", G_TYPE_UINT64, results->startup_time,
+      "rebuffer-count", G_TYPE_UINT, results->rebuffer_count,
+      "rebuffer-time", G_TYPE_UINT64, results->rebuffer_time,
+      "switch-count", G_TYPE_UINT, results->switch_count,
+      "average-bitrate", G_TYPE_UINT64, results->average_bitrate,
+      "fragment-count", G_TYPE_UINT, results->fragment_count,
+      "failed-requests", G_TYPE_UINT, results->failed_requests, NULL);
+  str = gst_structure_to_string (s);
+  gst_structure_free (s);
+
+  return str;
+}
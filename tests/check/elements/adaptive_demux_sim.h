@@ -0,0 +1,108 @@
+/* Offline network simulator for elements based upon GstAdaptiveDemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_ADAPTIVE_DEMUX_SIM_H__
+#define __GST_ADAPTIVE_DEMUX_SIM_H__
+
+#include <gst/gst.h>
+#include "adaptive_demux_engine.h"
+
+G_BEGIN_DECLS
+
+/* One step of a network trace. A step is in effect from its start time until
+ * the start time of the next step, the last step until the end of the run */
+typedef struct _GstAdaptiveDemuxSimTraceStep
+{
+  /* time since the start of the run */
+  GstClockTime start;
+  /* available bandwidth in bits per second, 0 stalls all transfers until
+   * the next step */
+  guint64 bandwidth;
+  /* delay before the response to every request */
+  GstClockTime latency;
+  /* random additional delay, uniformly distributed in [0, jitter] */
+  GstClockTime jitter;
+  /* probability in [0, 1] that a media fragment request fails with a 503,
+   * retries included */
+  gdouble loss;
+} GstAdaptiveDemuxSimTraceStep;
+
+typedef struct _GstAdaptiveDemuxSimResource
+{
+  const gchar *uri;
+  /* content of manifests, or NULL to generate @size bytes of media data */
+  const gchar *payload;
+  guint64 size;
+
+  /* bitrate of the representation a media fragment belongs to and duration
+   * of the fragment. 0 for anything that is not a media fragment */
+  guint bitrate;
+  GstClockTime duration;
+} GstAdaptiveDemuxSimResource;
+
+typedef struct _GstAdaptiveDemuxSimConfig
+{
+  const gchar *element_name;
+  const gchar *manifest_uri;
+
+  /* terminated by an entry with a NULL uri */
+  const GstAdaptiveDemuxSimResource *resources;
+
+  const GstAdaptiveDemuxSimTraceStep *trace;
+  guint n_trace_steps;
+
+  /* name of the algorithm and demuxer properties selecting it, in
+   * GstStructure string syntax, e.g. "conservative, bitrate-limit=(float)0.5" */
+  const gchar *algorithm;
+
+  /* seed for jitter and loss, runs with the same seed and trace are
+   * comparable */
+  guint32 seed;
+} GstAdaptiveDemuxSimConfig;
+
+typedef struct _GstAdaptiveDemuxSimResults
+{
+  gchar *algorithm;
+
+  /* FALSE if the run was aborted by an error */
+  gboolean completed;
+
+  /* time until the first media fragment was completely received */
+  GstClockTime startup_time;
+  /* stalls of a player consuming the received media in real time once it
+   * started, and their accumulated duration */
+  guint rebuffer_count;
+  GstClockTime rebuffer_time;
+
+  guint switch_count;
+  /* duration weighted average of the selected representation bitrates */
+  guint64 average_bitrate;
+
+  guint fragment_count;
+  guint failed_requests;
+} GstAdaptiveDemuxSimResults;
+
+void gst_adaptive_demux_sim_run (const GstAdaptiveDemuxSimConfig * config,
+    GstAdaptiveDemuxSimResults * results);
+
+void gst_adaptive_demux_sim_results_clear (GstAdaptiveDemuxSimResults * results);
+
+gchar * gst_adaptive_demux_sim_results_to_string (const GstAdaptiveDemuxSimResults * results);
+
+G_END_DECLS
+#endif /* __GST_ADAPTIVE_DEMUX_SIM_H__ */
@@ -0,0 +1,217 @@
+/* GStreamer unit tests for the compare element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#define VIDEO_CAPS "video/x-raw,format=I420,width=96,height=64,framerate=30/1"
+
+/* Returns the next result or summary message of the compare element,
+ * skipping the messages of failed matches */
+static GstMessage *
+pop_compare_message (GstBus * bus)
+{
+  GstMessage *msg;
+
+  while ((msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+              GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR))) {
+    fail_if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR);
+    if (!gst_message_has_name (msg, "delta"))
+      return msg;
+    gst_message_unref (msg);
+  }
+
+  fail ("no message from the compare element");
+  return NULL;
+}
+
+GST_START_TEST (test_identical)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+  const GValue *components;
+  gdouble delta, ssim, psnr;
+  guint i;
+
+  pipeline = gst_parse_launch ("videotestsrc num-buffers=1 ! " VIDEO_CAPS
+      " ! compare name=compare method=ssim post-results=true threshold=0.0"
+      " ! fakesink videotestsrc num-buffers=1 ! " VIDEO_CAPS
+      " ! compare.check", NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  msg = pop_compare_message (bus);
+  fail_unless (gst_message_has_name (msg, "GstCompareResult"));
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_get (s, "delta", G_TYPE_DOUBLE, &delta,
+          "ssim", G_TYPE_DOUBLE, &ssim, "psnr", G_TYPE_DOUBLE, &psnr, NULL));
+  fail_unless_equals_float (delta, 1.0);
+  fail_unless_equals_float (ssim, 1.0);
+  fail_unless_equals_float (psnr, 100.0);
+
+  /* one value per plane */
+  components = gst_structure_get_value (s, "ssim-components");
+  fail_unless (components != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (components), 3);
+  for (i = 0; i < 3; i++) {
+    fail_unless_equals_float (g_value_get_double (gst_value_array_get_value
+            (components, i)), 1.0);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads)
+{
+  GstElement *pipeline1, *pipeline4;
+  GstBus *bus1, *bus4;
+  GstMessage *msg1, *msg4;
+  gdouble ssim, psnr, delta;
+  guint i;
+
+  /* same content, compared on 1 and on 4 threads */
+  pipeline1 = gst_parse_launch ("videotestsrc num-buffers=3 pattern=smpte ! "
+      VIDEO_CAPS " ! compare name=compare method=psnr n-threads=1"
+      " post-results=true threshold=0.0 ! fakesink"
+      " videotestsrc num-buffers=3 pattern=smpte75 ! " VIDEO_CAPS
+      " ! compare.check", NULL);
+  pipeline4 = gst_parse_launch ("videotestsrc num-buffers=3 pattern=smpte ! "
+      VIDEO_CAPS " ! compare name=compare method=psnr n-threads=4"
+      " post-results=true threshold=0.0 ! fakesink"
+      " videotestsrc num-buffers=3 pattern=smpte75 ! " VIDEO_CAPS
+      " ! compare.check", NULL);
+  fail_unless (pipeline1 != NULL && pipeline4 != NULL);
+  bus1 = gst_element_get_bus (pipeline1);
+  bus4 = gst_element_get_bus (pipeline4);
+
+  fail_unless (gst_element_set_state (pipeline1, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (pipeline4, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  /* the result does not depend on how the frame is split between threads */
+  for (i = 0; i < 3; i++) {
+    msg1 = pop_compare_message (bus1);
+    msg4 = pop_compare_message (bus4);
+    fail_unless (gst_message_has_name (msg1, "GstCompareResult"));
+    fail_unless (gst_message_has_name (msg4, "GstCompareResult"));
+
+    fail_unless (gst_structure_get (gst_message_get_structure (msg1),
+            "delta", G_TYPE_DOUBLE, &delta, "ssim", G_TYPE_DOUBLE, &ssim,
+            "psnr", G_TYPE_DOUBLE, &psnr, NULL));
+    fail_unless (ssim < 1.0);
+    fail_unless (psnr < 100.0);
+    fail_unless_equals_float (delta, psnr);
+    fail_unless (gst_structure_is_equal (gst_message_get_structure (msg1),
+            gst_message_get_structure (msg4)));
+
+    gst_message_unref (msg1);
+    gst_message_unref (msg4);
+  }
+
+  gst_element_set_state (pipeline1, GST_STATE_NULL);
+  gst_element_set_state (pipeline4, GST_STATE_NULL);
+  gst_object_unref (bus1);
+  gst_object_unref (bus4);
+  gst_object_unref (pipeline1);
+  gst_object_unref (pipeline4);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_summary)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+  guint64 frames = 0, failed = 0;
+  gdouble psnr[2], psnr_min, psnr_average, delta_max;
+  guint i;
+
+  pipeline = gst_parse_launch ("videotestsrc num-buffers=2 pattern=smpte ! "
+      VIDEO_CAPS " ! compare name=compare method=psnr n-threads=2"
+      " post-results=true threshold=30.0 ! fakesink"
+      " videotestsrc num-buffers=2 pattern=ball ! " VIDEO_CAPS
+      " ! compare.check", NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 2; i++) {
+    msg = pop_compare_message (bus);
+    fail_unless (gst_message_has_name (msg, "GstCompareResult"));
+    fail_unless (gst_structure_get_double (gst_message_get_structure (msg),
+            "psnr", &psnr[i]));
+    fail_unless (psnr[i] < 30.0);
+    gst_message_unref (msg);
+  }
+
+  /* posted once both pads are EOS */
+  msg = pop_compare_message (bus);
+  fail_unless (gst_message_has_name (msg, "GstCompareSummary"));
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_get (s, "frames", G_TYPE_UINT64, &frames,
+          "failed", G_TYPE_UINT64, &failed,
+          "psnr-min", G_TYPE_DOUBLE, &psnr_min,
+          "psnr-average", G_TYPE_DOUBLE, &psnr_average,
+          "delta-max", G_TYPE_DOUBLE, &delta_max, NULL));
+  fail_unless_equals_int (frames, 2);
+  fail_unless_equals_int (failed, 2);
+  fail_unless_equals_float (psnr_min, MIN (psnr[0], psnr[1]));
+  fail_unless_equals_float (psnr_average, (psnr[0] + psnr[1]) / 2);
+  fail_unless_equals_float (delta_max, MAX (psnr[0], psnr[1]));
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+compare_suite (void)
+{
+  Suite *s = suite_create ("compare");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_identical);
+  tcase_add_test (tc_chain, test_threads);
+  tcase_add_test (tc_chain, test_summary);
+
+  return s;
+}
+
+GST_CHECK_MAIN (compare);
@@ -0,0 +1,278 @@
+/* GStreamer unit test for MPEG-DASH adaptive bitrate selection under
+ * simulated network conditions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include "adaptive_demux_common.h"
+#include "adaptive_demux_sim.h"
+
+#define DEMUX_ELEMENT_NAME "dashdemux"
+
+#define SIM_MANIFEST_URI "http://unit.test/test.mpd"
+#define SIM_FRAGMENT_COUNT 8
+#define SIM_FRAGMENT_DURATION (500 * GST_MSECOND)
+
+static const guint sim_bitrates[] = { 250000, 500000, 1000000 };
+
+static const gchar *sim_mpd =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<MPD xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+    "     xmlns=\"urn:mpeg:DASH:schema:MPD:2011\""
+    "     xsi:schemaLocation=\"urn:mpeg:DASH:schema:MPD:2011 DASH-MPD.xsd\""
+    "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+    "     type=\"static\""
+    "     minBufferTime=\"PT1S\""
+    "     mediaPresentationDuration=\"PT4S\">"
+    "  <Period>"
+    "    <AdaptationSet mimeType=\"video/webm\""
+    "                   segmentAlignment=\"true\">"
+    "      <SegmentTemplate media=\"video$RepresentationID$_$Number$.webm\""
+    "                       timescale=\"1000\""
+    "                       duration=\"500\""
+    "                       startNumber=\"1\" />"
+    "      <Representation id=\"0\" codecs=\"vp9\" width=\"320\""
+    "                      height=\"180\" bandwidth=\"250000\" />"
+    "      <Representation id=\"1\" codecs=\"vp9\" width=\"640\""
+    "                      height=\"360\" bandwidth=\"500000\" />"
+    "      <Representation id=\"2\" codecs=\"vp9\" width=\"1280\""
+    "                      height=\"720\" bandwidth=\"1000000\" />"
+    "    </AdaptationSet>"
+    "  </Period>"
+    "</MPD>";
+
+/* The manifest and all fragments of all representations */
+static GArray *
+sim_create_resources (void)
+{
+  GArray *resources;
+  GstAdaptiveDemuxSimResource resource = { 0, };
+  guint i, j;
+
+  resources = g_array_new (TRUE, TRUE, sizeof (GstAdaptiveDemuxSimResource));
+
+  resource.uri = g_strdup (SIM_MANIFEST_URI);
+  resource.payload = sim_mpd;
+  g_array_append_val (resources, resource);
+
+  for (i = 0; i < G_N_ELEMENTS (sim_bitrates); i++) {
+    for (j = 1; j <= SIM_FRAGMENT_COUNT; j++) {
+      resource.uri = g_strdup_printf ("http://unit.test/video%u_%u.webm", i, j);
+      resource.payload = NULL;
+      resource.bitrate = sim_bitrates[i];
+      resource.duration = SIM_FRAGMENT_DURATION;
+      resource.size = gst_util_uint64_scale (sim_bitrates[i],
+          SIM_FRAGMENT_DURATION, 8 * GST_SECOND);
+      g_array_append_val (resources, resource);
+    }
+  }
+
+  return resources;
+}
+
+static void
+sim_free_resources (GArray * resources)
+{
+  guint i;
+
+  for (i = 0; i < resources->len; i++)
+    g_free ((gchar *) g_array_index (resources, GstAdaptiveDemuxSimResource,
+            i).uri);
+  g_array_free (resources, TRUE);
+}
+
+static void
+sim_run (const GstAdaptiveDemuxSimTraceStep * trace, guint n_trace_steps,
+    const gchar * algorithm, GstAdaptiveDemuxSimResults * results)
+{
+  GstAdaptiveDemuxSimConfig config = { 0, };
+  GArray *resources = sim_create_resources ();
+
+  config.element_name = DEMUX_ELEMENT_NAME;
+  config.manifest_uri = SIM_MANIFEST_URI;
+  config.resources = (const GstAdaptiveDemuxSimResource *) resources->data;
+  config.trace = trace;
+  config.n_trace_steps = n_trace_steps;
+  config.algorithm = algorithm;
+  config.seed = 42;
+
+  gst_adaptive_demux_sim_run (&config, results);
+
+  sim_free_resources (resources);
+}
+
+/******************** Test specific code starts here **************************/
+
+/*
+ * Test that a run over a fast network receives all fragments and reports
+ * consistent numbers
+ */
+GST_START_TEST (testSimConstantBandwidth)
+{
+  const GstAdaptiveDemuxSimTraceStep trace[] = {
+    {0, 8000000, 5 * GST_MSECOND, 0, 0.0},
+  };
+  GstAdaptiveDemuxSimResults results;
+
+  sim_run (trace, G_N_ELEMENTS (trace), NULL, &results);
+
+  fail_unless (results.completed);
+  fail_unless_equals_string (results.algorithm, "default");
+  fail_unless_equals_int (results.fragment_count, SIM_FRAGMENT_COUNT);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (results.startup_time));
+  fail_unless (results.average_bitrate >= sim_bitrates[0]);
+  fail_unless (results.average_bitrate <= sim_bitrates[2]);
+  fail_unless (results.switch_count < SIM_FRAGMENT_COUNT);
+  fail_unless_equals_int (results.failed_requests, 0);
+
+  gst_adaptive_demux_sim_results_clear (&results);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that the demuxer properties of the algorithm are applied: capping the
+ * bitrate below the second representation must select the first one only
+ */
+GST_START_TEST (testSimAlgorithmProperties)
+{
+  const GstAdaptiveDemuxSimTraceStep trace[] = {
+    {0, 8000000, 0, 0, 0.0},
+  };
+  GstAdaptiveDemuxSimResults results;
+
+  sim_run (trace, G_N_ELEMENTS (trace), "capped, max-bitrate=(uint)300000",
+      &results);
+
+  fail_unless (results.completed);
+  fail_unless_equals_string (results.algorithm, "capped");
+  fail_unless_equals_int (results.fragment_count, SIM_FRAGMENT_COUNT);
+  fail_unless_equals_int (results.switch_count, 0);
+  fail_unless_equals_uint64 (results.average_bitrate, sim_bitrates[0]);
+
+  gst_adaptive_demux_sim_results_clear (&results);
+}
+
+GST_END_TEST;
+
+/*
+ * Test a bandwidth drop below the lowest bitrate followed by a recovery,
+ * comparing the default selection with a conservative one
+ */
+GST_START_TEST (testSimBandwidthStep)
+{
+  const GstAdaptiveDemuxSimTraceStep trace[] = {
+    {0, 4000000, 10 * GST_MSECOND, 0, 0.0},
+    {1 * GST_SECOND, 200000, 50 * GST_MSECOND, 20 * GST_MSECOND, 0.0},
+    {2500 * GST_MSECOND, 4000000, 10 * GST_MSECOND, 0, 0.0},
+  };
+  const gchar *algorithms[] = {
+    NULL,
+    "conservative, bitrate-limit=(float)0.3",
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (algorithms); i++) {
+    GstAdaptiveDemuxSimResults results;
+    gchar *str;
+
+    sim_run (trace, G_N_ELEMENTS (trace), algorithms[i], &results);
+
+    str = gst_adaptive_demux_sim_results_to_string (&results);
+    GST_INFO ("bandwidth step: %s", str);
+    g_free (str);
+
+    fail_unless (results.completed);
+    fail_unless_equals_int (results.fragment_count, SIM_FRAGMENT_COUNT);
+    /* the slow step is below the lowest bitrate for 1.5s, playback can't
+     * stall for longer than that and the download of one fragment */
+    fail_unless (results.rebuffer_time <=
+        1500 * GST_MSECOND + SIM_FRAGMENT_DURATION);
+
+    gst_adaptive_demux_sim_results_clear (&results);
+  }
+}
+
+GST_END_TEST;
+
+/*
+ * Test that lost requests are counted and retried. The demuxer tries each
+ * fragment several times before giving up, but takes the loss of the last
+ * one for the end of the stream, so that one may be missing
+ */
+GST_START_TEST (testSimLoss)
+{
+  const GstAdaptiveDemuxSimTraceStep trace[] = {
+    {0, 8000000, 5 * GST_MSECOND, 5 * GST_MSECOND, 0.4},
+  };
+  GstAdaptiveDemuxSimResults results;
+
+  sim_run (trace, G_N_ELEMENTS (trace), NULL, &results);
+
+  fail_unless (results.completed);
+  fail_unless (results.fragment_count >= SIM_FRAGMENT_COUNT - 1);
+  fail_unless (results.fragment_count <= SIM_FRAGMENT_COUNT);
+  fail_unless (results.failed_requests > 0);
+
+  gst_adaptive_demux_sim_results_clear (&results);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that a run in which all fragment requests are lost makes the demuxer
+ * give up, and that this is reported
+ */
+GST_START_TEST (testSimOutage)
+{
+  const GstAdaptiveDemuxSimTraceStep trace[] = {
+    {0, 8000000, 5 * GST_MSECOND, 0, 1.0},
+  };
+  GstAdaptiveDemuxSimResults results;
+
+  sim_run (trace, G_N_ELEMENTS (trace), NULL, &results);
+
+  fail_if (results.completed);
+  fail_unless_equals_int (results.fragment_count, 0);
+  fail_unless (results.failed_requests > 0);
+
+  gst_adaptive_demux_sim_results_clear (&results);
+}
+
+GST_END_TEST;
+
+static Suite *
+dash_demux_sim_suite (void)
+{
+  Suite *s = suite_create ("dash_demux_sim");
+  TCase *tc_sim = tcase_create ("simulation");
+
+  tcase_add_test (tc_sim, testSimConstantBandwidth);
+  tcase_add_test (tc_sim, testSimAlgorithmProperties);
+  tcase_add_test (tc_sim, testSimBandwidthStep);
+  tcase_add_test (tc_sim, testSimLoss);
+  tcase_add_test (tc_sim, testSimOutage);
+
+  tcase_add_unchecked_fixture (tc_sim, gst_adaptive_demux_test_setup,
+      gst_adaptive_demux_test_teardown);
+
+  suite_add_tcase (s, tc_sim);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dash_demux_sim);
@@ -871,6 +871,49 @@ GST_START_TEST (dash_mpdparser_period_segmentTemplate)
 
 GST_END_TEST;
 
+/*
+ * Test parsing and writing the low latency SegmentTemplate attributes
+ *
+ */
+GST_START_TEST (dash_mpdparser_period_segmentTemplate_availabilityTime)
+{
+  GstMPDPeriodNode *periodNode;
+  GstMPDSegmentTemplateNode *segmentTemplate;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\">"
+      "  <Period>"
+      "    <SegmentTemplate media=\"TestMedia\""
+      "                     duration=\"2\""
+      "                     availabilityTimeOffset=\"1.5\""
+      "                     availabilityTimeComplete=\"false\">"
+      "    </SegmentTemplate></Period></MPD>";
+
+  gboolean ret;
+  gchar *new_xml;
+  gint new_xml_size;
+  GstMPDClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_client_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  periodNode = (GstMPDPeriodNode *) mpdclient->mpd_root_node->Periods->data;
+  segmentTemplate = periodNode->SegmentTemplate;
+  assert_equals_float (segmentTemplate->availabilityTimeOffset, 1.5);
+  assert_equals_int (segmentTemplate->availabilityTimeComplete, FALSE);
+
+  ret = gst_mpd_client_get_xml_content (mpdclient, &new_xml, &new_xml_size);
+  assert_equals_int (ret, TRUE);
+  fail_unless (strstr (new_xml, "availabilityTimeComplete=\"false\"") != NULL);
+  fail_unless (strstr (new_xml, "availabilityTimeOffset=") != NULL);
+
+  g_free (new_xml);
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing Period SegmentTemplate attributes where a
  * presentationTimeOffset attribute has been specified
@@ -3163,6 +3206,128 @@ GST_START_TEST (dash_mpdparser_bitstreamSwitching_inheritance)
 
 GST_END_TEST;
 
+/*
+ * Test that a manifest update shares unchanged Periods and AdaptationSets
+ * with the previous manifest
+ */
+GST_START_TEST (dash_mpdparser_update_reuse)
+{
+  GstMPDPeriodNode *old_period0, *old_period1, *new_period0, *new_period1;
+  GstMPDAdaptationSetNode *old_adapt_set, *new_adapt_set;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     minimumUpdatePeriod=\"PT2S\">"
+      "  <Period id=\"P0\" start=\"PT0S\">"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <Representation id=\"v1\" bandwidth=\"250000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "  </Period>"
+      "  <Period id=\"P1\" start=\"PT10S\">"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <Representation id=\"v1\" bandwidth=\"250000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "    <AdaptationSet id=\"2\" mimeType=\"audio/mp4\">"
+      "      <Representation id=\"a1\" bandwidth=\"64000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "  </Period></MPD>";
+  const gchar *xml_update =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     minimumUpdatePeriod=\"PT2S\">"
+      "  <Period id=\"P0\" start=\"PT0S\">"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <Representation id=\"v1\" bandwidth=\"250000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "  </Period>"
+      "  <Period id=\"P1\" start=\"PT10S\" duration=\"PT20S\">"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <Representation id=\"v1\" bandwidth=\"250000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "    <AdaptationSet id=\"2\" mimeType=\"audio/mp4\">"
+      "      <Representation id=\"a1\" bandwidth=\"128000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "  </Period></MPD>";
+  const gchar *xml_inherited =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     minimumUpdatePeriod=\"PT2S\">"
+      "  <Period id=\"P0\" start=\"PT0S\">"
+      "    <SegmentTemplate media=\"$Number$.mp4\" duration=\"2\"/>"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <Representation id=\"v1\" bandwidth=\"250000\">"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "  </Period></MPD>";
+
+  gboolean ret;
+  GstMPDClient *mpdclient = gst_mpd_client_new ();
+  GstMPDClient *new_mpdclient = gst_mpd_client_new ();
+  GstMPDClient *inherited_mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_client_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  ret = gst_mpd_client_parse_update (new_mpdclient, xml_update,
+      (gint) strlen (xml_update), mpdclient);
+  assert_equals_int (ret, TRUE);
+
+  old_period0 = g_list_nth_data (mpdclient->mpd_root_node->Periods, 0);
+  old_period1 = g_list_nth_data (mpdclient->mpd_root_node->Periods, 1);
+  new_period0 = g_list_nth_data (new_mpdclient->mpd_root_node->Periods, 0);
+  new_period1 = g_list_nth_data (new_mpdclient->mpd_root_node->Periods, 1);
+
+  /* the first Period did not change at all */
+  fail_unless (new_period0 == old_period0);
+
+  /* the second one did, but only the audio AdaptationSet changed */
+  fail_unless (new_period1 != old_period1);
+  assert_equals_uint64 (new_period1->duration, 20000);
+  assert_equals_int (g_list_length (new_period1->AdaptationSets), 2);
+  fail_unless (g_list_nth_data (new_period1->AdaptationSets, 0) ==
+      g_list_nth_data (old_period1->AdaptationSets, 0));
+  new_adapt_set = g_list_nth_data (new_period1->AdaptationSets, 1);
+  fail_unless (new_adapt_set != g_list_nth_data (old_period1->AdaptationSets,
+          1));
+  assert_equals_uint64 (((GstMPDRepresentationNode *)
+          new_adapt_set->Representations->data)->bandwidth, 128000);
+
+  /* an AdaptationSet can't be shared if what it inherits from the Period
+   * changed */
+  ret = gst_mpd_client_parse_update (inherited_mpdclient, xml_inherited,
+      (gint) strlen (xml_inherited), mpdclient);
+  assert_equals_int (ret, TRUE);
+  new_period0 =
+      g_list_nth_data (inherited_mpdclient->mpd_root_node->Periods, 0);
+  fail_unless (new_period0 != old_period0);
+  old_adapt_set = g_list_nth_data (old_period0->AdaptationSets, 0);
+  new_adapt_set = g_list_nth_data (new_period0->AdaptationSets, 0);
+  fail_unless (new_adapt_set != old_adapt_set);
+  fail_unless (new_adapt_set->SegmentTemplate != NULL);
+
+  /* the updates keep the shared nodes alive */
+  gst_mpd_client_free (mpdclient);
+
+  new_period0 = g_list_nth_data (new_mpdclient->mpd_root_node->Periods, 0);
+  assert_equals_string (new_period0->id, "P0");
+
+  gst_mpd_client_free (inherited_mpdclient);
+  gst_mpd_client_free (new_mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test various duration formats
  */
@@ -6567,6 +6732,8 @@ dash_suite (void)
       dash_mpdparser_period_segmentList_multipleSegmentBaseType_bitstreamSwitching);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_period_segmentList_segmentURL);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_period_segmentTemplate);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_period_segmentTemplate_availabilityTime);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_segmentTemplateWithPresentationTimeOffset);
   tcase_add_test (tc_simpleMPD,
@@ -6655,6 +6822,7 @@ dash_suite (void)
   tcase_add_test (tc_simpleMPD, dash_mpdparser_isoff_ondemand_profile);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_GstDateTime);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_bitstreamSwitching_inheritance);
+  tcase_add_test (tc_simpleMPD, dash_mpdparser_update_reuse);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_various_duration_formats);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_default_presentation_delay);
 
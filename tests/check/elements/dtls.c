@@ -208,6 +208,113 @@ GST_START_TEST (test_data_transfer)
 
 GST_END_TEST;
 
+/* Runs a handshake between a server and a client that are not linked to
+ * anything else and returns whether the client resumed a session */
+static gboolean
+run_handshake (const gchar * id, const gchar * resumption_id,
+    gboolean async_handshake)
+{
+  GstElement *s_enc, *s_dec, *c_enc, *c_dec, *bin;
+  GstStructure *stats;
+  gboolean c_resumed = FALSE, s_resumed = FALSE;
+  gchar *s_id, *c_id;
+  GstBus *bus;
+
+  s_id = g_strdup_printf ("%s-server", id);
+  c_id = g_strdup_printf ("%s-client", id);
+
+  g_mutex_lock (&key_lock);
+  key_count = 0;
+  g_mutex_unlock (&key_lock);
+
+  bin = gst_bin_new (NULL);
+  bus = gst_bus_new ();
+  gst_bus_set_sync_handler (bus, bus_msg_handler, NULL, NULL);
+  gst_element_set_bus (bin, bus);
+  gst_object_unref (bus);
+
+  s_dec = gst_element_factory_make ("dtlsdec", NULL);
+  g_object_set (s_dec, "connection-id", s_id, "async-handshake",
+      async_handshake, NULL);
+  g_signal_connect (s_dec, "on-key-received", G_CALLBACK (_on_key_received),
+      NULL);
+  gst_bin_add (GST_BIN (bin), s_dec);
+  gst_element_set_state (s_dec, GST_STATE_PAUSED);
+
+  s_enc = gst_element_factory_make ("dtlsenc", NULL);
+  g_object_set (s_enc, "connection-id", s_id, NULL);
+  gst_bin_add (GST_BIN (bin), s_enc);
+  gst_element_set_state (s_enc, GST_STATE_PAUSED);
+
+  c_dec = gst_element_factory_make ("dtlsdec", NULL);
+  g_object_set (c_dec, "connection-id", c_id, "resumption-id", resumption_id,
+      "async-handshake", async_handshake, NULL);
+  g_signal_connect (c_dec, "on-key-received", G_CALLBACK (_on_key_received),
+      NULL);
+  gst_bin_add (GST_BIN (bin), c_dec);
+  gst_element_set_state (c_dec, GST_STATE_PAUSED);
+
+  c_enc = gst_element_factory_make ("dtlsenc", NULL);
+  g_object_set (c_enc, "connection-id", c_id, "is-client", TRUE, NULL);
+  gst_bin_add (GST_BIN (bin), c_enc);
+
+  gst_element_link_pads (s_enc, "src", c_dec, "sink");
+  gst_element_link_pads (c_enc, "src", s_dec, "sink");
+
+  gst_element_set_state (c_enc, GST_STATE_PAUSED);
+
+  _wait_for_key_count_to_reach (2);
+
+  g_object_get (c_dec, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_boolean (stats, "resumed", &c_resumed));
+  gst_structure_free (stats);
+
+  g_object_get (s_dec, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_boolean (stats, "resumed", &s_resumed));
+  gst_structure_free (stats);
+
+  fail_unless_equals_int (c_resumed, s_resumed);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bin);
+  g_free (s_id);
+  g_free (c_id);
+
+  return c_resumed;
+}
+
+GST_START_TEST (test_session_resumption)
+{
+  fail_if (run_handshake ("resume1", "peer", FALSE));
+  fail_unless (run_handshake ("resume2", "peer", FALSE));
+
+  /* sessions are only resumed with the same id */
+  fail_if (run_handshake ("resume3", NULL, FALSE));
+  fail_if (run_handshake ("resume4", "other-peer", FALSE));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_async_handshake)
+{
+  GstElement *dec;
+  GstStructure *stats;
+  guint threads = 0;
+
+  fail_if (run_handshake ("async1", "async-peer", TRUE));
+  fail_unless (run_handshake ("async2", "async-peer", TRUE));
+
+  dec = gst_element_factory_make ("dtlsdec", NULL);
+  g_object_set (dec, "connection-id", "async-stats", NULL);
+  g_object_get (dec, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint (stats, "pool-threads", &threads));
+  fail_unless (threads > 0);
+  gst_structure_free (stats);
+  gst_object_unref (dec);
+}
+
+GST_END_TEST;
+
 static Suite *
 dtls_suite (void)
 {
@@ -217,6 +324,8 @@ dtls_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_create_and_unref);
   tcase_add_test (tc_chain, test_data_transfer);
+  tcase_add_test (tc_chain, test_session_resumption);
+  tcase_add_test (tc_chain, test_async_handshake);
 
   return s;
 }
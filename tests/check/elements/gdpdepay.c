@@ -277,6 +277,91 @@ GST_START_TEST (test_audio_in_one_buffer)
 
 GST_END_TEST;
 
+GST_START_TEST (test_payload_crc_no_copy)
+{
+  const GstDPHeaderFlag flags = GST_DP_HEADER_FLAG_CRC_HEADER |
+      GST_DP_HEADER_FLAG_CRC_PAYLOAD;
+  GstCaps *caps;
+  GstElement *gdpdepay;
+  GstBuffer *buffer, *data_buf, *outbuffer;
+  GstMemory *mems[2];
+  GstEvent *event;
+  GstSegment segment;
+  GstMapInfo map;
+  guint8 crc[2];
+  guint i;
+
+  gdpdepay = setup_gdpdepay ();
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-gdp");
+  gst_check_setup_events (mysrcpad, gdpdepay, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  event = gst_event_new_stream_start ("s-s-id-1234");
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_dp_payload_event (event, flags)), GST_FLOW_OK);
+  gst_event_unref (event);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_dp_payload_caps (caps, flags)), GST_FLOW_OK);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  event = gst_event_new_segment (&segment);
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_dp_payload_event (event, flags)), GST_FLOW_OK);
+  gst_event_unref (event);
+
+  /* a payload in two memories, which must come out as they went in */
+  buffer = gst_buffer_new ();
+  for (i = 0; i < 2; i++) {
+    mems[i] = gst_allocator_alloc (NULL, 1000, NULL);
+    gst_memory_map (mems[i], &map, GST_MAP_WRITE);
+    memset (map.data, i + 1, map.size);
+    gst_memory_unmap (mems[i], &map);
+    gst_buffer_append_memory (buffer, gst_memory_ref (mems[i]));
+  }
+  data_buf = gst_dp_payload_buffer (buffer, flags);
+  gst_buffer_unref (buffer);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, data_buf), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuffer = buffers->data;
+  fail_unless_equals_int (gst_buffer_get_size (outbuffer), 2000);
+  fail_unless_equals_int (gst_buffer_n_memory (outbuffer), 2);
+  for (i = 0; i < 2; i++)
+    fail_unless (gst_buffer_peek_memory (outbuffer, i) == mems[i]);
+
+  /* a payload not matching its CRC does not validate */
+  buffer = gst_buffer_new_allocate (NULL, 100, NULL);
+  gst_buffer_memset (buffer, 0, 0x55, 100);
+  data_buf = gst_dp_payload_buffer (buffer, flags);
+  gst_buffer_unref (buffer);
+  gst_buffer_extract (data_buf, 60, crc, 2);
+  crc[0] ^= 0xff;
+  gst_buffer_fill (data_buf, 60, crc, 2);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, data_buf), GST_FLOW_ERROR);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  for (i = 0; i < 2; i++)
+    gst_memory_unref (mems[i]);
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdpdepay, "gdpdepay", 1);
+  cleanup_gdpdepay (gdpdepay);
+}
+
+GST_END_TEST;
+
 static GstStaticPadTemplate shsinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -409,6 +494,7 @@ gdpdepay_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_audio_per_byte);
   tcase_add_test (tc_chain, test_audio_in_one_buffer);
+  tcase_add_test (tc_chain, test_payload_crc_no_copy);
   tcase_add_test (tc_chain, test_streamheader);
 
   return s;
@@ -555,6 +555,68 @@ GST_START_TEST (test_crc)
 
 GST_END_TEST;
 
+static guint16
+crc_bytewise (const guint8 * data, guint length)
+{
+  guint16 crc_register = CRC_INIT;
+
+  while (length--)
+    crc_register = (guint16) ((crc_register << 8) ^
+        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *data++]);
+
+  return 0xffff ^ crc_register;
+}
+
+GST_START_TEST (test_crc_payload)
+{
+  GstBuffer *inbuffer, *outbuffer;
+  guint8 data[300], payload[100 + 99 + 98], header[GST_DP_HEADER_LENGTH];
+  GstMemory *mems[3];
+  guint offset, length, i;
+
+  /* CRC-16/GENIBUS check value */
+  fail_unless_equals_int (gst_dp_crc ((const guint8 *) "123456789", 9),
+      0xd64e);
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = g_random_int () & 0xff;
+
+  /* all the lengths and alignments around the 8 bytes blocks */
+  for (offset = 0; offset < 8; offset++) {
+    for (length = 1; length < 100; length++) {
+      fail_unless_equals_int (gst_dp_crc (data + offset, length),
+          crc_bytewise (data + offset, length));
+    }
+  }
+
+  /* the payload memories are not copied and the CRC covers all of them */
+  inbuffer = gst_buffer_new ();
+  for (i = 0; i < 3; i++) {
+    mems[i] = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        data + i * 100, 100, 0, 100 - i, NULL, NULL);
+    gst_buffer_append_memory (inbuffer, gst_memory_ref (mems[i]));
+  }
+
+  outbuffer = gst_dp_payload_buffer (inbuffer, GST_DP_HEADER_FLAG_CRC_HEADER |
+      GST_DP_HEADER_FLAG_CRC_PAYLOAD);
+  fail_unless_equals_int (gst_buffer_n_memory (outbuffer), 4);
+  for (i = 0; i < 3; i++)
+    fail_unless (gst_buffer_peek_memory (outbuffer, i + 1) == mems[i]);
+
+  gst_buffer_extract (outbuffer, 0, header, GST_DP_HEADER_LENGTH);
+  fail_unless (gst_dp_validate_header (GST_DP_HEADER_LENGTH, header));
+  fail_unless_equals_int (gst_buffer_extract (inbuffer, 0, payload,
+          sizeof (payload)), sizeof (payload));
+  fail_unless_equals_int (GST_READ_UINT16_BE (header + 60),
+      crc_bytewise (payload, sizeof (payload)));
+
+  gst_buffer_unref (outbuffer);
+  gst_buffer_unref (inbuffer);
+  for (i = 0; i < 3; i++)
+    gst_memory_unref (mems[i]);
+}
+
+GST_END_TEST;
 
 static Suite *
 gdppay_suite (void)
@@ -568,6 +630,7 @@ gdppay_suite (void)
   tcase_add_test (tc_chain, test_first_no_new_segment);
   tcase_add_test (tc_chain, test_streamheader);
   tcase_add_test (tc_chain, test_crc);
+  tcase_add_test (tc_chain, test_crc_payload);
 
   return s;
 }
@@ -0,0 +1,170 @@
+/* GStreamer unit tests for the playlists written by hlssink2
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <gst/check/gstcheck.h>
+
+#undef GST_CAT_DEFAULT
+#include "gstm3u8playlist.h"
+#include "gstm3u8playlist.c"
+
+GST_DEBUG_CATEGORY (hls_debug);
+
+/* same as hlssink2 */
+#define LOW_LATENCY_VERSION 6
+
+static const gchar *PARTS_PLAYLIST = "#EXTM3U\n\
+#EXT-X-VERSION:6\n\
+#EXT-X-MEDIA-SEQUENCE:0\n\
+#EXT-X-TARGETDURATION:0\n\
+#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=1.5\n\
+#EXT-X-PART-INF:PART-TARGET=0.5\n\
+\n\
+#EXT-X-PART:DURATION=0.5,URI=\"segment00000.ts\",BYTERANGE=\"1000@0\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.25,URI=\"segment00000.ts\",BYTERANGE=\"800@1000\"\n";
+
+static const gchar *SEGMENT_PLAYLIST = "#EXTM3U\n\
+#EXT-X-VERSION:6\n\
+#EXT-X-MEDIA-SEQUENCE:0\n\
+#EXT-X-TARGETDURATION:1\n\
+#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=1.5\n\
+#EXT-X-PART-INF:PART-TARGET=0.5\n\
+\n\
+#EXT-X-PART:DURATION=0.5,URI=\"segment00000.ts\",BYTERANGE=\"1000@0\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.25,URI=\"segment00000.ts\",BYTERANGE=\"800@1000\"\n\
+#EXTINF:0.75,\n\
+segment00000.ts\n\
+#EXT-X-PART:DURATION=0.5,URI=\"segment00001.ts\",BYTERANGE=\"1200@0\",INDEPENDENT=YES\n";
+
+static GstM3U8Playlist *
+low_latency_playlist_new (void)
+{
+  GstM3U8Playlist *playlist;
+
+  playlist = gst_m3u8_playlist_new (LOW_LATENCY_VERSION, 0);
+  playlist->part_target_duration = 500 * GST_MSECOND;
+
+  return playlist;
+}
+
+static void
+add_segment (GstM3U8Playlist * playlist, guint index)
+{
+  gchar *url = g_strdup_printf ("segment%05u.ts", index);
+
+  fail_unless (gst_m3u8_playlist_add_part (playlist, url, 500 * GST_MSECOND,
+          0, 1000, TRUE));
+  fail_unless (gst_m3u8_playlist_add_part (playlist, url, 250 * GST_MSECOND,
+          1000, 800, FALSE));
+  fail_unless (gst_m3u8_playlist_add_entry (playlist, url, NULL,
+          750 * GST_MSECOND, index, FALSE));
+  g_free (url);
+}
+
+GST_START_TEST (test_render_parts)
+{
+  GstM3U8Playlist *playlist = low_latency_playlist_new ();
+  gchar *content;
+
+  /* parts of the segment being written come after all segments */
+  fail_unless (gst_m3u8_playlist_add_part (playlist, "segment00000.ts",
+          500 * GST_MSECOND, 0, 1000, TRUE));
+  fail_unless (gst_m3u8_playlist_add_part (playlist, "segment00000.ts",
+          250 * GST_MSECOND, 1000, 800, FALSE));
+  content = gst_m3u8_playlist_render (playlist);
+  fail_unless_equals_string (content, PARTS_PLAYLIST);
+  g_free (content);
+
+  /* and are listed before the segment once it is closed */
+  fail_unless (gst_m3u8_playlist_add_entry (playlist, "segment00000.ts",
+          NULL, 750 * GST_MSECOND, 0, FALSE));
+  fail_unless (gst_m3u8_playlist_add_part (playlist, "segment00001.ts",
+          500 * GST_MSECOND, 0, 1200, TRUE));
+  content = gst_m3u8_playlist_render (playlist);
+  fail_unless_equals_string (content, SEGMENT_PLAYLIST);
+  g_free (content);
+
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_render_parts_window)
+{
+  GstM3U8Playlist *playlist = low_latency_playlist_new ();
+  gchar *content, **lines;
+  guint i, n_parts = 0;
+
+  for (i = 0; i < 4; i++)
+    add_segment (playlist, i);
+  playlist->end_list = TRUE;
+  content = gst_m3u8_playlist_render (playlist);
+
+  /* only the last two segments keep their parts */
+  lines = g_strsplit (content, "\n", -1);
+  for (i = 0; lines[i]; i++) {
+    if (g_str_has_prefix (lines[i], "#EXT-X-PART:")) {
+      fail_unless (strstr (lines[i], "segment00002.ts") ||
+          strstr (lines[i], "segment00003.ts"));
+      n_parts++;
+    }
+  }
+  fail_unless_equals_int (n_parts, 4);
+  fail_unless (g_str_has_suffix (content, "segment00003.ts\n#EXT-X-ENDLIST"));
+
+  g_strfreev (lines);
+  g_free (content);
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_render_without_parts)
+{
+  GstM3U8Playlist *playlist = gst_m3u8_playlist_new (3, 0);
+  gchar *content;
+
+  add_segment (playlist, 0);
+  content = gst_m3u8_playlist_render (playlist);
+  fail_if (strstr (content, "#EXT-X-PART"));
+  fail_if (strstr (content, "#EXT-X-SERVER-CONTROL"));
+  fail_unless (strstr (content, "#EXTINF:0.75,\nsegment00000.ts\n"));
+
+  g_free (content);
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink2_m3u8_suite (void)
+{
+  Suite *s = suite_create ("hlssink2_m3u8");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (hls_debug, "hls", 0, "hls element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_render_parts);
+  tcase_add_test (tc_chain, test_render_parts_window);
+  tcase_add_test (tc_chain, test_render_without_parts);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink2_m3u8);
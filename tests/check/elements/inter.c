@@ -0,0 +1,156 @@
+/* GStreamer unit tests for the inter elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define VIDEO_CAPS "video/x-raw, format=RGBA, width=16, height=16, " \
+    "framerate=30/1"
+#define AUDIO_CAPS "audio/x-raw, format=S16LE, layout=interleaved, " \
+    "rate=48000, channels=1"
+
+/* 25 ms at 48 kHz, the default period of interaudiosrc */
+#define AUDIO_PERIOD_SIZE (1200 * 2)
+
+static GstHarness *
+inter_src_new (const gchar * factory, const gchar * caps, GstClockTime timeout)
+{
+  GstHarness *h = gst_harness_new (factory);
+
+  g_object_set (h->element, "channel", "inter-unit-test", NULL);
+  if (GST_CLOCK_TIME_IS_VALID (timeout))
+    g_object_set (h->element, "timeout", timeout, NULL);
+  gst_harness_use_systemclock (h);
+  gst_harness_set_sink_caps_str (h, caps);
+  gst_harness_play (h);
+
+  return h;
+}
+
+static GstHarness *
+inter_sink_new (const gchar * factory, const gchar * caps)
+{
+  GstHarness *h = gst_harness_new (factory);
+
+  g_object_set (h->element, "channel", "inter-unit-test", "sync", FALSE,
+      NULL);
+  gst_harness_set_src_caps_str (h, caps);
+
+  return h;
+}
+
+GST_START_TEST (test_video_readers)
+{
+  GstHarness *sink, *src[2];
+  GstBuffer *in, *out;
+  guint i;
+
+  sink = inter_sink_new ("intervideosink", VIDEO_CAPS);
+  in = gst_harness_create_buffer (sink, 16 * 16 * 4);
+  fail_unless_equals_int (gst_harness_push (sink, gst_buffer_ref (in)),
+      GST_FLOW_OK);
+
+  /* Without timeout the frame is only output once, by each source */
+  for (i = 0; i < 2; i++) {
+    src[i] = inter_src_new ("intervideosrc", VIDEO_CAPS, 0);
+
+    out = gst_harness_pull (src[i]);
+    fail_unless (out != NULL);
+    fail_unless (gst_buffer_peek_memory (out, 0) ==
+        gst_buffer_peek_memory (in, 0));
+    gst_buffer_unref (out);
+
+    out = gst_harness_pull (src[i]);
+    fail_unless (out != NULL);
+    fail_unless (gst_buffer_peek_memory (out, 0) !=
+        gst_buffer_peek_memory (in, 0));
+    gst_buffer_unref (out);
+  }
+
+  gst_buffer_unref (in);
+  gst_harness_teardown (src[0]);
+  gst_harness_teardown (src[1]);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+static gboolean
+pull_audio (GstHarness * h, const guint8 * data)
+{
+  guint i;
+
+  for (i = 0; i < 40; i++) {
+    GstBuffer *out = gst_harness_pull (h);
+    gboolean gap;
+
+    fail_unless (out != NULL);
+    fail_unless_equals_int (gst_buffer_get_size (out), AUDIO_PERIOD_SIZE);
+    gap = GST_BUFFER_FLAG_IS_SET (out, GST_BUFFER_FLAG_GAP);
+    if (!gap)
+      fail_unless (gst_buffer_memcmp (out, 0, data, AUDIO_PERIOD_SIZE) == 0);
+    gst_buffer_unref (out);
+
+    if (!gap)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+GST_START_TEST (test_audio_readers)
+{
+  GstHarness *sink, *src[2];
+  guint8 data[AUDIO_PERIOD_SIZE];
+  guint i;
+
+  for (i = 0; i < AUDIO_PERIOD_SIZE; i++)
+    data[i] = i & 0xff;
+
+  sink = inter_sink_new ("interaudiosink", AUDIO_CAPS);
+  src[0] = inter_src_new ("interaudiosrc", AUDIO_CAPS, GST_CLOCK_TIME_NONE);
+  src[1] = inter_src_new ("interaudiosrc", AUDIO_CAPS, GST_CLOCK_TIME_NONE);
+
+  fail_unless_equals_int (gst_harness_push (sink,
+          gst_buffer_new_memdup (data, sizeof (data))), GST_FLOW_OK);
+
+  /* Both sources get all the audio */
+  fail_unless (pull_audio (src[0], data));
+  fail_unless (pull_audio (src[1], data));
+
+  gst_harness_teardown (src[0]);
+  gst_harness_teardown (src[1]);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+static Suite *
+inter_suite (void)
+{
+  Suite *s = suite_create ("inter");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_video_readers);
+  tcase_add_test (tc_chain, test_audio_readers);
+
+  return s;
+}
+
+GST_CHECK_MAIN (inter);
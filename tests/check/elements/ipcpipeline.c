@@ -0,0 +1,208 @@
+/* GStreamer unit tests for the fd passing of ipcpipelinesink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* for memfd_create() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
+
+#define MEMORY_SIZE 4096
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  gboolean received;
+  gboolean fd_backed;
+  gboolean content_ok;
+  gboolean released;
+} FdPassingTest;
+
+static void
+fill_data (guint8 * data)
+{
+  guint i;
+
+  for (i = 0; i < MEMORY_SIZE; i++)
+    data[i] = (i * 7) & 0xff;
+}
+
+static void
+slave_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    FdPassingTest * t)
+{
+  guint8 expected[MEMORY_SIZE];
+  GstMemory *mem;
+  GstMapInfo map;
+
+  fill_data (expected);
+
+  g_mutex_lock (&t->lock);
+  t->received = TRUE;
+  if (gst_buffer_n_memory (buffer) == 1) {
+    mem = gst_buffer_peek_memory (buffer, 0);
+    t->fd_backed = gst_is_fd_memory (mem);
+    if (gst_memory_map (mem, &map, GST_MAP_READ)) {
+      t->content_ok = map.size == MEMORY_SIZE &&
+          memcmp (map.data, expected, MEMORY_SIZE) == 0;
+      gst_memory_unmap (mem, &map);
+    }
+  }
+  g_cond_signal (&t->cond);
+  g_mutex_unlock (&t->lock);
+}
+
+/* Called once the sink dropped the memory, on RELEASE_MEMORY */
+static void
+memory_released (FdPassingTest * t, GstMiniObject * mem)
+{
+  g_mutex_lock (&t->lock);
+  t->released = TRUE;
+  g_cond_signal (&t->cond);
+  g_mutex_unlock (&t->lock);
+}
+
+static GstBuffer *
+create_memfd_buffer (FdPassingTest * t)
+{
+  GstAllocator *allocator = gst_fd_allocator_new ();
+  GstBuffer *buffer;
+  GstMemory *mem;
+  GstMapInfo map;
+  int fd;
+
+  fd = memfd_create ("ipcpipeline-test", MFD_CLOEXEC);
+  fail_unless (fd >= 0);
+  fail_unless (ftruncate (fd, MEMORY_SIZE) == 0);
+
+  mem = gst_fd_allocator_alloc (allocator, fd, MEMORY_SIZE,
+      GST_FD_MEMORY_FLAG_NONE);
+  fail_unless (mem != NULL);
+  fail_unless (gst_memory_map (mem, &map, GST_MAP_WRITE));
+  fill_data (map.data);
+  gst_memory_unmap (mem, &map);
+  gst_mini_object_weak_ref (GST_MINI_OBJECT (mem),
+      (GstMiniObjectNotify) memory_released, t);
+
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, mem);
+  gst_object_unref (allocator);
+
+  return buffer;
+}
+
+/* Waits for @flag, set from another thread */
+static gboolean
+wait_for (FdPassingTest * t, gboolean * flag)
+{
+  gint64 end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&t->lock);
+  while (!*flag && g_cond_wait_until (&t->cond, &t->lock, end_time));
+  g_mutex_unlock (&t->lock);
+
+  return *flag;
+}
+
+GST_START_TEST (test_fd_passing)
+{
+  GstElement *master, *appsrc, *ipcsink, *slave, *ipcsrc, *fakesink;
+  GstFlowReturn flow = GST_FLOW_ERROR;
+  FdPassingTest t = { 0, };
+  int sockets[2];
+
+  g_mutex_init (&t.lock);
+  g_cond_init (&t.cond);
+
+  fail_unless (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+  fail_unless (fcntl (sockets[0], F_SETFL, O_NONBLOCK) == 0);
+  fail_unless (fcntl (sockets[1], F_SETFL, O_NONBLOCK) == 0);
+
+  /* the slave is driven by the master */
+  slave = gst_element_factory_make ("ipcslavepipeline", NULL);
+  ipcsrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  fakesink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (slave && ipcsrc && fakesink);
+  g_object_set (ipcsrc, "fdin", sockets[1], "fdout", sockets[1], NULL);
+  g_object_set (fakesink, "sync", FALSE, "async", FALSE, "signal-handoffs",
+      TRUE, NULL);
+  g_signal_connect (fakesink, "handoff", G_CALLBACK (slave_handoff), &t);
+  gst_bin_add_many (GST_BIN (slave), ipcsrc, fakesink, NULL);
+  fail_unless (gst_element_link (ipcsrc, fakesink));
+
+  master = gst_pipeline_new (NULL);
+  appsrc = gst_element_factory_make ("appsrc", NULL);
+  ipcsink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  fail_unless (appsrc && ipcsink);
+  g_object_set (ipcsink, "fdin", sockets[0], "fdout", sockets[0],
+      "fd-passing", TRUE, NULL);
+  gst_bin_add_many (GST_BIN (master), appsrc, ipcsink, NULL);
+  fail_unless (gst_element_link (appsrc, ipcsink));
+
+  fail_unless (gst_element_set_state (master, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (appsrc, "push-buffer", create_memfd_buffer (&t),
+      &flow);
+  fail_unless_equals_int (flow, GST_FLOW_OK);
+
+  /* the memory was received as a fd ... */
+  fail_unless (wait_for (&t, &t.received));
+  fail_unless (t.fd_backed);
+  fail_unless (t.content_ok);
+
+  /* ... and released once the slave pipeline did not need it anymore */
+  fail_unless (wait_for (&t, &t.released));
+
+  gst_element_set_state (master, GST_STATE_NULL);
+  gst_element_set_state (slave, GST_STATE_NULL);
+  gst_object_unref (master);
+  gst_object_unref (slave);
+  close (sockets[0]);
+  close (sockets[1]);
+  g_cond_clear (&t.cond);
+  g_mutex_clear (&t.lock);
+}
+
+GST_END_TEST;
+
+static Suite *
+ipcpipeline_suite (void)
+{
+  Suite *s = suite_create ("ipcpipeline");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_fd_passing);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ipcpipeline);
@@ -0,0 +1,139 @@
+/* GStreamer unit tests for the iqa element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <gst/check/gstcheck.h>
+
+/* RGBA is the output format, so frames are compared without conversion */
+#define VIDEO_CAPS "video/x-raw,format=RGBA,width=32,height=16,framerate=30/1"
+
+/* The first linked sink pad gets the reference stream */
+#define IQA_PIPELINE(do_psnr, ref_color, cmp_color) \
+    "videotestsrc num-buffers=1 pattern=solid-color foreground-color=" \
+    ref_color " ! " VIDEO_CAPS " ! iqa name=iqa do-psnr=" do_psnr \
+    " ! fakesink videotestsrc num-buffers=1 pattern=solid-color" \
+    " foreground-color=" cmp_color " ! " VIDEO_CAPS " ! iqa."
+
+GST_START_TEST (test_psnr)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GstStructure *psnr = NULL;
+  gdouble value = 0, expected;
+
+  /* identical frames */
+  pipeline = gst_parse_launch (IQA_PIPELINE ("true", "0xff204060",
+          "0xff204060"), NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless (gst_message_has_name (msg, "IQA"));
+  fail_unless (gst_structure_get (gst_message_get_structure (msg), "psnr",
+          GST_TYPE_STRUCTURE, &psnr, NULL));
+  fail_unless_equals_int (gst_structure_n_fields (psnr), 1);
+  fail_unless (gst_structure_get_double (psnr, "sink_1", &value));
+  fail_unless_equals_float (value, 100.0);
+  fail_if (gst_structure_has_field (gst_message_get_structure (msg),
+          "dssim"));
+  gst_structure_free (psnr);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  /* every red sample differs by 16, alpha is not counted */
+  pipeline = gst_parse_launch (IQA_PIPELINE ("true", "0xff204060",
+          "0x80304060"), NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless (gst_message_has_name (msg, "IQA"));
+  fail_unless (gst_structure_get (gst_message_get_structure (msg), "psnr",
+          GST_TYPE_STRUCTURE, &psnr, NULL));
+  fail_unless (gst_structure_get_double (psnr, "sink_1", &value));
+  expected = 10 * log10 (255.0 * 255.0 * 3 / (16 * 16));
+  fail_unless (fabs (value - expected) < 1e-9);
+  gst_structure_free (psnr);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_psnr_disabled)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+
+  pipeline = gst_parse_launch (IQA_PIPELINE ("false", "0xff204060",
+          "0xff304060"), NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless (gst_message_has_name (msg, "IQA"));
+  fail_if (gst_structure_has_field (gst_message_get_structure (msg), "psnr"));
+  fail_unless (gst_structure_has_field (gst_message_get_structure (msg),
+          "time"));
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+iqa_suite (void)
+{
+  Suite *s = suite_create ("iqa");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_psnr);
+  tcase_add_test (tc_chain, test_psnr_disabled);
+
+  return s;
+}
+
+GST_CHECK_MAIN (iqa);
@@ -0,0 +1,246 @@
+/* GStreamer unit tests for the latencystamp and latencymeasure elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define VIDEO_CAPS "video/x-raw, format=RGBA, width=16, height=16, " \
+    "framerate=30/1"
+
+/* The channel is used from the start */
+static GstHarness *
+harness_new (const gchar * factory, const gchar * channel)
+{
+  GstElement *element = gst_element_factory_make (factory, NULL);
+  GstHarness *h;
+
+  fail_unless (element != NULL);
+  g_object_set (element, "channel", channel, NULL);
+  h = gst_harness_new_with_element (element, "sink", "src");
+  gst_harness_set_src_caps_str (h, VIDEO_CAPS);
+  gst_object_unref (element);
+
+  return h;
+}
+
+#define stamp_new() harness_new ("latencystamp", "latency-unit-test")
+#define measure_new() harness_new ("latencymeasure", "latency-unit-test")
+
+/* Stamps a buffer and returns it */
+static GstBuffer *
+stamp_buffer (GstHarness * stamp, guint i)
+{
+  GstBuffer *buf = gst_buffer_new ();
+
+  GST_BUFFER_PTS (buf) = i * GST_MSECOND;
+  fail_unless_equals_int (gst_harness_push (stamp, buf), GST_FLOW_OK);
+  buf = gst_harness_pull (stamp);
+  fail_unless (buf != NULL);
+
+  return buf;
+}
+
+static guint
+get_uint (const GstStructure * s, const gchar * field)
+{
+  guint value = 0;
+
+  fail_unless (gst_structure_get_uint (s, field, &value));
+
+  return value;
+}
+
+static guint64
+get_uint64 (const GstStructure * s, const gchar * field)
+{
+  guint64 value = 0;
+
+  fail_unless (gst_structure_get_uint64 (s, field, &value));
+
+  return value;
+}
+
+GST_START_TEST (test_stamp)
+{
+  GstHarness *stamp = stamp_new ();
+  GstReferenceTimestampMeta *meta;
+  GstCaps *reference;
+  GstBuffer *buf;
+  guint i;
+
+  reference = gst_caps_from_string ("timestamp/x-gst-latency-stamp, "
+      "channel=latency-unit-test");
+
+  for (i = 0; i < 3; i++) {
+    buf = stamp_buffer (stamp, i);
+    meta = gst_buffer_get_reference_timestamp_meta (buf, reference);
+    fail_unless (meta != NULL);
+    /* the ID is in the duration */
+    fail_unless_equals_uint64 (meta->duration, i);
+    fail_unless (meta->timestamp > 0);
+    gst_buffer_unref (buf);
+  }
+
+  gst_caps_unref (reference);
+  gst_harness_teardown (stamp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_measure)
+{
+  GstHarness *stamp = stamp_new ();
+  GstHarness *measure = measure_new ();
+  GstStructure *stats;
+  GstBus *bus;
+  GstMessage *msg;
+  guint64 id = 0, latency = 0;
+  guint i;
+
+  bus = gst_bus_new ();
+  gst_element_set_bus (measure->element, bus);
+  g_object_set (measure->element, "post-messages", TRUE, NULL);
+
+  /* buffers 3 and 4 are dropped on the way */
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = stamp_buffer (stamp, i);
+
+    if (i == 3 || i == 4) {
+      gst_buffer_unref (buf);
+      continue;
+    }
+    g_usleep (1000);
+    fail_unless_equals_int (gst_harness_push (measure, buf), GST_FLOW_OK);
+  }
+
+  g_object_get (measure->element, "stats", &stats, NULL);
+  fail_unless (gst_structure_has_name (stats, "GstLatencyMeasureStats"));
+  fail_unless_equals_string (gst_structure_get_string (stats, "media"),
+      "video");
+  fail_unless_equals_int (get_uint (stats, "stamped"), 8);
+  fail_unless_equals_int (get_uint (stats, "matched-by-pts"), 0);
+  fail_unless_equals_int (get_uint (stats, "unmatched"), 0);
+  fail_unless_equals_int (get_uint (stats, "latency-count"), 8);
+  fail_unless_equals_uint64 (get_uint64 (stats, "lost"), 2);
+  fail_unless (get_uint64 (stats, "latency-max") >= GST_MSECOND);
+  gst_structure_free (stats);
+
+  /* one message per matched buffer */
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  fail_unless (gst_message_has_name (msg, "GstLatencyMeasurement"));
+  fail_unless (gst_structure_get (gst_message_get_structure (msg),
+          "id", G_TYPE_UINT64, &id, "latency", G_TYPE_UINT64, &latency,
+          NULL));
+  fail_unless_equals_uint64 (id, 0);
+  fail_unless (latency >= GST_MSECOND);
+  gst_message_unref (msg);
+
+  gst_bus_set_flushing (bus, TRUE);
+  gst_object_unref (bus);
+  gst_harness_teardown (measure);
+  gst_harness_teardown (stamp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_match_by_pts)
+{
+  GstHarness *stamp = stamp_new ();
+  GstHarness *measure = measure_new ();
+  GstHarness *other = harness_new ("latencymeasure", "another-channel");
+  GstStructure *stats;
+  GstBuffer *buf, *recreated;
+
+  /* a buffer recreated without the metas but with the same PTS */
+  buf = stamp_buffer (stamp, 5);
+  recreated = gst_buffer_new ();
+  GST_BUFFER_PTS (recreated) = GST_BUFFER_PTS (buf);
+  gst_buffer_unref (buf);
+
+  fail_unless_equals_int (gst_harness_push (measure,
+          gst_buffer_ref (recreated)), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (other, recreated), GST_FLOW_OK);
+
+  g_object_get (measure->element, "stats", &stats, NULL);
+  fail_unless_equals_int (get_uint (stats, "stamped"), 0);
+  fail_unless_equals_int (get_uint (stats, "matched-by-pts"), 1);
+  fail_unless_equals_int (get_uint (stats, "latency-count"), 1);
+  gst_structure_free (stats);
+
+  /* the stamps of another channel are not used */
+  g_object_get (other->element, "stats", &stats, NULL);
+  fail_unless_equals_int (get_uint (stats, "matched-by-pts"), 0);
+  fail_unless_equals_int (get_uint (stats, "unmatched"), 1);
+  fail_unless_equals_int (get_uint (stats, "latency-count"), 0);
+  gst_structure_free (stats);
+
+  gst_harness_teardown (other);
+  gst_harness_teardown (measure);
+  gst_harness_teardown (stamp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stats_query)
+{
+  GstHarness *h;
+  GstQuery *query;
+  const GValue *stats;
+
+  h = gst_harness_new_parse ("latencystamp ! latencymeasure name=first ! "
+      "identity ! latencymeasure name=second");
+  gst_harness_set_src_caps_str (h, VIDEO_CAPS);
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_new ()),
+      GST_FLOW_OK);
+  gst_buffer_unref (gst_harness_pull (h));
+
+  /* each stage on the way adds its statistics, from downstream */
+  query = gst_query_new_custom (GST_QUERY_CUSTOM,
+      gst_structure_new_empty ("GstLatencyStatsQuery"));
+  fail_unless (gst_pad_peer_query (h->sinkpad, query));
+  stats = gst_structure_get_value (gst_query_get_structure (query), "stats");
+  fail_unless (stats != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (stats), 2);
+  fail_unless_equals_string (gst_structure_get_string (gst_value_get_structure
+          (gst_value_array_get_value (stats, 0)), "name"), "second");
+  fail_unless_equals_string (gst_structure_get_string (gst_value_get_structure
+          (gst_value_array_get_value (stats, 1)), "name"), "first");
+  gst_query_unref (query);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+latencymeasure_suite (void)
+{
+  Suite *s = suite_create ("latencymeasure");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_stamp);
+  tcase_add_test (tc_chain, test_measure);
+  tcase_add_test (tc_chain, test_match_by_pts);
+  tcase_add_test (tc_chain, test_stats_query);
+
+  return s;
+}
+
+GST_CHECK_MAIN (latencymeasure);
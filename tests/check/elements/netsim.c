@@ -1,5 +1,7 @@
 #include <gst/check/gstharness.h>
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 GST_START_TEST (netsim_stress)
 {
@@ -51,6 +53,110 @@ GST_START_TEST (netsim_stress_delayed)
 
 GST_END_TEST;
 
+static gchar *
+write_trace_file (const gchar * contents)
+{
+  GError *err = NULL;
+  gchar *filename;
+  gint fd;
+
+  fd = g_file_open_tmp ("netsim-trace-XXXXXX", &filename, &err);
+  fail_unless (fd >= 0, "%s", err ? err->message : "");
+  close (fd);
+  fail_unless (g_file_set_contents (filename, contents, -1, NULL));
+
+  return filename;
+}
+
+static void
+check_packet_stats (GstBus * bus, const gchar * status, GstClockTime arrival,
+    GstClockTime departure)
+{
+  GstMessage *msg;
+  const GstStructure *s;
+  guint64 arrival_time, departure_time;
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_name (s, "GstNetSimPacket"));
+  fail_unless_equals_string (gst_structure_get_string (s, "status"), status);
+  fail_unless (gst_structure_get_uint64 (s, "arrival-time", &arrival_time));
+  fail_unless (gst_structure_get_uint64 (s, "departure-time",
+          &departure_time));
+  if (GST_CLOCK_TIME_IS_VALID (arrival))
+    fail_unless_equals_uint64 (arrival_time, arrival);
+  if (GST_CLOCK_TIME_IS_VALID (departure))
+    fail_unless_equals_uint64 (departure_time, departure);
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (netsim_trace)
+{
+  gchar *filename = write_trace_file ("100\n");
+  gchar *launch;
+  GstHarness *h;
+  GstBus *bus = gst_bus_new ();
+  guint i;
+
+  /* one 1500 bytes opportunity every 100 ms and room for 3 packets */
+  launch = g_strdup_printf ("netsim trace-file=\"%s\" trace-queue-size=3000 "
+      "trace-stats=true", filename);
+  h = gst_harness_new_parse (launch);
+  g_free (launch);
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  for (i = 0; i < 5; i++)
+    fail_unless_equals_int (gst_harness_push (h,
+            gst_harness_create_buffer (h, 1000)), GST_FLOW_OK);
+
+  for (i = 0; i < 3; i++)
+    gst_buffer_unref (gst_harness_pull (h));
+
+  /* the first opportunity sends the first packet and half of the second one,
+   * the second opportunity the rest of the queue */
+  check_packet_stats (bus, "queue-full", GST_CLOCK_TIME_NONE,
+      GST_CLOCK_TIME_NONE);
+  check_packet_stats (bus, "queue-full", GST_CLOCK_TIME_NONE,
+      GST_CLOCK_TIME_NONE);
+  check_packet_stats (bus, "delivered", 0, 100 * GST_MSECOND);
+  check_packet_stats (bus, "delivered", GST_CLOCK_TIME_NONE,
+      200 * GST_MSECOND);
+  check_packet_stats (bus, "delivered", GST_CLOCK_TIME_NONE,
+      200 * GST_MSECOND);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 3);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_trace_invalid)
+{
+  gchar *filename = write_trace_file ("0\n20\n10\n");
+  GstElement *netsim = gst_element_factory_make ("netsim", NULL);
+
+  g_object_set (netsim, "trace-file", filename, NULL);
+  fail_unless_equals_int (gst_element_set_state (netsim, GST_STATE_READY),
+      GST_STATE_CHANGE_FAILURE);
+
+  g_object_set (netsim, "trace-file", "/nonexistent/netsim-trace", NULL);
+  fail_unless_equals_int (gst_element_set_state (netsim, GST_STATE_READY),
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_element_set_state (netsim, GST_STATE_NULL);
+  gst_object_unref (netsim);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 netsim_suite (void)
 {
@@ -60,6 +166,8 @@ netsim_suite (void)
   suite_add_tcase (s, (tc_chain = tcase_create ("general")));
   tcase_add_test (tc_chain, netsim_stress);
   tcase_add_test (tc_chain, netsim_stress_delayed);
+  tcase_add_test (tc_chain, netsim_trace);
+  tcase_add_test (tc_chain, netsim_trace_invalid);
 
   return s;
 }
@@ -24,6 +24,7 @@
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstharness.h>
+#include <gst/check/gsttestclock.h>
 
 GST_START_TEST (test_flush_before_buffer)
 {
@@ -95,6 +96,175 @@ GST_START_TEST (test_flush_before_buffer)
 
 GST_END_TEST;
 
+static void
+proxy_harness_new (GstHarness ** h_in, GstHarness ** h_out)
+{
+  GstElement *sink, *src;
+
+  sink = gst_element_factory_make ("proxysink", NULL);
+  src = gst_element_factory_make ("proxysrc", NULL);
+
+  g_object_set (src, "proxysink", sink, NULL);
+
+  *h_in = gst_harness_new_with_element (sink, "sink", NULL);
+  *h_out = gst_harness_new_with_element (src, NULL, "src");
+  gst_object_unref (sink);
+  gst_object_unref (src);
+
+  gst_harness_play (*h_out);
+  gst_harness_play (*h_in);
+  gst_harness_set_src_caps_str (*h_in, "foo/bar");
+}
+
+static guint64
+get_stat (GstHarness * h, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 value = 0;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, field, &value));
+  gst_structure_free (stats);
+
+  return value;
+}
+
+GST_START_TEST (test_batching)
+{
+  GstHarness *h_in, *h_out;
+  GstClock *clock;
+  guint i;
+
+  /* The batches only time out when the clock is advanced */
+  clock = gst_test_clock_new ();
+  gst_system_clock_set_default (clock);
+
+  proxy_harness_new (&h_in, &h_out);
+  g_object_set (h_in->element, "max-batch-buffers", 4,
+      "max-batch-buffer-size", 100, NULL);
+
+  /* The small buffers are kept until the batch is full */
+  for (i = 0; i < 3; i++)
+    fail_unless_equals_int (gst_harness_push (h_in,
+            gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+  fail_unless_equals_int (get_stat (h_out, "received"), 0);
+
+  fail_unless_equals_int (gst_harness_push (h_in,
+          gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+  fail_unless_equals_int (get_stat (h_out, "received"), 4);
+
+  /* A big buffer is passed on right away, after the pending ones */
+  fail_unless_equals_int (gst_harness_push (h_in,
+          gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+  fail_unless_equals_int (get_stat (h_out, "received"), 4);
+  fail_unless_equals_int (gst_harness_push (h_in,
+          gst_buffer_new_and_alloc (1000)), GST_FLOW_OK);
+  fail_unless_equals_int (get_stat (h_out, "received"), 6);
+
+  /* Serialized events are not overtaking the batched buffers */
+  fail_unless_equals_int (gst_harness_push (h_in,
+          gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h_in, gst_event_new_eos ()));
+  fail_unless_equals_int (get_stat (h_out, "received"), 7);
+
+  for (i = 0; i < 7; i++)
+    gst_buffer_unref (gst_harness_pull (h_out));
+
+  gst_harness_teardown (h_in);
+  gst_harness_teardown (h_out);
+  gst_system_clock_set_default (NULL);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_batch_timeout)
+{
+  GstHarness *h_in, *h_out;
+  GstClock *clock;
+  GstClockID id;
+  guint i;
+
+  clock = gst_test_clock_new ();
+  gst_system_clock_set_default (clock);
+
+  proxy_harness_new (&h_in, &h_out);
+  g_object_set (h_in->element, "max-batch-buffers", 4,
+      "max-batch-buffer-size", 100, "max-batch-time", 20 * GST_MSECOND, NULL);
+
+  for (i = 0; i < 2; i++)
+    fail_unless_equals_int (gst_harness_push (h_in,
+            gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+  fail_unless_equals_int (get_stat (h_out, "received"), 0);
+
+  /* The partial batch is passed on without further input */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (clock), &id);
+  fail_unless_equals_uint64 (gst_clock_id_get_time (id), 20 * GST_MSECOND);
+  gst_clock_id_unref (id);
+  fail_unless (gst_test_clock_crank (GST_TEST_CLOCK (clock)));
+
+  for (i = 0; i < 2; i++)
+    gst_buffer_unref (gst_harness_pull (h_out));
+  fail_unless_equals_int (get_stat (h_out, "received"), 2);
+
+  /* A full batch does not time out anymore */
+  for (i = 0; i < 4; i++)
+    fail_unless_equals_int (gst_harness_push (h_in,
+            gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+  fail_unless_equals_int (get_stat (h_out, "received"), 6);
+  fail_if (gst_test_clock_peek_next_pending_id (GST_TEST_CLOCK (clock),
+          NULL));
+
+  for (i = 0; i < 4; i++)
+    gst_buffer_unref (gst_harness_pull (h_out));
+
+  gst_harness_teardown (h_in);
+  gst_harness_teardown (h_out);
+  gst_system_clock_set_default (NULL);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+block_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_leaky)
+{
+  GstHarness *h_in, *h_out;
+  GstPad *srcpad;
+  gulong probe_id;
+  guint i;
+
+  proxy_harness_new (&h_in, &h_out);
+  g_object_set (h_out->element, "max-size-buffers", 2, "leaky",
+      2 /* downstream */ , NULL);
+
+  /* Stall the downstream pipeline */
+  srcpad = gst_element_get_static_pad (h_out->element, "src");
+  probe_id = gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+      block_probe, NULL, NULL);
+
+  /* The upstream pipeline is not blocked by the full queue */
+  for (i = 0; i < 10; i++)
+    fail_unless_equals_int (gst_harness_push (h_in,
+            gst_buffer_new_and_alloc (10)), GST_FLOW_OK);
+
+  fail_unless_equals_int (get_stat (h_out, "received"), 10);
+  fail_unless (get_stat (h_out, "dropped") >= 7);
+
+  gst_pad_remove_probe (srcpad, probe_id);
+  gst_object_unref (srcpad);
+
+  gst_harness_teardown (h_in);
+  gst_harness_teardown (h_out);
+}
+
+GST_END_TEST;
+
 static Suite *
 proxysink_suite (void)
 {
@@ -103,6 +273,9 @@ proxysink_suite (void)
 
   suite_add_tcase (s, tc_basic);
   tcase_add_test (tc_basic, test_flush_before_buffer);
+  tcase_add_test (tc_basic, test_batching);
+  tcase_add_test (tc_basic, test_batch_timeout);
+  tcase_add_test (tc_basic, test_leaky);
 
   return s;
 }
@@ -0,0 +1,194 @@
+/*
+ * ristrtxsend.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gst/check/check.h>
+#include <gst/rtp/rtp.h>
+
+#define TEST_SSRC 0x12345670
+#define TEST_CAPS "application/x-rtp, payload=(int)33, clock-rate=(int)90000, " \
+    "encoding-name=(string)MP2T, ssrc=(uint)305419888"
+
+static GstBuffer *
+create_rtp_buffer (guint16 seqnum, guint32 rtptime)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+
+  buf = gst_rtp_buffer_new_allocate (4, 0, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, 33);
+  gst_rtp_buffer_set_ssrc (&rtp, TEST_SSRC);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, rtptime);
+  GST_WRITE_UINT16_BE (gst_rtp_buffer_get_payload (&rtp), seqnum);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+static void
+push_packets (GstHarness * h, guint16 first, guint n, guint32 ts_step)
+{
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    guint16 seqnum = first + i;
+
+    fail_unless_equals_int (gst_harness_push (h,
+            create_rtp_buffer (seqnum, seqnum * ts_step)), GST_FLOW_OK);
+    gst_buffer_unref (gst_harness_pull (h));
+  }
+}
+
+static void
+request_rtx (GstHarness * h, guint16 seqnum)
+{
+  fail_unless (gst_harness_push_upstream_event (h,
+          gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+              gst_structure_new ("GstRTPRetransmissionRequest",
+                  "seqnum", G_TYPE_UINT, (guint) seqnum,
+                  "ssrc", G_TYPE_UINT, (guint) TEST_SSRC, NULL))));
+}
+
+static void
+pull_rtx (GstHarness * h, guint16 seqnum)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp);
+  fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtp), TEST_SSRC + 1);
+  fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), seqnum);
+  fail_unless_equals_int (GST_READ_UINT16_BE (gst_rtp_buffer_get_payload
+          (&rtp)), seqnum);
+  gst_rtp_buffer_unmap (&rtp);
+  gst_buffer_unref (buf);
+}
+
+static void
+check_stats (GstHarness * h, guint hits, guint misses, guint evictions)
+{
+  guint num_hits, num_misses, num_evictions;
+
+  g_object_get (h->element, "num-rtx-hits", &num_hits, "num-rtx-misses",
+      &num_misses, "num-evictions", &num_evictions, NULL);
+  fail_unless_equals_int (num_hits, hits);
+  fail_unless_equals_int (num_misses, misses);
+  fail_unless_equals_int (num_evictions, evictions);
+}
+
+GST_START_TEST (test_rtx_max_size_packets)
+{
+  GstHarness *h = gst_harness_new ("ristrtxsend");
+
+  g_object_set (h->element, "max-size-packets", 100, NULL);
+  gst_harness_set_src_caps_str (h, TEST_CAPS);
+
+  push_packets (h, 0, 250, 3000);
+
+  request_rtx (h, 249);
+  pull_rtx (h, 249);
+  request_rtx (h, 150);
+  pull_rtx (h, 150);
+
+  /* evicted and not sent yet */
+  request_rtx (h, 149);
+  request_rtx (h, 250);
+
+  check_stats (h, 2, 2, 150);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtx_max_size_time)
+{
+  GstHarness *h = gst_harness_new ("ristrtxsend");
+
+  /* 10 packets per 100 ms, unlimited number of packets */
+  g_object_set (h->element, "max-size-packets", 0, "max-size-time", 100,
+      NULL);
+  gst_harness_set_src_caps_str (h, TEST_CAPS);
+
+  push_packets (h, 0, 3000, 900);
+
+  request_rtx (h, 2989);
+  pull_rtx (h, 2989);
+  request_rtx (h, 2988);
+
+  check_stats (h, 1, 1, 2989);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtx_seqnum_wrap)
+{
+  GstHarness *h = gst_harness_new ("ristrtxsend");
+
+  g_object_set (h->element, "max-size-packets", 100, NULL);
+  gst_harness_set_src_caps_str (h, TEST_CAPS);
+
+  push_packets (h, 65500, 100, 3000);
+
+  request_rtx (h, 65535);
+  pull_rtx (h, 65535);
+  request_rtx (h, 63);
+  pull_rtx (h, 63);
+  request_rtx (h, 65500);
+  pull_rtx (h, 65500);
+
+  check_stats (h, 3, 0, 0);
+
+  /* packets with a gap in the seqnums, the limit is on the number of
+   * packets and not on the seqnums they span */
+  push_packets (h, 80, 10, 3000);
+
+  request_rtx (h, 70);
+  request_rtx (h, 85);
+  pull_rtx (h, 85);
+  request_rtx (h, 65510);
+  pull_rtx (h, 65510);
+  request_rtx (h, 65509);
+
+  check_stats (h, 5, 2, 10);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+ristrtxsend_suite (void)
+{
+  Suite *s = suite_create ("ristrtxsend");
+  TCase *tc = tcase_create ("history");
+
+  suite_add_tcase (s, tc);
+
+  tcase_add_test (tc, test_rtx_max_size_packets);
+  tcase_add_test (tc, test_rtx_max_size_time);
+  tcase_add_test (tc, test_rtx_seqnum_wrap);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ristrtxsend);
@@ -0,0 +1,171 @@
+/* GStreamer unit tests for the roundrobin element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+typedef struct
+{
+  GstHarness *h;
+  GstHarness *out[3];
+} RoundRobinTest;
+
+static void
+round_robin_test_setup (RoundRobinTest * t, guint n_pads)
+{
+  guint i;
+
+  t->h = gst_harness_new_with_padnames ("roundrobin", "sink", NULL);
+  gst_harness_set_src_caps_str (t->h, "application/x-test");
+
+  for (i = 0; i < n_pads; i++) {
+    gchar *name = g_strdup_printf ("src_%u", i);
+
+    t->out[i] = gst_harness_new_with_element (t->h->element, NULL, name);
+    g_free (name);
+  }
+}
+
+static void
+round_robin_test_teardown (RoundRobinTest * t, guint n_pads)
+{
+  guint i;
+
+  for (i = 0; i < n_pads; i++)
+    gst_harness_teardown (t->out[i]);
+  gst_harness_teardown (t->h);
+}
+
+static void
+set_weight (RoundRobinTest * t, guint i, gdouble weight)
+{
+  GstPad *pad;
+  gchar *name = g_strdup_printf ("src_%u", i);
+
+  pad = gst_element_get_static_pad (t->h->element, name);
+  fail_unless (pad != NULL);
+  g_object_set (pad, "weight", weight, NULL);
+  gst_object_unref (pad);
+  g_free (name);
+}
+
+static void
+push_buffers (RoundRobinTest * t, guint n, GstBufferFlags flags)
+{
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    GstBuffer *buf = gst_buffer_new ();
+
+    GST_BUFFER_FLAG_SET (buf, flags);
+    fail_unless_equals_int (gst_harness_push (t->h, buf), GST_FLOW_OK);
+  }
+}
+
+GST_START_TEST (test_equal_weights)
+{
+  RoundRobinTest t;
+  guint i;
+
+  round_robin_test_setup (&t, 3);
+
+  /* buffers are distributed in turn */
+  for (i = 0; i < 9; i++) {
+    push_buffers (&t, 1, 0);
+    fail_unless_equals_int (gst_harness_buffers_received (t.out[i % 3]),
+        i / 3 + 1);
+  }
+
+  round_robin_test_teardown (&t, 3);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_weights)
+{
+  RoundRobinTest t;
+  guint i, max_run = 0, run = 0;
+
+  round_robin_test_setup (&t, 2);
+  set_weight (&t, 0, 3.0);
+  set_weight (&t, 1, 1.0);
+
+  /* the shares follow the weights and the buffers of the heaviest pad are
+   * interleaved with the others */
+  for (i = 0; i < 400; i++) {
+    guint received = gst_harness_buffers_received (t.out[0]);
+
+    push_buffers (&t, 1, 0);
+    if (gst_harness_buffers_received (t.out[0]) > received)
+      max_run = MAX (max_run, ++run);
+    else
+      run = 0;
+  }
+
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[0]), 300);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[1]), 100);
+  fail_unless_equals_int (max_run, 3);
+
+  /* a pad with a weight of 0 gets nothing */
+  set_weight (&t, 1, 0.0);
+  push_buffers (&t, 10, 0);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[0]), 310);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[1]), 100);
+
+  round_robin_test_teardown (&t, 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_duplicate_flags)
+{
+  RoundRobinTest t;
+
+  round_robin_test_setup (&t, 2);
+  g_object_set (t.h->element, "duplicate-flags", GST_BUFFER_FLAG_MARKER, NULL);
+  set_weight (&t, 1, 0.0);
+
+  push_buffers (&t, 4, 0);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[0]), 4);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[1]), 0);
+
+  /* flagged buffers go everywhere, whatever the weights */
+  push_buffers (&t, 2, GST_BUFFER_FLAG_MARKER);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[0]), 6);
+  fail_unless_equals_int (gst_harness_buffers_received (t.out[1]), 2);
+
+  round_robin_test_teardown (&t, 2);
+}
+
+GST_END_TEST;
+
+static Suite *
+roundrobin_suite (void)
+{
+  Suite *s = suite_create ("roundrobin");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_equal_weights);
+  tcase_add_test (tc_chain, test_weights);
+  tcase_add_test (tc_chain, test_duplicate_flags);
+
+  return s;
+}
+
+GST_CHECK_MAIN (roundrobin);
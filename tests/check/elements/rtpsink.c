@@ -17,7 +17,10 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <string.h>
+#include <gio/gio.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 
 GST_START_TEST (test_uri_to_properties)
 {
@@ -42,6 +45,90 @@ GST_START_TEST (test_uri_to_properties)
 
 GST_END_TEST;
 
+#define GSO_TEST_PACKETS 6
+#define GSO_TEST_SIZE 1000
+
+static GstBuffer *
+create_rtp_packet (guint16 seqnum, gsize size)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  GstMapInfo map;
+
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  memset (map.data, seqnum & 0xff, size);
+  GST_WRITE_UINT8 (map.data, 0x80);
+  GST_WRITE_UINT8 (map.data + 1, 96);
+  GST_WRITE_UINT16_BE (map.data + 2, seqnum);
+  GST_WRITE_UINT32_BE (map.data + 4, 0);
+  GST_WRITE_UINT32_BE (map.data + 8, 0x12345678);
+  gst_buffer_unmap (buffer, &map);
+
+  return buffer;
+}
+
+GST_START_TEST (test_gso_send)
+{
+  GstElement *rtpsink;
+  GstHarness *h;
+  GSocket *socket;
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+  GstBufferList *list;
+  gchar *uri;
+  guint8 data[2 * GSO_TEST_SIZE];
+  guint16 port;
+  guint i;
+
+  /* receive on a port picked by the kernel */
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, 0);
+  fail_unless (g_socket_bind (socket, addr, FALSE, NULL));
+  g_object_unref (addr);
+  g_object_unref (iaddr);
+  g_socket_set_timeout (socket, 5);
+
+  addr = g_socket_get_local_address (socket, NULL);
+  fail_unless (addr != NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
+
+  rtpsink = gst_element_factory_make ("rtpsink", NULL);
+  uri = g_strdup_printf ("rtp://127.0.0.1:%u", port);
+  g_object_set (rtpsink, "uri", uri, "gso", TRUE, NULL);
+  g_free (uri);
+
+  h = gst_harness_new_with_element (rtpsink, "sink_%u", NULL);
+  gst_harness_set_src_caps_str (h, "application/x-rtp, media=video, "
+      "payload=96, clock-rate=90000, encoding-name=RAW, ssrc=(uint)305419896");
+
+  /* equal datagrams and a shorter last one, merged into one send */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < GSO_TEST_PACKETS; i++)
+    gst_buffer_list_add (list, create_rtp_packet (i,
+            i < GSO_TEST_PACKETS - 1 ? GSO_TEST_SIZE : GSO_TEST_SIZE / 2));
+  fail_unless_equals_int (gst_harness_push_list (h, list), GST_FLOW_OK);
+
+  /* the kernel splits them back into the original datagrams */
+  for (i = 0; i < GSO_TEST_PACKETS; i++) {
+    gssize size = g_socket_receive (socket, (gchar *) data, sizeof (data),
+        NULL, NULL);
+
+    fail_unless_equals_int (size,
+        i < GSO_TEST_PACKETS - 1 ? GSO_TEST_SIZE : GSO_TEST_SIZE / 2);
+    fail_unless_equals_int (GST_READ_UINT16_BE (data + 2), i);
+    fail_unless_equals_int (data[size - 1], i);
+  }
+
+  gst_harness_teardown (h);
+  gst_object_unref (rtpsink);
+  g_object_unref (socket);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpsink_suite (void)
 {
@@ -50,6 +137,7 @@ rtpsink_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_uri_to_properties);
+  tcase_add_test (tc_chain, test_gso_send);
 
   return s;
 }
@@ -17,7 +17,12 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <gst/check/gstcheck.h>
+#include <gio/gio.h>
 
 GST_START_TEST (test_uri_to_properties)
 {
@@ -43,6 +48,186 @@ GST_START_TEST (test_uri_to_properties)
 
 GST_END_TEST;
 
+#define BATCH_TEST_PACKETS 40
+
+static void
+rtpsrc_pad_added (GstElement * rtpsrc, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+/* counts the buffers, the ones with a reference timestamp and their bytes */
+static void
+rtpsrc_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gint * counts)
+{
+  if (gst_buffer_get_reference_timestamp_meta (buffer, NULL))
+    g_atomic_int_inc (&counts[1]);
+  g_atomic_int_add (&counts[2], gst_buffer_get_size (buffer));
+  g_atomic_int_inc (&counts[0]);
+}
+
+static void
+send_rtp_packets (guint16 port, const gsize * sizes, guint n)
+{
+  GSocket *socket;
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+  guint8 *packet;
+  guint i;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, port);
+
+  for (i = 0; i < n; i++) {
+    packet = g_malloc0 (sizes[i]);
+    packet[0] = 0x80;
+    packet[1] = 96;
+    GST_WRITE_UINT16_BE (packet + 2, i);
+    GST_WRITE_UINT32_BE (packet + 4, i * 3000);
+    GST_WRITE_UINT32_BE (packet + 8, 0x12345678);
+    fail_unless_equals_int (g_socket_send_to (socket, addr,
+            (const gchar *) packet, sizes[i], NULL, NULL), sizes[i]);
+    g_free (packet);
+    /* don't overflow the receive buffer with the big ones */
+    if (sizes[i] > 1500)
+      g_usleep (5 * G_TIME_SPAN_MILLISECOND);
+  }
+
+  g_object_unref (addr);
+  g_object_unref (iaddr);
+  g_object_unref (socket);
+}
+
+/* Returns the port the socket of the RTP source of @rtpsrc is bound to */
+static guint16
+get_rtp_port (GstElement * rtpsrc)
+{
+  GstElement *src;
+  GSocket *socket = NULL;
+  GSocketAddress *addr;
+  guint16 port;
+
+  src = gst_bin_get_by_name (GST_BIN (rtpsrc), "rtp_rtp_batchsrc0");
+  if (!src)
+    src = gst_bin_get_by_name (GST_BIN (rtpsrc), "rtp_rtp_udpsrc0");
+  fail_unless (src != NULL);
+  g_object_get (src, "used-socket", &socket, NULL);
+  fail_unless (socket != NULL);
+
+  addr = g_socket_get_local_address (socket, NULL);
+  fail_unless (addr != NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  fail_unless (port != 0);
+
+  g_object_unref (addr);
+  g_object_unref (socket);
+  gst_object_unref (src);
+
+  return port;
+}
+
+static GstElement *
+create_batch_pipeline (gint * counts)
+{
+  GstElement *pipeline, *rtpsrc, *sink, *rtcp_src;
+
+  pipeline = gst_pipeline_new (NULL);
+  rtpsrc = gst_element_factory_make ("rtpsrc", "rtpsrc");
+  sink = gst_element_factory_make ("fakesink", NULL);
+  /* let the kernel pick free ports, the RTCP one would be 1 otherwise */
+  g_object_set (rtpsrc, "uri", "rtp://127.0.0.1:0"
+      "?latency=0&batch-size=16&timestamping=true&encoding-name=RAW", NULL);
+  rtcp_src = gst_bin_get_by_name (GST_BIN (rtpsrc), "rtp_rtcp_udpsrc0");
+  fail_unless (rtcp_src != NULL);
+  g_object_set (rtcp_src, "port", 0, NULL);
+  gst_object_unref (rtcp_src);
+
+  g_object_set (sink, "sync", FALSE, "async", FALSE, "signal-handoffs", TRUE,
+      NULL);
+  g_signal_connect (rtpsrc, "pad-added", G_CALLBACK (rtpsrc_pad_added), sink);
+  g_signal_connect (sink, "handoff", G_CALLBACK (rtpsrc_handoff), counts);
+  gst_bin_add_many (GST_BIN (pipeline), rtpsrc, sink, NULL);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  return pipeline;
+}
+
+static void
+wait_for_packets (gint * counts, gint n)
+{
+  guint i;
+
+  for (i = 0; i < 500 && g_atomic_int_get (&counts[0]) < n; i++)
+    g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+}
+
+GST_START_TEST (test_batch_receive)
+{
+  GstElement *pipeline, *rtpsrc;
+  gsize sizes[BATCH_TEST_PACKETS];
+  gint counts[3] = { 0, 0, 0 };
+  guint i;
+
+  for (i = 0; i < BATCH_TEST_PACKETS; i++)
+    sizes[i] = 12 + 100;
+
+  pipeline = create_batch_pipeline (counts);
+  rtpsrc = gst_bin_get_by_name (GST_BIN (pipeline), "rtpsrc");
+
+  send_rtp_packets (get_rtp_port (rtpsrc), sizes, BATCH_TEST_PACKETS);
+  wait_for_packets (counts, BATCH_TEST_PACKETS);
+
+  fail_unless_equals_int (g_atomic_int_get (&counts[0]), BATCH_TEST_PACKETS);
+#if defined(HAVE_RECVMMSG) && defined(__linux__)
+  /* the kernel time of every packet is attached to it */
+  fail_unless_equals_int (g_atomic_int_get (&counts[1]), BATCH_TEST_PACKETS);
+#endif
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (rtpsrc);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_batch_receive_large)
+{
+  GstElement *pipeline, *rtpsrc;
+  /* jumbo frames and datagrams the kernel reassembled from fragments */
+  const gsize sizes[] = { 12 + 100, 9000, 12 + 1400, 60000, 1501, 9000 };
+  gint counts[3] = { 0, 0, 0 };
+  gint total = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    total += sizes[i];
+
+  pipeline = create_batch_pipeline (counts);
+  rtpsrc = gst_bin_get_by_name (GST_BIN (pipeline), "rtpsrc");
+
+  send_rtp_packets (get_rtp_port (rtpsrc), sizes, G_N_ELEMENTS (sizes));
+  wait_for_packets (counts, G_N_ELEMENTS (sizes));
+
+  /* nothing was dropped or truncated */
+  fail_unless_equals_int (g_atomic_int_get (&counts[0]), G_N_ELEMENTS (sizes));
+  fail_unless_equals_int (g_atomic_int_get (&counts[2]), total);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (rtpsrc);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpsrc_suite (void)
 {
@@ -51,6 +236,8 @@ rtpsrc_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_uri_to_properties);
+  tcase_add_test (tc_chain, test_batch_receive);
+  tcase_add_test (tc_chain, test_batch_receive_large);
 
   return s;
 }
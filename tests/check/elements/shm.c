@@ -26,6 +26,9 @@
 
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -229,6 +232,245 @@ GST_START_TEST (test_shm_live)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shm_ring)
+{
+  GstElement *producer, *consumer;
+  GstElement *src, *sink;
+  gchar *socket_path = NULL;
+  GstStateChangeReturn state_res;
+  GstSample *sample = NULL;
+  guint64 ring_buffers = 0;
+  guint i;
+
+  /* fixed size buffers of 4096 bytes, only a few fit in the area, so the
+   * sink has to wait for the batched acks */
+  src = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (src, "sizetype", 2, NULL);
+
+  sink = gst_element_factory_make ("shmsink", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "shm-size", 16384,
+      "ring-size", 8, NULL);
+
+  producer = gst_pipeline_new ("producer-pipeline");
+  gst_bin_add_many (GST_BIN (producer), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  state_res = gst_element_set_state (producer, GST_STATE_PLAYING);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  g_object_get (sink, "socket-path", &socket_path, NULL);
+  fail_unless (socket_path != NULL);
+
+  src = gst_element_factory_make ("shmsrc", NULL);
+  sink = gst_element_factory_make ("appsink", NULL);
+  g_object_set (src, "is-live", TRUE, "use-ring", TRUE, NULL);
+  g_object_set (sink, "async", FALSE, "enable-last-sample", FALSE, NULL);
+
+  consumer = gst_pipeline_new ("consumer-pipeline");
+  gst_bin_add_many (GST_BIN (consumer), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  g_object_set (src, "socket-path", socket_path, NULL);
+
+  state_res = gst_element_set_state (consumer, GST_STATE_PLAYING);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 100; i++) {
+    GstBuffer *buf;
+
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    fail_unless (sample != NULL);
+    buf = gst_sample_get_buffer (sample);
+    fail_unless_equals_int (gst_buffer_get_size (buf), 4096);
+    gst_sample_unref (sample);
+  }
+
+  /* only the first buffers may come before the ring is set up */
+  g_object_get (src, "ring-buffers", &ring_buffers, NULL);
+  fail_unless (ring_buffers >= 90);
+
+  state_res = gst_element_set_state (producer, GST_STATE_NULL);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  state_res = gst_element_set_state (consumer, GST_STATE_NULL);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (consumer);
+  gst_object_unref (producer);
+
+  g_free (socket_path);
+}
+
+GST_END_TEST;
+
+static GstSample *
+push_and_pull (GstElement * src, GstElement * appsink, GstMemory * mem)
+{
+  GstSample *sample = NULL;
+  GstFlowReturn flow;
+  GstBuffer *buf;
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, gst_memory_ref (mem));
+  g_signal_emit_by_name (src, "push-buffer", buf, &flow);
+  fail_unless_equals_int (flow, GST_FLOW_OK);
+  gst_buffer_unref (buf);
+
+  g_signal_emit_by_name (appsink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+
+  return sample;
+}
+
+static GMutex released_lock;
+static GCond released_cond;
+static guint n_released;
+
+static void
+memory_released (gpointer user_data)
+{
+  g_mutex_lock (&released_lock);
+  n_released++;
+  g_cond_signal (&released_cond);
+  g_mutex_unlock (&released_lock);
+}
+
+/* Counts in n_released when @mem is freed */
+static void
+watch_memory (GstMemory * mem)
+{
+  static GQuark quark;
+
+  if (!quark)
+    quark = g_quark_from_static_string ("shm-test-released");
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem), quark,
+      GUINT_TO_POINTER (1), memory_released);
+}
+
+/* Waits until @n memories watched with watch_memory() were freed */
+static void
+wait_memories_released (guint n)
+{
+  gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&released_lock);
+  while (n_released < n) {
+    if (!g_cond_wait_until (&released_cond, &released_lock, end_time))
+      break;
+  }
+  fail_unless_equals_int (n_released, n);
+  n_released = 0;
+  g_mutex_unlock (&released_lock);
+}
+
+GST_START_TEST (test_shm_fd_passing)
+{
+  GstElement *producer, *consumer;
+  GstElement *src, *sink, *shmsrc, *appsink;
+  GstAllocator *allocator;
+  GstMemory *mem;
+  GstBuffer *buf;
+  GstMapInfo map;
+  gchar *socket_path = NULL;
+  gchar *tmp_path = NULL;
+  guint8 data[8192];
+  GstStateChangeReturn state_res;
+  GstSample *sample = NULL;
+  GstMemory *received;
+  gboolean fd_passed = FALSE;
+  guint i;
+  gint fd;
+
+  /* a file backed memory, its fd is passed to shmsrc instead of copying it */
+  fd = g_file_open_tmp ("shm-fd-passing-XXXXXX", &tmp_path, NULL);
+  fail_unless (fd >= 0);
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i & 0xff;
+  fail_unless_equals_int (write (fd, data, sizeof (data)), sizeof (data));
+
+  allocator = gst_fd_allocator_new ();
+  mem = gst_fd_allocator_alloc (allocator, fd, sizeof (data),
+      GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (mem, 4096, 1024);
+  watch_memory (mem);
+
+  src = gst_element_factory_make ("appsrc", NULL);
+  g_object_set (src, "is-live", TRUE, "format", GST_FORMAT_TIME, NULL);
+
+  sink = gst_element_factory_make ("shmsink", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "fd-passing", TRUE,
+      "wait-for-connection", TRUE, "enable-last-sample", FALSE, NULL);
+
+  producer = gst_pipeline_new ("producer-pipeline");
+  gst_bin_add_many (GST_BIN (producer), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  state_res = gst_element_set_state (producer, GST_STATE_PLAYING);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  g_object_get (sink, "socket-path", &socket_path, NULL);
+  fail_unless (socket_path != NULL);
+
+  consumer = gst_pipeline_new ("consumer-pipeline");
+  appsink = gst_element_factory_make ("appsink", NULL);
+  g_object_set (appsink, "async", FALSE, "enable-last-sample", FALSE, NULL);
+  shmsrc = gst_element_factory_make ("shmsrc", NULL);
+  g_object_set (shmsrc, "is-live", TRUE, "socket-path", socket_path, NULL);
+  gst_bin_add_many (GST_BIN (consumer), shmsrc, appsink, NULL);
+  fail_unless (gst_element_link (shmsrc, appsink));
+
+  state_res = gst_element_set_state (consumer, GST_STATE_PLAYING);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  /* the first buffers are copied until shmsink knows that shmsrc accepts
+   * fds, from then on all of them must be passed as fds */
+  for (i = 0; i < 100 && !fd_passed; i++) {
+    sample = push_and_pull (src, appsink, mem);
+    buf = gst_sample_get_buffer (sample);
+    fd_passed = gst_is_fd_memory (gst_buffer_peek_memory (buf, 0));
+    gst_sample_unref (sample);
+  }
+  fail_unless (fd_passed);
+
+  for (i = 0; i < 10; i++) {
+    sample = push_and_pull (src, appsink, mem);
+    buf = gst_sample_get_buffer (sample);
+    fail_unless_equals_int (gst_buffer_n_memory (buf), 1);
+    received = gst_buffer_peek_memory (buf, 0);
+    fail_unless (gst_is_fd_memory (received));
+    watch_memory (received);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, 1024);
+    fail_unless (memcmp (map.data, data + 4096, 1024) == 0);
+    gst_buffer_unmap (buf, &map);
+    gst_sample_unref (sample);
+  }
+
+  /* nothing keeps the received memories once the samples are gone */
+  wait_memories_released (10);
+
+  /* shmsink drops its buffers once shmsrc released them, the memory is
+   * then freed with the last reference of the test */
+  gst_memory_unref (mem);
+  wait_memories_released (1);
+
+  state_res = gst_element_set_state (producer, GST_STATE_NULL);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  state_res = gst_element_set_state (consumer, GST_STATE_NULL);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (consumer);
+  gst_object_unref (producer);
+  gst_object_unref (allocator);
+
+  g_unlink (tmp_path);
+  g_free (tmp_path);
+  g_free (socket_path);
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -243,6 +485,8 @@ shm_suite (void)
 
   tc = tcase_create ("shm2");
   tcase_add_test (tc, test_shm_live);
+  tcase_add_test (tc, test_shm_ring);
+  tcase_add_test (tc, test_shm_fd_passing);
   suite_add_tcase (s, tc);
 
   return s;
@@ -30,6 +30,9 @@
 #include <gst/check/gstcheck.h>
 
 #include <gst/check/gstharness.h>
+#include <gst/rtp/rtp.h>
+
+#include <string.h>
 
 GST_START_TEST (test_create_and_unref)
 {
@@ -249,6 +252,132 @@ GST_START_TEST (test_roc)
 
 GST_END_TEST;
 
+#define SHARD_KEY "012345678901234567890123456789012345678901234567890123456789"
+#define SHARD_SRTP_CAPS "application/x-srtp, payload=(int)8, " \
+    "srtp-key=(buffer)" SHARD_KEY ", srtp-cipher=(string)aes-128-icm, " \
+    "srtp-auth=(string)hmac-sha1-80, srtcp-cipher=(string)aes-128-icm, " \
+    "srtcp-auth=(string)hmac-sha1-80"
+#define SHARD_N_SSRCS 5
+#define SHARD_N_PACKETS 40
+
+static GstCaps *
+request_shard_key (GstElement * dec, guint ssrc, gpointer user_data)
+{
+  GstCaps *caps = gst_caps_from_string (SHARD_SRTP_CAPS);
+
+  gst_caps_set_simple (caps, "ssrc", G_TYPE_UINT, ssrc, NULL);
+  return caps;
+}
+
+static GstBuffer *
+create_shard_rtp_buffer (guint i)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+  guint8 *payload;
+
+  buf = gst_rtp_buffer_new_allocate (20, 0, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, 8);
+  gst_rtp_buffer_set_ssrc (&rtp, 1000 + i % SHARD_N_SSRCS);
+  gst_rtp_buffer_set_seq (&rtp, i / SHARD_N_SSRCS);
+  gst_rtp_buffer_set_timestamp (&rtp, (i / SHARD_N_SSRCS) * 160);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  memset (payload, i, 20);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+static guint64
+get_stats_count (GstElement * e, const gchar * field)
+{
+  GstStructure *stats;
+  const GValue *streams;
+  guint64 total = 0;
+  guint i;
+
+  g_object_get (e, "stats", &stats, NULL);
+  streams = gst_structure_get_value (stats, "streams");
+  fail_unless (streams != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (streams), SHARD_N_SSRCS);
+
+  for (i = 0; i < gst_value_array_get_size (streams); i++) {
+    const GstStructure *ss =
+        gst_value_get_structure (gst_value_array_get_value (streams, i));
+    guint64 count;
+
+    fail_unless (gst_structure_get_uint64 (ss, field, &count));
+    fail_unless_equals_uint64 (count, SHARD_N_PACKETS / SHARD_N_SSRCS);
+    total += count;
+  }
+  gst_structure_free (stats);
+
+  return total;
+}
+
+GST_START_TEST (test_n_threads_buffer_list)
+{
+  GstHarness *enc_h, *dec_h;
+  GstBufferList *list, *protected;
+  GstCaps *caps;
+  guint i;
+
+  enc_h = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0", "rtp_src_0");
+  g_object_set (enc_h->element, "n-threads", 4, NULL);
+  gst_util_set_object_arg (G_OBJECT (enc_h->element), "key", SHARD_KEY);
+  gst_harness_set_src_caps_str (enc_h, "application/x-rtp, payload=(int)8");
+
+  dec_h = gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  g_object_set (dec_h->element, "n-threads", 4, NULL);
+  g_signal_connect (dec_h->element, "request-key",
+      G_CALLBACK (request_shard_key), NULL);
+  caps = request_shard_key (dec_h->element, 1000, NULL);
+  gst_harness_set_src_caps (dec_h, caps);
+
+  /* the SSRCs of the list are interleaved and end up in several shards */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < SHARD_N_PACKETS; i++)
+    gst_buffer_list_add (list, create_shard_rtp_buffer (i));
+  fail_unless_equals_int (gst_harness_push_list (enc_h, list), GST_FLOW_OK);
+
+  protected = gst_buffer_list_new ();
+  for (i = 0; i < SHARD_N_PACKETS; i++) {
+    GstBuffer *buf = gst_harness_pull (enc_h);
+
+    fail_unless (buf != NULL);
+    fail_unless (gst_buffer_get_size (buf) > 32);
+    gst_buffer_list_add (protected, buf);
+  }
+  fail_unless_equals_uint64 (get_stats_count (enc_h->element,
+          "protect-count"), SHARD_N_PACKETS);
+
+  fail_unless_equals_int (gst_harness_push_list (dec_h, protected),
+      GST_FLOW_OK);
+
+  /* unprotected packets come out in their original order */
+  for (i = 0; i < SHARD_N_PACKETS; i++) {
+    GstBuffer *buf = gst_harness_pull (dec_h);
+    GstBuffer *expected = create_shard_rtp_buffer (i);
+    GstMapInfo map;
+
+    fail_unless (buf != NULL);
+    gst_buffer_map (expected, &map, GST_MAP_READ);
+    fail_unless_equals_int (gst_buffer_get_size (buf), map.size);
+    fail_unless (gst_buffer_memcmp (buf, 0, map.data, map.size) == 0);
+    gst_buffer_unmap (expected, &map);
+    gst_buffer_unref (expected);
+    gst_buffer_unref (buf);
+  }
+  fail_unless_equals_uint64 (get_stats_count (dec_h->element,
+          "unprotect-count"), SHARD_N_PACKETS);
+
+  gst_harness_teardown (enc_h);
+  gst_harness_teardown (dec_h);
+}
+
+GST_END_TEST;
+
 #ifdef HAVE_SRTP2
 
 GST_START_TEST (test_simple_mki)
@@ -395,6 +524,7 @@ srtp_suite (void)
   tcase_add_test (tc_chain, test_play);
   tcase_add_test (tc_chain, test_roc);
   tcase_add_test (tc_chain, test_play_key_error);
+  tcase_add_test (tc_chain, test_n_threads_buffer_list);
 #ifdef HAVE_SRTP2
   tcase_add_test (tc_chain, test_simple_mki);
   tcase_add_test (tc_chain, test_srtpdec_multiple_mki);
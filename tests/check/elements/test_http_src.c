@@ -231,6 +231,7 @@ gst_test_http_src_reset_input (GstTestHTTPSrc * src)
   src->input.context = NULL;
   src->input.size = 0;
   src->input.status_code = 0;
+  src->input.connect_time = GST_CLOCK_TIME_NONE;
   if (src->input.request_headers) {
     gst_structure_free (src->input.request_headers);
     src->input.request_headers = NULL;
@@ -313,6 +314,10 @@ gst_test_http_src_start (GstBaseSrc * basesrc)
   }
   http_headers = gst_structure_new_empty ("http-headers");
   gst_structure_set (http_headers, "uri", G_TYPE_STRING, src->uri, NULL);
+  if (GST_CLOCK_TIME_IS_VALID (src->input.connect_time)) {
+    gst_structure_set (http_headers, "connect-time", GST_TYPE_CLOCK_TIME,
+        src->input.connect_time, NULL);
+  }
   if (!src->input.request_headers) {
     src->input.request_headers =
         gst_structure_new_empty (TEST_HTTP_SRC_REQUEST_HEADERS_NAME);
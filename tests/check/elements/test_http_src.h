@@ -52,6 +52,9 @@ typedef struct _GstTestHTTPSrcInput
   GstStructure *request_headers;
   GstStructure *response_headers;
   guint status_code; /* HTTP status code */
+  /* reported as "connect-time" in the http-headers, like curlhttpsrc does,
+   * if valid */
+  GstClockTime connect_time;
 } GstTestHTTPSrcInput;
 
 /* Opaque structure used by GstTestHTTPSrc */
@@ -0,0 +1,206 @@
+/* GStreamer unit tests for the videocodectestsink element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* No padding in such frames */
+#define WIDTH 16
+#define HEIGHT 16
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+#define CAPS_FORMAT "video/x-raw, format=%s, width=16, height=16, " \
+    "framerate=30/1"
+
+typedef struct
+{
+  GstHarness *h;
+  GstBus *bus;
+} TestSink;
+
+static void
+test_sink_setup (TestSink * t, const gchar * format, const gchar * manifest)
+{
+  GstElement *sink = gst_element_factory_make ("videocodectestsink", NULL);
+  gchar *caps;
+
+  fail_unless (sink != NULL);
+  g_object_set (sink, "manifest", manifest, NULL);
+  t->bus = gst_bus_new ();
+  gst_element_set_bus (sink, t->bus);
+
+  t->h = gst_harness_new_with_element (sink, "sink", NULL);
+  caps = g_strdup_printf (CAPS_FORMAT, format);
+  gst_harness_set_src_caps_str (t->h, caps);
+  g_free (caps);
+  gst_object_unref (sink);
+}
+
+static void
+test_sink_teardown (TestSink * t)
+{
+  gst_harness_teardown (t->h);
+  gst_bus_set_flushing (t->bus, TRUE);
+  gst_object_unref (t->bus);
+}
+
+static void
+fill_frame (guint8 * data, guint seed)
+{
+  guint i;
+
+  for (i = 0; i < FRAME_SIZE; i++)
+    data[i] = (i * 13 + seed * 7) & 0xff;
+}
+
+static void
+push_frame (TestSink * t, const guint8 * data)
+{
+  fail_unless_equals_int (gst_harness_push (t->h,
+          gst_buffer_new_memdup (data, FRAME_SIZE)), GST_FLOW_OK);
+}
+
+/* Returns the stats and the checksum messages posted at EOS */
+static void
+push_eos (TestSink * t, GstStructure ** stats, GstStructure ** checksum)
+{
+  GstMessage *msg;
+
+  fail_unless (gst_harness_push_event (t->h, gst_event_new_eos ()));
+
+  msg = gst_bus_pop_filtered (t->bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  fail_unless (gst_message_has_name (msg, "conformance/stats"));
+  *stats = gst_structure_copy (gst_message_get_structure (msg));
+  gst_message_unref (msg);
+
+  msg = gst_bus_pop_filtered (t->bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  fail_unless (gst_message_has_name (msg, "conformance/checksum"));
+  *checksum = gst_structure_copy (gst_message_get_structure (msg));
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_manifest)
+{
+  TestSink t;
+  GstStructure *stats, *checksum;
+  GString *manifest = g_string_new ("# frames of the test\n\n");
+  guint8 data[FRAME_SIZE];
+  gchar *path, *frame_md5;
+  guint64 frames = 0;
+  gint64 first_mismatch = 0;
+  guint i, value = 0;
+
+  /* frame 2 differs, and frame 3 is missing */
+  for (i = 0; i < 4; i++) {
+    fill_frame (data, i == 2 ? 100 : i);
+    frame_md5 = g_compute_checksum_for_data (G_CHECKSUM_MD5, data,
+        FRAME_SIZE);
+    g_string_append_printf (manifest, "%s  frame-%u.yuv\n", frame_md5, i);
+    g_free (frame_md5);
+  }
+
+  path = g_build_filename (g_get_tmp_dir (), "videocodectestsink-XXXXXX",
+      NULL);
+  g_close (g_mkstemp (path), NULL);
+  fail_unless (g_file_set_contents (path, manifest->str, -1, NULL));
+
+  test_sink_setup (&t, "I420", path);
+  for (i = 0; i < 3; i++) {
+    fill_frame (data, i);
+    push_frame (&t, data);
+  }
+  push_eos (&t, &stats, &checksum);
+
+  fail_unless (gst_structure_get_uint64 (stats, "frames", &frames));
+  fail_unless_equals_uint64 (frames, 3);
+  fail_unless (gst_structure_get_uint (stats, "interval-count", &value));
+  fail_unless_equals_int (value, 2);
+  fail_unless (gst_structure_has_field (stats, "fps"));
+
+  fail_unless (gst_structure_get_uint (checksum, "frames-expected", &value));
+  fail_unless_equals_int (value, 4);
+  fail_unless (gst_structure_get_uint (checksum, "frames-mismatched",
+          &value));
+  fail_unless_equals_int (value, 2);
+  fail_unless (gst_structure_get_int64 (checksum, "first-mismatch",
+          &first_mismatch));
+  fail_unless_equals_int64 (first_mismatch, 2);
+
+  gst_structure_free (stats);
+  gst_structure_free (checksum);
+  test_sink_teardown (&t);
+  g_unlink (path);
+  g_free (path);
+  g_string_free (manifest, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_nv12)
+{
+  TestSink t;
+  GstStructure *stats, *checksum;
+  guint8 nv12[FRAME_SIZE], i420[FRAME_SIZE];
+  const guint8 *uv = nv12 + WIDTH * HEIGHT;
+  guint8 *u = i420 + WIDTH * HEIGHT;
+  guint8 *v = u + WIDTH * HEIGHT / 4;
+  gchar *expected;
+  guint i;
+
+  /* the checksum is the one of the I420 layout */
+  fill_frame (nv12, 0);
+  memcpy (i420, nv12, WIDTH * HEIGHT);
+  for (i = 0; i < WIDTH * HEIGHT / 4; i++) {
+    u[i] = uv[2 * i];
+    v[i] = uv[2 * i + 1];
+  }
+  expected = g_compute_checksum_for_data (G_CHECKSUM_MD5, i420, FRAME_SIZE);
+
+  test_sink_setup (&t, "NV12", NULL);
+  push_frame (&t, nv12);
+  push_eos (&t, &stats, &checksum);
+
+  fail_unless_equals_string (gst_structure_get_string (checksum, "checksum"),
+      expected);
+  fail_if (gst_structure_has_field (checksum, "frames-expected"));
+
+  gst_structure_free (stats);
+  gst_structure_free (checksum);
+  g_free (expected);
+  test_sink_teardown (&t);
+}
+
+GST_END_TEST;
+
+static Suite *
+videocodectestsink_suite (void)
+{
+  Suite *s = suite_create ("videocodectestsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_manifest);
+  tcase_add_test (tc_chain, test_nv12);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videocodectestsink);
@@ -0,0 +1,187 @@
+/* GStreamer unit tests for the watchdog element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+static void
+push_buffers (GstHarness * h, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    GstBuffer *buf = gst_buffer_new ();
+
+    GST_BUFFER_PTS (buf) = i * GST_MSECOND;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    g_usleep (G_USEC_PER_SEC / 1000);
+  }
+}
+
+static guint
+get_count (const GstStructure * stats, const gchar * field)
+{
+  guint count = 0;
+
+  fail_unless (gst_structure_get_uint (stats, field, &count));
+
+  return count;
+}
+
+GST_START_TEST (test_gap_stats)
+{
+  GstHarness *h = gst_harness_new ("watchdog");
+  GstStructure *stats;
+  const GValue *histogram;
+  guint64 max = 0;
+  guint i, sum = 0;
+
+  g_object_set (h->element, "timeout", 0, NULL);
+  gst_harness_set_src_caps_str (h, "foo/bar");
+  push_buffers (h, 10);
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  fail_unless (gst_structure_has_name (stats, "GstWatchdogStats"));
+  fail_unless_equals_int (get_count (stats, "gap-count"), 9);
+
+  histogram = gst_structure_get_value (stats, "gap-histogram");
+  for (i = 0; i < gst_value_array_get_size (histogram); i++)
+    sum += g_value_get_uint (gst_value_array_get_value (histogram, i));
+  fail_unless_equals_int (sum, 9);
+
+  /* We slept at least 1 ms between the buffers */
+  fail_unless (gst_structure_get_uint64 (stats, "gap-max", &max));
+  fail_unless (max >= GST_MSECOND);
+  fail_if (gst_structure_has_field (stats, "processing-count"));
+  gst_structure_free (stats);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_processing_stats)
+{
+  GstHarness *h;
+  GstElement *in, *out;
+  GstStructure *stats;
+  guint64 p50 = 0;
+
+  h = gst_harness_new_parse ("watchdog name=in timeout=0 ! "
+      "identity sleep-time=2000 ! watchdog name=out timeout=0");
+  in = gst_bin_get_by_name (GST_BIN (h->element), "in");
+  out = gst_bin_get_by_name (GST_BIN (h->element), "out");
+  g_object_set (out, "upstream-watchdog", in, NULL);
+
+  gst_harness_set_src_caps_str (h, "foo/bar");
+  push_buffers (h, 5);
+
+  g_object_get (out, "stats", &stats, NULL);
+  fail_unless_equals_int (get_count (stats, "processing-count"), 5);
+  fail_unless (gst_structure_get_uint64 (stats, "processing-p50", &p50));
+  fail_unless (p50 >= 2 * GST_MSECOND);
+  gst_structure_free (stats);
+
+  gst_object_unref (in);
+  gst_object_unref (out);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stats_query)
+{
+  GstHarness *h;
+  GstQuery *query;
+  const GValue *array;
+  const GstStructure *s;
+
+  h = gst_harness_new_parse ("watchdog name=in timeout=0 ! "
+      "identity ! watchdog name=out timeout=0");
+  gst_harness_set_src_caps_str (h, "foo/bar");
+  push_buffers (h, 2);
+
+  query = gst_query_new_custom (GST_QUERY_CUSTOM,
+      gst_structure_new_empty ("GstWatchdogStatsQuery"));
+  fail_unless (gst_pad_peer_query (h->sinkpad, query));
+
+  /* The statistics are collected from downstream to upstream */
+  array = gst_structure_get_value (gst_query_get_structure (query), "stats");
+  fail_unless (array != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (array), 2);
+  s = gst_value_get_structure (gst_value_array_get_value (array, 0));
+  fail_unless_equals_string (gst_structure_get_string (s, "name"), "out");
+  s = gst_value_get_structure (gst_value_array_get_value (array, 1));
+  fail_unless_equals_string (gst_structure_get_string (s, "name"), "in");
+  fail_unless_equals_int (get_count (s, "gap-count"), 1);
+  gst_query_unref (query);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_warning_message)
+{
+  GstHarness *h = gst_harness_new ("watchdog");
+  GstBus *bus = gst_bus_new ();
+  GstMessage *msg;
+  const GstStructure *s;
+  gint warning_timeout = 0;
+
+  gst_element_set_bus (h->element, bus);
+  g_object_set (h->element, "timeout", 0, "warning-timeout", 50, NULL);
+  gst_harness_set_src_caps_str (h, "foo/bar");
+  push_buffers (h, 1);
+
+  /* The message is posted without any error */
+  msg = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND,
+      GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ELEMENT);
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_name (s, "GstWatchdogWarning"));
+  fail_unless (gst_structure_get_int (s, "warning-timeout",
+          &warning_timeout));
+  fail_unless_equals_int (warning_timeout, 50);
+  fail_unless (gst_structure_has_field_typed (s, "stats", GST_TYPE_STRUCTURE));
+  gst_message_unref (msg);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+watchdog_suite (void)
+{
+  Suite *s = suite_create ("watchdog");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_gap_stats);
+  tcase_add_test (tc_chain, test_processing_stats);
+  tcase_add_test (tc_chain, test_stats_query);
+  tcase_add_test (tc_chain, test_warning_message);
+
+  return s;
+}
+
+GST_CHECK_MAIN (watchdog);
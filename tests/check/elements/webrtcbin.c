@@ -1813,6 +1813,134 @@ GST_START_TEST (test_stats_with_stream)
 
 GST_END_TEST;
 
+static void
+validate_filtered_stats_foreach (GQuark field_id, const GValue * value,
+    const GstStructure * filter)
+{
+  const GstStructure *s;
+  GstWebRTCStatsType type, filter_type;
+
+  fail_unless (GST_VALUE_HOLDS_STRUCTURE (value));
+  s = gst_value_get_structure (value);
+
+  fail_unless (gst_structure_get (s, "type", GST_TYPE_WEBRTC_STATS_TYPE, &type,
+          NULL));
+  fail_unless (gst_structure_get (filter, "type", GST_TYPE_WEBRTC_STATS_TYPE,
+          &filter_type, NULL));
+  fail_unless_equals_int (type, filter_type);
+}
+
+GST_START_TEST (test_filtered_stats)
+{
+  struct test_webrtc *t = create_audio_test ();
+  const GstStructure *reply;
+  GstStructure *filter;
+  GstPromise *p;
+  GstCaps *caps;
+  GstPad *pad;
+
+  /* test that only the requested stats are returned */
+
+  t->on_offer_created = NULL;
+  t->on_answer_created = NULL;
+  t->on_negotiation_needed = NULL;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  test_webrtc_create_offer (t);
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  caps = gst_caps_from_string (OPUS_RTP_CAPS (96));
+  pad = gst_element_get_static_pad (t->webrtc1, "sink_0");
+  gst_pad_set_caps (pad, caps);
+  gst_caps_unref (caps);
+
+  test_webrtc_wait_for_answer_error_eos (t);
+  test_webrtc_signal_state (t, STATE_ANSWER_SET);
+
+  /* by type */
+  filter = gst_structure_new ("filter", "type", GST_TYPE_WEBRTC_STATS_TYPE,
+      GST_WEBRTC_STATS_CODEC, NULL);
+  p = gst_promise_new ();
+  g_signal_emit_by_name (t->webrtc1, "get-filtered-stats", NULL, filter, p);
+  fail_unless_equals_int (gst_promise_wait (p), GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (p);
+  fail_unless (gst_structure_n_fields (reply) > 0);
+  gst_structure_foreach (reply,
+      (GstStructureForeachFunc) validate_filtered_stats_foreach, filter);
+  gst_promise_unref (p);
+  gst_structure_free (filter);
+
+  /* by id */
+  filter = gst_structure_new ("filter", "id", G_TYPE_STRING,
+      "peer-connection-stats", NULL);
+  p = gst_promise_new ();
+  g_signal_emit_by_name (t->webrtc1, "get-filtered-stats", NULL, filter, p);
+  fail_unless_equals_int (gst_promise_wait (p), GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (p);
+  fail_unless_equals_int (gst_structure_n_fields (reply), 1);
+  fail_unless (gst_structure_has_field (reply, "peer-connection-stats"));
+  gst_promise_unref (p);
+  gst_structure_free (filter);
+
+  gst_object_unref (pad);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
+static void
+_bus_stats_delta (struct test_webrtc *t, GstBus * bus, GstMessage * msg,
+    gpointer user_data)
+{
+  const GstStructure *s;
+
+  if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ELEMENT
+      || GST_ELEMENT (msg->src) != t->webrtc1)
+    return;
+
+  s = gst_message_get_structure (msg);
+  if (!gst_structure_has_name (s, "application/x-webrtc-stats-delta"))
+    return;
+
+  /* the first update contains everything */
+  fail_unless (gst_structure_has_field (s, "peer-connection-stats"));
+  test_webrtc_signal_state_unlocked (t, STATE_CUSTOM);
+}
+
+GST_START_TEST (test_stats_interval)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  guint interval;
+
+  /* test that the periodic stats updates are posted on the bus */
+  t->on_negotiation_needed = NULL;
+  t->bus_message = _bus_stats_delta;
+
+  g_object_set (t->webrtc1, "stats-interval", 20, NULL);
+  g_object_get (t->webrtc1, "stats-interval", &interval, NULL);
+  fail_unless_equals_int (interval, 20);
+
+  /* the updates run on the peerconnection thread */
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  test_webrtc_wait_for_state_mask (t, 1 << STATE_CUSTOM);
+
+  g_object_set (t->webrtc1, "stats-interval", 0, NULL);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_add_transceiver)
 {
   struct test_webrtc *t = test_webrtc_new ();
@@ -2321,6 +2449,77 @@ GST_START_TEST (test_data_channel_transfer_data)
 
 GST_END_TEST;
 
+#define LARGE_DATA_SIZE (256 * 1024)
+
+static void
+have_data_channel_transfer_large_data (struct test_webrtc *t,
+    GstElement * element, GObject * our, gpointer user_data)
+{
+  GObject *other = user_data;
+  guint8 *bytes = g_malloc (LARGE_DATA_SIZE);
+  GBytes *data;
+  GstWebRTCDataChannelState state;
+  GError *error = NULL;
+  guint i;
+
+  for (i = 0; i < LARGE_DATA_SIZE; i++)
+    bytes[i] = i % 251;
+  data = g_bytes_new_take (bytes, LARGE_DATA_SIZE);
+
+  g_object_get (our, "ready-state", &state, NULL);
+  fail_unless_equals_int (GST_WEBRTC_DATA_CHANNEL_STATE_OPEN, state);
+
+  g_object_set_data_full (our, "expected", g_bytes_ref (data),
+      (GDestroyNotify) g_bytes_unref);
+
+  fail_unless (gst_webrtc_data_channel_send_data_full (GST_WEBRTC_DATA_CHANNEL
+          (other), data, &error));
+  g_assert_null (error);
+  g_bytes_unref (data);
+}
+
+/* a message larger than what sctpenc passes to the SCTP stack at once must
+ * arrive in one piece */
+GST_START_TEST (test_data_channel_transfer_large_data)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GObject *channel = NULL;
+  VAL_SDP_INIT (media_count, _count_num_sdp_media, GUINT_TO_POINTER (1), NULL);
+  VAL_SDP_INIT (offer, on_sdp_has_datachannel, NULL, &media_count);
+
+  t->on_negotiation_needed = NULL;
+  t->on_ice_candidate = NULL;
+  t->on_prepare_data_channel = have_prepare_data_channel;
+  t->on_data_channel = have_data_channel_transfer_large_data;
+
+  g_object_set (t->webrtc1, "sctp-bulk-mode", TRUE, NULL);
+  g_object_set (t->webrtc2, "sctp-bulk-mode", TRUE, NULL);
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (t->webrtc1, "create-data-channel", "label", NULL,
+      &channel);
+  g_assert_nonnull (channel);
+  t->data_channel_data = channel;
+  g_signal_connect (channel, "on-error",
+      G_CALLBACK (on_channel_error_not_reached), NULL);
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  test_validate_sdp_full (t, &offer, &offer, 1 << STATE_CUSTOM, FALSE);
+
+  g_object_unref (channel);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 static void
 have_data_channel_create_data_channel (struct test_webrtc *t,
     GstElement * element, GObject * our, gpointer user_data)
@@ -3064,6 +3263,80 @@ GST_START_TEST (test_duplicate_nego)
 
 GST_END_TEST;
 
+static void
+_check_transceivers_mlines (struct test_webrtc *t, GstElement * element,
+    GstWebRTCSessionDescription * sd, gpointer user_data)
+{
+  GArray *transceivers;
+  guint i;
+
+  g_signal_emit_by_name (element, "get-transceivers", &transceivers);
+  fail_unless_equals_int (transceivers->len, GPOINTER_TO_UINT (user_data));
+
+  for (i = 0; i < transceivers->len; i++) {
+    GstWebRTCRTPTransceiver *trans =
+        g_array_index (transceivers, GstWebRTCRTPTransceiver *, i);
+    const GstSDPMedia *media = gst_sdp_message_get_media (sd->sdp, i);
+    guint mline;
+    gchar *mid;
+
+    g_object_get (trans, "mlineindex", &mline, "mid", &mid, NULL);
+    fail_unless_equals_int (mline, i);
+    fail_unless_equals_string (mid,
+        gst_sdp_media_get_attribute_val (media, "mid"));
+    g_free (mid);
+  }
+
+  g_array_unref (transceivers);
+}
+
+/* Negotiates an increasing number of bundled m-lines and logs how long
+ * each offer/answer exchange takes, which should grow about linearly */
+GST_START_TEST (test_bundle_many_mlines)
+{
+  const guint n_mlines[] = { 8, 32, 128 };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (n_mlines); i++) {
+    struct test_webrtc *t = test_webrtc_new ();
+    guint n = n_mlines[i];
+    VAL_SDP_INIT (count, _count_num_sdp_media, GUINT_TO_POINTER (n), NULL);
+    VAL_SDP_INIT (answer, _check_transceivers_mlines, GUINT_TO_POINTER (n),
+        &count);
+    GstCaps *caps;
+    gint64 start;
+
+    t->on_negotiation_needed = NULL;
+    t->on_ice_candidate = NULL;
+
+    gst_util_set_object_arg (G_OBJECT (t->webrtc1), "bundle-policy",
+        "max-bundle");
+    gst_util_set_object_arg (G_OBJECT (t->webrtc2), "bundle-policy",
+        "max-bundle");
+
+    caps = gst_caps_from_string ("application/x-rtp,payload=96,"
+        "encoding-name=OPUS,media=audio,clock-rate=48000");
+    for (j = 0; j < n; j++) {
+      GstWebRTCRTPTransceiver *trans;
+
+      g_signal_emit_by_name (t->webrtc1, "add-transceiver",
+          GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_RECVONLY, caps, &trans);
+      fail_unless (trans != NULL);
+      gst_object_unref (trans);
+    }
+    gst_caps_unref (caps);
+
+    start = g_get_monotonic_time ();
+    test_validate_sdp (t, &count, &answer);
+    GST_INFO ("negotiated %u m-lines in %" G_GINT64_FORMAT " us", n,
+        g_get_monotonic_time () - start);
+
+    test_webrtc_free (t);
+  }
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_dual_audio)
 {
   struct test_webrtc *t = create_audio_test ();
@@ -5794,6 +6067,8 @@ webrtcbin_suite (void)
     tcase_add_test (tc, test_sdp_no_media);
     tcase_add_test (tc, test_session_stats);
     tcase_add_test (tc, test_stats_with_stream);
+    tcase_add_test (tc, test_filtered_stats);
+    tcase_add_test (tc, test_stats_interval);
     tcase_add_test (tc, test_audio);
     tcase_add_test (tc, test_ice_port_restriction);
     tcase_add_test (tc, test_audio_video);
@@ -5806,6 +6081,7 @@ webrtcbin_suite (void)
     tcase_add_test (tc, test_bundle_audio_video_max_bundle_max_bundle);
     tcase_add_test (tc, test_bundle_audio_video_max_bundle_none);
     tcase_add_test (tc, test_bundle_audio_video_max_compat_max_bundle);
+    tcase_add_test (tc, test_bundle_many_mlines);
     tcase_add_test (tc, test_dual_audio);
     tcase_add_test (tc, test_duplicate_nego);
     tcase_add_test (tc, test_renego_add_stream);
@@ -5842,6 +6118,7 @@ webrtcbin_suite (void)
       tcase_add_test (tc, test_data_channel_remote_notify);
       tcase_add_test (tc, test_data_channel_transfer_string);
       tcase_add_test (tc, test_data_channel_transfer_data);
+      tcase_add_test (tc, test_data_channel_transfer_large_data);
       tcase_add_test (tc, test_data_channel_create_after_negotiate);
       tcase_add_test (tc, test_data_channel_close);
       tcase_add_test (tc, test_data_channel_low_threshold);
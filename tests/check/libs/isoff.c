@@ -180,6 +180,72 @@ GST_START_TEST (isoff_moof_parse)
 
 GST_END_TEST;
 
+GST_START_TEST (isoff_moof_parse_in_place)
+{
+  GstByteReader reader = GST_BYTE_READER_INIT (moof1, sizeof (moof1));
+  GstBuffer *buffer;
+  GstMoofBox *moof, *moof_in_place;
+  GstTrafBox *traf, *traf_in_place;
+  GstTrunBox *trun, *trun_in_place;
+  GstTrunSample sample;
+  guint i;
+
+  fail_unless (gst_byte_reader_skip (&reader, 8));
+  moof = gst_isoff_moof_box_parse (&reader);
+  fail_unless (moof != NULL);
+
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (gpointer) moof1, sizeof (moof1), 0, sizeof (moof1), NULL, NULL);
+  moof_in_place = gst_isoff_moof_box_parse_buffer (buffer, 8,
+      sizeof (moof1) - 8);
+  gst_buffer_unref (buffer);
+  fail_unless (moof_in_place != NULL);
+
+  fail_unless_equals_int (moof_in_place->mfhd.sequence_number, 1);
+  fail_unless_equals_int (moof_in_place->traf->len, 1);
+
+  traf = &g_array_index (moof->traf, GstTrafBox, 0);
+  traf_in_place = &g_array_index (moof_in_place->traf, GstTrafBox, 0);
+  fail_unless_equals_int (traf_in_place->tfhd.track_id, 1);
+  fail_unless_equals_int (traf_in_place->trun->len, 1);
+
+  trun = &g_array_index (traf->trun, GstTrunBox, 0);
+  trun_in_place = &g_array_index (traf_in_place->trun, GstTrunBox, 0);
+  fail_unless_equals_int (trun_in_place->sample_count, 96);
+  fail_unless_equals_int (trun_in_place->data_offset, trun->data_offset);
+
+  /* Samples are only decoded on demand */
+  fail_unless (trun_in_place->samples == NULL);
+  fail_unless (trun_in_place->sample_data != NULL);
+  fail_unless_equals_int (trun_in_place->sample_record_size, 12);
+
+  for (i = 0; i < 96; i++) {
+    GstTrunSample *expected =
+        &g_array_index (trun->samples, GstTrunSample, i);
+
+    fail_unless (gst_isoff_trun_box_get_sample (trun_in_place, i, &sample));
+    fail_unless_equals_int (sample.sample_size, expected->sample_size);
+    fail_unless_equals_int (sample.sample_flags, expected->sample_flags);
+    fail_unless_equals_int (sample.sample_composition_time_offset.s,
+        expected->sample_composition_time_offset.s);
+  }
+  fail_if (gst_isoff_trun_box_get_sample (trun_in_place, 96, &sample));
+
+  /* Same accessor on an eagerly parsed trun */
+  fail_unless (gst_isoff_trun_box_get_sample (trun, 0, &sample));
+  fail_unless_equals_int (sample.sample_flags, 0x02000000);
+
+  fail_unless_equals_int (gst_isoff_trun_box_get_samples (trun_in_place)->len,
+      96);
+  fail_unless (memcmp (trun_in_place->samples->data, trun->samples->data,
+          96 * sizeof (GstTrunSample)) == 0);
+
+  gst_isoff_moof_box_free (moof_in_place);
+  gst_isoff_moof_box_free (moof);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (isoff_moof_parse_with_tfdt)
 {
   /* INDENT-ON */
@@ -338,6 +404,65 @@ GST_START_TEST (isoff_moov_parse)
 
 GST_END_TEST;
 
+GST_START_TEST (isoff_sidx_plan_ranges)
+{
+  GstSidxBoxEntry entries[4] = { {0,}, };
+  GstSidxBox sidx = { 0, };
+  GArray *ranges;
+  GstSidxRange *range;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (entries); i++) {
+    entries[i].size = 1000 + i;
+    entries[i].offset = i * 2000;
+    entries[i].pts = i * GST_SECOND;
+    entries[i].duration = GST_SECOND;
+  }
+  /* 0 and 2 start with a key unit, 3 with an open GOP SAP */
+  entries[0].starts_with_sap = TRUE;
+  entries[0].sap_type = 1;
+  entries[2].starts_with_sap = TRUE;
+  entries[2].sap_type = 2;
+  entries[3].starts_with_sap = TRUE;
+  entries[3].sap_type = 4;
+
+  sidx.entries = entries;
+  sidx.entries_count = G_N_ELEMENTS (entries);
+
+  ranges = gst_isoff_sidx_box_plan_ranges (&sidx, 500, GST_CLOCK_TIME_NONE,
+      GST_CLOCK_TIME_NONE, GST_ISOFF_SIDX_RANGE_PLAN_ALL);
+  fail_unless_equals_int (ranges->len, 4);
+  range = &g_array_index (ranges, GstSidxRange, 3);
+  fail_unless_equals_int (range->entry_index, 3);
+  fail_unless_equals_uint64 (range->offset, 6500);
+  fail_unless_equals_uint64 (range->size, 1003);
+  fail_unless_equals_uint64 (range->pts, 3 * GST_SECOND);
+  g_array_free (ranges, TRUE);
+
+  ranges = gst_isoff_sidx_box_plan_ranges (&sidx, 500, GST_CLOCK_TIME_NONE,
+      GST_CLOCK_TIME_NONE, GST_ISOFF_SIDX_RANGE_PLAN_KEY_UNITS);
+  fail_unless_equals_int (ranges->len, 2);
+  range = &g_array_index (ranges, GstSidxRange, 0);
+  fail_unless_equals_int (range->entry_index, 0);
+  fail_unless_equals_uint64 (range->offset, 500);
+  range = &g_array_index (ranges, GstSidxRange, 1);
+  fail_unless_equals_int (range->entry_index, 2);
+  fail_unless_equals_uint64 (range->offset, 4500);
+  g_array_free (ranges, TRUE);
+
+  /* Time restricted */
+  ranges = gst_isoff_sidx_box_plan_ranges (&sidx, 0, GST_SECOND + 1,
+      3 * GST_SECOND, GST_ISOFF_SIDX_RANGE_PLAN_ALL);
+  fail_unless_equals_int (ranges->len, 2);
+  fail_unless_equals_int (g_array_index (ranges, GstSidxRange, 0).entry_index,
+      1);
+  fail_unless_equals_int (g_array_index (ranges, GstSidxRange, 1).entry_index,
+      2);
+  g_array_free (ranges, TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 dash_isoff_suite (void)
 {
@@ -345,6 +470,7 @@ dash_isoff_suite (void)
   TCase *tc_isoff_box = tcase_create ("isoff-box-parsing");
   TCase *tc_moof = tcase_create ("moof");
   TCase *tc_moov = tcase_create ("moov");
+  TCase *tc_sidx = tcase_create ("sidx");
 
   tcase_add_test (tc_isoff_box, isoff_box_header_minimal);
   tcase_add_test (tc_isoff_box, isoff_box_header_long_size);
@@ -354,6 +480,7 @@ dash_isoff_suite (void)
   suite_add_tcase (s, tc_isoff_box);
 
   tcase_add_test (tc_moof, isoff_moof_parse);
+  tcase_add_test (tc_moof, isoff_moof_parse_in_place);
   tcase_add_test (tc_moof, isoff_moof_parse_with_tfdt);
   tcase_add_test (tc_moof, isoff_moof_parse_with_tfxd_tfrf);
   suite_add_tcase (s, tc_moof);
@@ -361,6 +488,9 @@ dash_isoff_suite (void)
   tcase_add_test (tc_moov, isoff_moov_parse);
   suite_add_tcase (s, tc_moov);
 
+  tcase_add_test (tc_sidx, isoff_sidx_plan_ranges);
+  suite_add_tcase (s, tc_sidx);
+
   return s;
 }
 
@@ -0,0 +1,197 @@
+/* GStreamer unit tests for the batched sends of the webrtc nice library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <sys/socket.h>
+#include <gst/check/gstcheck.h>
+#include <gio/gio.h>
+
+#include "../../../gst-libs/gst/webrtc/nice/nicebatch.h"
+
+/* more than the 64 datagrams of one sendmmsg() call, few enough for the
+ * receive buffer of the socket */
+#define N_DATAGRAMS 80
+
+/* A run of equally sized datagrams ended by a shorter one, a run of bigger
+ * ones and datagrams that all differ */
+static gsize
+datagram_size (guint i)
+{
+  if (i < 60)
+    return 1000;
+  if (i == 60)
+    return 300;
+  if (i < 70)
+    return 1200;
+  return 100 + i * 10;
+}
+
+static GSocket *
+create_socket (void)
+{
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+  GSocket *socket;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, 0);
+  fail_unless (g_socket_bind (socket, addr, FALSE, NULL));
+  g_object_unref (addr);
+  g_object_unref (iaddr);
+
+  return socket;
+}
+
+/* Each datagram starts with its index */
+static GstBufferList *
+create_list (void)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+  guint i;
+
+  for (i = 0; i < N_DATAGRAMS; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, datagram_size (i), NULL);
+    GstMapInfo map;
+
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    memset (map.data, i, map.size);
+    GST_WRITE_UINT16_BE (map.data, i);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_list_add (list, buf);
+  }
+
+  return list;
+}
+
+static void
+init_target (GstWebRTCNiceBatchTarget * target, GSocket * sender,
+    GSocket * receiver)
+{
+  GSocketAddress *addr = g_socket_get_local_address (receiver, NULL);
+
+  fail_unless (addr != NULL);
+  memset (target, 0, sizeof (*target));
+  target->socket = sender;
+  target->addr_len = g_socket_address_get_native_size (addr);
+  fail_unless (g_socket_address_to_native (addr, &target->addr,
+          sizeof (target->addr), NULL));
+  target->gso = TRUE;
+  g_object_unref (addr);
+}
+
+/* Every datagram arrives once, whole and in order */
+static void
+check_datagrams (GSocket * receiver)
+{
+  gchar *data = g_malloc (G_MAXUINT16);
+  gssize len;
+  guint i;
+
+  g_socket_set_timeout (receiver, 5);
+  for (i = 0; i < N_DATAGRAMS; i++) {
+    len = g_socket_receive (receiver, data, G_MAXUINT16, NULL, NULL);
+    fail_unless_equals_int (len, datagram_size (i));
+    fail_unless_equals_int (GST_READ_UINT16_BE (data), i);
+    fail_unless_equals_int ((guint8) data[len - 1], i & 0xff);
+  }
+
+  /* and nothing else */
+  g_socket_set_blocking (receiver, FALSE);
+  fail_unless_equals_int (g_socket_receive (receiver, data, G_MAXUINT16,
+          NULL, NULL), -1);
+  g_free (data);
+}
+
+GST_START_TEST (test_send_list)
+{
+  GstWebRTCNiceBatchTarget target;
+  GSocket *sender, *receiver;
+  GstBufferList *list;
+
+  sender = create_socket ();
+  receiver = create_socket ();
+  g_socket_set_option (receiver, SOL_SOCKET, SO_RCVBUF, 1024 * 1024, NULL);
+  init_target (&target, sender, receiver);
+
+  list = create_list ();
+  gst_webrtc_nice_batch_send_list (NULL, &target, list);
+  gst_buffer_list_unref (list);
+
+  check_datagrams (receiver);
+
+  g_object_unref (sender);
+  g_object_unref (receiver);
+}
+
+GST_END_TEST;
+
+#if defined(__linux__) && defined(SO_NO_CHECK)
+GST_START_TEST (test_send_list_without_gso)
+{
+  GstWebRTCNiceBatchTarget target;
+  GSocket *sender, *receiver;
+  GstBufferList *list;
+
+  sender = create_socket ();
+  receiver = create_socket ();
+  g_socket_set_option (receiver, SOL_SOCKET, SO_RCVBUF, 1024 * 1024, NULL);
+  init_target (&target, sender, receiver);
+
+  /* the kernel refuses segmentation offload without UDP checksums */
+  fail_unless (g_socket_set_option (sender, SOL_SOCKET, SO_NO_CHECK, 1,
+          NULL));
+
+  list = create_list ();
+  gst_webrtc_nice_batch_send_list (NULL, &target, list);
+  gst_buffer_list_unref (list);
+
+  /* the remaining datagrams were sent one by one */
+  fail_if (target.gso);
+  check_datagrams (receiver);
+
+  g_object_unref (sender);
+  g_object_unref (receiver);
+}
+
+GST_END_TEST;
+#endif
+
+static Suite *
+nicebatch_suite (void)
+{
+  Suite *s = suite_create ("nicebatch");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_send_list);
+#if defined(__linux__) && defined(SO_NO_CHECK)
+  tcase_add_test (tc_chain, test_send_list_without_gso);
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (nicebatch);
@@ -0,0 +1,156 @@
+/* GStreamer unit tests for the uridownloader library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gsturidownloader.h>
+
+#include "../elements/test_http_src.h"
+
+#define FRAGMENT_SIZE 4096
+
+static gboolean
+timings_src_start (GstTestHTTPSrc * src, const gchar * uri,
+    GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  input_data->size = FRAGMENT_SIZE;
+  input_data->connect_time = *(GstClockTime *) user_data;
+
+  return TRUE;
+}
+
+static GstFlowReturn
+timings_src_create (GstTestHTTPSrc * src, guint64 offset, guint length,
+    GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, length, NULL);
+
+  gst_buffer_memset (buf, 0, 0xab, length);
+  *retbuf = buf;
+
+  return GST_FLOW_OK;
+}
+
+static const GstTestHTTPSrcCallbacks timings_callbacks = {
+  .src_start = timings_src_start,
+  .src_create = timings_src_create,
+};
+
+GST_START_TEST (test_fragment_timings)
+{
+  GstUriDownloader *downloader;
+  GstFragment *fragment;
+  GstStructure *timings;
+  GstClockTime connect_time, response_time, first_byte_time, download_time,
+      transfer_time;
+  GstClockTime reported_connect_time = 5 * GST_MSECOND;
+  GError *err = NULL;
+
+  fail_unless (gst_test_http_src_register_plugin (gst_registry_get (),
+          "testhttpsrc"));
+  gst_test_http_src_install_callbacks (&timings_callbacks,
+      &reported_connect_time);
+  downloader = gst_uri_downloader_new ();
+
+  /* a new connection, the source reports how long it took */
+  fragment = gst_uri_downloader_fetch_uri (downloader,
+      "http://unit.test/fragment-0.ts", NULL, FALSE, FALSE, TRUE, &err);
+  fail_unless (fragment != NULL);
+  fail_unless (err == NULL);
+  fail_unless (fragment->completed);
+
+  timings = gst_fragment_get_timings (fragment);
+  fail_unless (gst_structure_has_name (timings, "GstFragmentTimings"));
+  fail_unless (gst_structure_get (timings,
+          "connect-time", GST_TYPE_CLOCK_TIME, &connect_time,
+          "response-time", GST_TYPE_CLOCK_TIME, &response_time,
+          "first-byte-time", GST_TYPE_CLOCK_TIME, &first_byte_time,
+          "download-time", GST_TYPE_CLOCK_TIME, &download_time,
+          "transfer-time", GST_TYPE_CLOCK_TIME, &transfer_time, NULL));
+  fail_unless_equals_clocktime (connect_time, reported_connect_time);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (response_time));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (first_byte_time));
+  fail_unless (first_byte_time >= response_time);
+  fail_unless (download_time >= first_byte_time);
+  fail_unless_equals_clocktime (transfer_time,
+      download_time - first_byte_time);
+  gst_structure_free (timings);
+  g_object_unref (fragment);
+
+  /* the source of the same origin is reused, its connection was already
+   * set up when the request was issued */
+  reported_connect_time = GST_CLOCK_TIME_NONE;
+  fragment = gst_uri_downloader_fetch_uri (downloader,
+      "http://unit.test/fragment-1.ts", NULL, FALSE, FALSE, TRUE, &err);
+  fail_unless (fragment != NULL);
+  fail_unless (err == NULL);
+
+  g_object_get (fragment, "timings", &timings, NULL);
+  fail_unless (timings != NULL);
+  fail_unless (gst_structure_get_clock_time (timings, "connect-time",
+          &connect_time));
+  fail_unless_equals_clocktime (connect_time, 0);
+  gst_structure_free (timings);
+  g_object_unref (fragment);
+
+  g_object_unref (downloader);
+  gst_test_http_src_install_callbacks (NULL, NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fragment_timings_unknown)
+{
+  GstFragment *fragment;
+  GstStructure *timings;
+  GstClockTime value;
+  const gchar *fields[] = { "connect-time", "response-time",
+    "first-byte-time", "download-time", "transfer-time"
+  };
+  guint i;
+
+  /* nothing was requested */
+  fragment = gst_fragment_new ();
+  timings = gst_fragment_get_timings (fragment);
+  for (i = 0; i < G_N_ELEMENTS (fields); i++) {
+    fail_unless (gst_structure_get_clock_time (timings, fields[i], &value));
+    fail_if (GST_CLOCK_TIME_IS_VALID (value));
+  }
+  gst_structure_free (timings);
+  g_object_unref (fragment);
+}
+
+GST_END_TEST;
+
+static Suite *
+uridownloader_suite (void)
+{
+  Suite *s = suite_create ("uridownloader");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_fragment_timings);
+  tcase_add_test (tc_chain, test_fragment_timings_unknown);
+
+  return s;
+}
+
+GST_CHECK_MAIN (uridownloader);
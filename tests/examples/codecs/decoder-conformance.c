@@ -0,0 +1,360 @@
+/* GStreamer
+ *
+ * Decoder conformance and speed runner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program decodes each bitstream of a directory with the given decoder
+ * into a videocodectestsink, and writes one JSON report with the result of
+ * each of them. A bitstream named "foo.bit" is checked against the
+ * per-frame checksums of "foo.bit.md5", if any. The report contains the
+ * "conformance/stats" and "conformance/checksum" messages of the sink, the
+ * decoding latency of the frames being measured with a latencystamp before
+ * the decoder.
+ *
+ * For example:
+ *   decoder-conformance -d "dav1ddec" -o report.json av1-conformance/
+ *   decoder-conformance -d "libde265dec ! videoconvert" hevc-conformance/
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <json-glib/json-glib.h>
+
+static gchar *decoder = NULL;
+static gchar *output = NULL;
+static gint timeout = 60;
+
+typedef struct
+{
+  GMainLoop *loop;
+  GstElement *stamp;
+  GstStructure *stats;
+  GstStructure *checksum;
+  gchar *error;
+  gboolean timed_out;
+} Run;
+
+static void
+add_json_value (JsonBuilder * builder, const GValue * value)
+{
+  GType type = G_VALUE_TYPE (value);
+
+  if (type == G_TYPE_STRING) {
+    json_builder_add_string_value (builder, g_value_get_string (value));
+  } else if (type == G_TYPE_UINT) {
+    json_builder_add_int_value (builder, g_value_get_uint (value));
+  } else if (type == G_TYPE_INT) {
+    json_builder_add_int_value (builder, g_value_get_int (value));
+  } else if (type == G_TYPE_UINT64) {
+    /* JSON numbers are signed, counters never get that large */
+    json_builder_add_int_value (builder, g_value_get_uint64 (value));
+  } else if (type == G_TYPE_INT64) {
+    json_builder_add_int_value (builder, g_value_get_int64 (value));
+  } else if (type == G_TYPE_DOUBLE) {
+    json_builder_add_double_value (builder, g_value_get_double (value));
+  } else if (type == G_TYPE_BOOLEAN) {
+    json_builder_add_boolean_value (builder, g_value_get_boolean (value));
+  } else if (GST_VALUE_HOLDS_ARRAY (value)) {
+    guint i;
+
+    json_builder_begin_array (builder);
+    for (i = 0; i < gst_value_array_get_size (value); i++)
+      add_json_value (builder, gst_value_array_get_value (value, i));
+    json_builder_end_array (builder);
+  } else {
+    gchar *str = gst_value_serialize (value);
+
+    json_builder_add_string_value (builder, str ? str : "");
+    g_free (str);
+  }
+}
+
+static gboolean
+add_json_field (GQuark field, const GValue * value, gpointer user_data)
+{
+  JsonBuilder *builder = user_data;
+
+  json_builder_set_member_name (builder, g_quark_to_string (field));
+  add_json_value (builder, value);
+
+  return TRUE;
+}
+
+static gboolean
+bus_msg (GstBus * bus, GstMessage * msg, gpointer user_data)
+{
+  Run *run = user_data;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *err;
+
+      gst_message_parse_error (msg, &err, NULL);
+      if (!run->error)
+        run->error = g_strdup (err->message);
+      g_error_free (err);
+      g_main_loop_quit (run->loop);
+      break;
+    }
+    case GST_MESSAGE_ELEMENT:{
+      const GstStructure *s = gst_message_get_structure (msg);
+
+      if (gst_structure_has_name (s, "conformance/stats")) {
+        gst_clear_structure (&run->stats);
+        run->stats = gst_structure_copy (s);
+      } else if (gst_structure_has_name (s, "conformance/checksum")) {
+        gst_clear_structure (&run->checksum);
+        run->checksum = gst_structure_copy (s);
+      }
+      break;
+    }
+    case GST_MESSAGE_EOS:
+      g_main_loop_quit (run->loop);
+      break;
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+run_timeout (gpointer user_data)
+{
+  Run *run = user_data;
+
+  if (!run->error)
+    run->error = g_strdup ("Timeout");
+  run->timed_out = TRUE;
+  g_main_loop_quit (run->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Links the first video stream out of parsebin */
+static void
+pad_added (GstElement * parsebin, GstPad * pad, Run * run)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (run->stamp, "sink");
+  GstCaps *caps = gst_pad_get_current_caps (pad);
+
+  if (!caps)
+    caps = gst_pad_query_caps (pad, NULL);
+
+  if (!gst_pad_is_linked (sinkpad) && !gst_caps_is_empty (caps) &&
+      g_str_has_prefix (gst_structure_get_name (gst_caps_get_structure (caps,
+                  0)), "video/"))
+    gst_pad_link (pad, sinkpad);
+
+  gst_caps_unref (caps);
+  gst_object_unref (sinkpad);
+}
+
+static void
+run_one (const gchar * path, JsonBuilder * builder)
+{
+  GstElement *pipeline, *src, *parsebin, *dec, *sink;
+  GError *err = NULL;
+  gchar *manifest, *basename;
+  const gchar *status;
+  guint mismatched = 0;
+  guint timeout_id, bus_id;
+  Run run = { NULL, };
+
+  manifest = g_strconcat (path, ".md5", NULL);
+  if (!g_file_test (manifest, G_FILE_TEST_IS_REGULAR))
+    g_clear_pointer (&manifest, g_free);
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  parsebin = gst_element_factory_make ("parsebin", NULL);
+  run.stamp = gst_element_factory_make ("latencystamp", NULL);
+  sink = gst_element_factory_make ("videocodectestsink", NULL);
+  dec = gst_parse_bin_from_description (decoder, TRUE, &err);
+  if (!src || !parsebin || !run.stamp || !sink || !dec) {
+    g_printerr ("Failed to create the elements: %s\n",
+        err ? err->message : "missing plugin");
+    exit (1);
+  }
+
+  g_object_set (src, "location", path, NULL);
+  g_object_set (sink, "manifest", manifest, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, parsebin, run.stamp, dec, sink,
+      NULL);
+  gst_element_link (src, parsebin);
+  gst_element_link_many (run.stamp, dec, sink, NULL);
+  g_signal_connect (parsebin, "pad-added", G_CALLBACK (pad_added), &run);
+
+  run.loop = g_main_loop_new (NULL, FALSE);
+  bus_id = gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), bus_msg, &run);
+  timeout_id = g_timeout_add_seconds (timeout, run_timeout, &run);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (run.loop);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  if (!run.timed_out)
+    g_source_remove (timeout_id);
+  g_source_remove (bus_id);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (run.loop);
+
+  if (run.checksum)
+    gst_structure_get_uint (run.checksum, "frames-mismatched", &mismatched);
+  if (run.error)
+    status = "error";
+  else if (!manifest)
+    status = "unchecked";
+  else
+    status = mismatched ? "fail" : "pass";
+
+  basename = g_path_get_basename (path);
+  json_builder_begin_object (builder);
+  json_builder_set_member_name (builder, "file");
+  json_builder_add_string_value (builder, basename);
+  json_builder_set_member_name (builder, "status");
+  json_builder_add_string_value (builder, status);
+  if (run.error) {
+    json_builder_set_member_name (builder, "error");
+    json_builder_add_string_value (builder, run.error);
+  }
+  if (run.stats)
+    gst_structure_foreach (run.stats, add_json_field, builder);
+  if (run.checksum)
+    gst_structure_foreach (run.checksum, add_json_field, builder);
+  json_builder_end_object (builder);
+
+  g_printerr ("%-40s %s\n", basename, status);
+
+  g_free (basename);
+  g_free (manifest);
+  g_free (run.error);
+  gst_clear_structure (&run.stats);
+  gst_clear_structure (&run.checksum);
+}
+
+static gint
+compare_names (gconstpointer a, gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"decoder", 'd', 0, G_OPTION_ARG_STRING, &decoder,
+        "Decoder bin description, with a single always source pad", NULL},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+        "File to write the report to (default: standard output)", NULL},
+    {"timeout", 't', 0, G_OPTION_ARG_INT, &timeout,
+        "Timeout in seconds for each bitstream (default: 60)", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GPtrArray *files;
+  JsonBuilder *builder;
+  JsonGenerator *generator;
+  JsonNode *root;
+  gchar *json;
+  GDir *dir;
+  const gchar *name;
+  guint i;
+
+  ctx = g_option_context_new ("DIRECTORY - decoder conformance runner");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_option_context_free (ctx);
+    g_clear_error (&err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 2 || !decoder) {
+    g_printerr ("Usage: %s -d DECODER [OPTION...] DIRECTORY\n", argv[0]);
+    return 1;
+  }
+
+  dir = g_dir_open (argv[1], 0, &err);
+  if (!dir) {
+    g_printerr ("Error opening %s: %s\n", argv[1], err->message);
+    g_clear_error (&err);
+    return 1;
+  }
+
+  /* Everything but the manifests and previous reports is a bitstream */
+  files = g_ptr_array_new_with_free_func (g_free);
+  while ((name = g_dir_read_name (dir))) {
+    gchar *path = g_build_filename (argv[1], name, NULL);
+
+    if (!g_str_has_suffix (name, ".md5") && !g_str_has_suffix (name, ".json")
+        && g_file_test (path, G_FILE_TEST_IS_REGULAR))
+      g_ptr_array_add (files, path);
+    else
+      g_free (path);
+  }
+  g_dir_close (dir);
+  g_ptr_array_sort (files, compare_names);
+
+  builder = json_builder_new ();
+  json_builder_begin_object (builder);
+  json_builder_set_member_name (builder, "decoder");
+  json_builder_add_string_value (builder, decoder);
+  json_builder_set_member_name (builder, "results");
+  json_builder_begin_array (builder);
+  for (i = 0; i < files->len; i++)
+    run_one (g_ptr_array_index (files, i), builder);
+  json_builder_end_array (builder);
+  json_builder_end_object (builder);
+
+  root = json_builder_get_root (builder);
+  generator = json_generator_new ();
+  json_generator_set_pretty (generator, TRUE);
+  json_generator_set_root (generator, root);
+  json = json_generator_to_data (generator, NULL);
+  json_node_unref (root);
+  g_object_unref (generator);
+  g_object_unref (builder);
+
+  if (output) {
+    if (!g_file_set_contents (output, json, -1, &err)) {
+      g_printerr ("Error writing %s: %s\n", output, err->message);
+      g_clear_error (&err);
+      return 1;
+    }
+  } else {
+    puts (json);
+  }
+
+  g_free (json);
+  g_ptr_array_unref (files);
+  g_free (decoder);
+  g_free (output);
+
+  return 0;
+}
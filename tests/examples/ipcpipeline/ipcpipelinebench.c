@@ -0,0 +1,249 @@
+/* GStreamer
+ *
+ * benchmark for the buffer transport of ipcpipelinesrc/ipcpipelinesink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program pushes raw 1080p and 4K video through ipcpipelinesink to an
+ * ipcpipelinesrc in a child process, once with the buffers written on the
+ * socket and once with their memory passed as a file descriptor, and
+ * reports the frame rates.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <gst/gst.h>
+
+static gint num_buffers = 300;
+static gchar *format = NULL;
+
+typedef struct
+{
+  const gchar *name;
+  gint width;
+  gint height;
+} Resolution;
+
+static const Resolution resolutions[] = {
+  {"1080p", 1920, 1080},
+  {"4K", 3840, 2160},
+};
+
+static gboolean
+master_bus_msg (GstBus * bus, GstMessage * msg, gpointer data)
+{
+  GMainLoop *loop = data;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *err;
+      gchar *dbg;
+
+      gst_message_parse_error (msg, &err, &dbg);
+      g_printerr ("ERROR: %s\n", err->message);
+      if (dbg != NULL)
+        g_printerr ("ERROR debug information: %s\n", dbg);
+      g_error_free (err);
+      g_free (dbg);
+      g_main_loop_quit (loop);
+      break;
+    }
+    case GST_MESSAGE_EOS:
+      g_main_loop_quit (loop);
+      break;
+    default:
+      break;
+  }
+  return TRUE;
+}
+
+static gdouble
+run_master (int fd, const Resolution * res, gboolean fd_passing)
+{
+  GMainLoop *loop;
+  GstElement *pipeline, *source, *capsfilter, *ipcpipelinesink;
+  GstCaps *caps;
+  gint64 start, elapsed;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  pipeline = gst_pipeline_new (NULL);
+  gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), master_bus_msg, loop);
+
+  /* a static pattern, so that the source costs as little as possible */
+  source = gst_element_factory_make ("videotestsrc", NULL);
+  g_object_set (source, "pattern", 2, "num-buffers", num_buffers, NULL);
+
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, format,
+      "width", G_TYPE_INT, res->width, "height", G_TYPE_INT, res->height,
+      "framerate", GST_TYPE_FRACTION, 0, 1, NULL);
+  g_object_set (capsfilter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  ipcpipelinesink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  g_object_set (ipcpipelinesink, "fdin", fd, "fdout", fd, "fd-passing",
+      fd_passing, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), source, capsfilter, ipcpipelinesink,
+      NULL);
+  gst_element_link_many (source, capsfilter, ipcpipelinesink, NULL);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+  elapsed = g_get_monotonic_time () - start;
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_watch (GST_ELEMENT_BUS (pipeline));
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+
+  return elapsed > 0 ? num_buffers * (gdouble) G_USEC_PER_SEC / elapsed : 0;
+}
+
+static void
+run_slave (int fd)
+{
+  GMainLoop *loop;
+  GstElement *pipeline, *ipcpipelinesrc, *sink;
+
+  pipeline = gst_element_factory_make ("ipcslavepipeline", NULL);
+  ipcpipelinesrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  g_object_set (ipcpipelinesrc, "fdin", fd, "fdout", fd, NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), ipcpipelinesrc, sink, NULL);
+  gst_element_link_many (ipcpipelinesrc, sink, NULL);
+
+  /* The slave is driven by the master until it kills us */
+  loop = g_main_loop_new (NULL, FALSE);
+  g_main_loop_run (loop);
+}
+
+/* Both pipelines run in their own child process, so that each run starts
+ * from a fresh GStreamer and the result goes back through a pipe */
+static gdouble
+run_one (const Resolution * res, gboolean fd_passing)
+{
+  int sockets[2], result[2];
+  pid_t slave, master;
+  gdouble fps = 0;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) || pipe (result)) {
+    fprintf (stderr, "Error creating sockets: %s\n", strerror (errno));
+    exit (1);
+  }
+  if (fcntl (sockets[0], F_SETFL, O_NONBLOCK) < 0 ||
+      fcntl (sockets[1], F_SETFL, O_NONBLOCK) < 0) {
+    fprintf (stderr, "Error setting O_NONBLOCK on sockets: %s\n",
+        strerror (errno));
+    exit (1);
+  }
+
+  slave = fork ();
+  if (slave < 0) {
+    fprintf (stderr, "Error forking: %s\n", strerror (errno));
+    exit (1);
+  } else if (slave == 0) {
+    close (sockets[0]);
+    gst_init (NULL, NULL);
+    run_slave (sockets[1]);
+    _exit (0);
+  }
+
+  master = fork ();
+  if (master < 0) {
+    fprintf (stderr, "Error forking: %s\n", strerror (errno));
+    exit (1);
+  } else if (master == 0) {
+    close (sockets[1]);
+    gst_init (NULL, NULL);
+    fps = run_master (sockets[0], res, fd_passing);
+    if (write (result[1], &fps, sizeof (fps)) != sizeof (fps))
+      _exit (1);
+    _exit (0);
+  }
+
+  close (sockets[0]);
+  close (sockets[1]);
+  close (result[1]);
+  if (read (result[0], &fps, sizeof (fps)) != sizeof (fps))
+    fps = 0;
+  close (result[0]);
+  waitpid (master, NULL, 0);
+  kill (slave, SIGTERM);
+  waitpid (slave, NULL, 0);
+
+  return fps;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"num-buffers", 'n', 0, G_OPTION_ARG_INT, &num_buffers,
+        "Number of frames to send for each run", NULL},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Raw video format (default: I420)", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("- ipcpipeline buffer transport benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_option_context_free (ctx);
+    g_clear_error (&err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (!format)
+    format = g_strdup ("I420");
+
+  g_print ("%-8s %-8s %12s %12s %8s\n", "size", "format", "socket fps",
+      "fd fps", "speedup");
+  for (i = 0; i < G_N_ELEMENTS (resolutions); i++) {
+    gdouble socket_fps, fd_fps;
+
+    socket_fps = run_one (&resolutions[i], FALSE);
+    fd_fps = run_one (&resolutions[i], TRUE);
+    g_print ("%-8s %-8s %12.1f %12.1f %7.2fx\n", resolutions[i].name, format,
+        socket_fps, fd_fps, socket_fps > 0 ? fd_fps / socket_fps : 0);
+  }
+
+  g_free (format);
+
+  return 0;
+}
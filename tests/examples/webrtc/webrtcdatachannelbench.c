@@ -0,0 +1,271 @@
+/* Measures the data channel throughput between two webrtcbins in the same
+ * process.
+ *
+ * The sender keeps the buffered amount of its channel between a high and a
+ * low water mark, the way an application pushing bulk data should, and the
+ * throughput is reported once the receiver got all the data. */
+
+#include <gst/gst.h>
+#include <gst/webrtc/webrtc.h>
+
+#include <string.h>
+
+static GMainLoop *loop;
+static GstElement *pipe1, *webrtc1, *webrtc2;
+static GstBus *bus1;
+
+static gint total_mib = 64;
+static gint message_kib = 64;
+static gint high_water_kib = 1024;
+static gboolean bulk_mode = FALSE;
+
+static GBytes *message;
+static guint64 bytes_queued, bytes_received, total_bytes;
+static gint64 start_time;
+/* protects bytes_queued against concurrent on-open/on-buffered-amount-low */
+static GMutex send_lock;
+
+static GOptionEntry entries[] = {
+  {"size", 's', 0, G_OPTION_ARG_INT, &total_mib,
+      "Amount of data to transfer in MiB (default: 64)", "MIB"},
+  {"message-size", 'm', 0, G_OPTION_ARG_INT, &message_kib,
+      "Size of each message in KiB (default: 64)", "KIB"},
+  {"high-water", 'w', 0, G_OPTION_ARG_INT, &high_water_kib,
+      "Buffered amount at which sending pauses in KiB (default: 1024)", "KIB"},
+  {"bulk", 'b', 0, G_OPTION_ARG_NONE, &bulk_mode,
+      "Enable the SCTP bulk mode of webrtcbin", NULL},
+  {NULL}
+};
+
+static gboolean
+_bus_watch (GstBus * bus, GstMessage * msg, GstElement * pipe)
+{
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *err = NULL;
+      gchar *dbg_info = NULL;
+
+      gst_message_parse_error (msg, &err, &dbg_info);
+      g_printerr ("ERROR from element %s: %s\n",
+          GST_OBJECT_NAME (msg->src), err->message);
+      g_printerr ("Debugging info: %s\n", (dbg_info) ? dbg_info : "none");
+      g_error_free (err);
+      g_free (dbg_info);
+      g_main_loop_quit (loop);
+      break;
+    }
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+/* Sends messages until the high water mark is reached or everything is
+ * queued */
+static void
+_fill_channel (GstWebRTCDataChannel * channel)
+{
+  g_mutex_lock (&send_lock);
+  while (bytes_queued < total_bytes) {
+    guint64 buffered;
+    GError *error = NULL;
+
+    g_object_get (channel, "buffered-amount", &buffered, NULL);
+    if (buffered >= high_water_kib * 1024)
+      break;
+
+    if (!gst_webrtc_data_channel_send_data_full (channel, message, &error)) {
+      g_printerr ("Failed to send data: %s\n", error->message);
+      g_clear_error (&error);
+      break;
+    }
+    bytes_queued += g_bytes_get_size (message);
+  }
+  g_mutex_unlock (&send_lock);
+}
+
+static void
+_on_open (GstWebRTCDataChannel * channel, gpointer user_data)
+{
+  g_print ("Channel open, sending %d MiB in %d KiB messages%s\n", total_mib,
+      message_kib, bulk_mode ? " in bulk mode" : "");
+
+  g_object_set (channel, "buffered-amount-low-threshold",
+      (guint64) high_water_kib * 1024 / 2, NULL);
+  start_time = g_get_monotonic_time ();
+  _fill_channel (channel);
+}
+
+static void
+_on_buffered_amount_low (GstWebRTCDataChannel * channel, gpointer user_data)
+{
+  _fill_channel (channel);
+}
+
+static gboolean
+_report (gpointer user_data)
+{
+  gdouble seconds = (g_get_monotonic_time () - start_time) / 1e6;
+
+  g_print ("Transferred %" G_GUINT64_FORMAT " bytes in %.3f s: %.2f MB/s\n",
+      bytes_received, seconds, bytes_received / seconds / 1e6);
+  g_main_loop_quit (loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_on_message_data (GstWebRTCDataChannel * channel, GBytes * data,
+    gpointer user_data)
+{
+  bytes_received += g_bytes_get_size (data);
+  if (bytes_received == total_bytes)
+    g_idle_add (_report, NULL);
+}
+
+static void
+_on_data_channel (GstElement * webrtc, GstWebRTCDataChannel * channel,
+    gpointer user_data)
+{
+  g_signal_connect (channel, "on-message-data", G_CALLBACK (_on_message_data),
+      NULL);
+}
+
+static void
+_on_answer_received (GstPromise * promise, gpointer user_data)
+{
+  GstWebRTCSessionDescription *answer = NULL;
+  const GstStructure *reply;
+
+  g_assert (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (promise);
+  gst_structure_get (reply, "answer",
+      GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &answer, NULL);
+  gst_promise_unref (promise);
+
+  g_signal_emit_by_name (webrtc1, "set-remote-description", answer, NULL);
+  g_signal_emit_by_name (webrtc2, "set-local-description", answer, NULL);
+
+  gst_webrtc_session_description_free (answer);
+}
+
+static void
+_on_offer_received (GstPromise * promise, gpointer user_data)
+{
+  GstWebRTCSessionDescription *offer = NULL;
+  const GstStructure *reply;
+
+  g_assert (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (promise);
+  gst_structure_get (reply, "offer",
+      GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &offer, NULL);
+  gst_promise_unref (promise);
+
+  g_signal_emit_by_name (webrtc1, "set-local-description", offer, NULL);
+  g_signal_emit_by_name (webrtc2, "set-remote-description", offer, NULL);
+
+  promise = gst_promise_new_with_change_func (_on_answer_received, user_data,
+      NULL);
+  g_signal_emit_by_name (webrtc2, "create-answer", NULL, promise);
+
+  gst_webrtc_session_description_free (offer);
+}
+
+static void
+_on_negotiation_needed (GstElement * element, gpointer user_data)
+{
+  GstPromise *promise;
+
+  promise = gst_promise_new_with_change_func (_on_offer_received, user_data,
+      NULL);
+  g_signal_emit_by_name (webrtc1, "create-offer", NULL, promise);
+}
+
+static void
+_on_ice_candidate (GstElement * webrtc, guint mlineindex, gchar * candidate,
+    GstElement * other)
+{
+  g_signal_emit_by_name (other, "add-ice-candidate", mlineindex, candidate);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GstWebRTCDataChannel *channel;
+  guint8 *data;
+
+  context = g_option_context_new ("- webrtcbin data channel benchmark");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("Error initializing: %s\n", error->message);
+    g_clear_error (&error);
+    g_option_context_free (context);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (total_mib <= 0 || message_kib <= 0 || high_water_kib <= 0) {
+    g_printerr ("Sizes must be positive\n");
+    return 1;
+  }
+
+  total_bytes = (guint64) total_mib * 1024 * 1024;
+  data = g_malloc (message_kib * 1024);
+  memset (data, 0xaa, message_kib * 1024);
+  message = g_bytes_new_take (data, message_kib * 1024);
+  /* only whole messages are sent */
+  total_bytes -= total_bytes % g_bytes_get_size (message);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  pipe1 = gst_parse_launch ("webrtcbin name=send webrtcbin name=recv", NULL);
+  bus1 = gst_pipeline_get_bus (GST_PIPELINE (pipe1));
+  gst_bus_add_watch (bus1, (GstBusFunc) _bus_watch, pipe1);
+
+  webrtc1 = gst_bin_get_by_name (GST_BIN (pipe1), "send");
+  webrtc2 = gst_bin_get_by_name (GST_BIN (pipe1), "recv");
+  g_object_set (webrtc1, "sctp-bulk-mode", bulk_mode, NULL);
+  g_object_set (webrtc2, "sctp-bulk-mode", bulk_mode, NULL);
+
+  g_signal_connect (webrtc1, "on-negotiation-needed",
+      G_CALLBACK (_on_negotiation_needed), NULL);
+  g_signal_connect (webrtc2, "on-data-channel", G_CALLBACK (_on_data_channel),
+      NULL);
+  g_signal_connect (webrtc1, "on-ice-candidate",
+      G_CALLBACK (_on_ice_candidate), webrtc2);
+  g_signal_connect (webrtc2, "on-ice-candidate",
+      G_CALLBACK (_on_ice_candidate), webrtc1);
+
+  gst_element_set_state (GST_ELEMENT (pipe1), GST_STATE_READY);
+
+  g_signal_emit_by_name (webrtc1, "create-data-channel", "bench", NULL,
+      &channel);
+  if (!channel) {
+    g_printerr ("Could not create data channel, is usrsctp available?\n");
+    return 1;
+  }
+  g_signal_connect (channel, "on-open", G_CALLBACK (_on_open), NULL);
+  g_signal_connect (channel, "on-buffered-amount-low",
+      G_CALLBACK (_on_buffered_amount_low), NULL);
+
+  gst_element_set_state (GST_ELEMENT (pipe1), GST_STATE_PLAYING);
+
+  g_main_loop_run (loop);
+
+  gst_element_set_state (GST_ELEMENT (pipe1), GST_STATE_NULL);
+
+  gst_object_unref (channel);
+  gst_object_unref (webrtc1);
+  gst_object_unref (webrtc2);
+  gst_bus_remove_watch (bus1);
+  gst_object_unref (bus1);
+  gst_object_unref (pipe1);
+  g_bytes_unref (message);
+
+  gst_deinit ();
+
+  return 0;
+}